@@ -113,6 +113,9 @@ protected:
                            bool direction,
                            list<ETranscriptSymbol>& subpath) const;
 
+    // progress hook of the vectorized score-only pass
+    static bool x_ScorePassProgress(void* aligner, size_t cells);
+
     virtual bool x_CheckMemoryLimit();
 
     friend class CThreadRunOnTop;
@@ -151,6 +151,12 @@ public:
     unsigned char GetMBTemplateType() const;
     void SetMBTemplateType(unsigned char type);
 
+    /// Store the megablast lookup table with a compact backbone; this saves
+    /// memory and cache when few words are indexed, e.g. for batches of
+    /// short queries
+    bool GetMBCompactBackbone() const;
+    void SetMBCompactBackbone(bool compact = true);
+
     /******************* Query setup options ************************/
     void ClearFilterOptions();
 #endif /* SKIP_DOXYGEN_PROCESSING */
@@ -489,6 +489,28 @@ private:
     TSeqLocInfoVector m_QueryMasks;
 };
 
+
+/// Interface to receive the results of a search one query at a time.
+///
+/// Searches that report their results through this interface convert and
+/// pass on the results for each query as soon as they are available, and
+/// keep no reference to them, so that callers which format or store the
+/// results right away never hold the results for all queries in memory.
+///
+/// @sa CLocalBlast::Run(ISearchResultsHandler&)
+
+class NCBI_XBLAST_EXPORT ISearchResultsHandler : public CObject {
+public:
+    /// Destructor
+    virtual ~ISearchResultsHandler() {}
+
+    /// Receive the results for one query (for eSequenceComparison results,
+    /// one query-subject pair). Results are passed in the order in which
+    /// they would appear in a CSearchResultSet.
+    /// @param results Results for one query [in]
+    virtual void HandleResults(CRef<CSearchResults> results) = 0;
+};
+
 END_SCOPE(blast)
 END_NCBI_SCOPE
 
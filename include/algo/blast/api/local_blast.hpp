@@ -89,6 +89,13 @@ public:
     
     /// Executes the search
     CRef<CSearchResultSet> Run();
+
+    /// Executes the search, passing the results for each query to handler
+    /// as soon as they are available instead of collecting them in a
+    /// CSearchResultSet. Peak memory is then bounded by the traceback
+    /// results rather than by the Seq-aligns for the whole query batch.
+    /// @param handler Receives the results for each query [in]
+    void Run(ISearchResultsHandler& handler);
     
     /// Set a function callback to be invoked by the CORE of BLAST to allow
     /// interrupting a BLAST search in progress.
@@ -113,6 +120,9 @@ public:
     BlastDiagnostics* GetDiagnostics();
 
 private:
+    /// Run the preliminary stage of the search and set up m_TbackSearch
+    void x_InitTracebackSearch();
+
     /// Query factory from which to obtain the query sequence data
     CRef<IQueryFactory> m_QueryFactory;
     
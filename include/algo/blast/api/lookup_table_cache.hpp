@@ -0,0 +1,197 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file lookup_table_cache.hpp
+ * Declares a cache of pre-built lookup tables stored as files
+ */
+
+#ifndef ALGO_BLAST_API___LOOKUP_TABLE_CACHE_HPP
+#define ALGO_BLAST_API___LOOKUP_TABLE_CACHE_HPP
+
+#include <corelib/ncbiobj.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <algo/blast/core/lookup_image.h>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+
+// Forward declaration
+class CMemoryFile;
+
+BEGIN_SCOPE(blast)
+
+/// Cache of lookup tables stored as files in a directory, for services that
+/// search with the same queries or PSSMs over and over. A table is found by
+/// a key computed from the query, the lookup segments, the lookup table
+/// options and the score matrix (see lookup_image.h). Cached tables are
+/// memory mapped read-only and used in place, so processes that share the
+/// directory also share the physical memory of the tables. Since the key
+/// is a hash, a mapped table is only used if the full key stored with it
+/// matches.
+///
+/// A mapped file stays mapped while lookup tables use it, and these keep
+/// the cache alive. Unused files stay mapped for reuse until the mapped
+/// files exceed the size limit of the cache; the least recently used are
+/// then unmapped first. Files are never removed by the cache and are only
+/// valid on the platform, and with the version of the BLAST libraries,
+/// that wrote them; stale files are detected and replaced.
+class NCBI_XBLAST_EXPORT CLookupTableCache : public CObject
+{
+public:
+    /// Environment variable naming the directory of the default cache
+    static const char* kEnvVar;
+
+    /// Extension of the cached lookup table files
+    static const string kExtension;
+
+    /// Default limit on the size of the mapped files, in bytes
+    static const Uint8 kDefaultMaxMappedSize;
+
+    /// Get the cache used by CSetupFactory::CreateLookupTable
+    /// @return the cache set by SetDefault or, if none was set, a cache
+    /// in the directory named by the environment variable kEnvVar; NULL if
+    /// neither is available
+    static CRef<CLookupTableCache> GetDefault();
+
+    /// Set the cache used by CSetupFactory::CreateLookupTable
+    /// @param cache The cache; NULL disables caching [in]
+    static void SetDefault(CRef<CLookupTableCache> cache);
+
+    /// Constructor
+    /// @param dir Directory of the cached lookup tables; it is created if
+    /// it does not exist [in]
+    /// @param max_mapped_size Size of the mapped files, in bytes, above
+    /// which files no lookup table uses are unmapped [in]
+    /// @throw CBlastException if the directory cannot be created
+    CLookupTableCache(const string& dir,
+                      Uint8 max_mapped_size = kDefaultMaxMappedSize);
+
+    /// Destructor
+    ~CLookupTableCache();
+
+    /// Get the directory of the cached lookup tables
+    const string& GetDirectory() const { return m_Dir; }
+
+    /// Get the number of files currently mapped
+    size_t GetNumMapped() const;
+
+    /// Get the total size of the files currently mapped, in bytes
+    Uint8 GetMappedSize() const;
+
+    /// Create a lookup table, taking it from the cache if possible. Takes
+    /// the same arguments as LookupTableWrapInit, which is called to build
+    /// lookup tables that are not in the cache yet; these are then saved.
+    /// Errors in reading or writing the cache are reported as warnings and
+    /// do not prevent the lookup table from being created.
+    /// @return Status of LookupTableWrapInit, or 0 if the lookup table was
+    /// taken from the cache
+    Int2 CreateLookupTable(BLAST_SequenceBlk* query,
+                           const LookupTableOptions* lookup_options,
+                           const QuerySetUpOptions* query_options,
+                           BlastSeqLoc* lookup_segments,
+                           BlastScoreBlk* sbp,
+                           LookupTableWrap** lookup_wrap_ptr,
+                           Blast_Message** error_msg);
+
+private:
+    /// Prohibit copy constructor
+    CLookupTableCache(const CLookupTableCache&);
+    /// Prohibit assignment operator
+    CLookupTableCache& operator=(const CLookupTableCache&);
+
+    /// A mapped file
+    struct SMapping {
+        CMemoryFile* file;  ///< The mapping
+        Uint8 hash;         ///< Hash of the key of the lookup table
+        Uint8 size;         ///< Size of the file
+        int users;          ///< Number of lookup tables using the file
+        bool stale;         ///< True if the file was found to be stale
+    };
+
+    /// Type of the list of mapped files, most recently used first
+    typedef list<SMapping> TMappingList;
+    /// Type of the index of mapped files
+    typedef map<Uint8, TMappingList::iterator> TFileMap;
+
+    /// Name of the file holding the lookup table with the given key
+    /// @param hash Hash of the key of the lookup table [in]
+    string x_GetPath(Uint8 hash) const;
+
+    /// Create a lookup table from the cache
+    /// @param key Key of the lookup table [in]
+    /// @param query The query sequence [in][out]
+    /// @return the lookup table, or NULL if it is not in the cache
+    LookupTableWrap* x_Find(const LookupTableKey* key,
+                            BLAST_SequenceBlk* query);
+
+    /// Save a lookup table in the cache
+    /// @param key Key of the lookup table [in]
+    /// @param lookup_wrap The lookup table [in]
+    /// @param query The query sequence the table was built from [in]
+    void x_Save(const LookupTableKey* key,
+                const LookupTableWrap* lookup_wrap,
+                const BLAST_SequenceBlk* query);
+
+    /// Called when a lookup table created by x_Find is freed
+    /// @param image The image the table used [in]
+    void x_Release(const void* image);
+
+    /// Unmap a file; m_Mutex must be held
+    /// @param itr The file [in]
+    void x_Unmap(TMappingList::iterator itr);
+
+    /// Unmap unused files, least recently used first, until the mapped
+    /// files fit the size limit; m_Mutex must be held
+    void x_Trim();
+
+    /// Release callback installed in lookup tables created by x_Find
+    static void x_ReleaseImage(const void* image, void* data);
+
+    /// Directory of the cached lookup tables
+    string m_Dir;
+    /// Limit on m_MappedSize, exceeded only by files in use
+    Uint8 m_MaxMappedSize;
+    /// Total size of the mapped files
+    Uint8 m_MappedSize;
+    /// All files mapped by this cache
+    TMappingList m_Mapped;
+    /// Mapped files by hash, excluding those found to be stale
+    TFileMap m_Files;
+    /// Protects m_Mapped, m_Files and m_MappedSize
+    mutable CFastMutex m_Mutex;
+};
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
+
+#endif  /* ALGO_BLAST_API___LOOKUP_TABLE_CACHE_HPP */
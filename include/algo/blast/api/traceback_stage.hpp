@@ -78,6 +78,17 @@ public:
     /// Run the traceback search.
     CRef<CSearchResultSet> Run();
     
+    /// Run the traceback search, passing the results for each query to
+    /// handler as soon as they have been converted to Seq-aligns. For
+    /// BLAST database searches, the traceback results for a query are freed
+    /// once passed on, so the Seq-aligns for all queries are never held in
+    /// memory at once.
+    /// @param handler Receives the results [in]
+    /// @param query_masks Filtered query regions to set in the results, as
+    /// in CSearchResultSet::SetFilteredQueryRegions [in]
+    void Run(ISearchResultsHandler& handler,
+             const TSeqLocInfoVector& query_masks = TSeqLocInfoVector());
+    
     /// Runs the traceback but only returns the HSP's and not the Seq-Align.
     BlastHSPResults* RunSimple();
 
@@ -35,6 +35,7 @@
 #define ALGO_BLAST_BLASTINPUT__BLAST_INPUT_AUX__HPP
 
 #include <algo/blast/api/sseqloc.hpp>   /* for CBlastQueryVector */
+#include <algo/blast/api/blast_options.hpp>
 #include <objects/seqset/Bioseq_set.hpp>
 
 BEGIN_NCBI_SCOPE
@@ -257,6 +258,19 @@ int
 GetQueryBatchSize(EProgram program, bool is_ungapped = false, bool remote = false,
                   bool use_default = true);
 
+/** Retrieve a query batch size, in bases, for which the megablast lookup
+ * table fits in the given amount of cache. Meant for searches of many
+ * short queries, where keeping the lookup table in cache matters more than
+ * making the batches as large as possible.
+ * @param options BLAST options for a contiguous megablast search; the
+ * word size and the compact backbone setting are used [in]
+ * @param cache_size Bytes of cache available to the lookup table [in]
+ * @return the batch size; at least 1
+ */
+NCBI_BLASTINPUT_EXPORT
+int
+GetCacheAwareQueryBatchSize(const CBlastOptions& options, Uint8 cache_size);
+
 /** Read sequence input for BLAST 
  * @param in input stream from which to read [in]
  * @param read_proteins expect proteins or nucleotides as input [in]
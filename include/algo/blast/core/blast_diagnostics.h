@@ -63,6 +63,18 @@ typedef struct BlastUngappedStats {
                               i.e. number of HSPs saved after ungapped stage.*/
    Int4 num_seqs_passed; /**< Number of sequences with at least one HSP saved
                             after ungapped stage. */
+   double scan_time; /**< Time spent scanning the subjects for lookup table
+                        hits, in seconds; only measured if stage timing is
+                        enabled (see Blast_DiagnosticsSetStageTiming) */
+   double extension_time; /**< Time spent in ungapped extensions, in 
+                             seconds; only measured if stage timing is 
+                             enabled */
+   double scan_cpu_time; /**< CPU time spent scanning the subjects, in
+                            seconds; only measured if stage timing is
+                            enabled */
+   double extension_cpu_time; /**< CPU time spent in ungapped extensions,
+                                 in seconds; only measured if stage timing
+                                 is enabled */
 } BlastUngappedStats;
 
 /** Structure containing hit counts from the gapped stage of a BLAST 
@@ -76,8 +88,36 @@ typedef struct BlastGappedStats {
                             gapped extension */
    Int4 num_seqs_passed; /**< Number of sequences with top HSP passing the
                             e-value threshold. */
+   double extension_time; /**< Time spent in preliminary gapped extensions,
+                             in seconds; only measured if stage timing is
+                             enabled */
+   double extension_cpu_time; /**< CPU time spent in preliminary gapped
+                                 extensions, in seconds; only measured if
+                                 stage timing is enabled */
 } BlastGappedStats;
 
+/** Structure describing the work done by one thread in the preliminary
+ * stage of a multi-threaded BLAST search */
+typedef struct BlastThreadStats {
+   Int4 num_subjects; /**< Number of subject sequences searched */
+   Int4 num_steals; /**< Number of times this thread ran out of work and
+                       took subject sequences from another thread */
+   Int4 num_pieces; /**< Number of pieces of split subject sequences
+                       searched, included in num_subjects */
+   double busy_time; /**< Time spent searching, in seconds */
+   double idle_time; /**< Time spent waiting for the other threads to 
+                        finish, in seconds */
+   double cpu_time; /**< CPU time used by this thread, in seconds; 0 if the
+                       platform cannot report CPU time per thread */
+   double scan_time; /**< Time spent scanning for lookup table hits, in 
+                        seconds; only measured if stage timing is enabled */
+   double ungapped_time; /**< Time spent in ungapped extensions, in seconds;
+                            only measured if stage timing is enabled */
+   double gapped_time; /**< Time spent in preliminary gapped extensions, in
+                          seconds; only measured if stage timing is 
+                          enabled */
+} BlastThreadStats;
+
 /** Return statistics from the BLAST search */
 typedef struct BlastDiagnostics {
    BlastUngappedStats* ungapped_stat; /**< Ungapped extension counts */
@@ -85,6 +125,16 @@ typedef struct BlastDiagnostics {
    BlastRawCutoffs* cutoffs; /**< Various raw values for the cutoffs */
    MT_LOCK mt_lock; /**< Mutex for updating diagnostics data in a 
                        multi-threaded search. */
+   BlastThreadStats* thread_stat; /**< Per-thread work of the preliminary
+                                     stage; NULL unless the search was 
+                                     multi-threaded */
+   Int4 num_threads; /**< Number of elements in thread_stat */
+   double lookup_time; /**< Time spent building the lookup table, in 
+                          seconds; only measured if stage timing is 
+                          enabled */
+   double lookup_cpu_time; /**< CPU time spent building the lookup table,
+                              in seconds; only measured if stage timing is
+                              enabled */
 } BlastDiagnostics;
 
 /** Free the BlastDiagnostics structure and all substructures. */
@@ -115,6 +165,45 @@ void
 Blast_DiagnosticsUpdate(BlastDiagnostics* diag_global,
                         BlastDiagnostics* diag_local);
 
+/** Add the per-thread statistics of one multi-threaded run of the
+ * preliminary stage to the diagnostics. The statistics of consecutive runs
+ * (e.g. for the chunks of a split query) are summed if they used the same
+ * number of threads, otherwise the new statistics replace the old ones.
+ * @param diagnostics Diagnostics for the entire BLAST search [in] [out]
+ * @param thread_stat Statistics for each thread [in]
+ * @param num_threads Number of elements in thread_stat [in]
+ * @return 0 on success, -1 if out of memory
+ */
+Int2
+Blast_DiagnosticsAddThreadStats(BlastDiagnostics* diagnostics,
+                                const BlastThreadStats* thread_stat,
+                                Int4 num_threads);
+
+/** Enable or disable the measurement of the time spent in the stages of
+ * the search (lookup table construction, scanning, ungapped and gapped
+ * extension). Timing is off by default, because reading the clock for every
+ * subject sequence is not free. The setting applies to the whole process and
+ * should be changed only while no search is running.
+ * @param enable TRUE to measure the stage times [in]
+ */
+void Blast_DiagnosticsSetStageTiming(Boolean enable);
+
+/** Is the time spent in the stages of the search being measured?
+ * @return TRUE if Blast_DiagnosticsSetStageTiming enabled it
+ */
+Boolean Blast_DiagnosticsGetStageTiming(void);
+
+/** Read a monotonic wall clock
+ * @return time in seconds from an unspecified starting point
+ */
+double Blast_DiagnosticsTimer(void);
+
+/** Read the CPU time used by the calling thread
+ * @return time in seconds from an unspecified starting point; the CPU time
+ * of the whole process if the platform cannot report it per thread
+ */
+double Blast_DiagnosticsCpuTimer(void);
+
 #ifdef __cplusplus
 }
 #endif
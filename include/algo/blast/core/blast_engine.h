@@ -143,6 +143,22 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
    BlastHSPStream* hsp_stream, BlastDiagnostics* diagnostics,
    TInterruptFnPtr interrupt_search, SBlastProgress* progress_info);
 
+/** Can the preliminary search of one subject sequence be split into pieces
+ * searched by different threads (see blast_sched.h)? Only if the HSPs of a
+ * subject sequence are found chunk by chunk, and merging the HSP lists of 
+ * the pieces gives those of the whole subject sequence: the search must be 
+ * gapped, without sum statistics, and neither translate the subject nor be 
+ * an RPS or PHI BLAST search. The engine also searches whole subjects when 
+ * a database index is used.
+ * @param program_number Type of BLAST program [in]
+ * @param score_options Hit scoring options [in]
+ * @param hit_options Options for saving the HSPs [in]
+ */
+Boolean
+Blast_SubjectCanBeSplit(EBlastProgramType program_number,
+   const BlastScoringOptions* score_options,
+   const BlastHitSavingOptions* hit_options);
+
 /** The high level function performing the BLAST search against a BLAST 
  * database after all the setup has been done.
  * @param program_number Type of BLAST program [in]
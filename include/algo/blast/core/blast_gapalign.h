@@ -85,6 +85,10 @@ typedef struct BlastGapAlignStruct {
    Int4 greedy_subject_seed_start;  /**< for greedy alignments, the subject
                                          offset of the gapped start point */
    Int4 score;   /**< Return value: alignment score */
+   struct BlastSWProfile** sw_profiles; /**< Smith-Waterman query profiles,
+                                             one per query context, built
+                                             on first use */
+   Int4 num_sw_profiles; /**< number of entries in sw_profiles */
 } BlastGapAlignStruct;
 
 /** Initializes the BlastGapAlignStruct structure 
@@ -110,6 +110,17 @@ typedef struct BlastHSPStream {
    BlastHSPPipe *pre_pipe;         /**< registered preliminary pipeline (unused
                                     for now) */
    BlastHSPPipe *tback_pipe;       /**< registered traceback pipeline */
+   Boolean thread_buffer;          /**< Is this a buffer private to one
+                                    thread? If so, HSP lists are appended to
+                                    sorted_hsplists as they are written,
+                                    without locking */
+   Int4 buffer_hitlist_size;       /**< Number of hits per query saved by the
+                                    collector of the shared stream; HSP lists
+                                    of a thread buffer which can't be among
+                                    these are dropped */
+   Int4 buffer_prune_size;         /**< Number of HSP lists in a thread buffer
+                                    at which the lists that can't be saved
+                                    are dropped */
 } BlastHSPStream;
 
 /*****************************************************************************/
@@ -129,6 +140,49 @@ BlastHSPStream* BlastHSPStreamNew(EBlastProgramType program,
                              Int4 num_queries,
                              BlastHSPWriter* writer);
 
+/** Can one thread of a multi-threaded preliminary search write to a buffer
+ * of its own rather than to the stream? This is the case if the writer of the
+ * stream is the collector, which keeps a bounded number of hits per query
+ * whatever the order of the HSP lists.
+ * @param hsp_stream The stream shared by all threads [in]
+ * @return TRUE if BlastHSPStreamNewThreadBuffer can be used
+ */
+NCBI_XBLAST_EXPORT
+Boolean BlastHSPStreamCanUseThreadBuffers(const BlastHSPStream* hsp_stream);
+
+/** Create a buffer to be used instead of an HSP stream by one thread of a
+ * multi-threaded preliminary search. Writing to the buffer needs no lock,
+ * and the HSP lists are kept as written until BlastHSPStreamMergeThreadBuffers
+ * passes them to the writer of the shared stream. Whenever the buffer grows
+ * past a limit, the HSP lists which, for each of their queries, are beaten
+ * by as many hits as the collector saves are dropped, so that the buffer
+ * never holds much more than the collector would.
+ * @param hsp_stream The stream shared by all threads [in]
+ * @return The new buffer, to be freed with BlastHSPStreamFree, or NULL on
+ * error or if BlastHSPStreamCanUseThreadBuffers is FALSE
+ */
+NCBI_XBLAST_EXPORT
+BlastHSPStream* BlastHSPStreamNewThreadBuffer(const BlastHSPStream* hsp_stream);
+
+/** Move the contents of per-thread buffers into the stream they were created
+ * for. The HSP lists of all buffers are merged in order of increasing subject
+ * OID, HSP lists for the same OID being kept in the order they were written,
+ * and written to the stream in that order. Because the HSP list of each
+ * subject sequence is written by a single thread, even if the subject was
+ * split into pieces, the stream ends up in the same state as if
+ * the search had been single-threaded, whatever the order in which the
+ * threads wrote their results.
+ * @param hsp_stream The stream shared by all threads [in][out]
+ * @param buffers Buffers created with BlastHSPStreamNewThreadBuffer; these
+ *                are left empty [in][out]
+ * @param num_buffers Number of buffers [in]
+ * @return kBlastHSPStream_Success on success, otherwise kBlastHSPStream_Error
+ */
+NCBI_XBLAST_EXPORT
+int BlastHSPStreamMergeThreadBuffers(BlastHSPStream* hsp_stream,
+                                     BlastHSPStream** buffers,
+                                     Int4 num_buffers);
+
 /** Frees the BlastHSPStream structure by invoking the destructor function set
  * by the user-defined constructor function when the structure is initialized
  * (indirectly, by BlastHSPStreamNew). If the destructor function pointer is not
@@ -232,6 +232,20 @@ typedef enum {
    eDiscTemplate_12_21_Optimal = 12
 } EDiscTemplateType;
 
+/** Number of lookup table words covered by one cell of a compact
+ * megablast backbone */
+#define MB_COMPACT_CELL_WORDS 32
+
+/** One cell of a compact megablast backbone. A compact backbone replaces
+ * the array with one entry per lookup table word by a bit per word, set if
+ * the word occurs in the query, and an array with one entry per word that
+ * occurs. The bits and the number of words present before the cell are kept
+ * together, so that a lookup touches one cell and one entry. */
+typedef struct BlastMBCompactCell {
+    Uint4 bits;     /**< one bit per word, set if the word is present */
+    Int4 rank;      /**< number of words present in all preceding cells */
+} BlastMBCompactCell;
+
 /** The lookup table structure used for Mega BLAST */
 typedef struct BlastMBLookupTable {
     Int4 word_length;      /**< number of exact letter matches that will trigger
@@ -263,8 +277,78 @@ typedef struct BlastMBLookupTable {
     Int4 num_words_added; /**< Number of words added to the l.t. */
     BlastSeqLoc* masked_locations; /**< masked locations, only non-NULL for soft-masking. */
 
+    BlastMBCompactCell* compact_backbone; /**< If not NULL, replaces 
+                                            hashtable; see 
+                                            BlastMBCompactCell */
+    Int4* compact_heads;  /**< First position for each word present, in
+                             order of increasing word */
+    BlastMBCompactCell* compact_backbone2; /**< Replaces hashtable2 */
+    Int4* compact_heads2; /**< First positions for the second template */
 } BlastMBLookupTable;
 
+/** Count the bits set in a word
+ * @param x The word [in]
+ */
+static NCBI_INLINE Int4 BlastMBPopCount(Uint4 x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcount(x);
+#else
+    x = x - ((x >> 1) & 0x55555555);
+    x = (x & 0x33333333) + ((x >> 2) & 0x33333333);
+    x = (x + (x >> 4)) & 0x0f0f0f0f;
+    return (Int4)((x * 0x01010101) >> 24);
+#endif
+}
+
+/** Look up a word in a compact megablast backbone
+ * @param backbone The cells of the backbone [in]
+ * @param heads First position for each word present [in]
+ * @param index The lookup table word [in]
+ * @return The first position of the word in the table, or 0 if absent
+ */
+static NCBI_INLINE Int4
+BlastMBCompactLookup(const BlastMBCompactCell* backbone, const Int4* heads,
+                     Int4 index)
+{
+    const BlastMBCompactCell* cell = backbone + index / MB_COMPACT_CELL_WORDS;
+    Uint4 bit = (Uint4)1 << (index % MB_COMPACT_CELL_WORDS);
+
+    if (!(cell->bits & bit))
+        return 0;
+    return heads[cell->rank + BlastMBPopCount(cell->bits & (bit - 1))];
+}
+
+/** Get the first position of a word in a megablast lookup table. Further
+ * positions are found by following next_pos.
+ * @param mb_lt The lookup table [in]
+ * @param index The lookup table word [in]
+ * @return The position plus one, or 0 if the word is not in the table
+ */
+static NCBI_INLINE Int4
+BlastMBLookupTableFirstPos(const BlastMBLookupTable* mb_lt, Int4 index)
+{
+    if (mb_lt->compact_backbone)
+        return BlastMBCompactLookup(mb_lt->compact_backbone,
+                                    mb_lt->compact_heads, index);
+    return mb_lt->hashtable[index];
+}
+
+/** Like BlastMBLookupTableFirstPos, for the second discontiguous template;
+ * further positions are found by following next_pos2.
+ * @param mb_lt The lookup table [in]
+ * @param index The lookup table word [in]
+ * @return The position plus one, or 0 if the word is not in the table
+ */
+static NCBI_INLINE Int4
+BlastMBLookupTableFirstPos2(const BlastMBLookupTable* mb_lt, Int4 index)
+{
+    if (mb_lt->compact_backbone2)
+        return BlastMBCompactLookup(mb_lt->compact_backbone2,
+                                    mb_lt->compact_heads2, index);
+    return mb_lt->hashtable2[index];
+}
+
 /**
  * Create the lookup table for Mega BLAST 
  * @param query The query sequence block (if concatenated sequence, the 
@@ -290,6 +374,31 @@ Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
  */
 BlastMBLookupTable* BlastMBLookupTableDestruct(BlastMBLookupTable* mb_lt);
 
+/**
+ * Estimate the memory accessed when scanning subject sequences with a
+ * Mega BLAST lookup table: the presence vector, the backbone and the
+ * chains of query positions
+ * @param approx_table_entries Number of words in the table [in]
+ * @param lut_width The number of nucleotides in one lookup table word [in]
+ * @param compact TRUE if the table has a compact backbone [in]
+ * @return Size in bytes
+ */
+Int8 BlastMBLookupTableFootprint(Int4 approx_table_entries, Int4 lut_width,
+                                 Boolean compact);
+
+/**
+ * Find how many words a contiguous Mega BLAST lookup table may hold while
+ * its footprint, as computed by BlastMBLookupTableFootprint, stays within
+ * a given size; the width of the table is chosen by
+ * BlastChooseNaLookupTable. Meant to size query batches so that the lookup
+ * table stays in cache when scanning the database.
+ * @param lookup_options Options for lookup table creation [in]
+ * @param max_footprint Size in bytes that the table should fit in [in]
+ * @return The number of words, or 0 if no table fits
+ */
+Int4 BlastMBLookupTableMaxEntries(const LookupTableOptions* lookup_options,
+                                  Int8 max_footprint);
+
 /*----------------------- Discontiguous Megablast -------------------------*/
 
 /** Forms a lookup table index for the 11-of-16 coding template in
@@ -189,6 +189,9 @@ typedef struct LookupTableOptions {
    Int4 mb_template_type; /**< Type of a discontiguous word template */
    char* phi_pattern;  /**< PHI-BLAST pattern */
    EBlastProgramType program_number; /**< indicates blastn, blastp, etc. */
+   Boolean mb_compact_backbone; /**< Store the megablast lookup table with a
+                                     compact backbone, which takes far less
+                                     memory when few words are indexed */
 } LookupTableOptions;
 
 /** Options for dust algorithm, applies only to nucl.-nucl. comparisons.
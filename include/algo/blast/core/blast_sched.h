@@ -0,0 +1,180 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_sched.h
+ * Work-stealing distribution of subject sequences among the threads of the
+ * preliminary stage of a multi-threaded BLAST search.
+ *
+ * Each thread has a share of subject sequences, protected by its own lock,
+ * and takes sequences one at a time from the front of it. A thread whose
+ * share is exhausted refills it from a chunk iterator shared by all threads,
+ * so the subject sequences are enumerated by all threads as they go rather
+ * than up front. Once the chunk iterator is exhausted, a thread without work
+ * takes the back half of the largest remaining share. Compared to handing
+ * out fixed size chunks from a single queue, this keeps all threads busy
+ * until the very end of the search when the lengths of the subject
+ * sequences are very uneven, and threads only compete for a lock when one
+ * of them runs out of work.
+ *
+ * A subject sequence longer than the piece length is split into pieces,
+ * which are handed out before any other work so that all threads can search
+ * it at the same time. The HSP lists found in the pieces are merged once
+ * the last piece is done, by the thread which searched it.
+ */
+
+#ifndef ALGO_BLAST_CORE__BLAST_SCHED__H
+#define ALGO_BLAST_CORE__BLAST_SCHED__H
+
+#include <algo/blast/core/ncbi_std.h>
+#include <algo/blast/core/blast_export.h>
+#include <algo/blast/core/blast_seqsrc.h>
+#include <algo/blast/core/blast_diagnostics.h>
+#include <algo/blast/core/blast_hits.h>
+#include <algo/blast/core/blast_gapalign.h>
+#include <connect/ncbi_core.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Default length of the pieces of a split subject sequence: every piece
+ * spans at least two chunks of the subject (see MAX_DBSEQ_LEN) */
+#define BLAST_SUBJECT_PIECE_LEN (2 * MAX_DBSEQ_LEN)
+
+/** Part of a subject sequence to search. The chunks of the subject sequence
+ * are assigned to pieces by their starting offset, so that the chunks of all
+ * pieces are exactly those searched if the subject is not split. */
+typedef struct BlastSubjectPiece {
+    Int4 index;         /**< Index of the piece, 0 if the subject is not 
+                             split */
+    Int4 num_pieces;    /**< Number of pieces, 1 if the subject is not 
+                             split */
+    Int4 begin;         /**< Smallest starting offset of a chunk in the 
+                             piece */
+    Int4 end;           /**< One past the largest starting offset of a chunk
+                             in the piece */
+} BlastSubjectPiece;
+
+/** Create a scheduler for all subject sequences that the chunk iterator of
+ * a BlastSeqSrc would return. The chunk iterator of seq_src is reset, and is
+ * advanced by the threads taking work from the scheduler.
+ * @param seq_src Source of subject sequences [in]
+ * @param num_threads Number of threads that will take work [in]
+ * @param locks Array of num_threads + 1 mutexes: one protecting the share of
+ *              each thread, and one protecting the chunk iterator and the
+ *              split subject sequences;
+ *              may be NULL if the scheduler is used by a single thread. The
+ *              scheduler takes ownership of the locks, but not of the array,
+ *              even if it fails. [in]
+ * @param piece_length Subject sequences longer than this are split into 
+ *              pieces of this length; 0 if subject sequences must not be 
+ *              split [in]
+ * @return The new scheduler, or NULL on error
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectScheduler*
+BlastSubjectSchedulerNew(BlastSeqSrc* seq_src, Int4 num_threads,
+                         MT_LOCK* locks, Int4 piece_length);
+
+/** Free a scheduler, including the HSP lists of split subject sequences
+ * that were not merged
+ * @param sched The scheduler to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectScheduler*
+BlastSubjectSchedulerFree(BlastSubjectScheduler* sched);
+
+/** Get the next subject sequence for a thread. Must only be called from
+ * the thread with the given index.
+ * @param sched The scheduler [in]
+ * @param seq_src The copy of the BlastSeqSrc the scheduler was created 
+ *                for used by the calling thread [in]
+ * @param thread_index Index of the calling thread, between 0 and
+ *                     num_threads - 1 [in]
+ * @return Ordinal id of the next subject sequence, BLAST_SEQSRC_EOF when
+ *         all subject sequences have been handed out, or BLAST_SEQSRC_ERROR
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSubjectSchedulerNext(BlastSubjectScheduler* sched,
+                               const BlastSeqSrc* seq_src,
+                               Int4 thread_index);
+
+/** Get the part of the subject sequence last given to a thread that the
+ * thread should search.
+ * @param sched The scheduler [in]
+ * @param thread_index Index of the thread [in]
+ * @param piece The part to search [out]
+ */
+NCBI_XBLAST_EXPORT
+void BlastSubjectSchedulerGetPiece(const BlastSubjectScheduler* sched,
+                                   Int4 thread_index,
+                                   BlastSubjectPiece* piece);
+
+/** Hand in the HSP list found in the piece of a split subject sequence last
+ * given to a thread. Once the HSP lists of all pieces are in, they are 
+ * merged in the order of the pieces as if they were consecutive chunks of 
+ * the subject sequence (see Blast_HSPListsMerge), and the merged HSP list is
+ * returned to the thread which handed in the last piece.
+ * @param sched The scheduler [in]
+ * @param thread_index Index of the calling thread [in]
+ * @param hsp_list HSP list found in the piece, with offsets relative to the
+ *                 whole subject sequence; may be NULL. The scheduler takes
+ *                 ownership. On return, the merged HSP list if all pieces
+ *                 are done, NULL otherwise. [in][out]
+ * @param merge_offset Starting offset of the first chunk of the piece which
+ *                 had any HSPs [in]
+ * @param merge_overlap Overlap of that chunk with the previous one [in]
+ * @param hsp_num_max Maximal number of HSPs to keep [in]
+ * @param allow_gap Allow merged HSPs to have a gap? [in]
+ * @return 1 if the merged HSP list was returned, 0 if other pieces are not 
+ *         done yet, -1 on error
+ */
+NCBI_XBLAST_EXPORT
+Int2 BlastSubjectSchedulerMergePiece(BlastSubjectScheduler* sched,
+                                     Int4 thread_index,
+                                     BlastHSPList** hsp_list,
+                                     Int4 merge_offset, Int4 merge_overlap,
+                                     Int4 hsp_num_max, Boolean allow_gap);
+
+/** Get the number of subject sequences and pieces a thread was given and
+ * the number of times it took work from another thread. Should only be
+ * called after all threads have finished; times are set to zero.
+ * @param sched The scheduler [in]
+ * @param thread_index Index of the thread [in]
+ * @param stats Statistics for the thread [out]
+ */
+NCBI_XBLAST_EXPORT
+void BlastSubjectSchedulerGetThreadStats(const BlastSubjectScheduler* sched,
+                                         Int4 thread_index,
+                                         BlastThreadStats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* !ALGO_BLAST_CORE__BLAST_SCHED__H */
@@ -84,6 +84,10 @@ typedef struct BlastSeqSrc BlastSeqSrc;
  */
 typedef struct BlastSeqSrcIterator BlastSeqSrcIterator;
 
+/** Distributes subject sequences among the threads of a search; defined 
+ * in blast_sched.h */
+typedef struct BlastSubjectScheduler BlastSubjectScheduler;
+
 /** Structure that contains the information needed for BlastSeqSrcNew to fully
  * populate the BlastSeqSrc structure it returns */
 typedef struct BlastSeqSrcNewInfo BlastSeqSrcNewInfo;
@@ -433,6 +437,40 @@ void BlastSeqSrcResetChunkIterator(BlastSeqSrc* seq_src);
 NCBI_XBLAST_EXPORT
 void BlastSeqSrcSetNumberOfThreads(BlastSeqSrc* seq_src, int nthreads);
 
+/** Make BlastSeqSrcIteratorNext take subject sequences from a scheduler
+ * shared by several threads instead of from the chunk iterator of this 
+ * object. Meant for the per-thread copies of a BlastSeqSrc in a 
+ * multi-threaded search (see blast_sched.h).
+ * @param seq_src the BLAST sequence source [in]
+ * @param scheduler the scheduler, or NULL to go back to the chunk 
+ *                  iterator; not owned by seq_src [in]
+ * @param thread_index index of the thread using seq_src [in]
+ */
+NCBI_XBLAST_EXPORT
+void BlastSeqSrcSetScheduler(BlastSeqSrc* seq_src, 
+                             BlastSubjectScheduler* scheduler,
+                             Int4 thread_index);
+
+/** Get the scheduler set with BlastSeqSrcSetScheduler
+ * @param seq_src the BLAST sequence source [in]
+ * @param thread_index index of the thread using seq_src [out]
+ * @return the scheduler, or NULL if the chunk iterator is used
+ */
+NCBI_XBLAST_EXPORT
+BlastSubjectScheduler* BlastSeqSrcGetScheduler(const BlastSeqSrc* seq_src,
+                                               Int4* thread_index);
+
+/** Get the next ordinal id from the chunk iterator of a BlastSeqSrc, even
+ * if a scheduler was set with BlastSeqSrcSetScheduler. Meant for the
+ * scheduler itself.
+ * @param seq_src the BLAST sequence source [in]
+ * @param itr the iterator to advance [in]
+ * @return one of the BLAST_SEQSRC_* defined in blast_seqsrc.h
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSeqSrcChunkIteratorNext(const BlastSeqSrc* seq_src, 
+                                  BlastSeqSrcIterator* itr);
+
 /*****************************************************************************/
 
 #ifdef __cplusplus
@@ -0,0 +1,189 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_simd.h
+ *  Runtime selection of vectorized (SSE4.1/AVX2) kernels used by the
+ *  BLAST engine. The scalar code paths are always available and serve
+ *  as the reference implementation; every vector kernel must produce
+ *  bit-identical results.
+ */
+
+#ifndef ALGO_BLAST_CORE___BLAST_SIMD__H
+#define ALGO_BLAST_CORE___BLAST_SIMD__H
+
+#include <algo/blast/core/ncbi_std.h>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Instruction set levels for which BLAST provides vector kernels */
+typedef enum EBlastSimdLevel {
+    eBlastSimdNone = 0,     /**< portable scalar code only */
+    eBlastSimdSSE41,        /**< 128-bit SSE4.1 kernels */
+    eBlastSimdAVX2          /**< 256-bit AVX2 kernels */
+} EBlastSimdLevel;
+
+/** Number of substitution scores processed by one call to
+ *  BlastSimdXDropScan; callers gather scores in blocks of this size */
+#define BLAST_SIMD_XDROP_BLOCK 16
+
+/** Return the instruction set level used by the BLAST kernels. This is
+ *  the best level supported by both the compiler and the CPU, capped by
+ *  the BLAST_SIMD environment variable ("none", "sse4.1" or "avx2") and
+ *  by BlastSimdSetMaxLevel.
+ * @return the level in effect
+ */
+NCBI_XBLAST_EXPORT
+EBlastSimdLevel BlastSimdGetLevel(void);
+
+/** Cap the instruction set level used by the BLAST kernels. Meant for
+ *  regression testing of the vector kernels against the scalar ones;
+ *  the setting is process-wide and must not be changed while a search
+ *  is running.
+ * @param level Highest level to use [in]
+ * @return the previous cap
+ */
+NCBI_XBLAST_EXPORT
+EBlastSimdLevel BlastSimdSetMaxLevel(EBlastSimdLevel level);
+
+/** Continue an ungapped X-dropoff extension over a block of substitution
+ *  scores. The scores are accumulated in order; after each one the best
+ *  score so far is updated and the extension stops when the running
+ *  score has dropped by at least 'dropoff' from the best score or, if
+ *  requested, has become nonpositive. This is the inner loop of the
+ *  protein ungapped extension routines, expressed so that it can be run
+ *  with vector instructions.
+ * @param scores Substitution scores of the next positions [in]
+ * @param num Number of scores, at most BLAST_SIMD_XDROP_BLOCK [in]
+ * @param dropoff The X-dropoff value [in]
+ * @param stop_at_nonpositive Stop also when the running score
+ *                            becomes nonpositive [in]
+ * @param score The running score [in][out]
+ * @param maxscore The best running score [in][out]
+ * @param best Offset into 'scores' where maxscore was last improved;
+ *             left unchanged if maxscore did not improve [in][out]
+ * @return Offset into 'scores' of the position where the extension
+ *         stopped, or 'num' if it did not stop
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSimdXDropScan(const Int4* scores, Int4 num, Int4 dropoff,
+                        Boolean stop_at_nonpositive, Int4* score,
+                        Int4* maxscore, Int4* best);
+
+/** How a Smith-Waterman query profile takes its scores from a matrix */
+typedef enum EBlastSWProfileType {
+    eBlastSWProfileQueryRows,   /**< score of query letter q against
+                                     subject letter c is matrix[q][c] */
+    eBlastSWProfileSubjectRows, /**< score of query letter q against
+                                     subject letter c is matrix[c][q] */
+    eBlastSWProfilePositional   /**< score of query position i against
+                                     subject letter c is matrix[i][c] */
+} EBlastSWProfileType;
+
+/** Query profile for the striped Smith-Waterman score-only engine. The
+ *  profile holds the substitution scores of every query position against
+ *  every subject letter, laid out for 8, 16 and 32-bit vector lanes
+ *  (Farrar, "Striped Smith-Waterman speeds database searches six times
+ *  over other SIMD implementations", Bioinformatics 23:156-161, 2007).
+ *  The 16 and 32-bit layouts are only built if a subject needs them.
+ */
+typedef struct BlastSWProfile BlastSWProfile;
+
+/** Build a query profile
+ * @param query The query sequence; ignored for position-specific
+ *              profiles [in]
+ * @param query_length Length of the query [in]
+ * @param matrix Score matrix or PSSM [in]
+ * @param type How to index the matrix [in]
+ * @param alphabet_size Number of distinct subject letters [in]
+ * @return The new profile, or NULL if out of memory
+ */
+NCBI_XBLAST_EXPORT
+BlastSWProfile* BlastSWProfileNew(const Uint1* query, Int4 query_length,
+                                  Int4** matrix, EBlastSWProfileType type,
+                                  Int4 alphabet_size);
+
+/** Free a query profile
+ * @param profile The profile to free [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+BlastSWProfile* BlastSWProfileFree(BlastSWProfile* profile);
+
+/** Check whether a profile was built from the given inputs
+ * @param profile The profile [in]
+ * @param query The query sequence [in]
+ * @param query_length Length of the query [in]
+ * @param matrix Score matrix or PSSM [in]
+ * @return TRUE if the profile can be reused for these inputs
+ */
+NCBI_XBLAST_EXPORT
+Boolean BlastSWProfileMatches(const BlastSWProfile* profile,
+                              const Uint1* query, Int4 query_length,
+                              Int4** matrix);
+
+/** Compute the score of the best local alignment of a subject sequence
+ *  to the profiled query, with affine gap costs. The computation starts
+ *  with 8-bit saturating lanes and is repeated with 16-bit and then
+ *  32-bit lanes if the score does not fit. The result is the same as
+ *  that of the scalar Smith-Waterman routines in blast_sw.c.
+ * @param profile The query profile [in]
+ * @param subject The subject sequence [in]
+ * @param subject_length Length of the subject [in]
+ * @param subject_is_packed TRUE if the subject is in ncbi2na
+ *                          format, 4 bases per byte [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @return The score of the best local alignment
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSWProfileScore(BlastSWProfile* profile, const Uint1* subject,
+                         Int4 subject_length, Boolean subject_is_packed,
+                         Int4 gap_open, Int4 gap_extend);
+
+/** Report which code computed the last score of a profile; intended for
+ *  testing
+ * @param profile The query profile [in]
+ * @return 8, 16 or 32 for the vector lane width in bits that produced
+ *         the score, or 0 for the scalar code
+ */
+NCBI_XBLAST_EXPORT
+Int4 BlastSWProfileGetLaneBits(const BlastSWProfile* profile);
+
+#ifdef __cplusplus
+}
+#endif
+
+/* @} */
+
+#endif /* !ALGO_BLAST_CORE___BLAST_SIMD__H */
@@ -84,6 +84,15 @@ NCBI_XBLAST_EXPORT
 BlastHSPWriterInfo* 
 BlastHSPCollectorInfoNew(BlastHSPCollectorParams* params);
 
+/** Get the parameters of a writer, if it is a collector saving the hits of
+ * a search with one HSP list per subject sequence (i.e. not RPS BLAST).
+ * @param writer The writer [in]
+ * @return The collector parameters, or NULL for any other writer
+ */
+NCBI_XBLAST_EXPORT
+const BlastHSPCollectorParams*
+BlastHSPCollectorGetParams(const BlastHSPWriter* writer);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,135 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file lookup_image.h
+ * Flat, position-independent images of finished lookup tables.
+ *
+ * An image holds a lookup table together with all of its arrays in one
+ * contiguous block of memory, so that it can be written to a file and later
+ * used in place, for instance from a read-only memory mapping shared by
+ * several processes. A lookup table created from an image only owns its
+ * top-level structure; its arrays point into the image, which must outlive
+ * it. Images are only meaningful on the platform that wrote them.
+ *
+ * The protein lookup table and the nucleotide lookup tables (standard, small
+ * and megablast) can be saved as images.
+ */
+
+#ifndef ALGO_BLAST_CORE__LOOKUP_IMAGE__H
+#define ALGO_BLAST_CORE__LOOKUP_IMAGE__H
+
+#include <algo/blast/core/ncbi_std.h>
+#include <algo/blast/core/blast_export.h>
+#include <algo/blast/core/lookup_wrap.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Key that identifies a lookup table. Tables are looked up by the hash,
+ * but an image is only accepted if the whole key data matches.
+ */
+typedef struct LookupTableKey {
+    Uint8 hash;     /**< Hash of the key data; never 0 */
+    Uint1* data;    /**< Everything the lookup table depends on */
+    Int8 size;      /**< Size of the key data in bytes */
+} LookupTableKey;
+
+/** Compute the key of the lookup table LookupTableWrapInit would build
+ * from the given arguments. The key covers the query sequence, the
+ * lookup segments, the lookup table options, soft masking and, for protein
+ * lookup tables, the score matrix or PSSM.
+ * @param query The query sequence [in]
+ * @param lookup_options Options for lookup table creation [in]
+ * @param query_options Options for query setup [in]
+ * @param lookup_segments Locations on query to be used for lookup table
+ *                        construction [in]
+ * @param sbp Scoring block containing matrix [in]
+ * @return The key, to be freed with LookupTableKeyFree, or NULL if this
+ *         kind of lookup table cannot be saved as an image or if out of
+ *         memory
+ */
+NCBI_XBLAST_EXPORT
+LookupTableKey* LookupTableKeyNew(const BLAST_SequenceBlk* query,
+                                  const LookupTableOptions* lookup_options,
+                                  const QuerySetUpOptions* query_options,
+                                  const BlastSeqLoc* lookup_segments,
+                                  const BlastScoreBlk* sbp);
+
+/** Free a lookup table key
+ * @param key The key [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+LookupTableKey* LookupTableKeyFree(LookupTableKey* key);
+
+/** Save a lookup table as an image
+ * @param lookup_wrap The lookup table [in]
+ * @param query The query sequence the table was built from [in]
+ * @param key Key of the lookup table, as computed by LookupTableKeyNew
+ *            before the table was built; stored in the image [in]
+ * @param image The image, to be freed with free() [out]
+ * @param image_size Size of the image in bytes [out]
+ * @return 0 on success, -1 if the lookup table cannot be saved as an
+ *         image, -2 if out of memory
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableImageNew(const LookupTableWrap* lookup_wrap,
+                         const BLAST_SequenceBlk* query,
+                         const LookupTableKey* key,
+                         void** image, Int8* image_size);
+
+/** Create a lookup table from an image. The query undergoes the same
+ * preparation as if the lookup table had been built by LookupTableWrapInit.
+ * @param image The image; must remain valid and unchanged until the lookup
+ *              table is freed [in]
+ * @param image_size Size of the image in bytes [in]
+ * @param key The expected key; both its hash and its data must match
+ *            the key stored in the image [in]
+ * @param query The query sequence [in][out]
+ * @param lookup_wrap_ptr The lookup table [out]
+ * @return 0 on success, -1 if the image is invalid or does not match the
+ *         key or the query, -2 if out of memory
+ */
+NCBI_XBLAST_EXPORT
+Int2 LookupTableWrapFromImage(const void* image, Int8 image_size,
+                              const LookupTableKey* key,
+                              BLAST_SequenceBlk* query,
+                              LookupTableWrap** lookup_wrap_ptr);
+
+/** Free the parts of a lookup table created by LookupTableWrapFromImage
+ * that do not belong to the image. Called by LookupTableWrapFree.
+ * @param lookup_wrap The lookup table [in]
+ * @return NULL
+ */
+NCBI_XBLAST_EXPORT
+void* LookupTableImageTableFree(LookupTableWrap* lookup_wrap);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* !ALGO_BLAST_CORE__LOOKUP_IMAGE__H */
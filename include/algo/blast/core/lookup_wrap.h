@@ -58,11 +58,22 @@ typedef struct LookupTableWrap {
                                       search */
    void* lookup_callback;    /**< function used to look up an
                                   index->q_off pair */
+   const void* image;        /**< If not NULL, the arrays of the lookup
+                                  table are stored in this read-only image,
+                                  which is not owned by the lookup table;
+                                  see lookup_image.h */
+   void* image_release;      /**< If not NULL, function called with image
+                                  and image_release_data once the lookup
+                                  table no longer uses the image */
+   void* image_release_data; /**< Passed to image_release */
 } LookupTableWrap;
 
 /** Function pointer type to check the presence of index->q_off pair */
 typedef Boolean (*T_Lookup_Callback)(const LookupTableWrap *, Int4, Int4);
 
+/** Function pointer type to release the image of a lookup table */
+typedef void (*T_Lookup_ImageRelease)(const void* image, void* data);
+
 /** Create the lookup table for all query words.
  * @param query The query sequence [in]
  * @param lookup_options What kind of lookup table to build? [in]
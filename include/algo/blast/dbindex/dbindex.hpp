@@ -476,6 +476,8 @@ class NCBI_XBLAST_EXPORT CDbIndex : public CObject
             unsigned long chunk_overlap;        /**< Amount by which individual chunks overlap. */
             unsigned long report_level;         /**< Verbose index creation. */
             unsigned long max_index_size;       /**< Maximum index size in megabytes. */
+            unsigned long num_threads;          /**< Number of threads used to build
+                                                     and save the offset lists. */
 
             std::string stat_file_name;         /**< File to write index statistics into. */
         };
@@ -34,6 +34,7 @@
 */
 
 #include <corelib/ncbiobj.hpp>
+#include <corelib/ncbi_param.hpp>
 
 #include <util/range.hpp>
 
@@ -64,6 +65,11 @@ class CGene_ref;
 class CSeq_feat_Handle;
 class CSeq_annot_SortedIter;
 
+// Number of threads calculating the locations of big Seq-annots while they
+// are indexed: 0 means the CPU count (at most 8), 1 disables the threads.
+NCBI_PARAM_DECL_EXPORT(NCBI_XOBJMGR_EXPORT, unsigned,
+                       OBJMGR, ANNOT_INDEX_THREADS);
+
 class NCBI_XOBJMGR_EXPORT CSeq_annot_Info : public CTSE_Info_Object
 {
     typedef CTSE_Info_Object TParent;
@@ -45,6 +45,7 @@
 #include <objects/seq/seq_id_handle.hpp>
 
 #include <util/rangemap.hpp>
+#include <util/rangemap_index.hpp>
 #include <corelib/ncbiobj.hpp>
 #include <corelib/ncbimtx.hpp>
 #include <objmgr/impl/annot_object_index.hpp>
@@ -102,6 +103,17 @@ struct NCBI_XOBJMGR_EXPORT SIdAnnotObjs
     typedef vector<TRangeMap*>                               TAnnotSet;
     typedef vector<CConstRef<CSeq_annot_SNP_Info> >          TSNPSet;
 
+    // compact copy of a range map, see CTSE_Info::SetCompactAnnotIndex()
+    class CRangeIndex : public CObject, public CRangeMapIndex<TRangeMap>
+    {
+    public:
+        explicit CRangeIndex(const TRangeMap& rmap)
+            : CRangeMapIndex<TRangeMap>(rmap)
+            {
+            }
+    };
+    typedef vector<CConstRef<CRangeIndex> >                  TIndexSet;
+
     size_t x_GetRangeMapCount(void) const
         {
             return m_AnnotSet.size();
@@ -121,8 +133,17 @@ struct NCBI_XOBJMGR_EXPORT SIdAnnotObjs
     TRangeMap& x_GetRangeMap(size_t index);
     bool x_CleanRangeMaps(void);
 
+    // Compact index of a non-empty range map, made on the first call;
+    // null if the range map is too small for it. The index is dropped
+    // when the range map is modified under the TSE annot write lock.
+    // Concurrent searches may make the index, so it's accessed only via
+    // CTSE_Info::x_GetRangeIndex(), which holds the TSE range index mutex.
+    CConstRef<CRangeIndex> x_GetRangeIndex(size_t index) const;
+    void x_DropRangeIndexes(void);
+
     TAnnotSet m_AnnotSet;
     TSNPSet   m_SNPSet;
+    mutable TIndexSet m_IndexSet;
 
 private:
     const SIdAnnotObjs& operator=(const SIdAnnotObjs& objs);
@@ -254,6 +275,12 @@ public:
     size_t GetUsedMemory(void) const;
     void SetUsedMemory(size_t size);
 
+    // Search annotations using compact copies of the range maps;
+    // worth it for TSEs which are searched much more than modified.
+    // The default is set by [OBJMGR] COMPACT_ANNOT_INDEX.
+    bool GetCompactAnnotIndex(void) const;
+    void SetCompactAnnotIndex(bool compact);
+
     // Annot index access
     bool HasAnnot(const CAnnotName& name) const;
     bool HasUnnamedAnnot(void) const;
@@ -489,6 +516,11 @@ private:
                                        const CSeq_id_Handle& id) const;
     const SIdAnnotObjs* x_GetUnnamedIdObjects(const CSeq_id_Handle& id) const;
 
+    // compact index of the range map, made under m_RangeIndexMutex
+    // tse annot index should be locked by TAnnotLockReadGuard
+    CConstRef<SIdAnnotObjs::CRangeIndex>
+    x_GetRangeIndex(const SIdAnnotObjs& objs, size_t index) const;
+
     // tse annot index should be locked by TAnnotLockReadGuard
     bool x_HasIdObjects(const CSeq_id_Handle& id) const;
 
@@ -688,6 +720,7 @@ private:
     TLocusIndex            m_LocusIndex;
 
     mutable TAnnotLock     m_AnnotLock;
+    mutable CFastMutex     m_RangeIndexMutex;
     mutable CSeq_id_Handle m_RequestedId;
 
     enum EAnnotIdsFlags {
@@ -699,6 +732,9 @@ private:
     // Do not use ID matching for annotations
     TAnnotIdsFlags m_AnnotIdsFlags;
 
+    // Use compact copies of the annotation range maps
+    bool           m_CompactAnnotIndex;
+
     // information about original TSE for its copy
     struct SBaseTSE
     {
@@ -845,6 +881,13 @@ size_t CTSE_Info::GetUsedMemory(void) const
 }
 
 
+inline
+bool CTSE_Info::GetCompactAnnotIndex(void) const
+{
+    return m_CompactAnnotIndex;
+}
+
+
 inline
 const CTSE_Info::TBlobId& CTSE_Info::GetBlobId(void) const
 {
@@ -899,19 +942,27 @@ class CTSEAnnotObjectMapper
 public:
     CTSEAnnotObjectMapper(CTSE_Info& tse, const CAnnotName& name)
         : m_TSE(tse), m_Name(name),
-          m_AnnotObjs(tse.x_SetAnnotObjs(name))
+          m_AnnotObjs(tse.x_SetAnnotObjs(name)),
+          m_LastIdObjs(0)
         {
         }
 
     void Map(const SAnnotObject_Key& key,
              const SAnnotObject_Index& index) const
         {
-            m_TSE.x_MapAnnotObject(m_AnnotObjs, m_Name, key, index);
+            // consecutive objects are usually located on the same Seq-id
+            if ( !m_LastIdObjs || m_LastId != key.m_Handle ) {
+                m_LastIdObjs =
+                    &m_TSE.x_SetIdObjects(m_AnnotObjs, m_Name, key.m_Handle);
+                m_LastId = key.m_Handle;
+            }
+            m_TSE.x_MapAnnotObject(*m_LastIdObjs, key, index);
         }
 
     void Unmap(const SAnnotObject_Key& key,
                const CAnnotObject_Info& info) const
         {
+            m_LastIdObjs = 0;
             m_TSE.x_UnmapAnnotObject(m_AnnotObjs, m_Name, info, key);
             if ( m_AnnotObjs.empty() ) {
                 m_TSE.x_RemoveAnnotObjs(m_Name);
@@ -922,6 +973,8 @@ private:
     CTSE_Info& m_TSE;
     const CAnnotName& m_Name;
     CTSE_Info::TAnnotObjs& m_AnnotObjs;
+    mutable CSeq_id_Handle m_LastId;
+    mutable SIdAnnotObjs*  m_LastIdObjs;
 };
 
 
@@ -236,10 +236,13 @@ private:
     void x_InitializeCache(void);
     void x_ClearCache(void);
     void x_ResizeCache(size_t size);
+    void x_ReserveCache(TSeqPos capacity);
+    void x_GrowCache(void);
     void x_SwapCache(void);
     void x_UpdateCacheUp(TSeqPos pos);
     void x_UpdateCacheDown(TSeqPos pos);
     void x_FillCache(TSeqPos start, TSeqPos count);
+    void x_DecodeSeg(char* dst, TSeqPos start, TSeqPos count);
     void x_UpdateSeg(TSeqPos pos);
     void x_InitSeg(TSeqPos pos);
     void x_IncSeg(void);
@@ -290,6 +293,10 @@ private:
     TSeqPos                  m_BackupPos;
     TCacheData               m_BackupData;
     TCache_I                 m_BackupEnd;
+    // Allocated size of both caches and the amount of data to fill;
+    // the latter grows with sequential access
+    TSeqPos                  m_CacheCapacity;
+    TSeqPos                  m_CacheFill;
     // optional ambiguities randomizer
     CRef<INcbi2naRandomizer> m_Randomizer;
     // scanned range
@@ -1330,6 +1330,40 @@ public:
     ///   true if the file exists.
     bool GetFileSizeL(const string & fname, TIndx & length);
 
+    /// Publish a mapping of an entire file.
+    ///
+    /// Volume files never change once opened, so on platforms with a
+    /// large address space the atlas can map them whole, once, and
+    /// let any number of threads read the mapping without the atlas
+    /// lock.  Published mappings are shared by all publishers of the
+    /// same file, are not counted against the memory bound, and are
+    /// never touched by garbage collection; they are unmapped when
+    /// the last publisher releases them.  Pointers into a published
+    /// mapping may be passed to RetRegion(), which ignores them.  If
+    /// the file cannot be published (memory mapping is disabled, the
+    /// address space is too small, or mapping failed), NULL is
+    /// returned and the caller should fall back to regions.
+    ///
+    /// @param fname
+    ///   The filename of the file to publish.
+    /// @param locked
+    ///   The lock hold object for this thread.
+    /// @return
+    ///   A pointer to the beginning of the file, or NULL.
+    const char * PublishFile(const string & fname, CSeqDBLockHold & locked);
+
+    /// Release a published mapping.
+    ///
+    /// Each successful call to PublishFile() must be matched by a
+    /// call to this method.  The mapping is unmapped when its last
+    /// publisher releases it.
+    ///
+    /// @param data
+    ///   The pointer returned by PublishFile().
+    /// @param locked
+    ///   The lock hold object for this thread.
+    void ReleasePublishedFile(const char * data, CSeqDBLockHold & locked);
+
     /// Gets a partial mapping of the file.
     ///
     /// Part of a file is mapped or read.  The region is held in
@@ -1418,6 +1452,10 @@ public:
             }
         }
 
+        if (m_RecentPublished && m_RecentPublished->InRange(datap)) {
+            return;
+        }
+
         x_RetRegionNonRecent(datap);
 
         Verify(true);
@@ -2049,6 +2087,15 @@ private:
     /// Map to find regions for Returning (x_RetRegionNonRecent).
     TAddressTable m_AddressLookup;
 
+    /// Published whole-file mappings by fid.
+    map<int, CRegionMap*> m_Published;
+
+    /// Map to find published mappings by address.
+    TAddressTable m_PublishedLookup;
+
+    /// Most recently returned published mapping.
+    CRegionMap * m_RecentPublished;
+
     // Recent region lookup
 
     /// Number of recently-used-region slots.
@@ -39,6 +39,7 @@
 /// Implemented for: UNIX, MS-Windows
 
 #include <objtools/blast/seqdb_reader/impl/seqdbvol.hpp>
+#include <util/bitset/ncbi_bitset.hpp>
 
 BEGIN_NCBI_SCOPE
 
@@ -47,25 +48,28 @@ USING_SCOPE(objects);
 
 /// Bit set class.
 class CSeqDB_BitSet : public CObject {
-    // Some of this code might be more efficient if a larger word size
-    // were used.  However, I think the difference would probably be
-    // tiny, and reading of OID mask file data on such platforms would
-    // then require special byte-order-aware algorithms.  Working at
-    // the byte level completely sidesteps all such issues and results
-    // in simpler, clearer code.
+    // The bits are stored in a compressed BitMagic vector, indexed by
+    // OID (not by the offset from the start of the range), so that
+    // bit sets covering different ranges can be combined with the
+    // vector's own block-wise AND and OR operations.  Runs of clear
+    // or set bits (as found in heavily filtered databases) take very
+    // little memory in this representation.
     
-    /// Word size for vector elements.
+    /// Word size for OID mask file data.
     typedef unsigned char TByte;
     
+    /// Storage for bit data.
+    typedef bm::bvector<> TBits;
+    
     /// Some useful constants related to word size.
     enum {
-        /// Number of bits per stored word.
+        /// Number of bits per OID mask file byte.
         eWordBits = 8,
         
-        /// Shift to convert from bit index to vector index.
+        /// Shift to convert from bit index to byte index.
         eWordShift = 3,
         
-        /// Mask to compute bit index within word.
+        /// Mask to compute bit index within byte.
         eWordMask = eWordBits-1
     };
     
@@ -81,10 +85,9 @@ public:
     CSeqDB_BitSet()
         : m_Start  (0),
           m_End    (0),
-          m_Special(eNone)
+          m_Special(eNone),
+          m_Bits   (bm::BM_GAP)
     {
-        _ASSERT(eWordShift); // must be 32 or 64
-        _ASSERT(TByte(0) < TByte(-1)); // must be unsigned
     }
     
     /// Constructor for bit array with start/end range.
@@ -105,14 +108,9 @@ public:
     CSeqDB_BitSet(size_t start, size_t end, ESpecialCase sp = eNone)
         : m_Start  (start),
           m_End    (end),
-          m_Special(sp)
+          m_Special(sp),
+          m_Bits   (bm::BM_GAP)
     {
-        _ASSERT(eWordShift); // must be 32 or 64
-        _ASSERT(TByte(0) < TByte(-1)); // must be unsigned
-        
-        if (sp == eNone) {
-            x_Alloc(end-start);
-        }
     }
 
     /// Constructor.
@@ -212,17 +210,35 @@ public:
     /// converts it to a normal (`eNone') bitset if so.
     void Normalize();
     
-private:
-    /// Set all bits that are true in `src'.
-    /// @param src The bitset to read from.
-    void x_CopyBits(const CSeqDB_BitSet & src);
+    /// Get the first OID of the range represented here.
+    size_t GetStart() const
+    {
+        return m_Start;
+    }
+    
+    /// Get the OID after the end of the range represented here.
+    size_t GetEnd() const
+    {
+        return m_End;
+    }
     
-    /// Set all bits in the given range that are true in `src'.
-    /// @param src The bitset to read from.
-    /// @param begin The start of the index range to read.
-    /// @param end The index past the end of the index range.
-    void x_CopyBits(const CSeqDB_BitSet & src, size_t start, size_t end);
+    /// Store this bitset in a byte string.
+    ///
+    /// The range, the special case, the (compressed) bits and their
+    /// checksum are stored; the format is private to this class and
+    /// depends on the byte order of the platform.
+    ///
+    /// @param data The serialized bitset. [out]
+    void Serialize(string & data) const;
+    
+    /// Read this bitset from a byte string.
+    ///
+    /// @param data A string produced by Serialize(). [in]
+    /// @return false if the data is not a valid serialized bitset or
+    ///   fails its checksum (this object is then unchanged).
+    bool Deserialize(const string & data);
     
+private:
     /// Set this bitset to the value of the provided one.
     ///
     /// This is like a normal "copy assignment" operation, except that
@@ -245,30 +261,24 @@ private:
     /// @param end Move end point up (but not down) to here.
     void x_Normalize(size_t start, size_t end);
     
-    /// Allocate memory for the bit data.
-    /// @param bits Allocate enough storage to hold this many bits.
-    void x_Alloc(size_t bits)
-    {
-        m_Bits.resize((bits + eWordBits - 1) >> eWordShift);
-    }
-    
     /// Prevent copy construction.
     CSeqDB_BitSet(const CSeqDB_BitSet &);
     
     /// Prevent copy assignment.
     CSeqDB_BitSet & operator=(const CSeqDB_BitSet &);
     
-    /// Number of bits stored here.
+    /// First OID of the range represented here.
     size_t m_Start;
     
-    /// Number of bits stored here.
+    /// OID after the end of the range represented here.
     size_t m_End;
     
     /// Special edge cases.
     ESpecialCase m_Special;
     
-    /// Representation of bit data.
-    vector<TByte> m_Bits;
+    /// Representation of bit data, indexed by OID; no bits outside
+    /// of the range are set.
+    TBits m_Bits;
 };
 
 END_NCBI_SCOPE
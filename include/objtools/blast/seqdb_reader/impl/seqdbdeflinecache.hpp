@@ -0,0 +1,143 @@
+#ifndef OBJTOOLS_READERS_SEQDB__SEQDBDEFLINECACHE_HPP
+#define OBJTOOLS_READERS_SEQDB__SEQDBDEFLINECACHE_HPP
+
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+
+/// @file seqdbdeflinecache.hpp
+/// Cache of decoded deflines for CSeqDB.
+/// 
+/// Defines classes:
+///     CSeqDBDeflineCache
+/// 
+/// Implemented for: UNIX, MS-Windows
+
+#include <objtools/blast/seqdb_reader/seqdbcommon.hpp>
+#include <objects/blastdb/Blast_def_line_set.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <list>
+#include <map>
+
+BEGIN_NCBI_SCOPE
+
+/// Import definitions from the ncbi::objects namespace.
+USING_SCOPE(objects);
+
+/// CSeqDBDeflineCache class
+/// 
+/// A size-bounded cache of decoded (and filtered) Blast-def-line-set
+/// objects, keyed by OID.  The cache is split into shards by OID,
+/// each with its own lock and least-recently-used list, so that
+/// lookups from many threads do not contend with each other or with
+/// the atlas lock.  The size of each entry is estimated from the size
+/// of its binary ASN.1 data; the objects returned are shared, so
+/// they are only available as const references.
+
+class CSeqDBDeflineCache : public CObject {
+public:
+    /// Type of the cached objects.
+    typedef CConstRef<CBlast_def_line_set> TDeflines;
+    
+    /// Number of shards (a power of two).
+    enum { eShards = 16 };
+    
+    /// Constructor.
+    /// @param max_bytes The approximate limit on the memory used. [in]
+    CSeqDBDeflineCache(size_t max_bytes);
+    
+    /// Find the deflines of a sequence.
+    /// @param oid The OID of the sequence. [in]
+    /// @return The deflines, or NULL if not in the cache.
+    TDeflines Find(int oid);
+    
+    /// Add the deflines of a sequence.
+    ///
+    /// Least recently used entries of the same shard are removed to
+    /// make room.  Entries larger than a shard are not added.
+    ///
+    /// @param oid The OID of the sequence. [in]
+    /// @param deflines The deflines. [in]
+    /// @param asn1_size The size of the binary ASN.1 data. [in]
+    void Add(int oid, TDeflines deflines, size_t asn1_size);
+    
+private:
+    /// Prevent copy construction.
+    CSeqDBDeflineCache(const CSeqDBDeflineCache &);
+    
+    /// Prevent copy assignment.
+    CSeqDBDeflineCache & operator=(const CSeqDBDeflineCache &);
+    
+    /// A cached object.
+    struct SEntry {
+        /// The OID of the sequence.
+        int oid;
+        
+        /// The deflines.
+        TDeflines deflines;
+        
+        /// Estimated memory used.
+        size_t bytes;
+    };
+    
+    /// Entries, most recently used first.
+    typedef list<SEntry> TLru;
+    
+    /// Entries by OID.
+    typedef map<int, TLru::iterator> TIndex;
+    
+    /// One part of the cache.
+    struct SShard {
+        /// Constructor.
+        SShard()
+            : bytes(0)
+        {
+        }
+        
+        /// Protects all fields below.
+        CFastMutex lock;
+        
+        /// Entries, most recently used first.
+        TLru lru;
+        
+        /// Entries by OID.
+        TIndex index;
+        
+        /// Estimated memory used by all entries.
+        size_t bytes;
+    };
+    
+    /// The shards.
+    SShard m_Shards[eShards];
+    
+    /// Memory limit for each shard.
+    size_t m_MaxShardBytes;
+};
+
+END_NCBI_SCOPE
+
+#endif // OBJTOOLS_READERS_SEQDB__SEQDBDEFLINECACHE_HPP
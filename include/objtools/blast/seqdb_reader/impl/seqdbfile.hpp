@@ -44,6 +44,7 @@
 
 #include <objtools/blast/seqdb_reader/impl/seqdbgeneral.hpp>
 #include <objtools/blast/seqdb_reader/impl/seqdbatlas.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbprefetch.hpp>
 
 #include <corelib/ncbistr.hpp>
 #include <corelib/ncbifile.hpp>
@@ -314,9 +315,7 @@ public:
                   CSeqDBLockHold & locked);
     
     /// Destructor
-    virtual ~CSeqDBExtFile()
-    {
-    }
+    virtual ~CSeqDBExtFile();
     
     /// Release memory held in the atlas layer by this object.
     void UnLease()
@@ -324,7 +323,50 @@ public:
         m_Lease.Clear();
     }
     
+    /// Read part of the file ahead of its use.
+    ///
+    /// This queues the area with the prefetcher, which reads it in
+    /// its own thread.  Published areas are touched in place; other
+    /// areas are announced to the operating system.
+    ///
+    /// @param prefetcher
+    ///     The prefetcher that will read the data.
+    /// @param start
+    ///     The starting offset of the area.
+    /// @param end
+    ///     The offset for the first byte after the area.
+    void Prefetch(CSeqDBPrefetcher & prefetcher,
+                  TIndx              start,
+                  TIndx              end) const
+    {
+        if (m_Published) {
+            prefetcher.Add(m_Published + start, end - start);
+        } else {
+            prefetcher.Add(m_FileName, start, end);
+        }
+    }
+    
+    /// Check whether the whole file is published by the atlas.
+    ///
+    /// Reads of a published file go straight to the shared mapping;
+    /// they do not need the atlas lock and do not acquire holds.
+    bool IsPublished() const
+    {
+        return m_Published != 0;
+    }
+    
 protected:
+    /// Publish the whole file, if the atlas allows it.
+    ///
+    /// @param locked
+    ///     The lock holder object for this thread.
+    void x_Publish(CSeqDBLockHold & locked)
+    {
+        if (! m_Published) {
+            m_Published = m_Atlas.PublishFile(m_FileName, locked);
+        }
+    }
+    
     /// Get a region of the file
     ///
     /// This method is called to load part of the file into the lease
@@ -350,6 +392,10 @@ protected:
                              CSeqDBLockHold & locked,
                              bool             in_lease = false) const
     {
+        if (m_Published) {
+            return m_Published + start;
+        }
+        
         m_Atlas.Lock(locked);
         
         if (! m_Lease.Contains(start, end)) {
@@ -386,6 +432,10 @@ protected:
                      TIndx   start,
                      TIndx   end) const
     {
+        if (m_Published) {
+            memcpy(buf, m_Published + start, end - start);
+            return;
+        }
         m_File.ReadBytes(m_Lease, buf, start, end);
     }
     
@@ -455,6 +505,9 @@ protected:
     
     /// The raw file object.
     CSeqDBRawFile m_File;
+    
+    /// The published mapping of the whole file, or NULL.
+    const char * m_Published;
 };
 
 void inline CSeqDBExtFile::x_SetFileType(char prot_nucl)
@@ -706,28 +759,37 @@ private:
         }
     }
     
-    /// Get header data (assumes locked).
+    /// Get header data (assumes locked unless published).
     Uint4 * x_GetHdr() const
     {
+        if (m_Published) {
+            return (Uint4*) (m_Published + m_OffHdr);
+        }
         if (m_HdrLease.Empty()) {
             m_Atlas.GetRegion(m_HdrLease, m_FileName, m_OffHdr, m_EndHdr);
         }
         return (Uint4*) m_HdrLease.GetPtr(m_OffHdr);
     }
     
-    /// Get sequence data (assumes locked).
+    /// Get sequence data (assumes locked unless published).
     Uint4 * x_GetSeq() const
     {
+        if (m_Published) {
+            return (Uint4*) (m_Published + m_OffSeq);
+        }
         if (m_SeqLease.Empty()) {
             m_Atlas.GetRegion(m_SeqLease, m_FileName, m_OffSeq, m_EndSeq);
         }
         return (Uint4*) m_SeqLease.GetPtr(m_OffSeq);
     }
     
-    /// Get ambiguity data (assumes locked).
+    /// Get ambiguity data (assumes locked unless published).
     Uint4 * x_GetAmb() const
     {
         _ASSERT(x_GetSeqType() == 'n');
+        if (m_Published) {
+            return (Uint4*) (m_Published + m_OffAmb);
+        }
         if (m_AmbLease.Empty()) {
             m_Atlas.GetRegion(m_AmbLease, m_FileName, m_OffAmb, m_EndAmb);
         }
@@ -842,6 +904,7 @@ public:
                   CSeqDBLockHold & locked)
         : CSeqDBExtFile(atlas, dbname + ".-sq", prot_nucl, locked)
     {
+        x_Publish(locked);
     }
     
     /// Destructor
@@ -647,6 +647,28 @@ private:
                       TOid           & oid,
                       CSeqDBLockHold & locked);
 
+    /// One sample of a numeric index, as stored in the sample tree.
+    struct SNumericSample {
+        /// The key of the sample.
+        Int8 key;
+
+        /// The number of the sample in the index file.
+        Int4 sample;
+
+        /// The data (OID) of the sample.
+        Int4 data;
+    };
+
+    /// Build the sample tree of a numeric index.
+    ///
+    /// The samples of the index file are copied into m_SampleTree in
+    /// Eytzinger (breadth-first) order, so that a search touches few
+    /// cache lines and no leases.
+    ///
+    /// @param locked
+    ///   The lock holder object for this thread.
+    void x_BuildSampleTree(CSeqDBLockHold & locked);
+
     /// Index file search
     ///
     /// Given a numeric identifier, this routine finds the OID or the
@@ -1234,6 +1256,10 @@ private:
     /// size of the numeric key-data pair
     int m_TermSize;
 
+    /// Samples of a numeric index in Eytzinger order, with the root
+    /// at position 1; empty until the first numeric search.
+    vector<SNumericSample> m_SampleTree;
+
     Uint8 x_GetNumericKey(const void *p) {
         if (m_LongId)
             return((Uint8) SeqDB_GetStdOrd((Uint8 *)p));
@@ -0,0 +1,174 @@
+#ifndef OBJTOOLS_READERS_SEQDB__SEQDBPREFETCH_HPP
+#define OBJTOOLS_READERS_SEQDB__SEQDBPREFETCH_HPP
+
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file seqdbprefetch.hpp
+/// Background reading of sequence data for CSeqDB.
+///
+/// Defines classes:
+///     CSeqDBPrefetcher
+///
+/// Implemented for: UNIX, MS-Windows
+
+#include <objtools/blast/seqdb_reader/seqdbcommon.hpp>
+#include <corelib/ncbiobj.hpp>
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <deque>
+
+BEGIN_NCBI_SCOPE
+
+/// Prefetcher for sequence data.
+///
+/// Cold volumes on network file systems are slow to read one page
+/// fault at a time.  This object owns a background thread that reads
+/// areas of sequence files before the search threads get to them.
+/// Areas of published (whole-file) mappings are advised with
+/// MADV_WILLNEED and then touched page by page, so that the faults
+/// are taken by the background thread; areas of other files are
+/// advised with posix_fadvise(POSIX_FADV_WILLNEED), which lets the
+/// kernel start reading them into the page cache.
+///
+/// Requests are queued and processed in order; when the queue is
+/// full, new requests are dropped, since prefetching is only a hint.
+/// The thread is started with the first request, and stopped (with
+/// any pending requests discarded) when this object is destroyed.
+/// Mapped areas passed to this object must remain valid until then.
+
+class CSeqDBPrefetcher : public CObject {
+public:
+    /// Type which spans possible file offsets.
+    typedef CNcbiStreamoff TIndx;
+
+    /// Maximum number of pending requests.
+    enum { eMaxPending = 64 };
+
+    /// Constructor.
+    CSeqDBPrefetcher();
+
+    /// Destructor; stops the background thread.
+    ~CSeqDBPrefetcher();
+
+    /// Prefetch part of a memory mapped file.
+    ///
+    /// @param data The beginning of the area. [in]
+    /// @param length The length of the area in bytes. [in]
+    void Add(const char * data, TIndx length);
+
+    /// Prefetch part of a file that is not mapped as a whole.
+    ///
+    /// @param fname The name of the file. [in]
+    /// @param begin The offset of the beginning of the area. [in]
+    /// @param end The offset of the end of the area. [in]
+    void Add(const string & fname, TIndx begin, TIndx end);
+
+    /// Get statistics of the work done so far.
+    /// @return The statistics.
+    SSeqDBPrefetchStats GetStats() const;
+
+private:
+    /// Prevent copy construction.
+    CSeqDBPrefetcher(const CSeqDBPrefetcher &);
+
+    /// Prevent copy assignment.
+    CSeqDBPrefetcher & operator=(const CSeqDBPrefetcher &);
+
+    /// An area to prefetch.
+    struct SRequest {
+        /// Start of a mapped area, or NULL for an area of a file.
+        const char * data;
+
+        /// Name of the file, if data is NULL.
+        string fname;
+
+        /// Offset of the beginning of the area in the file.
+        TIndx begin;
+
+        /// Offset of the end of the area in the file, or the length
+        /// of the mapped area.
+        TIndx end;
+    };
+
+    /// The background thread.
+    class CWorker : public CThread {
+    public:
+        /// Constructor.
+        /// @param owner The prefetcher owning this thread. [in]
+        CWorker(CSeqDBPrefetcher & owner)
+            : m_Owner(owner)
+        {
+        }
+
+    protected:
+        /// Process requests until the owner stops.
+        virtual void * Main(void);
+
+    private:
+        /// The prefetcher owning this thread.
+        CSeqDBPrefetcher & m_Owner;
+    };
+
+    /// Queue a request, starting the thread if needed.
+    /// @param request The request. [in]
+    void x_Add(const SRequest & request);
+
+    /// Wait for the next request.
+    /// @param request The request. [out]
+    /// @return false if the thread should stop.
+    bool x_Next(SRequest & request);
+
+    /// Read one area.
+    /// @param request The area to read. [in]
+    void x_Process(const SRequest & request);
+
+    /// Protects all fields below.
+    mutable CFastMutex m_Lock;
+
+    /// Signalled for each queued request, and when stopping.
+    CSemaphore m_Pending;
+
+    /// Requests not yet processed.
+    deque<SRequest> m_Queue;
+
+    /// True when the thread must stop.
+    bool m_Stop;
+
+    /// The background thread, once started.
+    CRef<CWorker> m_Worker;
+
+    /// Work done so far.
+    SSeqDBPrefetchStats m_Stats;
+
+    /// Allow the background thread to use the request queue.
+    friend class CWorker;
+};
+
+END_NCBI_SCOPE
+
+#endif // OBJTOOLS_READERS_SEQDB__SEQDBPREFETCH_HPP
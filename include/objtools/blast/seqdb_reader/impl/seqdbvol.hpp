@@ -226,6 +226,36 @@ public:
     ///     The lock holder object for this thread. [in]
     void OpenSeqFile(CSeqDBLockHold &locked) const;
 
+    /// Read the sequence data of a range of OIDs ahead of its use.
+    ///
+    /// @param begin_oid
+    ///     The first OID of the range, relative to this volume. [in]
+    /// @param end_oid
+    ///     The OID after the range, relative to this volume. [in]
+    /// @param prefetcher
+    ///     The prefetcher that will read the data. [in]
+    /// @param locked
+    ///     The lock holder object for this thread. [in]
+    void Prefetch(int                begin_oid,
+                  int                end_oid,
+                  CSeqDBPrefetcher & prefetcher,
+                  CSeqDBLockHold   & locked) const;
+
+    /// Check whether sequence data can be read without the lock.
+    ///
+    /// This is true once the sequence file is open and both it and
+    /// the index file are published by the atlas; sequence lengths
+    /// and sequence data are then read directly from the shared
+    /// mappings.
+    ///
+    /// @return
+    ///     true if the index and sequence files are published.
+    bool IsPublished() const
+    {
+        return m_SeqFileOpened && m_Seq.NotEmpty() &&
+            m_Seq->IsPublished() && m_Idx->IsPublished();
+    }
+
     /// Sequence length for protein databases.
     ///
     /// This method returns the length of the sequence in bases, and
@@ -293,6 +323,34 @@ public:
     GetFilteredHeader(int                    oid,
                       CSeqDBLockHold       & locked) const;
 
+    /// Get some fields of the sequence header information.
+    ///
+    /// This is like GetFilteredHeader(), but fields not included in
+    /// `fields' are skipped instead of decoded, and the result is not
+    /// cached.  If deflines are filtered by ID lists or membership
+    /// bits, or if a cached copy exists, all fields are returned.
+    ///
+    /// @param oid
+    ///   The OID of the sequence. [in]
+    /// @param fields
+    ///   The fields to decode. [in]
+    /// @param locked
+    ///   The lock holder object for this thread. [in]
+    /// @return
+    ///   The set of blast-def-lines describing this sequence.
+    CRef<CBlast_def_line_set>
+    GetPartialHeader(int                   oid,
+                     TSeqDBDeflineFields   fields,
+                     CSeqDBLockHold      & locked) const;
+
+    /// Get the size of the binary header data of a sequence.
+    ///
+    /// @param oid
+    ///   The OID of the sequence. [in]
+    /// @return
+    ///   The size of the binary ASN.1 data in bytes.
+    int GetHdrLength(int oid) const;
+
     /// Get the sequence type stored in this database.
     ///
     /// This method returns the type of sequences stored in this
@@ -331,6 +389,9 @@ public:
     ///   The taxonomy database object. [in]
     /// @param seqdata
     ///   Include sequence data in the returned Bioseq. [in]
+    /// @param deflines
+    ///   The filtered deflines of the sequence, if the caller has
+    ///   them cached, or NULL to read them here. [in]
     /// @param locked
     ///   The lock holder object for this thread. [in]
     /// @return
@@ -341,6 +402,7 @@ public:
               const CSeq_id        * pref_seq_id,
               CRef<CSeqDBTaxInfo>    tax_info,
               bool                   seqdata,
+              CConstRef<CBlast_def_line_set> deflines,
               CSeqDBLockHold       & locked);
 
     /// Get the sequence data.
@@ -1037,6 +1099,14 @@ private:
                  bool           * changed,
                  CSeqDBLockHold & locked) const;
 
+    /// Adjust BL_ORD_ID ids to the global OID range.
+    ///
+    /// @param bdls
+    ///   The Blast-def-line-set to adjust. [in|out]
+    /// @param changed
+    ///   Set to true if any ids were changed (optional). [out]
+    void x_AdjustOids(CBlast_def_line_set & bdls, bool * changed) const;
+
     /// Get sequence header binary data.
     ///
     /// This method returns the sequence header information as a
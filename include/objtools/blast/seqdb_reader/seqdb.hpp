@@ -487,12 +487,43 @@ public:
     ///
     /// Do not modify the object returned here (e.g. by removing some
     /// of the deflines), as the object is cached internally and
-    /// future operations on this OID may be affected.
+    /// future operations on this OID may be affected.  If the shared
+    /// defline cache is enabled (see SetDeflineCacheSize()), a copy of
+    /// the cached object is returned instead.
     ///
     /// @param oid The ordinal ID of the sequence.
     /// @return The blast deflines for this sequence.
     CRef<CBlast_def_line_set> GetHdr(int oid) const;
 
+    /// Get some fields of the ASN.1 header for the sequence.
+    ///
+    /// Fields not included in `fields' are skipped while decoding,
+    /// which is faster for callers that only need (for example) the
+    /// titles or the Seq-ids.  All fields may still be present, if
+    /// the deflines are cached or must be decoded in full to apply
+    /// ID list or membership filtering.  Unlike GetHdr(), results
+    /// are not cached.
+    ///
+    /// @param oid The ordinal ID of the sequence.
+    /// @param fields The fields needed, from ESeqDBDeflineField.
+    /// @return The blast deflines for this sequence.
+    CRef<CBlast_def_line_set>
+    GetPartialHdr(int oid, TSeqDBDeflineFields fields) const;
+
+    /// Enable a cache of decoded headers shared by all threads.
+    ///
+    /// GetHdr() and the methods built on it keep the deflines of
+    /// recently used sequences, up to approximately `bytes' bytes.
+    /// The cache is split into independently locked parts, so that
+    /// threads reading cached headers do not wait for each other.
+    /// GetHdr() and GetPartialHdr() return copies of cached deflines,
+    /// and GetBioseq() builds the bioseq from them.  The cache may be
+    /// resized or disabled while other threads use this object; a
+    /// resize starts with an empty cache.
+    ///
+    /// @param bytes The memory limit, or zero to disable the cache.
+    void SetDeflineCacheSize(size_t bytes);
+
     /// Get taxid for an OID.
     ///
     /// This finds the leaf-node TAXIDS associated with a given OID and
@@ -575,6 +606,22 @@ public:
                    vector<int> & taxids,
                    bool          persist = false) const;
 
+    /// Restrict this database to sequences with the given taxids.
+    ///
+    /// The taxid to OID postings files of the database, built by
+    /// makeblastdb -taxid_index, are used to compute the OIDs of the
+    /// sequences; this is much faster than scanning the deflines or
+    /// translating a list of GIs.  The restriction is combined with
+    /// any filtering already in place (alias files, GI lists, or
+    /// earlier calls to this method).  This method must be called
+    /// before the database is shared between threads.
+    ///
+    /// @param taxids
+    ///   The taxids of the sequences to include.
+    /// @throw CSeqDBException
+    ///   If the database has no taxid to OID postings files.
+    void SetTaxIdFilter(const set<TTaxId> & taxids);
+
     /// Get a CBioseq for a sequence.
     ///
     /// This builds and returns the header and sequence data
@@ -1025,6 +1072,20 @@ public:
     /// Translate an Accession to a list of OIDs.
     void AccessionToOids(const string & acc, vector<int> & oids) const;
 
+    /// Translate a list of Accessions to OIDs.
+    ///
+    /// This is equivalent to calling AccessionToOids() for each of
+    /// the strings and keeping the first OID found, but is faster for
+    /// large lists: numeric GIs and string ids are translated together,
+    /// in merge passes over the GI and string indices of each volume.
+    /// Ids not found this way are looked up one by one, in sorted
+    /// order.
+    ///
+    /// @param accs The accessions or other identifier strings. [in]
+    /// @param oids One OID per string, or -1 if not found. [out]
+    void AccessionsToOids(const vector<string> & accs,
+                          vector<int>          & oids) const;
+
     /// Translate a Seq-id to a list of OIDs.
     void SeqidToOids(const CSeq_id & seqid, vector<int> & oids) const;
 
@@ -1460,6 +1521,39 @@ public:
     /// @param num_threads   Number of threads
     void SetNumberOfThreads(int num_threads, bool force_mt = false);
 
+    /// Read sequence data ahead of its use
+    ///
+    /// The sequence data of the OIDs in [begin_oid, end_oid) is read
+    /// by a background thread, so that later calls to GetSequence()
+    /// and similar methods find it in memory instead of waiting for
+    /// the disk or network file system.  This method only queues the
+    /// request and returns immediately; prefetching is a hint, and
+    /// requests may be dropped if too many are pending.
+    ///
+    /// @param begin_oid The first OID of the range. [in]
+    /// @param end_oid The OID after the range. [in]
+    void Prefetch(int begin_oid, int end_oid);
+
+    /// Enable or disable sequential readahead
+    ///
+    /// When enabled, GetNextOIDChunk() prefetches the sequence data
+    /// of the OIDs following each returned chunk, so that the next
+    /// chunks are read while the current one is used.  If an OID
+    /// mask (such as a GI list) applies, only the included OIDs are
+    /// read.  Readahead is disabled by default, since it only helps
+    /// when the data is not already in memory.
+    ///
+    /// @param enable True to enable readahead. [in]
+    void SetSequentialReadahead(bool enable);
+
+    /// Get statistics of the prefetching done so far
+    ///
+    /// This reports the amount of data read ahead by Prefetch() and
+    /// sequential readahead, and the page faults and time they took.
+    ///
+    /// @return The statistics.
+    SSeqDBPrefetchStats GetPrefetchStats() const;
+
     /// Retrieve the current slice size used for mmap
     Int8 GetSliceSize() const;
 
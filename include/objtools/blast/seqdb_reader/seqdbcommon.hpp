@@ -1516,6 +1516,37 @@ struct SSeqDBTaxInfo {
 };
 
 
+/// SSeqDBPrefetchStats
+///
+/// This structure reports the work done by SeqDB to read sequence
+/// data ahead of its use, either on request (CSeqDB::Prefetch) or by
+/// sequential readahead in CSeqDB::GetNextOIDChunk.
+
+struct SSeqDBPrefetchStats {
+    /// Default constructor
+    SSeqDBPrefetchStats()
+        : requests(0), bytes(0), pages(0), page_faults(0), seconds(0.0)
+    {
+    }
+
+    /// Number of prefetch requests processed.
+    Uint8 requests;
+
+    /// Number of bytes of sequence data prefetched.
+    Uint8 bytes;
+
+    /// Number of memory pages touched by the background reader.
+    Uint8 pages;
+
+    /// Number of major page faults taken by the background reader;
+    /// each of these is a read that a search thread did not wait for.
+    Uint8 page_faults;
+
+    /// Time spent by the background reader, in seconds.
+    double seconds;
+};
+
+
 /// Resolve a file path using SeqDB's path algorithms.
 ///
 /// This finds a file using the same algorithm used by SeqDB to find
@@ -1602,6 +1633,18 @@ enum ESeqDBIdType {
     eOID       /// The ordinal id indicates the order of the data in the volume's index file.
 };
 
+/// Fields of Blast-def-line objects, for CSeqDB::GetPartialHdr().
+enum ESeqDBDeflineField {
+    eDeflineTitle  = 0x1, ///< The title.
+    eDeflineSeqIds = 0x2, ///< The list of Seq-ids.
+    eDeflineTaxId  = 0x4, ///< The taxid.
+    eDeflineOther  = 0x8, ///< Memberships, links and other-info.
+    eDeflineAll    = 0xF  ///< All fields.
+};
+
+/// Bitwise OR of ESeqDBDeflineField values.
+typedef int TSeqDBDeflineFields;
+
 /// Seq-id simplification.
 ///
 /// Given a Seq-id, this routine devolves it to a GI or PIG if
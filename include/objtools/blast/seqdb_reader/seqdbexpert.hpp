@@ -35,6 +35,7 @@
 ///
 /// Defines classes:
 ///     CSeqDBExpert
+///     CSeqDBSeqView
 ///
 /// Implemented for: UNIX, MS-Windows
 
@@ -46,6 +47,8 @@ BEGIN_NCBI_SCOPE
 /// Include definitions from the objects namespace.
 USING_SCOPE(objects);
 
+class CSeqDBSeqView;
+
 
 /// CSeqDBExpert
 ///
@@ -137,6 +140,19 @@ public:
                            int         * seq_length,
                            int         * ambig_length) const;
 
+    /// Borrow the packed data of a sequence.
+    ///
+    /// The view is pointed at the packed data of the sequence in the
+    /// database files and the ambiguities of a nucleotide sequence are
+    /// decoded into its side table.  Any sequence the view referred to
+    /// before is released first.  The data is not copied, and if the
+    /// same view is used for many sequences, no memory is allocated once
+    /// its ambiguity table has grown to the largest needed.
+    ///
+    /// @param oid Ordinal id of the sequence. [in]
+    /// @param view The view to point at the sequence. [out]
+    void GetSeqView(int oid, CSeqDBSeqView & view) const;
+
     /// Get GI Bounds.
     ///
     /// Fetch the lowest, highest, and total number of GIs.  A value
@@ -213,6 +229,129 @@ void SeqDB_UnpackAmbiguities(const CTempString & sequence,
                              const CTempString & ambiguities,
                              string            & result);
 
+/// CSeqDBSeqView
+///
+/// Borrowed view of the packed data of one database sequence.  The data
+/// (ncbi2na for nucleotides, ncbistdaa for proteins) stays in the memory
+/// mapped database file; the view holds a reference to the database and
+/// to that region until it is released, reset to another sequence by
+/// CSeqDBExpert::GetSeqView(), or destroyed.  The ambiguities of a
+/// nucleotide sequence are available as a table of runs, so that callers
+/// can work on the packed data and look up the few ambiguous positions.
+
+class NCBI_XOBJREAD_EXPORT CSeqDBSeqView : public CObject {
+public:
+    /// A run of identical ambiguous residues.
+    struct SAmbigRun {
+        TSeqPos start;      ///< Position of the first residue of the run
+        TSeqPos length;     ///< Number of residues in the run
+        Uint1   residue;    ///< The residue in ncbi4na (NA8) encoding
+    };
+
+    /// Ambiguous runs of a sequence, in the order stored in the database.
+    typedef vector<SAmbigRun> TAmbigRuns;
+
+    /// Constructor; the view does not refer to any sequence.
+    CSeqDBSeqView();
+
+    /// Destructor; the sequence data is returned to the database.
+    ~CSeqDBSeqView();
+
+    /// Return the sequence data to the database.
+    ///
+    /// The view no longer refers to any sequence, but keeps the storage
+    /// of its ambiguity table for the next sequence.
+    void Release();
+
+    /// Check whether the view refers to a sequence.
+    bool Empty() const
+    {
+        return m_Data == NULL;
+    }
+
+    /// Get the ordinal id of the sequence, or -1 if the view is empty.
+    int GetOID() const
+    {
+        return m_OID;
+    }
+
+    /// Get the length of the sequence in residues.
+    int GetLength() const
+    {
+        return m_Length;
+    }
+
+    /// Check whether this is a protein sequence.
+    bool IsProtein() const
+    {
+        return m_IsProtein;
+    }
+
+    /// Get the packed sequence data.
+    ///
+    /// Nucleotide data has four bases per byte, the first base in the
+    /// most significant bits, and ambiguous bases replaced by arbitrary
+    /// ones (see GetAmbiguities()).  Protein data is in ncbistdaa.
+    const char * GetPackedData() const
+    {
+        return m_Data;
+    }
+
+    /// Get the ambiguous runs of a nucleotide sequence.
+    const TAmbigRuns & GetAmbiguities() const
+    {
+        return m_Ambig;
+    }
+
+    /// Expand the sequence to one residue per byte.
+    ///
+    /// This produces the same data as CSeqDB::GetAmbigSeq(), in a buffer
+    /// owned by the caller.
+    ///
+    /// @param buffer
+    ///   Receives the sequence; it must hold GetLength() bytes, plus two
+    ///   sentinel bytes for kSeqDBNuclBlastNA8. [out]
+    /// @param nucl_code
+    ///   kSeqDBNuclNcbiNA8 or kSeqDBNuclBlastNA8; ignored for proteins. [in]
+    /// @param masks
+    ///   If not NULL, residues in these ranges are masked. [in]
+    void Expand(char                          * buffer,
+                int                             nucl_code,
+                const CSeqDB::TSequenceRanges * masks = NULL) const;
+
+private:
+    /// Decode the ambiguity data of the sequence into the side table.
+    /// @param data Ambiguity data in database format. [in]
+    /// @param length Length of the ambiguity data in bytes. [in]
+    void x_SetAmbiguities(const char * data, int length);
+
+    /// Prevent copy construction.
+    CSeqDBSeqView(const CSeqDBSeqView &);
+
+    /// Prevent copy assignment.
+    CSeqDBSeqView & operator=(const CSeqDBSeqView &);
+
+    /// The database the data was borrowed from.
+    CConstRef<CSeqDBExpert> m_SeqDB;
+
+    /// Ordinal id of the sequence.
+    int m_OID;
+
+    /// The packed sequence data.
+    const char * m_Data;
+
+    /// Length of the sequence in residues.
+    int m_Length;
+
+    /// True for a protein sequence.
+    bool m_IsProtein;
+
+    /// Ambiguous runs of a nucleotide sequence.
+    TAmbigRuns m_Ambig;
+
+    friend class CSeqDBExpert;
+};
+
 END_NCBI_SCOPE
 
 #endif // OBJTOOLS_BLAST_SEQDB_READER___SEQDBEXPERT__HPP
@@ -383,6 +383,17 @@ public:
     /// @param max_file_size Maximum file size in bytes.
     void SetMaxFileSize(Uint8 max_file_size);
 
+    /// Set the number of threads used to build the database.
+    ///
+    /// With one or more threads, FASTA input is parsed by a separate
+    /// thread, and sequences are converted to database format by the
+    /// given number of worker threads (see CWriteDB).  The database
+    /// produced is the same as that of a serial build.  This must be
+    /// called before any sequences are added.
+    ///
+    /// @param num_threads Number of worker threads (0 for none).
+    void SetNumberOfThreads(int num_threads);
+
     /// Define a masking algorithm.
     ///
     /// The returned integer ID will be defined as corresponding to the
@@ -625,6 +636,9 @@ private:
     /// masking locations (via SetMaskDataSource). Used to display a warning in
     /// case this didn't happen
     bool m_FoundMatchingMasks;
+
+    /// Number of threads converting sequences (0 for a serial build).
+    int m_NumThreads;
 };
 
 END_NCBI_SCOPE
@@ -122,7 +122,11 @@ public:
         // Specialized ISAMs; these can be ORred into the above.
 
         /// Add an index from sequence hash to OID.
-        eAddHash = 0x100
+        eAddHash = 0x100,
+
+        /// Add a taxid to OID postings file (see CSeqDB::SetTaxIdFilter).
+        /// Unlike the other flags, this does not imply the ISAMs.
+        eAddTaxIds = 0x200
     };
     typedef int TIndexType; ///< Bitwise OR of "EIndexType"
 
@@ -337,6 +341,19 @@ public:
     /// @param letters Maximum letters to pack in one volume. [in]
     void SetMaxVolumeLetters(Uint8 letters);
 
+    /// Set the number of threads used to build the database.
+    ///
+    /// With one or more threads, added sequences are packed, and
+    /// their headers and identifier lists built, by that many worker
+    /// threads, while sequences are still written in the order they
+    /// were added; ISAM indices of each volume are built in parallel
+    /// when the volume is closed.  The database produced is the same
+    /// as that of a serial build.  The default is zero (a serial
+    /// build); this must be called before adding any sequences.
+    ///
+    /// @param num_threads Number of worker threads. [in]
+    void SetNumberOfThreads(int num_threads);
+
     /// Extract Deflines From Bioseq.
     ///
     /// Deflines are extracted from the CBioseq and returned to the
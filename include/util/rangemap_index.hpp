@@ -0,0 +1,240 @@
+#ifndef UTIL___RANGEMAP_INDEX__HPP
+#define UTIL___RANGEMAP_INDEX__HPP
+
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Read-only compact copy of CRangeMap/CRangeMultimap
+*
+* ===========================================================================
+*/
+
+#include <util/rangemap.hpp>
+#include <vector>
+#include <algorithm>
+
+
+/** @addtogroup RangeSupport
+ *
+ * @{
+ */
+
+
+BEGIN_NCBI_SCOPE
+
+
+/////////////////////////////////////////////////////////////////////////////
+///
+/// CRangeMapIndex --
+///
+/// Snapshot of a range map for fast repeated searches.
+///
+/// The entries are kept in the order of the range map, i.e. grouped by
+/// the length level and sorted by range within a level, with the range
+/// bounds stored in separate contiguous arrays. A search scans the same
+/// entries in the same order as the range map iterator does, so the
+/// results are identical, but without walking the tree nodes.
+/// The index points to the values of the range map, so it becomes
+/// invalid when the range map is modified.
+
+template<class RangeMap>
+class CRangeMapIndex
+{
+public:
+    typedef RangeMap                                TRangeMap;
+    typedef size_t                                  size_type;
+    typedef typename TRangeMap::position_type       position_type;
+    typedef typename TRangeMap::range_type          range_type;
+    typedef typename TRangeMap::value_type          value_type;
+
+    explicit CRangeMapIndex(const TRangeMap& rmap);
+
+    size_type size(void) const
+        {
+            return m_Values.size();
+        }
+    bool empty(void) const
+        {
+            return m_Values.empty();
+        }
+
+    class const_iterator
+    {
+    public:
+        const_iterator(void)
+            : m_Index(0), m_Level(0), m_Pos(0)
+            {
+            }
+
+        bool Valid(void) const
+            {
+                return m_Index && m_Level < m_Index->m_Levels.size();
+            }
+        DECLARE_OPERATOR_BOOL(Valid());
+
+        range_type GetInterval(void) const
+            {
+                return m_Index->m_Values[m_Pos]->first;
+            }
+        const value_type& operator*(void) const
+            {
+                return *m_Index->m_Values[m_Pos];
+            }
+        const value_type* operator->(void) const
+            {
+                return m_Index->m_Values[m_Pos];
+            }
+
+        const_iterator& operator++(void)
+            {
+                size_t pos = m_Pos + 1;
+                while ( !x_SetPos(pos) &&
+                        ++m_Level < m_Index->m_Levels.size() ) {
+                    pos = x_FirstPos();
+                }
+                return *this;
+            }
+
+    private:
+        friend class CRangeMapIndex<RangeMap>;
+
+        const_iterator(const CRangeMapIndex& index, const range_type& range)
+            : m_Index(&index), m_Range(range), m_Level(0), m_Pos(0)
+            {
+                size_t count = index.m_Levels.size();
+                if ( range.Empty() ) {
+                    m_Level = count;
+                    return;
+                }
+                while ( m_Level < count && !x_SetPos(x_FirstPos()) ) {
+                    ++m_Level;
+                }
+            }
+
+        // The same steps as in CRangeMapIterator: skip the entries
+        // ending before the range, stop at the first one starting
+        // after it.
+        bool x_SetPos(size_t pos)
+            {
+                const size_t end = m_Index->m_Levels[m_Level].m_End;
+                const position_type* from = &m_Index->m_From[0];
+                const position_type* to_open = &m_Index->m_ToOpen[0];
+                for ( ; pos < end; ++pos ) {
+                    if ( to_open[pos] > m_Range.GetFrom() ) {
+                        if ( from[pos] < m_Range.GetToOpen() ) {
+                            m_Pos = pos;
+                            return true;
+                        }
+                        return false;
+                    }
+                }
+                return false;
+            }
+
+        // The first entry of the level, which can intersect the range.
+        size_t x_FirstPos(void) const
+            {
+                const SLevel& level = m_Index->m_Levels[m_Level];
+                position_type from = m_Range.GetFrom();
+                if ( from <= range_type::GetWholeFrom() + level.m_Shift ) {
+                    return level.m_Begin;
+                }
+                const position_type* base = &m_Index->m_From[0];
+                return std::lower_bound(base + level.m_Begin,
+                                        base + level.m_End,
+                                        position_type(from - level.m_Shift))
+                    - base;
+            }
+
+        const CRangeMapIndex* m_Index;
+        range_type            m_Range;
+        size_t                m_Level;
+        size_t                m_Pos;
+    };
+
+    const_iterator begin(const range_type& range) const
+        {
+            return const_iterator(*this, range);
+        }
+    const_iterator begin(void) const
+        {
+            return const_iterator(*this, range_type::GetWhole());
+        }
+
+private:
+    friend class const_iterator;
+
+    struct SLevel
+    {
+        position_type m_Shift;  // maximum length of the level minus one
+        size_t        m_Begin;
+        size_t        m_End;
+    };
+    typedef vector<SLevel>                 TLevels;
+    typedef vector<position_type>          TPositions;
+    typedef vector<const value_type*>      TValues;
+
+    TLevels    m_Levels;
+    TPositions m_From;
+    TPositions m_ToOpen;
+    TValues    m_Values;
+
+private:
+    CRangeMapIndex(const CRangeMapIndex&);
+    void operator=(const CRangeMapIndex&);
+};
+
+
+template<class RangeMap>
+CRangeMapIndex<RangeMap>::CRangeMapIndex(const TRangeMap& rmap)
+{
+    size_type size = rmap.size();
+    m_From.reserve(size);
+    m_ToOpen.reserve(size);
+    m_Values.reserve(size);
+    for ( typename TRangeMap::const_iterator it = rmap.begin(); it; ++it ) {
+        position_type shift = it.GetSelectIter()->first - 1;
+        if ( m_Levels.empty() || m_Levels.back().m_Shift != shift ) {
+            SLevel level;
+            level.m_Shift = shift;
+            level.m_Begin = level.m_End = m_Values.size();
+            m_Levels.push_back(level);
+        }
+        const range_type& range = it->first;
+        m_From.push_back(range.GetFrom());
+        m_ToOpen.push_back(range.GetToOpen());
+        m_Values.push_back(&*it);
+        m_Levels.back().m_End = m_Values.size();
+    }
+}
+
+
+/* @} */
+
+
+END_NCBI_SCOPE
+
+#endif  /* UTIL___RANGEMAP_INDEX__HPP */
@@ -69,6 +69,20 @@ public:
     typedef ECodingType  TCodingType;
 
     static ECodingType GetCodingType(TCoding coding);
+
+    /// Instruction sets used by the conversion and manipulation routines;
+    /// the best one supported by the CPU is picked at run time.
+    enum ESimdLevel {
+        eSimd_None,     ///< table-driven code only
+        eSimd_SSE41
+    };
+
+    /// Get the instruction set in use
+    static ESimdLevel GetSimdLevel(void);
+
+    /// Limit the instruction set, e.g. to compare with the table-driven
+    /// code; returns the previous limit
+    static ESimdLevel SetMaxSimdLevel(ESimdLevel level);
 };
 
 
@@ -33,6 +33,7 @@
 
 #include <ncbi_pch.hpp>
 #include "mm_aligner_threads.hpp"
+#include "nw_score_simd.hpp"
 
 #include <corelib/ncbimtx.hpp>
 #include <algo/align/nw/align_exception.hpp>
@@ -493,7 +494,32 @@ void CMMAligner::x_RunTop ( const SCoordRect& rect,
     TScore V0 = lt? 0: wg;
     TScore E, G, n0;
 
-    for(i = 1;  i < N1 - 1;  ++i) {
+    i = 1;
+    if(NW_UseScorePass(N1 - 2, N2 - 1)) {
+        SNWScorePass pass;
+        pass.m_Seq1 = seq1;
+        pass.m_Seq2 = seq2;
+        pass.m_Rows = N1 - 2;
+        pass.m_Cols = N2 - 1;
+        pass.m_Matrix = sm;
+        pass.m_Wg = m_Wg;
+        pass.m_Ws = m_Ws;
+        pass.m_V0 = V0;
+        pass.m_Ws0 = ws;
+        pass.m_FreeLastCol = bFreeGapRight2;
+        if(m_prg_callback) {
+            pass.m_Progress = x_ScorePassProgress;
+            pass.m_ProgressData = const_cast<CMMAligner*>(this);
+        }
+        if(!NW_ScorePass(pass, rowV, rowF)) {
+            // stopped by the progress callback, m_terminate is set
+            return;
+        }
+        V0 += TScore(N1 - 2) * ws;
+        i = N1 - 1;
+    }
+
+    for(;  i < N1 - 1;  ++i) {
         
         V = V0 += ws;
         E = kInfMinus;
@@ -664,7 +690,42 @@ void CMMAligner::x_RunBtm(const SCoordRect& rect,
     TScore V0 = rb? 0: wg;
     TScore E, G, n0;
 
-    for(i = N1 - 2;  i > 0;  --i) {
+    i = N1 - 2;
+    if(NW_UseScorePass(N1 - 2, N2 - 1)) {
+        // the kernel runs forward; feed it the mirrored block
+        vector<TScore> mirV (stl_rowV.rbegin(), stl_rowV.rend());
+        vector<TScore> mirF (N2);
+        SNWScorePass pass;
+        pass.m_Seq1 = seq1 + N1 - 1;
+        pass.m_Step1 = -1;
+        pass.m_Seq2 = seq2 + N2 - 1;
+        pass.m_Step2 = -1;
+        pass.m_Rows = N1 - 2;
+        pass.m_Cols = N2 - 1;
+        pass.m_Matrix = sm;
+        pass.m_Wg = m_Wg;
+        pass.m_Ws = m_Ws;
+        pass.m_V0 = V0;
+        pass.m_Ws0 = ws;
+        pass.m_FreeLastCol = bFreeGapLeft2;
+        if(m_prg_callback) {
+            pass.m_Progress = x_ScorePassProgress;
+            pass.m_ProgressData = const_cast<CMMAligner*>(this);
+        }
+        if(!NW_ScorePass(pass, &mirV[0], &mirF[0])) {
+            // stopped by the progress callback, m_terminate is set
+            return;
+        }
+        for(j = 0; j < int(N2) - 1; ++j) {
+            rowV[j] = mirV[N2 - 1 - j];
+            rowF[j] = mirF[N2 - 1 - j];
+        }
+        rowV[N2 - 1] = mirV[0];
+        V0 += TScore(N1 - 2) * ws;
+        i = 0;
+    }
+
+    for(;  i > 0;  --i) {
         
         V = V0 += ws;
         E = kInfMinus;
@@ -934,6 +995,18 @@ CNWAligner::TScore CMMAligner::x_RunTerm(const SCoordRect& rect,
 }
 
 
+bool CMMAligner::x_ScorePassProgress(void* data, size_t cells)
+{
+    CMMAligner* aligner = static_cast<CMMAligner*>(data);
+#ifdef NCBI_THREADS
+    CFastMutexGuard guard (progress_mutex);
+#endif
+    aligner->m_prg_info.m_iter_done += cells;
+    aligner->m_terminate = aligner->m_prg_callback(&aligner->m_prg_info);
+    return aligner->m_terminate;
+}
+
+
 bool CMMAligner::x_CheckMemoryLimit()
 {
     return true;
@@ -0,0 +1,320 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:  Anti-diagonal score-only dynamic programming kernel
+ *
+ * ===========================================================================
+ *
+ */
+
+#include <ncbi_pch.hpp>
+#include "nw_score_simd.hpp"
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+
+BEGIN_NCBI_SCOPE
+
+typedef CNWAligner::TScore TScore;
+
+
+SNWScorePass::SNWScorePass(void)
+    : m_Seq1(0), m_Step1(1), m_Seq2(0), m_Step2(1),
+      m_Rows(0), m_Cols(0), m_Matrix(0),
+      m_Wg(0), m_Ws(0), m_V0(0), m_Ws0(0),
+      m_FreeLastCol(false),
+      m_Progress(0), m_ProgressData(0)
+{
+}
+
+
+namespace {
+
+// shortest anti-diagonal worth vectorizing
+const size_t kMinScorePassDim = 32;
+
+// diagonals between two progress reports
+const size_t kProgressRate = 256;
+
+// largest score magnitude handled in 16-bit lanes; leaves room for
+// one more gap opening on top of any cell value
+const Int8 kMaxScore16 = 32000;
+
+
+// 16-bit lanes with saturating arithmetic
+struct SLanes16
+{
+    typedef Int2 TLane;
+    enum { eWidth = 8 };
+
+    static TLane MinusInf(void) { return kMin_I2; }
+
+    static TLane Add(TLane a, TScore b) {
+        TScore rv = a + b;
+        return TLane(rv < kMin_I2? kMin_I2: (rv > kMax_I2? kMax_I2: rv));
+    }
+
+#ifdef __SSE2__
+    typedef __m128i TVec;
+
+    static TVec Splat(TScore v) { return _mm_set1_epi16(TLane(v)); }
+    static TVec Add(TVec a, TVec b) { return _mm_adds_epi16(a, b); }
+    static TVec Max(TVec a, TVec b) { return _mm_max_epi16(a, b); }
+#endif
+};
+
+
+// 32-bit lanes; kInfMinus leaves enough headroom for plain additions
+struct SLanes32
+{
+    typedef Int4 TLane;
+    enum { eWidth = 4 };
+
+    static TLane MinusInf(void) { return kInfMinus; }
+
+    static TLane Add(TLane a, TScore b) { return a + b; }
+
+#ifdef __SSE2__
+    typedef __m128i TVec;
+
+    static TVec Splat(TScore v) { return _mm_set1_epi32(v); }
+    static TVec Add(TVec a, TVec b) { return _mm_add_epi32(a, b); }
+    static TVec Max(TVec a, TVec b) {
+        // SSE2 lacks a signed 32-bit max
+        __m128i gt = _mm_cmpgt_epi32(a, b);
+        return _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+    }
+#endif
+};
+
+
+#ifdef __SSE2__
+inline __m128i s_Load(const void* p)
+{
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+}
+
+inline void s_Store(void* p, __m128i v)
+{
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+}
+#endif
+
+
+// Cell (i,j) lives at index i of the buffers of diagonal d = i + j.
+// E(i,j) depends on diagonal d-1 at index i, F(i,j) on diagonal d-1
+// at index i-1, and the diagonal move on diagonal d-2 at index i-1.
+template <class TLanes>
+bool s_ScorePass(const SNWScorePass& pass, TScore* rowV, TScore* rowF)
+{
+    typedef typename TLanes::TLane TLane;
+
+    const size_t R = pass.m_Rows;
+    const size_t C = pass.m_Cols;
+
+    // the padding absorbs the lanes past the end of the last vector
+    const size_t dim = R + 1 + TLanes::eWidth;
+    vector<TLane> buf (8 * dim);
+    TLane* V2 = &buf[0];
+    TLane* V1 = V2 + dim;
+    TLane* V  = V1 + dim;
+    TLane* E1 = V  + dim;
+    TLane* E  = E1 + dim;
+    TLane* F1 = E  + dim;
+    TLane* F  = F1 + dim;
+    TLane* S  = F  + dim;
+
+    const TLane kMinus = TLanes::MinusInf();
+    const TNCBIScore (*sm) [NCBI_FSM_DIM] = pass.m_Matrix;
+    const TScore Wg = pass.m_Wg, Ws = pass.m_Ws;
+
+#ifdef __SSE2__
+    const typename TLanes::TVec vWg = TLanes::Splat(Wg);
+    const typename TLanes::TVec vWs = TLanes::Splat(Ws);
+#endif
+
+    V[0] = TLane(rowV[0]);
+
+    size_t cells = 0;
+    for (size_t d = 1; d <= R + C; ++d) {
+
+        TLane* tmp = V2;  V2 = V1;  V1 = V;  V = tmp;
+        swap(E1, E);
+        swap(F1, F);
+
+        const size_t lo = d > C? d - C: 1;
+        const size_t hi = d - 1 < R? d - 1: R;
+
+        if (lo <= hi) {
+
+            const char* s1 = pass.m_Seq1 + ptrdiff_t(lo) * pass.m_Step1;
+            const char* s2 = pass.m_Seq2 + ptrdiff_t(d - lo) * pass.m_Step2;
+            for (size_t i = lo; i <= hi; ++i) {
+                S[i] = TLane(sm[(unsigned char)*s1][(unsigned char)*s2]);
+                s1 += pass.m_Step1;
+                s2 -= pass.m_Step2;
+            }
+
+#ifdef __SSE2__
+            for (size_t i = lo; i <= hi; i += TLanes::eWidth) {
+                typename TLanes::TVec e = TLanes::Add(TLanes::Max(
+                    s_Load(E1 + i), TLanes::Add(s_Load(V1 + i), vWg)), vWs);
+                typename TLanes::TVec f = TLanes::Add(TLanes::Max(
+                    s_Load(F1 + i - 1), TLanes::Add(s_Load(V1 + i - 1), vWg)),
+                    vWs);
+                typename TLanes::TVec g = TLanes::Add(s_Load(V2 + i - 1),
+                                                      s_Load(S + i));
+                s_Store(E + i, e);
+                s_Store(F + i, f);
+                s_Store(V + i, TLanes::Max(TLanes::Max(e, f), g));
+            }
+#else
+            for (size_t i = lo; i <= hi; ++i) {
+                TLane e = TLanes::Add(max(E1[i], TLanes::Add(V1[i], Wg)), Ws);
+                TLane f = TLanes::Add(max(F1[i-1], TLanes::Add(V1[i-1], Wg)),
+                                      Ws);
+                TLane g = TLanes::Add(V2[i-1], S[i]);
+                E[i] = e;
+                F[i] = f;
+                V[i] = max(max(e, f), g);
+            }
+#endif
+
+            // vertical gaps in the last column may come for free
+            if (pass.m_FreeLastCol && d > C) {
+                TLane f = max(F1[lo-1], V1[lo-1]);
+                TLane g = TLanes::Add(V2[lo-1], S[lo]);
+                F[lo] = f;
+                V[lo] = max(max(E[lo], f), g);
+            }
+
+            cells += hi - lo + 1;
+        }
+
+        // boundary cells; these overwrite the lanes stored past hi
+        if (d <= C) {
+            V[0] = TLane(rowV[d]);
+            F[0] = kMinus;
+        }
+        if (d <= R) {
+            V[d] = TLane(pass.m_V0 + TScore(d) * pass.m_Ws0);
+            E[d] = kMinus;
+        }
+
+        // the last row is complete up to column d - R; rowV[d] has been
+        // consumed by now, so the output can share the input buffer
+        if (d >= R) {
+            rowV[d - R] = V[R];
+            if (d > R) {
+                rowF[d - R] = F[R];
+            }
+        }
+
+        if (pass.m_Progress && d % kProgressRate == 0) {
+            if (pass.m_Progress(pass.m_ProgressData, cells)) {
+                return false;
+            }
+            cells = 0;
+        }
+    }
+
+    if (pass.m_Progress && cells > 0) {
+        if (pass.m_Progress(pass.m_ProgressData, cells)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
+// Upper bound on the magnitude of any value computed by the pass: every
+// cell holds the score of a path of at most R + C steps from a boundary
+// cell, and each step changes the score by at most one substitution
+// score or one gap opening plus extension.
+Int8 s_ScoreBound(const SNWScorePass& pass, const TScore* rowV)
+{
+    bool used1 [256], used2 [256];
+    fill(used1, used1 + 256, false);
+    fill(used2, used2 + 256, false);
+
+    const char* s = pass.m_Seq1 + pass.m_Step1;
+    for (size_t i = 1; i <= pass.m_Rows; ++i, s += pass.m_Step1) {
+        used1[(unsigned char)*s] = true;
+    }
+    s = pass.m_Seq2 + pass.m_Step2;
+    for (size_t j = 1; j <= pass.m_Cols; ++j, s += pass.m_Step2) {
+        used2[(unsigned char)*s] = true;
+    }
+
+    Int8 step = Int8(abs(pass.m_Wg)) + abs(pass.m_Ws);
+    for (size_t c1 = 0; c1 < NCBI_FSM_DIM; ++c1) {
+        if (!used1[c1]) continue;
+        for (size_t c2 = 0; c2 < NCBI_FSM_DIM; ++c2) {
+            if (used2[c2]) {
+                step = max(step, Int8(abs(pass.m_Matrix[c1][c2])));
+            }
+        }
+    }
+
+    Int8 start = abs(Int8(pass.m_V0)) + Int8(pass.m_Rows) * abs(pass.m_Ws0);
+    for (size_t j = 0; j <= pass.m_Cols; ++j) {
+        start = max(start, abs(Int8(rowV[j])));
+    }
+
+    return start + Int8(pass.m_Rows + pass.m_Cols + 2) * step;
+}
+
+} // namespace
+
+
+bool NW_UseScorePass(size_t rows, size_t cols)
+{
+    return rows >= kMinScorePassDim && cols >= kMinScorePassDim;
+}
+
+
+bool NW_ScorePassFits16(const SNWScorePass& pass, const TScore* rowV)
+{
+    return s_ScoreBound(pass, rowV) <= kMaxScore16;
+}
+
+
+bool NW_ScorePass(const SNWScorePass& pass, TScore* rowV, TScore* rowF)
+{
+    if (pass.m_Rows == 0 || pass.m_Cols == 0) {
+        return true;
+    }
+
+    if (NW_ScorePassFits16(pass, rowV)) {
+        return s_ScorePass<SLanes16>(pass, rowV, rowF);
+    }
+    return s_ScorePass<SLanes32>(pass, rowV, rowF);
+}
+
+
+END_NCBI_SCOPE
@@ -0,0 +1,120 @@
+#ifndef ALGO___NW_SCORE_SIMD__HPP
+#define ALGO___NW_SCORE_SIMD__HPP
+
+/* $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:  Anti-diagonal score-only dynamic programming kernel
+*
+*   The kernel evaluates the affine (Gotoh) recurrences used by the
+*   linear-space aligners over a block of rows without keeping any
+*   traceback, processing one anti-diagonal at a time so that all
+*   cells of a diagonal are independent and can be computed in SIMD
+*   registers. 16-bit lanes are used whenever the scores of the block
+*   are provably within range, 32-bit lanes otherwise. The results are
+*   identical to the scalar row-by-row evaluation.
+*
+*   Only CMMAligner uses the kernel, for the rows of x_RunTop and
+*   x_RunBtm that need no traceback. CNWAligner, CBandAligner and the
+*   spliced aligners record traceback bits for every cell and stay
+*   scalar.
+*
+*/
+
+#include <algo/align/nw/nw_aligner.hpp>
+
+BEGIN_NCBI_SCOPE
+
+
+/// Progress hook; receives the number of cells computed since the
+/// previous call and returns true to stop the computation
+typedef bool (*FNWScorePassProgress)(void* data, size_t cells);
+
+
+/// Score-only pass parameters.
+///
+/// Rows and columns are numbered from one; row zero and column zero
+/// form the boundary. The residue of row i is seq1[i * step1], the
+/// residue of column j is seq2[j * step2], so that passes running
+/// towards the beginning of the sequences use negative steps.
+struct SNWScorePass
+{
+    SNWScorePass(void);
+
+    const char*  m_Seq1;
+    int          m_Step1;
+    const char*  m_Seq2;
+    int          m_Step2;
+
+    /// Number of rows and columns to compute
+    size_t       m_Rows;
+    size_t       m_Cols;
+
+    const TNCBIScore (*m_Matrix) [NCBI_FSM_DIM];
+
+    /// Gap opening and extension
+    CNWAligner::TScore  m_Wg;
+    CNWAligner::TScore  m_Ws;
+
+    /// Column zero: V(i,0) = m_V0 + i * m_Ws0
+    CNWAligner::TScore  m_V0;
+    CNWAligner::TScore  m_Ws0;
+
+    /// Vertical gaps in the last column are not penalized
+    bool         m_FreeLastCol;
+
+    FNWScorePassProgress m_Progress;
+    void*                m_ProgressData;
+};
+
+
+/// Check whether a block is large enough to benefit from the kernel
+bool NW_UseScorePass(size_t rows, size_t cols);
+
+
+/// Check whether the pass will run in 16-bit lanes, that is whether
+/// no value it computes can exceed the 16-bit range
+bool NW_ScorePassFits16(const SNWScorePass& pass,
+                        const CNWAligner::TScore* rowV);
+
+
+/// Run the score-only pass.
+///
+/// @param pass
+///   Block description
+/// @param rowV
+///   On input, V(0,j) for j = 0..m_Cols; on output, V(m_Rows,j)
+/// @param rowF
+///   On output, F(m_Rows,j) for j = 1..m_Cols
+/// @return
+///   false if the progress hook requested termination
+bool NW_ScorePass(const SNWScorePass& pass,
+                  CNWAligner::TScore* rowV,
+                  CNWAligner::TScore* rowF);
+
+
+END_NCBI_SCOPE
+
+#endif  /* ALGO___NW_SCORE_SIMD__HPP */
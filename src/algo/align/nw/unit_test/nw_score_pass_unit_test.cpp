@@ -0,0 +1,420 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Unit tests for the score-only pass used by CMMAligner
+*
+* ===========================================================================
+*/
+
+#include <ncbi_pch.hpp>
+
+// This header must be included before all Boost.Test headers if there are any
+#include <corelib/test_boost.hpp>
+#include <util/random_gen.hpp>
+#include <util/tables/raw_scoremat.h>
+#include <algo/align/nw/mm_aligner.hpp>
+#include "../nw_score_simd.hpp"
+
+#include <common/test_assert.h>  /* This header must go last */
+
+USING_NCBI_SCOPE;
+
+typedef CNWAligner::TScore TScore;
+
+
+namespace {
+
+const char* const kNa = "ACGT";
+const char* const kAa = "ARNDCQEGHILKMFPSTWYV";
+
+
+string s_RandomSeq(CRandom& rnd, size_t len, const char* alphabet)
+{
+    string seq (len, ' ');
+    size_t n = strlen(alphabet);
+    for (size_t i = 0; i < len; ++i) {
+        seq[i] = alphabet[rnd.GetRand(0, CRandom::TValue(n - 1))];
+    }
+    return seq;
+}
+
+
+// A copy of seq with about one residue in ten changed, inserted or deleted
+string s_Mutate(CRandom& rnd, const string& seq, const char* alphabet)
+{
+    string rv;
+    size_t n = strlen(alphabet);
+    for (size_t i = 0; i < seq.size(); ++i) {
+        switch (rnd.GetRand(0, 29)) {
+        case 0:
+            rv += alphabet[rnd.GetRand(0, CRandom::TValue(n - 1))];
+            break;
+        case 1:
+            rv += alphabet[rnd.GetRand(0, CRandom::TValue(n - 1))];
+            rv += seq[i];
+            break;
+        case 2:
+            break;
+        default:
+            rv += seq[i];
+        }
+    }
+    return rv;
+}
+
+
+void s_NaMatrix(SNCBIFullScoreMatrix& sm, TScore match, TScore mismatch)
+{
+    for (size_t i = 0; i < NCBI_FSM_DIM; ++i) {
+        for (size_t j = 0; j < NCBI_FSM_DIM; ++j) {
+            sm.s[i][j] = i == j? match: mismatch;
+        }
+    }
+}
+
+
+// Block of all residues of seq1 and seq2, in the layout used by
+// x_RunTop or, with reverse set, by x_RunBtm
+SNWScorePass s_MakePass(const string& seq1, const string& seq2,
+                        const SNCBIFullScoreMatrix& sm,
+                        TScore wg, TScore ws, bool reverse)
+{
+    SNWScorePass pass;
+    if (reverse) {
+        pass.m_Seq1 = seq1.data() + seq1.size();
+        pass.m_Step1 = -1;
+        pass.m_Seq2 = seq2.data() + seq2.size();
+        pass.m_Step2 = -1;
+    }
+    else {
+        pass.m_Seq1 = seq1.data() - 1;
+        pass.m_Seq2 = seq2.data() - 1;
+    }
+    pass.m_Rows = seq1.size();
+    pass.m_Cols = seq2.size();
+    pass.m_Matrix = sm.s;
+    pass.m_Wg = wg;
+    pass.m_Ws = ws;
+    pass.m_V0 = wg;
+    pass.m_Ws0 = ws;
+    return pass;
+}
+
+
+// Row zero as set up by x_RunTop
+vector<TScore> s_FirstRow(const SNWScorePass& pass, TScore start)
+{
+    vector<TScore> row (pass.m_Cols + 1);
+    row[0] = start;
+    for (size_t j = 1; j <= pass.m_Cols; ++j) {
+        row[j] = start + pass.m_Wg + TScore(j) * pass.m_Ws;
+    }
+    return row;
+}
+
+
+// The row loop of CMMAligner::x_RunTop, reading the residues and the
+// boundary the way SNWScorePass describes them
+void s_RowLoop(const SNWScorePass& pass,
+               vector<TScore>& rowV, vector<TScore>& rowF)
+{
+    const size_t C = pass.m_Cols;
+    const TNCBIScore (*sm) [NCBI_FSM_DIM] = pass.m_Matrix;
+    rowF.assign(C + 1, kInfMinus);
+
+    TScore V0 = pass.m_V0;
+    for (size_t i = 1; i <= pass.m_Rows; ++i) {
+        unsigned char ci = pass.m_Seq1[ptrdiff_t(i) * pass.m_Step1];
+        TScore V = V0 += pass.m_Ws0;
+        TScore E = kInfMinus;
+        TScore diag = rowV[0];
+        rowV[0] = V;
+        for (size_t j = 1; j <= C; ++j) {
+            unsigned char cj = pass.m_Seq2[ptrdiff_t(j) * pass.m_Step2];
+            TScore G = diag + sm[ci][cj];
+            diag = rowV[j];
+
+            TScore n0 = V + pass.m_Wg;
+            if (E >= n0) {
+                E += pass.m_Ws;
+            }
+            else {
+                E = n0 + pass.m_Ws;
+            }
+
+            TScore wg2 = pass.m_Wg, ws2 = pass.m_Ws;
+            if (j == C && pass.m_FreeLastCol) {
+                wg2 = ws2 = 0;
+            }
+            n0 = rowV[j] + wg2;
+            if (rowF[j] > n0) {
+                rowF[j] += ws2;
+            }
+            else {
+                rowF[j] = n0 + ws2;
+            }
+
+            V = max(max(E, rowF[j]), G);
+            rowV[j] = V;
+        }
+    }
+}
+
+
+void s_CheckPass(const SNWScorePass& pass, const vector<TScore>& first_row)
+{
+    vector<TScore> expV (first_row), expF;
+    s_RowLoop(pass, expV, expF);
+
+    vector<TScore> rowV (first_row), rowF (pass.m_Cols + 1, 0);
+    BOOST_REQUIRE(NW_ScorePass(pass, &rowV[0], &rowF[0]));
+    BOOST_CHECK_EQUAL_COLLECTIONS(rowV.begin(), rowV.end(),
+                                  expV.begin(), expV.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(rowF.begin() + 1, rowF.end(),
+                                  expF.begin() + 1, expF.end());
+}
+
+
+struct SProgressCount
+{
+    SProgressCount(size_t stop_at)
+        : m_Calls(0), m_Cells(0), m_StopAt(stop_at)
+    {
+    }
+
+    static bool Progress(void* data, size_t cells)
+    {
+        SProgressCount* count = static_cast<SProgressCount*>(data);
+        count->m_Cells += cells;
+        return ++count->m_Calls == count->m_StopAt;
+    }
+
+    size_t m_Calls;
+    size_t m_Cells;
+    size_t m_StopAt;
+};
+
+
+bool s_StopAfterStart(CNWAligner::SProgressInfo* info)
+{
+    size_t* calls = static_cast<size_t*>(info->m_data);
+    ++*calls;
+    return info->m_iter_done > 0;
+}
+
+
+// The pass with row zero and column zero lowered by shift
+SNWScorePass s_ShiftPass(const SNWScorePass& pass, TScore shift,
+                         vector<TScore>& first_row)
+{
+    SNWScorePass rv (pass);
+    rv.m_V0 = pass.m_Wg - shift;
+    first_row = s_FirstRow(pass, -shift);
+    return rv;
+}
+
+
+bool s_Fits16(const SNWScorePass& pass, TScore shift)
+{
+    vector<TScore> row;
+    SNWScorePass shifted = s_ShiftPass(pass, shift, row);
+    return NW_ScorePassFits16(shifted, &row[0]);
+}
+
+} // namespace
+
+
+BOOST_AUTO_TEST_CASE(ScorePassMatchesRowLoop)
+{
+    CRandom rnd (1);
+    SNCBIFullScoreMatrix na, aa;
+    s_NaMatrix(na, 1, -2);
+    NCBISM_Unpack(&NCBISM_Blosum62, &aa);
+
+    // sizes around the vector widths and bigger ones
+    const size_t kSizes[] = { 1, 2, 7, 8, 9, 15, 16, 17, 33, 100, 257 };
+    const size_t kNumSizes = sizeof(kSizes) / sizeof(kSizes[0]);
+
+    for (size_t s1 = 0; s1 < kNumSizes; ++s1) {
+        for (size_t s2 = 0; s2 < kNumSizes; s2 += 2) {
+            for (int protein = 0; protein < 2; ++protein) {
+                const char* alphabet = protein? kAa: kNa;
+                string seq1 = s_RandomSeq(rnd, kSizes[s1], alphabet);
+                string seq2 = s_Mutate(rnd, seq1, alphabet);
+                seq2 += s_RandomSeq(rnd, kSizes[s2], alphabet);
+                for (int reverse = 0; reverse < 2; ++reverse) {
+                    for (int free_col = 0; free_col < 2; ++free_col) {
+                        SNWScorePass pass = protein?
+                            s_MakePass(seq1, seq2, aa, -11, -1, reverse != 0):
+                            s_MakePass(seq1, seq2, na, -5, -2, reverse != 0);
+                        pass.m_FreeLastCol = free_col != 0;
+                        vector<TScore> row = s_FirstRow(pass, 0);
+                        BOOST_CHECK(NW_ScorePassFits16(pass, &row[0]));
+                        s_CheckPass(pass, row);
+
+                        // free end gaps in column zero
+                        pass.m_V0 = pass.m_Ws0 = 0;
+                        s_CheckPass(pass, row);
+                    }
+                }
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(ScorePassIn32BitLanes)
+{
+    CRandom rnd (2);
+    SNCBIFullScoreMatrix na;
+    s_NaMatrix(na, 1000, -1500);
+
+    for (int reverse = 0; reverse < 2; ++reverse) {
+        for (int free_col = 0; free_col < 2; ++free_col) {
+            string seq1 = s_RandomSeq(rnd, 300, kNa);
+            string seq2 = s_Mutate(rnd, seq1, kNa);
+            SNWScorePass pass =
+                s_MakePass(seq1, seq2, na, -3000, -500, reverse != 0);
+            pass.m_FreeLastCol = free_col != 0;
+            vector<TScore> row = s_FirstRow(pass, 0);
+            BOOST_CHECK(!NW_ScorePassFits16(pass, &row[0]));
+            s_CheckPass(pass, row);
+        }
+    }
+}
+
+
+// Scores as close to the 16-bit range as the bound allows, and just past
+// the bound, where the pass switches to 32-bit lanes
+BOOST_AUTO_TEST_CASE(ScorePassAt16BitBound)
+{
+    SNCBIFullScoreMatrix na;
+    s_NaMatrix(na, 3, -4);
+
+    // nothing but mismatches, so the scores keep falling; the block is
+    // small, so that they get close to the bound
+    string seq1 (16, 'A'), seq2 (16, 'C');
+    for (int reverse = 0; reverse < 2; ++reverse) {
+        SNWScorePass pass = s_MakePass(seq1, seq2, na, -5, -2, reverse != 0);
+
+        // the largest shift that still fits
+        TScore lo = 0, hi = 40000;
+        BOOST_REQUIRE(s_Fits16(pass, lo));
+        BOOST_REQUIRE(!s_Fits16(pass, hi));
+        while (hi - lo > 1) {
+            TScore mid = (lo + hi) / 2;
+            if (s_Fits16(pass, mid)) {
+                lo = mid;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        BOOST_CHECK_GT(lo, 31500);
+
+        vector<TScore> row;
+        s_CheckPass(s_ShiftPass(pass, lo, row), row);
+        s_CheckPass(s_ShiftPass(pass, hi, row), row);
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(ScorePassProgressAndTermination)
+{
+    CRandom rnd (3);
+    SNCBIFullScoreMatrix na;
+    s_NaMatrix(na, 1, -2);
+    string seq1 = s_RandomSeq(rnd, 700, kNa);
+    string seq2 = s_RandomSeq(rnd, 600, kNa);
+    SNWScorePass pass = s_MakePass(seq1, seq2, na, -5, -2, false);
+
+    // every cell is reported once
+    SProgressCount all (0);
+    pass.m_Progress = SProgressCount::Progress;
+    pass.m_ProgressData = &all;
+    vector<TScore> row = s_FirstRow(pass, 0);
+    vector<TScore> rowF (pass.m_Cols + 1);
+    BOOST_CHECK(NW_ScorePass(pass, &row[0], &rowF[0]));
+    BOOST_CHECK_EQUAL(all.m_Cells, seq1.size() * seq2.size());
+    BOOST_CHECK_GT(all.m_Calls, size_t(2));
+
+    // the pass stops at the first request
+    SProgressCount stop (2);
+    pass.m_ProgressData = &stop;
+    row = s_FirstRow(pass, 0);
+    BOOST_CHECK(!NW_ScorePass(pass, &row[0], &rowF[0]));
+    BOOST_CHECK_EQUAL(stop.m_Calls, size_t(2));
+    BOOST_CHECK_LT(stop.m_Cells, all.m_Cells);
+}
+
+
+// x_RunTop and x_RunBtm hand their rows to the pass; the Myers-Miller
+// aligner must still find alignments as good as the full matrix one
+BOOST_AUTO_TEST_CASE(MMAlignerMatchesNWAligner)
+{
+    CRandom rnd (4);
+    for (int protein = 0; protein < 2; ++protein) {
+        const char* alphabet = protein? kAa: kNa;
+        const SNCBIPackedScoreMatrix* sm = protein? &NCBISM_Blosum62: 0;
+        for (int esf = 0; esf < 16; ++esf) {
+            string seq1 = s_RandomSeq(rnd, rnd.GetRand(100, 400), alphabet);
+            string seq2 = s_RandomSeq(rnd, rnd.GetRand(0, 50), alphabet) +
+                s_Mutate(rnd, seq1, alphabet) +
+                s_RandomSeq(rnd, rnd.GetRand(0, 50), alphabet);
+            bool l1 = (esf & 1) != 0, r1 = (esf & 2) != 0;
+            bool l2 = (esf & 4) != 0, r2 = (esf & 8) != 0;
+
+            CNWAligner nw (seq1, seq2, sm);
+            nw.SetEndSpaceFree(l1, r1, l2, r2);
+            CMMAligner mm (seq1, seq2, sm);
+            mm.SetEndSpaceFree(l1, r1, l2, r2);
+
+            TScore score = nw.Run();
+            BOOST_CHECK_EQUAL(mm.Run(), score);
+            // rescoring does not follow where CMMAligner puts free end
+            // gaps, so the transcript is only checked without them
+            if (esf == 0) {
+                BOOST_CHECK_EQUAL(mm.ScoreFromTranscript
+                                  (mm.GetTranscript(false), 0, 0), score);
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(MMAlignerTermination)
+{
+    CRandom rnd (5);
+    string seq1 = s_RandomSeq(rnd, 1000, kNa);
+    string seq2 = s_Mutate(rnd, seq1, kNa);
+
+    size_t calls = 0;
+    CMMAligner mm (seq1, seq2);
+    mm.SetProgressCallback(s_StopAfterStart, &calls);
+    BOOST_CHECK_EQUAL(mm.Run(), TScore(0));
+    // the start of the run and the first report of the pass
+    BOOST_CHECK_EQUAL(calls, size_t(2));
+}
@@ -157,6 +157,7 @@ CLookupTableOptions::DebugDump(CDebugDumpContext ddc, unsigned int /*depth*/) co
     ddc.Log("word_size", m_Ptr->word_size);
     ddc.Log("mb_template_length", m_Ptr->mb_template_length);
     ddc.Log("mb_template_type", m_Ptr->mb_template_type);
+    ddc.Log("mb_compact_backbone", m_Ptr->mb_compact_backbone);
 }
 
 void
@@ -32,6 +32,7 @@
 
 #include <ncbi_pch.hpp>
 #include "blast_aux_priv.hpp"
+#include <corelib/ncbitime.hpp>
 #include <algo/blast/core/blast_seqsrc.h>
 #include <algo/blast/core/blast_query_info.h>
 #include <algo/blast/core/blast_hspstream.h>
@@ -202,8 +203,17 @@ BlastSetupPreliminarySearchEx(CRef<IQueryFactory> qf,
         SetUpDbIndexCallbacks();
     }
 
-    // 5. Create the lookup table
+    // 5. Create diagnostics
+    BlastDiagnostics* diags = is_multi_threaded
+        ? CSetupFactory::CreateDiagnosticsStructureMT()
+        : CSetupFactory::CreateDiagnosticsStructure();
+    retval->m_InternalData->m_Diagnostics.Reset
+        (new TBlastDiagnostics(diags, Blast_DiagnosticsFree));
+
+    // 6. Create the lookup table
     if ( !retval->m_QuerySplitter->IsQuerySplit() ) {
+        CStopWatch sw(CStopWatch::eStart);
+        double cpu_start = Blast_DiagnosticsCpuTimer();
         LookupTableWrap* lut =
             CSetupFactory::CreateLookupTable(query_data, opts_memento.get(),
                                              sbp, lookup_segments_wrap,
@@ -211,15 +221,12 @@ BlastSetupPreliminarySearchEx(CRef<IQueryFactory> qf,
                                              seqsrc);
         retval->m_InternalData->m_LookupTable.Reset
             (new TLookupTableWrap(lut, LookupTableWrapFree));
+        if (Blast_DiagnosticsGetStageTiming()) {
+            diags->lookup_time += sw.Elapsed();
+            diags->lookup_cpu_time += Blast_DiagnosticsCpuTimer() - cpu_start;
+        }
     }
 
-    // 6. Create diagnostics
-    BlastDiagnostics* diags = is_multi_threaded
-        ? CSetupFactory::CreateDiagnosticsStructureMT()
-        : CSetupFactory::CreateDiagnosticsStructure();
-    retval->m_InternalData->m_Diagnostics.Reset
-        (new TBlastDiagnostics(diags, Blast_DiagnosticsFree));
-
     // 7. Create the HSP stream
     BlastHSPStream* hsp_stream = 
         CSetupFactory::CreateHspStream(opts_memento.get(),
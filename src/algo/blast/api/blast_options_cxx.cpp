@@ -954,6 +954,23 @@ CBlastOptions::SetMBTemplateType(unsigned char type)
     }
 }
 
+bool
+CBlastOptions::GetMBCompactBackbone() const
+{
+    if (! m_Local) {
+        x_Throwx("Error: GetMBCompactBackbone() not available.");
+    }
+    return m_Local->GetMBCompactBackbone();
+}
+
+void
+CBlastOptions::SetMBCompactBackbone(bool compact)
+{
+    if (m_Local) {
+        m_Local->SetMBCompactBackbone(compact);
+    }
+}
+
 /******************* Query setup options ************************/
 
 void
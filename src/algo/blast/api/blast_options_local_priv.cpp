@@ -450,6 +450,7 @@ x_LookupTableOptions_cmp(const LookupTableOptions* a,
     if (a->word_size != b->word_size) return false;
     if (a->mb_template_length != b->mb_template_length) return false;
     if (a->mb_template_type != b->mb_template_type) return false;
+    if (a->mb_compact_backbone != b->mb_compact_backbone) return false;
     if (x_safe_strcmp(a->phi_pattern, b->phi_pattern) != 0) return false;
     return true;
 }
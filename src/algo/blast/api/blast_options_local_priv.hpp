@@ -94,6 +94,9 @@ public:
     unsigned char GetMBTemplateType() const;
     void SetMBTemplateType(unsigned char type);
 
+    bool GetMBCompactBackbone() const;
+    void SetMBCompactBackbone(bool compact = true);
+
     /******************* Query setup options ************************/
     char* GetFilterString() const;
     void SetFilterString(const char* f);
@@ -596,6 +599,18 @@ CBlastOptionsLocal::SetMBTemplateType(unsigned char type)
     m_LutOpts->mb_template_type = type;
 }
 
+inline bool
+CBlastOptionsLocal::GetMBCompactBackbone() const
+{
+    return m_LutOpts->mb_compact_backbone ? true : false;
+}
+
+inline void
+CBlastOptionsLocal::SetMBCompactBackbone(bool compact)
+{
+    m_LutOpts->mb_compact_backbone = compact;
+}
+
 /******************* Query setup options ************************/
 
 inline char*
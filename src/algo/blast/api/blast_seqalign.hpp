@@ -127,6 +127,33 @@ LocalBlastResults2SeqAlign(BlastHSPResults   * hsp_results,
                            vector<TSeqLocInfoVector>& subj_masks,
                            EResultType         result_type = eDatabaseSearch);
 
+/// Convert the traceback results for one query into Seq-aligns.
+/// @param hit_list
+///   Results of a traceback search for this query; may be NULL. [in]
+/// @param prog
+///   The type of search done. [in]
+/// @param query_loc
+///   The query sequence. [in]
+/// @param query_length
+///   Length of the query sequence. [in]
+/// @param seqinfo_src
+///   Provides sequence identifiers and meta-data. [in]
+/// @param is_gapped
+///   True if this was a gapped search. [in]
+/// @param is_ooframe
+///   True if out-of-frame matches are allowed. [in]
+/// @param subj_masks
+///   Subject masks that intersect the HSPs are appended here. [in|out]
+CRef<CSeq_align_set>
+BlastHitList2SeqAlign_OMF(const BlastHitList     * hit_list,
+                          EBlastProgramType        prog,
+                          const CSeq_loc         & query_loc,
+                          TSeqPos                  query_length,
+                          const IBlastSeqInfoSrc * seqinfo_src,
+                          bool                     is_gapped,
+                          bool                     is_ooframe,
+                          TSeqLocInfoVector      & subj_masks);
+
 // Convert PrelminSearch Output to CStdseg
 //
 // This converts the BlatsHitsLists for a query into a list of CStd_seg
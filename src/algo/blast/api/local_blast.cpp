@@ -222,6 +222,38 @@ CLocalBlast::Run()
          return result_set;
     }
     
+    x_InitTracebackSearch();
+    CRef<CSearchResultSet> retval = m_TbackSearch->Run();
+    retval->SetFilteredQueryRegions(m_PrelimSearch->GetFilteredQueryRegions());
+    m_Messages = m_TbackSearch->GetSearchMessages();
+
+    return retval;
+}
+
+void
+CLocalBlast::Run(ISearchResultsHandler& handler)
+{
+    _ASSERT(m_QueryFactory);
+    _ASSERT(m_PrelimSearch);
+    _ASSERT(m_Opts);
+
+    if (m_PrelimSearch->CheckInternalData() != 0) {
+        // The search cannot be run; pass on the empty results
+        CRef<CSearchResultSet> results = Run();
+        NON_CONST_ITERATE(CSearchResultSet, itr, *results) {
+            handler.HandleResults(*itr);
+        }
+        return;
+    }
+
+    x_InitTracebackSearch();
+    m_TbackSearch->Run(handler, m_PrelimSearch->GetFilteredQueryRegions());
+    m_Messages = m_TbackSearch->GetSearchMessages();
+}
+
+void
+CLocalBlast::x_InitTracebackSearch()
+{
 	try {
 	    m_PrelimSearch->SetNumberOfThreads(GetNumberOfThreads());
 	    m_InternalData = m_PrelimSearch->Run();
@@ -267,11 +299,6 @@ CLocalBlast::Run()
         m_TbackSearch->SetResultType(eSequenceComparison);
     }
     m_TbackSearch->SetNumberOfThreads(GetNumberOfThreads());
-    CRef<CSearchResultSet> retval = m_TbackSearch->Run();
-    retval->SetFilteredQueryRegions(m_PrelimSearch->GetFilteredQueryRegions());
-    m_Messages = m_TbackSearch->GetSearchMessages();
-
-    return retval;
 }
 
 Int4 CLocalBlast::GetNumExtensions()
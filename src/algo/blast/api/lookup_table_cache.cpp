@@ -0,0 +1,298 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file lookup_table_cache.cpp
+ * Implements a cache of pre-built lookup tables stored as files
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbifile.hpp>
+#include <algo/blast/api/lookup_table_cache.hpp>
+#include <algo/blast/api/blast_exception.hpp>
+#include <algo/blast/api/blast_aux.hpp>
+
+/** @addtogroup AlgoBlast
+ *
+ * @{
+ */
+
+BEGIN_NCBI_SCOPE
+BEGIN_SCOPE(blast)
+
+const char* CLookupTableCache::kEnvVar = "BLAST_LOOKUP_TABLE_CACHE";
+const string CLookupTableCache::kExtension(".lut");
+const Uint8 CLookupTableCache::kDefaultMaxMappedSize =
+                                            NCBI_CONST_UINT8(1) << 30;
+
+/// Protects the default cache
+DEFINE_STATIC_FAST_MUTEX(s_DefaultCacheMutex);
+/// The default cache
+static CRef<CLookupTableCache> s_DefaultCache;
+/// True once the environment was checked for the default cache
+static bool s_DefaultCacheInitialized = false;
+
+CRef<CLookupTableCache>
+CLookupTableCache::GetDefault()
+{
+    CFastMutexGuard guard(s_DefaultCacheMutex);
+    if ( !s_DefaultCacheInitialized ) {
+        s_DefaultCacheInitialized = true;
+        const char* dir = getenv(kEnvVar);
+        if (dir && *dir) {
+            try { s_DefaultCache.Reset(new CLookupTableCache(dir)); }
+            catch (const CException& e) {
+                ERR_POST(Warning << "Lookup table cache disabled: "
+                                 << e.GetMsg());
+            }
+        }
+    }
+    return s_DefaultCache;
+}
+
+void
+CLookupTableCache::SetDefault(CRef<CLookupTableCache> cache)
+{
+    CFastMutexGuard guard(s_DefaultCacheMutex);
+    s_DefaultCacheInitialized = true;
+    s_DefaultCache = cache;
+}
+
+CLookupTableCache::CLookupTableCache(const string& dir,
+                                     Uint8 max_mapped_size)
+    : m_Dir(CDirEntry::AddTrailingPathSeparator(dir)),
+      m_MaxMappedSize(max_mapped_size),
+      m_MappedSize(0)
+{
+    CDir d(m_Dir);
+    if ( !d.Exists() && !d.CreatePath() ) {
+        NCBI_THROW(CBlastException, eInvalidArgument,
+                   "Cannot create lookup table cache directory " + m_Dir);
+    }
+}
+
+CLookupTableCache::~CLookupTableCache()
+{
+    // lookup tables keep the cache alive, so no file is in use here
+    NON_CONST_ITERATE(TMappingList, itr, m_Mapped) {
+        delete itr->file;
+    }
+}
+
+size_t
+CLookupTableCache::GetNumMapped() const
+{
+    CFastMutexGuard guard(m_Mutex);
+    return m_Mapped.size();
+}
+
+Uint8
+CLookupTableCache::GetMappedSize() const
+{
+    CFastMutexGuard guard(m_Mutex);
+    return m_MappedSize;
+}
+
+string
+CLookupTableCache::x_GetPath(Uint8 hash) const
+{
+    return m_Dir + NStr::UInt8ToString(hash, 0, 16) + kExtension;
+}
+
+void
+CLookupTableCache::x_Unmap(TMappingList::iterator itr)
+{
+    _ASSERT(itr->users == 0);
+    if ( !itr->stale ) {
+        m_Files.erase(itr->hash);
+    }
+    m_MappedSize -= itr->size;
+    delete itr->file;
+    m_Mapped.erase(itr);
+}
+
+void
+CLookupTableCache::x_Trim()
+{
+    TMappingList::iterator itr = m_Mapped.end();
+    while (m_MappedSize > m_MaxMappedSize && itr != m_Mapped.begin()) {
+        --itr;
+        if (itr->users == 0) {
+            x_Unmap(itr++);
+        }
+    }
+}
+
+void
+CLookupTableCache::x_ReleaseImage(const void* image, void* data)
+{
+    CLookupTableCache* cache = static_cast<CLookupTableCache*>(data);
+    cache->x_Release(image);
+    // may destroy the cache
+    cache->RemoveReference();
+}
+
+void
+CLookupTableCache::x_Release(const void* image)
+{
+    CFastMutexGuard guard(m_Mutex);
+    NON_CONST_ITERATE(TMappingList, itr, m_Mapped) {
+        if (itr->file->GetPtr() == image) {
+            _ASSERT(itr->users > 0);
+            if (--itr->users == 0 && itr->stale) {
+                x_Unmap(itr);
+            }
+            break;
+        }
+    }
+    x_Trim();
+}
+
+LookupTableWrap*
+CLookupTableCache::x_Find(const LookupTableKey* key,
+                          BLAST_SequenceBlk* query)
+{
+    CFastMutexGuard guard(m_Mutex);
+
+    TMappingList::iterator mapping;
+    TFileMap::iterator itr = m_Files.find(key->hash);
+    if (itr != m_Files.end()) {
+        mapping = itr->second;
+        m_Mapped.splice(m_Mapped.begin(), m_Mapped, mapping);
+    } else {
+        const string kPath(x_GetPath(key->hash));
+        if ( !CFile(kPath).Exists() ) {
+            return NULL;
+        }
+        SMapping m;
+        try { m.file = new CMemoryFile(kPath); }
+        catch (const CException& e) {
+            ERR_POST(Warning << "Cannot map cached lookup table " << kPath
+                             << ": " << e.GetMsg());
+            return NULL;
+        }
+        m.hash = key->hash;
+        m.size = m.file->GetSize();
+        m.users = 0;
+        m.stale = false;
+        mapping = m_Mapped.insert(m_Mapped.begin(), m);
+        m_Files[key->hash] = mapping;
+        m_MappedSize += m.size;
+    }
+
+    LookupTableWrap* retval = NULL;
+    if (LookupTableWrapFromImage(mapping->file->GetPtr(),
+                                 (Int8)mapping->size, key, query,
+                                 &retval) != 0) {
+        // stale, damaged or a different key with the same hash; it will be
+        // replaced, but stays mapped while other tables use it
+        m_Files.erase(key->hash);
+        mapping->stale = true;
+        if (mapping->users == 0) {
+            x_Unmap(mapping);
+        }
+        return NULL;
+    }
+
+    mapping->users++;
+    retval->image_release = (void*)x_ReleaseImage;
+    retval->image_release_data = this;
+    AddReference();
+    x_Trim();
+    return retval;
+}
+
+void
+CLookupTableCache::x_Save(const LookupTableKey* key,
+                          const LookupTableWrap* lookup_wrap,
+                          const BLAST_SequenceBlk* query)
+{
+    void* image = NULL;
+    Int8 image_size = 0;
+    if (LookupTableImageNew(lookup_wrap, query, key, &image,
+                            &image_size) != 0) {
+        return;
+    }
+    TAutoUint1Ptr image_guard(static_cast<Uint1*>(image));
+
+    // write to a temporary file and rename it, so that other processes
+    // never see an incomplete table
+    const string kPath(x_GetPath(key->hash));
+    const string kTmpPath(CFile::GetTmpNameEx(m_Dir, "lut_"));
+    {
+        CNcbiOfstream out(kTmpPath.c_str(), IOS_BASE::out | IOS_BASE::binary);
+        out.write(static_cast<const char*>(image), image_size);
+        out.close();
+        if (out.fail()) {
+            ERR_POST(Warning << "Cannot write cached lookup table "
+                             << kTmpPath);
+            CFile(kTmpPath).Remove();
+            return;
+        }
+    }
+    if ( !CFile(kTmpPath).Rename(kPath, CFile::fRF_Overwrite) ) {
+        ERR_POST(Warning << "Cannot save cached lookup table " << kPath);
+        CFile(kTmpPath).Remove();
+    }
+}
+
+Int2
+CLookupTableCache::CreateLookupTable(BLAST_SequenceBlk* query,
+                                     const LookupTableOptions* lookup_options,
+                                     const QuerySetUpOptions* query_options,
+                                     BlastSeqLoc* lookup_segments,
+                                     BlastScoreBlk* sbp,
+                                     LookupTableWrap** lookup_wrap_ptr,
+                                     Blast_Message** error_msg)
+{
+    LookupTableKey* key = LookupTableKeyNew(query, lookup_options,
+                                            query_options, lookup_segments,
+                                            sbp);
+    if (key) {
+        *lookup_wrap_ptr = x_Find(key, query);
+        if (*lookup_wrap_ptr) {
+            LookupTableKeyFree(key);
+            if (error_msg) {
+                *error_msg = NULL;
+            }
+            return 0;
+        }
+    }
+
+    Int2 status = LookupTableWrapInit(query, lookup_options, query_options,
+                                      lookup_segments, sbp, lookup_wrap_ptr,
+                                      NULL, error_msg);
+    if (status == 0 && key) {
+        x_Save(key, *lookup_wrap_ptr, query);
+    }
+    LookupTableKeyFree(key);
+    return status;
+}
+
+END_SCOPE(blast)
+END_NCBI_SCOPE
+
+/* @} */
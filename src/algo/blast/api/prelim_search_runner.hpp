@@ -41,11 +41,16 @@
  */
 
 #include <corelib/ncbithr.hpp>                  // for CThread
+#include <corelib/ncbitime.hpp>                 // for CStopWatch
+#if defined(NCBI_OS_UNIX)
+#  include <sys/resource.h>                     // for getrusage
+#endif
 #include <algo/blast/api/setup_factory.hpp>
 #include "blast_memento_priv.hpp"
 
 // CORE BLAST includes
 #include <algo/blast/core/blast_engine.h>
+#include <algo/blast/core/blast_sched.h>
 
 BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(blast)
@@ -108,13 +113,38 @@ private:
 class CPrelimSearchThread : public CThread
 {
 public:
+    /// Constructor
+    /// @param internal_data data shared by all search threads [in]
+    /// @param opts_memento search options [in]
+    /// @param scheduler if not NULL, the subject sequences are taken from
+    /// this scheduler rather than from the chunk iterator of the BlastSeqSrc
+    /// [in]
+    /// @param thread_index index of this thread in the scheduler [in]
+    /// @param hsp_buffer if not empty, HSP lists found by this thread are
+    /// written to this buffer rather than to the shared HSP stream [in]
     CPrelimSearchThread(SInternalData& internal_data,
-                        const CBlastOptionsMemento* opts_memento)
-        : m_InternalData(internal_data), m_OptsMemento(opts_memento)
+                        const CBlastOptionsMemento* opts_memento,
+                        BlastSubjectScheduler* scheduler = NULL,
+                        int thread_index = 0,
+                        CRef<TBlastHSPStream> hsp_buffer =
+                            CRef<TBlastHSPStream>())
+        : m_InternalData(internal_data), m_OptsMemento(opts_memento),
+          m_BusyTime(0.0), m_CpuTime(0.0)
     {
+        if (hsp_buffer.NotEmpty()) {
+            m_InternalData.m_HspStream = hsp_buffer;
+        }
+        // Each thread counts its own hits and stage times, the caller
+        // adds them to the shared diagnostics after joining the thread
+        if (m_InternalData.m_Diagnostics.NotEmpty()) {
+            m_InternalData.m_Diagnostics.Reset
+                (new TBlastDiagnostics(Blast_DiagnosticsInit(),
+                                       Blast_DiagnosticsFree));
+        }
         // The following fields need to be copied to ensure MT-safety
         BlastSeqSrc* seqsrc = 
             BlastSeqSrcCopy(m_InternalData.m_SeqSrc->GetPointer());
+        BlastSeqSrcSetScheduler(seqsrc, scheduler, thread_index);
         m_InternalData.m_SeqSrc.Reset(new TBlastSeqSrc(seqsrc, 
                                                        BlastSeqSrcFree));
         // The progress field must be copied to ensure MT-safety
@@ -125,17 +155,50 @@ public:
         }
     }
 
+    /// Time spent in the search by this thread, in seconds; only valid
+    /// after the thread has been joined
+    double GetBusyTime() const { return m_BusyTime; }
+
+    /// CPU time used by this thread, in seconds (0 if the platform cannot
+    /// report it); only valid after the thread has been joined
+    double GetCpuTime() const { return m_CpuTime; }
+
+    /// Hit counts and stage times of this thread (NULL if the search does
+    /// not collect diagnostics); only valid after the thread has been joined
+    BlastDiagnostics* GetDiagnostics() {
+        return m_InternalData.m_Diagnostics.NotEmpty()
+            ? m_InternalData.m_Diagnostics->GetPointer() : NULL;
+    }
+
 protected:
     virtual ~CPrelimSearchThread(void) {}
 
     virtual void* Main(void) {
-        return (void*) 
-            ((intptr_t) CPrelimSearchRunner(m_InternalData, m_OptsMemento)());
+        CStopWatch sw(CStopWatch::eStart);
+        double cpu_start = x_GetCpuTime();
+        int retval = CPrelimSearchRunner(m_InternalData, m_OptsMemento)();
+        m_BusyTime = sw.Elapsed();
+        m_CpuTime = x_GetCpuTime() - cpu_start;
+        return (void*) ((intptr_t) retval);
     }
 
 private:
+    /// CPU time used so far by the calling thread, in seconds
+    static double x_GetCpuTime() {
+#if defined(NCBI_OS_UNIX)  &&  defined(RUSAGE_THREAD)
+        rusage ruse;
+        if (getrusage(RUSAGE_THREAD, &ruse) == 0) {
+            return ruse.ru_utime.tv_sec + ruse.ru_stime.tv_sec +
+                1.0e-6 * (ruse.ru_utime.tv_usec + ruse.ru_stime.tv_usec);
+        }
+#endif
+        return 0.0;
+    }
+
     SInternalData m_InternalData;
     const CBlastOptionsMemento* m_OptsMemento;
+    double m_BusyTime;
+    double m_CpuTime;
 };
 
 END_SCOPE(blast)
@@ -38,6 +38,7 @@
 #include <algo/blast/api/blast_mtlock.hpp>
 #include <algo/blast/core/blast_hits.h>
 #include <algo/blast/core/blast_stat.h>
+#include <algo/blast/core/blast_sched.h>
 
 #include "prelim_search_runner.hpp"
 #include "blast_aux_priv.hpp"
@@ -135,22 +136,71 @@ int
 CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
 {
     typedef vector< CRef<CPrelimSearchThread> > TBlastThreads;
-    TBlastThreads the_threads(GetNumberOfThreads());
+    const int kNumThreads = static_cast<int>(GetNumberOfThreads());
+    TBlastThreads the_threads(kNumThreads);
 
     auto_ptr<const CBlastOptionsMemento> opts_memento
         (m_Options->CreateSnapshot());
     _TRACE("Launching BLAST with " << GetNumberOfThreads() << " threads");
 
+    // Each thread gets a share of the subject sequences and takes work from
+    // the others once its own share is done, so that all threads stay busy
+    // even if the subject lengths are very uneven. Subject sequences much
+    // longer than a chunk are split into pieces searched by all threads.
+    vector<MT_LOCK> locks(kNumThreads + 1);
+    for (int i = 0; i <= kNumThreads; i++) {
+        locks[i] = Blast_CMT_LOCKInit();
+    }
+    const Int4 kPieceLength =
+        Blast_SubjectCanBeSplit(opts_memento->m_ProgramType,
+                                opts_memento->m_ScoringOpts,
+                                opts_memento->m_HitSaveOpts)
+        ? BLAST_SUBJECT_PIECE_LEN : 0;
+    CStructWrapper<BlastSubjectScheduler> scheduler
+        (BlastSubjectSchedulerNew(internal_data.m_SeqSrc->GetPointer(),
+                                  kNumThreads, &locks[0], kPieceLength),
+         BlastSubjectSchedulerFree);
+    if (scheduler.GetPointer() == NULL) {
+        NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                   "Failed to create subject scheduler");
+    }
+
+    // Each thread writes its HSP lists to a buffer of its own, so that the
+    // threads never wait for each other to save results. The buffers drop
+    // the HSP lists the collector can't save as they fill up, and are
+    // merged into the shared stream once all threads are done. This is not
+    // possible if the search uses the hits saved so far to raise the score
+    // cutoff as it goes, or if the writer (e.g. culling) needs to see all
+    // HSP lists.
+    BlastHSPStream* hsp_stream = internal_data.m_HspStream->GetPointer();
+    vector< CRef<TBlastHSPStream> > hsp_buffers(kNumThreads);
+    vector<BlastHSPStream*> hsp_buffer_ptrs;
+    if (opts_memento->m_HitSaveOpts->low_score_perc <= 0.00001 &&
+        BlastHSPStreamCanUseThreadBuffers(hsp_stream)) {
+        for (int i = 0; i < kNumThreads; i++) {
+            BlastHSPStream* buffer = BlastHSPStreamNewThreadBuffer(hsp_stream);
+            if (buffer == NULL) {
+                NCBI_THROW(CBlastSystemException, eOutOfMemory,
+                           "Failed to create HSP buffer");
+            }
+            hsp_buffers[i].Reset(new TBlastHSPStream(buffer,
+                                                     BlastHSPStreamFree));
+            hsp_buffer_ptrs.push_back(buffer);
+        }
+    }
+
     // -RMH- This appears to be a problem right now.  When used...this
     // can cause all the work to go to a single thread!  (-MN- This is fixed in SB-768)
     BlastSeqSrcSetNumberOfThreads(m_InternalData->m_SeqSrc->GetPointer(), 
                                   GetNumberOfThreads());
 
     // Create the threads ...
-    NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
-        thread->Reset(new CPrelimSearchThread(internal_data,
-                                              opts_memento.get()));
-        if (thread->Empty()) {
+    for (int i = 0; i < kNumThreads; i++) {
+        the_threads[i].Reset(new CPrelimSearchThread(internal_data,
+                                                     opts_memento.get(),
+                                                     scheduler.GetPointer(),
+                                                     i, hsp_buffers[i]));
+        if (the_threads[i].Empty()) {
             NCBI_THROW(CBlastSystemException, eOutOfMemory,
                        "Failed to create preliminary search thread");
         }
@@ -162,6 +212,7 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
     GetDbIndexSetNumThreadsFn()( GetNumberOfThreads() );
 
     // ... launch the threads ...
+    CStopWatch sw(CStopWatch::eStart);
     NON_CONST_ITERATE(TBlastThreads, thread, the_threads) {
         (*thread)->Run();
     }
@@ -177,9 +228,45 @@ CBlastPrelimSearch::x_LaunchMultiThreadedSearch(SInternalData& internal_data)
             retv = reinterpret_cast<Uint8> (result);
         }
     }
+    const double kElapsed = sw.Elapsed();
 
     BlastSeqSrcSetNumberOfThreads(m_InternalData->m_SeqSrc->GetPointer(), 0);
 
+    // Single reduction step: the buffered HSP lists are passed to the writer
+    // of the shared stream in the order of a single-threaded search
+    if ( !hsp_buffer_ptrs.empty() &&
+         BlastHSPStreamMergeThreadBuffers(hsp_stream, &hsp_buffer_ptrs[0],
+                                          kNumThreads)
+         != kBlastHSPStream_Success && !retv) {
+        NCBI_THROW(CBlastException, eCoreBlastError,
+                   "Failed to merge HSP buffers of the search threads");
+    }
+
+    // Record how the work was spread over the threads
+    if (m_InternalData->m_Diagnostics.NotEmpty()) {
+        BlastDiagnostics* diags = m_InternalData->m_Diagnostics->GetPointer();
+        vector<BlastThreadStats> thread_stats(kNumThreads);
+        for (int i = 0; i < kNumThreads; i++) {
+            BlastSubjectSchedulerGetThreadStats(scheduler.GetPointer(), i,
+                                                &thread_stats[i]);
+            thread_stats[i].busy_time = the_threads[i]->GetBusyTime();
+            thread_stats[i].idle_time =
+                max(0.0, kElapsed - thread_stats[i].busy_time);
+            thread_stats[i].cpu_time = the_threads[i]->GetCpuTime();
+
+            BlastDiagnostics* local = the_threads[i]->GetDiagnostics();
+            if (local) {
+                thread_stats[i].scan_time = local->ungapped_stat->scan_time;
+                thread_stats[i].ungapped_time =
+                    local->ungapped_stat->extension_time;
+                thread_stats[i].gapped_time =
+                    local->gapped_stat->extension_time;
+                Blast_DiagnosticsUpdate(diags, local);
+            }
+        }
+        Blast_DiagnosticsAddThreadStats(diags, &thread_stats[0], kNumThreads);
+    }
+
     if (retv) {
           NCBI_THROW(CBlastException, eCoreBlastError,
                                    BlastErrorCode2String((Int2)retv));
@@ -53,7 +53,9 @@ USING_SCOPE(blast);
 struct SSeqDB_SeqSrc_Data {
     /// Constructor.
     SSeqDB_SeqSrc_Data()
-        : copied(false)
+        : copied(false),
+          expand_lent(false),
+          ranges_oid(-1)
     {
     }
     
@@ -63,7 +65,9 @@ struct SSeqDB_SeqSrc_Data {
           mask_algo_id(id),
           mask_type(type),
           copied(false),
-          isProtein(seqdb->GetSequenceType() == CSeqDB::eProtein)
+          isProtein(seqdb->GetSequenceType() == CSeqDB::eProtein),
+          expand_lent(false),
+          ranges_oid(-1)
     {
     }
     
@@ -95,6 +99,19 @@ struct SSeqDB_SeqSrc_Data {
     ESubjectMaskingType mask_type;
     bool copied;
     bool isProtein;
+
+    /// View of the packed data of the subject being expanded, reused for
+    /// every subject.
+    CRef<CSeqDBSeqView> view;
+
+    /// Buffer the subjects are expanded into, reused for every subject.
+    vector<char> expand_buf;
+
+    /// True while expand_buf holds a subject that has not been released.
+    bool expand_lent;
+
+    /// OID of the subject partial fetching ranges were last set for.
+    int ranges_oid;
     
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
@@ -269,8 +286,11 @@ s_SeqDbSetRanges(void* seqdb_handle, BlastSeqSrcSetRangesArg* args)
 {
     if (!seqdb_handle || !args) return;
 
-    CSeqDB & seqdb = **(TSeqDBData *) seqdb_handle;
+    TSeqDBData * datap = (TSeqDBData *) seqdb_handle;
+    CSeqDB & seqdb = **datap;
         
+    datap->ranges_oid = args->oid;
+
     CSeqDB::TRangeList ranges;
     for (int i=0; i< args->num_ranges; ++i) {
         ranges.insert(pair<int,int> (args->ranges[i*2], args->ranges[i*2+1]));
@@ -332,14 +352,79 @@ s_SeqDbGetSequence(void* seqdb_handle, BlastSeqSrcGetSeqArg* args)
     has_sentinel_byte = (args->encoding == eBlastEncodingNucleotide);
     
     /* free buffers if necessary */
-    if (args->seq) BlastSequenceBlkClean(args->seq);
+    if (args->seq) {
+        if (datap->expand_lent && args->seq->sequence_start ==
+            (Uint1*) &datap->expand_buf[0]) {
+            datap->expand_lent = false;
+        }
+        BlastSequenceBlkClean(args->seq);
+    }
     
     /* This occurs if the pre-selected partial sequence in the traceback stage
      * was too small to perform the traceback. Only do this for nucleotide
      * sequences as proteins are not long enough to be of significance */
-    if (args->reset_ranges && datap->isProtein == false)
+    if (args->reset_ranges && datap->isProtein == false) {
         seqdb.RemoveOffsetRanges(oid);
+        if (datap->ranges_oid == oid) {
+            datap->ranges_oid = -1;
+        }
+    }
     
+    /* A subject that has to be expanded goes into a buffer reused for all
+       subjects, from a view of the packed data in the database, so that
+       nothing is allocated per subject.  If the buffer still holds another
+       subject, or ranges were set for partial fetching of this one,
+       CSeqDB expands it into newly allocated memory instead. */
+    if (datap->copied && !datap->expand_lent && datap->ranges_oid != oid) {
+        if (datap->view.Empty()) {
+            datap->view.Reset(new CSeqDBSeqView);
+        }
+        seqdb.GetSeqView(oid, *datap->view);
+        len = datap->view->GetLength();
+        if (len <= 0) {
+            datap->view->Release();
+            return BLAST_SEQSRC_ERROR;
+        }
+
+        size_t size = len + (has_sentinel_byte ? 2 : 0);
+        if (datap->expand_buf.size() < size) {
+            datap->expand_buf.resize(size);
+        }
+        char* buf = &datap->expand_buf[0];
+
+        datap->view->Expand(buf, 
+                            has_sentinel_byte ? kSeqDBNuclBlastNA8 
+                                              : kSeqDBNuclNcbiNA8,
+                            (datap->mask_type == eHardSubjMasking) ?
+                                &(datap->seq_ranges) : NULL);
+        datap->view->Release();
+        if (datap->mask_type == eHardSubjMasking) {
+            datap->seq_ranges.clear();
+        }
+
+        BlastSetUp_SeqBlkNew((Uint1*)buf, len, &args->seq, FALSE);
+        args->seq->sequence_start = args->seq->sequence_start_nomask =
+            (Uint1*) buf;
+        if (has_sentinel_byte) {
+            args->seq->sequence = args->seq->sequence_nomask = 
+                (Uint1*) buf + 1;
+        }
+        datap->expand_lent = true;
+        args->seq->oid = oid;
+
+#if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
+     (!defined(NCBI_COMPILER_MIPSPRO)) )
+        if (datap->mask_type != eNoSubjMasking) {
+            if (BlastSeqBlkSetSeqRanges(args->seq, 
+                                (SSeqRange*) datap->seq_ranges.get_data(),
+                                datap->seq_ranges.size() + 1, false, datap->mask_type) != 0) {
+                return BLAST_SEQSRC_ERROR;
+            }
+        }
+#endif
+        return BLAST_SEQSRC_SUCCESS;
+    }
+
     const char *buf;
     len = (datap->copied) 
            /* This will consume and clear datap->seq_ranges */
@@ -400,6 +485,14 @@ s_SeqDbReleaseSequence(void* seqdb_handle, BlastSeqSrcGetSeqArg* args)
     _ASSERT(args);
     _ASSERT(args->seq);
 
+    if (datap->expand_lent && 
+        args->seq->sequence_start == (Uint1*) &datap->expand_buf[0]) {
+        // the subject was expanded into the reusable buffer
+        datap->expand_lent = false;
+        args->seq->sequence_start = NULL;
+        args->seq->sequence = NULL;
+        return;
+    }
     if (args->seq->sequence_start_allocated) {
         ASSERT (datap->copied);
         sfree(args->seq->sequence_start);
@@ -38,6 +38,7 @@
 #include <algo/blast/api/seqsrc_seqdb.hpp>      // for SeqDbBlastSeqSrcInit
 #include <algo/blast/api/blast_mtlock.hpp>      // for Blast_DiagnosticsInitMT
 #include <algo/blast/api/blast_dbindex.hpp>
+#include <algo/blast/api/lookup_table_cache.hpp>
 
 #include "blast_aux_priv.hpp"
 #include "blast_memento_priv.hpp"
@@ -208,14 +209,31 @@ CSetupFactory::CreateLookupTable(CRef<ILocalQueryData> query_data,
 
     BlastSeqLoc * lookup_segments = lookup_segments_wrap->getLocs();
 
-    Int2 status = LookupTableWrapInit(queries,
-                                      opts_memento->m_LutOpts,
-                                      opts_memento->m_QueryOpts,
-                                      lookup_segments,
-                                      score_blk,
-                                      &retval,
-                                      rps_info ? (*rps_info)() : 0,
-                                      &blast_msg);
+    // RPS-BLAST lookup tables are already memory mapped
+    CRef<CLookupTableCache> lut_cache;
+    if ( !rps_info ) {
+        lut_cache = CLookupTableCache::GetDefault();
+    }
+
+    Int2 status = 0;
+    if (lut_cache.NotEmpty()) {
+        status = lut_cache->CreateLookupTable(queries,
+                                              opts_memento->m_LutOpts,
+                                              opts_memento->m_QueryOpts,
+                                              lookup_segments,
+                                              score_blk,
+                                              &retval,
+                                              &blast_msg);
+    } else {
+        status = LookupTableWrapInit(queries,
+                                     opts_memento->m_LutOpts,
+                                     opts_memento->m_QueryOpts,
+                                     lookup_segments,
+                                     score_blk,
+                                     &retval,
+                                     rps_info ? (*rps_info)() : 0,
+                                     &blast_msg);
+    }
     if (status != 0) {
          TSearchMessages search_messages;
          Blast_Message2TSearchMessages(blast_msg.Get(), 
@@ -292,6 +292,96 @@ CBlastTracebackSearch::Run()
                                      m_ResultType);
 }
 
+void
+CBlastTracebackSearch::Run(ISearchResultsHandler& handler,
+                           const TSeqLocInfoVector& query_masks)
+{
+    _ASSERT(m_OptsMemento);
+    _ASSERT(m_SeqInfoSrc);
+    _ASSERT(m_QueryFactory);
+
+    // RunSimple keeps the larger hit list size used for PSI-BLAST
+    int hitlist_size_backup = m_OptsMemento->m_HitSaveOpts->hitlist_size;
+    CRef< CStructWrapper<BlastHSPResults> >
+        HspResults(WrapStruct(RunSimple(), Blast_HSPResultsFree));
+    m_OptsMemento->m_HitSaveOpts->hitlist_size = hitlist_size_backup;
+    BlastHSPResults* hsp_results = HspResults->GetPointer();
+
+    const EBlastProgramType kProgram = m_OptsMemento->m_ProgramType;
+    CRef<ILocalQueryData> qdata = m_QueryFactory->MakeLocalQueryData(m_Options);
+    vector< CConstRef<CSeq_id> > query_ids;
+    query_ids.reserve(qdata->GetNumQueries());
+    for (size_t i = 0; i < qdata->GetNumQueries(); i++) {
+        query_ids.push_back(CConstRef<CSeq_id>(qdata->GetSeq_loc(i)->GetId()));
+    }
+    
+    m_SeqInfoSrc->GarbageCollect();
+
+    if (Blast_ProgramIsPhiBlast(kProgram) || m_ResultType != eDatabaseSearch
+        || !hsp_results) {
+        // Results are not arranged by query; convert them all at once
+        vector<TSeqLocInfoVector> subj_masks;
+        TSeqAlignVector aligns =
+            LocalBlastResults2SeqAlign(hsp_results,
+                                       *qdata,
+                                       *m_SeqInfoSrc,
+                                       kProgram,
+                                       m_Options->GetGappedMode(),
+                                       m_Options->GetOutOfFrameMode(),
+                                       subj_masks,
+                                       m_ResultType);
+        CRef<CSearchResultSet> results =
+            BlastBuildSearchResultSet(query_ids,
+                                      m_InternalData->m_ScoreBlk->GetPointer(),
+                                      m_InternalData->m_QueryInfo,
+                                      kProgram,
+                                      aligns,
+                                      m_Messages,
+                                      subj_masks,
+                                      NULL,
+                                      m_ResultType);
+        results->SetFilteredQueryRegions(query_masks);
+        NON_CONST_ITERATE(CSearchResultSet, itr, *results) {
+            handler.HandleResults(*itr);
+        }
+        return;
+    }
+
+    _ASSERT(hsp_results->num_queries == (int)qdata->GetNumQueries());
+    if (m_Messages.size() < query_ids.size()) {
+        m_Messages.resize(query_ids.size());
+    }
+    for (int index = 0; index < hsp_results->num_queries; index++) {
+        TSeqLocInfoVector subj_masks;
+        CRef<CSeq_align_set> aligns =
+            BlastHitList2SeqAlign_OMF(hsp_results->hitlist_array[index],
+                                      kProgram,
+                                      *qdata->GetSeq_loc(index),
+                                      qdata->GetSeqLength(index),
+                                      m_SeqInfoSrc,
+                                      m_Options->GetGappedMode(),
+                                      m_Options->GetOutOfFrameMode(),
+                                      subj_masks);
+        // the Seq-aligns now hold everything needed from this hit list
+        hsp_results->hitlist_array[index] =
+            Blast_HitListFree(hsp_results->hitlist_array[index]);
+
+        CRef<CBlastAncillaryData> ancillary_data
+            (new CBlastAncillaryData(kProgram, index,
+                                     m_InternalData->m_ScoreBlk->GetPointer(),
+                                     m_InternalData->m_QueryInfo));
+        CRef<CSearchResults> results(new CSearchResults(query_ids[index],
+                                                        aligns,
+                                                        m_Messages[index],
+                                                        ancillary_data));
+        if ((size_t)index < query_masks.size()) {
+            results->SetMaskedQueryRegions(query_masks[index]);
+        }
+        results->SetSubjectMasks(subj_masks);
+        handler.HandleResults(results);
+    }
+}
+
 BlastHSPResults*
 CBlastTracebackSearch::RunSimple()
 {
@@ -34,6 +34,7 @@
 #include <ncbi_pch.hpp>
 #include <algo/blast/blastinput/blast_input_aux.hpp>
 #include <algo/blast/api/blast_exception.hpp>
+#include <algo/blast/core/blast_nalookup.h>
 #include <serial/iterator.hpp>  // for CTypeConstIterator
 /* for CBlastFastaInputSource */
 #include <algo/blast/blastinput/blast_fasta_input.hpp>  
@@ -206,6 +207,25 @@ ParseSequenceRangeOpenEnd(const string& range_str,
     return retval;
 }
 
+int
+GetCacheAwareQueryBatchSize(const CBlastOptions& options, Uint8 cache_size)
+{
+    LookupTableOptions lookup_options;
+    memset(&lookup_options, 0, sizeof(lookup_options));
+    lookup_options.word_size = options.GetWordSize();
+    lookup_options.mb_template_length = options.GetMBTemplateLength();
+    lookup_options.mb_compact_backbone = options.GetMBCompactBackbone();
+
+    Int8 max_footprint = (Int8)min(cache_size, (Uint8)kMax_I8);
+    Int4 max_entries = BlastMBLookupTableMaxEntries(&lookup_options,
+                                                    max_footprint);
+
+    // both strands of every query are entered in the lookup table
+    int retval = max(max_entries / 2, 1);
+    _TRACE("Using cache-aware query batch size " << retval);
+    return retval;
+}
+
 CRef<CScope>
 ReadSequencesToBlast(CNcbiIstream& in, 
                      bool read_proteins, 
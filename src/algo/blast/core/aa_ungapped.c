@@ -32,6 +32,7 @@
 #include <algo/blast/core/blast_aalookup.h>
 #include <algo/blast/core/blast_aascan.h>
 #include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_simd.h>
 
 /** Scan a subject sequence for word hits and trigger two-hit extensions.
  *
@@ -467,6 +468,9 @@ s_BlastAaWordFinder_TwoHit(const BLAST_SequenceBlk * subject,
     BLAST_DiagTable * diag = ewp->diag_table;
     TAaScanSubjectFunction scansub;
     Int4 scan_range[3];
+    const Boolean kTimed = ungapped_stats && Blast_DiagnosticsGetStageTiming();
+    double scan_start = 0.0;
+    double scan_cpu_start = 0.0;
 
     ASSERT(diag != NULL);
 
@@ -501,8 +505,17 @@ s_BlastAaWordFinder_TwoHit(const BLAST_SequenceBlk * subject,
 
     while (scan_range[1] <= scan_range[2]) {
         /* scan the subject sequence for hits */
+        if (kTimed) {
+            scan_start = Blast_DiagnosticsTimer();
+            scan_cpu_start = Blast_DiagnosticsCpuTimer();
+        }
         hits = scansub(lookup_wrap, subject, 
                                   offset_pairs, array_size, scan_range);
+        if (kTimed) {
+            ungapped_stats->scan_time += Blast_DiagnosticsTimer() - scan_start;
+            ungapped_stats->scan_cpu_time +=
+                Blast_DiagnosticsCpuTimer() - scan_cpu_start;
+        }
 
         totalhits += hits;
         /* for each hit, */
@@ -736,6 +749,9 @@ s_BlastAaWordFinder_OneHit(const BLAST_SequenceBlk * subject,
     BLAST_DiagTable * diag = ewp->diag_table;
     TAaScanSubjectFunction scansub;
     Int4 scan_range[3];
+    const Boolean kTimed = ungapped_stats && Blast_DiagnosticsGetStageTiming();
+    double scan_start = 0.0;
+    double scan_cpu_start = 0.0;
 
     ASSERT(diag != NULL);
 
@@ -765,8 +781,17 @@ s_BlastAaWordFinder_OneHit(const BLAST_SequenceBlk * subject,
 
     while (scan_range[1] <= scan_range[2]) {
         /* scan the subject sequence for hits */
+        if (kTimed) {
+            scan_start = Blast_DiagnosticsTimer();
+            scan_cpu_start = Blast_DiagnosticsCpuTimer();
+        }
         hits = scansub(lookup_wrap, subject,
                        offset_pairs, array_size, scan_range);
+        if (kTimed) {
+            ungapped_stats->scan_time += Blast_DiagnosticsTimer() - scan_start;
+            ungapped_stats->scan_cpu_time +=
+                Blast_DiagnosticsCpuTimer() - scan_cpu_start;
+        }
 
         totalhits += hits;
         /* for each hit, */
@@ -843,6 +868,31 @@ static Int4 s_BlastAaExtendRight(Int4 ** matrix,
     s = subject->sequence + s_off;
     q = query->sequence + q_off;
 
+    if (BlastSimdGetLevel() != eBlastSimdNone) {
+        Int4 scores[BLAST_SIMD_XDROP_BLOCK];
+        Int4 k, num, stop, best;
+
+        for (i = 0; i < n; i += num) {
+            num = MIN(BLAST_SIMD_XDROP_BLOCK, n - i);
+            for (k = 0; k < num; k++)
+                scores[k] = matrix[q[i + k]][s[i + k]];
+
+            best = -1;
+            stop = BlastSimdXDropScan(scores, num, dropoff, TRUE,
+                                      &score, &maxscore, &best);
+            if (best >= 0)
+                best_i = i + best;
+            if (stop < num) {
+                i += stop;
+                break;
+            }
+        }
+
+        *length = best_i + 1;
+        *s_last_off = s_off + i;
+        return maxscore;
+    }
+
     for (i = 0; i < n; i++) {
         score += matrix[q[i]][s[i]];
 
@@ -900,6 +950,28 @@ static Int4 s_BlastAaExtendLeft(Int4 ** matrix,
     s = subject->sequence + s_off - n;
     q = query->sequence + q_off - n;
 
+    if (BlastSimdGetLevel() != eBlastSimdNone) {
+        Int4 scores[BLAST_SIMD_XDROP_BLOCK];
+        Int4 k, num, stop, best;
+
+        for (i = n; i >= 0; i -= num) {
+            num = MIN(BLAST_SIMD_XDROP_BLOCK, i + 1);
+            for (k = 0; k < num; k++)
+                scores[k] = matrix[q[i - k]][s[i - k]];
+
+            best = -1;
+            stop = BlastSimdXDropScan(scores, num, dropoff, FALSE,
+                                      &score, &maxscore, &best);
+            if (best >= 0)
+                best_i = i - best;
+            if (stop < num)
+                break;
+        }
+
+        *length = n - best_i + 1;
+        return maxscore;
+    }
+
     for (i = n; i >= 0; i--) {
         score += matrix[q[i]][s[i]];
 
@@ -948,6 +1020,31 @@ static Int4 s_BlastPSSMExtendRight(Int4 ** matrix,
     n = MIN(subject->length - s_off, query_size - q_off);
     s = subject->sequence + s_off;
 
+    if (BlastSimdGetLevel() != eBlastSimdNone) {
+        Int4 scores[BLAST_SIMD_XDROP_BLOCK];
+        Int4 k, num, stop, best;
+
+        for (i = 0; i < n; i += num) {
+            num = MIN(BLAST_SIMD_XDROP_BLOCK, n - i);
+            for (k = 0; k < num; k++)
+                scores[k] = matrix[q_off + i + k][s[i + k]];
+
+            best = -1;
+            stop = BlastSimdXDropScan(scores, num, dropoff, TRUE,
+                                      &score, &maxscore, &best);
+            if (best >= 0)
+                best_i = i + best;
+            if (stop < num) {
+                i += stop;
+                break;
+            }
+        }
+
+        *length = best_i + 1;
+        *s_last_off = s_off + i;
+        return maxscore;
+    }
+
     for (i = 0; i < n; i++) {
         score += matrix[q_off + i][s[i]];
 
@@ -996,6 +1093,28 @@ static Int4 s_BlastPSSMExtendLeft(Int4 ** matrix,
     best_i = n + 1;
     s = subject->sequence + s_off - n;
 
+    if (BlastSimdGetLevel() != eBlastSimdNone) {
+        Int4 scores[BLAST_SIMD_XDROP_BLOCK];
+        Int4 k, num, stop, best;
+
+        for (i = n; i >= 0; i -= num) {
+            num = MIN(BLAST_SIMD_XDROP_BLOCK, i + 1);
+            for (k = 0; k < num; k++)
+                scores[k] = matrix[q_off - n + i - k][s[i - k]];
+
+            best = -1;
+            stop = BlastSimdXDropScan(scores, num, dropoff, FALSE,
+                                      &score, &maxscore, &best);
+            if (best >= 0)
+                best_i = i - best;
+            if (stop < num)
+                break;
+        }
+
+        *length = n - best_i + 1;
+        return maxscore;
+    }
+
     for (i = n; i >= 0; i--) {
         score += matrix[q_off - n + i][s[i]];
 
@@ -34,6 +34,10 @@
 
 #include <algo/blast/core/blast_diagnostics.h>
 #include <algo/blast/core/blast_def.h>
+#include <time.h>
+
+/** Set by Blast_DiagnosticsSetStageTiming */
+static volatile Boolean s_StageTiming = FALSE;
 
 BlastDiagnostics* Blast_DiagnosticsFree(BlastDiagnostics* diagnostics)
 {
@@ -41,6 +45,7 @@ BlastDiagnostics* Blast_DiagnosticsFree(BlastDiagnostics* diagnostics)
       sfree(diagnostics->ungapped_stat);
       sfree(diagnostics->gapped_stat);
       sfree(diagnostics->cutoffs);
+      sfree(diagnostics->thread_stat);
       if (diagnostics->mt_lock)
          diagnostics->mt_lock = MT_LOCK_Delete(diagnostics->mt_lock);
       sfree(diagnostics);
@@ -73,6 +78,12 @@ BlastDiagnostics* Blast_DiagnosticsCopy(const BlastDiagnostics* diagnostics)
     } else {
       sfree(diagnostics->cutoffs);
     }
+    if (diagnostics->thread_stat) {
+        Blast_DiagnosticsAddThreadStats(retval, diagnostics->thread_stat,
+                                        diagnostics->num_threads);
+    }
+    retval->lookup_time = diagnostics->lookup_time;
+    retval->lookup_cpu_time = diagnostics->lookup_cpu_time;
     return retval;
 }
 
@@ -134,6 +145,14 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
          local->ungapped_stat->good_init_extends;
       global->ungapped_stat->num_seqs_passed += 
          local->ungapped_stat->num_seqs_passed;
+      global->ungapped_stat->scan_time += 
+         local->ungapped_stat->scan_time;
+      global->ungapped_stat->extension_time += 
+         local->ungapped_stat->extension_time;
+      global->ungapped_stat->scan_cpu_time += 
+         local->ungapped_stat->scan_cpu_time;
+      global->ungapped_stat->extension_cpu_time += 
+         local->ungapped_stat->extension_cpu_time;
    }
 
    if (global->gapped_stat && local->gapped_stat) {
@@ -145,6 +164,10 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
          local->gapped_stat->good_extensions;
       global->gapped_stat->num_seqs_passed += 
          local->gapped_stat->num_seqs_passed;
+      global->gapped_stat->extension_time += 
+         local->gapped_stat->extension_time;
+      global->gapped_stat->extension_cpu_time += 
+         local->gapped_stat->extension_cpu_time;
    }
 
    if (global->cutoffs && local->cutoffs) {
@@ -158,3 +181,71 @@ Blast_DiagnosticsUpdate(BlastDiagnostics* global, BlastDiagnostics* local)
    if (global->mt_lock) 
       MT_LOCK_Do(global->mt_lock, eMT_Unlock);
 }
+
+Int2
+Blast_DiagnosticsAddThreadStats(BlastDiagnostics* diagnostics,
+                                const BlastThreadStats* thread_stat,
+                                Int4 num_threads)
+{
+   Int4 i;
+
+   if (!diagnostics || !thread_stat || num_threads <= 0)
+      return 0;
+
+   if (diagnostics->num_threads != num_threads) {
+      BlastThreadStats* new_stat = 
+         (BlastThreadStats*) calloc(num_threads, sizeof(BlastThreadStats));
+      if (!new_stat)
+         return -1;
+      sfree(diagnostics->thread_stat);
+      diagnostics->thread_stat = new_stat;
+      diagnostics->num_threads = num_threads;
+   }
+
+   for (i = 0; i < num_threads; i++) {
+      diagnostics->thread_stat[i].num_subjects += thread_stat[i].num_subjects;
+      diagnostics->thread_stat[i].num_steals += thread_stat[i].num_steals;
+      diagnostics->thread_stat[i].num_pieces += thread_stat[i].num_pieces;
+      diagnostics->thread_stat[i].busy_time += thread_stat[i].busy_time;
+      diagnostics->thread_stat[i].idle_time += thread_stat[i].idle_time;
+      diagnostics->thread_stat[i].cpu_time += thread_stat[i].cpu_time;
+      diagnostics->thread_stat[i].scan_time += thread_stat[i].scan_time;
+      diagnostics->thread_stat[i].ungapped_time += 
+         thread_stat[i].ungapped_time;
+      diagnostics->thread_stat[i].gapped_time += thread_stat[i].gapped_time;
+   }
+   return 0;
+}
+
+void Blast_DiagnosticsSetStageTiming(Boolean enable)
+{
+   s_StageTiming = enable;
+}
+
+Boolean Blast_DiagnosticsGetStageTiming(void)
+{
+   return s_StageTiming;
+}
+
+double Blast_DiagnosticsTimer(void)
+{
+#ifdef CLOCK_MONOTONIC
+   struct timespec ts;
+   if (clock_gettime(CLOCK_MONOTONIC, &ts) == 0)
+      return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+#endif
+   /* No monotonic clock: clock() is the wall clock on Windows and the
+      process CPU time elsewhere, either is good enough for the stage
+      breakdown */
+   return (double)clock() / CLOCKS_PER_SEC;
+}
+
+double Blast_DiagnosticsCpuTimer(void)
+{
+#ifdef CLOCK_THREAD_CPUTIME_ID
+   struct timespec ts;
+   if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) == 0)
+      return (double)ts.tv_sec + 1.0e-9 * ts.tv_nsec;
+#endif
+   return (double)clock() / CLOCKS_PER_SEC;
+}
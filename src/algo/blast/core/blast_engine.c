@@ -72,6 +72,7 @@
 #include <algo/blast/core/blast_traceback.h>
 #include <algo/blast/core/mb_indexed_lookup.h>
 #include <algo/blast/core/gencode_singleton.h>
+#include <algo/blast/core/blast_sched.h>
 #include "blast_gapalign_priv.h"
 
 /** Converts nucleotide coordinates to protein */
@@ -99,6 +100,16 @@ typedef struct BlastCoreAuxStruct {
     Uint1* translation_table; /**< Translation table for forward strand */
     Uint1* translation_table_rc; /**< Translation table for reverse 
                                      strand */
+    Int4 piece_begin; /**< Only the chunks of the subject sequence starting
+                           at this offset or later are searched */
+    Int4 piece_end; /**< Only the chunks of the subject sequence starting
+                         before this offset are searched */
+    Boolean piece_only; /**< Is only a piece of a split subject searched? 
+                             If so, the HSP list is finished once the HSP
+                             lists of all pieces are merged */
+    Int4 merge_offset; /**< Starting offset of the first chunk of the 
+                            subject with HSPs */
+    Int4 merge_overlap; /**< Overlap of that chunk with the previous one */
 } BlastCoreAuxStruct;
 
 /** Deallocates all memory in BlastCoreAuxStruct */
@@ -396,7 +407,8 @@ s_RPSOffsetArrayToContextOffsets(BlastQueryInfo    * info,
  * @param hit_params Hit saving parameters [in]
  * @param diagnostics Hit counts and other diagnostics [in] [out]
  * @param aux_struct Structure containing different auxiliary data and memory
- *                   for the preliminary stage of the BLAST search [in]
+ *                   for the preliminary stage of the BLAST search, and the
+ *                   piece of the subject to search [in] [out]
  * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [out]
  * @param interrupt_search function callback to allow interruption of BLAST
  *                   search [in, optional]
@@ -436,6 +448,9 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
     const int kHspNumMax = BlastHspNumMax(score_options->gapped_calculation, hit_params->options);
     const int kScanSubjectOffsetArraySize = GetOffsetArraySize(lookup);
     Int4 overlap;
+    Boolean timed = FALSE;
+    double stage_start = 0.0;
+    double stage_cpu_start = 0.0;
 
     SubjectSplitStruct backup; 
     backup.sequence = NULL;
@@ -443,13 +458,24 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
     if (diagnostics) {
         ungapped_stats = diagnostics->ungapped_stat;
         gapped_stats = diagnostics->gapped_stat;
+        timed = ungapped_stats && gapped_stats && 
+            Blast_DiagnosticsGetStageTiming();
     }
 
     s_BackupSubject(subject, &backup);
+    aux_struct->merge_offset = 0;
+    aux_struct->merge_overlap = 0;
 
     while (TRUE) {
         status = s_GetNextSubjectChunk(subject, &backup, kNucleotide);
         if (status == SUBJECT_SPLIT_DONE) break;
+        /* Search only the chunks starting in the given piece of the
+           subject; the other pieces are searched by other threads. */
+        if (backup.offset >= aux_struct->piece_end) {
+            status = 0;
+            break;
+        }
+        if (backup.offset < aux_struct->piece_begin) continue;
         if (status == SUBJECT_SPLIT_NO_RANGE) continue;
         ASSERT(status == SUBJECT_SPLIT_OK);
         ASSERT(subject->num_seq_ranges >= 1);
@@ -461,11 +487,29 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         BlastInitHitListReset(init_hitlist);
 
         if (aux_struct->WordFinder) {
+            /* the word finder adds its scanning time to scan_time, the
+               rest of its time is spent in ungapped extensions */
+            double scan_time = 0.0;
+            double scan_cpu_time = 0.0;
+            if (timed) {
+                scan_time = ungapped_stats->scan_time;
+                scan_cpu_time = ungapped_stats->scan_cpu_time;
+                stage_start = Blast_DiagnosticsTimer();
+                stage_cpu_start = Blast_DiagnosticsCpuTimer();
+            }
             aux_struct->WordFinder(subject, query, query_info, lookup, matrix, 
                                    word_params, aux_struct->ewp, 
                                    aux_struct->offset_pairs, 
                                    kScanSubjectOffsetArraySize,
                                    init_hitlist, ungapped_stats);
+            if (timed) {
+                ungapped_stats->extension_time += 
+                    Blast_DiagnosticsTimer() - stage_start -
+                    (ungapped_stats->scan_time - scan_time);
+                ungapped_stats->extension_cpu_time += 
+                    Blast_DiagnosticsCpuTimer() - stage_cpu_start -
+                    (ungapped_stats->scan_cpu_time - scan_cpu_time);
+            }
 
             if (init_hitlist->total == 0) continue;
         }
@@ -489,9 +533,19 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
           * are saved.
           */
         /* fence_hit is null, since this is only for prelim stage. */
+        if (timed) {
+            stage_start = Blast_DiagnosticsTimer();
+            stage_cpu_start = Blast_DiagnosticsCpuTimer();
+        }
         status = aux_struct->GetGappedScore(program_number, query, query_info, 
                     subject, gap_align, score_params, ext_params, hit_params, 
                     init_hitlist, &hsp_list, gapped_stats, NULL);
+        if (timed) {
+            gapped_stats->extension_time += 
+                Blast_DiagnosticsTimer() - stage_start;
+            gapped_stats->extension_cpu_time += 
+                Blast_DiagnosticsCpuTimer() - stage_cpu_start;
+        }
         if (status) break;
 
         /* Removes redundant HSPs. */
@@ -526,6 +580,11 @@ s_BlastSearchEngineOneContext(EBlastProgramType program_number,
         Blast_HSPListAdjustOffsets(hsp_list, backup.offset);
         overlap = (backup.offset == backup.hard_ranges[backup.hm_index].left) ?
                   0 : DBSEQ_CHUNK_OVERLAP;
+        if (!combined_hsp_list) {
+            /* needed to merge with the HSPs of the previous pieces */
+            aux_struct->merge_offset = backup.offset;
+            aux_struct->merge_overlap = overlap;
+        }
         status = Blast_HSPListsMerge(&hsp_list, &combined_hsp_list,  
                      kHspNumMax, &(backup.offset), INT4_MIN,
                      overlap, score_options->gapped_calculation);
@@ -612,6 +671,82 @@ s_Blast_HSPListReapByPrelimEvalue(BlastHSPList* hsp_list, const BlastHitSavingPa
    return 0;
 }
 
+/** Finish the HSP list found for one subject sequence: calculate the
+ * e-values (or link the HSPs) and discard the HSPs that don't pass the
+ * preliminary cutoffs. 
+ * @param program_number BLAST program type [in]
+ * @param query_info Query information [in]
+ * @param subject_length Length of the subject sequence [in]
+ * @param stat_length Length of the subject sequence for statistical 
+ *                    purposes [in]
+ * @param isRPS Is this an RPS BLAST search? [in]
+ * @param score_params Scoring parameters [in]
+ * @param hit_params Hit saving parameters [in]
+ * @param sbp Scoring block [in]
+ * @param diagnostics Hit counts and other diagnostics [in] [out]
+ * @param hsp_list_ptr The HSP list, freed if no HSPs are left [in] [out]
+ */
+static Int2
+s_BlastSearchEngineCoreFinish(EBlastProgramType program_number,
+        BlastQueryInfo* query_info,
+        Int4 subject_length,
+        Int4 stat_length,
+        Boolean isRPS,
+        const BlastScoringParameters* score_params,
+        const BlastHitSavingParameters* hit_params,
+        BlastScoreBlk* sbp,
+        BlastDiagnostics* diagnostics,
+        BlastHSPList** hsp_list_ptr)
+{
+    BlastHSPList* hsp_list_out = *hsp_list_ptr;
+    BlastHitSavingOptions* hit_options = hit_params->options;
+    BlastScoringOptions* score_options = score_params->options;
+    Int2 status = 0;
+
+    if (hit_params->link_hsp_params) {
+        status = BLAST_LinkHsps(program_number, hsp_list_out, query_info,
+                  subject_length, sbp, hit_params->link_hsp_params, 
+                  score_options->gapped_calculation);
+    } else if (!Blast_ProgramIsPhiBlast(program_number)
+           && !(isRPS && !sbp->gbp) ){
+        /* Calculate e-values for all HSPs. Skip this step
+           for PHI or RPS with old FSC, since calculating the E values 
+           requires precomputation that has not been done yet */
+        double scale_factor = 1.0;
+        if (isRPS) {
+            scale_factor = score_params->scale_factor;
+        }
+        status = Blast_HSPListGetEvalues(program_number, query_info,
+                                         stat_length, hsp_list_out, 
+                                         score_options->gapped_calculation, 
+                                         isRPS, sbp, 0, scale_factor);
+    }
+    
+   /* Use score threshold rather than evalue if 
+    * matrix_only_scoring is used.  -RMH- 
+    */
+    if ( sbp->matrix_only_scoring )
+    {
+        status = Blast_HSPListReapByRawScore(hsp_list_out, hit_options);
+    }else {
+       /* Discard HSPs that don't pass the e-value test. */
+        status = s_Blast_HSPListReapByPrelimEvalue(hsp_list_out, hit_params);
+    }
+
+    /* If there are no HSPs left, destroy the HSP list too. */
+    if (hsp_list_out && hsp_list_out->hspcnt == 0)
+        hsp_list_out = Blast_HSPListFree(hsp_list_out);
+
+    if (diagnostics && diagnostics->gapped_stat && hsp_list_out && hsp_list_out->hspcnt > 0) {
+        BlastGappedStats* gapped_stats = diagnostics->gapped_stat;
+        ++gapped_stats->num_seqs_passed;
+        gapped_stats->good_extensions += hsp_list_out->hspcnt;
+    }
+
+    *hsp_list_ptr = hsp_list_out;
+    return status;
+}
+
 /** The core of the BLAST search: comparison between the (concatenated)
  * query against one subject sequence. Translation of the subject sequence
  * into 6 frames is done inside, if necessary. If subject sequence is 
@@ -630,8 +765,11 @@ s_Blast_HSPListReapByPrelimEvalue(BlastHSPList* hsp_list, const BlastHitSavingPa
  * @param db_options Database options [in]
  * @param diagnostics Hit counts and other diagnostics [in] [out]
  * @param aux_struct Structure containing different auxiliary data and memory
- *                   for the preliminary stage of the BLAST search [in]
- * @param hsp_list_out_ptr List of HSPs found for a given subject sequence [in]
+ *                   for the preliminary stage of the BLAST search, and the
+ *                   piece of the subject to search [in] [out]
+ * @param hsp_list_out_ptr List of HSPs found for a given subject sequence; 
+ *                   not finished if only a piece of the subject was 
+ *                   searched [out]
  * @param interrupt_search function callback to allow interruption of BLAST
  *                   search [in, optional]
  * @param progress_info contains information about the progress of the current
@@ -807,44 +945,12 @@ s_BlastSearchEngineCore(EBlastProgramType program_number,
         return status;
     }
 
-    if (hit_params->link_hsp_params) {
-        status = BLAST_LinkHsps(program_number, hsp_list_out, query_info,
-                  subject->length, gap_align->sbp, hit_params->link_hsp_params, 
-                  score_options->gapped_calculation);
-    } else if (!Blast_ProgramIsPhiBlast(program_number)
-           && !(isRPS && !sbp->gbp) ){
-        /* Calculate e-values for all HSPs. Skip this step
-           for PHI or RPS with old FSC, since calculating the E values 
-           requires precomputation that has not been done yet */
-        double scale_factor = 1.0;
-        if (isRPS) {
-            scale_factor = score_params->scale_factor;
-        }
-        status = Blast_HSPListGetEvalues(program_number, query_info,
-                                         stat_length, hsp_list_out, 
-                                         score_options->gapped_calculation, 
-                                         isRPS, gap_align->sbp, 0, scale_factor);
-    }
-    
-   /* Use score threshold rather than evalue if 
-    * matrix_only_scoring is used.  -RMH- 
-    */
-    if ( sbp->matrix_only_scoring )
-    {
-        status = Blast_HSPListReapByRawScore(hsp_list_out, hit_options);
-    }else {
-       /* Discard HSPs that don't pass the e-value test. */
-        status = s_Blast_HSPListReapByPrelimEvalue(hsp_list_out, hit_params);
-    }
-
-    /* If there are no HSPs left, destroy the HSP list too. */
-    if (hsp_list_out && hsp_list_out->hspcnt == 0)
-        *hsp_list_out_ptr = hsp_list_out = Blast_HSPListFree(hsp_list_out);
-
-    if (diagnostics && diagnostics->gapped_stat && hsp_list_out && hsp_list_out->hspcnt > 0) {
-        BlastGappedStats* gapped_stats = diagnostics->gapped_stat;
-        ++gapped_stats->num_seqs_passed;
-        gapped_stats->good_extensions += hsp_list_out->hspcnt;
+    /* The HSP lists of the pieces of a split subject are finished once
+       they are merged */
+    if (!aux_struct->piece_only) {
+        status = s_BlastSearchEngineCoreFinish(program_number, query_info,
+                     subject->length, stat_length, isRPS, score_params,
+                     hit_params, sbp, diagnostics, &hsp_list_out);
     }
 
     s_BlastSearchEngineCoreCleanUp(program_number, query_info, query_info_in,
@@ -931,6 +1037,9 @@ s_BlastSetUpAuxStructures(const BlastSeqSrc* seq_src,
     *aux_struct_ptr = aux_struct = (BlastCoreAuxStruct*)
       calloc(1, sizeof(BlastCoreAuxStruct));
 
+    /* search whole subject sequences unless told otherwise */
+    aux_struct->piece_end = INT4_MAX;
+
     if ((status = BlastExtendWordNew(query->length, word_params, 
                                     &aux_struct->ewp)) != 0)
       return status;
@@ -1224,6 +1333,17 @@ s_AdjustSubjectForSraSearch(BlastHSPList* hsp_list, Uint1 offset )
 }
 
 
+Boolean
+Blast_SubjectCanBeSplit(EBlastProgramType program_number,
+   const BlastScoringOptions* score_options,
+   const BlastHitSavingOptions* hit_options)
+{
+    return score_options->gapped_calculation && !hit_options->do_sum_stats &&
+        !Blast_SubjectIsTranslated(program_number) &&
+        !Blast_ProgramIsRpsBlast(program_number) &&
+        !Blast_ProgramIsPhiBlast(program_number);
+}
+
 Int4 
 BLAST_PreliminarySearchEngine(EBlastProgramType program_number, 
     BLAST_SequenceBlk* query, BlastQueryInfo* query_info,
@@ -1257,6 +1377,11 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
     T_MB_IdbCheckOid check_index_oid = 
         (T_MB_IdbCheckOid)lookup_wrap->check_index_oid;
     Int4 last_vol_idx = LAST_VOL_IDX_INIT;
+    Int4 sched_thread = 0;
+    BlastSubjectScheduler* sched = 
+        BlastSeqSrcGetScheduler(seq_src, &sched_thread);
+    const Int4 kHspNumMax = BlastHspNumMax(gapped_calculation, hit_options);
+    Boolean can_split = FALSE;
 
     BlastInitialWordParametersNew(program_number, word_options, 
       hit_params, lookup_wrap, sbp, query_info, 
@@ -1295,17 +1420,38 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
 
     db_length = BlastSeqSrcGetTotLen(seq_src);
 
+    /* Long subject sequences may be split into pieces by the scheduler of
+       a multi-threaded search. The index and the search space of a single
+       subject are set up for whole subject sequences. */
+    can_split = sched && db_length > 0 && check_index_oid == 0 &&
+        !hit_params->link_hsp_params &&
+        Blast_SubjectCanBeSplit(program_number, score_options, hit_options);
+
     itr = BlastSeqSrcIteratorNewEx(MAX(BlastSeqSrcGetNumSeqs(seq_src)/100,1));
 
     /* iterate over all subject sequences */
     while ( (seq_arg.oid = BlastSeqSrcIteratorNext(seq_src, itr)) 
            != BLAST_SEQSRC_EOF) {
        Int4 stat_length;
+       BlastSubjectPiece piece;
        if (seq_arg.oid == BLAST_SEQSRC_ERROR) {
     	   status = BLASTERR_SEQSRC;
            break;
        }
 
+       BlastSubjectSchedulerGetPiece(sched, sched_thread, &piece);
+       if (piece.num_pieces > 1 && !can_split) {
+           /* The first piece stands for the whole subject */
+           if (piece.index > 0)
+               continue;
+           piece.num_pieces = 1;
+           piece.begin = 0;
+           piece.end = INT4_MAX;
+       }
+       aux_struct->piece_begin = piece.begin;
+       aux_struct->piece_end = piece.end;
+       aux_struct->piece_only = (piece.num_pieces > 1);
+
        if( check_index_oid != 0 && 
                check_index_oid( seq_arg.oid, &last_vol_idx ) == eNoResults ) {
            continue;
@@ -1358,6 +1504,28 @@ BLAST_PreliminarySearchEngine(EBlastProgramType program_number,
           break;
       }
 
+      /* The HSP lists of the pieces of a subject are merged, then finished,
+         by the thread which searched the last piece */
+      if (aux_struct->piece_only) {
+          Int2 merged = 
+              BlastSubjectSchedulerMergePiece(sched, sched_thread, &hsp_list,
+                  aux_struct->merge_offset, aux_struct->merge_overlap,
+                  kHspNumMax, gapped_calculation);
+          if (merged < 0) {
+              status = BLASTERR_MEMORY;
+              break;
+          }
+          if (merged > 0) {
+              status = s_BlastSearchEngineCoreFinish(program_number, 
+                           query_info, seq_arg.seq->length, stat_length, 
+                           FALSE, score_params, hit_params, sbp, diagnostics,
+                           &hsp_list);
+              if (status) {
+                  break;
+              }
+          }
+      }
+
       if (hsp_list && hsp_list->hspcnt > 0) {
          int query_index=0; /* Used to loop over queries below. */
          if (!gapped_calculation) {
@@ -34,6 +34,7 @@
 #include <algo/blast/core/blast_gapalign.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE macros */
 #include <algo/blast/core/greedy_align.h>
+#include <algo/blast/core/blast_simd.h>
 #include "blast_gapalign_priv.h"
 #include "blast_hits_priv.h"
 #include "blast_itree.h"
@@ -276,6 +277,12 @@ BLAST_GapAlignStructFree(BlastGapAlignStruct* gap_align)
       s_BlastGreedyAlignsFree(gap_align->greedy_align_mem);
    GapStateFree(gap_align->state_struct);
    sfree(gap_align->dp_mem);
+   if (gap_align->sw_profiles) {
+      Int4 i;
+      for (i = 0; i < gap_align->num_sw_profiles; i++)
+         BlastSWProfileFree(gap_align->sw_profiles[i]);
+      sfree(gap_align->sw_profiles);
+   }
 
    sfree(gap_align);
    return NULL;
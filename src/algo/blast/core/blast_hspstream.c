@@ -35,6 +35,7 @@
 
 #include <algo/blast/core/blast_hspstream.h>
 #include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/hspfilter_collector.h>
 #include "blast_hspstream_mt_utils.h"
 
 /** Default hit saving stream methods */
@@ -303,6 +304,144 @@ int BlastHSPStreamRead(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list_out)
    return kBlastHSPStream_Success;
 }
 
+/** Best hit of one buffered HSP list for one query, as ranked by the hit
+ * lists: by e-value, then by score */
+typedef struct SHSPListQueryHit {
+   Int4 hsplist;    /**< index of the HSP list in the buffer */
+   Int4 query;      /**< index of the query */
+   double evalue;   /**< best e-value of the HSPs for the query, 0 for any
+                         e-value too small to tell apart from others */
+   Int4 score;      /**< best score of the HSPs with that e-value */
+} SHSPListQueryHit;
+
+/** Is one hit worse than another one?
+ * @param h1 The first hit [in]
+ * @param h2 The second hit [in]
+ */
+static NCBI_INLINE Boolean
+s_QueryHitIsWorse(const SHSPListQueryHit* h1, const SHSPListQueryHit* h2)
+{
+   return h1->evalue > h2->evalue ||
+      (h1->evalue == h2->evalue && h1->score < h2->score);
+}
+
+/** Callback to sort SHSPListQueryHit by query, then from best to worst */
+static int
+s_QueryHitCompare(const void* v1, const void* v2)
+{
+   const SHSPListQueryHit* h1 = (const SHSPListQueryHit*) v1;
+   const SHSPListQueryHit* h2 = (const SHSPListQueryHit*) v2;
+
+   if (h1->query != h2->query)
+      return BLAST_CMP(h1->query, h2->query);
+   if (s_QueryHitIsWorse(h1, h2))
+      return 1;
+   if (s_QueryHitIsWorse(h2, h1))
+      return -1;
+   return 0;
+}
+
+/** Drop the HSP lists of a thread buffer which the collector of the shared
+ * stream can't save. For each query, the collector keeps the
+ * buffer_hitlist_size HSP lists with the best e-values (then scores); an HSP
+ * list is dropped only if, for every query it has hits to, the buffer
+ * already holds that many HSP lists with strictly better hits. The
+ * collector would discard it whichever thread found those, so the results
+ * of the search don't change. E-values are compared with the same precision
+ * as in the hit lists.
+ * @param buffer The thread buffer [in][out]
+ * @return kBlastHSPStream_Success on success, otherwise kBlastHSPStream_Error
+ */
+static int
+s_BlastHSPStreamPruneThreadBuffer(BlastHSPStream* buffer)
+{
+   const double kEvalueEpsilon = 1.0e-180;
+   const Int4 kHitlistSize = buffer->buffer_hitlist_size;
+   const Int4 kNumQueries = buffer->results->num_queries;
+   SHSPListQueryHit* hits = NULL;
+   SHSPListQueryHit* sorted = NULL;
+   SHSPListQueryHit** thresholds = NULL;
+   Int4 num_hits = 0, max_hits = 0;
+   Int4 i, j, k, kept;
+
+   for (i = 0; i < buffer->num_hsplists; i++)
+      max_hits += MIN(buffer->sorted_hsplists[i]->hspcnt, kNumQueries);
+
+   hits = (SHSPListQueryHit*) malloc(MAX(max_hits, 1) *
+                                     sizeof(SHSPListQueryHit));
+   sorted = (SHSPListQueryHit*) malloc(MAX(max_hits, 1) *
+                                       sizeof(SHSPListQueryHit));
+   thresholds = (SHSPListQueryHit**) calloc(kNumQueries,
+                                            sizeof(SHSPListQueryHit*));
+   if (!hits || !sorted || !thresholds) {
+      sfree(hits);
+      sfree(sorted);
+      sfree(thresholds);
+      return kBlastHSPStream_Error;
+   }
+
+   /* Best hit of each HSP list for each of its queries */
+   for (i = 0; i < buffer->num_hsplists; i++) {
+      const BlastHSPList* hsp_list = buffer->sorted_hsplists[i];
+      Int4 first = num_hits;
+      for (j = 0; j < hsp_list->hspcnt; j++) {
+         const BlastHSP* hsp = hsp_list->hsp_array[j];
+         SHSPListQueryHit hit;
+         hit.hsplist = i;
+         hit.query = Blast_GetQueryIndexFromContext(hsp->context,
+                                                    buffer->program);
+         hit.evalue = hsp->evalue < kEvalueEpsilon ? 0.0 : hsp->evalue;
+         hit.score = hsp->score;
+         for (k = first; k < num_hits; k++) {
+            if (hits[k].query == hit.query)
+               break;
+         }
+         if (k == num_hits)
+            num_hits++;
+         else if (!s_QueryHitIsWorse(&hits[k], &hit))
+            continue;
+         hits[k] = hit;
+      }
+   }
+
+   /* The worst of the best kHitlistSize hits of each query */
+   memcpy(sorted, hits, num_hits * sizeof(SHSPListQueryHit));
+   qsort(sorted, num_hits, sizeof(SHSPListQueryHit), s_QueryHitCompare);
+   for (i = 0; i < num_hits; i = j) {
+      for (j = i + 1; j < num_hits && sorted[j].query == sorted[i].query;
+           j++)
+         ;
+      if (j - i > kHitlistSize)
+         thresholds[sorted[i].query] = &sorted[i + kHitlistSize - 1];
+   }
+
+   /* Keep the HSP lists which may be saved for any query, in order */
+   kept = 0;
+   for (i = 0, k = 0; i < buffer->num_hsplists; i++) {
+      Boolean keep = FALSE;
+      for ( ; k < num_hits && hits[k].hsplist == i; k++) {
+         const SHSPListQueryHit* threshold = thresholds[hits[k].query];
+         if (!threshold || !s_QueryHitIsWorse(&hits[k], threshold))
+            keep = TRUE;
+      }
+      if (keep || buffer->sorted_hsplists[i]->hspcnt == 0) {
+         buffer->sorted_hsplists[kept++] = buffer->sorted_hsplists[i];
+      } else {
+         buffer->sorted_hsplists[i] =
+            Blast_HSPListFree(buffer->sorted_hsplists[i]);
+      }
+   }
+   buffer->num_hsplists = kept;
+
+   /* Prune again once the buffer has doubled */
+   buffer->buffer_prune_size = MAX(buffer->buffer_prune_size, 2 * kept);
+
+   sfree(hits);
+   sfree(sorted);
+   sfree(thresholds);
+   return kBlastHSPStream_Success;
+}
+
 /** Write an HSP list to the collector HSP stream. The HSP stream assumes 
  * ownership of the HSP list and sets the dereferenced pointer to NULL.
  * @param hsp_stream Stream to write to. [in] [out]
@@ -316,6 +455,29 @@ int BlastHSPStreamWrite(BlastHSPStream* hsp_stream, BlastHSPList** hsp_list)
    if (!hsp_stream) 
       return kBlastHSPStream_Error;
 
+   /** A per-thread buffer keeps the HSP list as it is, no locking needed */
+   if (hsp_stream->thread_buffer) {
+      if (hsp_stream->results_sorted)
+         return kBlastHSPStream_Error;
+      if (*hsp_list == NULL)
+         return kBlastHSPStream_Success;
+      if (hsp_stream->num_hsplists == hsp_stream->num_hsplists_alloc) {
+         Int4 alloc = 2 * hsp_stream->num_hsplists_alloc;
+         BlastHSPList** new_lists = (BlastHSPList **)realloc(
+                                        hsp_stream->sorted_hsplists,
+                                        alloc * sizeof(BlastHSPList *));
+         if (!new_lists)
+            return kBlastHSPStream_Error;
+         hsp_stream->sorted_hsplists = new_lists;
+         hsp_stream->num_hsplists_alloc = alloc;
+      }
+      hsp_stream->sorted_hsplists[hsp_stream->num_hsplists++] = *hsp_list;
+      *hsp_list = NULL;
+      if (hsp_stream->num_hsplists >= hsp_stream->buffer_prune_size)
+         return s_BlastHSPStreamPruneThreadBuffer(hsp_stream);
+      return kBlastHSPStream_Success;
+   }
+
    /** Lock the mutex, if necessary */
    MT_LOCK_Do(hsp_stream->x_lock, eMT_Lock);
 
@@ -537,7 +699,145 @@ fprintf(stderr, "No hits to query %d\n", global_query);
 
    return kBlastHSPStream_Success;
 }
- 
+
+/** A sequence of HSP lists of non-decreasing subject OID from one buffer */
+typedef struct SHSPListRun {
+   BlastHSPList** hsplists;   /**< the HSP lists */
+   Int4 num_hsplists;         /**< number of HSP lists in the run */
+   Int4 next;                 /**< index of the first HSP list not merged */
+} SHSPListRun;
+
+/** Does the next HSP list of one run go before that of another? Runs are
+ * numbered in the order their HSP lists were written, so that HSP lists
+ * for the same OID keep that order.
+ * @param runs All runs [in]
+ * @param a Index of the first run [in]
+ * @param b Index of the second run [in]
+ */
+static NCBI_INLINE Boolean
+s_HSPListRunPrecedes(const SHSPListRun* runs, Int4 a, Int4 b)
+{
+   Int4 oid_a = runs[a].hsplists[runs[a].next]->oid;
+   Int4 oid_b = runs[b].hsplists[runs[b].next]->oid;
+   return oid_a < oid_b || (oid_a == oid_b && a < b);
+}
+
+/** Restore the heap property of a heap of runs below one position
+ * @param runs All runs [in]
+ * @param heap Heap of run indices, the run with the smallest OID on top
+ *             [in][out]
+ * @param heap_size Number of runs in the heap [in]
+ * @param pos Position to sift down from [in]
+ */
+static void
+s_HSPListRunSiftDown(const SHSPListRun* runs, Int4* heap, Int4 heap_size,
+                     Int4 pos)
+{
+   Int4 run = heap[pos];
+
+   for (;;) {
+      Int4 child = 2 * pos + 1;
+      if (child >= heap_size)
+         break;
+      if (child + 1 < heap_size &&
+          s_HSPListRunPrecedes(runs, heap[child + 1], heap[child]))
+         child++;
+      if (!s_HSPListRunPrecedes(runs, heap[child], run))
+         break;
+      heap[pos] = heap[child];
+      pos = child;
+   }
+   heap[pos] = run;
+}
+
+int BlastHSPStreamMergeThreadBuffers(BlastHSPStream* hsp_stream,
+                                     BlastHSPStream** buffers,
+                                     Int4 num_buffers)
+{
+   SHSPListRun* runs = NULL;
+   Int4* heap = NULL;
+   Int4 num_runs = 0, heap_size;
+   Int4 i, j;
+   int status = kBlastHSPStream_Success;
+
+   if (!hsp_stream || hsp_stream->thread_buffer ||
+       hsp_stream->results_sorted || (num_buffers > 0 && !buffers))
+      return kBlastHSPStream_Error;
+
+   /* A thread searches subject sequences in increasing order of OID until
+      it runs out of work and is given another range of OIDs, so that each
+      buffer consists of a few sorted runs. Merging the runs of all buffers
+      restores the order of a single-threaded search. */
+   for (i = 0; i < num_buffers; i++) {
+      BlastHSPStream* buffer = buffers[i];
+      if (!buffer)
+         continue;
+      if (!buffer->thread_buffer)
+         return kBlastHSPStream_Error;
+      for (j = 0; j < buffer->num_hsplists; j++) {
+         if (j == 0 || buffer->sorted_hsplists[j]->oid <
+                       buffer->sorted_hsplists[j - 1]->oid)
+            num_runs++;
+      }
+   }
+   if (num_runs == 0)
+      return kBlastHSPStream_Success;
+
+   runs = (SHSPListRun*) calloc(num_runs, sizeof(SHSPListRun));
+   heap = (Int4*) malloc(num_runs * sizeof(Int4));
+   if (!runs || !heap) {
+      sfree(runs);
+      sfree(heap);
+      return kBlastHSPStream_Error;
+   }
+
+   num_runs = 0;
+   for (i = 0; i < num_buffers; i++) {
+      BlastHSPStream* buffer = buffers[i];
+      if (!buffer)
+         continue;
+      for (j = 0; j < buffer->num_hsplists; j++) {
+         if (j == 0 || buffer->sorted_hsplists[j]->oid <
+                       buffer->sorted_hsplists[j - 1]->oid) {
+            runs[num_runs].hsplists = buffer->sorted_hsplists + j;
+            num_runs++;
+         }
+         runs[num_runs - 1].num_hsplists++;
+      }
+   }
+
+   heap_size = num_runs;
+   for (i = 0; i < heap_size; i++)
+      heap[i] = i;
+   for (i = heap_size / 2 - 1; i >= 0; i--)
+      s_HSPListRunSiftDown(runs, heap, heap_size, i);
+
+   while (heap_size > 0) {
+      SHSPListRun* run = &runs[heap[0]];
+      BlastHSPList* hsp_list = run->hsplists[run->next];
+
+      run->hsplists[run->next++] = NULL;
+      if (BlastHSPStreamWrite(hsp_stream, &hsp_list)
+          != kBlastHSPStream_Success) {
+         Blast_HSPListFree(hsp_list);
+         status = kBlastHSPStream_Error;
+      }
+
+      if (run->next == run->num_hsplists)
+         heap[0] = heap[--heap_size];
+      if (heap_size > 0)
+         s_HSPListRunSiftDown(runs, heap, heap_size, 0);
+   }
+
+   for (i = 0; i < num_buffers; i++) {
+      if (buffers[i])
+         buffers[i]->num_hsplists = 0;
+   }
+   sfree(runs);
+   sfree(heap);
+   return status;
+}
+
 int BlastHSPStreamBatchRead(BlastHSPStream* hsp_stream,
                             BlastHSPStreamResultBatch* batch) 
 {
@@ -660,10 +960,48 @@ BlastHSPStreamNew(EBlastProgramType program,
     hsp_stream->writer_finalized = FALSE;
     hsp_stream->pre_pipe = NULL;
     hsp_stream->tback_pipe = NULL;
+    hsp_stream->thread_buffer = FALSE;
 
     return hsp_stream;
 }
 
+Boolean
+BlastHSPStreamCanUseThreadBuffers(const BlastHSPStream* hsp_stream)
+{
+    return hsp_stream && hsp_stream->results && !hsp_stream->thread_buffer &&
+        BlastHSPCollectorGetParams(hsp_stream->writer) != NULL;
+}
+
+BlastHSPStream*
+BlastHSPStreamNewThreadBuffer(const BlastHSPStream* hsp_stream)
+{
+    BlastHSPStream* buffer = NULL;
+
+    if (!BlastHSPStreamCanUseThreadBuffers(hsp_stream))
+        return NULL;
+
+    buffer = (BlastHSPStream*) calloc(1, sizeof(BlastHSPStream));
+    if (!buffer)
+        return NULL;
+
+    buffer->program = hsp_stream->program;
+    buffer->num_hsplists_alloc = 100;
+    buffer->sorted_hsplists = (BlastHSPList **)malloc(
+                                           buffer->num_hsplists_alloc *
+                                           sizeof(BlastHSPList *));
+    /* never filled in, but the engine expects the query count here */
+    buffer->results = Blast_HSPResultsNew(hsp_stream->results->num_queries);
+    buffer->thread_buffer = TRUE;
+    buffer->buffer_hitlist_size =
+        BlastHSPCollectorGetParams(hsp_stream->writer)->prelim_hitlist_size;
+    buffer->buffer_prune_size = 2 * buffer->buffer_hitlist_size;
+
+    if (!buffer->sorted_hsplists || !buffer->results)
+        return BlastHSPStreamFree(buffer);
+
+    return buffer;
+}
+
 int BlastHSPStreamRegisterMTLock(BlastHSPStream* hsp_stream,
                                  MT_LOCK lock)
 {
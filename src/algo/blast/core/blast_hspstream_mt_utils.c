@@ -142,6 +142,86 @@ s_BlastHSPStreamCountNumOids(const BlastHSPStream* hsp_stream)
     return retval;
 }
 
+/** Number of groups a batch of HSP lists is split into
+ * @param batch the batch [in]
+ * @param max_hsplists maximum number of HSP lists in a group [in]
+ */
+static Int4
+s_NumGroups(const BlastHSPStreamResultBatch* batch, Int4 max_hsplists)
+{
+    return MAX(1, (batch->num_hsplists + max_hsplists - 1) / max_hsplists);
+}
+
+int BlastHSPStreamResultsBatchArraySplit(BlastHSPStreamResultsBatchArray* batches,
+                                         Int4 max_hsplists)
+{
+    BlastHSPStreamResultBatch** split = NULL;
+    Uint4 num_split = 0, i, j;
+
+    if (!batches || max_hsplists <= 0) {
+        return BLASTERR_INVALIDPARAM;
+    }
+
+    for (i = 0; i < batches->num_batches; i++) {
+        num_split += s_NumGroups(batches->array_of_batches[i], max_hsplists);
+    }
+    if (num_split == batches->num_batches) {
+        return 0;   /* nothing to split */
+    }
+
+    /* allocate all groups first, so that failure leaves batches unchanged */
+    split = (BlastHSPStreamResultBatch**) calloc(num_split, sizeof(*split));
+    if ( !split ) {
+        return BLASTERR_MEMORY;
+    }
+    for (i = 0, j = 0; i < batches->num_batches; i++) {
+        BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
+        const Int4 kNumGroups = s_NumGroups(batch, max_hsplists);
+        Int4 group, next = 0;
+
+        if (kNumGroups == 1) {
+            split[j++] = batch;
+            continue;
+        }
+        for (group = 0; group < kNumGroups; group++, j++) {
+            /* groups of (nearly) equal size */
+            const Int4 kGroupSize = (batch->num_hsplists - next) /
+                                    (kNumGroups - group);
+            split[j] = Blast_HSPStreamResultBatchInit(kGroupSize);
+            if ( !split[j] || !split[j]->hsplist_array ) {
+                for (j = 0, i = 0; i < batches->num_batches; i++) {
+                    batch = batches->array_of_batches[i];
+                    for (group = s_NumGroups(batch, max_hsplists);
+                         group > 0; group--, j++) {
+                        if (split[j] != batch) {
+                            split[j] = Blast_HSPStreamResultBatchFree(split[j]);
+                        }
+                    }
+                }
+                sfree(split);
+                return BLASTERR_MEMORY;
+            }
+            memcpy(split[j]->hsplist_array, batch->hsplist_array + next,
+                   kGroupSize * sizeof(*batch->hsplist_array));
+            split[j]->num_hsplists = kGroupSize;
+            next += kGroupSize;
+        }
+    }
+
+    /* the HSP lists now belong to the groups */
+    for (i = 0; i < batches->num_batches; i++) {
+        BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
+        if (s_NumGroups(batch, max_hsplists) > 1) {
+            batches->array_of_batches[i] =
+                Blast_HSPStreamResultBatchFree(batch);
+        }
+    }
+    sfree(batches->array_of_batches);
+    batches->array_of_batches = split;
+    batches->num_batches = batches->num_allocated = num_split;
+    return 0;
+}
+
 int BlastHSPStreamToHSPStreamResultsBatch(BlastHSPStream* hsp_stream,
                                           BlastHSPStreamResultsBatchArray** batches)
 {
@@ -61,6 +61,20 @@ NCBI_XBLAST_EXPORT
 int BlastHSPStreamToHSPStreamResultsBatch(BlastHSPStream* hsp_stream,
                                           BlastHSPStreamResultsBatchArray** batches);
 
+/** Splits the batches holding more than the given number of HSP lists into
+ * several batches for the same OID, so that the HSP lists for a subject
+ * sequence hit by many queries can be processed by several threads. The
+ * HSP lists of a batch are kept in order and divided into groups of nearly
+ * equal size.
+ * @param batches The batches to split [in|out]
+ * @param max_hsplists Maximum number of HSP lists in a batch [in]
+ * @return 0 on success, otherwise an error code; batches is not changed on
+ * failure
+ */
+NCBI_XBLAST_EXPORT
+int BlastHSPStreamResultsBatchArraySplit(BlastHSPStreamResultsBatchArray* batches,
+                                         Int4 max_hsplists);
+
 /**
  * Creates a BlastHSPStreamResultsBatchArray with a single element.
  * Used to mimic BlastHSPStreamToHSPStreamResultsBatch when there is no
@@ -923,6 +923,85 @@ s_FillContigMBTable(BLAST_SequenceBlk* query,
 }
 
 
+/** Choose the size of the PV array of a megablast lookup table. To fit in
+ * the external cache of latter-day microprocessors, the PV array cannot have
+ * one bit for every lookup table entry. Instead we choose a size that should
+ * fit in cache and make a single bit of the PV array handle multiple
+ * hashtable entries if necessary.
+ *
+ * If the query is too small or too large, the compression should be higher.
+ * Small queries don't reuse the PV array, and large queries saturate it. In
+ * either case, cache is better used on something else.
+ * @param hashsize Number of entries in the lookup table [in]
+ * @param approx_table_entries Number of words in the table [in]
+ * @return Number of PV_ARRAY_TYPE elements in the PV array
+ */
+static Int4 s_MBLookupTablePVSize(Int4 hashsize, Int4 approx_table_entries)
+{
+   const Int4 kTargetPVSize = 131072;
+   const Int4 kSmallQueryCutoff = 15000;
+   const Int4 kLargeQueryCutoff = 800000;
+   Int4 pv_size;
+
+   if (hashsize <= 8 * kTargetPVSize)
+      pv_size = hashsize >> PV_ARRAY_BTS;
+   else
+      pv_size = kTargetPVSize / PV_ARRAY_BYTES;
+
+   if(approx_table_entries <= kSmallQueryCutoff ||
+      approx_table_entries >= kLargeQueryCutoff) {
+         pv_size = pv_size / 2;
+   }
+   return pv_size;
+}
+
+/** Replace a megablast hashtable by a compact backbone. The hashtable is
+ * freed.
+ * @param hashtable The hashtable [in][out]
+ * @param hashsize Number of entries in the hashtable [in]
+ * @param backbone The compact backbone [out]
+ * @param heads First positions of the words present [out]
+ * @return zero on success, -1 if out of memory
+ */
+static Int2 s_MBLookupTableCompact(Int4** hashtable, Int4 hashsize,
+                                   BlastMBCompactCell** backbone,
+                                   Int4** heads)
+{
+   const Int4 kNumCells = hashsize / MB_COMPACT_CELL_WORDS;
+   Int4* table = *hashtable;
+   Int4 num_present = 0;
+   Int4 i, j;
+
+   for (i = 0; i < hashsize; i++) {
+      if (table[i])
+         num_present++;
+   }
+
+   *backbone = (BlastMBCompactCell*)malloc(kNumCells *
+                                           sizeof(BlastMBCompactCell));
+   *heads = (Int4*)malloc(MAX(num_present, 1) * sizeof(Int4));
+   if (*backbone == NULL || *heads == NULL)
+      return -1;
+
+   num_present = 0;
+   for (i = 0; i < kNumCells; i++) {
+      const Int4* words = table + i * MB_COMPACT_CELL_WORDS;
+      Uint4 bits = 0;
+
+      (*backbone)[i].rank = num_present;
+      for (j = 0; j < MB_COMPACT_CELL_WORDS; j++) {
+         if (words[j]) {
+            bits |= (Uint4)1 << j;
+            (*heads)[num_present++] = words[j];
+         }
+      }
+      (*backbone)[i].bits = bits;
+   }
+
+   sfree(*hashtable);
+   return 0;
+}
+
 /* Documentation in mb_lookup.h */
 Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
         BlastMBLookupTable** mb_lt_ptr,
@@ -934,9 +1013,6 @@ Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
    Int4 pv_size;
    Int2 status = 0;
    BlastMBLookupTable* mb_lt;
-   const Int4 kTargetPVSize = 131072;
-   const Int4 kSmallQueryCutoff = 15000;
-   const Int4 kLargeQueryCutoff = 800000;
    
    *mb_lt_ptr = NULL;
 
@@ -966,27 +1042,8 @@ Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
        mb_lt->masked_locations = s_SeqLocListInvert(location, query->length);
    }
 
-   /* Allocate the PV array. To fit in the external cache of 
-      latter-day microprocessors, the PV array cannot have one
-      bit for for every lookup table entry. Instead we choose
-      a size that should fit in cache and make a single bit
-      of the PV array handle multiple hashtable entries if
-      necessary.
-
-      If the query is too small or too large, the compression 
-      should be higher. Small queries don't reuse the PV array,
-      and large queries saturate it. In either case, cache
-      is better used on something else */
-
-   if (mb_lt->hashsize <= 8 * kTargetPVSize)
-      pv_size = mb_lt->hashsize >> PV_ARRAY_BTS;
-   else
-      pv_size = kTargetPVSize / PV_ARRAY_BYTES;
-
-   if(approx_table_entries <= kSmallQueryCutoff ||
-      approx_table_entries >= kLargeQueryCutoff) {
-         pv_size = pv_size / 2;
-   }
+   /* Allocate the PV array */
+   pv_size = s_MBLookupTablePVSize(mb_lt->hashsize, approx_table_entries);
    mb_lt->pv_array_bts = ilog2(mb_lt->hashsize / pv_size);
    mb_lt->pv_array = calloc(PV_ARRAY_BYTES, pv_size);
    if (mb_lt->pv_array == NULL) {
@@ -1005,6 +1062,21 @@ Int2 BlastMBLookupTableNew(BLAST_SequenceBlk* query, BlastSeqLoc* location,
         status = s_FillContigMBTable(query, location, mb_lt);
    }
 
+   if (status == 0 && lookup_options->mb_compact_backbone) {
+      status = s_MBLookupTableCompact(&mb_lt->hashtable, mb_lt->hashsize,
+                                      &mb_lt->compact_backbone,
+                                      &mb_lt->compact_heads);
+      if (status == 0 && mb_lt->hashtable2) {
+         status = s_MBLookupTableCompact(&mb_lt->hashtable2, mb_lt->hashsize,
+                                         &mb_lt->compact_backbone2,
+                                         &mb_lt->compact_heads2);
+      }
+      if (status != 0) {
+         BlastMBLookupTableDestruct(mb_lt);
+         return status;
+      }
+   }
+
    if (status > 0) {
       BlastMBLookupTableDestruct(mb_lt);
       return status;
@@ -1036,8 +1108,75 @@ BlastMBLookupTable* BlastMBLookupTableDestruct(BlastMBLookupTable* mb_lt)
    sfree(mb_lt->hashtable2);
    sfree(mb_lt->next_pos2);
    sfree(mb_lt->pv_array);
+   sfree(mb_lt->compact_backbone);
+   sfree(mb_lt->compact_heads);
+   sfree(mb_lt->compact_backbone2);
+   sfree(mb_lt->compact_heads2);
    if (mb_lt->masked_locations)
       mb_lt->masked_locations = BlastSeqLocFree(mb_lt->masked_locations);
    sfree(mb_lt);
    return mb_lt;
 }
+
+Int8 BlastMBLookupTableFootprint(Int4 approx_table_entries, Int4 lut_width,
+                                 Boolean compact)
+{
+   const Int4 kHashSize = 1 << (BITS_PER_NUC * lut_width);
+   Int8 retval;
+
+   /* PV array and the chains of query positions */
+   retval = (Int8)s_MBLookupTablePVSize(kHashSize, approx_table_entries) *
+                                                        PV_ARRAY_BYTES;
+   retval += (Int8)(approx_table_entries + 1) * sizeof(Int4);
+
+   /* the backbone; a compact backbone also needs one head per word
+      present, of which there are at most as many as words */
+   if (compact) {
+      retval += (Int8)(kHashSize / MB_COMPACT_CELL_WORDS) *
+                                          sizeof(BlastMBCompactCell);
+      retval += (Int8)approx_table_entries * sizeof(Int4);
+   } else {
+      retval += (Int8)kHashSize * sizeof(Int4);
+   }
+   return retval;
+}
+
+/** Footprint of the lookup table a contiguous megablast search would use
+ * @param lookup_options Options for lookup table creation [in]
+ * @param approx_table_entries Number of words in the table [in]
+ */
+static Int8 s_MBLookupTableFootprintForEntries(
+                                      const LookupTableOptions* lookup_options,
+                                      Int4 approx_table_entries)
+{
+   Int4 lut_width = 0;
+   ELookupTableType lut_type =
+       BlastChooseNaLookupTable(lookup_options, approx_table_entries, 0,
+                                &lut_width);
+
+   if (lut_type != eMBLookupTable)
+      return 0;     /* tables for few words are small anyway */
+   return BlastMBLookupTableFootprint(approx_table_entries, lut_width,
+                                      lookup_options->mb_compact_backbone);
+}
+
+Int4 BlastMBLookupTableMaxEntries(const LookupTableOptions* lookup_options,
+                                  Int8 max_footprint)
+{
+   /* the footprint grows with the number of words, so do a binary search */
+   Int4 low = 0, high = INT4_MAX / 2;
+
+   if (!lookup_options || lookup_options->mb_template_length > 0 ||
+       s_MBLookupTableFootprintForEntries(lookup_options, 1) > max_footprint)
+      return 0;
+
+   while (low < high) {
+      Int4 mid = low + (high - low + 1) / 2;
+      if (s_MBLookupTableFootprintForEntries(lookup_options, mid)
+                                                        <= max_footprint)
+         low = mid;
+      else
+         high = mid - 1;
+   }
+   return low;
+}
@@ -1409,7 +1409,7 @@ static NCBI_INLINE Int4 s_BlastMBLookupRetrieve(BlastMBLookupTable * lookup,
                                                 Int4 s_off)
 {
     Int4 i=0;
-    Int4 q_off = lookup->hashtable[index];
+    Int4 q_off = BlastMBLookupTableFirstPos(lookup, index);
 
     while (q_off) {
         offset_pairs[i].qs_offsets.q_off   = q_off - 1;
@@ -1433,7 +1433,7 @@ static NCBI_INLINE Int4 s_BlastMBLookupRetrieve2(BlastMBLookupTable * lookup,
                                                  Int4 s_off)
 {
     Int4 i=0;
-    Int4 q_off = lookup->hashtable2[index];
+    Int4 q_off = BlastMBLookupTableFirstPos2(lookup, index);
 
     while (q_off) {
         offset_pairs[i].qs_offsets.q_off   = q_off - 1;
@@ -0,0 +1,497 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_sched.c
+ * Work-stealing distribution of subject sequences among threads
+ */
+
+#include <algo/blast/core/blast_sched.h>
+
+/** A subject sequence split into pieces */
+typedef struct SBlastSplitSubject {
+    Int4 oid;                   /**< Ordinal id of the subject */
+    Int4 num_pieces;            /**< Number of pieces */
+    Int4 next_piece;            /**< First piece not handed out yet */
+    Int4 num_done;              /**< Number of pieces handed in */
+    BlastHSPList** hsp_lists;   /**< HSP list found in each piece */
+    Int4* merge_offsets;        /**< Merge offset of each piece */
+    Int4* merge_overlaps;       /**< Merge overlap of each piece */
+    struct SBlastSplitSubject* next; /**< Next split subject */
+} SBlastSplitSubject;
+
+/** Work owned by one thread */
+typedef struct SBlastSchedShare {
+    Int4* oids;         /**< Ordinal ids of the subjects of the share; only
+                             written by the owner while the share is empty */
+    Int4 begin;         /**< First subject not yet handed out */
+    Int4 end;           /**< One past the last subject of the share */
+    MT_LOCK lock;       /**< Protects begin and end */
+    SBlastSplitSubject* split; /**< Split subject last handed out, NULL if 
+                                    the subject was not split */
+    Int4 piece;         /**< Piece of split last handed out */
+    Int4 num_subjects;  /**< Subjects and pieces handed out to the owner */
+    Int4 num_steals;    /**< Shares taken from other threads */
+    Int4 num_pieces;    /**< Pieces handed out to the owner */
+} SBlastSchedShare;
+
+/** All fields except the shares are only accessed with lock held or never
+ * change after the scheduler is created */
+struct BlastSubjectScheduler {
+    Int4 num_threads;       /**< Number of threads */
+    SBlastSchedShare* share; /**< Work of each thread */
+    Int4 share_size;        /**< Number of subjects a share can hold */
+    Int4 piece_length;      /**< Length of the pieces of split subjects, 0
+                                 if subjects are never split */
+    MT_LOCK lock;           /**< Protects the iterator and split subjects */
+    BlastSeqSrcIterator* itr; /**< Chunk iterator used to refill the shares;
+                                   shared by all threads, as iterators of 
+                                   some BlastSeqSrc implementations do not 
+                                   share their position */
+    Boolean exhausted;      /**< Has the chunk iterator run out of 
+                                 subjects? */
+    SBlastSplitSubject* split; /**< All split subjects, most recent first */
+};
+
+/** Lock a mutex if there is one
+ * @param lock The mutex [in]
+ */
+static NCBI_INLINE void s_SchedLock(MT_LOCK lock)
+{
+    if (lock)
+        MT_LOCK_Do(lock, eMT_Lock);
+}
+
+/** Unlock a mutex if there is one
+ * @param lock The mutex [in]
+ */
+static NCBI_INLINE void s_SchedUnlock(MT_LOCK lock)
+{
+    if (lock)
+        MT_LOCK_Do(lock, eMT_Unlock);
+}
+
+/** Free a split subject
+ * @param split The split subject [in]
+ */
+static void s_SplitSubjectFree(SBlastSplitSubject* split)
+{
+    Int4 i;
+
+    if (split->hsp_lists) {
+        for (i = 0; i < split->num_pieces; i++)
+            Blast_HSPListFree(split->hsp_lists[i]);
+    }
+    sfree(split->hsp_lists);
+    sfree(split->merge_offsets);
+    sfree(split->merge_overlaps);
+    sfree(split);
+}
+
+BlastSubjectScheduler*
+BlastSubjectSchedulerNew(BlastSeqSrc* seq_src, Int4 num_threads,
+                         MT_LOCK* locks, Int4 piece_length)
+{
+    BlastSubjectScheduler* sched = NULL;
+    Int4 i;
+
+    if (num_threads >= 1)
+        sched = (BlastSubjectScheduler*) calloc(1,
+                                                sizeof(BlastSubjectScheduler));
+    if (sched) {
+        sched->share = (SBlastSchedShare*) calloc(num_threads,
+                                                  sizeof(SBlastSchedShare));
+    }
+    if (!sched || !sched->share) {
+        for (i = 0; locks && i <= num_threads; i++)
+            MT_LOCK_Delete(locks[i]);
+        if (sched)
+            sfree(sched);
+        return NULL;
+    }
+    sched->num_threads = num_threads;
+    for (i = 0; locks && i < num_threads; i++)
+        sched->share[i].lock = locks[i];
+    if (locks)
+        sched->lock = locks[num_threads];
+
+    if (!seq_src)
+        return BlastSubjectSchedulerFree(sched);
+
+    sched->share_size = kBlastSeqSrcDefaultChunkSize;
+    for (i = 0; i < num_threads; i++) {
+        SBlastSchedShare* share = &sched->share[i];
+        share->oids = (Int4*) malloc(sched->share_size * sizeof(Int4));
+        if (!share->oids)
+            return BlastSubjectSchedulerFree(sched);
+    }
+    sched->itr = BlastSeqSrcIteratorNewEx(kBlastSeqSrcDefaultChunkSize);
+    if (!sched->itr)
+        return BlastSubjectSchedulerFree(sched);
+
+    /* nothing to split if no subject is longer than a piece */
+    if (piece_length > 0 && BlastSeqSrcGetMaxSeqLen(seq_src) > piece_length)
+        sched->piece_length = piece_length;
+
+    BlastSeqSrcResetChunkIterator(seq_src);
+    return sched;
+}
+
+BlastSubjectScheduler*
+BlastSubjectSchedulerFree(BlastSubjectScheduler* sched)
+{
+    Int4 i;
+
+    if (!sched)
+        return NULL;
+
+    for (i = 0; i < sched->num_threads; i++) {
+        SBlastSchedShare* share = &sched->share[i];
+        if (share->lock)
+            MT_LOCK_Delete(share->lock);
+        sfree(share->oids);
+    }
+    if (sched->lock)
+        MT_LOCK_Delete(sched->lock);
+    BlastSeqSrcIteratorFree(sched->itr);
+    while (sched->split) {
+        SBlastSplitSubject* next = sched->split->next;
+        s_SplitSubjectFree(sched->split);
+        sched->split = next;
+    }
+    sfree(sched->share);
+    sfree(sched);
+    return NULL;
+}
+
+/** Refill the empty share of a thread from the chunk iterator
+ * @param sched The scheduler [in][out]
+ * @param share Share of the calling thread [in][out]
+ * @param seq_src BlastSeqSrc of the calling thread [in]
+ * @return Number of subjects added, or BLAST_SEQSRC_ERROR
+ */
+static Int4 s_SchedFill(BlastSubjectScheduler* sched,
+                        SBlastSchedShare* share, const BlastSeqSrc* seq_src)
+{
+    Int4 num_oids = 0;
+
+    /* nobody reads the array of an empty share, so it can be filled in
+       without holding the lock of the share */
+    s_SchedLock(sched->lock);
+    while (!sched->exhausted && num_oids < sched->share_size) {
+        Int4 oid = BlastSeqSrcChunkIteratorNext(seq_src, sched->itr);
+        if (oid == BLAST_SEQSRC_ERROR) {
+            num_oids = BLAST_SEQSRC_ERROR;
+            break;
+        }
+        if (oid == BLAST_SEQSRC_EOF)
+            sched->exhausted = TRUE;
+        else
+            share->oids[num_oids++] = oid;
+    }
+    s_SchedUnlock(sched->lock);
+    if (num_oids == BLAST_SEQSRC_ERROR)
+        return BLAST_SEQSRC_ERROR;
+
+    if (num_oids > 0) {
+        s_SchedLock(share->lock);
+        share->begin = 0;
+        share->end = num_oids;
+        s_SchedUnlock(share->lock);
+    }
+    return num_oids;
+}
+
+/** Give a thread whose share is exhausted the back half of the largest
+ * remaining share. No two locks are ever held at the same time.
+ * @param sched The scheduler [in][out]
+ * @param thief Index of the thread without work [in]
+ * @return TRUE if any work was found
+ */
+static Boolean s_SchedSteal(BlastSubjectScheduler* sched, Int4 thief)
+{
+    SBlastSchedShare* share = &sched->share[thief];
+
+    for (;;) {
+        SBlastSchedShare* victim = NULL;
+        Int4 largest = 0;
+        Int4 i, begin = 0, end = 0;
+
+        for (i = 0; i < sched->num_threads; i++) {
+            SBlastSchedShare* other = &sched->share[i];
+            Int4 size;
+            if (i == thief)
+                continue;
+            s_SchedLock(other->lock);
+            size = other->end - other->begin;
+            s_SchedUnlock(other->lock);
+            if (size > largest) {
+                largest = size;
+                victim = other;
+            }
+        }
+        if (!victim)
+            return FALSE;
+
+        /* the victim may have made progress since it was inspected; the
+           stolen subjects are copied before the victim can refill its
+           array, which it only does once its share is empty */
+        s_SchedLock(victim->lock);
+        if (victim->end > victim->begin) {
+            end = victim->end;
+            begin = end - (end - victim->begin + 1) / 2;
+            victim->end = begin;
+            memcpy(share->oids, victim->oids + begin,
+                   (end - begin) * sizeof(Int4));
+        }
+        s_SchedUnlock(victim->lock);
+
+        if (begin < end) {
+            s_SchedLock(share->lock);
+            share->begin = 0;
+            share->end = end - begin;
+            share->num_steals++;
+            s_SchedUnlock(share->lock);
+            return TRUE;
+        }
+    }
+}
+
+/** Split a subject sequence handed out to a thread if it is longer than a
+ * piece; the thread gets the first piece
+ * @param sched The scheduler [in][out]
+ * @param share Share of the calling thread [in][out]
+ * @param seq_src BlastSeqSrc of the calling thread [in]
+ * @param oid Ordinal id of the subject [in]
+ * @return 0 on success, -1 if out of memory
+ */
+static Int2 s_SchedSplit(BlastSubjectScheduler* sched,
+                         SBlastSchedShare* share, const BlastSeqSrc* seq_src,
+                         Int4 oid)
+{
+    SBlastSplitSubject* split = NULL;
+    Int4 length;
+
+    if (sched->piece_length == 0)
+        return 0;
+    length = BlastSeqSrcGetSeqLen(seq_src, (void*) &oid);
+    if (length <= sched->piece_length)
+        return 0;
+
+    split = (SBlastSplitSubject*) calloc(1, sizeof(SBlastSplitSubject));
+    if (!split)
+        return -1;
+    split->oid = oid;
+    split->num_pieces = (Int4) (((Int8) length + sched->piece_length - 1) /
+                                sched->piece_length);
+    split->next_piece = 1;
+    split->hsp_lists = (BlastHSPList**) calloc(split->num_pieces,
+                                               sizeof(BlastHSPList*));
+    split->merge_offsets = (Int4*) calloc(split->num_pieces, sizeof(Int4));
+    split->merge_overlaps = (Int4*) calloc(split->num_pieces, sizeof(Int4));
+    if (!split->hsp_lists || !split->merge_offsets || !split->merge_overlaps) {
+        s_SplitSubjectFree(split);
+        return -1;
+    }
+
+    s_SchedLock(sched->lock);
+    split->next = sched->split;
+    sched->split = split;
+    s_SchedUnlock(sched->lock);
+
+    share->split = split;
+    share->piece = 0;
+    share->num_pieces++;
+    return 0;
+}
+
+/** Give a thread a piece of a split subject that no thread has searched yet
+ * @param sched The scheduler [in][out]
+ * @param share Share of the calling thread [in][out]
+ * @return TRUE if a piece was found
+ */
+static Boolean s_SchedTakePiece(BlastSubjectScheduler* sched,
+                                SBlastSchedShare* share)
+{
+    SBlastSplitSubject* split = NULL;
+
+    if (sched->piece_length == 0)
+        return FALSE;
+
+    s_SchedLock(sched->lock);
+    for (split = sched->split; split; split = split->next) {
+        if (split->next_piece < split->num_pieces) {
+            share->split = split;
+            share->piece = split->next_piece++;
+            break;
+        }
+    }
+    s_SchedUnlock(sched->lock);
+
+    if (!split)
+        return FALSE;
+    share->num_subjects++;
+    share->num_pieces++;
+    return TRUE;
+}
+
+Int4 BlastSubjectSchedulerNext(BlastSubjectScheduler* sched,
+                               const BlastSeqSrc* seq_src,
+                               Int4 thread_index)
+{
+    SBlastSchedShare* share;
+
+    if (!sched || !seq_src || thread_index < 0 ||
+        thread_index >= sched->num_threads)
+        return BLAST_SEQSRC_ERROR;
+
+    share = &sched->share[thread_index];
+    share->split = NULL;
+    share->piece = 0;
+
+    for (;;) {
+        Int4 index = -1;
+
+        s_SchedLock(share->lock);
+        if (share->begin < share->end)
+            index = share->begin++;
+        s_SchedUnlock(share->lock);
+
+        if (index >= 0) {
+            Int4 oid = share->oids[index];
+            share->num_subjects++;
+            if (s_SchedSplit(sched, share, seq_src, oid) != 0)
+                return BLAST_SEQSRC_ERROR;
+            return oid;
+        }
+
+        /* pieces of split subjects go first, so that the threads search
+           a long subject together instead of one of them being left
+           with it at the end */
+        if (s_SchedTakePiece(sched, share))
+            return share->split->oid;
+
+        switch (s_SchedFill(sched, share, seq_src)) {
+        case BLAST_SEQSRC_ERROR:
+            return BLAST_SEQSRC_ERROR;
+        case 0:
+            if (!s_SchedSteal(sched, thread_index))
+                return BLAST_SEQSRC_EOF;
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+void BlastSubjectSchedulerGetPiece(const BlastSubjectScheduler* sched,
+                                   Int4 thread_index,
+                                   BlastSubjectPiece* piece)
+{
+    const SBlastSchedShare* share = NULL;
+
+    if (!piece)
+        return;
+    piece->index = 0;
+    piece->num_pieces = 1;
+    piece->begin = 0;
+    piece->end = INT4_MAX;
+
+    if (!sched || thread_index < 0 || thread_index >= sched->num_threads)
+        return;
+    share = &sched->share[thread_index];
+    if (!share->split)
+        return;
+
+    piece->index = share->piece;
+    piece->num_pieces = share->split->num_pieces;
+    piece->begin = share->piece * sched->piece_length;
+    if (piece->index < piece->num_pieces - 1)
+        piece->end = piece->begin + sched->piece_length;
+}
+
+Int2 BlastSubjectSchedulerMergePiece(BlastSubjectScheduler* sched,
+                                     Int4 thread_index,
+                                     BlastHSPList** hsp_list,
+                                     Int4 merge_offset, Int4 merge_overlap,
+                                     Int4 hsp_num_max, Boolean allow_gap)
+{
+    SBlastSplitSubject* split = NULL;
+    BlastHSPList* combined_hsp_list = NULL;
+    Boolean done;
+    Int2 status = 0;
+    Int4 i;
+
+    if (!sched || !hsp_list || thread_index < 0 ||
+        thread_index >= sched->num_threads ||
+        !(split = sched->share[thread_index].split))
+        return -1;
+
+    s_SchedLock(sched->lock);
+    i = sched->share[thread_index].piece;
+    split->hsp_lists[i] = *hsp_list;
+    split->merge_offsets[i] = merge_offset;
+    split->merge_overlaps[i] = merge_overlap;
+    done = (++split->num_done == split->num_pieces);
+    s_SchedUnlock(sched->lock);
+
+    *hsp_list = NULL;
+    if (!done)
+        return 0;
+
+    /* the other threads are done with this subject, so its HSP lists can
+       be merged without holding the lock */
+    for (i = 0; i < split->num_pieces; i++) {
+        if (status == 0) {
+            status = Blast_HSPListsMerge(&split->hsp_lists[i],
+                                         &combined_hsp_list, hsp_num_max,
+                                         &split->merge_offsets[i], INT4_MIN,
+                                         split->merge_overlaps[i], allow_gap);
+        }
+        split->hsp_lists[i] = Blast_HSPListFree(split->hsp_lists[i]);
+    }
+    if (status != 0) {
+        Blast_HSPListFree(combined_hsp_list);
+        return -1;
+    }
+
+    *hsp_list = combined_hsp_list;
+    return 1;
+}
+
+void BlastSubjectSchedulerGetThreadStats(const BlastSubjectScheduler* sched,
+                                         Int4 thread_index,
+                                         BlastThreadStats* stats)
+{
+    if (!stats)
+        return;
+    memset(stats, 0, sizeof(*stats));
+    if (!sched || thread_index < 0 || thread_index >= sched->num_threads)
+        return;
+    stats->num_subjects = sched->share[thread_index].num_subjects;
+    stats->num_steals = sched->share[thread_index].num_steals;
+    stats->num_pieces = sched->share[thread_index].num_pieces;
+}
@@ -35,6 +35,7 @@
 
 #include <algo/blast/core/blast_seqsrc.h>
 #include <algo/blast/core/blast_seqsrc_impl.h>
+#include <algo/blast/core/blast_sched.h>
 
 /** Complete type definition of Blast Sequence Source ADT.
  * The members of this structure should only be accessed by BlastSeqSrc
@@ -79,6 +80,12 @@ struct BlastSeqSrc {
                                                   chunk "bookmark"
                                                   */
    
+    BlastSubjectScheduler* Scheduler; /**< Shared source of subject
+                                         sequences for multi-threaded
+                                         iteration, not owned */
+    Int4              SchedulerThread; /**< Index of the thread using this
+                                          copy in Scheduler */
+
     void*             DataStructure;  /**< ADT holding the sequence data */
 
     char*             InitErrorStr;   /**< initialization error string */
@@ -173,6 +180,29 @@ void BlastSeqSrcSetNumberOfThreads(BlastSeqSrc* seq_src, int n_threads)
     (*seq_src->SetNumberOfThreads)(seq_src->DataStructure, n_threads);
 }
 
+void BlastSeqSrcSetScheduler(BlastSeqSrc* seq_src, 
+                             BlastSubjectScheduler* scheduler,
+                             Int4 thread_index)
+{
+    if (!seq_src) {
+        return;
+    }
+    seq_src->Scheduler = scheduler;
+    seq_src->SchedulerThread = thread_index;
+}
+
+BlastSubjectScheduler* BlastSeqSrcGetScheduler(const BlastSeqSrc* seq_src,
+                                               Int4* thread_index)
+{
+    if (!seq_src || !seq_src->Scheduler) {
+        return NULL;
+    }
+    if (thread_index) {
+        *thread_index = seq_src->SchedulerThread;
+    }
+    return seq_src->Scheduler;
+}
+
 Int4
 BlastSeqSrcGetNumSeqs(const BlastSeqSrc* seq_src)
 {
@@ -429,6 +459,20 @@ Int4 BlastSeqSrcIteratorNext(const BlastSeqSrc* seq_src,
     ASSERT(itr);
     ASSERT(seq_src->IterNext);
 
+    if (seq_src->Scheduler) {
+        return BlastSubjectSchedulerNext(seq_src->Scheduler, seq_src,
+                                         seq_src->SchedulerThread);
+    }
+    return (*seq_src->IterNext)(seq_src->DataStructure, itr);
+}
+
+Int4 BlastSeqSrcChunkIteratorNext(const BlastSeqSrc* seq_src, 
+                                  BlastSeqSrcIterator* itr)
+{
+    ASSERT(seq_src);
+    ASSERT(itr);
+    ASSERT(seq_src->IterNext);
+
     return (*seq_src->IterNext)(seq_src->DataStructure, itr);
 }
 
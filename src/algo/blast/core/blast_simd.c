@@ -0,0 +1,836 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ */
+
+/** @file blast_simd.c
+ * Runtime CPU dispatch and vector kernels for the BLAST engine
+ * @sa blast_simd.h
+ */
+
+#include <algo/blast/core/blast_simd.h>
+#include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE */
+
+/* The vector kernels are compiled with per-function target attributes,
+   so that the rest of the library does not need any special compiler
+   flags and still runs on CPUs without SSE4.1 */
+#if (defined(__x86_64__) || defined(__i386__))  &&  \
+    (defined(__clang__)  ||  \
+     (defined(__GNUC__)  &&  \
+      (__GNUC__ > 4  ||  (__GNUC__ == 4  &&  __GNUC_MINOR__ >= 9))))
+#  define BLAST_SIMD_X86 1
+#  include <immintrin.h>
+#endif
+
+/** Level detected on first use; -1 means not yet initialized */
+static volatile int s_DetectedLevel = -1;
+
+/** Cap set by BlastSimdSetMaxLevel */
+static volatile int s_MaxLevel = eBlastSimdAVX2;
+
+/** Determine the best level supported by the CPU, honoring the
+ *  BLAST_SIMD environment variable
+ * @return the detected level
+ */
+static EBlastSimdLevel s_DetectLevel(void)
+{
+    EBlastSimdLevel level = eBlastSimdNone;
+    const char* env = getenv("BLAST_SIMD");
+
+#ifdef BLAST_SIMD_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        level = eBlastSimdAVX2;
+    else if (__builtin_cpu_supports("sse4.1"))
+        level = eBlastSimdSSE41;
+#endif
+
+    if (env) {
+        if (strcmp(env, "none") == 0)
+            level = eBlastSimdNone;
+        else if (strcmp(env, "sse4.1") == 0)
+            level = MIN(level, eBlastSimdSSE41);
+    }
+    return level;
+}
+
+EBlastSimdLevel BlastSimdGetLevel(void)
+{
+    if (s_DetectedLevel < 0)
+        s_DetectedLevel = s_DetectLevel();
+    return (EBlastSimdLevel) MIN(s_DetectedLevel, s_MaxLevel);
+}
+
+EBlastSimdLevel BlastSimdSetMaxLevel(EBlastSimdLevel level)
+{
+    EBlastSimdLevel old_level = (EBlastSimdLevel) s_MaxLevel;
+    s_MaxLevel = level;
+    return old_level;
+}
+
+/** Reference implementation of BlastSimdXDropScan; the loop body is
+ *  the one used by the scalar ungapped extension routines
+ */
+static Int4 s_XDropScanScalar(const Int4* scores, Int4 num, Int4 dropoff,
+                              Boolean stop_at_nonpositive, Int4* score_ptr,
+                              Int4* maxscore_ptr, Int4* best)
+{
+    Int4 i;
+    Int4 score = *score_ptr;
+    Int4 maxscore = *maxscore_ptr;
+
+    for (i = 0; i < num; i++) {
+        score += scores[i];
+
+        if (score > maxscore) {
+            maxscore = score;
+            *best = i;
+        }
+        if ((stop_at_nonpositive && score <= 0) ||
+            (maxscore - score) >= dropoff)
+            break;
+    }
+
+    *score_ptr = score;
+    *maxscore_ptr = maxscore;
+    return i;
+}
+
+#ifdef BLAST_SIMD_X86
+
+/** Resolve the outcome of one vector of an X-drop scan. 'cum' holds the
+ *  running scores, 'prefmax' the running best scores and 'stop_mask'
+ *  has a bit set for every lane where the extension would stop.
+ * @return TRUE if the extension stopped within this vector
+ */
+static NCBI_INLINE Boolean
+s_XDropResolveLanes(const Int4* cum, const Int4* prefmax, Int4 lanes,
+                    int stop_mask, Int4 base, Int4* score, Int4* maxscore,
+                    Int4* best, Int4* stop_lane)
+{
+    Int4 last, j;
+    Int4 new_max;
+
+    stop_mask &= (1 << lanes) - 1;
+    last = stop_mask ? __builtin_ctz(stop_mask) : lanes - 1;
+    new_max = prefmax[last];
+
+    /* the best score was last improved at the first position that
+       reached its final value */
+    if (new_max > *maxscore) {
+        for (j = 0; cum[j] != new_max; j++)
+            ;
+        *best = base + j;
+        *maxscore = new_max;
+    }
+    *score = cum[last];
+    *stop_lane = last;
+    return stop_mask != 0;
+}
+
+/** SSE4.1 version of BlastSimdXDropScan */
+__attribute__((target("sse4.1")))
+static Int4 s_XDropScanSSE41(const Int4* scores, Int4 num, Int4 dropoff,
+                             Boolean stop_at_nonpositive, Int4* score,
+                             Int4* maxscore, Int4* best)
+{
+    const __m128i kMinusInf = _mm_set1_epi32(INT4_MIN);
+    const __m128i kDropoff = _mm_set1_epi32(dropoff - 1);
+    const __m128i kOne = _mm_set1_epi32(1);
+    Int4 base;
+
+    for (base = 0; base < num; base += 4) {
+        Int4 lanes = MIN(4, num - base);
+        Int4 tmp[4] = {0, 0, 0, 0};
+        Int4 cum[4], prefmax[4];
+        Int4 stop_lane;
+        __m128i x, m, stop;
+
+        if (lanes == 4) {
+            x = _mm_loadu_si128((const __m128i *)(scores + base));
+        } else {
+            memcpy(tmp, scores + base, lanes * sizeof(Int4));
+            x = _mm_loadu_si128((const __m128i *)tmp);
+        }
+
+        /* inclusive prefix sum, offset by the running score */
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+        x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+        x = _mm_add_epi32(x, _mm_set1_epi32(*score));
+
+        /* inclusive prefix maximum, seeded with the best score */
+        m = _mm_max_epi32(x, _mm_alignr_epi8(x, kMinusInf, 12));
+        m = _mm_max_epi32(m, _mm_alignr_epi8(m, kMinusInf, 8));
+        m = _mm_max_epi32(m, _mm_set1_epi32(*maxscore));
+
+        stop = _mm_cmpgt_epi32(_mm_sub_epi32(m, x), kDropoff);
+        if (stop_at_nonpositive)
+            stop = _mm_or_si128(stop, _mm_cmplt_epi32(x, kOne));
+
+        _mm_storeu_si128((__m128i *)cum, x);
+        _mm_storeu_si128((__m128i *)prefmax, m);
+        if (s_XDropResolveLanes(cum, prefmax, lanes,
+                           _mm_movemask_ps(_mm_castsi128_ps(stop)), base,
+                           score, maxscore, best, &stop_lane))
+            return base + stop_lane;
+    }
+    return num;
+}
+
+/** AVX2 version of BlastSimdXDropScan */
+__attribute__((target("avx2")))
+static Int4 s_XDropScanAVX2(const Int4* scores, Int4 num, Int4 dropoff,
+                            Boolean stop_at_nonpositive, Int4* score,
+                            Int4* maxscore, Int4* best)
+{
+    const __m256i kMinusInf = _mm256_set1_epi32(INT4_MIN);
+    const __m256i kDropoff = _mm256_set1_epi32(dropoff - 1);
+    const __m256i kOne = _mm256_set1_epi32(1);
+    Int4 base;
+
+    for (base = 0; base < num; base += 8) {
+        Int4 lanes = MIN(8, num - base);
+        Int4 tmp[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+        Int4 cum[8], prefmax[8];
+        Int4 stop_lane;
+        __m256i x, m, t, stop;
+
+        if (lanes == 8) {
+            x = _mm256_loadu_si256((const __m256i *)(scores + base));
+        } else {
+            memcpy(tmp, scores + base, lanes * sizeof(Int4));
+            x = _mm256_loadu_si256((const __m256i *)tmp);
+        }
+
+        /* inclusive prefix sum within each 128-bit half, then carry
+           the total of the low half into the high half */
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 4));
+        x = _mm256_add_epi32(x, _mm256_slli_si256(x, 8));
+        t = _mm256_shuffle_epi32(x, 0xFF);
+        x = _mm256_add_epi32(x, _mm256_permute2x128_si256(t, t, 0x08));
+        x = _mm256_add_epi32(x, _mm256_set1_epi32(*score));
+
+        /* inclusive prefix maximum, built the same way */
+        m = _mm256_max_epi32(x, _mm256_alignr_epi8(x, kMinusInf, 12));
+        m = _mm256_max_epi32(m, _mm256_alignr_epi8(m, kMinusInf, 8));
+        t = _mm256_shuffle_epi32(m, 0xFF);
+        m = _mm256_max_epi32(m, _mm256_permute2x128_si256(t, kMinusInf,
+                                                          0x02));
+        m = _mm256_max_epi32(m, _mm256_set1_epi32(*maxscore));
+
+        stop = _mm256_cmpgt_epi32(_mm256_sub_epi32(m, x), kDropoff);
+        if (stop_at_nonpositive)
+            stop = _mm256_or_si256(stop, _mm256_cmpgt_epi32(kOne, x));
+
+        _mm256_storeu_si256((__m256i *)cum, x);
+        _mm256_storeu_si256((__m256i *)prefmax, m);
+        if (s_XDropResolveLanes(cum, prefmax, lanes,
+                       _mm256_movemask_ps(_mm256_castsi256_ps(stop)), base,
+                       score, maxscore, best, &stop_lane))
+            return base + stop_lane;
+    }
+    return num;
+}
+
+#endif /* BLAST_SIMD_X86 */
+
+Int4 BlastSimdXDropScan(const Int4* scores, Int4 num, Int4 dropoff,
+                        Boolean stop_at_nonpositive, Int4* score,
+                        Int4* maxscore, Int4* best)
+{
+    ASSERT(num <= BLAST_SIMD_XDROP_BLOCK);
+
+    switch (BlastSimdGetLevel()) {
+#ifdef BLAST_SIMD_X86
+    case eBlastSimdAVX2:
+        return s_XDropScanAVX2(scores, num, dropoff, stop_at_nonpositive,
+                               score, maxscore, best);
+    case eBlastSimdSSE41:
+        return s_XDropScanSSE41(scores, num, dropoff, stop_at_nonpositive,
+                                score, maxscore, best);
+#endif
+    default:
+        return s_XDropScanScalar(scores, num, dropoff, stop_at_nonpositive,
+                                 score, maxscore, best);
+    }
+}
+
+/** Number of bytes in one vector of the striped Smith-Waterman engine */
+#define SW_VECTOR_BYTES 16
+
+/** Largest score an 8-bit lane of the striped Smith-Waterman engine
+ *  can hold */
+#define SW_BYTE_MAX 255
+
+/** Lane widths of the striped Smith-Waterman engine */
+enum {
+    eSWLanes8 = 0,      /**< 16 unsigned 8-bit lanes */
+    eSWLanes16,         /**< 8 signed 16-bit lanes */
+    eSWLanes32,         /**< 4 signed 32-bit lanes */
+    eSWNumLaneWidths    /**< number of lane widths */
+};
+
+/** Score given to query positions that pad out the last stripe of a
+ *  32-bit profile */
+#define SW_PAD_SCORE_32 (INT4_MIN / 2)
+
+/** Query profile for the striped Smith-Waterman engine */
+struct BlastSWProfile {
+    const Uint1* query;     /**< query the profile was built from */
+    Int4 query_length;      /**< number of query positions */
+    Int4** matrix;          /**< matrix the profile was built from */
+    Int4 alphabet_size;     /**< number of distinct subject letters */
+    Int4 min_score;         /**< smallest substitution score above
+                                 -SW_BYTE_MAX; lower scores, such as the
+                                 BLAST_SCORE_MIN of invalid letters, can
+                                 never extend an 8-bit lane score and are
+                                 masked out instead of biased */
+    Int4 max_score;         /**< largest substitution score */
+    Int4 lane_bits;         /**< lane width used for the last score, or
+                                 0 for the scalar code */
+    Int4* scores;           /**< scores[c * query_length + i] is the score
+                                 of query position i against letter c */
+    Uint1* striped[eSWNumLaneWidths];     /**< striped layouts, aligned to
+                                               SW_VECTOR_BYTES; built on
+                                               first use */
+    Uint1* striped_mem[eSWNumLaneWidths]; /**< allocations backing
+                                               'striped' */
+    Uint1* work;            /**< aligned scratch space for H and E */
+    Uint1* work_mem;        /**< allocation backing 'work' */
+};
+
+/** Allocate memory aligned to SW_VECTOR_BYTES
+ * @param size Number of bytes needed [in]
+ * @param mem Set to the pointer that must later be freed [out]
+ * @return The aligned pointer, or NULL
+ */
+static Uint1* s_SWAlignedAlloc(size_t size, Uint1** mem)
+{
+    *mem = (Uint1 *)malloc(size + SW_VECTOR_BYTES - 1);
+    if (*mem == NULL)
+        return NULL;
+    return (Uint1 *)(((size_t)*mem + SW_VECTOR_BYTES - 1) &
+                     ~(size_t)(SW_VECTOR_BYTES - 1));
+}
+
+/** Number of vectors in one stripe of the query for a lane width */
+static NCBI_INLINE Int4 s_SWSegmentLength(Int4 query_length, int width)
+{
+    Int4 lanes = SW_VECTOR_BYTES >> width;
+    return (query_length + lanes - 1) / lanes;
+}
+
+BlastSWProfile* BlastSWProfileNew(const Uint1* query, Int4 query_length,
+                                  Int4** matrix, EBlastSWProfileType type,
+                                  Int4 alphabet_size)
+{
+    BlastSWProfile* retval;
+    Int4 c, i;
+
+    ASSERT(query_length > 0);
+    retval = (BlastSWProfile *)calloc(1, sizeof(BlastSWProfile));
+    if (retval == NULL)
+        return NULL;
+
+    retval->query = query;
+    retval->query_length = query_length;
+    retval->matrix = matrix;
+    retval->alphabet_size = alphabet_size;
+    retval->scores = (Int4 *)malloc(alphabet_size * query_length *
+                                    sizeof(Int4));
+    /* three rows of vectors for the 32-bit engine, the widest one */
+    retval->work = s_SWAlignedAlloc(3 * SW_VECTOR_BYTES *
+                        s_SWSegmentLength(query_length, eSWLanes32),
+                        &retval->work_mem);
+    if (retval->scores == NULL || retval->work == NULL)
+        return BlastSWProfileFree(retval);
+
+    retval->min_score = INT4_MAX;
+    retval->max_score = INT4_MIN;
+    for (c = 0; c < alphabet_size; c++) {
+        Int4* row = retval->scores + c * query_length;
+        for (i = 0; i < query_length; i++) {
+            switch (type) {
+            case eBlastSWProfileQueryRows:
+                row[i] = matrix[query[i]][c];
+                break;
+            case eBlastSWProfileSubjectRows:
+                row[i] = matrix[c][query[i]];
+                break;
+            default:
+                row[i] = matrix[i][c];
+                break;
+            }
+            if (row[i] > -SW_BYTE_MAX)
+                retval->min_score = MIN(retval->min_score, row[i]);
+            retval->max_score = MAX(retval->max_score, row[i]);
+        }
+    }
+    return retval;
+}
+
+BlastSWProfile* BlastSWProfileFree(BlastSWProfile* profile)
+{
+    int width;
+
+    if (profile == NULL)
+        return NULL;
+
+    for (width = 0; width < eSWNumLaneWidths; width++)
+        sfree(profile->striped_mem[width]);
+    sfree(profile->work_mem);
+    sfree(profile->scores);
+    sfree(profile);
+    return NULL;
+}
+
+Boolean BlastSWProfileMatches(const BlastSWProfile* profile,
+                              const Uint1* query, Int4 query_length,
+                              Int4** matrix)
+{
+    return profile != NULL && profile->query == query &&
+           profile->query_length == query_length &&
+           profile->matrix == matrix;
+}
+
+/** Return the striped layout of a profile for one lane width, building
+ *  it if necessary. Query position i of the profile for letter c is
+ *  stored in lane i / seg_len of vector c * seg_len + i % seg_len
+ * @param profile The query profile [in][out]
+ * @param width One of the lane width constants [in]
+ * @return The striped layout, or NULL if out of memory
+ */
+static const Uint1* s_SWStripedProfile(BlastSWProfile* profile, int width)
+{
+    Int4 query_length = profile->query_length;
+    Int4 lanes = SW_VECTOR_BYTES >> width;
+    Int4 seg_len = s_SWSegmentLength(query_length, width);
+    Int4 c, k, lane;
+    Uint1* striped;
+
+    if (profile->striped[width])
+        return profile->striped[width];
+
+    /* the 8-bit layout is followed by the masks of the diagonal scores */
+    striped = s_SWAlignedAlloc((width == eSWLanes8 ? 2 : 1) *
+                               profile->alphabet_size * seg_len *
+                               SW_VECTOR_BYTES,
+                               &profile->striped_mem[width]);
+    if (striped == NULL)
+        return NULL;
+
+    for (c = 0; c < profile->alphabet_size; c++) {
+        const Int4* row = profile->scores + c * query_length;
+        Uint1* vec = striped + c * seg_len * SW_VECTOR_BYTES;
+        Uint1* mask = vec + profile->alphabet_size * seg_len *
+                      SW_VECTOR_BYTES;
+
+        for (k = 0; k < seg_len; k++, vec += SW_VECTOR_BYTES,
+                                      mask += SW_VECTOR_BYTES) {
+            for (lane = 0; lane < lanes; lane++) {
+                Int4 i = lane * seg_len + k;
+                switch (width) {
+                case eSWLanes8:
+                    /* biased so that all scores are nonnegative; scores
+                       too low to bias and padding are masked, so that
+                       the cell only gets gap scores */
+                    if (i < query_length && row[i] > -SW_BYTE_MAX) {
+                        vec[lane] = (Uint1)(row[i] - profile->min_score);
+                        mask[lane] = SW_BYTE_MAX;
+                    } else {
+                        vec[lane] = 0;
+                        mask[lane] = 0;
+                    }
+                    break;
+                case eSWLanes16:
+                    ((Int2 *)vec)[lane] = (Int2)(i < query_length ?
+                                          MAX(row[i], INT2_MIN) : INT2_MIN);
+                    break;
+                default:
+                    ((Int4 *)vec)[lane] = i < query_length ?
+                                          row[i] : SW_PAD_SCORE_32;
+                    break;
+                }
+            }
+        }
+    }
+    profile->striped[width] = striped;
+    return striped;
+}
+
+/** Return subject letter j, unpacking ncbi2na if necessary */
+#define SW_SUBJECT_LETTER(s, j, packed) \
+    ((packed) ? NCBI2NA_UNPACK_BASE((s)[(j) / 4], 3 - ((j) % 4)) : (s)[j])
+
+/** Scalar Smith-Waterman over the unstriped profile; used when no vector
+ *  engine is available. Values that are not positive never contribute
+ *  to a local alignment, so all of them are treated alike
+ */
+static Int4 s_SWProfileScoreScalar(const BlastSWProfile* profile,
+                                   const Uint1* subject, Int4 subject_length,
+                                   Boolean subject_is_packed,
+                                   Int4 gap_open_extend, Int4 gap_extend)
+{
+    Int4 query_length = profile->query_length;
+    Int4* h = (Int4 *)profile->work;
+    Int4* e = h + query_length + 1;
+    Int4 best = 0;
+    Int4 i, j;
+
+    memset(h, 0, (query_length + 1) * sizeof(Int4));
+    memset(e, 0, (query_length + 1) * sizeof(Int4));
+
+    for (j = 0; j < subject_length; j++) {
+        const Int4* row = profile->scores + query_length *
+                          SW_SUBJECT_LETTER(subject, j, subject_is_packed);
+        Int4 diag = 0, f = 0;
+
+        for (i = 1; i <= query_length; i++) {
+            Int4 score = MAX(diag + row[i - 1], 0);
+            e[i] = MAX(e[i] - gap_extend, h[i] - gap_open_extend);
+            score = MAX(score, e[i]);
+            score = MAX(score, f);
+            f = MAX(f - gap_extend, score - gap_open_extend);
+            f = MAX(f, 0);
+            e[i] = MAX(e[i], 0);
+            diag = h[i];
+            h[i] = score;
+            best = MAX(best, score);
+        }
+    }
+    return best;
+}
+
+#ifdef BLAST_SIMD_X86
+
+/** Threshold for leaving the lazy-F loop: once no lane has a vertical
+ *  gap score above max(H - threshold, 0) the remaining cells of the
+ *  column are final. Normally this is the gap open plus extend cost, but
+ *  with a zero gap open cost a cell just raised by F passes on exactly
+ *  H - gap_extend to its neighbor, so ties must keep the loop going
+ */
+static NCBI_INLINE Int4 s_SWLazyFThreshold(Int4 gap_open_extend,
+                                           Int4 gap_extend)
+{
+    return gap_open_extend > gap_extend ? gap_open_extend
+                                        : gap_open_extend + 1;
+}
+
+/** Striped Smith-Waterman with 16 unsigned 8-bit lanes. Scores are kept
+ *  biased so that they never go below zero; the caller must check the
+ *  result for saturation. The profile is followed by masks that zero
+ *  the diagonal score of cells whose substitution score is too low to
+ *  be biased
+ * @return the best score found
+ */
+__attribute__((target("sse4.1")))
+static Int4 s_SWStriped8(const __m128i* profile, Int4 seg_len,
+                         Int4 alphabet_size,
+                         const Uint1* subject, Int4 subject_length,
+                         Boolean subject_is_packed, Int4 bias,
+                         Int4 gap_open_extend, Int4 gap_extend,
+                         __m128i* work)
+{
+    const __m128i v_zero = _mm_setzero_si128();
+    const __m128i v_bias = _mm_set1_epi8((char)bias);
+    const __m128i v_gap_oe = _mm_set1_epi8((char)gap_open_extend);
+    const __m128i v_gap_e = _mm_set1_epi8((char)gap_extend);
+    const __m128i v_gap_test = _mm_set1_epi8((char)
+                        s_SWLazyFThreshold(gap_open_extend, gap_extend));
+    __m128i v_max = v_zero;
+    __m128i* h_store = work;
+    __m128i* h_load = work + seg_len;
+    __m128i* e_store = work + 2 * seg_len;
+    Uint1 lane_max[16];
+    Int4 best = 0;
+    Int4 i, j, k;
+
+    memset(work, 0, 3 * seg_len * sizeof(__m128i));
+
+    for (j = 0; j < subject_length; j++) {
+        const __m128i* prof = profile + seg_len *
+                        SW_SUBJECT_LETTER(subject, j, subject_is_packed);
+        const __m128i* mask = prof + alphabet_size * seg_len;
+        __m128i v_f = v_zero;
+        __m128i v_h = _mm_slli_si128(h_store[seg_len - 1], 1);
+        __m128i* tmp = h_load;
+        h_load = h_store;
+        h_store = tmp;
+
+        for (k = 0; k < seg_len; k++) {
+            __m128i v_e = e_store[k];
+            v_h = _mm_subs_epu8(_mm_adds_epu8(v_h, prof[k]), v_bias);
+            v_h = _mm_min_epu8(v_h, mask[k]);
+            v_h = _mm_max_epu8(v_h, v_e);
+            v_h = _mm_max_epu8(v_h, v_f);
+            v_max = _mm_max_epu8(v_max, v_h);
+            h_store[k] = v_h;
+
+            v_h = _mm_subs_epu8(v_h, v_gap_oe);
+            e_store[k] = _mm_max_epu8(_mm_subs_epu8(v_e, v_gap_e), v_h);
+            v_f = _mm_max_epu8(_mm_subs_epu8(v_f, v_gap_e), v_h);
+            v_h = h_load[k];
+        }
+
+        /* propagate vertical gaps across stripe boundaries until they
+           can no longer improve any score (the "lazy F" loop) */
+        for (i = 0; i < 16; i++) {
+            v_f = _mm_slli_si128(v_f, 1);
+            for (k = 0; k < seg_len; k++) {
+                v_h = _mm_max_epu8(h_store[k], v_f);
+                h_store[k] = v_h;
+                v_max = _mm_max_epu8(v_max, v_h);
+                v_h = _mm_subs_epu8(v_h, v_gap_oe);
+                e_store[k] = _mm_max_epu8(e_store[k], v_h);
+                v_f = _mm_subs_epu8(v_f, v_gap_e);
+                v_h = _mm_subs_epu8(h_store[k], v_gap_test);
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(
+                            _mm_subs_epu8(v_f, v_h), v_zero)) == 0xFFFF)
+                    goto next_column;
+            }
+        }
+next_column:
+        ;
+    }
+
+    _mm_storeu_si128((__m128i *)lane_max, v_max);
+    for (k = 0; k < 16; k++)
+        best = MAX(best, lane_max[k]);
+    return best;
+}
+
+/** Striped Smith-Waterman with 8 signed saturating 16-bit lanes; the
+ *  caller must check the result for saturation
+ * @return the best score found
+ */
+__attribute__((target("sse4.1")))
+static Int4 s_SWStriped16(const __m128i* profile, Int4 seg_len,
+                          const Uint1* subject, Int4 subject_length,
+                          Boolean subject_is_packed,
+                          Int4 gap_open_extend, Int4 gap_extend,
+                          __m128i* work)
+{
+    const __m128i v_zero = _mm_setzero_si128();
+    const __m128i v_gap_oe = _mm_set1_epi16((Int2)gap_open_extend);
+    const __m128i v_gap_e = _mm_set1_epi16((Int2)gap_extend);
+    const __m128i v_gap_test = _mm_set1_epi16((Int2)
+                        s_SWLazyFThreshold(gap_open_extend, gap_extend));
+    __m128i v_max = v_zero;
+    __m128i* h_store = work;
+    __m128i* h_load = work + seg_len;
+    __m128i* e_store = work + 2 * seg_len;
+    Int2 lane_max[8];
+    Int4 best = 0;
+    Int4 i, j, k;
+
+    memset(work, 0, 3 * seg_len * sizeof(__m128i));
+
+    for (j = 0; j < subject_length; j++) {
+        const __m128i* prof = profile + seg_len *
+                        SW_SUBJECT_LETTER(subject, j, subject_is_packed);
+        __m128i v_f = v_zero;
+        __m128i v_h = _mm_slli_si128(h_store[seg_len - 1], 2);
+        __m128i* tmp = h_load;
+        h_load = h_store;
+        h_store = tmp;
+
+        for (k = 0; k < seg_len; k++) {
+            __m128i v_e = e_store[k];
+            v_h = _mm_adds_epi16(v_h, prof[k]);
+            v_h = _mm_max_epi16(v_h, v_zero);
+            v_h = _mm_max_epi16(v_h, v_e);
+            v_h = _mm_max_epi16(v_h, v_f);
+            v_max = _mm_max_epi16(v_max, v_h);
+            h_store[k] = v_h;
+
+            v_h = _mm_subs_epi16(v_h, v_gap_oe);
+            e_store[k] = _mm_max_epi16(_mm_subs_epi16(v_e, v_gap_e), v_h);
+            v_f = _mm_max_epi16(_mm_subs_epi16(v_f, v_gap_e), v_h);
+            v_h = h_load[k];
+        }
+
+        for (i = 0; i < 8; i++) {
+            v_f = _mm_slli_si128(v_f, 2);
+            for (k = 0; k < seg_len; k++) {
+                v_h = _mm_max_epi16(h_store[k], v_f);
+                h_store[k] = v_h;
+                v_max = _mm_max_epi16(v_max, v_h);
+                v_h = _mm_subs_epi16(v_h, v_gap_oe);
+                e_store[k] = _mm_max_epi16(e_store[k], v_h);
+                v_f = _mm_subs_epi16(v_f, v_gap_e);
+                v_h = _mm_max_epi16(_mm_subs_epi16(h_store[k], v_gap_test),
+                                    v_zero);
+                if (!_mm_movemask_epi8(_mm_cmpgt_epi16(v_f, v_h)))
+                    goto next_column;
+            }
+        }
+next_column:
+        ;
+    }
+
+    _mm_storeu_si128((__m128i *)lane_max, v_max);
+    for (k = 0; k < 8; k++)
+        best = MAX(best, lane_max[k]);
+    return best;
+}
+
+/** Striped Smith-Waterman with 4 signed 32-bit lanes. Gap scores are
+ *  clamped at zero so that they cannot wrap around on long subjects
+ * @return the best score found
+ */
+__attribute__((target("sse4.1")))
+static Int4 s_SWStriped32(const __m128i* profile, Int4 seg_len,
+                          const Uint1* subject, Int4 subject_length,
+                          Boolean subject_is_packed,
+                          Int4 gap_open_extend, Int4 gap_extend,
+                          __m128i* work)
+{
+    const __m128i v_zero = _mm_setzero_si128();
+    const __m128i v_gap_oe = _mm_set1_epi32(gap_open_extend);
+    const __m128i v_gap_e = _mm_set1_epi32(gap_extend);
+    const __m128i v_gap_test = _mm_set1_epi32(
+                        s_SWLazyFThreshold(gap_open_extend, gap_extend));
+    __m128i v_max = v_zero;
+    __m128i* h_store = work;
+    __m128i* h_load = work + seg_len;
+    __m128i* e_store = work + 2 * seg_len;
+    Int4 lane_max[4];
+    Int4 best = 0;
+    Int4 i, j, k;
+
+    memset(work, 0, 3 * seg_len * sizeof(__m128i));
+
+    for (j = 0; j < subject_length; j++) {
+        const __m128i* prof = profile + seg_len *
+                        SW_SUBJECT_LETTER(subject, j, subject_is_packed);
+        __m128i v_f = v_zero;
+        __m128i v_h = _mm_slli_si128(h_store[seg_len - 1], 4);
+        __m128i* tmp = h_load;
+        h_load = h_store;
+        h_store = tmp;
+
+        for (k = 0; k < seg_len; k++) {
+            __m128i v_e = e_store[k];
+            v_h = _mm_add_epi32(v_h, prof[k]);
+            v_h = _mm_max_epi32(v_h, v_zero);
+            v_h = _mm_max_epi32(v_h, v_e);
+            v_h = _mm_max_epi32(v_h, v_f);
+            v_max = _mm_max_epi32(v_max, v_h);
+            h_store[k] = v_h;
+
+            v_h = _mm_max_epi32(_mm_sub_epi32(v_h, v_gap_oe), v_zero);
+            e_store[k] = _mm_max_epi32(_mm_sub_epi32(v_e, v_gap_e), v_h);
+            v_f = _mm_max_epi32(_mm_sub_epi32(v_f, v_gap_e), v_h);
+            v_h = h_load[k];
+        }
+
+        for (i = 0; i < 4; i++) {
+            v_f = _mm_slli_si128(v_f, 4);
+            for (k = 0; k < seg_len; k++) {
+                v_h = _mm_max_epi32(h_store[k], v_f);
+                h_store[k] = v_h;
+                v_max = _mm_max_epi32(v_max, v_h);
+                v_h = _mm_max_epi32(_mm_sub_epi32(v_h, v_gap_oe), v_zero);
+                e_store[k] = _mm_max_epi32(e_store[k], v_h);
+                v_f = _mm_max_epi32(_mm_sub_epi32(v_f, v_gap_e), v_zero);
+                v_h = _mm_max_epi32(_mm_sub_epi32(h_store[k], v_gap_test),
+                                    v_zero);
+                if (!_mm_movemask_epi8(_mm_cmpgt_epi32(v_f, v_h)))
+                    goto next_column;
+            }
+        }
+next_column:
+        ;
+    }
+
+    _mm_storeu_si128((__m128i *)lane_max, v_max);
+    for (k = 0; k < 4; k++)
+        best = MAX(best, lane_max[k]);
+    return best;
+}
+
+#endif /* BLAST_SIMD_X86 */
+
+Int4 BlastSWProfileScore(BlastSWProfile* profile, const Uint1* subject,
+                         Int4 subject_length, Boolean subject_is_packed,
+                         Int4 gap_open, Int4 gap_extend)
+{
+    Int4 gap_open_extend = gap_open + gap_extend;
+
+    profile->lane_bits = 0;
+    if (subject_length <= 0)
+        return 0;
+
+#ifdef BLAST_SIMD_X86
+    if (BlastSimdGetLevel() != eBlastSimdNone) {
+        Int4 query_length = profile->query_length;
+        __m128i* work = (__m128i *)profile->work;
+        const Uint1* striped;
+        Int4 bias = -profile->min_score;
+        Int4 score;
+
+        /* start with the narrowest lanes that can hold the inputs, and
+           widen them whenever the best score might have saturated */
+        if (bias >= 0 && profile->max_score + bias < SW_BYTE_MAX &&
+            gap_open_extend < SW_BYTE_MAX &&
+            (striped = s_SWStripedProfile(profile, eSWLanes8)) != NULL) {
+            profile->lane_bits = 8;
+            score = s_SWStriped8((const __m128i *)striped,
+                                 s_SWSegmentLength(query_length, eSWLanes8),
+                                 profile->alphabet_size,
+                                 subject, subject_length, subject_is_packed,
+                                 bias, gap_open_extend, gap_extend, work);
+            if (score < SW_BYTE_MAX - bias)
+                return score;
+        }
+        if (profile->max_score < INT2_MAX && gap_open_extend < INT2_MAX &&
+            (striped = s_SWStripedProfile(profile, eSWLanes16)) != NULL) {
+            profile->lane_bits = 16;
+            score = s_SWStriped16((const __m128i *)striped,
+                                  s_SWSegmentLength(query_length, eSWLanes16),
+                                  subject, subject_length, subject_is_packed,
+                                  gap_open_extend, gap_extend, work);
+            if (score < INT2_MAX)
+                return score;
+        }
+        if ((striped = s_SWStripedProfile(profile, eSWLanes32)) != NULL) {
+            profile->lane_bits = 32;
+            return s_SWStriped32((const __m128i *)striped,
+                                 s_SWSegmentLength(query_length, eSWLanes32),
+                                 subject, subject_length, subject_is_packed,
+                                 gap_open_extend, gap_extend, work);
+        }
+    }
+#endif
+
+    profile->lane_bits = 0;
+    return s_SWProfileScoreScalar(profile, subject, subject_length,
+                                  subject_is_packed, gap_open_extend,
+                                  gap_extend);
+}
+
+Int4 BlastSWProfileGetLaneBits(const BlastSWProfile* profile)
+{
+    return profile->lane_bits;
+}
@@ -34,6 +34,7 @@
 
 #include <algo/blast/core/blast_sw.h>
 #include <algo/blast/core/blast_util.h> /* for NCBI2NA_UNPACK_BASE */
+#include <algo/blast/core/blast_simd.h>
 
 /** swap (pointers to) a pair of sequences */
 #define SWAP_SEQS(A, B) {const Uint1 *tmp = (A); (A) = (B); (B) = tmp; }
@@ -239,6 +240,91 @@ static Int4 s_NuclSmithWaterman(const Uint1 *B, Int4 b_size,
 }
 
 
+/** Compute the score of the best local alignment between one query
+ *  context and a subject sequence with the striped vector engine. The
+ *  query profile of the context is kept in gap_align and reused for
+ *  all later subjects, as long as the query and score matrix it was
+ *  built from do not change.
+ * @param is_prot TRUE for protein searches [in]
+ * @param context Index of the query context [in]
+ * @param num_contexts Total number of query contexts [in]
+ * @param query The query context sequence [in]
+ * @param query_length Length of the query context [in]
+ * @param subject The subject sequence; packed ncbi2na for
+ *                nucleotide searches [in]
+ * @param subject_length Length of the subject sequence [in]
+ * @param gap_open Gap open penalty [in]
+ * @param gap_extend Gap extension penalty [in]
+ * @param gap_align Auxiliary data for gapped alignment 
+ *             (used for score matrix info and profiles) [in][out]
+ * @param score The score of the best local alignment [out]
+ * @return TRUE if the score was computed, FALSE if a profile
+ *         could not be allocated
+ */
+static Boolean s_SmithWatermanProfileScore(Boolean is_prot,
+                                   Int4 context, Int4 num_contexts,
+                                   const Uint1 *query, Int4 query_length,
+                                   const Uint1 *subject, Int4 subject_length,
+                                   Int4 gap_open, Int4 gap_extend,
+                                   BlastGapAlignStruct *gap_align,
+                                   Int4 *score)
+{
+   Int4 **matrix;
+   EBlastSWProfileType type;
+   Int4 alphabet_size;
+   BlastSWProfile *profile;
+
+   if (!is_prot) {
+      /* the subject is in ncbi2na, and the matrix is indexed 
+         by subject letter first (see s_NuclSmithWaterman) */
+      matrix = gap_align->sbp->matrix->data;
+      type = eBlastSWProfileSubjectRows;
+      alphabet_size = 4;
+   }
+   else if (gap_align->positionBased) {
+      matrix = gap_align->sbp->psi_matrix->pssm->data;
+      type = eBlastSWProfilePositional;
+      alphabet_size = BLASTAA_SIZE;
+   }
+   else {
+      matrix = gap_align->sbp->matrix->data;
+      type = eBlastSWProfileQueryRows;
+      alphabet_size = BLASTAA_SIZE;
+   }
+
+   if (query_length <= 0) {
+      *score = 0;
+      return TRUE;
+   }
+
+   if (gap_align->num_sw_profiles < num_contexts) {
+      BlastSWProfile **new_profiles = (BlastSWProfile **)realloc(
+                                      gap_align->sw_profiles,
+                                      num_contexts * sizeof(BlastSWProfile *));
+      if (new_profiles == NULL)
+         return FALSE;
+      memset(new_profiles + gap_align->num_sw_profiles, 0,
+             (num_contexts - gap_align->num_sw_profiles) *
+             sizeof(BlastSWProfile *));
+      gap_align->sw_profiles = new_profiles;
+      gap_align->num_sw_profiles = num_contexts;
+   }
+
+   profile = gap_align->sw_profiles[context];
+   if (!BlastSWProfileMatches(profile, query, query_length, matrix)) {
+      BlastSWProfileFree(profile);
+      profile = gap_align->sw_profiles[context] =
+         BlastSWProfileNew(query, query_length, matrix, type, alphabet_size);
+      if (profile == NULL)
+         return FALSE;
+   }
+
+   *score = BlastSWProfileScore(profile, subject, subject_length,
+                                (Boolean)!is_prot, gap_open, gap_extend);
+   return TRUE;
+}
+
+
 /** Values for the editing script operations in traceback */
 enum {
    EDIT_SUB         = eGapAlignSub,    /**< Substitution */
@@ -690,7 +776,19 @@ Int2 BLAST_SmithWatermanGetGappedScore (EBlastProgramType program_number,
          cutoff_score = hit_params->cutoffs[context].cutoff_score;
       }
 
-      if (is_prot) {
+      if (BlastSimdGetLevel() != eBlastSimdNone &&
+          s_SmithWatermanProfileScore(is_prot, context,
+                              query_info->last_context + 1,
+                              query->sequence + curr_ctx->query_offset,
+                              curr_ctx->query_length,
+                              subject->sequence,
+                              subject->length,
+                              score_params->gap_open,
+                              score_params->gap_extend,
+                              gap_align, &score)) {
+         /* score computed by the vector engine */
+      }
+      else if (is_prot) {
          score = s_SmithWatermanScoreOnly(
                               query->sequence + curr_ctx->query_offset,
                               curr_ctx->query_length,
@@ -74,6 +74,16 @@
  */
 #define HSP_MAX_WINDOW 11
 
+/** Minimum number of HSP lists with the same subject sequence that the
+ * multi-threaded traceback processes as one unit of work.
+ */
+#define TRACEBACK_MIN_GROUP_SIZE 8
+
+/** Number of units of work per thread the multi-threaded traceback aims for
+ * when splitting the HSP lists of subject sequences hit by many queries.
+ */
+#define TRACEBACK_GROUPS_PER_THREAD 4
+
 Int2
 Blast_HSPUpdateWithTraceback(BlastGapAlignStruct* gap_align, BlastHSP* hsp)
 {
@@ -250,17 +260,22 @@ s_HSPListPostTracebackUpdate(EBlastProgramType program_number,
    return 0;
 }
 
-/*
-    Comments in blast_traceback.h
+/** Compute gapped alignment with traceback for all HSPs from a single
+ * query/subject sequence pair; see Blast_TracebackFromHSPList.
+ * @param shared_target_t Translation of the subject sequence shared by
+ *        several HSP lists with the same subject, or NULL to translate the
+ *        subject for this HSP list only. Only used for in-frame searches with
+ *        a translated subject. [in|out]
  */
-Int2
-Blast_TracebackFromHSPList(EBlastProgramType program_number,
+static Int2
+s_TracebackFromHSPList(EBlastProgramType program_number,
    BlastHSPList* hsp_list, const BLAST_SequenceBlk* query_blk,
    BLAST_SequenceBlk* subject_blk, const BlastQueryInfo* query_info_in,
    BlastGapAlignStruct* gap_align, const BlastScoreBlk* sbp,
    const BlastScoringParameters* score_params,
    const BlastExtensionOptions* ext_options,
    const BlastHitSavingParameters* hit_params, const Uint1* gen_code_string,
+   SBlastTargetTranslation* shared_target_t,
    Boolean * fence_hit)
 {
    Int4 index;
@@ -331,6 +346,8 @@ Blast_TracebackFromHSPList(EBlastProgramType program_number,
           frame_offsets_a = frame_offsets =
               ContextOffsetsToOffsetArray(query_info_in);
       }
+      else if (shared_target_t && !kIsOutOfFrame)
+         target_t = shared_target_t;
       else
       	BlastTargetTranslationNew(subject_blk, gen_code_string, program_number, kIsOutOfFrame, &target_t);
       if (kIsOutOfFrame)
@@ -615,7 +632,9 @@ Blast_TracebackFromHSPList(EBlastProgramType program_number,
       }
    }
 
-   target_t = BlastTargetTranslationFree(target_t);
+   if (target_t != shared_target_t) {
+      target_t = BlastTargetTranslationFree(target_t);
+   }
 
    if (kSmithWaterman) {
        /* switch over to the result of the traceback */
@@ -716,6 +735,25 @@ Blast_TracebackFromHSPList(EBlastProgramType program_number,
    return 0;
 }
 
+/*
+    Comments in blast_traceback.h
+ */
+Int2
+Blast_TracebackFromHSPList(EBlastProgramType program_number,
+   BlastHSPList* hsp_list, const BLAST_SequenceBlk* query_blk,
+   BLAST_SequenceBlk* subject_blk, const BlastQueryInfo* query_info_in,
+   BlastGapAlignStruct* gap_align, const BlastScoreBlk* sbp,
+   const BlastScoringParameters* score_params,
+   const BlastExtensionOptions* ext_options,
+   const BlastHitSavingParameters* hit_params, const Uint1* gen_code_string,
+   Boolean * fence_hit)
+{
+   return s_TracebackFromHSPList(program_number, hsp_list, query_blk,
+                                 subject_blk, query_info_in, gap_align, sbp,
+                                 score_params, ext_options, hit_params,
+                                 gen_code_string, NULL, fence_hit);
+}
+
 /** Performs traceback alignment for one HSP list in a PHI BLAST search.
  * @param program_number eBlastTypePhiBlastn or eBlastTypePhiBlastp [in]
  * @param hsp_list HSP list for a single query/subject pair, with preliminary
@@ -1472,10 +1510,26 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
             return retval;
         }
         ASSERT(batches);
-        actual_num_threads = MAX(1, MIN(thread_data->num_elems, batches->num_batches));
         /* Added for testing purposes only */
         if (getenv("NCBI_BLAST_DISABLE_OPENMP")) {
             actual_num_threads = 1;
+        } else if (thread_data->num_elems > 1) {
+            /* A subject sequence hit by many queries would otherwise be
+               traced back by a single thread: divide its HSP lists into
+               groups, each of which fetches the subject once */
+            Int8 num_hsplists = 0;
+            Int4 max_group_size;
+            for (i = 0; i < (Int4)batches->num_batches; i++) {
+                num_hsplists += batches->array_of_batches[i]->num_hsplists;
+            }
+            max_group_size = (Int4) MAX(TRACEBACK_MIN_GROUP_SIZE,
+                num_hsplists / (thread_data->num_elems *
+                                TRACEBACK_GROUPS_PER_THREAD));
+            /* on failure the batches are left as they are */
+            BlastHSPStreamResultsBatchArraySplit(batches, max_group_size);
+        }
+        if (actual_num_threads == 0) {
+            actual_num_threads = MAX(1, MIN(thread_data->num_elems, batches->num_batches));
         }
         if (actual_num_threads != thread_data->num_elems) {
             SThreadLocalDataArrayTrim(thread_data, actual_num_threads);
@@ -1494,6 +1548,7 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
             BlastSeqSrc* seqsrc = NULL;
             BlastGapAlignStruct* gap_align = NULL;
             Boolean perform_partial_fetch = FALSE;
+            SBlastTargetTranslation* target_t = NULL;
 
 #ifdef _OPENMP
             tid = omp_get_thread_num();
@@ -1580,6 +1635,16 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                         continue;
                     }
                 }
+
+                /* Translate the subject once for all HSP lists in the batch */
+                if (Blast_SubjectIsTranslated(program_number) &&
+                    !score_params->options->is_ooframe &&
+                    batch->num_hsplists > 1) {
+                    BlastTargetTranslationNew(seq_arg.seq,
+                                              seq_arg.seq->gen_code_string,
+                                              program_number, FALSE,
+                                              &target_t);
+                }
             } /* end of set up for traceback */
 
             /* process all the hits to this subject sequence, one list at a time */
@@ -1594,12 +1659,12 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                                         query_info, pattern_blk);
                     } else {
                         Boolean fence_hit = FALSE;
-                        Blast_TracebackFromHSPList(program_number, hsp_list, query,
+                        s_TracebackFromHSPList(program_number, hsp_list, query,
                                          seq_arg.seq, query_info,
                                          gap_align, sbp, score_params,
                                          ext_params->options, hit_params,
                                          seq_arg.seq->gen_code_string,
-                                         &fence_hit);
+                                         target_t, &fence_hit);
 
                         if (fence_hit) {
                             /* Disable range support and refetch the
@@ -1622,15 +1687,25 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                                 }
                             }
 
+                            /* The shared translation was made from the
+                               partially fetched sequence */
+                            if (target_t) {
+                                target_t = BlastTargetTranslationFree(target_t);
+                                BlastTargetTranslationNew(seq_arg.seq,
+                                                seq_arg.seq->gen_code_string,
+                                                program_number, FALSE,
+                                                &target_t);
+                            }
+
                             /* Retry the alignment with fence_hit set*/
-                            Blast_TracebackFromHSPList(program_number, hsp_list,
+                            s_TracebackFromHSPList(program_number, hsp_list,
                                                 query, seq_arg.seq,
                                                 query_info, gap_align,
                                                 sbp, score_params,
                                                 ext_params->options,
                                                 hit_params,
                                                 seq_arg.seq->gen_code_string,
-                                                &fence_hit);
+                                                target_t, &fence_hit);
 #ifndef _OPENMP
                             ASSERT(fence_hit == FALSE);
 #endif
@@ -1656,6 +1731,7 @@ BLAST_ComputeTraceback_MT(EBlastProgramType program_number,
                 }
             }      /* loop over one HSPList batch */
             if (perform_traceback) {
+                target_t = BlastTargetTranslationFree(target_t);
                 BlastSeqSrcReleaseSequence(seqsrc, &seq_arg);
                 BlastSequenceBlkFree(seq_arg.seq);
             }
@@ -362,3 +362,11 @@ BlastHSPCollectorInfoNew(BlastHSPCollectorParams* params) {
    writer_info->params = params;
    return writer_info;
 }
+
+const BlastHSPCollectorParams*
+BlastHSPCollectorGetParams(const BlastHSPWriter* writer)
+{
+   if (!writer || writer->RunFnPtr != &s_BlastHSPCollectorRun)
+      return NULL;
+   return ((const BlastHSPCollectorData*) writer->data)->params;
+}
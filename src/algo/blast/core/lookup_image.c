@@ -0,0 +1,578 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file lookup_image.c
+ * Flat, position-independent images of finished lookup tables
+ */
+
+#include <algo/blast/core/lookup_image.h>
+#include <algo/blast/core/blast_aalookup.h>
+#include <algo/blast/core/blast_nalookup.h>
+#include <algo/blast/core/blast_filter.h>
+#include <algo/blast/core/blast_util.h>
+
+/** Identifies a lookup table image ("BLUT") */
+#define LUT_IMAGE_MAGIC 0x54554c42
+/** Version of the image layout; increment when any lookup table structure
+    changes */
+#define LUT_IMAGE_VERSION 2
+/** Largest number of arrays a lookup table may have */
+#define LUT_IMAGE_MAX_ARRAYS 10
+/** Alignment of the sections of an image, in bytes */
+#define LUT_IMAGE_ALIGN 64
+
+/** Round up to the alignment of image sections */
+#define LUT_IMAGE_ROUND(x) (((x) + LUT_IMAGE_ALIGN - 1) & \
+                            ~(Int8)(LUT_IMAGE_ALIGN - 1))
+
+/** Location of one section of an image */
+typedef struct SLutImageSection {
+    Int8 offset;        /**< Offset from the start of the image */
+    Int8 size;          /**< Size in bytes; 0 for a NULL array */
+} SLutImageSection;
+
+/** Start of every image */
+typedef struct SLutImageHeader {
+    Uint4 magic;        /**< Always LUT_IMAGE_MAGIC */
+    Uint4 version;      /**< Always LUT_IMAGE_VERSION */
+    Uint8 key;          /**< Hash of the key the table was built for */
+    Int8 image_size;    /**< Size of the whole image */
+    Int4 lut_type;      /**< Type of the lookup table */
+    Int4 query_length;  /**< Length of the query the table was built from */
+    SLutImageSection key_data; /**< Data of the key, compared in full */
+    SLutImageSection table;    /**< The lookup table structure */
+    SLutImageSection masked;   /**< Soft-masked locations, as SSeqRange */
+    SLutImageSection arrays[LUT_IMAGE_MAX_ARRAYS]; /**< Arrays of the table */
+} SLutImageHeader;
+
+/** The parts of a lookup table structure that cannot be copied as is */
+typedef struct SLutImageLayout {
+    Int4 table_size;            /**< Size of the lookup table structure */
+    Int4 num_arrays;            /**< Number of arrays */
+    void** arrays[LUT_IMAGE_MAX_ARRAYS]; /**< Array pointers in the table */
+    Int8 sizes[LUT_IMAGE_MAX_ARRAYS];    /**< Array sizes in bytes */
+    BlastSeqLoc** masked_locations; /**< Soft-masked locations, if any */
+    void** callbacks[2];        /**< Functions chosen at search time */
+} SLutImageLayout;
+
+/** Add an array to the layout of a lookup table
+ * @param layout The layout [in][out]
+ * @param field Address of the array pointer [in]
+ * @param size Size of the array in bytes [in]
+ */
+static void s_LutImageAddArray(SLutImageLayout* layout, void* field,
+                               Int8 size)
+{
+    ASSERT(layout->num_arrays < LUT_IMAGE_MAX_ARRAYS);
+    layout->arrays[layout->num_arrays] = (void**)field;
+    layout->sizes[layout->num_arrays] = (*(void**)field) ? size : 0;
+    layout->num_arrays++;
+}
+
+/** Describe the layout of a lookup table
+ * @param lut_type Type of the lookup table [in]
+ * @param lut The lookup table [in]
+ * @param query_length Length of the query the table was built from [in]
+ * @param layout The layout [out]
+ * @return TRUE if tables of this type can be saved as images
+ */
+static Boolean s_LutImageLayout(ELookupTableType lut_type, void* lut,
+                                Int4 query_length, SLutImageLayout* layout)
+{
+    memset(layout, 0, sizeof(*layout));
+
+    switch (lut_type) {
+    case eAaLookupTable:
+        {
+            BlastAaLookupTable* lookup = (BlastAaLookupTable*)lut;
+            Boolean small_bone = (lookup->bone_type == eSmallbone);
+            layout->table_size = sizeof(BlastAaLookupTable);
+            s_LutImageAddArray(layout, &lookup->thick_backbone,
+                               (Int8)lookup->backbone_size * (small_bone ?
+                                  sizeof(AaLookupSmallboneCell) :
+                                  sizeof(AaLookupBackboneCell)));
+            s_LutImageAddArray(layout, &lookup->overflow,
+                               (Int8)lookup->overflow_size * (small_bone ?
+                                  sizeof(Uint2) : sizeof(Int4)));
+            s_LutImageAddArray(layout, &lookup->pv,
+                               (Int8)((lookup->backbone_size >> PV_ARRAY_BTS)
+                                      + 1) * PV_ARRAY_BYTES);
+            layout->callbacks[0] = &lookup->scansub_callback;
+            return lookup->thin_backbone == NULL;
+        }
+
+    case eSmallNaLookupTable:
+        {
+            BlastSmallNaLookupTable* lookup = (BlastSmallNaLookupTable*)lut;
+            layout->table_size = sizeof(BlastSmallNaLookupTable);
+            s_LutImageAddArray(layout, &lookup->final_backbone,
+                               (Int8)lookup->backbone_size * sizeof(Int2));
+            s_LutImageAddArray(layout, &lookup->overflow,
+                               (Int8)lookup->overflow_size * sizeof(Int2));
+            layout->masked_locations = &lookup->masked_locations;
+            layout->callbacks[0] = &lookup->scansub_callback;
+            layout->callbacks[1] = &lookup->extend_callback;
+            return TRUE;
+        }
+
+    case eNaLookupTable:
+        {
+            BlastNaLookupTable* lookup = (BlastNaLookupTable*)lut;
+            layout->table_size = sizeof(BlastNaLookupTable);
+            s_LutImageAddArray(layout, &lookup->thick_backbone,
+                               (Int8)lookup->backbone_size *
+                               sizeof(NaLookupBackboneCell));
+            s_LutImageAddArray(layout, &lookup->overflow,
+                               (Int8)lookup->overflow_size * sizeof(Int4));
+            s_LutImageAddArray(layout, &lookup->pv,
+                               (Int8)((lookup->backbone_size >> PV_ARRAY_BTS)
+                                      + 1) * PV_ARRAY_BYTES);
+            layout->masked_locations = &lookup->masked_locations;
+            layout->callbacks[0] = &lookup->scansub_callback;
+            layout->callbacks[1] = &lookup->extend_callback;
+            return TRUE;
+        }
+
+    case eMBLookupTable:
+        {
+            BlastMBLookupTable* mb_lt = (BlastMBLookupTable*)lut;
+            const Int8 kNumCells = mb_lt->hashsize / MB_COMPACT_CELL_WORDS;
+            Int8 num_heads = 0, num_heads2 = 0;
+
+            if (mb_lt->compact_backbone) {
+                const BlastMBCompactCell* last =
+                                    &mb_lt->compact_backbone[kNumCells - 1];
+                num_heads = last->rank + BlastMBPopCount(last->bits);
+            }
+            if (mb_lt->compact_backbone2) {
+                const BlastMBCompactCell* last =
+                                    &mb_lt->compact_backbone2[kNumCells - 1];
+                num_heads2 = last->rank + BlastMBPopCount(last->bits);
+            }
+
+            layout->table_size = sizeof(BlastMBLookupTable);
+            s_LutImageAddArray(layout, &mb_lt->hashtable,
+                               (Int8)mb_lt->hashsize * sizeof(Int4));
+            s_LutImageAddArray(layout, &mb_lt->hashtable2,
+                               (Int8)mb_lt->hashsize * sizeof(Int4));
+            s_LutImageAddArray(layout, &mb_lt->next_pos,
+                               (Int8)(query_length + 1) * sizeof(Int4));
+            s_LutImageAddArray(layout, &mb_lt->next_pos2,
+                               (Int8)(query_length + 1) * sizeof(Int4));
+            s_LutImageAddArray(layout, &mb_lt->pv_array,
+                               (Int8)(mb_lt->hashsize >> mb_lt->pv_array_bts)
+                               * PV_ARRAY_BYTES);
+            s_LutImageAddArray(layout, &mb_lt->compact_backbone,
+                               kNumCells * sizeof(BlastMBCompactCell));
+            s_LutImageAddArray(layout, &mb_lt->compact_heads,
+                               MAX(num_heads, 1) * sizeof(Int4));
+            s_LutImageAddArray(layout, &mb_lt->compact_backbone2,
+                               kNumCells * sizeof(BlastMBCompactCell));
+            s_LutImageAddArray(layout, &mb_lt->compact_heads2,
+                               MAX(num_heads2, 1) * sizeof(Int4));
+            layout->masked_locations = &mb_lt->masked_locations;
+            layout->callbacks[0] = &mb_lt->scansub_callback;
+            layout->callbacks[1] = &mb_lt->extend_callback;
+            return TRUE;
+        }
+
+    default:
+        return FALSE;
+    }
+}
+
+/** Offset basis of the 64-bit FNV-1a hash */
+#define LUT_IMAGE_HASH_INIT NCBI_CONST_UINT8(14695981039346656037)
+
+/** Append bytes to the data of a lookup table key
+ * @param key The key [in][out]
+ * @param capacity Allocated size of the key data [in][out]
+ * @param data The bytes to append [in]
+ * @param size Number of bytes [in]
+ * @return TRUE on success, FALSE if out of memory
+ */
+static Boolean s_LutKeyAppend(LookupTableKey* key, Int8* capacity,
+                              const void* data, Int8 size)
+{
+    if (key->size + size > *capacity) {
+        Int8 new_capacity = MAX(2 * (*capacity), key->size + size);
+        Uint1* new_data = (Uint1*)realloc(key->data, new_capacity);
+        if (!new_data)
+            return FALSE;
+        key->data = new_data;
+        *capacity = new_capacity;
+    }
+    memcpy(key->data + key->size, data, size);
+    key->size += size;
+    return TRUE;
+}
+
+/** Append an integer to the data of a lookup table key
+ * @param key The key [in][out]
+ * @param capacity Allocated size of the key data [in][out]
+ * @param value The integer [in]
+ * @return TRUE on success, FALSE if out of memory
+ */
+static Boolean s_LutKeyAppendInt(LookupTableKey* key, Int8* capacity,
+                                 Int4 value)
+{
+    return s_LutKeyAppend(key, capacity, &value, sizeof(value));
+}
+
+/** Compute the 64-bit FNV-1a hash of a block of bytes
+ * @param data The bytes [in]
+ * @param size Number of bytes [in]
+ * @return the hash
+ */
+static Uint8 s_LutImageHash(const void* data, Int8 size)
+{
+    const Uint1* bytes = (const Uint1*)data;
+    Uint8 hash = LUT_IMAGE_HASH_INIT;
+    Int8 i;
+
+    for (i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= NCBI_CONST_UINT8(1099511628211);
+    }
+    return hash;
+}
+
+/** Determine whether the lookup table will record soft-masked locations;
+ * same test as in blast_nalookup.c
+ * @param query_options Options for query setup [in]
+ */
+static Boolean s_LutImageMaskAtHash(const QuerySetUpOptions* query_options)
+{
+    if (!query_options)
+        return FALSE;
+    if (SBlastFilterOptionsMaskAtHash(query_options->filtering_options))
+        return TRUE;
+    return query_options->filter_string &&
+           strstr(query_options->filter_string, "m") != NULL;
+}
+
+LookupTableKey* LookupTableKeyNew(const BLAST_SequenceBlk* query,
+                                  const LookupTableOptions* lookup_options,
+                                  const QuerySetUpOptions* query_options,
+                                  const BlastSeqLoc* lookup_segments,
+                                  const BlastScoreBlk* sbp)
+{
+    LookupTableKey* key;
+    Int8 capacity = 0;
+    Boolean ok = TRUE;
+    const SBlastScoreMatrix* matrix = NULL;
+    const BlastSeqLoc* loc;
+
+    if (!query || !query->sequence || !lookup_options)
+        return NULL;
+
+    switch (lookup_options->lut_type) {
+    case eAaLookupTable:
+        if (!sbp)
+            return NULL;
+        matrix = (sbp->psi_matrix && sbp->psi_matrix->pssm) ?
+                           sbp->psi_matrix->pssm : sbp->matrix;
+        if (!matrix)
+            return NULL;
+        break;
+    case eNaLookupTable:
+    case eSmallNaLookupTable:
+    case eMBLookupTable:
+    case eMixedMBLookupTable:
+        break;
+    default:
+        return NULL;
+    }
+
+    key = (LookupTableKey*)calloc(1, sizeof(LookupTableKey));
+    if (!key)
+        return NULL;
+
+    if (matrix) {
+        size_t i;
+        for (i = 0; ok && i < matrix->ncols; i++) {
+            ok = s_LutKeyAppend(key, &capacity, matrix->data[i],
+                                matrix->nrows * sizeof(int));
+        }
+        ok = ok && s_LutKeyAppendInt(key, &capacity, matrix == sbp->matrix);
+    } else {
+        ok = s_LutKeyAppendInt(key, &capacity,
+                               s_LutImageMaskAtHash(query_options));
+    }
+
+    ok = ok && s_LutKeyAppendInt(key, &capacity, LUT_IMAGE_VERSION);
+    ok = ok && s_LutKeyAppendInt(key, &capacity, lookup_options->lut_type);
+    ok = ok && s_LutKeyAppend(key, &capacity, &lookup_options->threshold,
+                              sizeof(lookup_options->threshold));
+    ok = ok && s_LutKeyAppendInt(key, &capacity, lookup_options->word_size);
+    ok = ok && s_LutKeyAppendInt(key, &capacity,
+                                 lookup_options->mb_template_length);
+    ok = ok && s_LutKeyAppendInt(key, &capacity,
+                                 lookup_options->mb_template_type);
+    ok = ok && s_LutKeyAppendInt(key, &capacity,
+                                 lookup_options->program_number);
+    ok = ok && s_LutKeyAppendInt(key, &capacity,
+                                 lookup_options->mb_compact_backbone);
+
+    ok = ok && s_LutKeyAppendInt(key, &capacity, query->length);
+    ok = ok && s_LutKeyAppend(key, &capacity, query->sequence,
+                              query->length);
+    for (loc = lookup_segments; ok && loc; loc = loc->next) {
+        ok = s_LutKeyAppendInt(key, &capacity, loc->ssr->left) &&
+             s_LutKeyAppendInt(key, &capacity, loc->ssr->right);
+    }
+
+    if (!ok)
+        return LookupTableKeyFree(key);
+
+    /* 0 is reserved for tables that cannot be saved */
+    key->hash = s_LutImageHash(key->data, key->size);
+    if (key->hash == 0)
+        key->hash = 1;
+    return key;
+}
+
+LookupTableKey* LookupTableKeyFree(LookupTableKey* key)
+{
+    if (key) {
+        sfree(key->data);
+        sfree(key);
+    }
+    return NULL;
+}
+
+Int2 LookupTableImageNew(const LookupTableWrap* lookup_wrap,
+                         const BLAST_SequenceBlk* query,
+                         const LookupTableKey* key,
+                         void** image, Int8* image_size)
+{
+    SLutImageLayout layout;
+    SLutImageHeader* header;
+    Uint1* retval;
+    Int8 offset;
+    Int4 num_masked = 0;
+    Int4 i;
+
+    if (image)
+        *image = NULL;
+    if (image_size)
+        *image_size = 0;
+    if (!lookup_wrap || !lookup_wrap->lut || lookup_wrap->image || !query ||
+        !image || !image_size || !key || key->hash == 0 ||
+        !s_LutImageLayout(lookup_wrap->lut_type, lookup_wrap->lut,
+                          query->length, &layout))
+        return -1;
+
+    if (layout.masked_locations) {
+        const BlastSeqLoc* loc;
+        for (loc = *layout.masked_locations; loc; loc = loc->next)
+            num_masked++;
+    }
+
+    /* lay out the sections */
+    offset = LUT_IMAGE_ROUND(sizeof(SLutImageHeader));
+    offset += LUT_IMAGE_ROUND(key->size);
+    offset += LUT_IMAGE_ROUND(layout.table_size);
+    offset += LUT_IMAGE_ROUND((Int8)num_masked * sizeof(SSeqRange));
+    for (i = 0; i < layout.num_arrays; i++)
+        offset += LUT_IMAGE_ROUND(layout.sizes[i]);
+
+    retval = (Uint1*)calloc(offset, 1);
+    if (!retval)
+        return -2;
+    header = (SLutImageHeader*)retval;
+    header->magic = LUT_IMAGE_MAGIC;
+    header->version = LUT_IMAGE_VERSION;
+    header->key = key->hash;
+    header->image_size = offset;
+    header->lut_type = lookup_wrap->lut_type;
+    header->query_length = query->length;
+
+    offset = LUT_IMAGE_ROUND(sizeof(SLutImageHeader));
+    header->key_data.offset = offset;
+    header->key_data.size = key->size;
+    memcpy(retval + offset, key->data, key->size);
+    offset += LUT_IMAGE_ROUND(key->size);
+
+    header->table.offset = offset;
+    header->table.size = layout.table_size;
+    memcpy(retval + offset, lookup_wrap->lut, layout.table_size);
+    offset += LUT_IMAGE_ROUND(layout.table_size);
+
+    header->masked.offset = offset;
+    header->masked.size = (Int8)num_masked * sizeof(SSeqRange);
+    if (num_masked > 0) {
+        SSeqRange* ranges = (SSeqRange*)(retval + offset);
+        const BlastSeqLoc* loc;
+        for (loc = *layout.masked_locations; loc; loc = loc->next)
+            *ranges++ = *loc->ssr;
+    }
+    offset += LUT_IMAGE_ROUND(header->masked.size);
+
+    for (i = 0; i < layout.num_arrays; i++) {
+        header->arrays[i].offset = offset;
+        header->arrays[i].size = layout.sizes[i];
+        if (layout.sizes[i] > 0)
+            memcpy(retval + offset, *layout.arrays[i], layout.sizes[i]);
+        offset += LUT_IMAGE_ROUND(layout.sizes[i]);
+    }
+
+    /* pointers are meaningless in an image; clear them so that identical
+       tables give identical images */
+    s_LutImageLayout(lookup_wrap->lut_type, retval + header->table.offset,
+                     query->length, &layout);
+    for (i = 0; i < layout.num_arrays; i++)
+        *layout.arrays[i] = NULL;
+    if (layout.masked_locations)
+        *layout.masked_locations = NULL;
+    for (i = 0; i < 2; i++) {
+        if (layout.callbacks[i])
+            *layout.callbacks[i] = NULL;
+    }
+
+    *image = retval;
+    *image_size = header->image_size;
+    return 0;
+}
+
+/** Check that a section lies within an image
+ * @param section The section [in]
+ * @param image_size Size of the image [in]
+ */
+static Boolean s_LutImageSectionValid(const SLutImageSection* section,
+                                      Int8 image_size)
+{
+    return section->offset >= 0 && section->size >= 0 &&
+           section->offset % LUT_IMAGE_ALIGN == 0 &&
+           section->offset <= image_size &&
+           section->size <= image_size - section->offset;
+}
+
+Int2 LookupTableWrapFromImage(const void* image, Int8 image_size,
+                              const LookupTableKey* key,
+                              BLAST_SequenceBlk* query,
+                              LookupTableWrap** lookup_wrap_ptr)
+{
+    const Uint1* bytes = (const Uint1*)image;
+    const SLutImageHeader* header = (const SLutImageHeader*)image;
+    LookupTableWrap* lookup_wrap;
+    SLutImageLayout layout;
+    void* lut;
+    Int4 i;
+
+    if (!lookup_wrap_ptr)
+        return -1;
+    *lookup_wrap_ptr = NULL;
+
+    if (!image || !query || !key ||
+        image_size < (Int8)sizeof(SLutImageHeader) ||
+        header->magic != LUT_IMAGE_MAGIC ||
+        header->version != LUT_IMAGE_VERSION ||
+        key->hash == 0 || header->key != key->hash ||
+        header->image_size != image_size ||
+        header->query_length != query->length ||
+        !s_LutImageSectionValid(&header->key_data, image_size) ||
+        !s_LutImageSectionValid(&header->table, image_size) ||
+        !s_LutImageSectionValid(&header->masked, image_size) ||
+        header->masked.size % sizeof(SSeqRange) != 0)
+        return -1;
+    for (i = 0; i < LUT_IMAGE_MAX_ARRAYS; i++) {
+        if (!s_LutImageSectionValid(&header->arrays[i], image_size))
+            return -1;
+    }
+
+    /* equal hashes do not prove equal keys */
+    if (header->key_data.size != key->size ||
+        memcmp(bytes + header->key_data.offset, key->data, key->size) != 0)
+        return -1;
+
+    /* the table structure is copied, so that the search may set its
+       callbacks; the arrays are used in place */
+    lut = malloc(header->table.size);
+    if (!lut)
+        return -2;
+    memcpy(lut, bytes + header->table.offset, header->table.size);
+    if (!s_LutImageLayout((ELookupTableType)header->lut_type, lut,
+                          header->query_length, &layout) ||
+        layout.table_size != header->table.size) {
+        sfree(lut);
+        return -1;
+    }
+    for (i = 0; i < layout.num_arrays; i++) {
+        *layout.arrays[i] = header->arrays[i].size > 0 ?
+                  (void*)(bytes + header->arrays[i].offset) : NULL;
+    }
+
+    lookup_wrap = (LookupTableWrap*) calloc(1, sizeof(LookupTableWrap));
+    if (!lookup_wrap) {
+        sfree(lut);
+        return -2;
+    }
+    lookup_wrap->lut_type = (ELookupTableType)header->lut_type;
+    lookup_wrap->lut = lut;
+    lookup_wrap->image = image;
+
+    if (layout.masked_locations) {
+        const SSeqRange* ranges =
+                        (const SSeqRange*)(bytes + header->masked.offset);
+        Int8 num_masked = header->masked.size / sizeof(SSeqRange);
+        Int8 k;
+        for (k = 0; k < num_masked; k++) {
+            if (!BlastSeqLocNew(layout.masked_locations, ranges[k].left,
+                                ranges[k].right)) {
+                LookupTableWrapFree(lookup_wrap);
+                return -2;
+            }
+        }
+    }
+
+    /* the small nucleotide table is built together with a compressed
+       copy of the query, which the ungapped extensions need */
+    if (lookup_wrap->lut_type == eSmallNaLookupTable &&
+        !query->compressed_nuc_seq_start) {
+        BlastCompressBlastnaSequence(query);
+    }
+
+    *lookup_wrap_ptr = lookup_wrap;
+    return 0;
+}
+
+void* LookupTableImageTableFree(LookupTableWrap* lookup_wrap)
+{
+    SLutImageLayout layout;
+
+    if (!lookup_wrap || !lookup_wrap->lut)
+        return NULL;
+
+    if (s_LutImageLayout(lookup_wrap->lut_type, lookup_wrap->lut, 0,
+                         &layout) && layout.masked_locations) {
+        *layout.masked_locations =
+                        BlastSeqLocFree(*layout.masked_locations);
+    }
+    sfree(lookup_wrap->lut);
+    return NULL;
+}
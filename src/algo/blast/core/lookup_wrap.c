@@ -43,6 +43,7 @@
 #include <algo/blast/core/lookup_util.h>
 #include <algo/blast/core/blast_rps.h>
 #include <algo/blast/core/blast_encoding.h>
+#include <algo/blast/core/lookup_image.h>
 
 Int2 LookupTableWrapInit(BLAST_SequenceBlk* query, 
         const LookupTableOptions* lookup_options,	
@@ -173,6 +174,16 @@ LookupTableWrap* LookupTableWrapFree(LookupTableWrap* lookup)
    if (!lookup)
        return NULL;
 
+   if (lookup->image) {
+      lookup->lut = LookupTableImageTableFree(lookup);
+      if (lookup->image_release) {
+         ((T_Lookup_ImageRelease)lookup->image_release)
+                                 (lookup->image, lookup->image_release_data);
+      }
+      sfree(lookup);
+      return NULL;
+   }
+
    switch(lookup->lut_type) {
    case eMBLookupTable:
       lookup->lut = (void*) 
@@ -59,7 +59,7 @@ s_MBLookup(const LookupTableWrap *lookup_wrap,
         return FALSE;
     }
 
-    q_off = mb_lt->hashtable[index];
+    q_off = BlastMBLookupTableFirstPos(mb_lt, index);
     while (q_off) {
         if (q_off == q_pos) return TRUE;
         q_off = mb_lt->next_pos[q_off];
@@ -1591,6 +1591,9 @@ Int2 BlastNaWordFinder(BLAST_SequenceBlk * subject,
     Int4 scan_range[3];
     Int4 word_length;
     Int4 lut_word_length;
+    const Boolean kTimed = ungapped_stats && Blast_DiagnosticsGetStageTiming();
+    double scan_start = 0.0;
+    double scan_cpu_start = 0.0;
 
     if (lookup_wrap->lut_type == eSmallNaLookupTable) {
         BlastSmallNaLookupTable *lookup = 
@@ -1650,7 +1653,16 @@ Int2 BlastNaWordFinder(BLAST_SequenceBlk * subject,
 
     while(s_DetermineScanningOffsets(subject, word_length, lut_word_length, scan_range)) {
 
+        if (kTimed) {
+            scan_start = Blast_DiagnosticsTimer();
+            scan_cpu_start = Blast_DiagnosticsCpuTimer();
+        }
         hitsfound = scansub(lookup_wrap, subject, offset_pairs, max_hits, &scan_range[1]);
+        if (kTimed) {
+            ungapped_stats->scan_time += Blast_DiagnosticsTimer() - scan_start;
+            ungapped_stats->scan_cpu_time +=
+                Blast_DiagnosticsCpuTimer() - scan_cpu_start;
+        }
 
         if (hitsfound == 0)
             continue;
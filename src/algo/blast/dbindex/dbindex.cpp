@@ -392,6 +392,7 @@ CDbIndex::SOptions CDbIndex::DefaultSOptions()
         DBSEQ_CHUNK_OVERLAP,    // defined by BLAST
         REPORT_NORMAL,          // normal level of progress reporting
         1536,                   // max index size if 1.5 Gb by default
+        1,                      // build offset lists in one thread
     };
 
     return result;
@@ -36,6 +36,7 @@
 #include <sstream>
 #include <string>
 #include <corelib/ncbi_limits.hpp>
+#include <corelib/ncbithr.hpp>
 
 #include <objmgr/object_manager.hpp>
 #include <objmgr/seq_vector.hpp>
@@ -956,12 +957,15 @@ class COffsetList
             mult_ = (options.ws_hint - options.hkey_width + 1)/options.stride;
         }
 
+        class CDataPool;
+
         /** Add an offset to the list. Update the total.
             @param item  [I]   offset to be appended to the list
             @param total [I/O] change in the length of the list will
                                be applied to this argument
+            @param pool  [I/O] storage of the list data
         */
-        void AddData( TWord item, TWord & total );
+        void AddData( TWord item, TWord & total, CDataPool & pool );
 
         /** Truncate the list to the value of offset. Update the total.
             The function removes the tail of the list corresponding
@@ -969,18 +973,19 @@ class COffsetList
             @param offset [I]   offset value threshold
             @param total  [I/O] change in the length of the list will
                                 be applied to this argument
+            @param pool   [I/O] storage of the list data
         */
-        void TruncateList( TWord offset, TWord & total );
+        void TruncateList( TWord offset, TWord & total, CDataPool & pool );
 
         /** Return the size of the offset list in words.
             @return size of the list in words
         */
         TWord Size() const { return (TWord)(data_.size()); }
 
-        /** Save the offset list.
-            @param os output stream open in binary mode
+        /** Append the saved form of the offset list to a buffer.
+            @param buf [I/O] the list is appended to this buffer
         */
-        void Save( CNcbiOstream & os ) const;
+        void Save( vector< TWord > & buf ) const;
 
     public: // for Solaris
 
@@ -994,21 +999,25 @@ class COffsetList
             SDataUnit * next;
         };
 
+        /** Storage of the data of a set of offset lists. Blocks are
+            allocated on first use, so that empty pools are cheap to
+            create and copy.
+        */
         class CDataPool
         {
-                static const Uint4 BLOCK_SIZE     = 1024*1024ULL;
-                static const Uint4 BLOCKS_RESERVE = 10*1024ULL;
-
                 typedef vector< SDataUnit > TBlock;
                 typedef vector< TBlock > TBlocks;
 
             public:
 
-                CDataPool() : free_( 0 )
-                {
-                    pool_.reserve( BLOCKS_RESERVE );
-                    new_block();
-                }
+                static const Uint4 BLOCK_SIZE     = 1024*1024ULL;
+                static const Uint4 BLOCKS_RESERVE = 10*1024ULL;
+
+                CDataPool( Uint4 block_size = BLOCK_SIZE ) 
+                    : free_( 0 ), 
+                      block_size_( block_size ),
+                      first_unused_( block_size )
+                {}
 
                 SDataUnit * alloc()
                 {
@@ -1018,7 +1027,7 @@ class COffsetList
                         return result;
                     }
 
-                    if( first_unused_ >= BLOCK_SIZE ) new_block();
+                    if( first_unused_ >= block_size_ ) new_block();
                     return &(*pool_.rbegin())[first_unused_++];
                 }
 
@@ -1031,23 +1040,28 @@ class COffsetList
                     d->next = t;
                 }
 
+                /** Free all memory; lists using the pool must not
+                    be used any more. */
                 void clear()
                 {
+                    TBlocks().swap( pool_ );
                     free_ = 0;
-                    pool_.resize( 1 );
-                    first_unused_ = 0;
+                    first_unused_ = block_size_;
                 }
 
             private:
 
                 void new_block()
                 {
-                    pool_.push_back( TBlock( BLOCK_SIZE ) );
+                    if( pool_.empty() ) pool_.reserve( BLOCKS_RESERVE );
+                    pool_.push_back( TBlock( block_size_ ) );
                     first_unused_ = 0;
                 }
 
                 SDataUnit * free_;
 
+                Uint4 block_size_;
+
                 Uint4 first_unused_;
 
                 TBlocks pool_;
@@ -1152,17 +1166,17 @@ class COffsetList
                 Uint4 size() const { return size_; }
                 bool empty() const { return (size() == 0); }
 
-                void push_back( const TWord & d )
+                void push_back( const TWord & d, CDataPool & pool )
                 {
                     if( start_ == 0 ) {
-                        start_ = curr_ = Pool_.alloc();
+                        start_ = curr_ = pool.alloc();
                         start_->next = 0;
                     }
                     
                     curr_->data[last_++] = d;
 
                     if( last_ >= DATA_UNIT_SIZE ) {
-                        SDataUnit * t = Pool_.alloc();
+                        SDataUnit * t = pool.alloc();
                         t->next = 0;
                         curr_->next = t;
                         curr_ = t;
@@ -1172,16 +1186,16 @@ class COffsetList
                     ++size_;
                 }
 
-                void resize( Uint4 newsize )
+                void resize( Uint4 newsize, CDataPool & pool )
                 {
                     if( newsize == 0 ) {
-                        Pool_.free( start_ );
+                        pool.free( start_ );
                         start_ = curr_ = 0;
                         size_ = last_ = 0;
                         return;
                     }
 
-                    while( newsize > size() ) push_back( 0 );
+                    while( newsize > size() ) push_back( 0, pool );
                     Uint4 t = 0;
                     SDataUnit * tp = 0, * tn = start_;
 
@@ -1191,18 +1205,14 @@ class COffsetList
                         tn = tp->next;
                     }
 
-                    Pool_.free( tn );
+                    pool.free( tn );
                     curr_ = tp;
                     last_ = DATA_UNIT_SIZE - (t - newsize) - 1;
                     size_ = newsize;
                 }
 
-                static void Clear() { Pool_.clear(); }
-
             private:
 
-                static CDataPool Pool_;
-
                 SDataUnit * start_;
                 SDataUnit * curr_;
                 Uint4 last_;
@@ -1215,24 +1225,18 @@ class COffsetList
         TData data_;               /**< Offset list data storage. */
         unsigned long min_offset_; /**< Minimum offset used by the index. */
         unsigned long mult_;       /**< Max multiple to use in list pre-ordering. */
-
-    public:
-
-        static void ClearAll() { TData::Clear(); }
 };
 
-COffsetList::CDataPool COffsetList::CData::Pool_;
-
 //-------------------------------------------------------------------------
-inline void COffsetList::Save( CNcbiOstream & os) const
+inline void COffsetList::Save( vector< TWord > & buf ) const
 {
     for( TData::const_iterator cit = data_.begin();
             cit != data_.end(); ++cit )
         if( *cit < min_offset_ ) {
-            WriteWord( os, *cit );
-            WriteWord( os, *(++cit) );
+            buf.push_back( *cit );
+            buf.push_back( *(++cit) );
         }
-        else if( (*cit)%mult_ == 0 ) WriteWord( os, *cit );
+        else if( (*cit)%mult_ == 0 ) buf.push_back( *cit );
 
     unsigned long m = mult_;
 
@@ -1246,25 +1250,27 @@ inline void COffsetList::Save( CNcbiOstream & os) const
                 for( unsigned long n = mult_; n > m; --n )
                     if( (*cit)%n == 0 ) { skip = true; break; }
 
-                if( !skip && (*cit)%m == 0 ) WriteWord( os, *cit );
+                if( !skip && (*cit)%m == 0 ) buf.push_back( *cit );
             }
         }
     }
 
     if( !data_.empty() ) {
-        WriteWord( os, (TWord)0 );
+        buf.push_back( (TWord)0 );
     }
 }
 
 //-------------------------------------------------------------------------
-inline void COffsetList::AddData( TWord item, TWord & total )
+inline void COffsetList::AddData( 
+        TWord item, TWord & total, CDataPool & pool )
 {
-    data_.push_back( item );
+    data_.push_back( item, pool );
     ++total;
 }
 
 //-------------------------------------------------------------------------
-inline void COffsetList::TruncateList( TWord offset, TWord & total )
+inline void COffsetList::TruncateList( 
+        TWord offset, TWord & total, CDataPool & pool )
 {
     bool flag = false;
     TData::const_iterator it = data_.begin();
@@ -1281,7 +1287,7 @@ inline void COffsetList::TruncateList( TWord offset, TWord & total )
             }
 
             TData::size_type diff = data_.size() - i;
-            data_.resize( i );
+            data_.resize( i, pool );
             total -= diff;
             return;
         }else {
@@ -1293,6 +1299,24 @@ inline void COffsetList::TruncateList( TWord offset, TWord & total )
 //-------------------------------------------------------------------------
 /** A class responsible for creation and management of Nmer
     offset lists.
+
+    The offset lists are split by Nmer value into partitions of
+    consecutive lists, one per thread. Each partition has its own
+    storage pool and size total, so that the lists of different
+    partitions can be updated without locking.
+
+    New sequence data is scanned in parallel: the data is split by
+    position into shards, one per thread, and each thread collects the
+    offsets of its shard into a bucket per partition. The buckets are
+    then appended to the offset lists by one thread per partition, in
+    shard order, so that the lists are ordered by offset exactly as if
+    the data were scanned by a single thread.
+
+    When the index is saved, the offset lists are formatted in chunks
+    of bounded size by the worker threads and the chunks are written to
+    the output stream in Nmer order as soon as they are ready. At most
+    a few chunks per thread are kept in memory. The output does not 
+    depend on the number of threads.
 */
 class COffsetData_Factory 
 {
@@ -1307,28 +1331,12 @@ class COffsetData_Factory
         */
         COffsetData_Factory( 
                 TSubjectMap & subject_map, 
-                const CDbIndex::SOptions & options )
-            : subject_map_( subject_map ),
-              hash_table_( 1<<(2*options.hkey_width) ),
-              report_level_( options.report_level ),
-              total_( 0 ),
-              hkey_width_( options.hkey_width ),
-              last_seq_( 0 ),
-              options_( options ),
-              code_bits_( GetCodeBits( options.stride ) )
-        {
-            for( THashTable::iterator i = hash_table_.begin();
-                    i != hash_table_.end(); ++i ) {
-                i->SetIndexParams( options_ );
-            }
-        }
-
-        ~COffsetData_Factory() { COffsetList::ClearAll(); }
+                const CDbIndex::SOptions & options );
 
         /** Get the total memory usage by offset lists in bytes.
             @return memory usage by this instance
         */
-        const TWord total() const { return total_; }
+        const TWord total() const;
 
         /** Bring offset lists up to date with the corresponding
             subject map instance.
@@ -1336,6 +1344,8 @@ class COffsetData_Factory
         void Update();
 
         /** Save the offset lists into the binary output stream.
+            The offset lists are discarded; this must be the last
+            operation on the object.
             @param os output stream; must be open in binary mode
         */
         void Save( CNcbiOstream & os );
@@ -1345,6 +1355,12 @@ class COffsetData_Factory
         /** Type used for individual offset lists. */
         typedef COffsetList TOffsetList;
 
+        /** Storage of offset list data. */
+        typedef TOffsetList::CDataPool TPool;
+
+        /** Buffer for saved offset lists and for collected offsets. */
+        typedef vector< TWord > TBuffer;
+
         typedef CDbIndex::TSeqNum TSeqNum;             /**< Forwarding from CDbIndex. */
         typedef TSubjectMap::TSeqInfo TSeqInfo;        /**< Forwarding from TSubjectMap. */
 
@@ -1353,6 +1369,187 @@ class COffsetData_Factory
         */
         typedef std::vector< TOffsetList > THashTable;
 
+        /** Sequence data of this size or less is scanned by the
+            calling thread.
+        */
+        static const TWord MIN_SHARD_LEN = 64*1024UL;
+
+        /** Approximate size in words of a chunk of saved offset lists. */
+        static const TWord SAVE_CHUNK_WORDS = 4*1024*1024UL;
+
+        /** Offset lists for a range of Nmer values. */
+        struct SPartition
+        {
+            /** Object constructor.
+                @param block_size number of units in a block of the pool
+            */
+            SPartition( Uint4 block_size ) 
+                : pool_( block_size ), total_( 0 ), start_( 0 ), stop_( 0 )
+            {}
+
+            TPool pool_;        /**< Storage of the offset list data. */
+            TWord total_;       /**< Size of the offset lists in words. */
+            TWord start_;       /**< First Nmer value of the partition. */
+            TWord stop_;        /**< One past the last Nmer value. */
+        };
+
+        /** Type of the partition list. */
+        typedef vector< SPartition > TPartitions;
+
+        /** Type of lists of new sequences. */
+        typedef vector< const TSeqInfo * > TSeqInfos;
+
+        /** Range of positions in the new sequence data scanned by 
+            one thread. Positions are counted over the valid segments
+            of the new sequences, in order.
+        */
+        struct SShard
+        {
+            TWord from_;                /**< First position of the shard. */
+            TWord to_;                  /**< One past the last position. */
+            vector< TBuffer > buckets_; /**< Pairs of (Nmer, offset list word)
+                                             collected for each partition. */
+        };
+
+        /** Type of the shard list. */
+        typedef vector< SShard > TShards;
+
+        /** Range of offset lists saved into one buffer. */
+        struct SChunk
+        {
+            TWord start_;       /**< First Nmer value of the chunk. */
+            TWord stop_;        /**< One past the last Nmer value. */
+            TWord size_;        /**< Size of the saved offset lists in words. */
+            bool last_;         /**< The last chunk of its partition. */
+            bool done_;         /**< The buffer is ready to be written. */
+            TBuffer buf_;       /**< Saved offset lists. */
+        };
+
+        /** Type of the chunk list. */
+        typedef vector< SChunk > TChunks;
+
+        /** Chunks of offset lists shared by the saving threads. */
+        struct SSaveQueue
+        {
+            /** Object constructor.
+                @param nchunks number of chunks
+                @param window maximum number of chunks taken by the
+                              threads but not yet written
+            */
+            SSaveQueue( TChunks::size_type nchunks, unsigned int window )
+                : chunks_( nchunks ), next_( 0 ),
+                  window_( window, window ), 
+                  done_( 0, (unsigned int)nchunks )
+            {}
+
+            TChunks chunks_;            /**< Chunks in Nmer order. */
+            TChunks::size_type next_;   /**< First chunk not taken by a thread. */
+            CFastMutex mutex_;          /**< Guards next_ and the done_ flags. */
+            CSemaphore window_;         /**< Limits the chunks in memory. */
+            CSemaphore done_;           /**< Posted for each formatted chunk. */
+        };
+
+        /** Sink adding offset list words to the lists directly. */
+        class CDirectSink
+        {
+            public:
+
+                CDirectSink( COffsetData_Factory & owner ) 
+                    : owner_( owner ) 
+                {}
+
+                void Add( TWord nmer, TWord word )
+                {
+                    SPartition & part = 
+                        owner_.partitions_[owner_.GetPartition( nmer )];
+                    owner_.hash_table_[(THashTable::size_type)nmer].AddData(
+                            word, part.total_, part.pool_ );
+                }
+
+            private:
+
+                COffsetData_Factory & owner_;
+        };
+
+        /** Sink collecting offset list words into the partition
+            buckets of a shard. 
+        */
+        class CShardSink
+        {
+            public:
+
+                CShardSink( COffsetData_Factory & owner, SShard & shard ) 
+                    : owner_( owner ), shard_( shard ) 
+                {}
+
+                void Add( TWord nmer, TWord word )
+                {
+                    TBuffer & bucket = 
+                        shard_.buckets_[owner_.GetPartition( nmer )];
+                    bucket.push_back( nmer );
+                    bucket.push_back( word );
+                }
+
+            private:
+
+                COffsetData_Factory & owner_;
+                SShard & shard_;
+        };
+
+        friend class CDirectSink;
+        friend class CShardSink;
+
+        /** Thread working on a shard, a partition, or saving chunks. */
+        class CWorker : public CThread
+        {
+            public:
+
+                /** Work to be done by a thread. */
+                enum EJob
+                {
+                    eScan,      /**< Scan a shard of new sequence data. */
+                    eMerge,     /**< Add the shard buckets to a partition. */
+                    eSave       /**< Format chunks of the save queue. */
+                };
+
+                /** Object constructor.
+                    @param owner the offset lists
+                    @param job the work to do
+                    @param index the shard or partition to work on
+                */
+                CWorker( 
+                        COffsetData_Factory & owner, 
+                        EJob job, TWord index )
+                    : owner_( owner ), job_( job ), index_( index )
+                {}
+
+            protected:
+
+                /** Do the work. */
+                virtual void * Main();
+
+            private:
+
+                COffsetData_Factory & owner_;   /**< The offset lists. */
+                EJob job_;                      /**< The work to do. */
+                TWord index_;                   /**< Shard or partition. */
+        };
+
+        friend class CWorker;
+
+        /** Type of the worker list. */
+        typedef vector< CRef< CWorker > > TWorkers;
+
+        /** Get the partition containing the offset list of an Nmer.
+            @param nmer the Nmer value
+            @return index of the partition
+        */
+        TWord GetPartition( TWord nmer ) const
+        {
+            return (TWord)(
+                    ((Uint8)nparts_*(nmer + 1) - 1)/hash_table_.size() );
+        }
+
         /** Truncate the offset lists according to the information
             from the subject map.
             Checks if the last oid for which information is added
@@ -1361,22 +1558,29 @@ class COffsetData_Factory
         */
         void Truncate();
 
-        /** Update offset lists with information corresponding to
-            the given sequence.
-            @param sinfo new sequence information
+        /** Add the offsets from a range of positions of the new
+            sequences.
+            @param from first position, counted over the valid
+                        segments of seqs_
+            @param to one past the last position
+            @param sink receives the offset list words
         */
-        void AddSeqInfo( const TSeqInfo & sinfo );
+        template< class TSink >
+        void AddSeqRange( TWord from, TWord to, TSink & sink );
 
-        /** Update offset lists with information corresponding to
-            the given valid segment of a sequence.
+        /** Add the offsets of the Nmers ending in a range of positions 
+            of a valid segment of a sequence.
             @param seq points to the start of the sequence
-            @param seqlen length of seq
             @param start start of the segment
             @param stop one past the end of the segment
+            @param from first Nmer end position to add
+            @param to one past the last Nmer end position to add
+            @param sink receives the offset list words
         */
+        template< class TSink >
         void AddSeqSeg( 
-                const Uint1 * seq, TWord seqlen,
-                TSeqPos start, TSeqPos stop );
+                const Uint1 * seq, TSeqPos start, TSeqPos stop, 
+                TSeqPos from, TSeqPos to, TSink & sink );
 
         /** Encode the offset data and add to the offset list 
             corresponding to the given Nmer value.
@@ -1385,16 +1589,58 @@ class COffsetData_Factory
             @param stop one past the end of the current valid segment
             @param curr end of the Nmer within the sequence
             @param offset offset encoded with subject map instance
+            @param sink receives the offset list words
         */
+        template< class TSink >
         void EncodeAndAddOffset( 
                 TWord nmer,
                 TSeqPos start, TSeqPos stop,
-                TSeqPos curr, TWord offset );
+                TSeqPos curr, TWord offset, TSink & sink );
+
+        /** Scan a shard of the new sequence data into its buckets.
+            @param shard the shard to scan
+        */
+        void ScanShard( SShard & shard );
+
+        /** Append the buckets of all shards for a partition to the
+            offset lists and free the buckets.
+            @param p index of the partition
+        */
+        void MergePartition( TWord p );
+
+        /** Save the offset lists of a chunk into its buffer.
+            @param chunk the chunk to save
+        */
+        void SaveChunk( SChunk & chunk );
+
+        /** Save the chunks of save_queue_ until there are none left. */
+        void SaveChunks();
+
+        /** Split the offset lists into chunks for saving.
+            @param chunks [O] the chunks in Nmer order
+        */
+        void MakeChunks( TChunks & chunks ) const;
+
+        /** Start worker threads.
+            @param job the work to do
+            @param count number of threads; thread i gets index i
+            @param workers [O] the started threads
+        */
+        void StartWorkers( CWorker::EJob job, TWord count, TWorkers & workers );
+
+        /** Wait for worker threads to finish.
+            @param workers the threads
+        */
+        void JoinWorkers( TWorkers & workers );
 
         TSubjectMap & subject_map_;     /**< Instance of subject map structure. */
         THashTable hash_table_;         /**< Mapping from Nmer values to the corresponding offset lists. */
+        TWord nparts_;                  /**< Number of partitions and threads. */
+        TPartitions partitions_;        /**< Partitions of hash_table_. */
+        TSeqInfos seqs_;                /**< Sequences being added. */
+        TShards shards_;                /**< Shards of seqs_ being scanned. */
+        SSaveQueue * save_queue_;       /**< Chunks being saved. */
         unsigned long report_level_;    /**< Level of reporting requested by the user. */
-        TWord total_;                   /**< Current size of the structure in bytes. */
         unsigned long hkey_width_;      /**< Nmer width in bases. */
         TSeqNum last_seq_;              /**< Logical oid of last processed sequence. */
 
@@ -1402,14 +1648,168 @@ class COffsetData_Factory
         unsigned long code_bits_;            /**< Number of bits to encode special offset prefixes. */
 };
 
+//-------------------------------------------------------------------------
+COffsetData_Factory::COffsetData_Factory( 
+        TSubjectMap & subject_map, const CDbIndex::SOptions & options )
+    : subject_map_( subject_map ),
+      hash_table_( 1<<(2*options.hkey_width) ),
+      save_queue_( 0 ),
+      report_level_( options.report_level ),
+      hkey_width_( options.hkey_width ),
+      last_seq_( 0 ),
+      options_( options ),
+      code_bits_( GetCodeBits( options.stride ) )
+{
+    for( THashTable::iterator i = hash_table_.begin();
+            i != hash_table_.end(); ++i ) {
+        i->SetIndexParams( options_ );
+    }
+
+    // Smaller pool blocks for more partitions keep the memory
+    // allocated ahead of need about the same.
+
+    TWord nlists = (TWord)hash_table_.size();
+    nparts_ = (TWord)max( options.num_threads, 1UL );
+    if( nparts_ > nlists ) nparts_ = nlists;
+    Uint4 block_size = max( TPool::BLOCK_SIZE/nparts_, (Uint4)1024 );
+    partitions_.resize( nparts_, SPartition( block_size ) );
+
+    for( TWord i = 0; i < nparts_; ++i ) {
+        partitions_[i].start_ = (TWord)(((Uint8)nlists*i)/nparts_);
+        partitions_[i].stop_  = (TWord)(((Uint8)nlists*(i + 1))/nparts_);
+        _ASSERT( GetPartition( partitions_[i].start_ ) == i );
+        _ASSERT( GetPartition( partitions_[i].stop_ - 1 ) == i );
+    }
+}
+
+//-------------------------------------------------------------------------
+const TWord COffsetData_Factory::total() const
+{
+    TWord result = 0;
+
+    for( TPartitions::const_iterator it = partitions_.begin();
+            it != partitions_.end(); ++it ) {
+        result += it->total_;
+    }
+
+    return result;
+}
+
+//-------------------------------------------------------------------------
+void * COffsetData_Factory::CWorker::Main()
+{
+    switch( job_ ) {
+        case eScan:  owner_.ScanShard( owner_.shards_[index_] ); break;
+        case eMerge: owner_.MergePartition( index_ ); break;
+        case eSave:  owner_.SaveChunks(); break;
+    }
+
+    return 0;
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::StartWorkers( 
+        CWorker::EJob job, TWord count, TWorkers & workers )
+{
+    for( TWord i = 0; i < count; ++i ) {
+        workers.push_back( CRef< CWorker >( 
+                    new CWorker( *this, job, i ) ) );
+        workers.back()->Run();
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::JoinWorkers( TWorkers & workers )
+{
+    for( TWorkers::iterator it = workers.begin();
+            it != workers.end(); ++it ) {
+        (*it)->Join();
+    }
+
+    workers.clear();
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::SaveChunk( SChunk & chunk )
+{
+    chunk.buf_.reserve( chunk.size_ );
+
+    for( TWord nmer = chunk.start_; nmer < chunk.stop_; ++nmer ) {
+        hash_table_[nmer].Save( chunk.buf_ );
+    }
+
+    _ASSERT( chunk.buf_.size() == chunk.size_ );
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::SaveChunks()
+{
+    SSaveQueue & queue = *save_queue_;
+
+    while( true ) {
+        // Do not run ahead of the writing thread by more than
+        // the window.
+
+        queue.window_.Wait();
+        SChunk * chunk = 0;
+
+        {
+            CFastMutexGuard guard( queue.mutex_ );
+
+            if( queue.next_ < queue.chunks_.size() ) {
+                chunk = &queue.chunks_[queue.next_++];
+            }
+        }
+
+        if( chunk == 0 ) {
+            queue.window_.Post();
+            break;
+        }
+
+        SaveChunk( *chunk );
+
+        {
+            CFastMutexGuard guard( queue.mutex_ );
+            chunk->done_ = true;
+        }
+
+        queue.done_.Post();
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::MakeChunks( TChunks & chunks ) const
+{
+    for( TPartitions::const_iterator pit = partitions_.begin();
+            pit != partitions_.end(); ++pit ) {
+        SChunk chunk;
+        chunk.start_ = pit->start_;
+        chunk.size_ = 0;
+        chunk.last_ = chunk.done_ = false;
+
+        for( TWord nmer = pit->start_; nmer < pit->stop_; ++nmer ) {
+            TWord size = hash_table_[nmer].Size();
+            if( size != 0 ) chunk.size_ += size + 1;
+
+            if( chunk.size_ >= SAVE_CHUNK_WORDS || nmer + 1 == pit->stop_ ) {
+                chunk.stop_ = nmer + 1;
+                chunk.last_ = (nmer + 1 == pit->stop_);
+                chunks.push_back( chunk );
+                chunk.start_ = nmer + 1;
+                chunk.size_ = 0;
+            }
+        }
+    }
+}
+
 //-------------------------------------------------------------------------
 void COffsetData_Factory::Save( CNcbiOstream & os ) 
 {
-    ++this->total_;
+    TWord total = this->total() + 1;
 
     for( THashTable::const_iterator cit = hash_table_.begin();
             cit != hash_table_.end(); ++cit ) {
-        if( cit->Size() > 0 ) ++this->total_;
+        if( cit->Size() > 0 ) ++total;
     }
 
     bool stat = !options_.stat_file_name.empty();
@@ -1420,7 +1820,12 @@ void COffsetData_Factory::Save( CNcbiOstream & os )
                 new CNcbiOfstream( options_.stat_file_name.c_str() ) );
     }
 
-    WriteWord( os, total() );
+    // The hash table is written through a buffer as well; it has
+    // 4^hkey_width entries.
+
+    TBuffer header;
+    header.reserve( hash_table_.size() + 3 );
+    header.push_back( total );
     TWord tot = 0;
     unsigned long nmer = 0;
 
@@ -1431,8 +1836,8 @@ void COffsetData_Factory::Save( CNcbiOstream & os )
         }
 
         if( cit->Size() != 0 ) 
-            WriteWord( os, tot );
-        else WriteWord( os, (TWord)0 );
+            header.push_back( tot );
+        else header.push_back( (TWord)0 );
 
         tot += cit->Size();
 
@@ -1442,21 +1847,67 @@ void COffsetData_Factory::Save( CNcbiOstream & os )
         }
     }
 
-    WriteWord( os, total() );
-    WriteWord( os, (TWord)0 );
+    header.push_back( total );
+    header.push_back( (TWord)0 );
+    os.write( reinterpret_cast< const char * >( &header[0] ),
+              header.size()*sizeof( TWord ) );
+    TBuffer().swap( header );
+
+    // The chunks are formatted by the workers, at most two per
+    // thread ahead of the one being written, and written in order.
+    // The storage of a partition is released after its last chunk
+    // is written.
+
+    TChunks chunks;
+    MakeChunks( chunks );
+    TWord nworkers = (TWord)min( (TChunks::size_type)nparts_, chunks.size() );
+    SSaveQueue queue( chunks.size(), 2*nworkers );
+    queue.chunks_.swap( chunks );
+    TWorkers workers;
+
+    if( nworkers > 1 ) {
+        save_queue_ = &queue;
+        StartWorkers( CWorker::eSave, nworkers, workers );
+    }
 
-    for( THashTable::const_iterator cit = hash_table_.begin();
-            cit != hash_table_.end(); ++cit ) {
-        cit->Save( os );
+    TWord part = 0;
+
+    for( TChunks::iterator it = queue.chunks_.begin();
+            it != queue.chunks_.end(); ++it ) {
+        if( nworkers > 1 ) {
+            while( true ) {
+                {
+                    CFastMutexGuard guard( queue.mutex_ );
+                    if( it->done_ ) break;
+                }
+
+                queue.done_.Wait();
+            }
+        }
+        else {
+            SaveChunk( *it );
+        }
+
+        if( !it->buf_.empty() ) {
+            os.write( reinterpret_cast< const char * >( &it->buf_[0] ),
+                      it->buf_.size()*sizeof( TWord ) );
+        }
+
+        TBuffer().swap( it->buf_ );
+        if( it->last_ ) partitions_[part++].pool_.clear();
+        if( nworkers > 1 ) queue.window_.Post();
     }
 
+    JoinWorkers( workers );
+    save_queue_ = 0;
     os << std::flush;
 }
 
 //-------------------------------------------------------------------------
+template< class TSink >
 void COffsetData_Factory::EncodeAndAddOffset(
         TWord nmer, TSeqPos start, TSeqPos stop, 
-        TSeqPos curr, TWord offset )
+        TSeqPos curr, TWord offset, TSink & sink )
 {
     TSeqPos start_diff = curr + 2 - hkey_width_ - start;
     TSeqPos end_diff = stop - curr;
@@ -1465,45 +1916,92 @@ void COffsetData_Factory::EncodeAndAddOffset(
         if( start_diff > options_.stride ) start_diff = 0;
         if( end_diff > options_.stride ) end_diff = 0;
         TWord code = (start_diff<<code_bits_) + end_diff;
-        hash_table_[(THashTable::size_type)nmer].AddData( 
-                code, total_ );
+        sink.Add( nmer, code );
     }
 
-    hash_table_[(THashTable::size_type)nmer].AddData( 
-            offset, total_ );
+    sink.Add( nmer, offset );
 }
 
 //-------------------------------------------------------------------------
+template< class TSink >
 void COffsetData_Factory::AddSeqSeg(
-        const Uint1 * seq, TWord , TSeqPos start, TSeqPos stop )
+        const Uint1 * seq, TSeqPos start, TSeqPos stop, 
+        TSeqPos from, TSeqPos to, TSink & sink )
 {
     const TWord nmer_mask = (((TWord)1)<<(2*hkey_width_)) - 1;
     const Uint1 letter_mask = 0x3;
     TWord nmer = 0;
-    unsigned long count = 0;
 
-    for( TSeqPos curr = start; curr < stop; ++curr, ++count ) {
+    // Start early enough to have the whole Nmer ending at from.
+
+    TSeqPos curr = start;
+    if( from > start + hkey_width_ - 1 ) curr = from - (hkey_width_ - 1);
+
+    for( ; curr < to; ++curr ) {
         Uint1 unit = seq[curr/CR];
         Uint1 letter = ((unit>>(6 - 2*(curr%CR)))&letter_mask);
         nmer = ((nmer<<2)&nmer_mask) + letter;
 
-        if( count >= hkey_width_ - 1 ) {
+        if( curr >= from && curr + 1 >= start + hkey_width_ ) {
             if( subject_map_.CheckOffset( seq, curr ) ) {
                 TWord offset = subject_map_.MakeOffset( seq, curr );
-                EncodeAndAddOffset( nmer, start, stop, curr, offset );
+                EncodeAndAddOffset( 
+                        nmer, start, stop, curr, offset, sink );
             }
         }
     }
 }
 
 //-------------------------------------------------------------------------
-void COffsetData_Factory::AddSeqInfo( const TSeqInfo & sinfo )
+template< class TSink >
+void COffsetData_Factory::AddSeqRange( TWord from, TWord to, TSink & sink )
 {
-    for( TSeqInfo::TSegs::const_iterator it = sinfo.segs_.begin();
-            it != sinfo.segs_.end(); ++it ) {
-        AddSeqSeg( 
-                subject_map_.seq_store_start() + sinfo.seq_start_, 
-                sinfo.len_, it->start_, it->stop_ );
+    TWord pos = 0;
+
+    for( TSeqInfos::const_iterator sit = seqs_.begin();
+            sit != seqs_.end() && pos < to; ++sit ) {
+        const TSeqInfo & sinfo = **sit;
+
+        for( TSeqInfo::TSegs::const_iterator it = sinfo.segs_.begin();
+                it != sinfo.segs_.end() && pos < to; ++it ) {
+            TWord len = it->stop_ - it->start_;
+
+            if( pos + len > from ) {
+                TWord seg_from = (from > pos) ? from - pos : 0;
+                TWord seg_to = min( to - pos, len );
+                AddSeqSeg( 
+                        subject_map_.seq_store_start() + sinfo.seq_start_,
+                        it->start_, it->stop_, 
+                        it->start_ + seg_from, it->start_ + seg_to, sink );
+            }
+
+            pos += len;
+        }
+    }
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::ScanShard( SShard & shard )
+{
+    CShardSink sink( *this, shard );
+    AddSeqRange( shard.from_, shard.to_, sink );
+}
+
+//-------------------------------------------------------------------------
+void COffsetData_Factory::MergePartition( TWord p )
+{
+    SPartition & part = partitions_[p];
+
+    for( TShards::iterator sit = shards_.begin(); 
+            sit != shards_.end(); ++sit ) {
+        TBuffer & bucket = sit->buckets_[p];
+
+        for( TBuffer::const_iterator it = bucket.begin(); 
+                it != bucket.end(); it += 2 ) {
+            hash_table_[*it].AddData( *(it + 1), part.total_, part.pool_ );
+        }
+
+        TBuffer().swap( bucket );
     }
 }
 
@@ -1513,9 +2011,12 @@ void COffsetData_Factory::Truncate()
     last_seq_ = subject_map_.LastGoodSequence();
     TWord offset = subject_map_.MakeOffset( last_seq_, 0 );
 
-    for( THashTable::iterator it = hash_table_.begin();
-            it != hash_table_.end(); ++it ) {
-        it->TruncateList( offset, total_ );
+    for( TPartitions::iterator pit = partitions_.begin();
+            pit != partitions_.end(); ++pit ) {
+        for( TWord nmer = pit->start_; nmer < pit->stop_; ++nmer ) {
+            hash_table_[nmer].TruncateList( 
+                    offset, pit->total_, pit->pool_ );
+        }
     }
 }
 
@@ -1527,11 +2028,44 @@ void COffsetData_Factory::Update()
     }
 
     const TSeqInfo * sinfo;
+    TWord len = 0;
+    seqs_.clear();
 
     while( (sinfo = subject_map_.GetSeqInfo( last_seq_ + 1 )) != 0 ) {
-        AddSeqInfo( *sinfo );
+        seqs_.push_back( sinfo );
         ++last_seq_;
+
+        for( TSeqInfo::TSegs::const_iterator it = sinfo->segs_.begin();
+                it != sinfo->segs_.end(); ++it ) {
+            len += it->stop_ - it->start_;
+        }
+    }
+
+    TWord nshards = (TWord)min( (Uint8)nparts_, (Uint8)len/MIN_SHARD_LEN );
+
+    if( nshards <= 1 ) {
+        CDirectSink sink( *this );
+        AddSeqRange( 0, len, sink );
+        return;
     }
+
+    // Scan the shards into the buckets, then empty the buckets
+    // into the partitions. 
+
+    shards_.resize( nshards );
+
+    for( TWord i = 0; i < nshards; ++i ) {
+        shards_[i].from_ = (TWord)(((Uint8)len*i)/nshards);
+        shards_[i].to_   = (TWord)(((Uint8)len*(i + 1))/nshards);
+        shards_[i].buckets_.resize( nparts_ );
+    }
+
+    TWorkers workers;
+    StartWorkers( CWorker::eScan, nshards, workers );
+    JoinWorkers( workers );
+    StartWorkers( CWorker::eMerge, nparts_, workers );
+    JoinWorkers( workers );
+    shards_.clear();
 }
 
 //-------------------------------------------------------------------------
@@ -118,10 +118,16 @@ void CMkIndexApplication::Init()
             "stride", "stride",
             "distance between stored database positions",
             CArgDescriptions::eInteger );
+    arg_desc->AddDefaultKey(
+            "threads", "num_threads",
+            "number of threads used to build the offset lists",
+            CArgDescriptions::eInteger, "1" );
     arg_desc->AddDefaultKey(
             "old_style_index", "boolean",
             "Use old style index (deprecated)",
             CArgDescriptions::eBoolean, "false" );
+    arg_desc->SetConstraint(
+            "threads", new CArgAllow_Integers( 1, kMax_Int ) );
     arg_desc->SetConstraint( 
             "verbosity",
             &(*new CArgAllow_Strings, "quiet", "normal", "verbose") );
@@ -174,6 +180,7 @@ int CMkIndexApplication::Run()
         options.hkey_width = GetArgs()["nmer"].AsInteger();
     }
 
+    options.num_threads = GetArgs()["threads"].AsInteger();
     options.legacy = GetArgs()["legacy"].AsBoolean();
     options.idmap  = GetArgs()["idmap"].AsBoolean();
 
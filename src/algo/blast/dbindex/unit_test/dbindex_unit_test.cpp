@@ -0,0 +1,123 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Unit tests for database index creation.
+ *
+ */
+#define NCBI_TEST_APPLICATION
+#include <ncbi_pch.hpp>
+
+#include <corelib/ncbifile.hpp>
+#include <util/random_gen.hpp>
+#include <algo/blast/dbindex/dbindex.hpp>
+#include <algo/blast/dbindex/sequence_istream_fasta.hpp>
+#include <sstream>
+
+#include <corelib/test_boost.hpp>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+
+USING_NCBI_SCOPE;
+USING_SCOPE(blastdbindex);
+
+// Random nucleotide sequences in FASTA format; some are long enough
+// to be split between the threads, some have runs of ambiguous bases
+// and lower case (masked) stretches.
+
+static string s_MakeFasta(unsigned int seed)
+{
+    static const char kBases[] = "ACGT";
+    CRandom random(seed);
+    ostringstream os;
+
+    for (int i = 0; i < 12; ++i) {
+        int len = (i % 4 == 0) ? random.GetRand(300000, 1200000)
+                               : random.GetRand(1, 20000);
+        os << ">lcl|seq" << i << " test sequence " << i << "\n";
+
+        for (int pos = 0; pos < len; ) {
+            int run = random.GetRand(1, 5000);
+            bool ambig = random.GetRand(0, 19) == 0;
+            bool masked = random.GetRand(0, 9) == 0;
+
+            for (int j = 0; j < run && pos < len; ++j, ++pos) {
+                char c = ambig ? 'N' : kBases[random.GetRand(0, 3)];
+                os << (masked ? (char)tolower(c) : c);
+                if (pos % 70 == 69) os << "\n";
+            }
+        }
+
+        os << "\n";
+    }
+
+    return os.str();
+}
+
+static string s_MakeIndex(const string& fasta, const string& fname,
+                          unsigned long num_threads)
+{
+    CDbIndex::SOptions options = CDbIndex::DefaultSOptions();
+    options.report_level = REPORT_QUIET;
+    options.num_threads = num_threads;
+
+    istringstream is(fasta);
+    CSequenceIStreamFasta input(is);
+    CDbIndex::TSeqNum stop = 0;
+    CFileDeleteAtExit::Add(fname);
+    CDbIndex::MakeIndex(input, fname, 0, stop, options);
+
+    CNcbiIfstream index(fname.c_str(), IOS_BASE::binary);
+    BOOST_REQUIRE(index);
+    ostringstream data;
+    data << index.rdbuf();
+    return data.str();
+}
+
+BOOST_AUTO_TEST_SUITE(dbindex)
+
+// The offset lists are built and saved by several threads; the index
+// must not depend on their number.
+BOOST_AUTO_TEST_CASE(ThreadedIndexIsIdentical)
+{
+    string fasta = s_MakeFasta(1);
+    string expected = s_MakeIndex(fasta, "dbindex_test_1.idx", 1);
+    BOOST_REQUIRE(!expected.empty());
+
+    unsigned long threads[] = { 2, 3, 4, 8 };
+
+    for (size_t i = 0; i < ArraySize(threads); ++i) {
+        string fname = "dbindex_test_" + NStr::ULongToString(threads[i]) + 
+                       ".idx";
+        string result = s_MakeIndex(fasta, fname, threads[i]);
+        BOOST_CHECK_MESSAGE(result == expected,
+                            "index built with " << threads[i] <<
+                            " threads differs from single thread index");
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
+
+#endif /* SKIP_DOXYGEN_PROCESSING */
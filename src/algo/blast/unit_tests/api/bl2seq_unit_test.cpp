@@ -60,6 +60,7 @@
 #include <algo/blast/blastinput/blast_input.hpp>
 #include <algo/blast/blastinput/blast_fasta_input.hpp>
 #include <algo/blast/api/windowmask_filter.hpp>
+#include <algo/blast/core/blast_simd.h>
 
 #include <objtools/simple/simple_om.hpp>        // for CSimpleOM
 #include <objtools/readers/fasta.hpp>           // for CFastaReader
@@ -821,6 +822,67 @@ BOOST_AUTO_TEST_CASE(IdenticalProteins)
     BOOST_CHECK( ancillary_data.front()->GetSearchSpace() != (Int8)0 );
 }
 
+/// Runs the same search with the vector kernels disabled and with the
+/// best kernels available, and requires identical alignments. Optionally
+/// uses Smith-Waterman gapped extension instead of X-drop
+static void s_CompareSimdWithScalar(const SSeqLoc& query,
+                                    const SSeqLoc& subj, EProgram program,
+                                    bool smith_waterman = false)
+{
+    string results[2];
+    EBlastSimdLevel saved_level = BlastSimdSetMaxLevel(eBlastSimdNone);
+    for (int i = 0; i < 2; i++) {
+        if (i == 1) {
+            BlastSimdSetMaxLevel(saved_level);
+        }
+        CRef<CBlastOptionsHandle> opts(CBlastOptionsFactory::Create(program));
+        if (smith_waterman) {
+            opts->SetOptions().SetGapExtnAlgorithm(eSmithWatermanScoreOnly);
+            opts->SetOptions().SetGapTracebackAlgorithm(eSmithWatermanTbckFull);
+        }
+        CBl2Seq blaster(query, subj, *opts);
+        TSeqAlignVector sav(blaster.Run());
+        CNcbiOstrstream oss;
+        ITERATE(TSeqAlignVector, itr, sav) {
+            oss << MSerial_AsnText << **itr;
+        }
+        results[i] = CNcbiOstrstreamToString(oss);
+    }
+    BOOST_REQUIRE( !results[0].empty() );
+    BOOST_CHECK_EQUAL(results[0], results[1]);
+}
+
+BOOST_AUTO_TEST_CASE(BlastpSimdMatchesScalar)
+{
+    CSeq_id qid("gi|34810917");
+    auto_ptr<SSeqLoc> query(CTestObjMgr::Instance().CreateSSeqLoc(qid));
+    CSeq_id sid("gi|129295");
+    auto_ptr<SSeqLoc> subj(CTestObjMgr::Instance().CreateSSeqLoc(sid));
+    s_CompareSimdWithScalar(*query, *query, eBlastp);
+    s_CompareSimdWithScalar(*query, *subj, eBlastp);
+}
+
+BOOST_AUTO_TEST_CASE(BlastxSimdMatchesScalar)
+{
+    CSeq_id qid("gi|555");
+    auto_ptr<SSeqLoc> query(
+        CTestObjMgr::Instance().CreateSSeqLoc(qid, eNa_strand_both));
+    query->genetic_code_id = 1;
+    CSeq_id sid("gi|129295");
+    auto_ptr<SSeqLoc> subj(CTestObjMgr::Instance().CreateSSeqLoc(sid));
+    s_CompareSimdWithScalar(*query, *subj, eBlastx);
+}
+
+BOOST_AUTO_TEST_CASE(SmithWatermanSimdMatchesScalar)
+{
+    CSeq_id qid("gi|34810917");
+    auto_ptr<SSeqLoc> query(CTestObjMgr::Instance().CreateSSeqLoc(qid));
+    CSeq_id sid("gi|129295");
+    auto_ptr<SSeqLoc> subj(CTestObjMgr::Instance().CreateSSeqLoc(sid));
+    s_CompareSimdWithScalar(*query, *query, eBlastp, true);
+    s_CompareSimdWithScalar(*query, *subj, eBlastp, true);
+}
+
 BOOST_AUTO_TEST_CASE(UnsupportedOption) {
     CDiscNucleotideOptionsHandle opts_handle;
     BOOST_REQUIRE_THROW(opts_handle.SetTraditionalBlastnDefaults(),
@@ -409,6 +409,61 @@ BOOST_AUTO_TEST_CASE(testDiscMegaBlastPartialRun)
 
 }
 
+/// Collects the results passed to it by a search
+class CCollectResultsHandler : public ISearchResultsHandler
+{
+public:
+    virtual void HandleResults(CRef<CSearchResults> results) {
+        m_Results.push_back(results);
+    }
+    vector< CRef<CSearchResults> > m_Results;
+};
+
+// Results passed on one query at a time must be the same as those returned
+// in a CSearchResultSet
+BOOST_AUTO_TEST_CASE(testStreamingResults)
+{
+    const string kDbName("data/seqp");
+    const TIntId kQueryGis[] = { 21282798, 129295 };
+    const size_t kNumQueries = sizeof(kQueryGis) / sizeof(*kQueryGis);
+
+    for (size_t i = 0; i < kNumQueries; i++) {
+        CRef<CSeq_loc> query_loc(new CSeq_loc());
+        query_loc->SetWhole().SetGi(GI_FROM(TIntId, kQueryGis[i]));
+        CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+        query_scope->AddDefaults();
+        m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    }
+    CRef<CBlastOptionsHandle> options(CBlastOptionsFactory::Create(eBlastp));
+    options->SetFilterString("L;m;");
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+    CSearchDatabase dbinfo(kDbName, CSearchDatabase::eBlastDbIsProtein);
+
+    CLocalBlast blaster(query_factory, options, dbinfo);
+    CRef<CSearchResultSet> expected = blaster.Run();
+
+    CCollectResultsHandler handler;
+    CLocalBlast streaming_blaster(query_factory, options, dbinfo);
+    streaming_blaster.Run(handler);
+
+    BOOST_REQUIRE_EQUAL(kNumQueries, expected->size());
+    BOOST_REQUIRE_EQUAL(kNumQueries, handler.m_Results.size());
+    BOOST_REQUIRE((*expected)[0].HasAlignments());
+    for (size_t i = 0; i < kNumQueries; i++) {
+        const CSearchResults& exp = (*expected)[i];
+        const CSearchResults& res = *handler.m_Results[i];
+        BOOST_REQUIRE(exp.GetSeqId()->Match(*res.GetSeqId()));
+        BOOST_REQUIRE(exp.GetSeqAlign()->Equals(*res.GetSeqAlign()));
+        BOOST_REQUIRE_EQUAL(exp.GetAncillaryData()->GetSearchSpace(),
+                            res.GetAncillaryData()->GetSearchSpace());
+
+        TMaskedQueryRegions exp_masks, res_masks;
+        exp.GetMaskedQueryRegions(exp_masks);
+        res.GetMaskedQueryRegions(res_masks);
+        BOOST_REQUIRE_EQUAL(exp_masks.size(), res_masks.size());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(testBlastpPrelimSearch) 
 {
     const string kDbName("data/seqp");
@@ -473,6 +528,41 @@ BOOST_AUTO_TEST_CASE(testBlastpPrelimSearch)
     }
 }
 
+BOOST_AUTO_TEST_CASE(testBlastpPrelimSearchStageTimes)
+{
+    const string kDbName("data/seqp");
+    const TGi kQueryGi = GI_FROM(TIntId, 21282798);
+
+    CRef<CSeq_loc> query_loc(new CSeq_loc());
+    query_loc->SetWhole().SetGi(kQueryGi);
+    CScope* query_scope = new CScope(CTestObjMgr::Instance().GetObjMgr());
+    query_scope->AddDefaults();
+    m_vQuery.push_back(SSeqLoc(query_loc, query_scope));
+    BlastSeqSrc* seq_src = SeqDbBlastSeqSrcInit(kDbName, true, 0, 0);
+
+    CRef<CBlastOptionsHandle> opts_handle(
+        CBlastOptionsFactory::Create(eBlastp));
+    CRef<CBlastOptions> options(&opts_handle->SetOptions());
+    CRef<IQueryFactory> query_factory(new CObjMgr_QueryFactory(m_vQuery));
+
+    Blast_DiagnosticsSetStageTiming(TRUE);
+    CBlastPrelimSearch prelim_search(query_factory, options, seq_src);
+    CRef<SInternalData> id(prelim_search.Run());
+    Blast_DiagnosticsSetStageTiming(FALSE);
+    BlastSeqSrcFree(seq_src);
+
+    const BlastDiagnostics* diagnostics = id->m_Diagnostics->GetPointer();
+    BOOST_REQUIRE(diagnostics->lookup_time > 0.0);
+    BOOST_REQUIRE(diagnostics->ungapped_stat->scan_time > 0.0);
+    BOOST_REQUIRE(diagnostics->ungapped_stat->extension_time > 0.0);
+    BOOST_REQUIRE(diagnostics->gapped_stat->extension_time > 0.0);
+    BOOST_REQUIRE(diagnostics->lookup_cpu_time > 0.0);
+    BOOST_REQUIRE(diagnostics->ungapped_stat->scan_cpu_time > 0.0);
+    BOOST_REQUIRE(diagnostics->ungapped_stat->extension_cpu_time > 0.0);
+    BOOST_REQUIRE(diagnostics->gapped_stat->extension_cpu_time > 0.0);
+    BOOST_REQUIRE(diagnostics->gapped_stat->extensions > 0);
+}
+
 BOOST_AUTO_TEST_CASE(testGappedOffsets)
 {
     const unsigned char query[] = {'\016', '\007', '\014', '\024', '\004', '\015', '\011', 
@@ -43,6 +43,8 @@
 #include <algo/blast/core/blast_encoding.h>
 #include <algo/blast/core/blast_setup.h>
 #include <algo/blast/core/blast_gapalign.h>
+#include <algo/blast/core/blast_simd.h>
+#include <util/random_gen.hpp>
 #include <blast_objmgr_priv.hpp>
 #ifdef NCBI_OS_IRIX
 #include <stdlib.h>
@@ -583,6 +585,109 @@ BOOST_AUTO_TEST_CASE(testBlastExtendWordFreeWithNULLInput) {
         BOOST_REQUIRE_EQUAL(true, null_output);
 }
 
+
+/// Textbook Smith-Waterman score with affine gaps (Gotoh), the reference
+/// for the striped engine
+static int s_SmithWatermanScore(const vector<Uint1>& query,
+                                const vector<Uint1>& subject,
+                                Int4** matrix, int gap_open, int gap_extend)
+{
+    const int kNegInf = -1000000;
+    size_t qlen = query.size();
+    vector<int> h(qlen + 1, 0), e(qlen + 1, kNegInf);
+    int best = 0;
+
+    for (size_t j = 0; j < subject.size(); j++) {
+        int diag = 0, f = kNegInf;
+        for (size_t i = 1; i <= qlen; i++) {
+            e[i] = max(e[i] - gap_extend, h[i] - gap_open - gap_extend);
+            int score = max(0, diag + matrix[query[i - 1]][subject[j]]);
+            score = max(score, max(e[i], f));
+            diag = h[i];
+            h[i] = score;
+            best = max(best, score);
+            f = max(f - gap_extend, score - gap_open - gap_extend);
+        }
+    }
+    return best;
+}
+
+/// The striped score-only Smith-Waterman must agree with the scalar code
+/// and the textbook recurrence, and must use 8-bit lanes for ordinary
+/// scores even though the matrix has BLAST_SCORE_MIN entries for invalid
+/// letters
+BOOST_AUTO_TEST_CASE(testSmithWatermanProfile8BitLanes) {
+    const int kAlphabetSize = BLASTAA_SIZE;
+    const Uint1 kInvalid[] = { 0, (Uint1)(kAlphabetSize - 1) };
+    CRandom random(1);
+
+    vector<Int4> data(kAlphabetSize * kAlphabetSize);
+    vector<Int4*> matrix(kAlphabetSize);
+    for (int a = 0; a < kAlphabetSize; a++) {
+        matrix[a] = &data[a * kAlphabetSize];
+        for (int b = 0; b < kAlphabetSize; b++) {
+            matrix[a][b] = a == b ? random.GetRand(4, 11)
+                                  : random.GetRand(-4, 0);
+        }
+    }
+    for (int a = 0; a < kAlphabetSize; a++) {
+        for (size_t k = 0; k < sizeof(kInvalid); k++) {
+            matrix[a][kInvalid[k]] = matrix[kInvalid[k]][a] = BLAST_SCORE_MIN;
+        }
+    }
+
+    EBlastSimdLevel saved_level = BlastSimdGetLevel();
+    int lanes8 = 0, lanes16 = 0;
+
+    for (int test = 0; test < 200; test++) {
+        vector<Uint1> query(random.GetRand(1, 300));
+        vector<Uint1> subject(random.GetRand(1, 400));
+        for (size_t i = 0; i < query.size(); i++) {
+            query[i] = random.GetRand(0, 19) ? random.GetRand(1, 26)
+                                             : kInvalid[0];
+        }
+        for (size_t i = 0; i < subject.size(); i++) {
+            subject[i] = random.GetRand(0, 19) ? random.GetRand(1, 26)
+                                               : kInvalid[1];
+        }
+        // identical sequences score too high for 8-bit lanes
+        if (test % 5 == 0) {
+            subject = query;
+        }
+        int gap_open = random.GetRand(0, 11);
+        int gap_extend = random.GetRand(1, 3);
+
+        BlastSWProfile* profile =
+            BlastSWProfileNew(&query[0], (Int4)query.size(), &matrix[0],
+                              eBlastSWProfileQueryRows, kAlphabetSize);
+        BOOST_REQUIRE(profile);
+
+        BlastSimdSetMaxLevel(eBlastSimdNone);
+        Int4 scalar = BlastSWProfileScore(profile, &subject[0],
+                                          (Int4)subject.size(), FALSE,
+                                          gap_open, gap_extend);
+        BOOST_REQUIRE_EQUAL(0, BlastSWProfileGetLaneBits(profile));
+        BlastSimdSetMaxLevel(saved_level);
+        Int4 vector_score = BlastSWProfileScore(profile, &subject[0],
+                                                (Int4)subject.size(), FALSE,
+                                                gap_open, gap_extend);
+        Int4 lane_bits = BlastSWProfileGetLaneBits(profile);
+        BlastSWProfileFree(profile);
+
+        BOOST_REQUIRE_EQUAL(s_SmithWatermanScore(query, subject, &matrix[0],
+                                                 gap_open, gap_extend),
+                            scalar);
+        BOOST_REQUIRE_EQUAL(scalar, vector_score);
+        lanes8 += lane_bits == 8;
+        lanes16 += lane_bits == 16;
+    }
+
+    if (saved_level != eBlastSimdNone) {
+        BOOST_REQUIRE(lanes8 > 100);
+        BOOST_REQUIRE(lanes16 > 0);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
 /*
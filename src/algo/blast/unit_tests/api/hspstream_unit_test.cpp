@@ -41,6 +41,7 @@
 
 #include "test_objmgr.hpp"
 #include "hspstream_test_util.hpp"
+#include "blast_hspstream_mt_utils.h"
 // For C++ mutex locking
 #include <algo/blast/api/blast_mtlock.hpp>
 
@@ -236,4 +237,260 @@ BOOST_AUTO_TEST_CASE(testMultiSeqHSPCollector) {
     hit_options = BlastHitSavingOptionsFree(hit_options);
     BOOST_REQUIRE(hit_options == NULL);
 }
+/// Creates a collector HSP stream with default blastp parameters, or
+/// with the given hit list size
+static BlastHSPStream* s_CollectorHSPStreamNew(int num_queries,
+                                               int hitlist_size = 0)
+{
+    const EBlastProgramType kProgram = eBlastTypeBlastp;
+
+    BlastExtensionOptions* ext_options = NULL;
+    BlastExtensionOptionsNew(kProgram, &ext_options, true);
+    BlastScoringOptions* scoring_options = NULL;
+    BlastScoringOptionsNew(kProgram, &scoring_options);
+    BlastHitSavingOptions* hit_options = NULL;
+    BlastHitSavingOptionsNew(kProgram, &hit_options,
+                             scoring_options->gapped_calculation);
+    if (hitlist_size > 0) {
+        hit_options->hitlist_size = hitlist_size;
+    }
+
+    BlastHSPWriterInfo * writer_info = BlastHSPCollectorInfoNew(
+            BlastHSPCollectorParamsNew(
+        hit_options, ext_options->compositionBasedStats,
+        scoring_options->gapped_calculation));
+    BlastHSPWriter* writer = BlastHSPWriterNew(&writer_info, NULL);
+    BlastHSPStream* hsp_stream = BlastHSPStreamNew(
+        kProgram, ext_options, FALSE, num_queries, writer);
+
+    BlastScoringOptionsFree(scoring_options);
+    BlastExtensionOptionsFree(ext_options);
+    BlastHitSavingOptionsFree(hit_options);
+    return hsp_stream;
+}
+
+BOOST_AUTO_TEST_CASE(testThreadBufferMerge) {
+    // More subjects than fit in the hit list, with many ties in score, so
+    // that which HSP lists are kept depends on the order they are written
+    const int kNumQueries = 2;
+    const int kNumSubjects = 3000;
+    const int kNumBuffers = 4;
+    const int kBlockSize = 100;
+    const int kNumBlocks = kNumSubjects / kBlockSize;
+    int index, status;
+    BlastHSPList* hsp_list = NULL;
+
+    // Reference: the HSP lists written in the order of a single thread
+    BlastHSPStream* expected = s_CollectorHSPStreamNew(kNumQueries);
+    for (index = 0; index < kNumSubjects; index++) {
+        hsp_list = setupHSPList(index % 7, kNumQueries, index);
+        status = BlastHSPStreamWrite(expected, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+    }
+
+    // The same HSP lists written to per-thread buffers in reverse order;
+    // written to the stream directly in this order, a different set of HSP
+    // lists would be kept
+    BlastHSPStream* hsp_stream = s_CollectorHSPStreamNew(kNumQueries);
+    BlastHSPStream* buffers[kNumBuffers];
+    for (index = 0; index < kNumBuffers; index++) {
+        buffers[index] = BlastHSPStreamNewThreadBuffer(hsp_stream);
+        BOOST_REQUIRE(buffers[index] != NULL);
+    }
+    for (int block = 0; block < kNumBlocks; block++) {
+        int first = (kNumBlocks - 1 - block) * kBlockSize;
+        for (index = first + kBlockSize - 1; index >= first; index--) {
+            hsp_list = setupHSPList(index % 7, kNumQueries, index);
+            status = BlastHSPStreamWrite(buffers[block % kNumBuffers],
+                                         &hsp_list);
+            BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+            BOOST_REQUIRE(hsp_list == NULL);
+        }
+    }
+    status = BlastHSPStreamMergeThreadBuffers(hsp_stream, buffers,
+                                              kNumBuffers);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+
+    // Buffers are left empty, and cannot be merged into each other
+    for (index = 0; index < kNumBuffers; index++) {
+        BOOST_REQUIRE_EQUAL(0, buffers[index]->num_hsplists);
+    }
+    status = BlastHSPStreamMergeThreadBuffers(buffers[0], buffers + 1, 1);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Error, status);
+
+    // Both streams return the same HSP lists in the same order
+    int num_read = 0;
+    BlastHSPList* expected_list = NULL;
+    while (BlastHSPStreamRead(expected, &expected_list)
+           == kBlastHSPStream_Success) {
+        status = BlastHSPStreamRead(hsp_stream, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+        BOOST_REQUIRE_EQUAL(expected_list->oid, hsp_list->oid);
+        BOOST_REQUIRE_EQUAL(expected_list->query_index, hsp_list->query_index);
+        BOOST_REQUIRE_EQUAL(expected_list->hsp_array[0]->score,
+                            hsp_list->hsp_array[0]->score);
+        expected_list = Blast_HSPListFree(expected_list);
+        hsp_list = Blast_HSPListFree(hsp_list);
+        num_read++;
+    }
+    BOOST_REQUIRE(num_read > 0);
+    BOOST_REQUIRE(num_read < kNumQueries * kNumSubjects);
+    status = BlastHSPStreamRead(hsp_stream, &hsp_list);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Eof, status);
+
+    for (index = 0; index < kNumBuffers; index++) {
+        buffers[index] = BlastHSPStreamFree(buffers[index]);
+    }
+    hsp_stream = BlastHSPStreamFree(hsp_stream);
+    expected = BlastHSPStreamFree(expected);
+}
+
+BOOST_AUTO_TEST_CASE(testResultsBatchArraySplit) {
+    // One subject hit by all queries, followed by subjects hit by few
+    const int kNumQueries = 50;
+    const int kNumSubjects = 4;
+    const int kMaxHSPLists = 8;
+    int index, status;
+    BlastHSPList* hsp_list = NULL;
+
+    BlastHSPStream* hsp_stream = s_CollectorHSPStreamNew(kNumQueries);
+    for (index = 0; index < kNumSubjects; index++) {
+        hsp_list = setupHSPList(10, index == 0 ? kNumQueries : 2, index);
+        status = BlastHSPStreamWrite(hsp_stream, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+    }
+
+    BlastHSPStreamResultsBatchArray* batches = NULL;
+    status = BlastHSPStreamToHSPStreamResultsBatch(hsp_stream, &batches);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+    BOOST_REQUIRE_EQUAL(kNumSubjects, (int)batches->num_batches);
+
+    vector<BlastHSPList*> expected;
+    for (Uint4 i = 0; i < batches->num_batches; i++) {
+        BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
+        expected.insert(expected.end(), batch->hsplist_array,
+                        batch->hsplist_array + batch->num_hsplists);
+    }
+
+    // Batches that are small enough are left alone
+    status = BlastHSPStreamResultsBatchArraySplit(batches, kNumQueries);
+    BOOST_REQUIRE_EQUAL(0, status);
+    BOOST_REQUIRE_EQUAL(kNumSubjects, (int)batches->num_batches);
+
+    // The large batch is divided into groups of nearly equal size; all HSP
+    // lists are kept, in the same order, and each group has a single OID
+    status = BlastHSPStreamResultsBatchArraySplit(batches, kMaxHSPLists);
+    BOOST_REQUIRE_EQUAL(0, status);
+    const int kNumGroups = (kNumQueries + kMaxHSPLists - 1) / kMaxHSPLists;
+    BOOST_REQUIRE_EQUAL(kNumGroups + kNumSubjects - 1,
+                        (int)batches->num_batches);
+    size_t next = 0;
+    for (Uint4 i = 0; i < batches->num_batches; i++) {
+        BlastHSPStreamResultBatch* batch = batches->array_of_batches[i];
+        BOOST_REQUIRE(batch->num_hsplists > 0);
+        BOOST_REQUIRE(batch->num_hsplists <= kMaxHSPLists);
+        if ((int)i < kNumGroups) {
+            BOOST_REQUIRE(batch->num_hsplists >= kNumQueries / kNumGroups);
+        }
+        for (int j = 0; j < batch->num_hsplists; j++, next++) {
+            BOOST_REQUIRE(next < expected.size());
+            BOOST_REQUIRE(batch->hsplist_array[j] == expected[next]);
+            BOOST_REQUIRE_EQUAL(batch->hsplist_array[0]->oid,
+                                batch->hsplist_array[j]->oid);
+        }
+    }
+    BOOST_REQUIRE_EQUAL(expected.size(), next);
+
+    status = BlastHSPStreamResultsBatchArraySplit(batches, 0);
+    BOOST_REQUIRE_EQUAL((int)BLASTERR_INVALIDPARAM, status);
+
+    batches = BlastHSPStreamResultsBatchArrayFree(batches);
+    hsp_stream = BlastHSPStreamFree(hsp_stream);
+}
+
+
+/// Creates an HSP list with e-values decreasing as the score grows
+static BlastHSPList* s_SetupHSPListWithEvalues(int score, int num_queries,
+                                               int oid)
+{
+    BlastHSPList* hsp_list = setupHSPList(score, num_queries, oid);
+    for (int index = 0; index < hsp_list->hspcnt; index++) {
+        hsp_list->hsp_array[index]->evalue = 1000.0 / (score + 1);
+    }
+    return hsp_list;
+}
+
+BOOST_AUTO_TEST_CASE(testThreadBufferPruning) {
+    // Many more subjects than the collector saves: the buffers must stay
+    // small, and the merged results must be those of a single thread
+    const int kNumQueries = 2;
+    const int kHitlistSize = 10;
+    const int kNumSubjects = 20000;
+    const int kNumBuffers = 4;
+    const int kBlockSize = 100;
+    const int kNumBlocks = kNumSubjects / kBlockSize;
+    int index, status;
+    BlastHSPList* hsp_list = NULL;
+
+    BlastHSPStream* expected =
+        s_CollectorHSPStreamNew(kNumQueries, kHitlistSize);
+    for (index = 0; index < kNumSubjects; index++) {
+        hsp_list = s_SetupHSPListWithEvalues((index * 7919) % 1000,
+                                             kNumQueries, index);
+        status = BlastHSPStreamWrite(expected, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+    }
+
+    BlastHSPStream* hsp_stream =
+        s_CollectorHSPStreamNew(kNumQueries, kHitlistSize);
+    BOOST_REQUIRE(BlastHSPStreamCanUseThreadBuffers(hsp_stream));
+    BlastHSPStream* buffers[kNumBuffers];
+    for (index = 0; index < kNumBuffers; index++) {
+        buffers[index] = BlastHSPStreamNewThreadBuffer(hsp_stream);
+        BOOST_REQUIRE(buffers[index] != NULL);
+    }
+    // Pruning keeps the best hits of each query, and runs again when the
+    // buffer has doubled
+    const int kMaxBuffered =
+        4 * kNumQueries * buffers[0]->buffer_hitlist_size;
+    for (int block = 0; block < kNumBlocks; block++) {
+        int first = (kNumBlocks - 1 - block) * kBlockSize;
+        BlastHSPStream* buffer = buffers[block % kNumBuffers];
+        for (index = first + kBlockSize - 1; index >= first; index--) {
+            hsp_list = s_SetupHSPListWithEvalues((index * 7919) % 1000,
+                                                 kNumQueries, index);
+            status = BlastHSPStreamWrite(buffer, &hsp_list);
+            BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+            BOOST_REQUIRE(buffer->num_hsplists < kMaxBuffered);
+        }
+    }
+    status = BlastHSPStreamMergeThreadBuffers(hsp_stream, buffers,
+                                              kNumBuffers);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+
+    int num_read = 0;
+    BlastHSPList* expected_list = NULL;
+    while (BlastHSPStreamRead(expected, &expected_list)
+           == kBlastHSPStream_Success) {
+        status = BlastHSPStreamRead(hsp_stream, &hsp_list);
+        BOOST_REQUIRE_EQUAL(kBlastHSPStream_Success, status);
+        BOOST_REQUIRE_EQUAL(expected_list->oid, hsp_list->oid);
+        BOOST_REQUIRE_EQUAL(expected_list->query_index, hsp_list->query_index);
+        BOOST_REQUIRE_EQUAL(expected_list->hsp_array[0]->score,
+                            hsp_list->hsp_array[0]->score);
+        expected_list = Blast_HSPListFree(expected_list);
+        hsp_list = Blast_HSPListFree(hsp_list);
+        num_read++;
+    }
+    BOOST_REQUIRE(num_read > 0);
+    status = BlastHSPStreamRead(hsp_stream, &hsp_list);
+    BOOST_REQUIRE_EQUAL(kBlastHSPStream_Eof, status);
+
+    for (index = 0; index < kNumBuffers; index++) {
+        buffers[index] = BlastHSPStreamFree(buffers[index]);
+    }
+    hsp_stream = BlastHSPStreamFree(hsp_stream);
+    expected = BlastHSPStreamFree(expected);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -56,8 +56,10 @@
 #include <algo/blast/api/tblastn_options.hpp>
 #include <algo/blast/api/blast_nucl_options.hpp>
 #include <algo/blast/api/disc_nucl_options.hpp>
+#include <algo/blast/api/lookup_table_cache.hpp>
 #include <algo/blast/core/blast_nalookup.h>
 #include <algo/blast/core/lookup_util.h>
+#include <algo/blast/core/lookup_image.h>
 
 #include "test_objmgr.hpp"
 #include "blast_test_util.hpp"
@@ -682,6 +684,242 @@ BOOST_AUTO_TEST_CASE(testMegablastTableSmallUnmaskedRegion) {
         BOOST_REQUIRE(segments == NULL);
 }
 
+// Test that the compact backbone finds the same query positions as the
+// dense hash table, for every possible word
+BOOST_AUTO_TEST_CASE(testMegablastLookupTableCompactBackbone) {
+    SetUpQuery(LARGE_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     TRUE, 0, 0);
+
+    QuerySetUpOptions* query_options;
+    BlastQuerySetUpOptionsNew(&query_options);
+	LookupTableWrap* dense_wrap_ptr;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk, 
+                                       lookup_options, query_options, lookup_segments, 
+                                       0, &dense_wrap_ptr, NULL, NULL), 0);
+    lookup_options->mb_compact_backbone = TRUE;
+	LookupTableWrap* compact_wrap_ptr;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk, 
+                                       lookup_options, query_options, lookup_segments, 
+                                       0, &compact_wrap_ptr, NULL, NULL), 0);
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+
+	BlastMBLookupTable* dense = (BlastMBLookupTable*) dense_wrap_ptr->lut;
+	BlastMBLookupTable* compact = (BlastMBLookupTable*) compact_wrap_ptr->lut;
+    BOOST_REQUIRE(dense->hashtable != NULL);
+    BOOST_REQUIRE(dense->compact_backbone == NULL);
+    BOOST_REQUIRE(compact->hashtable == NULL);
+    BOOST_REQUIRE(compact->compact_backbone != NULL);
+	BOOST_REQUIRE_EQUAL(dense->hashsize, compact->hashsize);
+	BOOST_REQUIRE_EQUAL(dense->longest_chain, compact->longest_chain);
+
+    int mismatches = 0;
+    for (Int4 index = 0; index < dense->hashsize; index++) {
+        if (BlastMBLookupTableFirstPos(dense, index) !=
+            BlastMBLookupTableFirstPos(compact, index))
+            mismatches++;
+    }
+	BOOST_REQUIRE_EQUAL(0, mismatches);
+	BOOST_REQUIRE_EQUAL(14646, BlastMBLookupTableFirstPos(compact, 1426260));
+
+    // the compact table supports more words in the same amount of memory
+    const Int8 kFootprint = 2 * 1024 * 1024;
+    Int4 compact_entries = BlastMBLookupTableMaxEntries(lookup_options,
+                                                        kFootprint);
+    lookup_options->mb_compact_backbone = FALSE;
+    Int4 dense_entries = BlastMBLookupTableMaxEntries(lookup_options,
+                                                      kFootprint);
+    BOOST_REQUIRE(compact_entries > dense_entries);
+    BOOST_REQUIRE(BlastMBLookupTableFootprint(compact_entries, 11, TRUE)
+                                                            <= kFootprint);
+
+	dense_wrap_ptr = LookupTableWrapFree(dense_wrap_ptr);
+	compact_wrap_ptr = LookupTableWrapFree(compact_wrap_ptr);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
+// Test that a lookup table taken from the cache is used in place and
+// gives the same query positions as the table that was saved
+BOOST_AUTO_TEST_CASE(testLookupTableCache) {
+    SetUpQuery(LARGE_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     TRUE, 0, 0);
+    QuerySetUpOptions* query_options;
+    BlastQuerySetUpOptionsNew(&query_options);
+
+    CDir cache_dir(CDir::GetTmpNameEx(kEmptyStr, "lutcache"));
+    CRef<CLookupTableCache> cache(new CLookupTableCache(cache_dir.GetPath()));
+
+    LookupTableWrap* built_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &built_wrap_ptr, NULL));
+    BOOST_REQUIRE(built_wrap_ptr->image == NULL);
+    BOOST_REQUIRE_EQUAL((ELookupTableType)built_wrap_ptr->lut_type, 
+                        eMBLookupTable);
+    BOOST_REQUIRE_EQUAL(1U, cache_dir.GetEntries("*" +
+                                  CLookupTableCache::kExtension).size());
+
+    LookupTableWrap* cached_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &cached_wrap_ptr, NULL));
+    BOOST_REQUIRE(cached_wrap_ptr->image != NULL);
+    BOOST_REQUIRE_EQUAL(built_wrap_ptr->lut_type, cached_wrap_ptr->lut_type);
+
+	BlastMBLookupTable* built = (BlastMBLookupTable*) built_wrap_ptr->lut;
+	BlastMBLookupTable* cached = (BlastMBLookupTable*) cached_wrap_ptr->lut;
+	BOOST_REQUIRE_EQUAL(built->hashsize, cached->hashsize);
+	BOOST_REQUIRE_EQUAL(built->longest_chain, cached->longest_chain);
+    int pv_array_size = (built->hashsize >> built->pv_array_bts);
+    BOOST_REQUIRE(memcmp(built->pv_array, cached->pv_array,
+                         pv_array_size * sizeof(PV_ARRAY_TYPE)) == 0);
+    BOOST_REQUIRE(memcmp(built->next_pos, cached->next_pos,
+                         (query_blk->length + 1) * sizeof(Int4)) == 0);
+    int mismatches = 0;
+    for (Int4 index = 0; index < built->hashsize; index++) {
+        if (BlastMBLookupTableFirstPos(built, index) !=
+            BlastMBLookupTableFirstPos(cached, index))
+            mismatches++;
+    }
+	BOOST_REQUIRE_EQUAL(0, mismatches);
+
+    // a different word size must not find the cached table
+    lookup_options->word_size = 24;
+    LookupTableWrap* other_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &other_wrap_ptr, NULL));
+    BOOST_REQUIRE(other_wrap_ptr->image == NULL);
+
+	built_wrap_ptr = LookupTableWrapFree(built_wrap_ptr);
+	cached_wrap_ptr = LookupTableWrapFree(cached_wrap_ptr);
+	other_wrap_ptr = LookupTableWrapFree(other_wrap_ptr);
+
+    // well under the size limit, the unused file stays mapped for reuse
+    BOOST_REQUIRE_EQUAL(1U, cache->GetNumMapped());
+
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+    cache.Reset();
+    cache_dir.Remove();
+}
+
+// Test that files are unmapped once unused if they exceed the size limit,
+// and that the lookup tables keep the cache alive
+BOOST_AUTO_TEST_CASE(testLookupTableCacheLimit) {
+    SetUpQuery(LARGE_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     TRUE, 0, 0);
+    QuerySetUpOptions* query_options;
+    BlastQuerySetUpOptionsNew(&query_options);
+
+    CDir cache_dir(CDir::GetTmpNameEx(kEmptyStr, "lutcache"));
+    CRef<CLookupTableCache> cache(new CLookupTableCache(cache_dir.GetPath(),
+                                                        0));
+
+    LookupTableWrap* built_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &built_wrap_ptr, NULL));
+    BOOST_REQUIRE(built_wrap_ptr->image == NULL);
+    BOOST_REQUIRE_EQUAL(0U, cache->GetNumMapped());
+
+    LookupTableWrap* cached_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &cached_wrap_ptr, NULL));
+    BOOST_REQUIRE(cached_wrap_ptr->image != NULL);
+
+    // a file in use is never unmapped
+    BOOST_REQUIRE_EQUAL(1U, cache->GetNumMapped());
+    BOOST_REQUIRE(cache->GetMappedSize() > 0);
+    LookupTableWrap* second_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(0, (int)cache->CreateLookupTable(query_blk,
+                             lookup_options, query_options, lookup_segments,
+                             NULL, &second_wrap_ptr, NULL));
+    BOOST_REQUIRE(second_wrap_ptr->image == cached_wrap_ptr->image);
+    BOOST_REQUIRE_EQUAL(1U, cache->GetNumMapped());
+
+    cached_wrap_ptr = LookupTableWrapFree(cached_wrap_ptr);
+    BOOST_REQUIRE_EQUAL(1U, cache->GetNumMapped());
+
+    // the last table to be freed releases the cache
+    CLookupTableCache* raw_cache = cache.GetPointer();
+    cache.Reset();
+    BOOST_REQUIRE(raw_cache->Referenced());
+    BOOST_REQUIRE_EQUAL(1U, raw_cache->GetNumMapped());
+    cache.Reset(raw_cache);
+    second_wrap_ptr = LookupTableWrapFree(second_wrap_ptr);
+    BOOST_REQUIRE_EQUAL(0U, cache->GetNumMapped());
+    BOOST_REQUIRE_EQUAL((Uint8)0, cache->GetMappedSize());
+
+	built_wrap_ptr = LookupTableWrapFree(built_wrap_ptr);
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+    cache.Reset();
+    cache_dir.Remove();
+}
+
+// Test that an image is rejected for a key with the same hash but
+// different data
+BOOST_AUTO_TEST_CASE(testLookupTableImageKeyCollision) {
+    SetUpQuery(LARGE_QUERY_GI);
+
+	LookupTableOptions* lookup_options;
+	LookupTableOptionsNew(eBlastTypeBlastn, &lookup_options);
+	BLAST_FillLookupTableOptions(lookup_options, eBlastTypeBlastn, 
+                                     TRUE, 0, 0);
+    QuerySetUpOptions* query_options;
+    BlastQuerySetUpOptionsNew(&query_options);
+
+    LookupTableKey* key = LookupTableKeyNew(query_blk, lookup_options,
+                                            query_options, lookup_segments,
+                                            NULL);
+    BOOST_REQUIRE(key != NULL);
+    BOOST_REQUIRE(key->hash != 0);
+    LookupTableWrap* built_wrap_ptr = NULL;
+ 	BOOST_REQUIRE_EQUAL((int)LookupTableWrapInit(query_blk, 
+                                       lookup_options, query_options,
+                                       lookup_segments, 0, &built_wrap_ptr,
+                                       NULL, NULL), 0);
+    void* image = NULL;
+    Int8 image_size = 0;
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableImageNew(built_wrap_ptr,
+                                     query_blk, key, &image, &image_size));
+
+    lookup_options->word_size = 24;
+    LookupTableKey* other_key = LookupTableKeyNew(query_blk, lookup_options,
+                                                  query_options,
+                                                  lookup_segments, NULL);
+    BOOST_REQUIRE(other_key != NULL);
+    BOOST_REQUIRE(other_key->hash != key->hash);
+    other_key->hash = key->hash;
+
+    LookupTableWrap* image_wrap_ptr = NULL;
+    BOOST_REQUIRE_EQUAL(-1, (int)LookupTableWrapFromImage(image, image_size,
+                                     other_key, query_blk, &image_wrap_ptr));
+    BOOST_REQUIRE(image_wrap_ptr == NULL);
+    BOOST_REQUIRE_EQUAL(0, (int)LookupTableWrapFromImage(image, image_size,
+                                     key, query_blk, &image_wrap_ptr));
+    BOOST_REQUIRE(image_wrap_ptr != NULL);
+
+	image_wrap_ptr = LookupTableWrapFree(image_wrap_ptr);
+	built_wrap_ptr = LookupTableWrapFree(built_wrap_ptr);
+    sfree(image);
+    key = LookupTableKeyFree(key);
+    other_key = LookupTableKeyFree(other_key);
+    query_options = BlastQuerySetUpOptionsFree(query_options);
+	lookup_options = LookupTableOptionsFree(lookup_options);
+}
 
 BOOST_AUTO_TEST_SUITE_END()
 
@@ -43,6 +43,7 @@
 #include <algo/blast/api/seqsrc_multiseq.hpp>
 #include <algo/blast/api/seqsrc_seqdb.hpp>
 #include <algo/blast/core/blast_util.h>
+#include <algo/blast/core/blast_sched.h>
 #include "blast_objmgr_priv.hpp"
 
 #ifdef KAPPA_PRINT_DIAGNOSTICS
@@ -348,6 +349,52 @@ BOOST_AUTO_TEST_CASE(testSeqDBSrcExisting)
     BOOST_REQUIRE_EQUAL(title, title2);
 }
 
+BOOST_AUTO_TEST_CASE(testSubjectScheduler)
+{
+    const char* kDbName = "data/seqn";
+    const Uint4 kFirstSeq = 1000;
+    const Uint4 kFinalSeq = 2000;
+    const int kNumThreads = 4;
+    BlastSeqSrc* seq_src =
+        SeqDbBlastSeqSrcInit(kDbName, false, kFirstSeq, kFinalSeq);
+    BOOST_REQUIRE(seq_src);
+
+    BlastSubjectScheduler* sched =
+        BlastSubjectSchedulerNew(seq_src, kNumThreads, NULL);
+    BOOST_REQUIRE(sched);
+    BOOST_REQUIRE_EQUAL((int)(kFinalSeq - kFirstSeq),
+                        BlastSubjectSchedulerGetNumSubjects(sched));
+
+    // Thread 1 starts first and, once its own share is done, takes the
+    // work of the others; every subject must be handed out exactly once
+    BlastSeqSrc* thread_src = BlastSeqSrcCopy(seq_src);
+    BlastSeqSrcSetScheduler(thread_src, sched, 1);
+    BlastSeqSrcIterator* itr = BlastSeqSrcIteratorNew();
+    vector<int> seen(kFinalSeq, 0);
+    Int4 oid;
+    while ((oid = BlastSeqSrcIteratorNext(thread_src, itr))
+           != BLAST_SEQSRC_EOF) {
+        BOOST_REQUIRE(oid >= (Int4)kFirstSeq && oid < (Int4)kFinalSeq);
+        ++seen[oid];
+    }
+    for (Uint4 i = kFirstSeq; i < kFinalSeq; i++) {
+        BOOST_REQUIRE_EQUAL(1, seen[i]);
+    }
+    BOOST_REQUIRE_EQUAL(BLAST_SEQSRC_EOF, BlastSubjectSchedulerNext(sched, 0));
+
+    BlastThreadStats stats;
+    BlastSubjectSchedulerGetThreadStats(sched, 1, &stats);
+    BOOST_REQUIRE_EQUAL((int)(kFinalSeq - kFirstSeq), stats.num_subjects);
+    BOOST_REQUIRE(stats.num_steals >= kNumThreads - 1);
+    BlastSubjectSchedulerGetThreadStats(sched, 0, &stats);
+    BOOST_REQUIRE_EQUAL(0, stats.num_subjects);
+
+    BlastSeqSrcIteratorFree(itr);
+    BlastSeqSrcFree(thread_src);
+    BlastSubjectSchedulerFree(sched);
+    BlastSeqSrcFree(seq_src);
+}
+
 BOOST_AUTO_TEST_CASE(testSeqDBSrcShared)
 {
     // Further test - multiple SeqSrc objects can use the same
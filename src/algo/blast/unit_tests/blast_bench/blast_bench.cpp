@@ -0,0 +1,695 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file blast_bench.cpp
+ * Runs saved search strategies against a generated BLAST database and
+ * reports the wall clock and CPU time of each stage of the search, per
+ * thread, in JSON. Meant to be run for every release to catch performance
+ * regressions.
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbitime.hpp>
+#include <corelib/ncbistr.hpp>
+#include <corelib/ncbifile.hpp>
+#include <util/random_gen.hpp>
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+#include <objmgr/seq_vector.hpp>
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/IUPACna.hpp>
+#include <objects/seq/IUPACaa.hpp>
+#include <objects/seqset/Bioseq_set.hpp>
+#include <objects/seqset/Seq_entry.hpp>
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seqloc/Seq_loc.hpp>
+#include <objects/seqalign/Seq_align_set.hpp>
+#include <objects/blast/Blast4_request.hpp>
+#include <objects/blast/Blast4_queries.hpp>
+#include <algo/blast/api/prelim_stage.hpp>
+#include <algo/blast/api/traceback_stage.hpp>
+#include <algo/blast/api/local_db_adapter.hpp>
+#include <algo/blast/api/objmgr_query_data.hpp>
+#include <algo/blast/api/search_strategy.hpp>
+#include <algo/blast/api/remote_blast.hpp>
+#include <algo/blast/api/blast_aux.hpp>
+#include <algo/blast/api/setup_factory.hpp>
+#include <algo/blast/api/blast_seqinfosrc.hpp>
+#include <algo/blast/api/uniform_search.hpp>
+#include <algo/blast/core/blast_diagnostics.h>
+#include <algo/blast/core/blast_program.h>
+#include <objtools/align_format/tabular.hpp>
+#include <objtools/blast/seqdb_reader/seqdb.hpp>
+#include <objtools/blast/seqdb_writer/writedb.hpp>
+#include <objtools/data_loaders/blastdb/bdbloader.hpp>
+
+#if defined(NCBI_OS_UNIX)
+#  include <sys/resource.h>
+#endif
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+USING_SCOPE(blast);
+USING_SCOPE(objects);
+USING_SCOPE(align_format);
+#endif
+
+/// CPU time used so far by the whole process, in seconds
+static double s_ProcessCpuTime()
+{
+#if defined(NCBI_OS_UNIX)
+    rusage ruse;
+    if (getrusage(RUSAGE_SELF, &ruse) == 0) {
+        return ruse.ru_utime.tv_sec + ruse.ru_stime.tv_sec +
+            1.0e-6 * (ruse.ru_utime.tv_usec + ruse.ru_stime.tv_usec);
+    }
+#endif
+    return 0.0;
+}
+
+/// Wall clock and CPU time of one stage of the search
+struct SStageTime {
+    double wall;    ///< Elapsed time, in seconds
+    double cpu;     ///< CPU time of all threads, in seconds
+
+    SStageTime() : wall(0.0), cpu(0.0) {}
+};
+
+/// Measures the wall clock and process CPU time between Start and Stop
+class CStageTimer
+{
+public:
+    CStageTimer() : m_Cpu(0.0) { Start(); }
+
+    /// Start (or restart) the measurement
+    void Start() {
+        m_Cpu = s_ProcessCpuTime();
+        m_Wall.Restart();
+    }
+
+    /// Return the time elapsed since the last Start
+    SStageTime Stop() {
+        SStageTime retval;
+        retval.wall = m_Wall.Elapsed();
+        retval.cpu = s_ProcessCpuTime() - m_Cpu;
+        return retval;
+    }
+
+private:
+    CStopWatch m_Wall;  ///< Wall clock
+    double m_Cpu;       ///< Process CPU time at the last Start
+};
+
+/// Minimal writer for the JSON report
+class CJsonWriter
+{
+public:
+    CJsonWriter(CNcbiOstream& out) : m_Out(out), m_First(true) {}
+
+    /// Open an object, as an array element or as the value of a key
+    /// @param key Name of the object, empty inside arrays [in]
+    void BeginObject(const string& key = kEmptyStr) {
+        x_Key(key);
+        m_Out << "{";
+        m_First = true;
+    }
+    /// Close the current object
+    void EndObject() { m_Out << "}"; m_First = false; }
+
+    /// Open an array
+    /// @param key Name of the array [in]
+    void BeginArray(const string& key) {
+        x_Key(key);
+        m_Out << "[";
+        m_First = true;
+    }
+    /// Close the current array
+    void EndArray() { m_Out << "]"; m_First = false; }
+
+    /// Write a string value
+    void Value(const string& key, const string& value) {
+        x_Key(key);
+        m_Out << "\"" << NStr::JsonEncode(value) << "\"";
+    }
+    /// Write a numeric value
+    void Value(const string& key, Int8 value) {
+        x_Key(key);
+        m_Out << value;
+    }
+    /// Write a time in seconds
+    void Value(const string& key, double value) {
+        x_Key(key);
+        m_Out << NStr::DoubleToString(value, 6, NStr::fDoubleFixed);
+    }
+    /// Write the times of a stage as an object
+    void Value(const string& key, const SStageTime& value) {
+        BeginObject(key);
+        Value("wall", value.wall);
+        Value("cpu", value.cpu);
+        EndObject();
+    }
+
+private:
+    /// Write the separator and the key of the next element
+    void x_Key(const string& key) {
+        if ( !m_First ) {
+            m_Out << ",";
+        }
+        m_First = false;
+        if ( !key.empty() ) {
+            m_Out << "\"" << key << "\":";
+        }
+    }
+
+    CNcbiOstream& m_Out;    ///< Output stream
+    bool m_First;           ///< No element written yet at this level
+};
+
+/// One search to be benchmarked
+struct SWorkload {
+    string name;                            ///< Strategy file or task name
+    CRef<CBlastOptionsHandle> opts_hndl;    ///< Search options
+    TSeqLocVector queries;                  ///< Query sequences
+};
+
+/// BLAST per-stage benchmark
+class CBlastBenchApp : public CNcbiApplication
+{
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+
+    /// Read a search strategy file
+    /// @param fname Name of the file [in]
+    SWorkload x_LoadStrategy(const string& fname);
+
+    /// Create a search of random queries
+    /// @param program Search program [in]
+    SWorkload x_MakeDefaultWorkload(EProgram program);
+
+    /// Generate the BLAST database for a workload; a fraction of the
+    /// subject sequences contain mutated copies of parts of the queries, so
+    /// that all stages of the search have work to do
+    /// @param workload The workload [in]
+    /// @return the name of the database
+    string x_MakeDatabase(const SWorkload& workload);
+
+    /// Run one workload and write its report
+    /// @param workload The workload [in]
+    /// @param json Report writer [in] [out]
+    void x_RunWorkload(SWorkload& workload, CJsonWriter& json);
+
+    /// Generate a random sequence
+    /// @param length Length of the sequence [in]
+    /// @param protein Generate a protein sequence? [in]
+    string x_RandomSequence(TSeqPos length, bool protein);
+
+    /// Create a Bioseq
+    /// @param id Local id of the sequence [in]
+    /// @param sequence The sequence in IUPACna or IUPACaa [in]
+    /// @param protein Is this a protein sequence? [in]
+    CRef<CBioseq> x_MakeBioseq(const string& id, const string& sequence,
+                               bool protein);
+
+    /// Add a sequence to the scope
+    /// @param id Local id of the sequence [in]
+    /// @param sequence The sequence in IUPACna or IUPACaa [in]
+    /// @param protein Is this a protein sequence? [in]
+    /// @return location of the whole sequence
+    SSeqLoc x_AddSequence(const string& id, const string& sequence,
+                          bool protein);
+
+    CRandom m_Random;       ///< Source of the random sequences
+    CRef<CScope> m_Scope;   ///< Scope holding the queries
+    string m_DbDir;         ///< Directory of the generated databases
+    int m_NumDbs;           ///< Number of databases generated so far
+};
+
+/// Residues used for random protein sequences
+static const char kAminoAcids[] = "ACDEFGHIKLMNPQRSTVWY";
+/// Bases used for random nucleotide sequences
+static const char kBases[] = "ACGT";
+
+void CBlastBenchApp::Init()
+{
+    HideStdArgs(fHideLogfile | fHideConffile | fHideVersion | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "Per-stage BLAST benchmark");
+
+    arg_desc->AddDefaultKey("db_seqs", "number",
+                            "Number of sequences in the generated database",
+                            CArgDescriptions::eInteger, "10000");
+    arg_desc->AddDefaultKey("db_length", "length",
+                            "Average length of the database sequences",
+                            CArgDescriptions::eInteger, "500");
+    arg_desc->AddDefaultKey("homolog_rate", "rate",
+                            "Fraction of database sequences containing "
+                            "a part of a query",
+                            CArgDescriptions::eDouble, "0.05");
+    arg_desc->AddDefaultKey("num_queries", "number",
+                            "Number of random queries of the default "
+                            "searches",
+                            CArgDescriptions::eInteger, "10");
+    arg_desc->AddDefaultKey("query_length", "length",
+                            "Length of the random queries of the default "
+                            "searches",
+                            CArgDescriptions::eInteger, "500");
+    arg_desc->AddDefaultKey("num_threads", "number", "Number of threads",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->SetConstraint("num_threads",
+                            new CArgAllow_Integers(1, kMax_Int));
+    arg_desc->AddDefaultKey("seed", "number", "Random number seed",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->AddDefaultKey("out", "file", "Report file",
+                            CArgDescriptions::eOutputFile, "-");
+
+    arg_desc->AddExtra(0, kMax_UInt, "Search strategy files; if none are "
+                       "given, a blastp and a megablast search of random "
+                       "queries are run",
+                       CArgDescriptions::eInputFile);
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+string CBlastBenchApp::x_RandomSequence(TSeqPos length, bool protein)
+{
+    const char* residues = protein ? kAminoAcids : kBases;
+    const int kLast = protein ? sizeof(kAminoAcids) - 2 : sizeof(kBases) - 2;
+    string retval(length, 'A');
+    for (TSeqPos i = 0; i < length; i++) {
+        retval[i] = residues[m_Random.GetRand(0, kLast)];
+    }
+    return retval;
+}
+
+CRef<CBioseq> CBlastBenchApp::x_MakeBioseq(const string& id,
+                                           const string& sequence,
+                                           bool protein)
+{
+    CRef<CBioseq> bioseq(new CBioseq);
+    CRef<CSeq_id> seqid(new CSeq_id(CSeq_id::e_Local, id));
+    bioseq->SetId().push_back(seqid);
+    CSeq_inst& inst = bioseq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetLength(sequence.size());
+    if (protein) {
+        inst.SetMol(CSeq_inst::eMol_aa);
+        inst.SetSeq_data().SetIupacaa(CIUPACaa(sequence));
+    } else {
+        inst.SetMol(CSeq_inst::eMol_dna);
+        inst.SetSeq_data().SetIupacna(CIUPACna(sequence));
+    }
+    return bioseq;
+}
+
+SSeqLoc CBlastBenchApp::x_AddSequence(const string& id,
+                                      const string& sequence, bool protein)
+{
+    CRef<CBioseq> bioseq = x_MakeBioseq(id, sequence, protein);
+    m_Scope->AddBioseq(*bioseq);
+
+    CRef<CSeq_loc> loc(new CSeq_loc);
+    loc->SetWhole().Assign(*bioseq->GetFirstId());
+    return SSeqLoc(loc, m_Scope);
+}
+
+SWorkload CBlastBenchApp::x_LoadStrategy(const string& fname)
+{
+    CNcbiIfstream in(fname.c_str());
+    if ( !in ) {
+        NCBI_THROW(CArgException, eInvalidArg,
+                   "Cannot open search strategy file " + fname);
+    }
+    CImportStrategy strategy(ExtractBlast4Request(in));
+
+    SWorkload retval;
+    retval.name = fname;
+    retval.opts_hndl = strategy.GetOptionsHandle();
+
+    CRef<CBlast4_queries> queries = strategy.GetQueries();
+    if (queries->IsBioseq_set()) {
+        ITERATE(CBioseq_set::TSeq_set, entry,
+                queries->GetBioseq_set().GetSeq_set()) {
+            if ( !(*entry)->IsSeq() ) {
+                continue;
+            }
+            const CBioseq& bioseq = (*entry)->GetSeq();
+            m_Scope->AddBioseq(bioseq);
+            CRef<CSeq_loc> loc(new CSeq_loc);
+            loc->SetWhole().Assign(*bioseq.GetFirstId());
+            retval.queries.push_back(SSeqLoc(loc, m_Scope));
+        }
+    } else if (queries->IsSeq_loc_list()) {
+        // the sequences must be available to the object manager
+        ITERATE(CBlast4_queries::TSeq_loc_list, loc,
+                queries->GetSeq_loc_list()) {
+            retval.queries.push_back(SSeqLoc(*loc, m_Scope));
+        }
+    } else {
+        NCBI_THROW(CBlastException, eNotSupported,
+                   "PSSM queries are not supported: " + fname);
+    }
+    if (retval.queries.empty()) {
+        NCBI_THROW(CBlastException, eInvalidArgument,
+                   "No queries in search strategy " + fname);
+    }
+    return retval;
+}
+
+SWorkload CBlastBenchApp::x_MakeDefaultWorkload(EProgram program)
+{
+    const CArgs& args = GetArgs();
+    const int kNumQueries = args["num_queries"].AsInteger();
+    const TSeqPos kQueryLength = args["query_length"].AsInteger();
+
+    SWorkload retval;
+    retval.name = EProgramToTaskName(program);
+    retval.opts_hndl.Reset(CBlastOptionsFactory::Create(program));
+
+    const bool kProtein = Blast_QueryIsProtein
+        (retval.opts_hndl->GetOptions().GetProgramType()) ? true : false;
+    for (int i = 0; i < kNumQueries; i++) {
+        string id = retval.name + "_query" + NStr::IntToString(i);
+        retval.queries.push_back
+            (x_AddSequence(id, x_RandomSequence(kQueryLength, kProtein),
+                           kProtein));
+    }
+    return retval;
+}
+
+string CBlastBenchApp::x_MakeDatabase(const SWorkload& workload)
+{
+    const CArgs& args = GetArgs();
+    const int kNumSeqs = args["db_seqs"].AsInteger();
+    const TSeqPos kLength = max(args["db_length"].AsInteger(), 2);
+    // homolog rate in parts per million
+    const CRandom::TValue kHomologRate =
+        (CRandom::TValue)(args["homolog_rate"].AsDouble() * 1000000);
+
+    EBlastProgramType program =
+        workload.opts_hndl->GetOptions().GetProgramType();
+    const bool kProtein = Blast_SubjectIsProtein(program) ? true : false;
+    // query fragments can be copied into the subjects only if both are of
+    // the same molecule type
+    const bool kAddHomologs =
+        (Blast_QueryIsProtein(program) ? true : false) == kProtein;
+    // mutation rate in percent
+    const CRandom::TValue kMutationRate = kProtein ? 20 : 5;
+
+    // sequences of the queries, to be copied into the database
+    vector<string> queries;
+    if (kAddHomologs) {
+        ITERATE(TSeqLocVector, query, workload.queries) {
+            CSeqVector sv(*query->seqloc, *query->scope,
+                          CBioseq_Handle::eCoding_Iupac);
+            string data;
+            sv.GetSeqData(0, sv.size(), data);
+            if ( !data.empty() ) {
+                queries.push_back(data);
+            }
+        }
+    }
+
+    m_NumDbs++;
+    const string kDbName =
+        CDirEntry::ConcatPath(m_DbDir, "db" + NStr::IntToString(m_NumDbs));
+    CWriteDB writedb(kDbName,
+                     kProtein ? CWriteDB::eProtein : CWriteDB::eNucleotide,
+                     workload.name);
+    for (int i = 0; i < kNumSeqs; i++) {
+        TSeqPos length = m_Random.GetRand(kLength / 2, kLength + kLength / 2);
+        string subject = x_RandomSequence(length, kProtein);
+
+        if ( !queries.empty() &&
+             m_Random.GetRand(0, 999999) < kHomologRate) {
+            const string& query =
+                queries[m_Random.GetRand(0, queries.size() - 1)];
+            TSeqPos part = min((TSeqPos)query.size(), length / 2);
+            TSeqPos from = m_Random.GetRand(0, query.size() - part);
+            TSeqPos to = m_Random.GetRand(0, length - part);
+            for (TSeqPos j = 0; j < part; j++) {
+                if (m_Random.GetRand(0, 99) >= kMutationRate) {
+                    subject[to + j] = query[from + j];
+                }
+            }
+        }
+        string id = "db" + NStr::IntToString(m_NumDbs) + "_subject" +
+            NStr::IntToString(i);
+        writedb.AddSequence(*x_MakeBioseq(id, subject, kProtein));
+    }
+    writedb.Close();
+    return kDbName;
+}
+
+void CBlastBenchApp::x_RunWorkload(SWorkload& workload, CJsonWriter& json)
+{
+    const int kNumThreads = GetArgs()["num_threads"].AsInteger();
+    CRef<CBlastOptions> options(&workload.opts_hndl->SetOptions());
+
+    const bool kProtein =
+        Blast_SubjectIsProtein(options->GetProgramType()) ? true : false;
+
+    const string kDbName = x_MakeDatabase(workload);
+    CRef<CSeqDB> seqdb(new CSeqDB(kDbName, kProtein ? CSeqDB::eProtein
+                                                    : CSeqDB::eNucleotide));
+    CSearchDatabase search_db(kDbName, kProtein
+                              ? CSearchDatabase::eBlastDbIsProtein
+                              : CSearchDatabase::eBlastDbIsNucleotide);
+    search_db.SetSeqDb(seqdb);
+    CRef<CLocalDbAdapter> db(new CLocalDbAdapter(search_db));
+    CRef<IQueryFactory> queries(new CObjMgr_QueryFactory(workload.queries));
+
+    // setup, including the lookup table
+    CStageTimer timer;
+    CRef<CBlastPrelimSearch> prelim(new CBlastPrelimSearch(queries, options,
+                                                           db));
+    SStageTime setup = timer.Stop();
+    if (prelim->CheckInternalData() != 0) {
+        NCBI_THROW(CBlastException, eSetup,
+                   "Setup of " + workload.name + " failed: " +
+                   prelim->GetSearchMessages().ToString());
+    }
+
+    // preliminary stage: scanning, ungapped and gapped extensions
+    prelim->SetNumberOfThreads(kNumThreads);
+    timer.Start();
+    CRef<SInternalData> internal_data = prelim->Run();
+    SStageTime prelim_time = timer.Stop();
+
+    // copy the diagnostics now, the traceback stage adds its own counts
+    const BlastDiagnostics* diags =
+        internal_data->m_Diagnostics->GetPointer();
+    CRef<TBlastDiagnostics> prelim_diags
+        (new TBlastDiagnostics(Blast_DiagnosticsCopy(diags),
+                               Blast_DiagnosticsFree));
+    diags = prelim_diags->GetPointer();
+
+    // traceback
+    timer.Start();
+    TSearchMessages messages = prelim->GetSearchMessages();
+    CRef<IBlastSeqInfoSrc> seqinfo_src(db->MakeSeqInfoSrc());
+    CBlastTracebackSearch traceback(queries, internal_data, options,
+                                    seqinfo_src, messages);
+    traceback.SetNumberOfThreads(kNumThreads);
+    CRef<CSearchResultSet> results = traceback.Run();
+    SStageTime traceback_time = timer.Stop();
+
+    // formatting, as tabular output; the subjects are read through the
+    // BLAST database data loader, as in the command line applications
+    CRef<CObjectManager> om = CObjectManager::GetInstance();
+    const string kLoaderName = CBlastDbDataLoader::RegisterInObjectManager
+        (*om, seqdb, true, CObjectManager::eNonDefault).GetLoader()->GetName();
+    timer.Start();
+    CNcbiOstrstream formatted;
+    Int8 num_aligns = 0;
+    {{
+        CScope scope(*om);
+        scope.AddScope(*m_Scope);
+        scope.AddDataLoader(kLoaderName);
+        CBlastTabularInfo tabinfo(formatted);
+        ITERATE(CSearchResultSet, result, *results) {
+            if ( !(*result)->HasAlignments() ) {
+                continue;
+            }
+            ITERATE(CSeq_align_set::Tdata, align,
+                    (*result)->GetSeqAlign()->Get()) {
+                if (tabinfo.SetFields(**align, scope) == 0) {
+                    tabinfo.Print();
+                }
+                num_aligns++;
+            }
+        }
+    }}
+    SStageTime format_time = timer.Stop();
+    om->RevokeDataLoader(kLoaderName);
+
+    // the lookup table is built during setup
+    SStageTime lookup;
+    lookup.wall = diags->lookup_time;
+    lookup.cpu = diags->lookup_cpu_time;
+    setup.wall = max(0.0, setup.wall - lookup.wall);
+    setup.cpu = max(0.0, setup.cpu - lookup.cpu);
+
+    // the stages of the preliminary search are timed by each thread, both
+    // of their times are sums over the threads
+    SStageTime scan, ungapped, gapped;
+    scan.wall = diags->ungapped_stat->scan_time;
+    scan.cpu = diags->ungapped_stat->scan_cpu_time;
+    ungapped.wall = diags->ungapped_stat->extension_time;
+    ungapped.cpu = diags->ungapped_stat->extension_cpu_time;
+    gapped.wall = diags->gapped_stat->extension_time;
+    gapped.cpu = diags->gapped_stat->extension_cpu_time;
+
+    EBlastProgramType program = options->GetProgramType();
+    json.BeginObject();
+    json.Value("strategy", workload.name);
+    json.Value("program", Blast_ProgramNameFromType(program));
+    json.Value("threads", (Int8)kNumThreads);
+    json.Value("queries", (Int8)workload.queries.size());
+    json.Value("db_sequences", (Int8)seqdb->GetNumSeqs());
+    json.Value("db_letters", (Int8)seqdb->GetTotalLength());
+    json.Value("alignments", num_aligns);
+    json.Value("formatted_bytes", (Int8)GetOssSize(formatted));
+
+    json.BeginObject("stages");
+    json.Value("setup", setup);
+    json.Value("lookup", lookup);
+    json.Value("preliminary", prelim_time);
+    json.Value("scan", scan);
+    json.Value("ungapped", ungapped);
+    json.Value("gapped", gapped);
+    json.Value("traceback", traceback_time);
+    json.Value("formatting", format_time);
+    json.EndObject();
+
+    json.BeginObject("counts");
+    json.Value("lookup_hits", diags->ungapped_stat->lookup_hits);
+    json.Value("ungapped_extensions",
+               (Int8)diags->ungapped_stat->init_extends);
+    json.Value("ungapped_hsps", (Int8)diags->ungapped_stat->good_init_extends);
+    json.Value("gapped_extensions", (Int8)diags->gapped_stat->extensions);
+    json.Value("gapped_hsps", (Int8)diags->gapped_stat->good_extensions);
+    json.EndObject();
+
+    json.BeginArray("per_thread");
+    if (diags->thread_stat) {
+        for (int i = 0; i < diags->num_threads; i++) {
+            const BlastThreadStats& stat = diags->thread_stat[i];
+            json.BeginObject();
+            json.Value("thread", (Int8)i);
+            json.Value("subjects", (Int8)stat.num_subjects);
+            json.Value("steals", (Int8)stat.num_steals);
+            json.Value("pieces", (Int8)stat.num_pieces);
+            json.Value("busy", stat.busy_time);
+            json.Value("idle", stat.idle_time);
+            json.Value("cpu", stat.cpu_time);
+            json.Value("scan", stat.scan_time);
+            json.Value("ungapped", stat.ungapped_time);
+            json.Value("gapped", stat.gapped_time);
+            json.EndObject();
+        }
+    } else {
+        // single threaded search
+        json.BeginObject();
+        json.Value("thread", (Int8)0);
+        json.Value("subjects", (Int8)seqdb->GetNumSeqs());
+        json.Value("steals", (Int8)0);
+        json.Value("pieces", (Int8)0);
+        json.Value("busy", prelim_time.wall);
+        json.Value("idle", 0.0);
+        json.Value("cpu", prelim_time.cpu);
+        json.Value("scan", scan.wall);
+        json.Value("ungapped", ungapped.wall);
+        json.Value("gapped", gapped.wall);
+        json.EndObject();
+    }
+    json.EndArray();
+    json.EndObject();
+}
+
+int CBlastBenchApp::Run()
+{
+    const CArgs& args = GetArgs();
+
+    m_Random.SetSeed(args["seed"].AsInteger());
+    m_Scope.Reset(new CScope(*CObjectManager::GetInstance()));
+    m_DbDir = CDirEntry::GetTmpName();
+    m_NumDbs = 0;
+
+    vector<SWorkload> workloads;
+    for (size_t i = 1; i <= args.GetNExtra(); i++) {
+        workloads.push_back(x_LoadStrategy(args[i].AsString()));
+    }
+    if (workloads.empty()) {
+        workloads.push_back(x_MakeDefaultWorkload(eBlastp));
+        workloads.push_back(x_MakeDefaultWorkload(eMegablast));
+    }
+
+    CDir db_dir(m_DbDir);
+    if ( !db_dir.Create() ) {
+        NCBI_THROW(CBlastException, eSetup,
+                   "Cannot create the database directory " + m_DbDir);
+    }
+    Blast_DiagnosticsSetStageTiming(TRUE);
+
+    CNcbiOstream& out = args["out"].AsOutputFile();
+    CJsonWriter json(out);
+    try {
+        json.BeginObject();
+        json.Value("seed", (Int8)args["seed"].AsInteger());
+        json.BeginArray("searches");
+        NON_CONST_ITERATE(vector<SWorkload>, workload, workloads) {
+            x_RunWorkload(*workload, json);
+        }
+        json.EndArray();
+        json.EndObject();
+        out << endl;
+    }
+    catch (...) {
+        Blast_DiagnosticsSetStageTiming(FALSE);
+        db_dir.Remove();
+        throw;
+    }
+
+    Blast_DiagnosticsSetStageTiming(FALSE);
+    db_dir.Remove();
+    return 0;
+}
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CBlastBenchApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
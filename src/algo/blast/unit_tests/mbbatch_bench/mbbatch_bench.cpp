@@ -0,0 +1,242 @@
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/** @file mbbatch_bench.cpp
+ * Measures the throughput of megablast searches of many short reads against
+ * a reference, with fixed size query batches or with batches packed so that
+ * the lookup table fits in a given amount of cache.
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbitime.hpp>
+#include <util/random_gen.hpp>
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_data.hpp>
+#include <objects/seq/IUPACna.hpp>
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seqloc/Seq_loc.hpp>
+#include <algo/blast/api/local_blast.hpp>
+#include <algo/blast/api/objmgr_query_data.hpp>
+#include <algo/blast/api/blast_nucl_options.hpp>
+#include <algo/blast/blastinput/blast_input_aux.hpp>
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+USING_NCBI_SCOPE;
+USING_SCOPE(blast);
+USING_SCOPE(objects);
+#endif
+
+/// Megablast short read throughput benchmark
+class CMBBatchBenchApp : public CNcbiApplication
+{
+private:
+    /** @inheritDoc */
+    virtual void Init();
+    /** @inheritDoc */
+    virtual int Run();
+
+    /// Generate a random nucleotide sequence
+    /// @param length Length of the sequence [in]
+    string x_RandomSequence(TSeqPos length);
+
+    /// Add a sequence to the scope
+    /// @param id Local id of the sequence [in]
+    /// @param sequence The sequence in IUPACna [in]
+    /// @return location of the whole sequence
+    SSeqLoc x_AddSequence(const string& id, const string& sequence);
+
+    CRandom m_Random;       ///< Source of the random sequences
+    CRef<CScope> m_Scope;   ///< Scope holding all sequences
+};
+
+void CMBBatchBenchApp::Init()
+{
+    HideStdArgs(fHideLogfile | fHideConffile | fHideVersion | fHideDryRun);
+
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "Megablast short read throughput benchmark");
+
+    arg_desc->AddDefaultKey("ref_length", "length", "Length of the reference",
+                            CArgDescriptions::eInteger, "1000000");
+    arg_desc->AddDefaultKey("num_reads", "number", "Number of reads",
+                            CArgDescriptions::eInteger, "100000");
+    arg_desc->AddDefaultKey("read_length", "length", "Length of each read",
+                            CArgDescriptions::eInteger, "150");
+    arg_desc->AddDefaultKey("mismatch_rate", "rate",
+                            "Fraction of read positions that are mutated",
+                            CArgDescriptions::eDouble, "0.02");
+    arg_desc->AddDefaultKey("batch_size", "bases",
+                            "Bases per query batch; 0 packs batches by "
+                            "the lookup table size given by -cache_size",
+                            CArgDescriptions::eInteger, "0");
+    arg_desc->AddDefaultKey("cache_size", "bytes",
+                            "Cache available to the lookup table",
+                            CArgDescriptions::eDataSize, "2MB");
+    arg_desc->AddFlag("compact", "Use the compact lookup table backbone");
+    arg_desc->AddDefaultKey("num_threads", "number", "Number of threads",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->AddDefaultKey("seed", "number", "Random number seed",
+                            CArgDescriptions::eInteger, "1");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+string CMBBatchBenchApp::x_RandomSequence(TSeqPos length)
+{
+    static const char kBases[] = "ACGT";
+    string retval(length, 'A');
+    for (TSeqPos i = 0; i < length; i++) {
+        retval[i] = kBases[m_Random.GetRand(0, 3)];
+    }
+    return retval;
+}
+
+SSeqLoc CMBBatchBenchApp::x_AddSequence(const string& id,
+                                        const string& sequence)
+{
+    CRef<CBioseq> bioseq(new CBioseq);
+    CRef<CSeq_id> seqid(new CSeq_id(CSeq_id::e_Local, id));
+    bioseq->SetId().push_back(seqid);
+    CSeq_inst& inst = bioseq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetMol(CSeq_inst::eMol_dna);
+    inst.SetLength(sequence.size());
+    inst.SetSeq_data().SetIupacna(CIUPACna(sequence));
+    m_Scope->AddBioseq(*bioseq);
+
+    CRef<CSeq_loc> loc(new CSeq_loc);
+    loc->SetWhole(*seqid);
+    return SSeqLoc(loc, m_Scope);
+}
+
+int CMBBatchBenchApp::Run()
+{
+    const CArgs& args = GetArgs();
+    const TSeqPos kRefLength = args["ref_length"].AsInteger();
+    const int kNumReads = args["num_reads"].AsInteger();
+    const TSeqPos kReadLength = args["read_length"].AsInteger();
+    // mismatch rate in parts per million
+    const CRandom::TValue kMismatchRate =
+        (CRandom::TValue)(args["mismatch_rate"].AsDouble() * 1000000);
+    const int kNumThreads = args["num_threads"].AsInteger();
+
+    if (kReadLength == 0 || kReadLength > kRefLength) {
+        NCBI_THROW(CArgException, eConstraint,
+                   "Read length must be between 1 and the reference length");
+    }
+
+    m_Random.SetSeed(args["seed"].AsInteger());
+    m_Scope.Reset(new CScope(*CObjectManager::GetInstance()));
+
+    // the reference, and reads sampled from both of its strands
+    string reference = x_RandomSequence(kRefLength);
+    TSeqLocVector subjects;
+    subjects.push_back(x_AddSequence("reference", reference));
+
+    TSeqLocVector reads;
+    reads.reserve(kNumReads);
+    for (int i = 0; i < kNumReads; i++) {
+        TSeqPos from = m_Random.GetRand(0, kRefLength - kReadLength);
+        string read = reference.substr(from, kReadLength);
+        for (TSeqPos j = 0; j < kReadLength; j++) {
+            if (m_Random.GetRand(0, 999999) < kMismatchRate) {
+                read[j] = "ACGT"[(string("ACGT").find(read[j]) +
+                                  m_Random.GetRand(1, 3)) % 4];
+            }
+        }
+        if (m_Random.GetRand(0, 1)) {
+            reverse(read.begin(), read.end());
+            NON_CONST_ITERATE(string, base, read) {
+                *base = "TGCA"[string("ACGT").find(*base)];
+            }
+        }
+        reads.push_back(x_AddSequence("read" + NStr::IntToString(i), read));
+    }
+
+    CRef<CBlastOptionsHandle> opts_hndl(CBlastOptionsFactory::Create(eMegablast));
+    if (args["compact"]) {
+        opts_hndl->SetOptions().SetMBCompactBackbone(true);
+    }
+
+    int batch_size = args["batch_size"].AsInteger();
+    if (batch_size <= 0) {
+        batch_size = GetCacheAwareQueryBatchSize(opts_hndl->GetOptions(),
+                                              args["cache_size"].AsInt8());
+    }
+
+    CRef<IQueryFactory> subject_factory(new CObjMgr_QueryFactory(subjects));
+    CRef<CLocalDbAdapter> db_adapter(new CLocalDbAdapter(subject_factory,
+                                                         opts_hndl));
+
+    // search the reads in batches of at least batch_size bases
+    int num_batches = 0;
+    Int8 num_hits = 0;
+    CStopWatch sw(CStopWatch::eStart);
+    for (size_t next = 0; next < reads.size(); num_batches++) {
+        TSeqLocVector batch;
+        for (size_t batch_length = 0;
+             next < reads.size() && (int)batch_length < batch_size; next++) {
+            batch.push_back(reads[next]);
+            batch_length += kReadLength;
+        }
+
+        CRef<IQueryFactory> queries(new CObjMgr_QueryFactory(batch));
+        CLocalBlast blaster(queries, opts_hndl, db_adapter);
+        blaster.SetNumberOfThreads(kNumThreads);
+        CRef<CSearchResultSet> results = blaster.Run();
+        ITERATE(CSearchResultSet, result, *results) {
+            if ((*result)->HasAlignments()) {
+                num_hits += (*result)->GetSeqAlign()->Get().size();
+            }
+        }
+    }
+    double elapsed = sw.Elapsed();
+
+    const double kQueriesPerSec = elapsed > 0 ? kNumReads / elapsed : 0.0;
+    CNcbiOstream& out = NcbiCout;
+    out << "batch size:            " << batch_size << " bases" << endl;
+    out << "lookup table backbone: "
+        << (args["compact"] ? "compact" : "dense") << endl;
+    out << "batches:               " << num_batches << endl;
+    out << "alignments:            " << num_hits << endl;
+    out << "elapsed:               " << elapsed << " s" << endl;
+    out << "queries/sec:           " << kQueriesPerSec << endl;
+    out << "queries/sec/core:      " << kQueriesPerSec / kNumThreads << endl;
+    return 0;
+}
+
+#ifndef SKIP_DOXYGEN_PROCESSING
+int main(int argc, const char* argv[] /*, const char* envp[]*/)
+{
+    return CMBBatchBenchApp().AppMain(argc, argv, 0, eDS_Default, 0);
+}
+#endif /* SKIP_DOXYGEN_PROCESSING */
@@ -41,6 +41,8 @@
 #include <util/sequtil/sequtil_convert.hpp>
 #include <objmgr/util/sequence.hpp>
 #include <objtools/blast/seqdb_reader/impl/seqdbisam.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbdeflinecache.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbbitset.hpp>
 #include <math.h>
 
 #include <util/sequtil/sequtil_convert.hpp>
@@ -531,6 +533,45 @@ BOOST_AUTO_TEST_CASE(GetAmbigSeqP)
     BOOST_REQUIRE_EQUAL(Uint4(3219499033ul), hashval2);
 }
 
+BOOST_AUTO_TEST_CASE(ExpertSeqView)
+{
+    const char * kDbs[] = { "data/seqn", "data/seqp" };
+    const CSeqDB::ESeqType kTypes[] = { CSeqDB::eNucleotide,
+                                        CSeqDB::eProtein };
+
+    for (int d = 0; d < 2; d++) {
+        CRef<CSeqDBExpert> db(new CSeqDBExpert(kDbs[d], kTypes[d]));
+        CSeqDBSeqView view;
+        vector<char> expanded;
+
+        for (int oid = 0; oid < 100 && db->CheckOrFindOID(oid); oid++) {
+            db->GetSeqView(oid, view);
+            BOOST_REQUIRE_EQUAL(oid, view.GetOID());
+
+            for (int code = kSeqDBNuclNcbiNA8; code <= kSeqDBNuclBlastNA8;
+                 code++) {
+                const char * buffer = 0;
+                int length = db->GetAmbigSeq(oid, & buffer, code);
+                BOOST_REQUIRE_EQUAL(length, view.GetLength());
+
+                // blastna data is surrounded by sentinel bytes
+                int size = length;
+                if (code == kSeqDBNuclBlastNA8 &&
+                    kTypes[d] == CSeqDB::eNucleotide) {
+                    size += 2;
+                }
+                expanded.assign(length + 2, 0);
+                view.Expand(& expanded[0], code);
+                BOOST_REQUIRE(equal(buffer, buffer + size,
+                                    expanded.begin()));
+                db->RetAmbigSeq(& buffer);
+            }
+        }
+        view.Release();
+        BOOST_REQUIRE(view.Empty());
+    }
+}
+
 BOOST_AUTO_TEST_CASE(GetBioseqN)
 {
     string got( s_Stringify(CSeqDB("data/seqn", CSeqDB::eNucleotide).GetBioseq(2)) );
@@ -660,6 +701,108 @@ BOOST_AUTO_TEST_CASE(GetHdrP)
     BOOST_REQUIRE_EQUAL(expected, got);
 }
 
+BOOST_AUTO_TEST_CASE(DeflineCacheHitsAndEviction)
+{
+
+    // 16 shards of 1000 bytes; an entry of 50 bytes of ASN.1 is
+    // estimated at 328 bytes, so each shard holds three of them.
+    CSeqDBDeflineCache cache(16 * 1000);
+
+    CRef<CBlast_def_line_set> hdr[4];
+    for(int i = 0; i < 4; i++) {
+        hdr[i].Reset(new CBlast_def_line_set);
+    }
+
+    BOOST_REQUIRE(cache.Find(0).Empty());
+
+    // OIDs that are multiples of 16 share a shard.
+    cache.Add(0,  hdr[0], 50);
+    cache.Add(16, hdr[1], 50);
+    cache.Add(32, hdr[2], 50);
+
+    // Hits return the cached object itself.
+    BOOST_REQUIRE(cache.Find(0).GetPointerOrNull()  == hdr[0].GetPointer());
+    BOOST_REQUIRE(cache.Find(16).GetPointerOrNull() == hdr[1].GetPointer());
+    BOOST_REQUIRE(cache.Find(32).GetPointerOrNull() == hdr[2].GetPointer());
+
+    // OID 0 was used after 16; adding a fourth entry evicts 16.
+    cache.Find(0);
+    cache.Add(48, hdr[3], 50);
+
+    BOOST_REQUIRE(cache.Find(16).Empty());
+    BOOST_REQUIRE(cache.Find(0).NotEmpty());
+    BOOST_REQUIRE(cache.Find(32).NotEmpty());
+    BOOST_REQUIRE(cache.Find(48).NotEmpty());
+
+    // Other shards are not affected, and entries larger than a shard
+    // are not added.
+    cache.Add(1, hdr[1], 50);
+    cache.Add(2, hdr[2], 1000);
+
+    BOOST_REQUIRE(cache.Find(1).NotEmpty());
+    BOOST_REQUIRE(cache.Find(2).Empty());
+    BOOST_REQUIRE(cache.Find(0).NotEmpty());
+}
+
+BOOST_AUTO_TEST_CASE(DeflineCacheSizeZero)
+{
+
+    CSeqDBDeflineCache cache(0);
+    CRef<CBlast_def_line_set> hdr(new CBlast_def_line_set);
+
+    cache.Add(0, hdr, 1);
+    BOOST_REQUIRE(cache.Find(0).Empty());
+
+    CSeqDB db("data/seqp", CSeqDB::eProtein);
+    string expected = s_Stringify(db.GetHdr(0));
+
+    db.SetDeflineCacheSize(1 << 20);
+    db.GetHdr(0);
+    db.SetDeflineCacheSize(0);
+
+    BOOST_REQUIRE_EQUAL(expected, s_Stringify(db.GetHdr(0)));
+    BOOST_REQUIRE_EQUAL(expected, s_Stringify(db.GetHdr(0)));
+}
+
+BOOST_AUTO_TEST_CASE(DeflineCacheReturnsCopies)
+{
+
+    CSeqDB db("data/seqp", CSeqDB::eProtein);
+
+    string hdr0 = s_Stringify(db.GetHdr(0));
+    string hdr1 = s_Stringify(db.GetHdr(1));
+    string bioseq0 = s_Stringify(db.GetBioseq(0));
+
+    db.SetDeflineCacheSize(1 << 20);
+
+    // The first call fills the cache, the second one hits it.
+    CRef<CBlast_def_line_set> miss = db.GetHdr(0);
+    CRef<CBlast_def_line_set> hit  = db.GetHdr(0);
+
+    BOOST_REQUIRE(miss.GetPointer() != hit.GetPointer());
+    BOOST_REQUIRE_EQUAL(hdr0, s_Stringify(miss));
+    BOOST_REQUIRE_EQUAL(hdr0, s_Stringify(hit));
+
+    // Changing a returned object does not change the cached one.
+    miss->Set().clear();
+    hit->Set().clear();
+
+    BOOST_REQUIRE_EQUAL(hdr0, s_Stringify(db.GetHdr(0)));
+    BOOST_REQUIRE_EQUAL(hdr1, s_Stringify(db.GetHdr(1)));
+
+    // GetBioseq builds the same bioseq from the cached deflines, and
+    // changing its ids does not change them.
+    CRef<CBioseq> bs = db.GetBioseq(0);
+    BOOST_REQUIRE_EQUAL(bioseq0, s_Stringify(bs));
+
+    NON_CONST_ITERATE(CBioseq::TId, id, bs->SetId()) {
+        (*id)->SetLocal().SetStr("changed");
+    }
+
+    BOOST_REQUIRE_EQUAL(hdr0, s_Stringify(db.GetHdr(0)));
+    BOOST_REQUIRE_EQUAL(bioseq0, s_Stringify(db.GetBioseq(0)));
+}
+
 BOOST_AUTO_TEST_CASE(GetSeqIDsN)
 {
 
@@ -2219,6 +2362,55 @@ BOOST_AUTO_TEST_CASE(SeqidToOid)
     }
 }
 
+BOOST_AUTO_TEST_CASE(AccessionsToOids)
+{
+
+    CSeqDB db("data/nrshort", CSeqDB::eProtein);
+
+    // Found and not found ids of each kind, out of OID order, and
+    // with a repeated id.
+
+    const char * accs[] = {
+        "XP_642837.1",      // 2
+        "xx_999999.1",      // not found
+        "NP_268346.1",      // 0
+        "12725253",         // 0, as a GI
+        "99999999",         // not found
+        "gi|66816243",      // 1
+        "AAO51685",         // 2, without a version
+        "Q4QBU6",           // 10
+        "NP_268346.1",      // 0
+        "P54670",           // 1
+        "gb|ABQ73725.1|",   // 7
+        "zz_1"              // not found
+    };
+    const int exp_oids[] = { 2, -1, 0, 0, -1, 1, 2, 10, 0, 1, 7, -1 };
+
+    vector<string> acc_list(accs, accs + ArraySize(accs));
+    vector<int> oids;
+
+    db.AccessionsToOids(acc_list, oids);
+
+    BOOST_REQUIRE_EQUAL(oids.size(), acc_list.size());
+
+    for(size_t i = 0; i < acc_list.size(); i++) {
+        vector<int> acc_oids;
+        db.AccessionToOids(acc_list[i], acc_oids);
+
+        int exp_oid = acc_oids.empty() ? -1 : acc_oids.front();
+
+        BOOST_REQUIRE_MESSAGE(oids[i] == exp_oid,
+                              "Mismatch for " << acc_list[i]);
+        BOOST_REQUIRE_EQUAL(exp_oids[i], oids[i]);
+    }
+
+    // An empty list gives an empty result.
+
+    acc_list.clear();
+    db.AccessionsToOids(acc_list, oids);
+    BOOST_REQUIRE(oids.empty());
+}
+
 BOOST_AUTO_TEST_CASE(TestResetInternalChunkBookmark)
 {
 
@@ -2249,6 +2441,117 @@ BOOST_AUTO_TEST_CASE(TestResetInternalChunkBookmark)
     BOOST_REQUIRE_EQUAL(kLastOid, end);
 }
 
+/// Wait for the background reader to process some prefetch requests.
+static SSeqDBPrefetchStats
+s_WaitForPrefetch(const CSeqDB & db, Uint8 requests)
+{
+    SSeqDBPrefetchStats stats = db.GetPrefetchStats();
+
+    for(int i = 0; i < 3000 && stats.requests < requests; i++) {
+        SleepMilliSec(10);
+        stats = db.GetPrefetchStats();
+    }
+
+    return stats;
+}
+
+/// Read all chunks of a database with GetNextOIDChunk.
+static void s_ReadAllChunks(CSeqDB & db, int chunk_size)
+{
+    int start = 0, end = 0;
+    vector<int> oid_list;
+
+    while(db.GetNextOIDChunk(start, end, chunk_size, oid_list) ==
+          CSeqDB::eOidList || start != end) {
+    }
+}
+
+BOOST_AUTO_TEST_CASE(PrefetchStats)
+{
+
+    CSeqDB db("data/seqp", CSeqDB::eProtein);
+    const int kNumOids = db.GetNumOIDs();
+
+    BOOST_REQUIRE_EQUAL((Uint8) 0, db.GetPrefetchStats().requests);
+
+    // Empty and out of range requests are ignored.
+    db.Prefetch(5, 5);
+    db.Prefetch(kNumOids, kNumOids + 10);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 0, db.GetPrefetchStats().requests);
+
+    // The whole sequence file area of the OIDs is read.
+    db.Prefetch(0, 10);
+    db.Prefetch(10, kNumOids);
+
+    SSeqDBPrefetchStats stats = s_WaitForPrefetch(db, 2);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 2, stats.requests);
+
+    Uint8 residues = 0;
+    for(int oid = 0; oid < kNumOids; oid++) {
+        // Each protein sequence is followed by a null byte.
+        residues += db.GetSeqLength(oid) + 1;
+    }
+    BOOST_REQUIRE_EQUAL(residues, stats.bytes);
+    BOOST_REQUIRE(stats.pages > 0);
+}
+
+BOOST_AUTO_TEST_CASE(SequentialReadaheadIsOptIn)
+{
+
+    CSeqDB db("data/seqn", CSeqDB::eNucleotide);
+
+    s_ReadAllChunks(db, 10);
+    SleepMilliSec(100);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 0, db.GetPrefetchStats().requests);
+
+    // Enabled, the OIDs after the first chunk are read ahead in one
+    // request; resetting the bookmark starts the readahead over.
+    db.SetSequentialReadahead(true);
+    db.ResetInternalChunkBookmark();
+    s_ReadAllChunks(db, 10);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 1, s_WaitForPrefetch(db, 1).requests);
+
+    db.ResetInternalChunkBookmark();
+    s_ReadAllChunks(db, 10);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 2, s_WaitForPrefetch(db, 2).requests);
+}
+
+BOOST_AUTO_TEST_CASE(SequentialReadaheadFollowsOidMask)
+{
+
+    // The three GIs of the list are far apart in the database.
+    CRef<CSeqDBGiList> gi_list(new CSeqDBFileGiList("data/seqn_3gis.gil"));
+    CSeqDB masked("data/seqn", CSeqDB::eNucleotide, gi_list);
+
+    vector<int> oids;
+    for(int oid = 0; masked.CheckOrFindOID(oid); oid++) {
+        oids.push_back(oid);
+    }
+    BOOST_REQUIRE_EQUAL(3, (int) oids.size());
+
+    masked.SetSequentialReadahead(true);
+    s_ReadAllChunks(masked, 10);
+
+    SSeqDBPrefetchStats stats = s_WaitForPrefetch(masked, 3);
+
+    // Each included OID is read on its own; excluded ones are not read.
+    CSeqDB db("data/seqn", CSeqDB::eNucleotide);
+    ITERATE(vector<int>, oid, oids) {
+        db.Prefetch(*oid, *oid + 1);
+    }
+
+    SSeqDBPrefetchStats expected = s_WaitForPrefetch(db, 3);
+
+    BOOST_REQUIRE_EQUAL((Uint8) 3, expected.requests);
+    BOOST_REQUIRE_EQUAL(expected.requests, stats.requests);
+    BOOST_REQUIRE_EQUAL(expected.bytes, stats.bytes);
+}
+
 BOOST_AUTO_TEST_CASE(ExpertNullConstructor)
 {
 
@@ -4244,6 +4547,209 @@ BOOST_AUTO_TEST_CASE(TestOidNotFoundWithUserAliasFileAndGiList)
     BOOST_CHECK_EQUAL(0U, filtered_gis.size());
 }
 
+/// Check that a bitset holds exactly the bits of a reference.
+static void s_CheckBitSet(const CSeqDB_BitSet & bits,
+                          const CSeqDB_BitSet & expected)
+{
+    BOOST_REQUIRE_EQUAL(expected.GetStart(), bits.GetStart());
+    BOOST_REQUIRE_EQUAL(expected.GetEnd(), bits.GetEnd());
+
+    size_t i = 0, j = 0;
+
+    while(true) {
+        bool found = bits.CheckOrFindBit(i);
+        bool exp_found = expected.CheckOrFindBit(j);
+
+        BOOST_REQUIRE_EQUAL(exp_found, found);
+        if (! found) {
+            break;
+        }
+        BOOST_REQUIRE_EQUAL(j, i);
+        i++;
+        j++;
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BitSetFromMaskData)
+{
+
+    // Mask data covering more than two BitMagic blocks (65536 bits).
+    vector<unsigned char> data(20000);
+    unsigned int seed = 17;
+
+    for(size_t i = 0; i < data.size(); i++) {
+        seed = seed * 1103515245 + 12345;
+        data[i] = (unsigned char)(seed >> 16);
+    }
+    // Long runs of clear and set bits.
+    fill(data.begin() + 1000, data.begin() + 9500, 0);
+    fill(data.begin() + 12000, data.begin() + 13000, 0xFF);
+
+    const unsigned char * p1 = & data[0];
+    const unsigned char * p2 = p1 + data.size();
+
+    // Unaligned starts, ends within a byte and data shorter than
+    // the range are all handled like the byte-by-byte definition.
+    const size_t kStarts[] = { 0, 3, 8, 65533, 65536, 100001 };
+    const size_t kLengths[] = { 1, 13, 8 * 20000, 8 * 20000 - 5,
+                                8 * 20000 + 77 };
+
+    for(size_t si = 0; si < ArraySize(kStarts); si++) {
+        for(size_t li = 0; li < ArraySize(kLengths); li++) {
+            size_t start = kStarts[si];
+            size_t end = start + kLengths[li];
+
+            CSeqDB_BitSet expected(start, end);
+
+            for(size_t oid = start; oid < end; oid++) {
+                size_t rel = oid - start;
+
+                if (rel / 8 < data.size() &&
+                    (data[rel / 8] & (0x80 >> (rel % 8)))) {
+                    expected.SetBit(oid);
+                }
+            }
+
+            CSeqDB_BitSet bits(start, end, p1, p2);
+            s_CheckBitSet(bits, expected);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(BitSetSerialize)
+{
+
+    CSeqDB_BitSet bits(5, 200000);
+    for(size_t i = 5; i < 200000; i += 7) {
+        bits.SetBit(i);
+    }
+    bits.AssignBitRange(100000, 150000, true);
+
+    string data;
+    bits.Serialize(data);
+
+    CSeqDB_BitSet copy;
+    BOOST_REQUIRE(copy.Deserialize(data));
+    s_CheckBitSet(copy, bits);
+
+    // Special cases keep their type.
+    CSeqDB_BitSet all_set(10, 20, CSeqDB_BitSet::eAllSet);
+    all_set.Serialize(data);
+    BOOST_REQUIRE(copy.Deserialize(data));
+    s_CheckBitSet(copy, all_set);
+
+    // Damaged or truncated data is rejected, leaving the object as
+    // it was.
+    bits.Serialize(data);
+
+    string damaged(data);
+    damaged[damaged.size() - 1] ^= 0x10;
+    BOOST_REQUIRE(! copy.Deserialize(damaged));
+    BOOST_REQUIRE(! copy.Deserialize(data.substr(0, data.size() - 1)));
+    BOOST_REQUIRE(! copy.Deserialize(data.substr(0, 8)));
+    BOOST_REQUIRE(! copy.Deserialize(kEmptyStr));
+    s_CheckBitSet(copy, all_set);
+}
+
+/// Read the OIDs included by a database's filters.
+static vector<int> s_GetIncludedOids(const string & dbname)
+{
+    CSeqDB db(dbname, CSeqDB::eNucleotide);
+    vector<int> oids;
+
+    for(int oid = 0; db.CheckOrFindOID(oid); oid++) {
+        oids.push_back(oid);
+    }
+    return oids;
+}
+
+BOOST_AUTO_TEST_CASE(OidMaskCacheFollowsListContents)
+{
+
+    CTmpFile gilist_tmpfile;
+    CTmpFile alias_tmpfile;
+    string gilist_name = gilist_tmpfile.GetFileName();
+    string alias_name = alias_tmpfile.GetFileName() + ".nal";
+    string cache_name = gilist_name + ".seqn.0.obm";
+    CFileDeleteAtExit::Add(gilist_name);
+    CFileDeleteAtExit::Add(alias_name);
+    CFileDeleteAtExit::Add(cache_name);
+
+    // Two one-GI lists of the same size, selecting different OIDs.
+    CSeqDB seqn("data/seqn", CSeqDB::eNucleotide);
+    const int kOidA = 10;
+    TGi gi_a = ZERO_GI, gi_b = ZERO_GI;
+    BOOST_REQUIRE(seqn.OidToGi(kOidA, gi_a));
+
+    int oid_b = kOidA + 1;
+    for( ; oid_b < seqn.GetNumOIDs(); oid_b++) {
+        if (seqn.OidToGi(oid_b, gi_b) &&
+            NStr::NumericToString(gi_b).size() ==
+            NStr::NumericToString(gi_a).size()) {
+            break;
+        }
+    }
+    BOOST_REQUIRE(oid_b < seqn.GetNumOIDs());
+
+    {{
+        ofstream stream(gilist_name.c_str());
+        stream << gi_a << endl;
+    }}
+    {{
+        ofstream stream(alias_name.c_str());
+        stream << "TITLE mask cache test" << endl;
+        stream << "DBLIST " << CDirEntry::CreateAbsolutePath("data/seqn")
+               << endl;
+        stream << "GILIST " << gilist_name << endl;
+    }}
+
+    CNcbiEnvironment env;
+    env.Set("BLASTDB_OID_MASK_CACHE", "1");
+
+    vector<int> expected_a(1, kOidA), expected_b(1, oid_b);
+
+    // The first open writes the cache, the second reads it.
+    BOOST_CHECK(s_GetIncludedOids(alias_tmpfile.GetFileName()) == expected_a);
+    BOOST_CHECK(CFile(cache_name).Exists());
+    BOOST_CHECK(s_GetIncludedOids(alias_tmpfile.GetFileName()) == expected_a);
+
+    // A list with new contents but the same size and time, and an
+    // older cache file, must not use the cached mask.
+    time_t list_time = 0;
+    BOOST_REQUIRE(CFile(gilist_name).GetTimeT(& list_time));
+    {{
+        ofstream stream(gilist_name.c_str());
+        stream << gi_b << endl;
+    }}
+    BOOST_REQUIRE(CFile(gilist_name).SetTimeT(& list_time));
+    BOOST_CHECK(s_GetIncludedOids(alias_tmpfile.GetFileName()) == expected_b);
+    BOOST_CHECK(s_GetIncludedOids(alias_tmpfile.GetFileName()) == expected_b);
+
+    // A damaged cache file is ignored and replaced.
+    string cache_data;
+    {{
+        CNcbiIfstream stream(cache_name.c_str(), IOS_BASE::binary);
+        NcbiStreamToString(& cache_data, stream);
+    }}
+    BOOST_REQUIRE(! cache_data.empty());
+    cache_data[cache_data.size() - 1] ^= 0x10;
+    {{
+        CNcbiOfstream stream(cache_name.c_str(), IOS_BASE::binary);
+        stream.write(cache_data.data(), cache_data.size());
+    }}
+    BOOST_CHECK(s_GetIncludedOids(alias_tmpfile.GetFileName()) == expected_b);
+
+    string new_cache_data;
+    {{
+        CNcbiIfstream stream(cache_name.c_str(), IOS_BASE::binary);
+        NcbiStreamToString(& new_cache_data, stream);
+    }}
+    BOOST_CHECK_EQUAL(cache_data.size(), new_cache_data.size());
+    BOOST_CHECK(cache_data != new_cache_data);
+
+    env.Unset("BLASTDB_OID_MASK_CACHE");
+}
+
 BOOST_AUTO_TEST_CASE(TestSpaceInDbName)
 {
 	// SVN does not allow filename with space, so we need to make one up on the fly
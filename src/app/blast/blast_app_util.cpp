@@ -783,6 +783,15 @@ void BlastFormatter_PreFetchSequenceData(const blast::CSearchResultSet&
     }
 }
 
+void CBlastFormatResultsHandler::HandleResults(CRef<blast::CSearchResults>
+                                               results)
+{
+    blast::CSearchResultSet result_set;
+    result_set.push_back(results);
+    BlastFormatter_PreFetchSequenceData(result_set, m_Scope);
+    m_Formatter.PrintOneResultSet(*results, m_Queries);
+}
+
 /// Auxiliary function to extract the ancillary data from the PSSM.
 CRef<CBlastAncillaryData>
 ExtractPssmAncillaryData(const CPssmWithParameters& pssm)
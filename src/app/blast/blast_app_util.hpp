@@ -50,6 +50,8 @@
 
 BEGIN_NCBI_SCOPE
 
+class CBlastFormat;
+
 /// Class to mix batch size for BLAST runs
 class CBatchSizeMixer 
 {
@@ -275,6 +277,32 @@ void
 BlastFormatter_PreFetchSequenceData(const blast::CSearchResultSet&
                                     results, CRef<CScope> scope);
 
+/// Formats the results of a search one query at a time, as they are passed
+/// on by CLocalBlast::Run(blast::ISearchResultsHandler&), so that the
+/// results for the whole query batch are never held in memory
+class CBlastFormatResultsHandler : public blast::ISearchResultsHandler
+{
+public:
+    /// Constructor
+    /// @param formatter Formatter for the results [in]
+    /// @param queries Query sequences of the search [in]
+    /// @param scope CScope object from which the sequence data will be
+    /// fetched [in]
+    CBlastFormatResultsHandler(CBlastFormat& formatter,
+                               CConstRef<blast::CBlastQueryVector> queries,
+                               CRef<CScope> scope)
+        : m_Formatter(formatter), m_Queries(queries), m_Scope(scope) {}
+
+    /// Format the results for one query
+    /// @param results Results for one query [in]
+    virtual void HandleResults(CRef<blast::CSearchResults> results);
+
+private:
+    CBlastFormat& m_Formatter;                    ///< Formatter
+    CConstRef<blast::CBlastQueryVector> m_Queries; ///< Query sequences
+    CRef<CScope> m_Scope;                         ///< Scope for prefetching
+};
+
 /// Auxiliary function to extract the ancillary data from the PSSM.
 /// Used in PSI-BLAST and DELTA-BLAST
 ///@param pssm Pssm [in]
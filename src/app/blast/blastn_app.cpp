@@ -171,6 +171,20 @@ int CBlastnApp::Run(void)
         /*** Process the input ***/
         CBatchSizeMixer mixer(SplitQuery_GetChunkSize(opt.GetProgram())-1000);
         int batch_size = m_CmdLineArgs->GetQueryBatchSize();
+
+        // used for experimentation purposes: pack short queries into batches
+        // whose megablast lookup table fits in the given amount of cache
+        char* cache_sz_str = getenv("BATCH_CACHE_SIZE");
+        if (cache_sz_str && !batch_size &&
+            !m_CmdLineArgs->ExecuteRemotely() &&
+            opt.GetProgram() == eMegablast && !opt.GetMBIndexLoaded()) {
+            opts_hndl->SetOptions().SetMBCompactBackbone(true);
+            batch_size = GetCacheAwareQueryBatchSize(opt,
+                             NStr::StringToUInt8_DataSize(cache_sz_str));
+            batch_size = min(batch_size,
+                             (int)SplitQuery_GetChunkSize(opt.GetProgram()) - 1000);
+        }
+
         if (batch_size) {
             input.SetBatchSize(batch_size);
         } else {
@@ -199,11 +213,23 @@ int CBlastnApp::Run(void)
             } else {
                 CLocalBlast lcl_blast(queries, opts_hndl, db_adapter);
                 lcl_blast.SetNumberOfThreads(m_CmdLineArgs->GetNumThreads());
-                results = lcl_blast.Run();
+                if (isArchiveFormat) {
+                    results = lcl_blast.Run();
+                } else {
+                    // format the results for each query as soon as they
+                    // are available
+                    CBlastFormatResultsHandler handler(formatter, query_batch,
+                                                       scope);
+                    lcl_blast.Run(handler);
+                }
                 if (!batch_size) 
                     input.SetBatchSize(mixer.GetBatchSize(lcl_blast.GetNumExtensions()));
             }
 
+            if (results.Empty()) {
+                continue;   // already formatted
+            }
+
             if (isArchiveFormat) {
                 formatter.WriteArchive(*queries, *opts_hndl, *results, 0, bah.GetMessages());
                 bah.ResetMessages();
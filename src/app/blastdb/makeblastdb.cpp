@@ -234,6 +234,18 @@ void CMakeBlastDBApp::Init()
                       "Create index of sequence hash values.",
                       true);
 
+    arg_desc->AddFlag("taxid_index",
+                      "Create index of taxonomy IDs to sequences.",
+                      true);
+
+    arg_desc->AddDefaultKey("threads", "int_value",
+                            "Number of threads used to parse the input and "
+                            "convert sequences; 0 builds the database in a "
+                            "single thread",
+                            CArgDescriptions::eInteger, "0");
+    arg_desc->SetConstraint("threads",
+                            new CArgAllowValuesGreaterThanOrEqual(0));
+
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     arg_desc->SetCurrentGroup("Sequence masking options");
@@ -1078,10 +1090,12 @@ void CMakeBlastDBApp::x_BuildDatabase()
 
     bool parse_seqids = x_ShouldParseSeqIds();
     bool hash_index = args["hash_index"];
+    bool taxid_index = args["taxid_index"];
     bool use_gi_mask = args["gi_mask"];
 
     CWriteDB::TIndexType indexing = CWriteDB::eNoIndex;
     indexing |= (hash_index ? CWriteDB::eAddHash : 0);
+    indexing |= (taxid_index ? CWriteDB::eAddTaxIds : 0);
     indexing |= (parse_seqids ? CWriteDB::eFullIndex : 0);
 
     m_DB.Reset(new CBuildDatabase(dbname,
@@ -1124,6 +1138,10 @@ void CMakeBlastDBApp::x_BuildDatabase()
 
     m_DB->SetMaxFileSize(bytes);
 
+    if (args["threads"].AsInteger() > 0) {
+        m_DB->SetNumberOfThreads(args["threads"].AsInteger());
+    }
+
     if (args["taxid"].HasValue()) {
         _ASSERT( !args["taxid_map"].HasValue() );
         CRef<CTaxIdSet> taxids(new CTaxIdSet(args["taxid"].AsInteger()));
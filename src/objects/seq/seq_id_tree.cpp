@@ -194,6 +194,12 @@ CSeq_id_Info* CSeq_id_Which_Tree::CreateInfo(const CSeq_id& id)
 void CSeq_id_Which_Tree::DropInfo(const CSeq_id_Info* info)
 {
     TWriteLockGuard guard(m_TreeLock);
+    x_DropInfo(info);
+}
+
+
+void CSeq_id_Which_Tree::x_DropInfo(const CSeq_id_Info* info)
+{
     if ( info->IsLocked() ) {
         _ASSERT(info->m_Seq_id_Type != CSeq_id::e_not_set);
         return;
@@ -363,7 +369,12 @@ CSeq_id_int_Tree::~CSeq_id_int_Tree(void)
 
 bool CSeq_id_int_Tree::Empty(void) const
 {
-    return m_IntMap.empty();
+    for ( size_t i = 0; i < kShards; ++i ) {
+        if ( !m_Shards[i].m_IntMap.empty() ) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
@@ -372,9 +383,10 @@ CSeq_id_Handle CSeq_id_int_Tree::FindInfo(const CSeq_id& id) const
     _ASSERT(x_Check(id));
     TPacked value = x_Get(id);
 
-    TReadLockGuard guard(m_TreeLock);
-    TIntMap::const_iterator it = m_IntMap.find(value);
-    if (it != m_IntMap.end()) {
+    const SShard& shard = x_GetShard(value);
+    TReadLockGuard guard(shard.m_Lock);
+    TIntMap::const_iterator it = shard.m_IntMap.find(value);
+    if (it != shard.m_IntMap.end()) {
         return CSeq_id_Handle(it->second);
     }
     return null;
@@ -386,9 +398,17 @@ CSeq_id_Handle CSeq_id_int_Tree::FindOrCreate(const CSeq_id& id)
     _ASSERT(x_Check(id));
     TPacked value = x_Get(id);
 
-    TWriteLockGuard guard(m_TreeLock);
+    SShard& shard = x_GetShard(value);
+    {{
+        TReadLockGuard guard(shard.m_Lock);
+        TIntMap::const_iterator it = shard.m_IntMap.find(value);
+        if (it != shard.m_IntMap.end()) {
+            return CSeq_id_Handle(it->second);
+        }
+    }}
+    TWriteLockGuard guard(shard.m_Lock);
     pair<TIntMap::iterator, bool> ins =
-        m_IntMap.insert(TIntMap::value_type(value, nullptr));
+        shard.m_IntMap.insert(TIntMap::value_type(value, nullptr));
     if ( ins.second ) {
         ins.first->second = CreateInfo(id);
     }
@@ -396,12 +416,21 @@ CSeq_id_Handle CSeq_id_int_Tree::FindOrCreate(const CSeq_id& id)
 }
 
 
+void CSeq_id_int_Tree::DropInfo(const CSeq_id_Info* info)
+{
+    // the seq-id of an info never changes, so it selects the shard
+    TPacked value = x_Get(*info->GetSeqId());
+    TWriteLockGuard guard(x_GetShard(value).m_Lock);
+    x_DropInfo(info);
+}
+
+
 void CSeq_id_int_Tree::x_Unindex(const CSeq_id_Info* info)
 {
     _ASSERT(x_Check(*info->GetSeqId()));
     TPacked value = x_Get(*info->GetSeqId());
 
-    _VERIFY(m_IntMap.erase(value));
+    _VERIFY(x_GetShard(value).m_IntMap.erase(value));
 }
 
 
@@ -416,9 +445,10 @@ void CSeq_id_int_Tree::FindMatchStr(const string& sid,
         // Not an integer value
         return;
     }
-    TReadLockGuard guard(m_TreeLock);
-    TIntMap::const_iterator it = m_IntMap.find(value);
-    if (it != m_IntMap.end()) {
+    const SShard& shard = x_GetShard(value);
+    TReadLockGuard guard(shard.m_Lock);
+    TIntMap::const_iterator it = shard.m_IntMap.find(value);
+    if (it != shard.m_IntMap.end()) {
         id_list.insert(CSeq_id_Handle(it->second));
     }
 }
@@ -432,7 +462,10 @@ size_t CSeq_id_int_Tree::Dump(CNcbiOstream& out,
     if ( details >= CSeq_id_Mapper::eDumpStatistics ) {
         out << "CSeq_id_Handles("<<CSeq_id::SelectionName(type)<<"): ";
     }
-    size_t count = m_IntMap.size(), elem_size = 0, extra_size = 0;
+    size_t count = 0, elem_size = 0, extra_size = 0;
+    for ( size_t i = 0; i < kShards; ++i ) {
+        count += m_Shards[i].m_IntMap.size();
+    }
     if ( count ) {
         elem_size = sizeof(int)+sizeof(void*); // map value
         elem_size += sizeof(int)+3*sizeof(void*); // red/black tree overhead
@@ -448,8 +481,10 @@ size_t CSeq_id_int_Tree::Dump(CNcbiOstream& out,
         out << count << " handles, "<<bytes<<" bytes" << endl;
     }
     if ( details >= CSeq_id_Mapper::eDumpAllIds ) {
-        ITERATE ( TIntMap, it, m_IntMap ) {
-            out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+        for ( size_t i = 0; i < kShards; ++i ) {
+            ITERATE ( TIntMap, it, m_Shards[i].m_IntMap ) {
+                out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+            }
         }
     }
     return total_bytes;
@@ -962,6 +997,13 @@ CSeq_id_Handle CSeq_id_Textseq_Tree::FindOrCreate(const CSeq_id& id)
             CSeq_id_Textseq_Info::ParseAcc(tid.GetAccession(), &tid);
         if ( key ) {
             TPacked packed = CSeq_id_Textseq_Info::Pack(key, tid);
+            {{
+                TReadLockGuard guard(m_TreeLock);
+                TPackedMap_CI it = m_PackedMap.find(key);
+                if ( it != m_PackedMap.end() ) {
+                    return CSeq_id_Handle(it->second, packed);
+                }
+            }}
             TWriteLockGuard guard(m_TreeLock);
             TPackedMap_I it = m_PackedMap.lower_bound(key);
             if ( it == m_PackedMap.end() ||
@@ -973,6 +1015,12 @@ CSeq_id_Handle CSeq_id_Textseq_Tree::FindOrCreate(const CSeq_id& id)
             return CSeq_id_Handle(it->second, packed);
         }
     }
+    {{
+        TReadLockGuard guard(m_TreeLock);
+        if ( CSeq_id_Info* info = x_FindStrInfo(id.Which(), tid) ) {
+            return CSeq_id_Handle(info);
+        }
+    }}
     TWriteLockGuard guard(m_TreeLock);
     CSeq_id_Info* info = x_FindStrInfo(id.Which(), tid);
     if ( !info ) {
@@ -1584,21 +1632,38 @@ CSeq_id_Local_Tree::~CSeq_id_Local_Tree(void)
 
 bool CSeq_id_Local_Tree::Empty(void) const
 {
-    return m_ByStr.empty() && m_ById.empty();
+    for ( size_t i = 0; i < kShards; ++i ) {
+        if ( !m_Shards[i].m_ByStr.empty() || !m_Shards[i].m_ById.empty() ) {
+            return false;
+        }
+    }
+    return true;
 }
 
 
-CSeq_id_Info* CSeq_id_Local_Tree::x_FindInfo(const CObject_id& oid) const
+size_t CSeq_id_Local_Tree::x_GetShardIndex(const string& str)
+{
+    // the string map is case-insensitive, so is the hash
+    size_t h = 0;
+    ITERATE ( string, it, str ) {
+        h = h*17 + tolower((unsigned char)*it);
+    }
+    return h % kShards;
+}
+
+
+CSeq_id_Info* CSeq_id_Local_Tree::x_FindInfo(const SShard& shard,
+                                             const CObject_id& oid)
 {
     if ( oid.IsStr() ) {
-        TByStr::const_iterator it = m_ByStr.find(oid.GetStr());
-        if (it != m_ByStr.end()) {
+        TByStr::const_iterator it = shard.m_ByStr.find(oid.GetStr());
+        if (it != shard.m_ByStr.end()) {
             return it->second;
         }
     }
     else if ( oid.IsId() ) {
-        TById::const_iterator it = m_ById.find(oid.GetId());
-        if (it != m_ById.end()) {
+        TById::const_iterator it = shard.m_ById.find(oid.GetId());
+        if (it != shard.m_ById.end()) {
             return it->second;
         }
     }
@@ -1611,8 +1676,9 @@ CSeq_id_Handle CSeq_id_Local_Tree::FindInfo(const CSeq_id& id) const
 {
     _ASSERT( id.IsLocal() );
     const CObject_id& oid = id.GetLocal();
-    TReadLockGuard guard(m_TreeLock);
-    return CSeq_id_Handle(x_FindInfo(oid));
+    const SShard& shard = x_GetShard(oid);
+    TReadLockGuard guard(shard.m_Lock);
+    return CSeq_id_Handle(x_FindInfo(shard, oid));
 }
 
 
@@ -1620,18 +1686,25 @@ CSeq_id_Handle CSeq_id_Local_Tree::FindOrCreate(const CSeq_id& id)
 {
     _ASSERT(id.IsLocal());
     const CObject_id& oid = id.GetLocal();
-    TWriteLockGuard guard(m_TreeLock);
-    CSeq_id_Info* info = x_FindInfo(oid);
+    SShard& shard = x_GetShard(oid);
+    {{
+        TReadLockGuard guard(shard.m_Lock);
+        if ( CSeq_id_Info* info = x_FindInfo(shard, oid) ) {
+            return CSeq_id_Handle(info);
+        }
+    }}
+    TWriteLockGuard guard(shard.m_Lock);
+    CSeq_id_Info* info = x_FindInfo(shard, oid);
 
     if ( !info ) {
         info = CreateInfo(id);
         if ( oid.IsStr() ) {
-            _VERIFY(m_ByStr.insert(TByStr::value_type(oid.GetStr(),
-                                                      info)).second);
+            _VERIFY(shard.m_ByStr.insert(TByStr::value_type(oid.GetStr(),
+                                                            info)).second);
         }
         else if ( oid.IsId() ) {
-            _VERIFY(m_ById.insert(TById::value_type(oid.GetId(),
-                                                    info)).second);
+            _VERIFY(shard.m_ById.insert(TById::value_type(oid.GetId(),
+                                                          info)).second);
         }
         else {
             NCBI_THROW(CSeq_id_MapperException, eEmptyError,
@@ -1642,17 +1715,28 @@ CSeq_id_Handle CSeq_id_Local_Tree::FindOrCreate(const CSeq_id& id)
 }
 
 
+void CSeq_id_Local_Tree::DropInfo(const CSeq_id_Info* info)
+{
+    // the seq-id of an info never changes, so it selects the shard
+    CConstRef<CSeq_id> id = info->GetSeqId();
+    _ASSERT(id->IsLocal());
+    TWriteLockGuard guard(x_GetShard(id->GetLocal()).m_Lock);
+    x_DropInfo(info);
+}
+
+
 void CSeq_id_Local_Tree::x_Unindex(const CSeq_id_Info* info)
 {
     CConstRef<CSeq_id> id = info->GetSeqId();
     _ASSERT(id->IsLocal());
     const CObject_id& oid = id->GetLocal();
+    SShard& shard = x_GetShard(oid);
 
     if ( oid.IsStr() ) {
-        _VERIFY(m_ByStr.erase(oid.GetStr()));
+        _VERIFY(shard.m_ByStr.erase(oid.GetStr()));
     }
     else if ( oid.IsId() ) {
-        _VERIFY(m_ById.erase(oid.GetId()));
+        _VERIFY(shard.m_ById.erase(oid.GetId()));
     }
 }
 
@@ -1660,24 +1744,29 @@ void CSeq_id_Local_Tree::x_Unindex(const CSeq_id_Info* info)
 void CSeq_id_Local_Tree::FindMatchStr(const string& sid,
                                       TSeq_id_MatchList& id_list) const
 {
-    TReadLockGuard guard(m_TreeLock);
     // In any case search in strings
-    TByStr::const_iterator str_it = m_ByStr.find(sid);
-    if (str_it != m_ByStr.end()) {
-        id_list.insert(CSeq_id_Handle(str_it->second));
-    }
-    else {
-        try {
-            TPacked value = NStr::StringToNumeric<TPacked>(sid);
-            TById::const_iterator int_it = m_ById.find(value);
-            if (int_it != m_ById.end()) {
-                id_list.insert(CSeq_id_Handle(int_it->second));
-            }
-        }
-        catch (const CStringException& /*ignored*/) {
-            // Not an integer value
+    {{
+        const SShard& shard = m_Shards[x_GetShardIndex(sid)];
+        TReadLockGuard guard(shard.m_Lock);
+        TByStr::const_iterator str_it = shard.m_ByStr.find(sid);
+        if (str_it != shard.m_ByStr.end()) {
+            id_list.insert(CSeq_id_Handle(str_it->second));
             return;
         }
+    }}
+    TPacked value;
+    try {
+        value = NStr::StringToNumeric<TPacked>(sid);
+    }
+    catch (const CStringException& /*ignored*/) {
+        // Not an integer value
+        return;
+    }
+    const SShard& shard = m_Shards[x_GetShardIndex(value)];
+    TReadLockGuard guard(shard.m_Lock);
+    TById::const_iterator int_it = shard.m_ById.find(value);
+    if (int_it != shard.m_ById.end()) {
+        id_list.insert(CSeq_id_Handle(int_it->second));
     }
 }
 
@@ -1691,7 +1780,10 @@ size_t CSeq_id_Local_Tree::Dump(CNcbiOstream& out,
         out << "CSeq_id_Handles("<<CSeq_id::SelectionName(type)<<"): "<<endl;
     }
     {{
-        size_t size = m_ByStr.size(), elem_size = 0, extra_size = 0;
+        size_t size = 0, elem_size = 0, extra_size = 0;
+        for ( size_t i = 0; i < kShards; ++i ) {
+            size += m_Shards[i].m_ByStr.size();
+        }
         if ( size ) {
             elem_size = sizeof(string)+sizeof(void*); // map value
             elem_size += sizeof(int)+3*sizeof(void*); // red/black tree
@@ -1701,8 +1793,10 @@ size_t CSeq_id_Local_Tree::Dump(CNcbiOstream& out,
             // malloc overhead:
             // map value, CSeq_id_Info, CSeq_id, CObject_id
             elem_size += 4*kMallocOverhead;
-            ITERATE ( TByStr, it, m_ByStr ) {
-                extra_size += sx_StringMemory(it->first);
+            for ( size_t i = 0; i < kShards; ++i ) {
+                ITERATE ( TByStr, it, m_Shards[i].m_ByStr ) {
+                    extra_size += sx_StringMemory(it->first);
+                }
             }
         }
         size_t bytes = extra_size + size*elem_size;
@@ -1712,7 +1806,10 @@ size_t CSeq_id_Local_Tree::Dump(CNcbiOstream& out,
         }
     }}
     {{
-        size_t size = m_ById.size(), elem_size = 0;
+        size_t size = 0, elem_size = 0;
+        for ( size_t i = 0; i < kShards; ++i ) {
+            size += m_Shards[i].m_ById.size();
+        }
         if ( size ) {
             elem_size = sizeof(int)+sizeof(void*);
             elem_size += sizeof(int)+3*sizeof(void*); // red/black tree
@@ -1730,11 +1827,15 @@ size_t CSeq_id_Local_Tree::Dump(CNcbiOstream& out,
         }
     }}
     if ( details >= CSeq_id_Mapper::eDumpAllIds ) {
-        ITERATE ( TByStr, it, m_ByStr ) {
-            out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+        for ( size_t i = 0; i < kShards; ++i ) {
+            ITERATE ( TByStr, it, m_Shards[i].m_ByStr ) {
+                out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+            }
         }
-        ITERATE ( TById, it, m_ById ) {
-            out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+        for ( size_t i = 0; i < kShards; ++i ) {
+            ITERATE ( TById, it, m_Shards[i].m_ById ) {
+                out << "  " << it->second->GetSeqId()->AsFastaString() << endl;
+            }
         }
     }
     return total_bytes;
@@ -2039,6 +2140,13 @@ CSeq_id_Handle CSeq_id_General_Tree::FindOrCreate(const CSeq_id& id)
                 break;
             }
             TPacked packed = CSeq_id_General_Str_Info::Pack(key, dbid);
+            {{
+                TReadLockGuard guard(m_TreeLock);
+                TPackedStrMap::const_iterator it = m_PackedStrMap.find(key);
+                if ( it != m_PackedStrMap.end() ) {
+                    return CSeq_id_Handle(it->second, packed);
+                }
+            }}
             TWriteLockGuard guard(m_TreeLock);
             TPackedStrMap::iterator it = m_PackedStrMap.lower_bound(key);
             if ( it == m_PackedStrMap.end() ||
@@ -2054,6 +2162,13 @@ CSeq_id_Handle CSeq_id_General_Tree::FindOrCreate(const CSeq_id& id)
         {
             const string& key = dbid.GetDb();
             TPacked packed = CSeq_id_General_Id_Info::Pack(key, dbid);
+            {{
+                TReadLockGuard guard(m_TreeLock);
+                TPackedIdMap::const_iterator it = m_PackedIdMap.find(key);
+                if ( it != m_PackedIdMap.end() ) {
+                    return CSeq_id_Handle(it->second, packed);
+                }
+            }}
             TWriteLockGuard guard(m_TreeLock);
             TPackedIdMap::iterator it = m_PackedIdMap.lower_bound(key);
             if ( it == m_PackedIdMap.end() ||
@@ -2069,6 +2184,12 @@ CSeq_id_Handle CSeq_id_General_Tree::FindOrCreate(const CSeq_id& id)
             break;
         }
     }
+    {{
+        TReadLockGuard guard(m_TreeLock);
+        if ( CSeq_id_Info* info = x_FindInfo(dbid) ) {
+            return CSeq_id_Handle(info);
+        }
+    }}
     TWriteLockGuard guard(m_TreeLock);
     CSeq_id_Info* info = x_FindInfo(dbid);
     if ( !info ) {
@@ -67,6 +67,60 @@ class CSeq_id_Info;
 class CSeq_id_Mapper;
 class CSeq_id_Which_Tree;
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//
+//  CSeq_id_Tree_Lock::
+//
+//    Read/write lock of a seq-id tree or of one shard of a tree.
+//    Lookups take it shared, insertions and removals exclusively.
+//    The lock is padded so that the locks of neighbouring shards
+//    do not share a cache line.
+//
+
+
+class CSeq_id_Tree_Lock
+{
+public:
+    typedef CGuard<CSeq_id_Tree_Lock,
+                   SSimpleReadLock<CSeq_id_Tree_Lock>,
+                   SSimpleReadUnlock<CSeq_id_Tree_Lock> > TReadLockGuard;
+    typedef CGuard<CSeq_id_Tree_Lock,
+                   SSimpleWriteLock<CSeq_id_Tree_Lock>,
+                   SSimpleWriteUnlock<CSeq_id_Tree_Lock> > TWriteLockGuard;
+
+    CSeq_id_Tree_Lock(void) {}
+
+    void ReadLock(void)
+        {
+            m_Lock.ReadLock();
+        }
+    void ReadUnlock(void)
+        {
+            m_Lock.ReadUnlock();
+        }
+    void WriteLock(void)
+        {
+            m_Lock.WriteLock();
+        }
+    void WriteUnlock(void)
+        {
+            m_Lock.WriteUnlock();
+        }
+
+private:
+    enum {
+        kCacheLine = 64
+    };
+
+    CFastRWLock m_Lock;
+    char m_Padding[kCacheLine];
+
+private:
+    CSeq_id_Tree_Lock(const CSeq_id_Tree_Lock&);
+    CSeq_id_Tree_Lock& operator=(const CSeq_id_Tree_Lock&);
+};
+
+
 ////////////////////////////////////////////////////////////////////
 //
 //  CSeq_id_***_Tree::
@@ -133,8 +187,11 @@ protected:
             return id.m_Info;
         }
     virtual void x_Unindex(const CSeq_id_Info* info) = 0;
+    // Unindex the info if it is still unlocked, the caller holds the lock
+    // guarding the info's index entry
+    void x_DropInfo(const CSeq_id_Info* info);
 
-    typedef CFastMutex TTreeLock;
+    typedef CSeq_id_Tree_Lock TTreeLock;
     typedef TTreeLock::TReadLockGuard TReadLockGuard;
     typedef TTreeLock::TWriteLockGuard TWriteLockGuard;
 
@@ -197,6 +254,8 @@ public:
     virtual CSeq_id_Handle FindInfo(const CSeq_id& id) const;
     virtual CSeq_id_Handle FindOrCreate(const CSeq_id& id);
 
+    virtual void DropInfo(const CSeq_id_Info* info);
+
     virtual void FindMatchStr(const string& sid,
                               TSeq_id_MatchList& id_list) const;
 
@@ -211,7 +270,31 @@ protected:
 
 private:
     typedef map<TPacked, CSeq_id_Info*> TIntMap;
-    TIntMap m_IntMap;
+
+    // The tree is split by value into shards with their own locks,
+    // so that creating and dropping different ids do not block each other.
+    enum {
+        kShards = 16
+    };
+    struct SShard {
+        mutable TTreeLock m_Lock;
+        TIntMap m_IntMap;
+    };
+
+    static size_t x_GetShardIndex(TPacked value)
+        {
+            return size_t(Uint8(value) % kShards);
+        }
+    SShard& x_GetShard(TPacked value)
+        {
+            return m_Shards[x_GetShardIndex(value)];
+        }
+    const SShard& x_GetShard(TPacked value) const
+        {
+            return m_Shards[x_GetShardIndex(value)];
+        }
+
+    SShard m_Shards[kShards];
 };
 
 
@@ -641,6 +724,8 @@ public:
     virtual CSeq_id_Handle FindInfo(const CSeq_id& id) const;
     virtual CSeq_id_Handle FindOrCreate(const CSeq_id& id);
 
+    virtual void DropInfo(const CSeq_id_Info* info);
+
     virtual void FindMatchStr(const string& sid,
                               TSeq_id_MatchList& id_list) const;
 
@@ -649,14 +734,44 @@ public:
                         int details) const;
 
 private:
-    virtual void x_Unindex(const CSeq_id_Info* info);
-    CSeq_id_Info* x_FindInfo(const CObject_id& oid) const;
-
     typedef map<string, CSeq_id_Info*, PNocase> TByStr;
     typedef map<TPacked, CSeq_id_Info*>         TById;
 
-    TByStr m_ByStr;
-    TById  m_ById;
+    // The tree is split by object-id into shards with their own locks,
+    // so that creating and dropping different ids do not block each other.
+    enum {
+        kShards = 16
+    };
+    struct SShard {
+        mutable TTreeLock m_Lock;
+        TByStr m_ByStr;
+        TById  m_ById;
+    };
+
+    static size_t x_GetShardIndex(const string& str);
+    static size_t x_GetShardIndex(TPacked id)
+        {
+            return size_t(Uint8(id) % kShards);
+        }
+    static size_t x_GetShardIndex(const CObject_id& oid)
+        {
+            return oid.IsStr()? x_GetShardIndex(oid.GetStr()):
+                oid.IsId()? x_GetShardIndex(TPacked(oid.GetId())): 0;
+        }
+    SShard& x_GetShard(const CObject_id& oid)
+        {
+            return m_Shards[x_GetShardIndex(oid)];
+        }
+    const SShard& x_GetShard(const CObject_id& oid) const
+        {
+            return m_Shards[x_GetShardIndex(oid)];
+        }
+
+    virtual void x_Unindex(const CSeq_id_Info* info);
+    static CSeq_id_Info* x_FindInfo(const SShard& shard,
+                                    const CObject_id& oid);
+
+    SShard m_Shards[kShards];
 };
 
 
@@ -0,0 +1,222 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Multi-threaded CSeq_id_Handle resolution throughput.
+ *   In the "lookup" mode all handles are kept alive and threads resolve
+ *   existing entries; in the "churn" mode each thread repeatedly creates
+ *   and releases handles of its own seq-ids, which inserts and removes
+ *   the mapper entries.
+ *
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbiargs.hpp>
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbitime.hpp>
+
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seq/seq_id_handle.hpp>
+#include <objects/seq/seq_id_mapper.hpp>
+
+
+USING_NCBI_SCOPE;
+USING_SCOPE(objects);
+
+
+typedef vector< CRef<CSeq_id> > TIds;
+
+
+/////////////////////////////////////////////////////////////////////////////
+//  Resolving thread
+
+
+class CResolveThread : public CThread
+{
+public:
+    CResolveThread(CSeq_id_Mapper& mapper, const TIds& ids,
+                   size_t start, size_t count, int passes)
+        : m_Mapper(mapper), m_Ids(ids), m_Start(start), m_Count(count),
+          m_Passes(passes), m_Failed(0)
+        {
+        }
+
+    size_t GetFailed(void) const { return m_Failed; }
+
+protected:
+    virtual void* Main(void)
+        {
+            const size_t size = m_Ids.size();
+            for ( int pass = 0; pass < m_Passes; ++pass ) {
+                for ( size_t i = 0; i < m_Count; ++i ) {
+                    const CSeq_id& id = *m_Ids[(m_Start + i) % size];
+                    if ( !m_Mapper.GetHandle(id) ) {
+                        ++m_Failed;
+                    }
+                }
+            }
+            return 0;
+        }
+
+private:
+    CSeq_id_Mapper& m_Mapper;
+    const TIds&     m_Ids;
+    size_t          m_Start;
+    size_t          m_Count;
+    int             m_Passes;
+    size_t          m_Failed;
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//  Application
+
+
+class CSeqIdMapperBenchApp : public CNcbiApplication
+{
+public:
+    virtual void Init(void);
+    virtual int  Run(void);
+
+private:
+    void x_MakeIds(size_t count, TIds& ids) const;
+};
+
+
+void CSeqIdMapperBenchApp::Init(void)
+{
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "CSeq_id_Handle resolution throughput");
+
+    arg_desc->AddDefaultKey("ids", "Count",
+                            "Number of distinct seq-ids",
+                            CArgDescriptions::eInteger, "100000");
+    arg_desc->AddDefaultKey("passes", "Count",
+                            "Passes over the seq-ids made by each thread",
+                            CArgDescriptions::eInteger, "10");
+    arg_desc->AddDefaultKey("max_threads", "Count",
+                            "Largest thread count; counts double from 1",
+                            CArgDescriptions::eInteger, "64");
+    arg_desc->AddDefaultKey("mode", "Mode",
+                            "lookup: resolve existing handles; "
+                            "churn: create and release handles",
+                            CArgDescriptions::eString, "lookup");
+    arg_desc->SetConstraint("mode",
+                            &(*new CArgAllow_Strings, "lookup", "churn"));
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+
+void CSeqIdMapperBenchApp::x_MakeIds(size_t count, TIds& ids) const
+{
+    ids.reserve(count);
+    for ( size_t i = 0; i < count; ++i ) {
+        string label;
+        switch ( i % 6 ) {
+        case 0:
+            label = "ref|NM_" + NStr::NumericToString(100000 + i) + ".1";
+            break;
+        case 1:
+            label = "gb|AY" + NStr::NumericToString(200000 + i) + ".2";
+            break;
+        case 2:
+            label = "gnl|BENCH|contig" + NStr::NumericToString(i);
+            break;
+        case 3:
+            label = "lcl|contig" + NStr::NumericToString(i);
+            break;
+        case 4:
+            label = "lcl|" + NStr::NumericToString(i);
+            break;
+        default:
+            label = "gi|" + NStr::NumericToString(1000 + i);
+            break;
+        }
+        ids.push_back(CRef<CSeq_id>(new CSeq_id(label)));
+    }
+}
+
+
+int CSeqIdMapperBenchApp::Run(void)
+{
+    const CArgs& args = GetArgs();
+    const size_t count = args["ids"].AsInteger();
+    const int passes = args["passes"].AsInteger();
+    const int max_threads = args["max_threads"].AsInteger();
+    const bool churn = args["mode"].AsString() == "churn";
+
+    TIds ids;
+    x_MakeIds(count, ids);
+
+    CRef<CSeq_id_Mapper> mapper = CSeq_id_Mapper::GetInstance();
+
+    // keep the handles alive so that all lookups hit existing entries,
+    // or release them right away so that each lookup creates an entry
+    vector<CSeq_id_Handle> keep;
+    if ( !churn ) {
+        keep.reserve(ids.size());
+        ITERATE ( TIds, it, ids ) {
+            keep.push_back(mapper->GetHandle(**it));
+        }
+    }
+
+    cout << "threads\t" << (churn? "creates/s": "lookups/s") << endl;
+    int status = 0;
+    for ( int nthreads = 1; nthreads <= max_threads; nthreads *= 2 ) {
+        vector< CRef<CResolveThread> > threads;
+        CStopWatch sw(CStopWatch::eStart);
+        for ( int t = 0; t < nthreads; ++t ) {
+            // churning threads work on disjoint slices of the seq-ids
+            size_t start = t * count / nthreads;
+            size_t slice = churn? (t + 1) * count / nthreads - start: count;
+            threads.push_back(CRef<CResolveThread>(new CResolveThread
+                (*mapper, ids, start, slice, passes)));
+            threads.back()->Run();
+        }
+        size_t failed = 0;
+        NON_CONST_ITERATE ( vector< CRef<CResolveThread> >, it, threads ) {
+            (*it)->Join();
+            failed += (*it)->GetFailed();
+        }
+        double elapsed = sw.Elapsed();
+        double lookups = double(count) * passes * (churn? 1: nthreads);
+        cout << nthreads << '\t'
+             << NStr::DoubleToString(lookups / elapsed, 0) << endl;
+        if ( failed ) {
+            ERR_POST("Failed lookups: " << failed);
+            status = 1;
+        }
+    }
+    return status;
+}
+
+
+int main(int argc, const char* argv[])
+{
+    return CSeqIdMapperBenchApp().AppMain(argc, argv);
+}
@@ -40,6 +40,7 @@
 #include <objects/general/Dbtag.hpp>
 #include <objects/general/Object_id.hpp>
 #include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/seq_id_mapper.hpp>
 #include <objects/seqloc/seqloc__.hpp>
 #include <objects/seqfeat/Seq_feat.hpp>
 #include <objects/seqfeat/SeqFeatData.hpp>
@@ -143,6 +144,101 @@ BOOST_AUTO_TEST_CASE(s_MTTest)
         (*it)->Join();
     }
 }
+
+
+// Threads create and release handles of a shared set of seq-ids, so that
+// mapper entries are inserted and dropped while other threads look up
+// the same ids or ids in the same shard.
+class CMTCreateDropThread : public CThread
+{
+public:
+    typedef vector< CRef<CSeq_id> > TIds;
+
+    CMTCreateDropThread(const TIds& ids, const TIds& alt_ids, int tid)
+        : m_Ids(ids), m_AltIds(alt_ids), m_Random(tid), m_Errors(0) {
+    }
+
+    int GetErrors(void) const {
+        return m_Errors;
+    }
+
+    virtual void* Main(void) {
+        for ( int i = 0; i < 20000; ++i ) {
+            size_t index = m_Random.GetRand(0, int(m_Ids.size())-1);
+            const CSeq_id& id = *m_Ids[index];
+            CSeq_id_Handle idh = CSeq_id_Handle::GetHandle(id);
+            // the entry found or created is the one of the same seq-id
+            if ( !idh || !idh.GetSeqId()->Equals(id) ) {
+                ++m_Errors;
+            }
+            // while a handle is held its entry is not dropped or replaced,
+            // and equivalent seq-ids resolve to it
+            if ( CSeq_id_Handle::GetHandle(*m_AltIds[index]) != idh ) {
+                ++m_Errors;
+            }
+            if ( m_Random.GetRand(0, 3) == 0 ) {
+                m_Held.push_back(idh);
+                if ( m_Held.size() > 8 ) {
+                    m_Held.pop_front();
+                }
+            }
+        }
+        ITERATE ( deque<CSeq_id_Handle>, it, m_Held ) {
+            if ( CSeq_id_Handle::GetHandle(*it->GetSeqId()) != *it ) {
+                ++m_Errors;
+            }
+        }
+        m_Held.clear();
+        return 0;
+    }
+
+private:
+    const TIds& m_Ids;
+    const TIds& m_AltIds;
+    CRandom m_Random;
+    int m_Errors;
+    deque<CSeq_id_Handle> m_Held;
+};
+
+
+BOOST_AUTO_TEST_CASE(s_MTCreateDropTest)
+{
+    CMTCreateDropThread::TIds ids, alt_ids;
+    for ( int i = 0; i < 40; ++i ) {
+        string n = NStr::IntToString(i);
+        ids.push_back(Ref(new CSeq_id("lcl|mt_contig" + n)));
+        alt_ids.push_back(Ref(new CSeq_id("lcl|MT_Contig" + n)));
+        ids.push_back(Ref(new CSeq_id("lcl|" + NStr::IntToString(i - 20))));
+        alt_ids.push_back(ids.back());
+        ids.push_back(Ref(new CSeq_id(CSeq_id::e_Gibbsq, i + 1)));
+        alt_ids.push_back(Ref(new CSeq_id("bbs|" + NStr::IntToString(i+1))));
+        ids.push_back(Ref(new CSeq_id("gb|MT" + NStr::IntToString(100000+i))));
+        alt_ids.push_back(ids.back());
+        ids.push_back(Ref(new CSeq_id("gnl|MTDB|tag" + n)));
+        alt_ids.push_back(Ref(new CSeq_id("gnl|mtdb|tag" + n)));
+    }
+
+    vector< CRef<CMTCreateDropThread> > tt;
+    for ( int i = 0; i < 8; ++i ) {
+        tt.push_back(Ref(new CMTCreateDropThread(ids, alt_ids, i)));
+    }
+    NON_CONST_ITERATE ( vector< CRef<CMTCreateDropThread> >, it, tt ) {
+        (*it)->Run();
+    }
+    NON_CONST_ITERATE ( vector< CRef<CMTCreateDropThread> >, it, tt ) {
+        (*it)->Join();
+        BOOST_CHECK_EQUAL((*it)->GetErrors(), 0);
+    }
+
+    // all handles are released, so the local and integer entries are gone
+    CRef<CSeq_id_Mapper> mapper = CSeq_id_Mapper::GetInstance();
+    ITERATE ( CMTCreateDropThread::TIds, it, ids ) {
+        if ( (*it)->IsLocal() || (*it)->IsGibbsq() ) {
+            BOOST_CHECK_MESSAGE(!mapper->GetHandle(**it, true),
+                                (*it)->AsFastaString());
+        }
+    }
+}
 #endif
 
 
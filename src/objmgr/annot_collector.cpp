@@ -2816,6 +2816,55 @@ void CAnnot_Collector::x_SearchObjects(const CTSE_Handle&    tseh,
 }
 
 
+// Iterator over the objects of a TSE range map intersecting a range,
+// using the compact copy of the range map if there is one.
+// The compact copy is locked, so that it survives the range map changes
+// made by recursive searches.
+class CAnnotRangeMap_CI
+{
+public:
+    typedef CTSE_Info::TRangeMap      TRangeMap;
+    typedef SIdAnnotObjs::CRangeIndex TRangeIndex;
+    typedef TRangeMap::value_type     value_type;
+
+    CAnnotRangeMap_CI(const TRangeMap& rmap,
+                      const CConstRef<TRangeIndex>& index,
+                      const CHandleRange::TRange& range)
+        : m_Index(index)
+        {
+            if ( index ) {
+                m_IndexIter = index->begin(range);
+            }
+            else {
+                m_MapIter = rmap.begin(range);
+            }
+        }
+
+    DECLARE_OPERATOR_BOOL(m_Index? m_IndexIter.Valid(): m_MapIter.Valid());
+
+    const value_type* operator->(void) const
+        {
+            return m_Index? m_IndexIter.operator->(): m_MapIter.operator->();
+        }
+
+    CAnnotRangeMap_CI& operator++(void)
+        {
+            if ( m_Index ) {
+                ++m_IndexIter;
+            }
+            else {
+                ++m_MapIter;
+            }
+            return *this;
+        }
+
+private:
+    CConstRef<TRangeIndex>      m_Index;
+    TRangeMap::const_iterator   m_MapIter;
+    TRangeIndex::const_iterator m_IndexIter;
+};
+
+
 void CAnnot_Collector::x_SearchRange(const CTSE_Handle&    tseh,
                                      const SIdAnnotObjs*   objs,
                                      CTSE_Info::TAnnotLockReadGuard& guard,
@@ -2883,6 +2932,10 @@ void CAnnot_Collector::x_SearchRange(const CTSE_Handle&    tseh,
                 continue;
             }
             const CTSE_Info::TRangeMap& rmap = objs->x_GetRangeMap(index);
+            CConstRef<SIdAnnotObjs::CRangeIndex> rindex;
+            if ( tse.GetCompactAnnotIndex() ) {
+                rindex = tse.x_GetRangeIndex(*objs, index);
+            }
 
             size_t start_size = m_AnnotSet.size(); // for rollback
 
@@ -2893,8 +2946,7 @@ void CAnnot_Collector::x_SearchRange(const CTSE_Handle&    tseh,
             ITERATE(CHandleRange, rg_it, hr) {
                 CHandleRange::TRange range = rg_it->first;
 
-                for ( CTSE_Info::TRangeMap::const_iterator
-                          aoit(rmap.begin(range));
+                for ( CAnnotRangeMap_CI aoit(rmap, rindex, range);
                       aoit; ++aoit ) {
                     const CAnnotObject_Info& annot_info =
                         *aoit->second.m_AnnotObject_Info;
@@ -34,6 +34,11 @@
 
 #define ANNOT_EDIT_COPY 1
 
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbi_param.hpp>
+#include <corelib/ncbi_system.hpp>
+#include <util/thread_pool.hpp>
+
 #include <objmgr/impl/seq_annot_info.hpp>
 #include <objmgr/impl/seq_entry_info.hpp>
 #include <objmgr/impl/bioseq_base_info.hpp>
@@ -706,6 +711,269 @@ void CSeq_annot_Info::x_UpdateObjectKeys(CAnnotObject_Info& info,
 }
 
 
+/////////////////////////////////////////////////////////////////////////////
+// Parallel calculation of annotation locations
+//
+// Converting the locations into CHandleRangeMap dominates the indexing of
+// big Seq-annots. Only the insertion into the TSE index needs the TSE to
+// be modified, so the locations are calculated by a pool of worker threads,
+// started once for each big Seq-annot, in batches one batch ahead of the
+// thread inserting them in the original order; the resulting index is the
+// same as without the threads.
+
+NCBI_PARAM_DEF_EX(unsigned, OBJMGR, ANNOT_INDEX_THREADS, 0,
+                  eParam_NoThread, OBJMGR_ANNOT_INDEX_THREADS);
+
+namespace {
+
+// smallest Seq-annot indexed with worker threads
+const size_t kMinParallelIndexSize = 50000;
+// objects in one batch
+const size_t kParallelIndexBatch = 16384;
+// default limit for the number of worker threads
+const unsigned kMaxAnnotIndexThreads = 8;
+
+
+unsigned s_GetAnnotIndexThreads(void)
+{
+    // read for every big Seq-annot, so that changes apply to new TSEs
+    unsigned threads =
+        NCBI_PARAM_TYPE(OBJMGR, ANNOT_INDEX_THREADS)::GetDefault();
+    if ( threads == 0 ) {
+        threads = min(GetCpuCount(), kMaxAnnotIndexThreads);
+    }
+    return threads;
+}
+
+
+class CAnnotMapsBatch
+{
+public:
+    typedef SAnnotObjectsIndex::TObjectInfos TObjectInfos;
+
+    CAnnotMapsBatch(void)
+        : m_Begin(0), m_End(0)
+        {
+        }
+
+    void Init(size_t begin, size_t end)
+        {
+            m_Begin = begin;
+            m_End = end;
+            m_Maps.resize(end - begin);
+            m_Done.assign(end - begin, false);
+        }
+
+    bool Contains(size_t i) const
+        {
+            return i >= m_Begin && i < m_End;
+        }
+
+    // Calculate the locations of the objects [begin, end) of the batch.
+    // Objects failing here are left for the inserting thread, which will
+    // report the error.
+    void Calculate(TObjectInfos& infos, const CMasterSeqSegments* master,
+                   size_t begin, size_t end)
+        {
+            for ( size_t i = begin; i < end; ++i ) {
+                const CAnnotObject_Info& info = infos[m_Begin + i];
+                if ( info.IsRemoved() ) {
+                    continue;
+                }
+                try {
+                    info.GetMaps(m_Maps[i], master);
+                    m_Done[i] = true;
+                }
+                catch ( exception& /*ignored*/ ) {
+                }
+            }
+        }
+
+    const vector<CHandleRangeMap>* GetMaps(size_t i) const
+        {
+            _ASSERT(Contains(i));
+            return m_Done[i - m_Begin]? &m_Maps[i - m_Begin]: 0;
+        }
+
+    size_t GetSize(void) const
+        {
+            return m_End - m_Begin;
+        }
+
+private:
+    size_t                           m_Begin, m_End;
+    vector< vector<CHandleRangeMap> > m_Maps;
+    vector<char>                     m_Done;
+};
+
+
+class CAnnotMapsTask : public CThreadPool_Task
+{
+public:
+    CAnnotMapsTask(CAnnotMapsBatch& batch,
+                   CAnnotMapsBatch::TObjectInfos& infos,
+                   const CMasterSeqSegments* master,
+                   size_t begin, size_t end,
+                   CSemaphore& done)
+        : m_Batch(batch), m_Infos(infos), m_Master(master),
+          m_Begin(begin), m_End(end), m_Done(done)
+        {
+        }
+
+    virtual EStatus Execute(void)
+        {
+            m_Batch.Calculate(m_Infos, m_Master, m_Begin, m_End);
+            return eCompleted;
+        }
+
+protected:
+    virtual void OnStatusChange(EStatus /*old*/)
+        {
+            // canceled tasks are counted too, so the waiting never hangs
+            if ( IsFinished() ) {
+                m_Done.Post();
+            }
+        }
+
+private:
+    CAnnotMapsBatch&               m_Batch;
+    CAnnotMapsBatch::TObjectInfos& m_Infos;
+    const CMasterSeqSegments*      m_Master;
+    size_t                         m_Begin, m_End;
+    CSemaphore&                    m_Done;
+};
+
+
+class CAnnotMapsCalculator
+{
+public:
+    typedef CAnnotMapsBatch::TObjectInfos TObjectInfos;
+
+    CAnnotMapsCalculator(TObjectInfos& infos,
+                         const CMasterSeqSegments* master,
+                         unsigned threads)
+        : m_Infos(infos), m_Master(master), m_ThreadCount(threads),
+          m_Current(0), m_Done(0, threads), m_Running(0)
+        {
+            // The threads are started once for the whole Seq-annot and
+            // take one task per batch; without them everything is
+            // calculated by the inserting thread.
+            try {
+                m_Pool.reset(new CThreadPool(threads, threads, threads));
+            }
+            catch ( CException& /*ignored*/ ) {
+            }
+        }
+    ~CAnnotMapsCalculator(void)
+        {
+            x_Join();
+            if ( m_Pool.get() ) {
+                m_Pool->Abort();
+            }
+        }
+
+    static bool IsUseful(size_t object_count, unsigned& threads)
+        {
+#ifdef NCBI_THREADS
+            if ( object_count < kMinParallelIndexSize ) {
+                return false;
+            }
+            threads = s_GetAnnotIndexThreads();
+            return threads > 1;
+#else
+            return false;
+#endif
+        }
+
+    // Locations of the object with index i, or null if they are not
+    // calculated; the objects should be requested in increasing order.
+    const vector<CHandleRangeMap>* GetMaps(size_t i)
+        {
+            if ( !m_Batch[m_Current].Contains(i) ) {
+                x_NextBatch(i);
+            }
+            return m_Batch[m_Current].GetMaps(i);
+        }
+
+private:
+    void x_NextBatch(size_t i);
+    void x_Start(CAnnotMapsBatch& batch, size_t begin);
+    void x_Join(void);
+
+    TObjectInfos&             m_Infos;
+    const CMasterSeqSegments* m_Master;
+    unsigned                  m_ThreadCount;
+    int                       m_Current;
+    CAnnotMapsBatch           m_Batch[2];
+    // posted once by each finished task
+    CSemaphore                m_Done;
+    unsigned                  m_Running;
+    auto_ptr<CThreadPool>     m_Pool;
+
+private:
+    CAnnotMapsCalculator(const CAnnotMapsCalculator&);
+    void operator=(const CAnnotMapsCalculator&);
+};
+
+
+void CAnnotMapsCalculator::x_NextBatch(size_t i)
+{
+    x_Join();
+    size_t begin = i - i % kParallelIndexBatch;
+    CAnnotMapsBatch& next = m_Batch[m_Current ^ 1];
+    if ( !next.Contains(i) ) {
+        // first request, nothing was calculated in advance
+        x_Start(next, begin);
+        x_Join();
+    }
+    m_Current ^= 1;
+    _ASSERT(m_Batch[m_Current].Contains(i));
+    // calculate the following batch while this one is inserted
+    x_Start(m_Batch[m_Current ^ 1], begin + kParallelIndexBatch);
+}
+
+
+void CAnnotMapsCalculator::x_Start(CAnnotMapsBatch& batch, size_t begin)
+{
+    _ASSERT(m_Running == 0);
+    size_t end = min(begin + kParallelIndexBatch, m_Infos.size());
+    if ( begin >= end ) {
+        return;
+    }
+    batch.Init(begin, end);
+    if ( !m_Pool.get() ) {
+        return;
+    }
+    size_t size = batch.GetSize();
+    for ( unsigned t = 0; t < m_ThreadCount; ++t ) {
+        size_t from = size * t / m_ThreadCount;
+        size_t to = size * (t + 1) / m_ThreadCount;
+        if ( from == to ) {
+            continue;
+        }
+        try {
+            m_Pool->AddTask(new CAnnotMapsTask(batch, m_Infos, m_Master,
+                                               from, to, m_Done));
+        }
+        catch ( CException& /*ignored*/ ) {
+            // the remaining objects are calculated by the inserting thread
+            break;
+        }
+        ++m_Running;
+    }
+}
+
+
+void CAnnotMapsCalculator::x_Join(void)
+{
+    for ( ; m_Running > 0; --m_Running ) {
+        m_Done.Wait();
+    }
+}
+
+} // namespace
+
+
 void CSeq_annot_Info::x_InitFeatKeys(CTSE_Info& tse)
 {
     _ASSERT(m_ObjectIndex.GetInfos().size() >= m_Object->GetData().GetFtable().size());
@@ -719,16 +987,21 @@ void CSeq_annot_Info::x_InitFeatKeys(CTSE_Info& tse)
 
     CTSEAnnotObjectMapper mapper(tse, GetName());
 
-    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it,
-                        m_ObjectIndex.GetInfos() ) {
+    SAnnotObjectsIndex::TObjectInfos& infos = m_ObjectIndex.GetInfos();
+    unsigned threads = 0;
+    auto_ptr<CAnnotMapsCalculator> calculator;
+    if ( CAnnotMapsCalculator::IsUseful(object_count, threads) ) {
+        calculator.reset(new CAnnotMapsCalculator(infos, master, threads));
+    }
+
+    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it, infos ) {
         CAnnotObject_Info& info = *it;
         if ( info.IsRemoved() ) {
             continue;
         }
         _ASSERT(info.GetFeatType() == info.GetFeatFast()->GetData().Which());
     }
-    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it,
-                        m_ObjectIndex.GetInfos() ) {
+    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it, infos ) {
         CAnnotObject_Info& info = *it;
         if ( info.IsRemoved() ) {
             continue;
@@ -737,11 +1010,18 @@ void CSeq_annot_Info::x_InitFeatKeys(CTSE_Info& tse)
         size_t keys_begin = m_ObjectIndex.GetKeys().size();
         index.m_AnnotObject_Info = &info;
 
-        info.GetMaps(hrmaps, master);
+        const vector<CHandleRangeMap>* maps = 0;
+        if ( calculator.get() ) {
+            maps = calculator->GetMaps(it - infos.begin());
+        }
+        if ( !maps ) {
+            info.GetMaps(hrmaps, master);
+            maps = &hrmaps;
+        }
 
         index.m_AnnotLocationIndex = 0;
 
-        ITERATE ( vector<CHandleRangeMap>, hrmit, hrmaps ) {
+        ITERATE ( vector<CHandleRangeMap>, hrmit, *maps ) {
             bool multi_id = hrmit->GetMap().size() > 1;
             ITERATE ( CHandleRangeMap, hrit, *hrmit ) {
                 const CHandleRange& hr = hrit->second;
@@ -794,8 +1074,14 @@ void CSeq_annot_Info::x_InitGraphKeys(CTSE_Info& tse)
 
     CTSEAnnotObjectMapper mapper(tse, GetName());
 
-    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it,
-                        m_ObjectIndex.GetInfos() ) {
+    SAnnotObjectsIndex::TObjectInfos& infos = m_ObjectIndex.GetInfos();
+    unsigned threads = 0;
+    auto_ptr<CAnnotMapsCalculator> calculator;
+    if ( CAnnotMapsCalculator::IsUseful(object_count, threads) ) {
+        calculator.reset(new CAnnotMapsCalculator(infos, master, threads));
+    }
+
+    NON_CONST_ITERATE ( SAnnotObjectsIndex::TObjectInfos, it, infos ) {
         CAnnotObject_Info& info = *it;
         if ( info.IsRemoved() ) {
             continue;
@@ -803,10 +1089,17 @@ void CSeq_annot_Info::x_InitGraphKeys(CTSE_Info& tse)
         size_t keys_begin = m_ObjectIndex.GetKeys().size();
         index.m_AnnotObject_Info = &info;
 
-        info.GetMaps(hrmaps, master);
+        const vector<CHandleRangeMap>* maps = 0;
+        if ( calculator.get() ) {
+            maps = calculator->GetMaps(it - infos.begin());
+        }
+        if ( !maps ) {
+            info.GetMaps(hrmaps, master);
+            maps = &hrmaps;
+        }
         index.m_AnnotLocationIndex = 0;
 
-        ITERATE ( vector<CHandleRangeMap>, hrmit, hrmaps ) {
+        ITERATE ( vector<CHandleRangeMap>, hrmit, *maps ) {
             ITERATE ( CHandleRangeMap, hrit, *hrmit ) {
                 const CHandleRange& hr = hrit->second;
                 key.m_Range = hr.GetOverlappingRange();
@@ -49,11 +49,21 @@
 #include <objmgr/objmgr_exception.hpp>
 #include <util/random_gen.hpp>
 
+#ifdef __SSSE3__
+#  include <tmmintrin.h>
+#endif
+
 BEGIN_NCBI_SCOPE
 BEGIN_SCOPE(objects)
 
 
-static const TSeqPos kCacheSize = 1024;
+// The cache fill size doubles with each sequential refill up to
+// kMaxCacheSize and drops back to kMinCacheSize on random repositioning
+static const TSeqPos kMinCacheSize = 1024;
+static const TSeqPos kMaxCacheSize = 64*1024;
+
+// GetSeqData() bypasses the cache for longer requests
+static const TSeqPos kMinBulkCount = kMaxCacheSize;
 
 void ThrowOutOfRangeSeq_inst(size_t pos)
 {
@@ -61,6 +71,192 @@ void ThrowOutOfRangeSeq_inst(size_t pos)
                    "reference out of range of Seq-inst data: "<<pos);
 }
 
+
+#ifdef __SSSE3__
+
+// Packed data shorter than this is decoded by the generic routines
+static const size_t kMinBulkUnpack = 64;
+
+
+// Unpack whole bytes of ncbi2na, 16 bytes (64 residues) per step;
+// in reverse the bytes are consumed backwards from src + bytes.
+// lut holds the converted values of codes 0-3.
+static
+size_t s_Unpack2na(char* dst, const char* src, size_t bytes,
+                   __m128i lut, bool reverse)
+{
+    const __m128i mask = _mm_set1_epi8(0x03);
+    const __m128i rev =
+        _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    size_t done = 0;
+    for ( ; done + 16 <= bytes; done += 16 ) {
+        __m128i v;
+        if ( reverse ) {
+            v = _mm_loadu_si128((const __m128i*)(src + bytes - done - 16));
+            v = _mm_shuffle_epi8(v, rev);
+        }
+        else {
+            v = _mm_loadu_si128((const __m128i*)(src + done));
+        }
+        // residue k of each byte is stored in bits 7-6, 5-4, 3-2, 1-0
+        __m128i r0 = _mm_and_si128(_mm_srli_epi16(v, 6), mask);
+        __m128i r1 = _mm_and_si128(_mm_srli_epi16(v, 4), mask);
+        __m128i r2 = _mm_and_si128(_mm_srli_epi16(v, 2), mask);
+        __m128i r3 = _mm_and_si128(v, mask);
+        r0 = _mm_shuffle_epi8(lut, r0);
+        r1 = _mm_shuffle_epi8(lut, r1);
+        r2 = _mm_shuffle_epi8(lut, r2);
+        r3 = _mm_shuffle_epi8(lut, r3);
+        if ( reverse ) {
+            swap(r0, r3);
+            swap(r1, r2);
+        }
+        __m128i lo01 = _mm_unpacklo_epi8(r0, r1);
+        __m128i hi01 = _mm_unpackhi_epi8(r0, r1);
+        __m128i lo23 = _mm_unpacklo_epi8(r2, r3);
+        __m128i hi23 = _mm_unpackhi_epi8(r2, r3);
+        __m128i* out = (__m128i*)(dst + done*4);
+        _mm_storeu_si128(out,   _mm_unpacklo_epi16(lo01, lo23));
+        _mm_storeu_si128(out+1, _mm_unpackhi_epi16(lo01, lo23));
+        _mm_storeu_si128(out+2, _mm_unpacklo_epi16(hi01, hi23));
+        _mm_storeu_si128(out+3, _mm_unpackhi_epi16(hi01, hi23));
+    }
+    return done;
+}
+
+
+// Unpack whole bytes of ncbi4na, 16 bytes (32 residues) per step
+static
+size_t s_Unpack4na(char* dst, const char* src, size_t bytes,
+                   __m128i lut, bool reverse)
+{
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i rev =
+        _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    size_t done = 0;
+    for ( ; done + 16 <= bytes; done += 16 ) {
+        __m128i v;
+        if ( reverse ) {
+            v = _mm_loadu_si128((const __m128i*)(src + bytes - done - 16));
+            v = _mm_shuffle_epi8(v, rev);
+        }
+        else {
+            v = _mm_loadu_si128((const __m128i*)(src + done));
+        }
+        __m128i r0 = _mm_shuffle_epi8(lut,
+                                      _mm_and_si128(_mm_srli_epi16(v, 4),
+                                                    mask));
+        __m128i r1 = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        if ( reverse ) {
+            swap(r0, r1);
+        }
+        __m128i* out = (__m128i*)(dst + done*2);
+        _mm_storeu_si128(out,   _mm_unpacklo_epi8(r0, r1));
+        _mm_storeu_si128(out+1, _mm_unpackhi_epi8(r0, r1));
+    }
+    return done;
+}
+
+
+// Same as copy_2bit_any(), but the bulk of the data is unpacked
+// 64 residues at a time with the conversion table held in a register.
+// The residues of partial bytes at both ends and of the last few
+// whole bytes are left to the generic routines.
+static
+void copy_2bit_bulk(char* dst, TSeqPos count,
+                    const vector<char>& srcCont, TSeqPos srcPos,
+                    const char* table, bool reverse)
+{
+    size_t endPos = srcPos + count;
+    if ( count < kMinBulkUnpack ||
+         endPos < srcPos || endPos / 4 > srcCont.size() ) {
+        copy_2bit_any(dst, count, srcCont, srcPos, table, reverse);
+        return;
+    }
+    __m128i lut = table?
+        _mm_setr_epi8(table[0], table[1], table[2], table[3],
+                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0):
+        _mm_setr_epi8(0, 1, 2, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    // residues in the partial bytes at the start and at the end
+    size_t head = (4 - srcPos % 4) % 4;
+    size_t tail = endPos % 4;
+    size_t bytes = (count - head - tail) / 4;
+    const char* src = &srcCont[0] + (srcPos + head) / 4;
+    if ( reverse ) {
+        if ( tail ) {
+            copy_2bit_any(dst, tail, srcCont, endPos - tail, table, true);
+            dst += tail;
+        }
+        size_t done = s_Unpack2na(dst, src, bytes, lut, true);
+        dst += done*4;
+        copy_2bit_any(dst, count - tail - done*4,
+                      srcCont, srcPos, table, true);
+    }
+    else {
+        if ( head ) {
+            copy_2bit_any(dst, head, srcCont, srcPos, table, false);
+            dst += head;
+        }
+        size_t done = s_Unpack2na(dst, src, bytes, lut, false);
+        dst += done*4;
+        size_t rest = head + done*4;
+        copy_2bit_any(dst, count - rest, srcCont, srcPos + rest,
+                      table, false);
+    }
+}
+
+
+// Same as copy_4bit_any(), unpacking 32 residues at a time
+static
+void copy_4bit_bulk(char* dst, TSeqPos count,
+                    const vector<char>& srcCont, TSeqPos srcPos,
+                    const char* table, bool reverse)
+{
+    size_t endPos = srcPos + count;
+    if ( count < kMinBulkUnpack ||
+         endPos < srcPos || endPos / 2 > srcCont.size() ) {
+        copy_4bit_any(dst, count, srcCont, srcPos, table, reverse);
+        return;
+    }
+    // conversion tables cover all 256 codes
+    __m128i lut = table?
+        _mm_loadu_si128((const __m128i*)table):
+        _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    size_t head = srcPos % 2;
+    size_t tail = endPos % 2;
+    size_t bytes = (count - head - tail) / 2;
+    const char* src = &srcCont[0] + (srcPos + head) / 2;
+    if ( reverse ) {
+        if ( tail ) {
+            copy_4bit_any(dst, tail, srcCont, endPos - tail, table, true);
+            dst += tail;
+        }
+        size_t done = s_Unpack4na(dst, src, bytes, lut, true);
+        dst += done*2;
+        copy_4bit_any(dst, count - tail - done*2,
+                      srcCont, srcPos, table, true);
+    }
+    else {
+        if ( head ) {
+            copy_4bit_any(dst, head, srcCont, srcPos, table, false);
+            dst += head;
+        }
+        size_t done = s_Unpack4na(dst, src, bytes, lut, false);
+        dst += done*2;
+        size_t rest = head + done*2;
+        copy_4bit_any(dst, count - rest, srcCont, srcPos + rest,
+                      table, false);
+    }
+}
+
+#else
+
+// No byte shuffles; the generic routines do the whole job
+#define copy_2bit_bulk copy_2bit_any
+#define copy_4bit_bulk copy_4bit_any
+
+#endif
+
 // CSeqVector_CI::
 
 
@@ -75,6 +271,8 @@ CSeqVector_CI::CSeqVector_CI(void)
       m_BackupPos(0),
       m_BackupData(),
       m_BackupEnd(0),
+      m_CacheCapacity(0),
+      m_CacheFill(kMinCacheSize),
       m_ScannedStart(0),
       m_ScannedEnd(0)
 {
@@ -97,6 +295,8 @@ CSeqVector_CI::CSeqVector_CI(const CSeqVector_CI& sv_it)
       m_BackupPos(0),
       m_BackupData(),
       m_BackupEnd(0),
+      m_CacheCapacity(0),
+      m_CacheFill(kMinCacheSize),
       m_Randomizer(sv_it.m_Randomizer),
       m_ScannedStart(0),
       m_ScannedEnd(0)
@@ -119,6 +319,8 @@ CSeqVector_CI::CSeqVector_CI(const CSeqVector& seq_vector, TSeqPos pos)
       m_BackupPos(0),
       m_BackupData(),
       m_BackupEnd(0),
+      m_CacheCapacity(0),
+      m_CacheFill(kMinCacheSize),
       m_Randomizer(seq_vector.m_Randomizer),
       m_ScannedStart(0),
       m_ScannedEnd(0)
@@ -142,6 +344,8 @@ CSeqVector_CI::CSeqVector_CI(const CSeqVector& seq_vector, TSeqPos pos,
       m_BackupPos(0),
       m_BackupData(),
       m_BackupEnd(0),
+      m_CacheCapacity(0),
+      m_CacheFill(kMinCacheSize),
       m_Randomizer(seq_vector.m_Randomizer),
       m_ScannedStart(0),
       m_ScannedEnd(0)
@@ -165,6 +369,8 @@ CSeqVector_CI::CSeqVector_CI(const CSeqVector& seq_vector, ENa_strand strand,
       m_BackupPos(0),
       m_BackupData(),
       m_BackupEnd(0),
+      m_CacheCapacity(0),
+      m_CacheFill(kMinCacheSize),
       m_Randomizer(seq_vector.m_Randomizer),
       m_ScannedStart(0),
       m_ScannedEnd(0)
@@ -428,9 +634,11 @@ CSeqVector_CI& CSeqVector_CI::operator=(const CSeqVector_CI& sv_it)
     m_Randomizer = sv_it.m_Randomizer;
     m_ScannedStart = sv_it.m_ScannedStart;
     m_ScannedEnd = sv_it.m_ScannedEnd;
+    m_CacheFill = sv_it.m_CacheFill;
     // copy cache if any
     size_t cache_size = sv_it.x_CacheSize();
     if ( cache_size ) {
+        x_ReserveCache(sv_it.m_CacheCapacity);
         x_InitializeCache();
         m_CacheEnd = m_CacheData.get() + cache_size;
         m_Cache = m_CacheData.get() + sv_it.x_CacheOffset();
@@ -458,10 +666,7 @@ CSeqVector_CI& CSeqVector_CI::operator=(const CSeqVector_CI& sv_it)
 void CSeqVector_CI::x_InitializeCache(void)
 {
     if ( !m_Cache ) {
-        m_CacheData.reset(new char[kCacheSize]);
-        m_BackupData.reset(new char[kCacheSize]);
-        m_BackupEnd = m_BackupData.get();
-        m_Cache = m_CacheEnd = m_CacheData.get();
+        x_ReserveCache(m_CacheFill);
     }
     else {
         x_ResetCache();
@@ -469,13 +674,39 @@ void CSeqVector_CI::x_InitializeCache(void)
 }
 
 
+// Make both caches at least capacity bytes long.
+// Reallocation discards the contents of both.
+void CSeqVector_CI::x_ReserveCache(TSeqPos capacity)
+{
+    if ( m_CacheData.get() && capacity <= m_CacheCapacity ) {
+        return;
+    }
+    capacity = max(capacity, m_CacheCapacity);
+    m_CacheData.reset(new char[capacity]);
+    m_BackupData.reset(new char[capacity]);
+    m_CacheCapacity = capacity;
+    m_BackupEnd = m_BackupData.get();
+    m_Cache = m_CacheEnd = m_CacheData.get();
+}
+
+
+// Called when the cache is refilled by sequential access
+void CSeqVector_CI::x_GrowCache(void)
+{
+    if ( m_CacheFill < kMaxCacheSize ) {
+        m_CacheFill = min(m_CacheFill*2, kMaxCacheSize);
+        x_ReserveCache(m_CacheFill);
+    }
+}
+
+
 inline
 void CSeqVector_CI::x_ResizeCache(size_t size)
 {
-    _ASSERT(size <= kCacheSize);
     if ( !m_CacheData.get() ) {
         x_InitializeCache();
     }
+    _ASSERT(size <= m_CacheCapacity);
     m_Cache = m_CacheData.get();
     m_CacheEnd = m_CacheData.get() + size;
 }
@@ -488,7 +719,7 @@ void CSeqVector_CI::x_UpdateCacheUp(TSeqPos pos)
     TSeqPos segEnd = m_Seg.GetEndPosition();
     _ASSERT(pos >= m_Seg.GetPosition() && pos < segEnd);
 
-    TSeqPos cache_size = min(kCacheSize, segEnd - pos);
+    TSeqPos cache_size = min(m_CacheFill, segEnd - pos);
     x_FillCache(pos, cache_size);
     m_Cache = m_CacheData.get();
     _ASSERT(GetPos() == pos);
@@ -502,7 +733,7 @@ void CSeqVector_CI::x_UpdateCacheDown(TSeqPos pos)
     TSeqPos segStart = m_Seg.GetPosition();
     _ASSERT(pos >= segStart && pos < m_Seg.GetEndPosition());
 
-    TSeqPos cache_offset = min(kCacheSize - 1, pos - segStart);
+    TSeqPos cache_offset = min(m_CacheFill - 1, pos - segStart);
     x_FillCache(pos - cache_offset, cache_offset + 1);
     m_Cache = m_CacheData.get() + cache_offset;
     _ASSERT(GetPos() == pos);
@@ -510,12 +741,19 @@ void CSeqVector_CI::x_UpdateCacheDown(TSeqPos pos)
 
 
 void CSeqVector_CI::x_FillCache(TSeqPos start, TSeqPos count)
+{
+    x_ResizeCache(count);
+    x_DecodeSeg(m_Cache, start, count);
+    m_CachePos = start;
+}
+
+
+// Decode count residues of the current segment starting at start
+void CSeqVector_CI::x_DecodeSeg(char* dst, TSeqPos start, TSeqPos count)
 {
     _ASSERT(m_Seg.GetType() != CSeqMap::eSeqEnd);
     _ASSERT(start >= m_Seg.GetPosition());
-    _ASSERT(start < m_Seg.GetEndPosition());
-
-    x_ResizeCache(count);
+    _ASSERT(start + count <= m_Seg.GetEndPosition());
 
     switch ( m_Seg.GetType() ) {
     case CSeqMap::eSeqData:
@@ -523,7 +761,7 @@ void CSeqVector_CI::x_FillCache(TSeqPos start, TSeqPos count)
         const CSeq_data& data = m_Seg.GetRefData();
         if ( data.IsGap() && m_Seg.GetType() == CSeqMap::eSeqGap ) {
             // workaround for erroneously split gap Seq-data
-            x_FillCache(start, count);
+            x_DecodeSeg(dst, start, count);
             return;
         }
         
@@ -564,41 +802,41 @@ void CSeqVector_CI::x_FillCache(TSeqPos start, TSeqPos count)
 
         switch ( dataCoding ) {
         case CSeq_data::e_Iupacna:
-            copy_8bit_any(m_Cache, count, data.GetIupacna().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetIupacna().Get(), dataPos,
                           table, reverse);
             break;
         case CSeq_data::e_Iupacaa:
-            copy_8bit_any(m_Cache, count, data.GetIupacaa().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetIupacaa().Get(), dataPos,
                           table, reverse);
             break;
         case CSeq_data::e_Ncbi2na:
-            copy_2bit_any(m_Cache, count, data.GetNcbi2na().Get(), dataPos,
-                            table, reverse);
+            copy_2bit_bulk(dst, count, data.GetNcbi2na().Get(), dataPos,
+                           table, reverse);
             break;
         case CSeq_data::e_Ncbi4na:
-            copy_4bit_any(m_Cache, count, data.GetNcbi4na().Get(), dataPos,
-                          table, reverse);
+            copy_4bit_bulk(dst, count, data.GetNcbi4na().Get(), dataPos,
+                           table, reverse);
             break;
         case CSeq_data::e_Ncbi8na:
-            copy_8bit_any(m_Cache, count, data.GetNcbi8na().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetNcbi8na().Get(), dataPos,
                           table, reverse);
             break;
         case CSeq_data::e_Ncbipna:
             NCBI_THROW(CSeqVectorException, eCodingError,
                        "Ncbipna conversion not implemented");
         case CSeq_data::e_Ncbi8aa:
-            copy_8bit_any(m_Cache, count, data.GetNcbi8aa().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetNcbi8aa().Get(), dataPos,
                           table, reverse);
             break;
         case CSeq_data::e_Ncbieaa:
-            copy_8bit_any(m_Cache, count, data.GetNcbieaa().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetNcbieaa().Get(), dataPos,
                           table, reverse);
             break;
         case CSeq_data::e_Ncbipaa:
             NCBI_THROW(CSeqVectorException, eCodingError,
                        "Ncbipaa conversion not implemented");
         case CSeq_data::e_Ncbistdaa:
-            copy_8bit_any(m_Cache, count, data.GetNcbistdaa().Get(), dataPos,
+            copy_8bit_any(dst, count, data.GetNcbistdaa().Get(), dataPos,
                           table, reverse);
             break;
         default:
@@ -606,25 +844,24 @@ void CSeqVector_CI::x_FillCache(TSeqPos start, TSeqPos count)
                            "Invalid data coding: "<<dataCoding);
         }
         if ( randomize ) {
-            m_Randomizer->RandomizeData(m_Cache, count, start);
+            m_Randomizer->RandomizeData(dst, count, start);
         }
         break;
     }
     case CSeqMap::eSeqGap:
         if (m_Coding == CSeq_data::e_Ncbi2na  &&  m_Randomizer) {
-            fill_n(m_Cache, count,
+            fill_n(dst, count,
                    sx_GetGapChar(CSeq_data::e_Ncbi4na, eCaseConversion_none));
-            m_Randomizer->RandomizeData(m_Cache, count, start);
+            m_Randomizer->RandomizeData(dst, count, start);
         }
         else {
-            fill_n(m_Cache, count, GetGapChar());
+            fill_n(dst, count, GetGapChar());
         }
         break;
     default:
         NCBI_THROW_FMT(CSeqVectorException, eDataError,
                        "Invalid segment type: "<<m_Seg.GetType());
     }
-    m_CachePos = start;
 }
 
 
@@ -663,9 +900,10 @@ void CSeqVector_CI::x_SetPos(TSeqPos pos)
     }
     else {
         // cannot use backup
+        m_CacheFill = kMinCacheSize;
         x_InitializeCache();
         TSeqPos old_pos = x_BackupPos();
-        if ( pos < old_pos && pos >= old_pos - kCacheSize &&
+        if ( pos < old_pos && pos >= old_pos - m_CacheFill &&
              m_Seg.GetEndPosition() >= old_pos ) {
             x_UpdateCacheDown(old_pos - 1);
             cache_offset = pos - x_CachePos();
@@ -745,6 +983,24 @@ void CSeqVector_CI::GetSeqData(string& buffer, TSeqPos count)
         count -= chunk_count;
         //if ( count == 0 ) break;
         if ( chunk_end == cache_end ) {
+            if ( count >= kMinBulkCount ) {
+                // decode long stretches directly into the buffer
+                TSeqPos pos = x_CacheEndPos();
+                TSeqPos end = pos + count;
+                while ( end - pos >= kMinBulkCount ) {
+                    x_UpdateSeg(pos);
+                    TSeqPos seg_count = min(end, m_Seg.GetEndPosition()) - pos;
+                    size_t offset = buffer.size();
+                    buffer.resize(offset + seg_count);
+                    x_DecodeSeg(&buffer[offset], pos, seg_count);
+                    pos += seg_count;
+                }
+                count = end - pos;
+                x_ResetCache();
+                m_CachePos = pos;
+                x_SetPos(pos);
+                continue;
+            }
             x_NextCacheSeg();
         }
         else {
@@ -790,6 +1046,7 @@ void CSeqVector_CI::x_NextCacheSeg()
     else {
         // can not use backup cache
         x_ResetCache();
+        x_GrowCache();
         x_UpdateCacheUp(pos);
         _ASSERT(GetPos() == pos);
         _ASSERT(x_CacheSize());
@@ -831,6 +1088,7 @@ void CSeqVector_CI::x_PrevCacheSeg()
     else {
         // can not use backup cache
         x_ResetCache();
+        x_GrowCache();
         x_UpdateCacheDown(pos);
         _ASSERT(GetPos() == pos);
         _ASSERT(x_CacheSize());
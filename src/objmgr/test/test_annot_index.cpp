@@ -0,0 +1,546 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Check that the optional annotation indexes, and indexes made with
+*   worker threads, give the same results as the default one
+*
+*/
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbiargs.hpp>
+#include <corelib/ncbithr.hpp>
+#include <util/random_gen.hpp>
+
+#include <objects/seqset/Seq_entry.hpp>
+#include <objects/seq/Bioseq.hpp>
+#include <objects/seq/Seq_inst.hpp>
+#include <objects/seq/Seq_annot.hpp>
+#include <objects/seqloc/Seq_id.hpp>
+#include <objects/seqloc/Seq_loc.hpp>
+#include <objects/seqloc/Seq_interval.hpp>
+#include <objects/seqloc/Seq_point.hpp>
+#include <objects/seqloc/Seq_loc_mix.hpp>
+#include <objects/seqfeat/Seq_feat.hpp>
+#include <objects/seqres/Seq_graph.hpp>
+#include <objects/seqres/Byte_graph.hpp>
+
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+#include <objmgr/bioseq_handle.hpp>
+#include <objmgr/seq_entry_handle.hpp>
+#include <objmgr/feat_ci.hpp>
+#include <objmgr/graph_ci.hpp>
+#include <objmgr/seq_annot_handle.hpp>
+#include <objmgr/impl/tse_info.hpp>
+#include <objmgr/impl/seq_annot_info.hpp>
+
+#include <common/test_assert.h>  /* This header must go last */
+
+
+BEGIN_NCBI_SCOPE
+using namespace objects;
+
+
+// Feature as seen by CFeat_CI: the original object and the mapped range.
+typedef pair<const CSeq_feat*, CRange<TSeqPos> > TFoundFeat;
+typedef vector<TFoundFeat>                       TFoundFeats;
+typedef vector<TFoundFeats>                      TSearchResults;
+
+// Feature or graph as seen by CFeat_CI or CGraph_CI: its position in its
+// Seq-annot and the mapped range.
+typedef pair<size_t, CRange<TSeqPos> > TFoundObject;
+typedef vector<TFoundObject>           TFoundObjects;
+typedef vector<TFoundObjects>          TObjectResults;
+
+
+//===========================================================================
+// CTestAnnotIndex
+
+class CTestAnnotIndex : public CNcbiApplication
+{
+public:
+    virtual void Init(void);
+    virtual int  Run(void);
+
+    // Run all queries on the bioseq.
+    void Search(const CBioseq_Handle& bh, TSearchResults& results) const;
+
+private:
+    CRef<CSeq_entry> x_CreateEntry(void);
+    CRef<CSeq_entry> x_CreateBigEntry(bool bad_location);
+    CRef<CSeq_loc>   x_CreateLocation(void);
+    void x_SetCompact(const CBioseq_Handle& bh, bool compact) const;
+    bool x_Compare(const string& title,
+                   const TSearchResults& expected,
+                   const TSearchResults& results) const;
+    void x_SearchObjects(const CBioseq_Handle& bh,
+                         const CSeq_entry& entry,
+                         TObjectResults& results) const;
+    void x_IndexWithThreads(unsigned threads,
+                            const CSeq_entry& entry,
+                            TObjectResults& results,
+                            string& error) const;
+    int x_TestIndexThreads(void);
+
+    CRandom                         m_Random;
+    CRef<CSeq_id>                   m_Id;
+    TSeqPos                         m_Length;
+    vector<CRange<TSeqPos> >        m_Queries;
+};
+
+
+void CTestAnnotIndex::Init(void)
+{
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "Check optional annotation indexes");
+
+    arg_desc->AddDefaultKey("seed", "Seed",
+                            "Random generator seed",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->AddDefaultKey("features", "Count",
+                            "Number of features",
+                            CArgDescriptions::eInteger, "20000");
+    arg_desc->AddDefaultKey("queries", "Count",
+                            "Number of searches",
+                            CArgDescriptions::eInteger, "200");
+    arg_desc->AddDefaultKey("threads", "Count",
+                            "Number of concurrent searching threads",
+                            CArgDescriptions::eInteger, "4");
+    arg_desc->AddDefaultKey("index_objects", "Count",
+                            "Number of features and of graphs in the "
+                            "Seq-annots indexed with worker threads",
+                            CArgDescriptions::eInteger, "60000");
+    arg_desc->AddDefaultKey("index_threads", "Count",
+                            "Number of threads indexing big Seq-annots",
+                            CArgDescriptions::eInteger, "4");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+
+CRef<CSeq_loc> CTestAnnotIndex::x_CreateLocation(void)
+{
+    CRef<CSeq_loc> loc(new CSeq_loc);
+    TSeqPos from = m_Random.GetRand(0, m_Length-1);
+    // mostly short features, some of them long
+    TSeqPos max_len = m_Random.GetRand(0, 9)? 1000: m_Length/4;
+    TSeqPos to = min(m_Length-1, from + m_Random.GetRand(0, max_len));
+    ENa_strand strand = m_Random.GetRand(0, 1)? eNa_strand_plus:
+        eNa_strand_minus;
+    switch ( m_Random.GetRand(0, 9) ) {
+    case 0:
+        loc->SetPnt().SetId(*m_Id);
+        loc->SetPnt().SetPoint(from);
+        loc->SetPnt().SetStrand(strand);
+        break;
+    case 1:
+    {{
+        // two intervals with a gap
+        TSeqPos mid = from + (to - from) / 2;
+        CRef<CSeq_loc> loc1(new CSeq_loc(*m_Id, from, mid, strand));
+        CRef<CSeq_loc> loc2(new CSeq_loc(*m_Id, min(to, mid + 10), to,
+                                         strand));
+        loc->SetMix().Set().push_back(loc1);
+        loc->SetMix().Set().push_back(loc2);
+        break;
+    }}
+    default:
+        loc->SetInt().SetId(*m_Id);
+        loc->SetInt().SetFrom(from);
+        loc->SetInt().SetTo(to);
+        loc->SetInt().SetStrand(strand);
+        break;
+    }
+    return loc;
+}
+
+
+CRef<CSeq_entry> CTestAnnotIndex::x_CreateEntry(void)
+{
+    const CArgs& args = GetArgs();
+
+    CRef<CSeq_entry> entry(new CSeq_entry);
+    CBioseq& seq = entry->SetSeq();
+    seq.SetId().push_back(m_Id);
+    seq.SetInst().SetRepr(CSeq_inst::eRepr_virtual);
+    seq.SetInst().SetMol(CSeq_inst::eMol_dna);
+    seq.SetInst().SetLength(m_Length);
+
+    CRef<CSeq_annot> annot(new CSeq_annot);
+    int count = args["features"].AsInteger();
+    for ( int i = 0; i < count; ++i ) {
+        CRef<CSeq_feat> feat(new CSeq_feat);
+        if ( m_Random.GetRand(0, 1) ) {
+            feat->SetData().SetRegion("region "+NStr::IntToString(i));
+        }
+        else {
+            feat->SetData().SetComment();
+        }
+        feat->SetLocation(*x_CreateLocation());
+        annot->SetData().SetFtable().push_back(feat);
+    }
+    seq.SetAnnot().push_back(annot);
+    return entry;
+}
+
+
+// Features and graphs enough to be indexed with worker threads, optionally
+// with a feature whose location cannot be indexed.
+CRef<CSeq_entry> CTestAnnotIndex::x_CreateBigEntry(bool bad_location)
+{
+    const CArgs& args = GetArgs();
+
+    CRef<CSeq_entry> entry(new CSeq_entry);
+    CBioseq& seq = entry->SetSeq();
+    seq.SetId().push_back(m_Id);
+    seq.SetInst().SetRepr(CSeq_inst::eRepr_virtual);
+    seq.SetInst().SetMol(CSeq_inst::eMol_dna);
+    seq.SetInst().SetLength(m_Length);
+
+    int count = args["index_objects"].AsInteger();
+    CRef<CSeq_annot> feats(new CSeq_annot);
+    CRef<CSeq_annot> graphs(new CSeq_annot);
+    for ( int i = 0; i < count; ++i ) {
+        CRef<CSeq_feat> feat(new CSeq_feat);
+        feat->SetData().SetRegion("region "+NStr::IntToString(i));
+        feat->SetLocation(*x_CreateLocation());
+        if ( bad_location && i == count/2 ) {
+            // an empty local Seq-id cannot be indexed
+            CRef<CSeq_id> id(new CSeq_id);
+            id->SetLocal();
+            feat->SetLocation().SetWhole(*id);
+        }
+        feats->SetData().SetFtable().push_back(feat);
+
+        CRef<CSeq_graph> graph(new CSeq_graph);
+        graph->SetLoc(*x_CreateLocation());
+        graph->SetNumval(1);
+        CByte_graph& data = graph->SetGraph().SetByte();
+        data.SetMin(0);
+        data.SetMax(255);
+        data.SetAxis(0);
+        data.SetValues().push_back(char(i));
+        graphs->SetData().SetGraph().push_back(graph);
+    }
+    seq.SetAnnot().push_back(feats);
+    seq.SetAnnot().push_back(graphs);
+    return entry;
+}
+
+
+void CTestAnnotIndex::x_SetCompact(const CBioseq_Handle& bh,
+                                   bool compact) const
+{
+    const CTSE_Info& tse = bh.GetTSE_Handle().x_GetTSE_Info();
+    const_cast<CTSE_Info&>(tse).SetCompactAnnotIndex(compact);
+}
+
+
+void CTestAnnotIndex::Search(const CBioseq_Handle& bh,
+                             TSearchResults& results) const
+{
+    // unsorted, so that the index order is checked too
+    SAnnotSelector sel;
+    sel.SetSortOrder(SAnnotSelector::eSortOrder_None);
+
+    results.clear();
+    ITERATE ( vector<CRange<TSeqPos> >, it, m_Queries ) {
+        results.push_back(TFoundFeats());
+        for ( CFeat_CI feat(bh, *it, sel); feat; ++feat ) {
+            results.back().push_back(TFoundFeat(&feat->GetOriginalFeature(),
+                                                feat->GetRange()));
+        }
+    }
+}
+
+
+bool CTestAnnotIndex::x_Compare(const string& title,
+                                const TSearchResults& expected,
+                                const TSearchResults& results) const
+{
+    _ASSERT(expected.size() == m_Queries.size());
+    if ( results.size() != expected.size() ) {
+        ERR_POST("ERROR: " << title << ": " << results.size() <<
+                 " searches instead of " << expected.size());
+        return false;
+    }
+    for ( size_t i = 0; i < expected.size(); ++i ) {
+        if ( results[i] != expected[i] ) {
+            ERR_POST("ERROR: " << title << ": search in " <<
+                     m_Queries[i].GetFrom() << ".." <<
+                     m_Queries[i].GetTo() << " found " <<
+                     results[i].size() << " features instead of " <<
+                     expected[i].size() << " or in different order");
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void CTestAnnotIndex::x_SearchObjects(const CBioseq_Handle& bh,
+                                      const CSeq_entry& entry,
+                                      TObjectResults& results) const
+{
+    // the objects are identified by their positions, since each search
+    // is done on a copy of the entry
+    map<const CObject*, size_t> positions;
+    ITERATE ( CBioseq::TAnnot, it, entry.GetSeq().GetAnnot() ) {
+        const CSeq_annot::TData& data = (*it)->GetData();
+        if ( data.IsFtable() ) {
+            ITERATE ( CSeq_annot::TData::TFtable, feat, data.GetFtable() ) {
+                positions.insert(make_pair(feat->GetPointer(),
+                                           positions.size()));
+            }
+        }
+        else if ( data.IsGraph() ) {
+            ITERATE ( CSeq_annot::TData::TGraph, graph, data.GetGraph() ) {
+                positions.insert(make_pair(graph->GetPointer(),
+                                           positions.size()));
+            }
+        }
+    }
+
+    // unsorted, so that the index order is checked too
+    SAnnotSelector sel;
+    sel.SetSortOrder(SAnnotSelector::eSortOrder_None);
+
+    results.clear();
+    ITERATE ( vector<CRange<TSeqPos> >, it, m_Queries ) {
+        results.push_back(TFoundObjects());
+        for ( CFeat_CI feat(bh, *it, sel); feat; ++feat ) {
+            results.back().push_back
+                (TFoundObject(positions[&feat->GetOriginalFeature()],
+                              feat->GetRange()));
+        }
+        results.push_back(TFoundObjects());
+        for ( CGraph_CI graph(bh, *it, sel); graph; ++graph ) {
+            results.back().push_back
+                (TFoundObject(positions[&graph->GetOriginalGraph()],
+                              graph->GetLoc().GetTotalRange()));
+        }
+    }
+}
+
+
+// Index a copy of the entry with the given number of threads and search it.
+// An error while indexing is returned instead of the results.
+void CTestAnnotIndex::x_IndexWithThreads(unsigned threads,
+                                         const CSeq_entry& entry,
+                                         TObjectResults& results,
+                                         string& error) const
+{
+    NCBI_PARAM_TYPE(OBJMGR, ANNOT_INDEX_THREADS)::SetDefault(threads);
+
+    CRef<CSeq_entry> copy(new CSeq_entry);
+    copy->Assign(entry);
+    CScope scope(*CObjectManager::GetInstance());
+
+    results.clear();
+    error.erase();
+    try {
+        // the Seq-annots are indexed when the entry is added
+        scope.AddTopLevelSeqEntry(*copy);
+        CBioseq_Handle bh = scope.GetBioseqHandle(*m_Id);
+        _ASSERT(bh);
+        x_SearchObjects(bh, *copy, results);
+    }
+    catch ( CException& exc ) {
+        results.clear();
+        error = exc.GetMsg();
+    }
+}
+
+
+// Indexing with worker threads must give the same features and graphs,
+// in the same order, as indexing without them, and must report the same
+// error for a location failing in a worker.
+int CTestAnnotIndex::x_TestIndexThreads(void)
+{
+    unsigned saved_threads =
+        NCBI_PARAM_TYPE(OBJMGR, ANNOT_INDEX_THREADS)::GetDefault();
+    unsigned threads = GetArgs()["index_threads"].AsInteger();
+    int error = 0;
+
+    for ( int bad_location = 0; bad_location < 2; ++bad_location ) {
+        string title = bad_location? "threaded index with a bad location":
+            "threaded index";
+        CRef<CSeq_entry> entry = x_CreateBigEntry(bad_location != 0);
+
+        TObjectResults expected, results;
+        string expected_error, result_error;
+        x_IndexWithThreads(1, *entry, expected, expected_error);
+        x_IndexWithThreads(threads, *entry, results, result_error);
+
+        if ( bad_location && expected_error.empty() ) {
+            ERR_POST("ERROR: " << title << ": no error without threads");
+            ++error;
+        }
+        if ( !bad_location && !expected_error.empty() ) {
+            ERR_POST("ERROR: " << title << ": " << expected_error);
+            ++error;
+        }
+        if ( result_error != expected_error ) {
+            ERR_POST("ERROR: " << title << ": error \"" << result_error <<
+                     "\" instead of \"" << expected_error << "\"");
+            ++error;
+        }
+        if ( results != expected ) {
+            ERR_POST("ERROR: " << title << ": found different objects "
+                     "or in different order");
+            ++error;
+        }
+    }
+
+    NCBI_PARAM_TYPE(OBJMGR, ANNOT_INDEX_THREADS)::SetDefault(saved_threads);
+    return error;
+}
+
+
+// Thread running the same searches as the main thread.
+class CSearchThread : public CThread
+{
+public:
+    CSearchThread(const CTestAnnotIndex& app, const CBioseq_Handle& bh)
+        : m_App(app), m_Bioseq(bh)
+        {
+        }
+
+    const TSearchResults& GetResults(void) const
+        {
+            return m_Results;
+        }
+
+protected:
+    virtual void* Main(void)
+        {
+            m_App.Search(m_Bioseq, m_Results);
+            return 0;
+        }
+
+private:
+    const CTestAnnotIndex& m_App;
+    CBioseq_Handle         m_Bioseq;
+    TSearchResults         m_Results;
+};
+
+
+int CTestAnnotIndex::Run(void)
+{
+    const CArgs& args = GetArgs();
+
+    m_Random.SetSeed(args["seed"].AsInteger());
+    m_Id.Reset(new CSeq_id("lcl|annot_index"));
+    m_Length = 10000000;
+
+    int query_count = args["queries"].AsInteger();
+    for ( int i = 0; i < query_count; ++i ) {
+        TSeqPos from = m_Random.GetRand(0, m_Length-1);
+        TSeqPos len = m_Random.GetRand(0, 9)? 5000: 500000;
+        m_Queries.push_back(CRange<TSeqPos>(from,
+                                            min(m_Length-1, from+len)));
+    }
+    m_Queries.push_back(CRange<TSeqPos>::GetWhole());
+
+    CRef<CObjectManager> om = CObjectManager::GetInstance();
+    CScope scope(*om);
+    scope.AddTopLevelSeqEntry(*x_CreateEntry());
+    CBioseq_Handle bh = scope.GetBioseqHandle(*m_Id);
+    _ASSERT(bh);
+
+    int error = 0;
+
+    x_SetCompact(bh, false);
+    TSearchResults expected;
+    Search(bh, expected);
+
+    // the first search makes the compact index, the second one uses it
+    x_SetCompact(bh, true);
+    for ( int pass = 0; pass < 2; ++pass ) {
+        TSearchResults results;
+        Search(bh, results);
+        if ( !x_Compare("compact index", expected, results) ) {
+            ++error;
+        }
+    }
+
+    // concurrent searches, all of them trying to make the index
+    x_SetCompact(bh, false);
+    x_SetCompact(bh, true);
+    vector<CRef<CSearchThread> > threads;
+    for ( int i = 0; i < args["threads"].AsInteger(); ++i ) {
+        threads.push_back(Ref(new CSearchThread(*this, bh)));
+        threads.back()->Run();
+    }
+    NON_CONST_ITERATE ( vector<CRef<CSearchThread> >, it, threads ) {
+        (*it)->Join();
+        if ( !x_Compare("concurrent compact index",
+                        expected, (*it)->GetResults()) ) {
+            ++error;
+        }
+    }
+
+    // a modification drops the index, the next search makes a new one
+    CRef<CSeq_feat> feat(new CSeq_feat);
+    feat->Assign(*expected.back().front().first);
+    scope.GetEditHandle(CFeat_CI(bh).GetAnnot()).AddFeat(*feat);
+    bh = scope.GetBioseqHandle(*m_Id);
+    x_SetCompact(bh, false);
+    Search(bh, expected);
+    x_SetCompact(bh, true);
+    {{
+        TSearchResults results;
+        Search(bh, results);
+        if ( !x_Compare("compact index after edit", expected, results) ) {
+            ++error;
+        }
+    }}
+
+    error += x_TestIndexThreads();
+
+    if ( error ) {
+        NcbiCout << "ERROR: " << error << " tests failed." << NcbiEndl;
+        return 1;
+    }
+    NcbiCout << "Test completed successfully" << NcbiEndl;
+    return 0;
+}
+
+
+END_NCBI_SCOPE
+
+USING_NCBI_SCOPE;
+
+//===========================================================================
+// entry point
+
+int main(int argc, const char* argv[])
+{
+    return CTestAnnotIndex().AppMain(argc, argv);
+}
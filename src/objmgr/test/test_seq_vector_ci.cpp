@@ -0,0 +1,468 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Check that the bulk decoding of ncbi2na and ncbi4na data in
+*   CSeqVector_CI gives the same residues as decoding them one by one
+*
+*/
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbiargs.hpp>
+#include <util/random_gen.hpp>
+
+#include <objects/seq/seq__.hpp>
+#include <objects/seq/seqport_util.hpp>
+#include <objects/seqloc/seqloc__.hpp>
+
+#include <objmgr/object_manager.hpp>
+#include <objmgr/scope.hpp>
+#include <objmgr/bioseq_handle.hpp>
+#include <objmgr/seq_vector.hpp>
+#include <objmgr/seq_vector_ci.hpp>
+#include <objmgr/impl/seq_vector_cvt.hpp>
+
+#include <common/test_assert.h>  /* This header must go last */
+
+
+BEGIN_NCBI_SCOPE
+using namespace objects;
+
+
+// Stretch [from, to) of one of the raw sequences on the given strand
+struct SSegment
+{
+    size_t  raw;
+    TSeqPos from;
+    TSeqPos to;
+    bool    minus;
+};
+typedef vector<SSegment> TSegments;
+
+
+//===========================================================================
+// CTestSeqVectorCI
+
+class CTestSeqVectorCI : public CNcbiApplication
+{
+public:
+    virtual void Init(void);
+    virtual int  Run(void);
+
+private:
+    CRef<CBioseq> x_CreateRaw(const string& id, CSeq_data::E_Choice coding,
+                              TSeqPos length);
+    CRef<CBioseq> x_CreateDelta(const string& id, const TSegments& segments);
+    string x_Expected(const SSegment& segment,
+                      CSeq_data::E_Choice coding, bool minus) const;
+    string x_Expected(const TSegments& segments,
+                      CSeq_data::E_Choice coding, bool minus) const;
+    bool x_Compare(const string& title, const string& expected,
+                   const string& data, TSeqPos offset) const;
+    int x_TestSequence(const string& name, const CBioseq_Handle& bh,
+                       const TSegments& segments);
+    int x_TestCopyRoutines(void);
+
+    CRandom                  m_Random;
+    int                      m_Requests;
+    vector<CRef<CBioseq> >   m_Raw;
+};
+
+
+void CTestSeqVectorCI::Init(void)
+{
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "Check bulk decoding in CSeqVector_CI");
+
+    arg_desc->AddDefaultKey("seed", "Seed",
+                            "Random generator seed",
+                            CArgDescriptions::eInteger, "1");
+    arg_desc->AddDefaultKey("length", "Length",
+                            "Length of the raw sequences",
+                            CArgDescriptions::eInteger, "300000");
+    arg_desc->AddDefaultKey("requests", "Count",
+                            "Number of random ranges read from each "
+                            "seq-vector",
+                            CArgDescriptions::eInteger, "100");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+
+CRef<CBioseq> CTestSeqVectorCI::x_CreateRaw(const string& id,
+                                            CSeq_data::E_Choice coding,
+                                            TSeqPos length)
+{
+    CRef<CBioseq> seq(new CBioseq);
+    seq->SetId().push_back(CRef<CSeq_id>(new CSeq_id("lcl|" + id)));
+    CSeq_inst& inst = seq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_raw);
+    inst.SetMol(CSeq_inst::eMol_dna);
+    inst.SetLength(length);
+    vector<char>* data;
+    if ( coding == CSeq_data::e_Ncbi2na ) {
+        data = &inst.SetSeq_data().SetNcbi2na().Set();
+        data->resize((length+3)/4);
+    }
+    else {
+        _ASSERT(coding == CSeq_data::e_Ncbi4na);
+        data = &inst.SetSeq_data().SetNcbi4na().Set();
+        data->resize((length+1)/2);
+    }
+    // every byte value, including the unused bits of the last byte
+    NON_CONST_ITERATE ( vector<char>, it, *data ) {
+        *it = char(m_Random.GetRand(0, 255));
+    }
+    return seq;
+}
+
+
+CRef<CBioseq> CTestSeqVectorCI::x_CreateDelta(const string& id,
+                                              const TSegments& segments)
+{
+    CRef<CBioseq> seq(new CBioseq);
+    seq->SetId().push_back(CRef<CSeq_id>(new CSeq_id("lcl|" + id)));
+    CSeq_inst& inst = seq->SetInst();
+    inst.SetRepr(CSeq_inst::eRepr_delta);
+    inst.SetMol(CSeq_inst::eMol_dna);
+    TSeqPos length = 0;
+    ITERATE ( TSegments, it, segments ) {
+        CRef<CDelta_seq> seg(new CDelta_seq);
+        CSeq_interval& interval = seg->SetLoc().SetInt();
+        interval.SetId().Assign(*m_Raw[it->raw]->GetId().front());
+        interval.SetFrom(it->from);
+        interval.SetTo(it->to - 1);
+        interval.SetStrand(it->minus? eNa_strand_minus: eNa_strand_plus);
+        inst.SetExt().SetDelta().Set().push_back(seg);
+        length += it->to - it->from;
+    }
+    inst.SetLength(length);
+    return seq;
+}
+
+
+// The residues of the segment as unpacked by CSeqportUtil, which shares
+// no decoding code with CSeqVector_CI
+string CTestSeqVectorCI::x_Expected(const SSegment& segment,
+                                    CSeq_data::E_Choice coding,
+                                    bool minus) const
+{
+    const CSeq_data& data = m_Raw[segment.raw]->GetInst().GetSeq_data();
+    TSeqPos length = segment.to - segment.from;
+    CSeq_data converted;
+    CSeqportUtil::Convert(data, &converted, coding, segment.from, length);
+    if ( segment.minus != minus ) {
+        CSeqportUtil::ReverseComplement(&converted, 0, length);
+    }
+    string ret;
+    ret.reserve(length);
+    switch ( coding ) {
+    case CSeq_data::e_Iupacna:
+        ret = converted.GetIupacna().Get().substr(0, length);
+        break;
+    case CSeq_data::e_Ncbi4na:
+    {
+        const vector<char>& v = converted.GetNcbi4na().Get();
+        for ( TSeqPos i = 0; i < length; ++i ) {
+            ret += char((v[i/2] >> (i%2? 0: 4)) & 0x0f);
+        }
+        break;
+    }
+    case CSeq_data::e_Ncbi2na:
+    {
+        const vector<char>& v = converted.GetNcbi2na().Get();
+        for ( TSeqPos i = 0; i < length; ++i ) {
+            ret += char((v[i/4] >> (6 - 2*(i%4))) & 0x03);
+        }
+        break;
+    }
+    default:
+        NCBI_THROW(CException, eUnknown, "unexpected coding");
+    }
+    return ret;
+}
+
+
+string CTestSeqVectorCI::x_Expected(const TSegments& segments,
+                                    CSeq_data::E_Choice coding,
+                                    bool minus) const
+{
+    string ret;
+    if ( minus ) {
+        REVERSE_ITERATE ( TSegments, it, segments ) {
+            ret += x_Expected(*it, coding, true);
+        }
+    }
+    else {
+        ITERATE ( TSegments, it, segments ) {
+            ret += x_Expected(*it, coding, false);
+        }
+    }
+    return ret;
+}
+
+
+bool CTestSeqVectorCI::x_Compare(const string& title,
+                                 const string& expected,
+                                 const string& data,
+                                 TSeqPos offset) const
+{
+    if ( offset + data.size() > expected.size() ) {
+        ERR_POST("ERROR: " << title << ": " << data.size() <<
+                 " residues at " << offset << " past the end " <<
+                 expected.size());
+        return false;
+    }
+    pair<string::const_iterator, string::const_iterator> diff =
+        mismatch(data.begin(), data.end(), expected.begin() + offset);
+    if ( diff.first != data.end() ) {
+        ERR_POST("ERROR: " << title << ": residue " <<
+                 offset + (diff.first - data.begin()) << " is " <<
+                 int(*diff.first) << " instead of " << int(*diff.second));
+        return false;
+    }
+    return true;
+}
+
+
+int CTestSeqVectorCI::x_TestSequence(const string& name,
+                                     const CBioseq_Handle& bh,
+                                     const TSegments& segments)
+{
+    bool ncbi2na = true;
+    ITERATE ( TSegments, it, segments ) {
+        if ( !m_Raw[it->raw]->GetInst().GetSeq_data().IsNcbi2na() ) {
+            ncbi2na = false;
+        }
+    }
+
+    int error = 0;
+    for ( int coding = 0; coding < (ncbi2na? 3: 2); ++coding ) {
+        for ( int minus = 0; minus < 2; ++minus ) {
+            CSeqVector sv(bh,
+                          coding == 1? CBioseq_Handle::eCoding_Iupac:
+                          CBioseq_Handle::eCoding_Ncbi,
+                          minus? eNa_strand_minus: eNa_strand_plus);
+            if ( coding == 2 ) {
+                sv.SetCoding(CSeq_data::e_Ncbi2na);
+            }
+            string title = name + (minus? " minus": " plus") +
+                (coding == 0? " ncbi4na": coding == 1? " iupacna": " ncbi2na");
+            string expected = x_Expected(segments, sv.GetCoding(), minus != 0);
+            if ( expected.size() != sv.size() ) {
+                ERR_POST("ERROR: " << title << ": length " << sv.size() <<
+                         " instead of " << expected.size());
+                ++error;
+                continue;
+            }
+
+            // the whole sequence, decoded in bulk
+            string data;
+            sv.GetSeqData(0, sv.size(), data);
+            if ( data.size() != sv.size() ||
+                 !x_Compare(title + " GetSeqData", expected, data, 0) ) {
+                ++error;
+            }
+
+            // residue by residue, forward and backward
+            string forward;
+            for ( CSeqVector_CI it(sv); it; ++it ) {
+                forward += *it;
+            }
+            if ( !x_Compare(title + " forward", expected, forward, 0) ) {
+                ++error;
+            }
+            string backward;
+            for ( CSeqVector_CI it(sv, sv.size()-1); ; --it ) {
+                backward += *it;
+                if ( it.GetPos() == 0 ) {
+                    break;
+                }
+            }
+            reverse(backward.begin(), backward.end());
+            if ( !x_Compare(title + " backward", expected, backward, 0) ) {
+                ++error;
+            }
+
+            // unaligned ranges, short ones and ones long enough to be
+            // decoded straight into the buffer
+            for ( int i = 0; i < m_Requests; ++i ) {
+                TSeqPos start = m_Random.GetRand(0, sv.size());
+                TSeqPos max_count = sv.size() - start;
+                if ( i % 2 ) {
+                    max_count = min(max_count, TSeqPos(300));
+                }
+                TSeqPos stop = start + m_Random.GetRand(0, max_count);
+                CNcbiOstrstream str;
+                str << title << " [" << start << ", " << stop << ")";
+                string range_title = CNcbiOstrstreamToString(str);
+                sv.GetSeqData(start, stop, data);
+                if ( data.size() != stop - start ||
+                     !x_Compare(range_title, expected, data, start) ) {
+                    ++error;
+                }
+                // continue reading sequentially after the range
+                CSeqVector_CI it(sv, start);
+                it.GetSeqData(data, stop - start);
+                string next;
+                for ( int j = 0; j < 5 && it; ++j, ++it ) {
+                    next += *it;
+                }
+                if ( !x_Compare(range_title + " iterator", expected,
+                                data + next, start) ) {
+                    ++error;
+                }
+            }
+        }
+    }
+    return error;
+}
+
+
+// Check the generic packed data routines against the residues extracted
+// one at a time, for every alignment of the start and end
+int CTestSeqVectorCI::x_TestCopyRoutines(void)
+{
+    // codes 0-3 in every position of a byte
+    static const char kPacked[] = {
+        char(0x1b), char(0xe4), char(0x6c), char(0x93),
+        char(0x27), char(0xd8), char(0xb1), char(0x4e)
+    };
+    vector<char> packed(kPacked, kPacked + sizeof(kPacked));
+    static const char kTable[] = "ACGTMRWSYKVHDBN-";
+
+    int error = 0;
+    for ( int bits = 2; bits <= 4; bits += 2 ) {
+        size_t per_byte = 8 / bits;
+        size_t total = packed.size() * per_byte;
+        for ( size_t pos = 0; pos < total; ++pos ) {
+            // the routines are never called for no residues
+            for ( size_t count = 1; pos + count <= total; ++count ) {
+                for ( int reverse = 0; reverse < 2; ++reverse ) {
+                    for ( int table = 0; table < 2; ++table ) {
+                        string expected;
+                        for ( size_t i = 0; i < count; ++i ) {
+                            size_t p = reverse? pos + count - 1 - i: pos + i;
+                            size_t shift = 8 - bits*(p % per_byte + 1);
+                            int c = (packed[p / per_byte] >> shift) &
+                                ((1 << bits) - 1);
+                            expected += table? kTable[c]: char(c);
+                        }
+                        string data(count + 1, 'X');
+                        if ( bits == 2 ) {
+                            copy_2bit_any(&data[0], count, packed, pos,
+                                          table? kTable: 0, reverse != 0);
+                        }
+                        else {
+                            copy_4bit_any(&data[0], count, packed, pos,
+                                          table? kTable: 0, reverse != 0);
+                        }
+                        if ( data != expected + 'X' ) {
+                            ERR_POST("ERROR: copy_" << bits << "bit" <<
+                                     (table? "_table": "") <<
+                                     (reverse? "_reverse": "") <<
+                                     " of " << count << " at " << pos <<
+                                     ": \"" << NStr::PrintableString(data) <<
+                                     "\" instead of \"" <<
+                                     NStr::PrintableString(expected) <<
+                                     "X\"");
+                            ++error;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    return error;
+}
+
+
+int CTestSeqVectorCI::Run(void)
+{
+    const CArgs& args = GetArgs();
+    m_Random.SetSeed(args["seed"].AsInteger());
+    m_Requests = args["requests"].AsInteger();
+    TSeqPos length = args["length"].AsInteger();
+
+    CRef<CObjectManager> om = CObjectManager::GetInstance();
+    CScope scope(*om);
+
+    m_Raw.push_back(x_CreateRaw("raw2na", CSeq_data::e_Ncbi2na, length+3));
+    m_Raw.push_back(x_CreateRaw("raw4na", CSeq_data::e_Ncbi4na, length+1));
+    vector<CBioseq_Handle> raw;
+    ITERATE ( vector<CRef<CBioseq> >, it, m_Raw ) {
+        raw.push_back(scope.AddBioseq(**it));
+    }
+
+    // segments with every alignment of the start and the end in the
+    // packed data, long and short ones, on both strands
+    TSegments segments2na, segments;
+    for ( TSeqPos shift = 0; shift < 4; ++shift ) {
+        SSegment seg2na = { 0, shift, length - shift, shift % 2 != 0 };
+        segments2na.push_back(seg2na);
+        SSegment seg4na = { 1, shift, length - 3*shift, shift >= 2 };
+        segments.push_back(seg4na);
+        SSegment seg_short = { 0, 7 + shift, 77 - shift, shift < 2 };
+        segments2na.push_back(seg_short);
+        segments.push_back(seg_short);
+        segments.push_back(seg2na);
+    }
+    CBioseq_Handle delta2na =
+        scope.AddBioseq(*x_CreateDelta("delta2na", segments2na));
+    CBioseq_Handle delta = scope.AddBioseq(*x_CreateDelta("delta", segments));
+
+    int error = 0;
+    error += x_TestCopyRoutines();
+    for ( size_t i = 0; i < m_Raw.size(); ++i ) {
+        SSegment whole = { i, 0, raw[i].GetBioseqLength(), false };
+        error += x_TestSequence(m_Raw[i]->GetId().front()->AsFastaString(),
+                                raw[i], TSegments(1, whole));
+    }
+    error += x_TestSequence("delta2na", delta2na, segments2na);
+    error += x_TestSequence("delta", delta, segments);
+
+    if ( error ) {
+        NcbiCout << "ERROR: " << error << " tests failed." << NcbiEndl;
+        return 1;
+    }
+    NcbiCout << "Test completed successfully." << NcbiEndl;
+    return 0;
+}
+
+
+END_NCBI_SCOPE
+
+USING_NCBI_SCOPE;
+
+//===========================================================================
+// entry point
+
+int main(int argc, const char* argv[])
+{
+    return CTestSeqVectorCI().AppMain(argc, argv);
+}
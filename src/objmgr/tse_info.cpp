@@ -32,6 +32,7 @@
 
 
 #include <ncbi_pch.hpp>
+#include <corelib/ncbi_param.hpp>
 #include <objmgr/impl/data_source.hpp>
 #include <objmgr/impl/tse_info.hpp>
 #include <objmgr/impl/tse_split_info.hpp>
@@ -82,6 +83,10 @@ SIdAnnotObjs::TRangeMap& SIdAnnotObjs::x_GetRangeMap(size_t index)
     if ( index >= m_AnnotSet.size() ) {
         m_AnnotSet.resize(index+1);
     }
+    if ( index < m_IndexSet.size() ) {
+        // the range map is going to be modified
+        m_IndexSet[index].Reset();
+    }
     TRangeMap*& slot = m_AnnotSet[index];
     if ( !slot ) {
         slot = new TRangeMap;
@@ -102,11 +107,43 @@ bool SIdAnnotObjs::x_CleanRangeMaps(void)
             slot = 0;
         }
         m_AnnotSet.pop_back();
+        if ( m_IndexSet.size() > m_AnnotSet.size() ) {
+            m_IndexSet.resize(m_AnnotSet.size());
+        }
     }
     return true;
 }
 
 
+// smaller range maps are searched as fast without the compact index
+static const size_t kMinRangeIndexSize = 64;
+
+
+CConstRef<SIdAnnotObjs::CRangeIndex>
+SIdAnnotObjs::x_GetRangeIndex(size_t index) const
+{
+    _ASSERT(!x_RangeMapIsEmpty(index));
+    if ( index < m_IndexSet.size() && m_IndexSet[index] ) {
+        return m_IndexSet[index];
+    }
+    const TRangeMap& rmap = x_GetRangeMap(index);
+    if ( rmap.size() < kMinRangeIndexSize ) {
+        return null;
+    }
+    if ( index >= m_IndexSet.size() ) {
+        m_IndexSet.resize(index+1);
+    }
+    m_IndexSet[index] = new CRangeIndex(rmap);
+    return m_IndexSet[index];
+}
+
+
+void SIdAnnotObjs::x_DropRangeIndexes(void)
+{
+    m_IndexSet.clear();
+}
+
+
 SIdAnnotObjs::SIdAnnotObjs(const SIdAnnotObjs& _DEBUG_ARG(objs))
 {
     _ASSERT(objs.m_AnnotSet.empty());
@@ -282,6 +319,17 @@ CTSE_Info& CTSE_Info::Assign(const CTSE_Lock& tse,
 }
 
 
+NCBI_PARAM_DECL(bool, OBJMGR, COMPACT_ANNOT_INDEX);
+NCBI_PARAM_DEF_EX(bool, OBJMGR, COMPACT_ANNOT_INDEX, false,
+                  eParam_NoThread, OBJMGR_COMPACT_ANNOT_INDEX);
+
+static bool s_GetDefaultCompactAnnotIndex(void)
+{
+    static CSafeStatic<NCBI_PARAM_TYPE(OBJMGR, COMPACT_ANNOT_INDEX)> sx_Value;
+    return sx_Value->Get();
+}
+
+
 void CTSE_Info::x_Initialize(void)
 {
     m_DataSource = 0;
@@ -291,6 +339,7 @@ void CTSE_Info::x_Initialize(void)
     m_LoadState = eNotLoaded;
     m_CacheState = eNotInCache;
     m_AnnotIdsFlags = 0;
+    m_CompactAnnotIndex = s_GetDefaultCompactAnnotIndex();
 }
 
 
@@ -325,6 +374,20 @@ void CTSE_Info::SetBlobVersion(TBlobVersion version)
 }
 
 
+void CTSE_Info::SetCompactAnnotIndex(bool compact)
+{
+    TAnnotLockWriteGuard guard(GetAnnotLock());
+    m_CompactAnnotIndex = compact;
+    if ( !compact ) {
+        NON_CONST_ITERATE ( TNamedAnnotObjs, it, m_NamedAnnotObjs ) {
+            NON_CONST_ITERATE ( TAnnotObjs, it2, it->second ) {
+                it2->second.x_DropRangeIndexes();
+            }
+        }
+    }
+}
+
+
 void CTSE_Info::SetName(const CAnnotName& name)
 {
     m_Name = name;
@@ -1129,6 +1192,16 @@ CTSE_Info::x_GetUnnamedIdObjects(const CSeq_id_Handle& idh) const
 }
 
 
+CConstRef<SIdAnnotObjs::CRangeIndex>
+CTSE_Info::x_GetRangeIndex(const SIdAnnotObjs& objs, size_t index) const
+{
+    // tse annot index should be locked by TAnnotLockReadGuard;
+    // concurrent searches may make the index, so guard it separately
+    CFastMutexGuard guard(m_RangeIndexMutex);
+    return objs.x_GetRangeIndex(index);
+}
+
+
 bool CTSE_Info::x_HasIdObjects(const CSeq_id_Handle& idh) const
 {
     // tse annot index should be locked by TAnnotLockReadGuard
@@ -368,6 +368,23 @@ CRef<CBlast_def_line_set> CSeqDB::GetHdr(int oid) const
     return rv;
 }
 
+CRef<CBlast_def_line_set>
+CSeqDB::GetPartialHdr(int oid, TSeqDBDeflineFields fields) const
+{
+    m_Impl->Verify();
+    CRef<CBlast_def_line_set> rv = m_Impl->GetPartialHdr(oid, fields);
+    m_Impl->Verify();
+
+    return rv;
+}
+
+void CSeqDB::SetDeflineCacheSize(size_t bytes)
+{
+    m_Impl->Verify();
+    m_Impl->SetDeflineCacheSize(bytes);
+    m_Impl->Verify();
+}
+
 CSeqDB::ESeqType CSeqDB::GetSequenceType() const
 {
     switch(m_Impl->GetSeqType()) {
@@ -807,6 +824,46 @@ void CSeqDB::AccessionToOids(const string & acc, vector<int> & oids) const
     m_Impl->Verify();
 }
 
+void CSeqDB::SetTaxIdFilter(const set<TTaxId> & taxids)
+{
+    m_Impl->Verify();
+    m_Impl->SetTaxIdFilter(taxids);
+    m_Impl->Verify();
+}
+
+void CSeqDB::AccessionsToOids(const vector<string> & accs,
+                              vector<int>          & oids) const
+{
+    m_Impl->Verify();
+    m_Impl->AccessionsToOids(accs, oids);
+
+    // As in AccessionToOids(), numeric strings that were not found
+    // are looked up as GIs (but not as PIGs or TIs).
+
+    for(size_t i = 0; i < accs.size(); i++) {
+        if (oids[i] >= 0) {
+            continue;
+        }
+
+        try {
+            TGi gi = GI_FROM(
+                    TIntId,
+                    NStr::StringToNumeric<TIntId>(accs[i],
+                                                  NStr::fConvErr_NoThrow)
+            );
+            int oid(-1);
+
+            if (gi > ZERO_GI  &&  m_Impl->GiToOidwFilterCheck(gi, oid)) {
+                oids[i] = oid;
+            }
+        }
+        catch(...) {
+        }
+    }
+
+    m_Impl->Verify();
+}
+
 void CSeqDB::SeqidToOids(const CSeq_id & seqid, vector<int> & oids) const
 {
     m_Impl->Verify();
@@ -1254,6 +1311,27 @@ void CSeqDB::SetNumberOfThreads(int num_threads, bool force_mt)
     m_Impl->SetNumberOfThreads(num_threads, force_mt);
 }
 
+void CSeqDB::Prefetch(int begin_oid, int end_oid)
+{
+    m_Impl->Verify();
+
+    m_Impl->Prefetch(begin_oid, end_oid);
+}
+
+void CSeqDB::SetSequentialReadahead(bool enable)
+{
+    m_Impl->Verify();
+
+    m_Impl->SetSequentialReadahead(enable);
+}
+
+SSeqDBPrefetchStats CSeqDB::GetPrefetchStats() const
+{
+    m_Impl->Verify();
+
+    return m_Impl->GetPrefetchStats();
+}
+
 string CSeqDB::ESeqType2String(ESeqType type)
 {
     string retval("Unknown");
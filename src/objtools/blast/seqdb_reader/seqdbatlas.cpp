@@ -187,6 +187,7 @@ CSeqDBAtlas::CSeqDBAtlas(bool use_mmap)
     : m_UseMmap           (use_mmap),
       m_CurAlloc          (0),
       m_LastFID           (0),
+      m_RecentPublished   (0),
       m_OpenRegionsTrigger(CSeqDBMapStrategy::eOpenRegionsWindow),
       m_MaxFileSize       (0),
       m_Strategy          (*this),
@@ -217,6 +218,11 @@ CSeqDBAtlas::~CSeqDBAtlas()
     // For now, and maybe permanently, enforce balance.
 
     _ASSERT(m_Pool.size() == 0);
+    _ASSERT(m_Published.empty());
+
+    ITERATE(TAddressTable, iter, m_PublishedLookup) {
+        delete iter->second;
+    }
 
     // Erase 'manually allocated' elements - In debug mode, this will
     // not execute, because of the above test.
@@ -352,6 +358,84 @@ bool CSeqDBAtlas::GetFileSizeL(const string & fname,
     return data.first;
 }
 
+const char * CSeqDBAtlas::PublishFile(const string   & fname,
+                                      CSeqDBLockHold & locked)
+{
+    // Mapping whole volumes is only reasonable with a 64 bit address
+    // space; otherwise the sliced regions are used.
+
+    if ((! m_UseMmap) || (sizeof(void*) < 8)) {
+        return 0;
+    }
+
+    Lock(locked);
+    Verify(true);
+
+    const string * strp = 0;
+    int fid = x_LookupFile(fname, & strp);
+
+    map<int, CRegionMap*>::iterator iter = m_Published.find(fid);
+
+    if (iter != m_Published.end()) {
+        iter->second->AddRef();
+        return iter->second->Data();
+    }
+
+    TIndx length(0);
+
+    if ((! GetFileSizeL(fname, length)) || (length == 0)) {
+        return 0;
+    }
+
+    auto_ptr<CRegionMap> rmap(new CRegionMap(strp, fid, 0, length));
+
+    try {
+        if (! rmap->MapMmap(this)) {
+            return 0;
+        }
+    }
+    catch(CSeqDBException &) {
+        // The caller can still use regions.
+        return 0;
+    }
+
+    rmap->AddRef();
+
+    CRegionMap * nmp = rmap.release();
+    m_Published[fid] = nmp;
+    m_PublishedLookup[nmp->Data()] = nmp;
+
+    Verify(true);
+    return nmp->Data();
+}
+
+void CSeqDBAtlas::ReleasePublishedFile(const char     * data,
+                                       CSeqDBLockHold & locked)
+{
+    Lock(locked);
+    Verify(true);
+
+    TAddressTable::iterator iter = m_PublishedLookup.find(data);
+    _ASSERT(iter != m_PublishedLookup.end());
+
+    if (iter == m_PublishedLookup.end()) {
+        return;
+    }
+
+    CRegionMap * rmap = iter->second;
+    rmap->RetRef();
+
+    if (! rmap->InUse()) {
+        if (m_RecentPublished == rmap) {
+            m_RecentPublished = 0;
+        }
+        m_Published.erase(rmap->Fid());
+        m_PublishedLookup.erase(iter);
+        delete rmap;
+    }
+    Verify(true);
+}
+
 void CSeqDBAtlas::GarbageCollect(CSeqDBLockHold & locked)
 {
     Lock(locked);
@@ -979,6 +1063,19 @@ void CSeqDBAtlas::x_RetRegionNonRecent(const char * datap)
         }
     }
 
+    // Published mappings are not reference counted per request.
+
+    iter = m_PublishedLookup.upper_bound(datap);
+
+    if (iter != m_PublishedLookup.begin()) {
+        --iter;
+
+        if ((*iter).second->InRange(datap)) {
+            m_RecentPublished = (*iter).second;
+            return;
+        }
+    }
+
     bool worked = x_Free(datap);
     _ASSERT(worked);
 
@@ -30,32 +30,130 @@
 /// @file seqdbbitset.cpp
 /// Implementation for the CSeqDB_BitSet class, a bit vector.
 #include <ncbi_pch.hpp>
-#include "seqdbbitset.hpp"
+#include <objtools/blast/seqdb_reader/impl/seqdbbitset.hpp>
+#include <util/bitset/bmserial.h>
+#include <util/checksum.hpp>
 
 BEGIN_NCBI_SCOPE
 
+/// Reverse the order of the bits of a byte.
+/// @param b The byte. [in]
+/// @return The byte with its bits in reverse order.
+static inline Uint4 s_ReverseBits(Uint4 b)
+{
+    b = ((b & 0xF0) >> 4) | ((b & 0x0F) << 4);
+    b = ((b & 0xCC) >> 2) | ((b & 0x33) << 2);
+    b = ((b & 0xAA) >> 1) | ((b & 0x55) << 1);
+    return b;
+}
+
 CSeqDB_BitSet::CSeqDB_BitSet(size_t        start,
                              size_t        end,
                              const TByte * p1,
                              const TByte * p2)
     : m_Start  (start),
       m_End    (end),
-      m_Special(eNone)
+      m_Special(eNone),
+      m_Bits   (bm::BM_GAP)
 {
-    _ASSERT(eWordShift); // must be 32 or 64
-    _ASSERT(TByte(0) < (TByte(-1))); // must be unsigned
-    
-    // Allocation is guaranteed to zero out the bit memory.
-    x_Alloc(end-start);
-    
-    size_t bytes = m_Bits.size();
+    size_t bytes = ((end - start) + eWordBits - 1) >> eWordShift;
     
     while(size_t(p2-p1) < bytes) {
         bytes--;
     }
     
-    _ASSERT((eWordBits*m_Bits.size()) >= (bytes*8));
-    memcpy(& m_Bits[0], p1, bytes);
+    // Bits past the end of the range (in the last byte) are ignored.
+    
+    size_t last = min(end, start + (bytes << eWordShift));
+    
+    if (start >= last) {
+        return;
+    }
+    
+    // The file stores the bits most significant bit first, starting
+    // at `start'; the bvector stores 32 bit words, least significant
+    // bit first, starting at OID zero.  The data is converted a byte
+    // at a time into a block of words, which is copied into the
+    // vector if any bit is set.  The loop runs over the bvector's
+    // bytes, which may straddle two file bytes if `start' is not a
+    // multiple of 8.
+    
+    const size_t kBlockBits = bm::set_block_size * 32;
+    const size_t shift = start & eWordMask;
+    
+    TBits::blocks_manager_type & bman = m_Bits.get_blocks_manager();
+    vector<bm::word_t> words(bm::set_block_size);
+    
+    for(size_t block = start / kBlockBits;
+        block * kBlockBits < last;
+        block++) {
+        
+        size_t lo = max(start, block * kBlockBits);
+        size_t hi = min(last,  (block + 1) * kBlockBits);
+        
+        fill(words.begin(), words.end(), bm::word_t(0));
+        bool found = false;
+        
+        for(size_t oid = lo & ~size_t(eWordMask); oid < hi; oid += eWordBits) {
+            // File bytes holding this byte's bits (ix may be -1).
+            
+            size_t rel = oid + eWordBits - start;
+            size_t ix = (rel >> eWordShift) - 1;
+            
+            Uint4 b = 0;
+            
+            if (shift == 0) {
+                b = p1[ix];
+            } else {
+                if (oid >= start) {
+                    b = p1[ix] << (eWordBits - shift);
+                }
+                if (ix + 1 < bytes) {
+                    b |= p1[ix + 1] >> shift;
+                }
+                b &= 0xFF;
+            }
+            
+            if (b == 0) {
+                continue;
+            }
+            
+            b = s_ReverseBits(b);
+            
+            // Clear bits outside of [lo, hi).
+            
+            if (oid < lo) {
+                b &= 0xFF << (lo - oid);
+            }
+            if (oid + eWordBits > hi) {
+                b &= 0xFF >> (oid + eWordBits - hi);
+            }
+            
+            size_t bit = oid - block * kBlockBits;
+            words[bit >> 5] |= bm::word_t(b) << (bit & 31);
+            found = (found || b);
+        }
+        
+        if (! found) {
+            continue;
+        }
+        
+        // Each block is visited once, so it is still unallocated and
+        // a (zeroed) bit block is returned.
+        
+        int block_type = 0;
+        bm::word_t * blk = bman.check_allocate_block(unsigned(block),
+                                                     false,
+                                                     bm::BM_BIT,
+                                                     & block_type,
+                                                     false);
+        _ASSERT(block_type == bm::BM_BIT);
+        
+        memcpy(blk, & words[0], bm::set_block_size * sizeof(bm::word_t));
+    }
+    
+    m_Bits.forget_count();
+    m_Bits.optimize();
 }
 
 void CSeqDB_BitSet::SetBit(size_t index)
@@ -64,13 +162,7 @@ void CSeqDB_BitSet::SetBit(size_t index)
     _ASSERT(index >= m_Start);
     _ASSERT(index < m_End);
     
-    index -= m_Start;
-    
-    size_t vx = index >> eWordShift;
-    int wx = index & eWordMask;
-    
-    _ASSERT(m_Bits.size() > vx);
-    m_Bits[vx] |= (TByte(0x80 >> wx));
+    m_Bits.set_bit(bm::id_t(index));
 }
 
 void CSeqDB_BitSet::ClearBit(size_t index)
@@ -79,13 +171,7 @@ void CSeqDB_BitSet::ClearBit(size_t index)
     _ASSERT(index >= m_Start);
     _ASSERT(index < m_End);
     
-    index -= m_Start;
-    
-    size_t vx = index >> eWordShift;
-    int wx = index & eWordMask;
-    
-    _ASSERT(m_Bits.size() > vx);
-    m_Bits[vx] &= ~(TByte(0x80 >> wx));
+    m_Bits.clear_bit(bm::id_t(index));
 }
 
 bool CSeqDB_BitSet::CheckOrFindBit(size_t & index) const
@@ -104,36 +190,16 @@ bool CSeqDB_BitSet::CheckOrFindBit(size_t & index) const
         return false;
     }
     
-    size_t nwords = m_Bits.size();
-    size_t ix = index - m_Start;
-    size_t vx = ix >> eWordShift;
-    size_t vx0 = vx;
-    
-    while(vx < nwords && ! m_Bits[vx]) {
-        vx ++;
-    }
-    
-    if (vx != vx0) {
-        ix = (vx << eWordShift);
+    if (m_Bits.test(bm::id_t(index))) {
+        return true;
     }
     
-    _ASSERT((ix + m_Start) >= index);
-    
-    size_t bitcount = m_End - m_Start;
+    // get_next() returns zero if there are no more bits.
     
-    while(ix < bitcount) {
-        vx = ix >> eWordShift;
-        int wx = ix & eWordMask;
-        
-        _ASSERT(nwords > vx);
-        if (m_Bits[vx] & (TByte(0x80) >> wx))
-            break;
-        
-        ix ++;
-    }
+    size_t next = m_Bits.get_next(bm::id_t(index));
     
-    if (ix < bitcount) {
-        index = (ix + m_Start);
+    if (next > index && next < m_End) {
+        index = next;
         return true;
     }
     
@@ -183,7 +249,7 @@ void CSeqDB_BitSet::UnionWith(CSeqDB_BitSet & other, bool consume)
         break;
         
     case eNone:
-        x_CopyBits(other);
+        m_Bits |= other.m_Bits;
         break;
         
     case eAllClear:
@@ -243,92 +309,35 @@ void CSeqDB_BitSet::IntersectWith(CSeqDB_BitSet & other, bool consume)
         return;
     }
     
-    if ((m_Start         == other.m_Start) &&
-        (m_Bits.size()   == other.m_Bits.size()) &&
-        (m_Special       == eNone) &&
-        (other.m_Special == eNone)) {
-        
-        size_t i = 0;
-        size_t end1 = (m_Bits.size() / sizeof(int)) * sizeof(int);
-        size_t end2 = m_Bits.size();
-        
-        // [ The first while() is only needed in the case of unaligned
-        // large-character-array allocation, which probably never
-        // happens in practice. ]
-        
-        while(i != end2 && (i & (sizeof(int)-1))) {
-            unsigned char * dst = & m_Bits[i];
-            unsigned char * src = & other.m_Bits[i];
-            
-            *dst &= *src;
-            i ++;
-        }
-        
-        while(i != end1) {
-            int * dst = (int*)(& m_Bits[i]);
-            int * src = (int*)(& other.m_Bits[i]);
-            
-            *dst &= *src;
-            i += sizeof(int);
-        }
-        
-        while(i != end2) {
-            unsigned char * dst = & m_Bits[i];
-            unsigned char * src = & other.m_Bits[i];
-            
-            *dst &= *src;
-            i ++;
-        }
-        return;
-    }
-    
-    // Intersection between unaligned or differently size bit sets.
-    // Some of these cases could be split off but this is currently
-    // not likely to happen in production code.
+    // Both are normal; since bits are indexed by OID, the ranges
+    // need not be aligned.
     
-    for(size_t i=0; CheckOrFindBit(i); i++) {
-        if (! other.CheckOrFindBit(i)) {
-            ClearBit(i);
-        }
-    }
-}
-
-void CSeqDB_BitSet::x_CopyBits(const CSeqDB_BitSet & src, size_t start, size_t end)
-{
-    for(size_t i = start; src.CheckOrFindBit(i) && i < end; i++) {
-        SetBit(i);
-    }
-}
-
-void CSeqDB_BitSet::x_CopyBits(const CSeqDB_BitSet & src)
-{
-    for(size_t i=0; src.CheckOrFindBit(i); i++) {
-        SetBit(i);
-    }
+    m_Bits &= other.m_Bits;
 }
 
 void CSeqDB_BitSet::x_Normalize(size_t start, size_t end)
 {
-    // Note: the "range change" paths are unlikely to be active for
-    // SeqDB, and could be improved (i.e. this is not the efficient
-    // way to move a range of bits).
-    
     if (m_Start > start || m_End < end || m_Special != eNone) {
-        CSeqDB_BitSet dup(std::min(m_Start, start),
-                          std::max(m_End,   end));
+        size_t       old_start = m_Start;
+        size_t       old_end   = m_End;
+        ESpecialCase special   = m_Special;
         
-        Swap(dup);
+        m_Start   = std::min(m_Start, start);
+        m_End     = std::max(m_End,   end);
+        m_Special = eNone;
         
-        switch(m_Special) {
+        switch(special) {
         case eAllClear:
+            m_Bits.clear(true);
             break;
             
         case eAllSet:
-            AssignBitRange(m_Start, m_End, true);
+            m_Bits.clear(true);
+            AssignBitRange(old_start, old_end, true);
             break;
             
         case eNone:
-            x_CopyBits(dup);
+            // Bits are indexed by OID, so nothing moves.
             break;
         }
     }
@@ -355,13 +364,7 @@ bool CSeqDB_BitSet::GetBit(size_t index) const
     _ASSERT(index >= m_Start);
     _ASSERT(index < m_End);
     
-    index -= m_Start;
-    
-    size_t vx = index >> eWordShift;
-    int wx = index & eWordMask;
-    
-    _ASSERT(m_Bits.size() > vx);
-    return !! (m_Bits[vx] & (TByte(0x80) >> wx));
+    return m_Bits.test(bm::id_t(index));
 }
 
 void CSeqDB_BitSet::Swap(CSeqDB_BitSet & other)
@@ -375,34 +378,10 @@ void CSeqDB_BitSet::Swap(CSeqDB_BitSet & other)
 void CSeqDB_BitSet::AssignBitRange(size_t start, size_t end, bool value)
 {
     _ASSERT(start >= m_Start && end <= m_End);
+    _ASSERT(m_Special == eNone);
     
-    if ((start + eWordBits*3) > end) {
-        for(size_t i = start; i < end; i++) {
-            AssignBit(i, value);
-        }
-        return;
-    } else {
-        size_t i = start - m_Start;
-        size_t e = end - m_Start;
-        
-        while(i & eWordMask) {
-            AssignBit(i + m_Start, value);
-            i++;
-        }
-        
-        size_t vx = i >> eWordShift,
-            evx = e >> eWordShift;
-        
-        char mask = value ? 0xFF : 0;
-        
-        memset(& m_Bits[vx], mask, evx-vx);
-        
-        i = vx << eWordShift;
-        
-        while(i < e) {
-            AssignBit(i + m_Start, value);
-            i++;
-        }
+    if (start < end) {
+        m_Bits.set_range(bm::id_t(start), bm::id_t(end - 1), value);
     }
 }
 
@@ -422,5 +401,105 @@ void CSeqDB_BitSet::Normalize()
     }
 }
 
+/// Header of a serialized bitset.
+struct SSeqDB_BitSetHeader {
+    /// Identifies the format.
+    Uint4 magic;
+    
+    /// The special case.
+    Uint4 special;
+    
+    /// First OID of the range.
+    Uint8 start;
+    
+    /// OID after the end of the range.
+    Uint8 end;
+    
+    /// Length of the serialized bits following the header.
+    Uint8 size;
+    
+    /// CRC32 of the serialized bits.
+    Uint4 checksum;
+    
+    /// Unused, zero.
+    Uint4 reserved;
+};
+
+/// Value of SSeqDB_BitSetHeader::magic.
+static const Uint4 kBitSetMagic = 0x53444232; // "SDB2"
+
+/// Compute the checksum of serialized bits.
+/// @param data Start of the serialized bits. [in]
+/// @param size Length of the serialized bits. [in]
+/// @return The CRC32 of the data.
+static Uint4 s_BitSetChecksum(const char * data, size_t size)
+{
+    CChecksum crc(CChecksum::eCRC32);
+    crc.AddChars(data, size);
+    return crc.GetChecksum();
+}
+
+void CSeqDB_BitSet::Serialize(string & data) const
+{
+    SSeqDB_BitSetHeader hdr;
+    memset(& hdr, 0, sizeof(hdr));
+    hdr.magic   = kBitSetMagic;
+    hdr.special = m_Special;
+    hdr.start   = m_Start;
+    hdr.end     = m_End;
+    
+    TBits bits(m_Bits);
+    bits.optimize();
+    
+    TBits::statistics st;
+    bits.calc_stat(& st);
+    
+    data.resize(sizeof(hdr) + st.max_serialize_mem);
+    
+    size_t size =
+        bm::serialize(bits, (unsigned char*) & data[sizeof(hdr)]);
+    
+    data.resize(sizeof(hdr) + size);
+    
+    hdr.size     = size;
+    hdr.checksum = s_BitSetChecksum(& data[sizeof(hdr)], size);
+    memcpy(& data[0], & hdr, sizeof(hdr));
+}
+
+bool CSeqDB_BitSet::Deserialize(const string & data)
+{
+    SSeqDB_BitSetHeader hdr;
+    
+    if (data.size() <= sizeof(hdr)) {
+        return false;
+    }
+    
+    memcpy(& hdr, data.data(), sizeof(hdr));
+    
+    if (hdr.magic != kBitSetMagic || hdr.special > eAllClear ||
+        hdr.start > hdr.end) {
+        return false;
+    }
+    
+    // BitMagic does not check its input, so truncated or damaged
+    // data is rejected here.
+    
+    if (hdr.size != data.size() - sizeof(hdr) ||
+        hdr.checksum != s_BitSetChecksum(data.data() + sizeof(hdr),
+                                         data.size() - sizeof(hdr))) {
+        return false;
+    }
+    
+    TBits bits(bm::BM_GAP);
+    bm::deserialize(bits, (const unsigned char*) data.data() + sizeof(hdr));
+    
+    m_Start   = size_t(hdr.start);
+    m_End     = size_t(hdr.end);
+    m_Special = ESpecialCase(hdr.special);
+    m_Bits.swap(bits);
+    
+    return true;
+}
+
 END_NCBI_SCOPE
 
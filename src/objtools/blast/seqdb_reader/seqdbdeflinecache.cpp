@@ -0,0 +1,106 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+
+/// @file seqdbdeflinecache.cpp
+/// Implementation for the CSeqDBDeflineCache class, a cache of
+/// decoded deflines.
+
+#include <ncbi_pch.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbdeflinecache.hpp>
+
+BEGIN_NCBI_SCOPE
+
+/// Decoded deflines take several times the space of the binary
+/// ASN.1 data; this factor (and a fixed cost per entry) is used to
+/// estimate it.
+static const size_t kDecodedSizeFactor = 4;
+
+/// Fixed cost of an entry, in bytes.
+static const size_t kEntryOverhead = 128;
+
+CSeqDBDeflineCache::CSeqDBDeflineCache(size_t max_bytes)
+    : m_MaxShardBytes(max_bytes / eShards)
+{
+}
+
+CSeqDBDeflineCache::TDeflines CSeqDBDeflineCache::Find(int oid)
+{
+    SShard & shard = m_Shards[oid & (eShards - 1)];
+    
+    CFastMutexGuard guard(shard.lock);
+    
+    TIndex::iterator iter = shard.index.find(oid);
+    
+    if (iter == shard.index.end()) {
+        return TDeflines();
+    }
+    
+    // Move the entry to the front.
+    
+    shard.lru.splice(shard.lru.begin(), shard.lru, iter->second);
+    
+    return iter->second->deflines;
+}
+
+void CSeqDBDeflineCache::Add(int oid, TDeflines deflines, size_t asn1_size)
+{
+    size_t bytes = asn1_size * kDecodedSizeFactor + kEntryOverhead;
+    
+    if (deflines.Empty() || bytes > m_MaxShardBytes) {
+        return;
+    }
+    
+    SShard & shard = m_Shards[oid & (eShards - 1)];
+    
+    CFastMutexGuard guard(shard.lock);
+    
+    if (shard.index.find(oid) != shard.index.end()) {
+        // Another thread added it first.
+        return;
+    }
+    
+    while(shard.bytes + bytes > m_MaxShardBytes) {
+        SEntry & last = shard.lru.back();
+        
+        shard.bytes -= last.bytes;
+        shard.index.erase(last.oid);
+        shard.lru.pop_back();
+    }
+    
+    SEntry entry;
+    entry.oid      = oid;
+    entry.deflines = deflines;
+    entry.bytes    = bytes;
+    
+    shard.lru.push_front(entry);
+    shard.index[oid] = shard.lru.begin();
+    shard.bytes += bytes;
+}
+
+END_NCBI_SCOPE
+
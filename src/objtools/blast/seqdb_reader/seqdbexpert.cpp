@@ -71,6 +71,39 @@ void CSeqDBExpert::GetRawSeqAndAmbig(int           oid,
     m_Impl->Verify();
 }
 
+void CSeqDBExpert::GetSeqView(int oid, CSeqDBSeqView & view) const
+{
+    view.Release();
+
+    const char * buffer = 0;
+    int seq_length = 0;
+    int amb_length = 0;
+
+    GetRawSeqAndAmbig(oid, & buffer, & seq_length, & amb_length);
+
+    view.m_SeqDB.Reset(this);
+    view.m_OID = oid;
+    view.m_Data = buffer;
+    view.m_IsProtein = (GetSequenceType() == CSeqDB::eProtein);
+
+    if (view.m_IsProtein) {
+        view.m_Length = seq_length;
+    } else {
+        // The last byte holds the number of bases in the last but one
+        // byte in its low two bits.
+        int whole_bytes = seq_length - 1;
+        view.m_Length = whole_bytes * 4 + (buffer[whole_bytes] & 3);
+
+        try {
+            view.x_SetAmbiguities(buffer + seq_length, amb_length);
+        }
+        catch(...) {
+            view.Release();
+            throw;
+        }
+    }
+}
+
 void CSeqDBExpert::GetGiBounds(TGi * low_id,
                                TGi * high_id,
                                int * count)
@@ -119,5 +152,29 @@ void CSeqDBExpert::HashToOids(unsigned hash, vector<int> & oids)
     m_Impl->Verify();
 }
 
-END_NCBI_SCOPE
+CSeqDBSeqView::CSeqDBSeqView()
+    : m_OID(-1),
+      m_Data(0),
+      m_Length(0),
+      m_IsProtein(false)
+{
+}
 
+CSeqDBSeqView::~CSeqDBSeqView()
+{
+    Release();
+}
+
+void CSeqDBSeqView::Release()
+{
+    if (m_Data) {
+        m_SeqDB->RetSequence(& m_Data);
+    }
+    m_SeqDB.Reset();
+    m_OID = -1;
+    m_Data = 0;
+    m_Length = 0;
+    m_Ambig.clear();
+}
+
+END_NCBI_SCOPE
@@ -133,7 +133,8 @@ CSeqDBExtFile::CSeqDBExtFile(CSeqDBAtlas    & atlas,
     : m_Atlas   (atlas),
       m_Lease   (atlas),
       m_FileName(dbfilename),
-      m_File    (atlas)
+      m_File    (atlas),
+      m_Published(0)
 {
     if ((prot_nucl != 'p') && (prot_nucl != 'n')) {
         NCBI_THROW(CSeqDBException,
@@ -152,6 +153,14 @@ CSeqDBExtFile::CSeqDBExtFile(CSeqDBAtlas    & atlas,
     }
 }
 
+CSeqDBExtFile::~CSeqDBExtFile()
+{
+    if (m_Published) {
+        CSeqDBLockHold locked(m_Atlas);
+        m_Atlas.ReleasePublishedFile(m_Published, locked);
+    }
+}
+
 CSeqDBIdxFile::CSeqDBIdxFile(CSeqDBAtlas    & atlas,
                              const string   & dbname,
                              char             prot_nucl,
@@ -242,6 +251,8 @@ CSeqDBIdxFile::CSeqDBIdxFile(CSeqDBAtlas    & atlas,
     } else {
         m_OffAmb = m_EndAmb = 0;
     }
+
+    x_Publish(locked);
 }
 
 END_NCBI_SCOPE
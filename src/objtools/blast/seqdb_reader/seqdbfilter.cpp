@@ -31,7 +31,7 @@
 /// Implementation for some assorted ID list filtering code.
 #include <ncbi_pch.hpp>
 #include "seqdbfilter.hpp"
-#include "seqdbbitset.hpp"
+#include <objtools/blast/seqdb_reader/impl/seqdbbitset.hpp>
 
 BEGIN_NCBI_SCOPE
 
@@ -60,6 +60,8 @@ CSeqDBImpl::CSeqDBImpl(const string       & db_name_list,
       m_RestrictBegin   (oid_begin),
       m_RestrictEnd     (oid_end),
       m_NextChunkOID    (0),
+      m_Readahead       (false),
+      m_ReadaheadOid    (0),
       m_NumSeqs         (0),
       m_NumSeqsStats    (0),
       m_NumOIDs         (0),
@@ -77,7 +79,8 @@ CSeqDBImpl::CSeqDBImpl(const string       & db_name_list,
       m_NeedTotalsScan  (false),
       m_UseGiMask       (m_Aliases.HasGiMask()),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_LockFreeSeqs    (false)
 {
     INIT_CLASS_MARK();
 
@@ -169,6 +172,8 @@ CSeqDBImpl::CSeqDBImpl()
       m_RestrictBegin   (0),
       m_RestrictEnd     (0),
       m_NextChunkOID    (0),
+      m_Readahead       (false),
+      m_ReadaheadOid    (0),
       m_NumSeqs         (0),
       m_NumOIDs         (0),
       m_TotalLength     (0),
@@ -179,7 +184,8 @@ CSeqDBImpl::CSeqDBImpl()
       m_NeedTotalsScan  (false),
       m_UseGiMask       (false),
       m_MaskDataColumn  (kUnknownTitle),
-      m_NumThreads      (0)
+      m_NumThreads      (0),
+      m_LockFreeSeqs    (false)
 {
     INIT_CLASS_MARK();
 
@@ -225,6 +231,10 @@ CSeqDBImpl::~CSeqDBImpl()
 
     SetNumberOfThreads(0);
 
+    // Stop reading ahead before the volumes go away.
+
+    m_Prefetcher.Reset();
+
     CSeqDBLockHold locked(m_Atlas);
     m_Atlas.Lock(locked);
 
@@ -261,6 +271,30 @@ void CSeqDBImpl::x_GetOidList(CSeqDBLockHold & locked)
     }
 }
 
+void CSeqDBImpl::SetTaxIdFilter(const set<TTaxId> & taxids)
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+
+    if (! m_OidListSetup) {
+        x_GetOidList(locked);
+    }
+
+    // Unfiltered databases have no OID list yet.
+
+    if (m_OIDList.Empty()) {
+        m_OIDList.Reset( new CSeqDBOIDList(m_Atlas,
+                                           m_VolSet,
+                                           *m_Aliases.GetFilterTree(),
+                                           m_UserGiList,
+                                           m_NegativeList,
+                                           locked) );
+    }
+
+    m_OIDList->ApplyTaxIdFilter(m_VolSet, taxids, locked);
+}
+
 bool CSeqDBImpl::CheckOrFindOID(int & next_oid)
 {
     CHECK_MARKER();
@@ -349,6 +383,10 @@ CSeqDBImpl::GetNextOIDChunk(int         & begin_chunk, // out
         x_GetOidList(locked);
     }
 
+    if (m_Readahead) {
+        x_Readahead(begin_chunk, end_chunk, locked);
+    }
+
     // Case 2: Return a range
 
     if (m_OIDList.Empty()) {
@@ -396,22 +434,164 @@ CSeqDBImpl::GetNextOIDChunk(int         & begin_chunk, // out
 void CSeqDBImpl::ResetInternalChunkBookmark()
 {
     CHECK_MARKER();
-    CFastMutexGuard guard(m_OIDLock);
-    m_NextChunkOID = 0;
+
+    {
+        CFastMutexGuard guard(m_OIDLock);
+        m_NextChunkOID = 0;
+    }
+
+    // The readahead position is only used under the atlas lock.
+
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+    m_ReadaheadOid = 0;
+}
+
+void CSeqDBImpl::Prefetch(int begin_oid, int end_oid)
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    x_Prefetch(begin_oid, end_oid, locked);
+}
+
+void CSeqDBImpl::SetSequentialReadahead(bool enable)
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+    m_Readahead = enable;
+}
+
+SSeqDBPrefetchStats CSeqDBImpl::GetPrefetchStats() const
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+
+    if (m_Prefetcher.Empty()) {
+        return SSeqDBPrefetchStats();
+    }
+    return m_Prefetcher->GetStats();
+}
+
+void CSeqDBImpl::x_Prefetch(int              begin_oid,
+                            int              end_oid,
+                            CSeqDBLockHold & locked) const
+{
+    m_Atlas.Lock(locked);
+
+    begin_oid = max(begin_oid, m_RestrictBegin);
+    end_oid   = min(end_oid,   m_RestrictEnd);
+
+    if (begin_oid >= end_oid) {
+        return;
+    }
+
+    if (m_Prefetcher.Empty()) {
+        m_Prefetcher.Reset(new CSeqDBPrefetcher);
+    }
+
+    for(int vol_idx = 0; vol_idx < m_VolSet.GetNumVols(); vol_idx++) {
+        int vol_start = m_VolSet.GetVolOIDStart(vol_idx);
+        const CSeqDBVol * vol = m_VolSet.GetVol(vol_idx);
+        int vol_end = vol_start + vol->GetNumOIDs();
+
+        if (vol_end <= begin_oid) {
+            continue;
+        }
+        if (vol_start >= end_oid) {
+            break;
+        }
+
+        vol->Prefetch(max(begin_oid, vol_start) - vol_start,
+                      min(end_oid, vol_end) - vol_start,
+                      *m_Prefetcher,
+                      locked);
+    }
+}
+
+void CSeqDBImpl::x_Readahead(int              begin_chunk,
+                             int              end_chunk,
+                             CSeqDBLockHold & locked)
+{
+    // Small chunks are read ahead in larger windows, so that each
+    // chunk does not become a request of its own.  A new window is
+    // requested when less than one window is left ahead.
+
+    const int kMinReadaheadOids = 1024;
+
+    int window = max(end_chunk - begin_chunk, kMinReadaheadOids);
+
+    if (m_ReadaheadOid < end_chunk) {
+        m_ReadaheadOid = end_chunk;
+    }
+
+    if (m_ReadaheadOid - end_chunk >= window ||
+        m_ReadaheadOid >= m_RestrictEnd) {
+        return;
+    }
+
+    int begin_oid = m_ReadaheadOid;
+    m_ReadaheadOid = min(end_chunk + 2 * window, m_RestrictEnd);
+
+    if (m_OIDList.Empty()) {
+        x_Prefetch(begin_oid, m_ReadaheadOid, locked);
+        return;
+    }
+
+    // With an OID mask, only runs of included OIDs are read.  Runs
+    // separated by a few excluded OIDs are read as one, which costs
+    // less than a request per run.
+
+    const int kMaxReadaheadGap = 16;
+
+    int oid = begin_oid;
+
+    while (oid < m_ReadaheadOid) {
+        if (! m_OIDList->CheckOrFindOID(oid) || oid >= m_ReadaheadOid) {
+            break;
+        }
+
+        int run_begin = oid;
+        int run_end = oid + 1;
+
+        while (run_end < m_ReadaheadOid) {
+            int next = run_end;
+
+            if (! m_OIDList->CheckOrFindOID(next) ||
+                next >= m_ReadaheadOid ||
+                next - run_end > kMaxReadaheadGap) {
+                oid = next;
+                break;
+            }
+            run_end = next + 1;
+        }
+
+        x_Prefetch(run_begin, run_end, locked);
+
+        if (run_end >= m_ReadaheadOid) {
+            break;
+        }
+    }
 }
 
 int CSeqDBImpl::GetSeqLength(int oid) const
 {
     CHECK_MARKER();
     CSeqDBLockHold locked(m_Atlas);
-    m_Atlas.MentionOid(oid, m_NumOIDs, locked);
+
+    if (! m_LockFreeSeqs) {
+        m_Atlas.MentionOid(oid, m_NumOIDs, locked);
+    }
 
     return x_GetSeqLength(oid, locked);
 }
 
 int CSeqDBImpl::x_GetSeqLength(int oid, CSeqDBLockHold & locked) const
 {
-    m_Atlas.Lock(locked);
+    if (! m_LockFreeSeqs) {
+        m_Atlas.Lock(locked);
+    }
 
     int vol_oid = 0;
 
@@ -461,7 +641,7 @@ void CSeqDBImpl::GetTaxIDs(int             oid,
         gi_to_taxid.clear();
     }
 
-    CRef<CBlast_def_line_set> defline_set =
+    CConstRef<CBlast_def_line_set> defline_set =
         x_GetHdr(oid, locked);
 
     if ((! defline_set.Empty()) && defline_set->CanGet()) {
@@ -496,7 +676,7 @@ void CSeqDBImpl::GetTaxIDs(int           oid,
         taxids.clear();
     }
 
-    CRef<CBlast_def_line_set> defline_set =
+    CConstRef<CBlast_def_line_set> defline_set =
         x_GetHdr(oid, locked);
 
     if ((! defline_set.Empty()) && defline_set->CanGet()) {
@@ -524,7 +704,7 @@ void CSeqDBImpl::GetLeafTaxIDs(
         gi_to_taxid_set.clear();
     }
 
-    CRef<CBlast_def_line_set> defline_set =
+    CConstRef<CBlast_def_line_set> defline_set =
         x_GetHdr(oid, locked);
 
     if ((! defline_set.Empty()) && defline_set->CanGet()) {
@@ -561,7 +741,7 @@ void CSeqDBImpl::GetLeafTaxIDs(
         taxids.clear();
     }
 
-    CRef<CBlast_def_line_set> defline_set = x_GetHdr(oid, locked);
+    CConstRef<CBlast_def_line_set> defline_set = x_GetHdr(oid, locked);
 
     if ((! defline_set.Empty())  &&  defline_set->CanGet()) {
         ITERATE(
@@ -596,6 +776,15 @@ CSeqDBImpl::GetBioseq(int oid, TGi target_gi, const CSeq_id * target_seq_id, boo
     CHECK_MARKER();
 
     CSeqDBLockHold locked(m_Atlas);
+
+    // Use (and fill) the defline cache, if enabled.
+
+    CConstRef<CBlast_def_line_set> deflines;
+
+    if (x_GetDeflineCache().NotEmpty()) {
+        deflines = x_GetHdr(oid, locked);
+    }
+
     m_Atlas.Lock(locked);
     m_Atlas.MentionOid(oid, m_NumOIDs, locked);
 
@@ -611,6 +800,7 @@ CSeqDBImpl::GetBioseq(int oid, TGi target_gi, const CSeq_id * target_seq_id, boo
                               target_seq_id,
                               m_TaxInfo,
                               seqdata,
+                              deflines,
                               locked);
     }
 
@@ -659,10 +849,14 @@ void CSeqDBImpl::x_RetSeqBuffer(SSeqResBuffer * buffer,
 
     buffer->checked_out = 0;
 
-    m_Atlas.Lock(locked);
+    // Published sequence data holds no references.
+
+    if (! m_LockFreeSeqs) {
+        m_Atlas.Lock(locked);
 
-    for(Uint4 index = 0; index < buffer->results.size(); ++index) {
-        m_Atlas.RetRegion(buffer->results[index].address);
+        for(Uint4 index = 0; index < buffer->results.size(); ++index) {
+            m_Atlas.RetRegion(buffer->results[index].address);
+        }
     }
 
     buffer->results.clear();
@@ -681,7 +875,9 @@ int CSeqDBImpl::x_GetSeqBuffer(SSeqResBuffer * buffer, int oid,
 
     // Not in cache, fill the cache
     CSeqDBLockHold locked(m_Atlas);
-    m_Atlas.Lock(locked);
+    if (! m_LockFreeSeqs) {
+        m_Atlas.Lock(locked);
+    }
     x_FillSeqBuffer(buffer, oid, locked);
     (buffer->checked_out)++;
     *seq = buffer->results[0].address;
@@ -692,8 +888,10 @@ void CSeqDBImpl::x_FillSeqBuffer(SSeqResBuffer  *buffer,
                                  int             oid,
                                  CSeqDBLockHold &locked) const
 {
-    // Must lock the atlas
-    m_Atlas.Lock(locked);
+    // Must lock the atlas, unless all volumes are published
+    if (! m_LockFreeSeqs) {
+        m_Atlas.Lock(locked);
+    }
 
     // clear the buffer first
     x_RetSeqBuffer(buffer, locked);
@@ -717,7 +915,7 @@ void CSeqDBImpl::x_FillSeqBuffer(SSeqResBuffer  *buffer,
             res.length = vol->GetSequence(vol_oid++, &seq, locked);
         } while (res.length >= 0 && tot_length >= res.length);
 
-        if (res.length >= 0)  m_Atlas.RetRegion(seq);
+        if (res.length >= 0 && ! m_LockFreeSeqs)  m_Atlas.RetRegion(seq);
         return;
     }
 
@@ -1037,18 +1235,109 @@ string CSeqDBImpl::GetDate() const
     return date;
 }
 
+/// Copy deflines shared through the defline cache.
+///
+/// @param hdr The cached deflines. [in]
+/// @return A copy the caller may modify.
+static CRef<CBlast_def_line_set> s_CopyHdr(const CBlast_def_line_set & hdr)
+{
+    CRef<CBlast_def_line_set> copy(new CBlast_def_line_set);
+    copy->Assign(hdr);
+    return copy;
+}
+
 CRef<CBlast_def_line_set> CSeqDBImpl::GetHdr(int oid)
 {
     CHECK_MARKER();
     CSeqDBLockHold locked(m_Atlas);
 
-    return x_GetHdr(oid, locked);
+    bool shared = false;
+    CConstRef<CBlast_def_line_set> hdr = x_GetHdr(oid, locked, & shared);
+
+    if (shared) {
+        return s_CopyHdr(*hdr);
+    }
+
+    // Not cached by this object; the volume's own cache has always been
+    // shared with the caller, as documented for CSeqDB::GetHdr().
+
+    return CRef<CBlast_def_line_set>
+        (const_cast<CBlast_def_line_set*>(hdr.GetPointerOrNull()));
 }
 
 CRef<CBlast_def_line_set>
-CSeqDBImpl::x_GetHdr(int oid, CSeqDBLockHold & locked)
+CSeqDBImpl::GetPartialHdr(int oid, TSeqDBDeflineFields fields)
+{
+    CHECK_MARKER();
+
+    CRef<CSeqDBDeflineCache> cache = x_GetDeflineCache();
+
+    if (cache.NotEmpty()) {
+        CConstRef<CBlast_def_line_set> hdr = cache->Find(oid);
+        if (hdr.NotEmpty()) {
+            return s_CopyHdr(*hdr);
+        }
+    }
+
+    CSeqDBLockHold locked(m_Atlas);
+    m_Atlas.Lock(locked);
+    m_Atlas.MentionOid(oid, m_NumOIDs, locked);
+
+    if (! m_OidListSetup) {
+        x_GetOidList(locked);
+    }
+
+    int vol_oid = 0;
+
+    if (const CSeqDBVol * vol = m_VolSet.FindVol(oid, vol_oid)) {
+        return vol->GetPartialHeader(vol_oid, fields, locked);
+    }
+
+    NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
+}
+
+void CSeqDBImpl::SetDeflineCacheSize(size_t bytes)
+{
+    CHECK_MARKER();
+
+    CRef<CSeqDBDeflineCache> cache;
+
+    if (bytes) {
+        cache.Reset(new CSeqDBDeflineCache(bytes));
+    }
+
+    // Threads still using the old cache keep their own reference.
+
+    CFastMutexGuard guard(m_DeflineCacheLock);
+    m_DeflineCache.Swap(cache);
+}
+
+CRef<CSeqDBDeflineCache> CSeqDBImpl::x_GetDeflineCache() const
+{
+    CFastMutexGuard guard(m_DeflineCacheLock);
+    return m_DeflineCache;
+}
+
+CConstRef<CBlast_def_line_set>
+CSeqDBImpl::x_GetHdr(int oid, CSeqDBLockHold & locked, bool * shared)
 {
     CHECK_MARKER();
+
+    // The defline cache has its own locks; hits do not need the atlas.
+
+    CRef<CSeqDBDeflineCache> cache = x_GetDeflineCache();
+
+    if (shared) {
+        *shared = cache.NotEmpty();
+    }
+
+    if (cache.NotEmpty()) {
+        CConstRef<CBlast_def_line_set> hdr = cache->Find(oid);
+        if (hdr.NotEmpty()) {
+            return hdr;
+        }
+    }
+
     m_Atlas.Lock(locked);
     m_Atlas.MentionOid(oid, m_NumOIDs, locked);
 
@@ -1059,7 +1348,14 @@ CSeqDBImpl::x_GetHdr(int oid, CSeqDBLockHold & locked)
     int vol_oid = 0;
 
     if (const CSeqDBVol * vol = m_VolSet.FindVol(oid, vol_oid)) {
-        return vol->GetFilteredHeader(vol_oid, locked);
+        CRef<CBlast_def_line_set> hdr =
+            vol->GetFilteredHeader(vol_oid, locked);
+
+        if (cache.NotEmpty() && hdr.NotEmpty()) {
+            cache->Add(oid, hdr, vol->GetHdrLength(vol_oid));
+        }
+
+        return hdr;
     }
 
     NCBI_THROW(CSeqDBException, eArgErr, CSeqDB::kOidNotFound);
@@ -1242,6 +1538,13 @@ void CSeqDBImpl::AccessionToOids(const string & acc,
         x_GetOidList(locked);
     }
 
+    x_AccessionToOids(acc, oids, locked);
+}
+
+void CSeqDBImpl::x_AccessionToOids(const string   & acc,
+                                   vector<int>    & oids,
+                                   CSeqDBLockHold & locked)
+{
     oids.clear();
 
     vector<int> vol_oids;
@@ -1279,6 +1582,203 @@ void CSeqDBImpl::AccessionToOids(const string & acc,
     }
 }
 
+void CSeqDBImpl::AccessionsToOids(const vector<string> & accs,
+                                  vector<int>          & oids)
+{
+    CHECK_MARKER();
+    CSeqDBLockHold locked(m_Atlas);
+
+    if (! m_OidListSetup) {
+        x_GetOidList(locked);
+    }
+
+    oids.assign(accs.size(), -1);
+
+    // Numeric GIs are translated together, with one merge pass over
+    // the GI index of each volume.  String ids are translated the same
+    // way against the string index of each volume, trying the key
+    // forms in the order used by CSeqDBIsam::StringToOids().  The
+    // remaining ids (not found in these passes, filtered out, or of
+    // another type) are looked up one by one, in sorted order so that
+    // the ISAM pages are visited in file order.
+
+    typedef vector< pair<TGi, size_t> >    TGiIds;
+    typedef vector< pair<string, size_t> > TStrIds;
+
+    CRef<CSeqDBGiList> gis(new CSeqDBGiList);
+    TGiIds  gi_ids;
+    TStrIds str_ids;
+    TStrIds other_ids;
+
+    // Whether each string id was adjusted by SeqDB_SimplifyAccession.
+    vector<bool> adjusted;
+
+    for(size_t i = 0; i < accs.size(); i++) {
+        Int8   ident   (-1);
+        string str_id;
+        bool   simpler (false);
+
+        ESeqDBIdType id_type =
+            SeqDB_SimplifyAccession(accs[i], ident, str_id, simpler);
+
+        if (id_type == eGiId) {
+            TGi gi = GI_FROM(Int8, ident);
+            gis->AddGi(gi);
+            gi_ids.push_back(make_pair(gi, i));
+        } else if (id_type == eStringId) {
+            str_ids.push_back(make_pair(NStr::ToLower(str_id), i));
+            adjusted.push_back(simpler);
+        } else {
+            other_ids.push_back(make_pair(NStr::ToLower(str_id), i));
+        }
+    }
+
+    if (! gi_ids.empty()) {
+        bool translated = true;
+
+        try {
+            for(int vol_idx = 0; vol_idx < m_VolSet.GetNumVols(); vol_idx++) {
+                m_VolSet.GetVol(vol_idx)->IdsToOids(*gis, locked);
+            }
+        }
+        catch(const CSeqDBException &) {
+            // Some volume has no GI index; use the general lookup.
+            translated = false;
+        }
+
+        ITERATE(TGiIds, iter, gi_ids) {
+            int oid1 = -1;
+
+            if (translated) {
+                gis->GiToOid(iter->first, oid1);
+            }
+
+            int oid2 = oid1;
+
+            if (oid1 >= 0 && x_CheckOrFindOID(oid2, locked) && oid1 == oid2) {
+                oids[iter->second] = oid1;
+            } else {
+                // Not translated, not found as a GI (a numeric string
+                // may also be a PDB or other string id), or filtered
+                // out in the volume found first.
+                other_ids.push_back(make_pair(accs[iter->second],
+                                              iter->second));
+            }
+        }
+    }
+
+    if (! str_ids.empty()) {
+        x_StringIdsToOids(str_ids, adjusted, oids, other_ids, locked);
+    }
+
+    sort(other_ids.begin(), other_ids.end());
+
+    vector<int> acc_oids;
+
+    ITERATE(TStrIds, iter, other_ids) {
+        x_AccessionToOids(accs[iter->second], acc_oids, locked);
+
+        if (! acc_oids.empty()) {
+            oids[iter->second] = acc_oids.front();
+        }
+    }
+}
+
+void CSeqDBImpl::x_StringIdsToOids(const vector< pair<string, size_t> > & ids,
+                                   const vector<bool>                   & adjusted,
+                                   vector<int>                          & oids,
+                                   vector< pair<string, size_t> >       & rest,
+                                   CSeqDBLockHold                       & locked)
+{
+    // Each volume is searched for each key form in turn.  Within a
+    // volume the first form found wins, and the first volume with a
+    // match wins, as in AccessionToOids().  An id whose first match
+    // is filtered out of the database is left to the general lookup,
+    // which also tries the versionless and Seq-id forms of the id;
+    // these forms are therefore only tried for ids that are not found
+    // in any volume.
+
+    static const int kNumForms = 3;
+
+    vector<bool> done(ids.size(), false);
+    size_t num_done = 0;
+
+    for(int vol_idx = 0; vol_idx < m_VolSet.GetNumVols(); vol_idx++) {
+        for(int form = 0; form < kNumForms; form++) {
+            if (num_done == ids.size()) {
+                break;
+            }
+
+            CRef<CSeqDBGiList> sis(new CSeqDBGiList);
+            vector<string> keys(ids.size());
+
+            for(size_t i = 0; i < ids.size(); i++) {
+                if (done[i]) {
+                    continue;
+                }
+
+                const string & acc = ids[i].first;
+
+                // Adjusted ids are only searched in their own form.
+
+                if (adjusted[i]) {
+                    if (form == kNumForms - 1) {
+                        keys[i] = acc;
+                    }
+                } else {
+                    switch(form) {
+                    case 0: keys[i] = "gb|" + acc + "|"; break;
+                    case 1: keys[i] = "gb||" + acc;      break;
+                    case 2: keys[i] = acc;               break;
+                    }
+                }
+
+                if (! keys[i].empty()) {
+                    sis->AddSi(keys[i]);
+                }
+            }
+
+            if (sis->Empty()) {
+                continue;
+            }
+
+            try {
+                m_VolSet.GetVol(vol_idx)->IdsToOids(*sis, locked);
+            }
+            catch(const CSeqDBException &) {
+                // This volume has no string index.
+                break;
+            }
+
+            for(size_t i = 0; i < ids.size(); i++) {
+                int oid1 = -1;
+
+                if (keys[i].empty() || ! sis->SiToOid(keys[i], oid1) ||
+                    oid1 < 0) {
+                    continue;
+                }
+
+                int oid2 = oid1;
+
+                if (x_CheckOrFindOID(oid2, locked) && oid1 == oid2) {
+                    oids[ids[i].second] = oid1;
+                } else {
+                    rest.push_back(ids[i]);
+                }
+
+                done[i] = true;
+                num_done++;
+            }
+        }
+    }
+
+    for(size_t i = 0; i < ids.size(); i++) {
+        if (! done[i]) {
+            rest.push_back(ids[i]);
+        }
+    }
+}
+
 void CSeqDBImpl::SeqidToOids(const CSeq_id & seqid_in,
                              vector<int>   & oids,
                              bool            multi)
@@ -2479,6 +2979,18 @@ void CSeqDBImpl::SetNumberOfThreads(int num_threads, bool force_mt)
     m_NextCacheID = 0;
     m_NumThreads = num_threads;
 
+    // Thread clients can skip the lock if every volume is published;
+    // the sequence files were opened above, before any client thread
+    // can use them.
+
+    m_LockFreeSeqs = (num_threads > 0);
+
+    for(int vol_idx = 0; vol_idx < m_VolSet.GetNumVols(); vol_idx++) {
+        if (! m_VolSet.GetVol(vol_idx)->IsPublished()) {
+            m_LockFreeSeqs = false;
+        }
+    }
+
 }
 
 int CSeqDBImpl::x_GetCacheID(CSeqDBLockHold &locked) const
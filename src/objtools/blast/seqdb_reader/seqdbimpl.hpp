@@ -44,6 +44,8 @@
 #include "seqdbalias.hpp"
 #include "seqdboidlist.hpp"
 #include <objtools/blast/seqdb_reader/impl/seqdbcol.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbprefetch.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbdeflinecache.hpp>
 #include "seqdbgimask.hpp"
 
 BEGIN_NCBI_SCOPE
@@ -269,6 +271,22 @@ public:
     ///   The length of the sequence in bases.
     CRef<CBlast_def_line_set> GetHdr(int oid);
 
+    /// Get some fields of the sequence header data.
+    ///
+    /// @param oid
+    ///   The ordinal id of the sequence.
+    /// @param fields
+    ///   The fields to decode.
+    /// @return
+    ///   The deflines, with at least the requested fields.
+    CRef<CBlast_def_line_set> GetPartialHdr(int oid, TSeqDBDeflineFields fields);
+
+    /// Set the size of the defline cache.
+    ///
+    /// @param bytes
+    ///   The approximate memory limit, or zero to disable the cache.
+    void SetDeflineCacheSize(size_t bytes);
+
     /// Get the sequence type.
     ///
     /// Return an enumerated value indicating which type of sequence
@@ -682,6 +700,13 @@ public:
     void AccessionToOids(const string & acc,
                          vector<int>  & oids);
 
+    /// Restrict the database to sequences with the given taxids.
+    void SetTaxIdFilter(const set<TTaxId> & taxids);
+
+    /// Find the first OID matching each of the specified strings.
+    void AccessionsToOids(const vector<string> & accs,
+                          vector<int>          & oids);
+
     /// Translate a CSeq-id to a list of OIDs.
     void SeqidToOids(const CSeq_id & seqid, vector<int> & oids, bool multi);
 
@@ -1122,6 +1147,28 @@ public:
     ///                 internal mmap. [in]
     void SetNumberOfThreads(int num_threads, bool force_mt = false);
 
+    /// Read sequence data ahead of its use
+    ///
+    /// The sequence data for the OIDs in [begin_oid, end_oid) is read
+    /// by a background thread, so that later fetches of it do not
+    /// wait for the disk or network.  This returns immediately.
+    ///
+    /// @param begin_oid The first OID of the range. [in]
+    /// @param end_oid The OID after the range. [in]
+    void Prefetch(int begin_oid, int end_oid);
+
+    /// Enable or disable sequential readahead
+    ///
+    /// When enabled (the default), GetNextOIDChunk prefetches the
+    /// sequence data of the OIDs following each returned chunk.
+    ///
+    /// @param enable True to enable readahead. [in]
+    void SetSequentialReadahead(bool enable);
+
+    /// Get statistics of the prefetching done so far
+    /// @return The statistics.
+    SSeqDBPrefetchStats GetPrefetchStats() const;
+
     /// Retrieve the slice size used in internal mmap
     Int8 GetSliceSize() const{
         return m_Atlas.GetSliceSize();
@@ -1218,6 +1265,43 @@ private:
     ///   true if an OID was found, false otherwise.
     bool x_CheckOrFindOID(int & next_oid, CSeqDBLockHold & locked);
 
+    /// Find OIDs matching the specified string.
+    ///
+    /// This is AccessionToOids() for callers that already hold the
+    /// lock and have set up the OID list.
+    ///
+    /// @param acc
+    ///   The accession or other identifier string.
+    /// @param oids
+    ///   The OIDs found are returned here.
+    /// @param locked
+    ///   The lock hold object for this thread.
+    void x_AccessionToOids(const string   & acc,
+                           vector<int>    & oids,
+                           CSeqDBLockHold & locked);
+
+    /// Find the first OID matching each of the specified string ids.
+    ///
+    /// The ids are translated with merge passes over the string index
+    /// of each volume.  Ids that are not found, or whose OID is
+    /// filtered out, are appended to rest for the general lookup.
+    ///
+    /// @param ids
+    ///   The simplified string ids and their positions in oids.
+    /// @param adjusted
+    ///   Whether each id was adjusted when it was simplified.
+    /// @param oids
+    ///   The OIDs found are stored here.
+    /// @param rest
+    ///   The ids left for the general lookup are appended here.
+    /// @param locked
+    ///   The lock hold object for this thread.
+    void x_StringIdsToOids(const vector< pair<string, size_t> > & ids,
+                           const vector<bool>                   & adjusted,
+                           vector<int>                          & oids,
+                           vector< pair<string, size_t> >       & rest,
+                           CSeqDBLockHold                       & locked);
+
     /// Get the sequence header data.
     ///
     /// This builds and returns the header data corresponding to the
@@ -1227,9 +1311,24 @@ private:
     ///   The ordinal id of the sequence.
     /// @param locked
     ///   The lock hold object for this thread.
+    /// @param shared
+    ///   Set to true if the deflines may be shared through the
+    ///   defline cache, and so must be copied before being returned
+    ///   to the user (optional).
     /// @return
-    ///   The length of the sequence in bases.
-    CRef<CBlast_def_line_set> x_GetHdr(int oid, CSeqDBLockHold & locked);
+    ///   The deflines, which must not be modified.
+    CConstRef<CBlast_def_line_set> x_GetHdr(int              oid,
+                                            CSeqDBLockHold & locked,
+                                            bool           * shared = 0);
+
+    /// Get the defline cache.
+    ///
+    /// The reference keeps the cache alive if SetDeflineCacheSize()
+    /// replaces it meanwhile.
+    ///
+    /// @return
+    ///   The defline cache, or NULL if it is disabled.
+    CRef<CSeqDBDeflineCache> x_GetDeflineCache() const;
 
     /// Look up for the GI of a sequence
     ///
@@ -1354,6 +1453,22 @@ private:
     /// "Bookmark" for multithreaded chunk-type OID iteration.
     int m_NextChunkOID;
 
+    /// True if GetNextOIDChunk reads ahead (protected by the atlas lock).
+    bool m_Readahead;
+
+    /// OIDs before this one have been read ahead by GetNextOIDChunk
+    /// (protected by the atlas lock).
+    int m_ReadaheadOid;
+
+    /// Reads sequence data in the background, once needed.
+    mutable CRef<CSeqDBPrefetcher> m_Prefetcher;
+
+    /// Decoded deflines shared by all threads, if enabled.
+    CRef<CSeqDBDeflineCache> m_DeflineCache;
+
+    /// Protects the m_DeflineCache reference (but not its contents).
+    mutable CFastMutex m_DeflineCacheLock;
+
     /// Number of sequences in the overall database.
     int m_NumSeqs;
 
@@ -1439,6 +1554,11 @@ private:
     mutable std::map<int, int> m_CacheID;
     mutable int m_NextCacheID;
 
+    /// True if thread clients read sequences and lengths without the
+    /// atlas lock; set by SetNumberOfThreads when all volumes are
+    /// published by the atlas.
+    bool m_LockFreeSeqs;
+
     /// Structure to keep sequence retrieval results
     struct SSeqRes {
         int length;   // length of the sequence
@@ -1458,6 +1578,22 @@ private:
     /// Cached sequences.
     mutable vector<SSeqResBuffer *> m_CachedSeqs;
 
+    /// Queue the sequence data of a range of OIDs for prefetching
+    ///
+    /// @param begin_oid The first OID of the range. [in]
+    /// @param end_oid The OID after the range. [in]
+    /// @param locked The lock holder object for this thread. [in]
+    void x_Prefetch(int begin_oid, int end_oid, CSeqDBLockHold & locked) const;
+
+    /// Read ahead of a chunk returned by GetNextOIDChunk
+    ///
+    /// If an OID list applies, only the included OIDs are read.
+    ///
+    /// @param begin_chunk The first OID of the chunk. [in]
+    /// @param end_chunk The OID after the chunk. [in]
+    /// @param locked The lock holder object for this thread. [in]
+    void x_Readahead(int begin_chunk, int end_chunk, CSeqDBLockHold & locked);
+
     /// Fill up the buffer
     void x_FillSeqBuffer(SSeqResBuffer * buffer, int oid, CSeqDBLockHold &locked) const;
 
@@ -139,6 +139,61 @@ Int4 CSeqDBIsam::x_GetPageNumElements(Int4   sample_num,
     return num_elements;
 }
 
+/// Fill a tree in Eytzinger order from a sorted array.
+///
+/// The tree node at position k has children at 2k and 2k+1; an
+/// in-order walk of the tree visits the elements in sorted order.
+///
+/// @param sorted The sorted elements. [in]
+/// @param tree The tree, of size sorted.size() + 1. [out]
+/// @param next The next sorted element to place. [in|out]
+/// @param k The position of the subtree to fill. [in]
+template<class T>
+static void s_FillEytzinger(const vector<T> & sorted,
+                            vector<T>       & tree,
+                            size_t          & next,
+                            size_t            k)
+{
+    if (k < tree.size()) {
+        s_FillEytzinger(sorted, tree, next, 2 * k);
+        tree[k] = sorted[next++];
+        s_FillEytzinger(sorted, tree, next, 2 * k + 1);
+    }
+}
+
+void CSeqDBIsam::x_BuildSampleTree(CSeqDBLockHold & locked)
+{
+    m_Atlas.Lock(locked);
+
+    TIndx offset_begin = m_KeySampleOffset;
+    TIndx offset_end   = offset_begin + m_TermSize * m_NumSamples;
+
+    if (! m_IndexLease.Contains(offset_begin, offset_end)) {
+        m_Atlas.GetRegion(m_IndexLease,
+                          m_IndexFname,
+                          offset_begin,
+                          offset_end);
+    }
+
+    const char * keydatap = m_IndexLease.GetPtr(offset_begin);
+
+    vector<SNumericSample> sorted(m_NumSamples);
+
+    for(int i = 0; i < m_NumSamples; i++) {
+        sorted[i].key    = x_GetNumericKey(keydatap);
+        sorted[i].sample = i;
+        sorted[i].data   = x_GetNumericData(keydatap);
+        keydatap += m_TermSize;
+    }
+
+    vector<SNumericSample> tree(m_NumSamples + 1);
+    size_t next = 0;
+
+    s_FillEytzinger(sorted, tree, next, 1);
+
+    m_SampleTree.swap(tree);
+}
+
 CSeqDBIsam::EErrorCode
 CSeqDBIsam::x_SearchIndexNumeric(Int8             Number,
                                  int            * Data,
@@ -165,55 +220,48 @@ CSeqDBIsam::x_SearchIndexNumeric(Int8             Number,
 
     _ASSERT(m_Type != eNumericNoData);
 
-    // Search the sample file.
+    // Search the sample tree for the first sample not less than the
+    // number; SampleNum is left at the sample before it, which is the
+    // page that would contain the number.
 
-    Int4 Start     (0);
-    Int4 Stop      (m_NumSamples - 1);
-
-    while(Stop >= Start) {
-        SampleNum = ((Uint4)(Stop + Start)) >> 1;
-
-        TIndx offset_begin = m_KeySampleOffset + (m_TermSize * SampleNum);
-        TIndx offset_end   = offset_begin + m_TermSize;
-
-        m_Atlas.Lock(locked);
+    m_Atlas.Lock(locked);
 
-        if (! m_IndexLease.Contains(offset_begin, offset_end)) {
-            m_Atlas.GetRegion(m_IndexLease,
-                              m_IndexFname,
-                              offset_begin,
-                              offset_end);
-        }
+    if (m_SampleTree.empty() && m_NumSamples > 0) {
+        x_BuildSampleTree(locked);
+    }
 
-        const void* keydatap(0);
+    size_t k = 1;
+    size_t n = m_SampleTree.size();
 
-        Int8 Key(0);
+    while(k < n) {
+        k = 2 * k + (m_SampleTree[k].key < Number ? 1 : 0);
+    }
 
-        keydatap = m_IndexLease.GetPtr(offset_begin);
-        Key = x_GetNumericKey (keydatap);
+    // Undo the right turns taken after the last left turn.
 
-        // If this is an exact match, return the master term number.
+    while(k & 1) {
+        k >>= 1;
+    }
+    k >>= 1;
 
-        if (Key == Number) {
-            if (Data != NULL) {
-                *Data = x_GetNumericData(keydatap);
-            }
+    SampleNum = (k == 0) ? m_NumSamples : m_SampleTree[k].sample;
 
-            if (Index != NULL)
-                *Index = SampleNum * m_PageSize;
+    // If this is an exact match, return the master term number.
 
-            done = true;
-            return eNoError;
+    if (k != 0 && m_SampleTree[k].key == Number) {
+        if (Data != NULL) {
+            *Data = m_SampleTree[k].data;
         }
 
-        // Otherwise, search for the next sample.
+        if (Index != NULL)
+            *Index = SampleNum * m_PageSize;
 
-        if ( Number < Key )
-            Stop = --SampleNum;
-        else
-            Start = SampleNum +1;
+        done = true;
+        return eNoError;
     }
 
+    -- SampleNum;
+
     // If the term is out of range altogether, report not finding it.
 
     if ( (SampleNum < 0) || (SampleNum >= m_NumSamples)) {
@@ -36,10 +36,70 @@
 #include "seqdbfilter.hpp"
 #include <objtools/blast/seqdb_reader/impl/seqdbfile.hpp>
 #include "seqdbgilistset.hpp"
+#include <corelib/ncbifile.hpp>
+#include <corelib/ncbi_process.hpp>
+#include <util/checksum.hpp>
+#include <util/bitset/bmserial.h>
 #include <algorithm>
 
 BEGIN_NCBI_SCOPE
 
+/// Environment variable which enables writing of mask cache files.
+static const char * kMaskCacheEnv = "BLASTDB_OID_MASK_CACHE";
+
+/// Extension of mask cache files.
+static const char * kMaskCacheExt = ".obm";
+
+/// Build the name of the mask cache file for an ID list and volume.
+///
+/// The cache is stored next to the ID list file.  Since the bits are
+/// indexed by OID, the first OID of the volume is part of the name;
+/// the same volume may start at other OIDs in other databases.
+///
+/// @param list The ID list file.
+/// @param vol The volume entry.
+/// @return The name of the mask cache file.
+static string s_MaskCachePath(const CSeqDB_Path    & list,
+                              const CSeqDBVolEntry & vol)
+{
+    return list.GetPathS() + "." +
+        CDirEntry(vol.Vol()->GetVolName()).GetName() + "." +
+        NStr::IntToString(vol.OIDStart()) + kMaskCacheExt;
+}
+
+/// Compute the size and checksum of a file.
+///
+/// @param fname The file name.
+/// @param sig The size and CRC32 of the file, as text. [out]
+/// @return false if the file could not be read.
+static bool s_FileSignature(const string & fname, string & sig)
+{
+    CNcbiIfstream in(fname.c_str(), IOS_BASE::in | IOS_BASE::binary);
+    
+    if (! in) {
+        return false;
+    }
+    
+    CChecksum crc(CChecksum::eCRC32);
+    Uint8 size = 0;
+    char buf[65536];
+    
+    while(in) {
+        in.read(buf, sizeof(buf));
+        crc.AddChars(buf, size_t(in.gcount()));
+        size += in.gcount();
+    }
+    
+    if (! in.eof()) {
+        return false;
+    }
+    
+    sig = NStr::UInt8ToString(size) + " " +
+        NStr::UIntToString(crc.GetChecksum(), 0, 16);
+    
+    return true;
+}
+
 CSeqDBOIDList::CSeqDBOIDList(CSeqDBAtlas              & atlas,
                              const CSeqDBVolSet       & volset,
                              CSeqDB_FilterTree        & filters,
@@ -48,9 +108,9 @@ CSeqDBOIDList::CSeqDBOIDList(CSeqDBAtlas              & atlas,
                              CSeqDBLockHold           & locked)
     : m_Atlas   (atlas),
       m_Lease   (atlas),
-      m_NumOIDs (0)
+      m_NumOIDs (0),
+      m_UseMaskCache(gi_list.Empty() && neg_list.Empty())
 {
-    _ASSERT(gi_list.NotEmpty() || neg_list.NotEmpty() || filters.HasFilter());
     x_Setup( volset, filters, gi_list, neg_list, locked );
 }
 
@@ -77,6 +137,16 @@ void CSeqDBOIDList::x_Setup(const CSeqDBVolSet       & volset,
     
     m_NumOIDs = volset.GetNumOIDs();
     
+    if (gi_list.Empty() && neg_list.Empty() && ! filters.HasFilter()) {
+        // Unfiltered databases only get an OID list when filtering
+        // is added later, as by ApplyTaxIdFilter().
+        
+        m_AllBits.Reset(new CSeqDB_BitSet(0,
+                                          m_NumOIDs,
+                                          CSeqDB_BitSet::eAllSet));
+        return;
+    }
+    
     m_AllBits.Reset(new CSeqDB_BitSet(0, m_NumOIDs));
     
     CSeqDBGiListSet gi_list_set(m_Atlas,
@@ -209,7 +279,6 @@ CSeqDBOIDList::x_ComputeFilters(const CSeqDB_FilterTree & filters,
             continue;
         
         CRef<CSeqDB_BitSet> f;
-        CRef<CSeqDBGiList> idlist;
         
         switch(mask.GetType()) {
         case CSeqDB_AliasMask::eOidList:
@@ -217,27 +286,18 @@ CSeqDBOIDList::x_ComputeFilters(const CSeqDB_FilterTree & filters,
             break;
             
         case CSeqDB_AliasMask::eSiList:
-            idlist = gis.GetNodeIdList(mask.GetPath(),
-                                       vol.Vol(),
-                                       CSeqDBGiListSet::eSiList,
-                                       locked);
-            f = x_IdsToBitSet(*idlist, vol_start, vol_end);
+            f = x_GetIdListMask(mask, vol, gis,
+                                CSeqDBGiListSet::eSiList, locked);
             break;
             
         case CSeqDB_AliasMask::eTiList:
-            idlist = gis.GetNodeIdList(mask.GetPath(),
-                                       vol.Vol(),
-                                       CSeqDBGiListSet::eTiList,
-                                       locked);
-            f = x_IdsToBitSet(*idlist, vol_start, vol_end);
+            f = x_GetIdListMask(mask, vol, gis,
+                                CSeqDBGiListSet::eTiList, locked);
             break;
             
         case CSeqDB_AliasMask::eGiList:
-            idlist = gis.GetNodeIdList(mask.GetPath(),
-                                       vol.Vol(),
-                                       CSeqDBGiListSet::eGiList,
-                                       locked);
-            f = x_IdsToBitSet(*idlist, vol_start, vol_end);
+            f = x_GetIdListMask(mask, vol, gis,
+                                CSeqDBGiListSet::eGiList, locked);
             break;
 
         case CSeqDB_AliasMask::eOidRange:
@@ -255,6 +315,263 @@ CSeqDBOIDList::x_ComputeFilters(const CSeqDB_FilterTree & filters,
     return volume_map;
 }
 
+CRef<CSeqDB_BitSet>
+CSeqDBOIDList::x_GetIdListMask(const CSeqDB_AliasMask         & mask,
+                               const CSeqDBVolEntry           & vol,
+                               CSeqDBGiListSet                & gis,
+                               CSeqDBGiListSet::EGiListType     list_type,
+                               CSeqDBLockHold                 & locked)
+{
+    int vol_start = vol.OIDStart();
+    int vol_end   = vol.OIDEnd();
+    
+    // With a user list, the ID lists are translated in terms of the
+    // user list, so the results cannot be shared.
+    
+    string cache, key;
+    
+    if (m_UseMaskCache) {
+        key = x_GetMaskCacheKey(mask.GetPath(), vol);
+    }
+    
+    if (! key.empty()) {
+        cache = s_MaskCachePath(mask.GetPath(), vol);
+        
+        CNcbiIfstream in(cache.c_str(), IOS_BASE::in | IOS_BASE::binary);
+        string data;
+        
+        if (in) {
+            NcbiStreamToString(& data, in);
+        }
+        
+        // Files made from other sources or for other OID ranges,
+        // and damaged files, are ignored (and replaced).
+        
+        if (NStr::StartsWith(data, key)) {
+            CRef<CSeqDB_BitSet> bits(new CSeqDB_BitSet);
+            
+            if (bits->Deserialize(data.substr(key.size())) &&
+                bits->GetStart() == size_t(vol_start) &&
+                bits->GetEnd()   == size_t(vol_end)) {
+                return bits;
+            }
+        }
+    }
+    
+    CRef<CSeqDBGiList> idlist =
+        gis.GetNodeIdList(mask.GetPath(), vol.Vol(), list_type, locked);
+    
+    CRef<CSeqDB_BitSet> bits = x_IdsToBitSet(*idlist, vol_start, vol_end);
+    
+    const char * enable = getenv(kMaskCacheEnv);
+    
+    if (! cache.empty() && enable && *enable && string(enable) != "0") {
+        // Write to a temporary file and rename it, so that other
+        // processes never see an incomplete file.  Databases are
+        // often read-only, so failures are silently ignored.
+        
+        string data;
+        bits->Serialize(data);
+        data.insert(0, key);
+        
+        string tmp =
+            cache + "." + NStr::UInt8ToString(CProcess::GetCurrentPid());
+        {
+            CNcbiOfstream out(tmp.c_str(), IOS_BASE::out | IOS_BASE::binary);
+            out.write(data.data(), data.size());
+            out.close();
+            
+            if (out.fail()) {
+                CFile(tmp).Remove();
+                return bits;
+            }
+        }
+        if (! CFile(tmp).Rename(cache, CFile::fRF_Overwrite)) {
+            CFile(tmp).Remove();
+        }
+    }
+    
+    return bits;
+}
+
+string CSeqDBOIDList::x_GetMaskCacheKey(const CSeqDB_Path    & list,
+                                        const CSeqDBVolEntry & vol)
+{
+    // Checksums of the (possibly large) ID list are computed once per
+    // list, not once per volume.
+    
+    map<string, string>::iterator it = m_ListSignatures.find(list.GetPathS());
+    
+    if (it == m_ListSignatures.end()) {
+        string sig;
+        
+        if (! s_FileSignature(list.GetPathS(), sig)) {
+            sig.erase();
+        }
+        it = m_ListSignatures.insert(make_pair(list.GetPathS(), sig)).first;
+    }
+    
+    Int8 index_size = CFile(vol.Vol()->GetVolName() + "." +
+                            vol.Vol()->GetSeqType() + "in").GetLength();
+    
+    if (it->second.empty() || index_size < 0) {
+        return kEmptyStr;
+    }
+    
+    // The volume is identified by its index file size, OID count and
+    // build date; checksumming the volume itself would cost about as
+    // much as translating the list.
+    
+    return "list " + it->second +
+        " index " + NStr::Int8ToString(index_size) +
+        " " + NStr::IntToString(vol.Vol()->GetNumOIDs()) +
+        " " + vol.Vol()->GetDate() + "\n";
+}
+
+void CSeqDBOIDList::ApplyTaxIdFilter(const CSeqDBVolSet  & volset,
+                                     const set<TTaxId>   & taxids,
+                                     CSeqDBLockHold      & locked)
+{
+    m_Atlas.Lock(locked);
+    
+    CRef<CSeqDB_BitSet> taxid_oids
+        (new CSeqDB_BitSet(0, volset.GetNumOIDs()));
+    
+    bool found_index = false;
+    
+    for(int i = 0; i < volset.GetNumVols(); i++) {
+        const CSeqDBVolEntry * vol = volset.GetVolEntry(i);
+        
+        CSeqDB_Path fn(vol->Vol()->GetVolName() + "." +
+                       vol->Vol()->GetSeqType() + "to");
+        
+        if (! m_Atlas.DoesFileExist(fn, locked)) {
+            // No sequence in this volume has a taxid.
+            continue;
+        }
+        
+        found_index = true;
+        x_ReadTaxIdPostings(fn,
+                            vol->OIDStart(),
+                            vol->OIDEnd(),
+                            taxids,
+                            *taxid_oids,
+                            locked);
+    }
+    
+    if (! found_index) {
+        NCBI_THROW(CSeqDBException,
+                   eFileErr,
+                   "Taxonomy ID index not found; the database must be "
+                   "built with makeblastdb -taxid_index.");
+    }
+    
+    m_AllBits->IntersectWith(*taxid_oids, true);
+    
+    while(m_NumOIDs && (! x_IsSet(m_NumOIDs - 1))) {
+        -- m_NumOIDs;
+    }
+}
+
+void CSeqDBOIDList::x_ReadTaxIdPostings(const CSeqDB_Path   & fn,
+                                        int                   vol_start,
+                                        int                   vol_end,
+                                        const set<TTaxId>   & taxids,
+                                        CSeqDB_BitSet       & bits,
+                                        CSeqDBLockHold      & locked)
+{
+    CSeqDBRawFile  file(m_Atlas);
+    CSeqDBMemLease lease(m_Atlas);
+    
+    if (! file.Open(fn, locked)) {
+        return;
+    }
+    
+    TIndx file_length = file.GetFileLength();
+    
+    if (file_length < 12) {
+        NCBI_THROW(CSeqDBException, eFileErr,
+                   "Taxonomy ID index is corrupted: " + fn.GetPathS());
+    }
+    
+    // The whole file is used, since the postings of common taxids
+    // (and many taxids) are usually wanted together.
+    
+    const Int4 * hdr = (const Int4 *)
+        file.GetRegion(lease, 0, file_length, locked);
+    
+    Int4 version = SeqDB_GetStdOrd(hdr);
+    Int4 num     = SeqDB_GetStdOrd(hdr + 1);
+    
+    const Int4 * table = hdr + 2;
+    TIndx data_start = (2 + 2 * (TIndx) num + 1) * sizeof(Int4);
+    
+    if (version != 1 || num < 0 || data_start > file_length) {
+        m_Atlas.RetRegion(lease);
+        NCBI_THROW(CSeqDBException, eFileErr,
+                   "Taxonomy ID index is corrupted: " + fn.GetPathS());
+    }
+    
+    const unsigned char * data =
+        (const unsigned char *) hdr + data_start;
+    
+    // Merge the requested taxids with the (sorted) table; the OIDs
+    // of all matching taxids are ORed together by deserialize().
+    
+    bm::bvector<> vol_oids(bm::BM_GAP);
+    
+    Int4 lo = 0;
+    
+    ITERATE(set<TTaxId>, iter, taxids) {
+        Int4 hi = num;
+        
+        while(lo < hi) {
+            Int4 mid = lo + (hi - lo) / 2;
+            
+            if (SeqDB_GetStdOrd(table + 2 * mid) < *iter) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        
+        if (lo == num) {
+            break;
+        }
+        
+        if (SeqDB_GetStdOrd(table + 2 * lo) == *iter) {
+            Int4 begin = SeqDB_GetStdOrd(table + 2 * lo + 1);
+            Int4 end   = SeqDB_GetStdOrd(table + 2 * lo + 3);
+            
+            if (begin < 0 || begin >= end ||
+                data_start + end > file_length) {
+                m_Atlas.RetRegion(lease);
+                NCBI_THROW(CSeqDBException, eFileErr,
+                           "Taxonomy ID index is corrupted: " +
+                           fn.GetPathS());
+            }
+            
+            bm::deserialize(vol_oids, data + begin);
+        }
+    }
+    
+    m_Atlas.RetRegion(lease);
+    
+    // Postings are relative to the volume.
+    
+    bm::bvector<>::enumerator en = vol_oids.first();
+    
+    for(; en.valid(); ++en) {
+        int oid = vol_start + (int) *en;
+        
+        if (oid >= vol_end) {
+            break;
+        }
+        
+        bits.SetBit(oid);
+    }
+}
+
 void CSeqDBOIDList::x_ApplyUserGiList(CSeqDBGiList   & gis,
                                       CSeqDBLockHold & locked)
 {
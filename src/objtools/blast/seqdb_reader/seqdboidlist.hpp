@@ -43,7 +43,7 @@
 #include "seqdbvolset.hpp"
 #include "seqdbfilter.hpp"
 #include "seqdbgilistset.hpp"
-#include "seqdbbitset.hpp"
+#include <objtools/blast/seqdb_reader/impl/seqdbbitset.hpp>
 
 BEGIN_NCBI_SCOPE
 
@@ -128,6 +128,21 @@ public:
         return found;
     }
     
+    /// Restrict the OID list to sequences with the given taxids.
+    ///
+    /// The taxid to OID postings files of the volumes (built with
+    /// the eAddTaxIds index flag) are read, and the OIDs found are
+    /// intersected with the current OID list.  Volumes without such
+    /// a file have no sequences with taxids.
+    ///
+    /// @param volset The set of database volumes.
+    /// @param taxids The taxids of the sequences to keep.
+    /// @param locked The lock holder object for this thread.
+    /// @throw CSeqDBException if no volume has a postings file.
+    void ApplyTaxIdFilter(const CSeqDBVolSet  & volset,
+                          const set<TTaxId>   & taxids,
+                          CSeqDBLockHold      & locked);
+    
     /// Deallocate the memory ranges owned by this object.
     /// 
     /// This object may hold a lease on a file owned by the atlas.  If
@@ -237,6 +252,54 @@ private:
     CRef<CSeqDB_BitSet>
     x_IdsToBitSet(const CSeqDBGiList & ids, int vol_start, int vol_end);
     
+    /// Get the OID bitset of an ID list filter for a volume.
+    ///
+    /// The ID list is translated to OIDs with the volume's ISAM
+    /// indices.  If there is no user list, the result only depends
+    /// on the ID list file and the volume, so it is also read from
+    /// (or saved to) a mask cache file next to the ID list file.  A
+    /// cache file is only used if it was made from an ID list file
+    /// with the same size and checksum, and a volume index of the
+    /// same size, OID count and date.
+    ///
+    /// @param mask The ID list filter.
+    /// @param vol The volume entry object for this volume.
+    /// @param gis An object that manages the GI lists used here.
+    /// @param list_type The type of IDs in the list.
+    /// @param locked The lock holder object for this thread.
+    /// @return An OID bitset object.
+    CRef<CSeqDB_BitSet>
+    x_GetIdListMask(const CSeqDB_AliasMask         & mask,
+                    const CSeqDBVolEntry           & vol,
+                    CSeqDBGiListSet                & gis,
+                    CSeqDBGiListSet::EGiListType     list_type,
+                    CSeqDBLockHold                 & locked);
+    
+    /// Get the key identifying the sources of a mask cache file.
+    ///
+    /// The key is stored at the start of the mask cache file.
+    ///
+    /// @param list The ID list file.
+    /// @param vol The volume entry object for this volume.
+    /// @return The key, or an empty string if a file is not readable.
+    string x_GetMaskCacheKey(const CSeqDB_Path    & list,
+                             const CSeqDBVolEntry & vol);
+    
+    /// Read the OIDs of some taxids from a postings file.
+    ///
+    /// @param fn The taxid to OID postings file of the volume.
+    /// @param vol_start The first OID included in this volume.
+    /// @param vol_end The first OID after this volume.
+    /// @param taxids The taxids to look up.
+    /// @param bits The OIDs found are set here.
+    /// @param locked The lock holder object for this thread.
+    void x_ReadTaxIdPostings(const CSeqDB_Path   & fn,
+                             int                   vol_start,
+                             int                   vol_end,
+                             const set<TTaxId>   & taxids,
+                             CSeqDB_BitSet       & bits,
+                             CSeqDBLockHold      & locked);
+    
     /// Apply a user GI list to a volume.
     ///
     /// This method applies a user-specified filter to the OID list.
@@ -277,6 +340,12 @@ private:
     /// The total number of OIDs represented in the bit set.
     int m_NumOIDs;
     
+    /// True if ID list masks may be read from the mask cache.
+    bool m_UseMaskCache;
+    
+    /// Size and checksum of each ID list file, by file name.
+    map<string, string> m_ListSignatures;
+    
     /// An OID bit set covering all volumes.
     CRef<CSeqDB_BitSet> m_AllBits;
 };
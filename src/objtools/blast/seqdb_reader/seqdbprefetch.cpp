@@ -0,0 +1,210 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+/// @file seqdbprefetch.cpp
+/// Implementation for the CSeqDBPrefetcher class, which reads
+/// sequence data in a background thread.
+
+#include <ncbi_pch.hpp>
+#include <objtools/blast/seqdb_reader/impl/seqdbprefetch.hpp>
+#include <corelib/ncbi_system.hpp>
+#include <corelib/ncbitime.hpp>
+
+#if defined(NCBI_OS_UNIX)
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/resource.h>
+#endif
+
+BEGIN_NCBI_SCOPE
+
+/// Count the major page faults taken so far by the calling thread
+/// (or by the process, where per-thread counts are not available).
+static Uint8 s_MajorFaults()
+{
+#if defined(NCBI_OS_UNIX)
+    rusage ruse;
+#  ifdef RUSAGE_THREAD
+    int who = RUSAGE_THREAD;
+#  else
+    int who = RUSAGE_SELF;
+#  endif
+    if (getrusage(who, & ruse) == 0) {
+        return ruse.ru_majflt;
+    }
+#endif
+    return 0;
+}
+
+CSeqDBPrefetcher::CSeqDBPrefetcher()
+    : m_Pending(0, eMaxPending + 1),
+      m_Stop   (false)
+{
+}
+
+CSeqDBPrefetcher::~CSeqDBPrefetcher()
+{
+    CRef<CWorker> worker;
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_Stop = true;
+        m_Queue.clear();
+        worker = m_Worker;
+    }}
+
+    if (worker.NotEmpty()) {
+        m_Pending.Post();
+        worker->Join();
+    }
+}
+
+void CSeqDBPrefetcher::Add(const char * data, TIndx length)
+{
+    if (data && length > 0) {
+        SRequest request;
+        request.data  = data;
+        request.begin = 0;
+        request.end   = length;
+        x_Add(request);
+    }
+}
+
+void CSeqDBPrefetcher::Add(const string & fname, TIndx begin, TIndx end)
+{
+    if (end > begin) {
+        SRequest request;
+        request.data  = 0;
+        request.fname = fname;
+        request.begin = begin;
+        request.end   = end;
+        x_Add(request);
+    }
+}
+
+SSeqDBPrefetchStats CSeqDBPrefetcher::GetStats() const
+{
+    CFastMutexGuard guard(m_Lock);
+    return m_Stats;
+}
+
+void CSeqDBPrefetcher::x_Add(const SRequest & request)
+{
+    CFastMutexGuard guard(m_Lock);
+
+    if (m_Stop || m_Queue.size() >= (size_t) eMaxPending) {
+        return;
+    }
+
+    if (m_Worker.Empty()) {
+        m_Worker.Reset(new CWorker(*this));
+        m_Worker->Run();
+    }
+
+    m_Queue.push_back(request);
+    m_Pending.Post();
+}
+
+bool CSeqDBPrefetcher::x_Next(SRequest & request)
+{
+    for(;;) {
+        m_Pending.Wait();
+
+        CFastMutexGuard guard(m_Lock);
+
+        if (m_Stop) {
+            return false;
+        }
+        if (! m_Queue.empty()) {
+            request = m_Queue.front();
+            m_Queue.pop_front();
+            return true;
+        }
+    }
+}
+
+void CSeqDBPrefetcher::x_Process(const SRequest & request)
+{
+    CStopWatch sw(CStopWatch::eStart);
+    Uint8 faults = s_MajorFaults();
+    Uint8 pages = 0;
+
+    if (request.data) {
+        size_t page = GetVirtualMemoryPageSize();
+        if (page == 0) {
+            page = 4096;
+        }
+
+        // Align the area to whole pages, as madvise() requires.
+
+        const char * begin = request.data;
+        const char * end   = request.data + request.end;
+        const char * first = begin - ((size_t) begin % page);
+
+        MemoryAdvise((void*) first, end - first, eMADV_WillNeed);
+
+        // Touch one byte per page, so that the faults are taken here
+        // instead of in the search threads.
+
+        volatile char sink = 0;
+        for(const char * p = first; p < end; p += page) {
+            sink ^= *((p < begin) ? begin : p);
+            ++pages;
+        }
+        (void) sink;
+    } else {
+#if defined(NCBI_OS_UNIX) && defined(POSIX_FADV_WILLNEED)
+        int fd = open(request.fname.c_str(), O_RDONLY);
+        if (fd >= 0) {
+            posix_fadvise(fd, request.begin, request.end - request.begin,
+                          POSIX_FADV_WILLNEED);
+            close(fd);
+        }
+#endif
+    }
+
+    faults = s_MajorFaults() - faults;
+
+    CFastMutexGuard guard(m_Lock);
+    m_Stats.requests ++;
+    m_Stats.bytes += request.end - request.begin;
+    m_Stats.pages += pages;
+    m_Stats.page_faults += faults;
+    m_Stats.seconds += sw.Elapsed();
+}
+
+void * CSeqDBPrefetcher::CWorker::Main(void)
+{
+    SRequest request;
+
+    while(m_Owner.x_Next(request)) {
+        m_Owner.x_Process(request);
+    }
+
+    return 0;
+}
+
+END_NCBI_SCOPE
@@ -33,6 +33,7 @@
 #include <ncbi_pch.hpp>
 #include <objtools/blast/seqdb_reader/impl/seqdbvol.hpp>
 #include "seqdboidlist.hpp"
+#include <objtools/blast/seqdb_reader/seqdbexpert.hpp>
 
 #include <objects/general/general__.hpp>
 #include <objects/seqfeat/seqfeat__.hpp>
@@ -237,12 +238,41 @@ char CSeqDBVol::x_GetSeqType() const
     return m_Idx->GetSeqType();
 }
 
+void CSeqDBVol::Prefetch(int                begin_oid,
+                         int                end_oid,
+                         CSeqDBPrefetcher & prefetcher,
+                         CSeqDBLockHold   & locked) const
+{
+    m_Atlas.Lock(locked);
+    if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+
+    end_oid = min(end_oid, m_Idx->GetNumOIDs());
+
+    if (m_Seq.Empty() || begin_oid < 0 || begin_oid >= end_oid) {
+        return;
+    }
+
+    // The offset table has an entry for the end of the last sequence,
+    // and nucleotide ambiguity data follows each sequence, so the
+    // start of the next sequence ends the area.
+
+    TIndx start_offset = 0;
+    TIndx end_offset   = 0;
+
+    m_Idx->GetSeqStart(begin_oid, start_offset);
+    m_Idx->GetSeqStart(end_oid, end_offset);
+
+    m_Seq->Prefetch(prefetcher, start_offset, end_offset);
+}
+
 int CSeqDBVol::GetSeqLengthProt(int oid, CSeqDBLockHold & locked) const
 {
     TIndx start_offset = 0;
     TIndx end_offset   = 0;
 
-    m_Atlas.Lock(locked);
+    if (! m_Idx->IsPublished()) {
+        m_Atlas.Lock(locked);
+    }
     m_Idx->GetSeqStartEnd(oid, start_offset, end_offset);
 
     _ASSERT('p' == m_Idx->GetSeqType());
@@ -258,8 +288,10 @@ int CSeqDBVol::GetSeqLengthExact(int oid, CSeqDBLockHold & locked) const
     TIndx start_offset = 0;
     TIndx end_offset   = 0;
 
-    m_Atlas.Lock(locked);
-    if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    if (! IsPublished()) {
+        m_Atlas.Lock(locked);
+        if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    }
     m_Idx->GetSeqStartEnd(oid, start_offset, end_offset);
 
     _ASSERT(m_Idx->GetSeqType() == 'n');
@@ -894,7 +926,7 @@ s_SeqDBWriteSeqDataNucl(CSeq_inst    & seqinst,
 /// @param title
 ///   The returned title string. [out]
 static void
-s_GetBioseqTitle(CRef<CBlast_def_line_set> deflines, string & title)
+s_GetBioseqTitle(CConstRef<CBlast_def_line_set> deflines, string & title)
 {
     title.erase();
 
@@ -1254,6 +1286,7 @@ CSeqDBVol::GetBioseq(int                    oid,
                      const CSeq_id        * target_seq_id,
                      CRef<CSeqDBTaxInfo>    tax_info,
                      bool                   seqdata,
+                     CConstRef<CBlast_def_line_set> deflines,
                      CSeqDBLockHold       & locked)
 {
     typedef list< CRef<CBlast_def_line> > TDeflines;
@@ -1265,15 +1298,20 @@ CSeqDBVol::GetBioseq(int                    oid,
     if (!m_SeqFileOpened) x_OpenSeqFile(locked);
 
     // Get the defline set; but do not modify the object returned by
-    // GetFilteredHeader, since that object lives in the cache.
+    // GetFilteredHeader (or the one passed in), since that object
+    // lives in a cache.
 
-    CRef<CBlast_def_line_set> orig_deflines =
-        x_GetFilteredHeader(oid,  NULL, locked);
+    CConstRef<CBlast_def_line_set> orig_deflines = deflines;
+
+    if (orig_deflines.Empty()) {
+        orig_deflines = x_GetFilteredHeader(oid,  NULL, locked);
+    }
 
-    CRef<CBlast_def_line_set> defline_set;
+    CConstRef<CBlast_def_line_set> defline_set;
 
     if ((target_gi != ZERO_GI) || target_seq_id) {
-        defline_set.Reset(new CBlast_def_line_set);
+        CRef<CBlast_def_line_set> filt_set(new CBlast_def_line_set);
+        defline_set = filt_set;
 
         CRef<const CSeq_id > seqid;
         if (target_gi != ZERO_GI) {
@@ -1295,7 +1333,7 @@ CSeqDBVol::GetBioseq(int                    oid,
             NCBI_THROW(CSeqDBException, eArgErr,
                        "Error: oid headers do not contain target gi/seq_id.");
         } else {
-            defline_set->Set().push_back(filt_dl);
+            filt_set->Set().push_back(filt_dl);
         }
     } else {
         defline_set = orig_deflines;
@@ -1311,7 +1349,15 @@ CSeqDBVol::GetBioseq(int                    oid,
     if (! defline->CanGetSeqid()) {
         return null_result;
     }
-    seqids = defline->GetSeqid();
+
+    // The defline is shared with a cache, so the bioseq gets its own
+    // copies of the Seq-ids.
+
+    ITERATE(list< CRef<CSeq_id> >, iter, defline->GetSeqid()) {
+        CRef<CSeq_id> seqid(new CSeq_id);
+        seqid->Assign(**iter);
+        seqids.push_back(seqid);
+    }
 
     // Get length & sequence.
 
@@ -1654,6 +1700,101 @@ void SeqDB_UnpackAmbiguities(const CTempString & sequence,
 }
 
 
+void CSeqDBSeqView::x_SetAmbiguities(const char * data, int length)
+{
+    m_Ambig.clear();
+
+    int total = length / 4;
+    if (total == 0) {
+        return;
+    }
+
+    // The same encodings as in s_SeqDBRebuildDNA_NA8(), read directly
+    // from the database data rather than from a copy.
+
+    const int * words = (const int *) data;
+    Uint4 amb_num = SeqDB_GetStdOrd(words);
+    bool new_format = (amb_num & 0x80000000) != 0;
+
+    if (new_format) {
+        amb_num &= 0x7FFFFFFF;
+    }
+
+    m_Ambig.reserve(amb_num);
+
+    for(int i = 1; i < total && m_Ambig.size() < amb_num; i++) {
+        Uint4 word = SeqDB_GetStdOrd(words + i);
+        SAmbigRun run;
+
+        run.residue = (word >> 28) & 0xF;
+
+        if (new_format) {
+            if (i + 1 >= total) {
+                break;
+            }
+            run.length = ((word >> 16) & 0xFFF) + 1;
+            run.start  = SeqDB_GetStdOrd(words + (++i));
+        } else {
+            run.length = ((word >> 24) & 0xF) + 1;
+            run.start  = word & 0xFFFFFF;
+        }
+        m_Ambig.push_back(run);
+    }
+}
+
+void CSeqDBSeqView::Expand(char                          * buffer,
+                           int                             nucl_code,
+                           const CSeqDB::TSequenceRanges * masks) const
+{
+    if (Empty()) {
+        NCBI_THROW(CSeqDBException, eArgErr,
+                   "Error: sequence view is empty.");
+    }
+
+    SSeqDBSlice range(0, m_Length);
+
+    if (m_IsProtein) {
+        memcpy(buffer, m_Data, m_Length);
+
+        if (masks) {
+            ITERATE(CSeqDB::TSequenceRanges, mask, *masks) {
+                TSeqPos end = min(mask->second, (TSeqPos) m_Length);
+                for(TSeqPos j = mask->first; j < end; j++) {
+                    buffer[j] = (char) 21;
+                }
+            }
+        }
+        return;
+    }
+
+    bool sentinel = (nucl_code == kSeqDBNuclBlastNA8);
+    char * seq = buffer + (sentinel ? 1 : 0);
+
+    s_SeqDBMapNA2ToNA8(m_Data, seq, range);
+
+    ITERATE(TAmbigRuns, run, m_Ambig) {
+        TSeqPos end = min(run->start + run->length, (TSeqPos) m_Length);
+        for(TSeqPos j = run->start; j < end; j++) {
+            seq[j] = run->residue;
+        }
+    }
+
+    if (masks) {
+        ITERATE(CSeqDB::TSequenceRanges, mask, *masks) {
+            TSeqPos end = min(mask->second, (TSeqPos) m_Length);
+            for(TSeqPos j = mask->first; j < end; j++) {
+                seq[j] = (char) 14;
+            }
+        }
+    }
+
+    if (sentinel) {
+        s_SeqDBMapNcbiNA8ToBlastNA8(seq, range);
+        buffer[0] = (char) 15;
+        buffer[m_Length + 1] = (char) 15;
+    }
+}
+
 int CSeqDBVol::x_GetSequence(int              oid,
                              const char    ** buffer,
                              bool             keep,
@@ -1666,8 +1807,10 @@ int CSeqDBVol::x_GetSequence(int              oid,
 
     int length = -1;
 
-    m_Atlas.Lock(locked);
-    if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    if (! IsPublished()) {
+        m_Atlas.Lock(locked);
+        if (!m_SeqFileOpened) x_OpenSeqFile(locked);
+    }
 
     if (oid >= m_Idx->GetNumOIDs()) return -1;
 
@@ -1900,33 +2043,118 @@ CSeqDBVol::x_GetHdrAsn1(int              oid,
 
     inpstr >> *bdls;
 
-    if (adjust_oids && bdls.NotEmpty() && m_VolStart) {
-        NON_CONST_ITERATE(list< CRef<CBlast_def_line> >, dl, bdls->Set()) {
-            if (! (**dl).CanGetSeqid()) {
-                continue;
-            }
+    if (adjust_oids && bdls.NotEmpty()) {
+        x_AdjustOids(*bdls, changed);
+    }
 
-            NON_CONST_ITERATE(list< CRef<CSeq_id> >, id, (*dl)->SetSeqid()) {
-                CSeq_id & seqid = **id;
+    return bdls;
+}
 
-                if (seqid.Which() == CSeq_id::e_General) {
-                    CDbtag & dbt = seqid.SetGeneral();
+void CSeqDBVol::x_AdjustOids(CBlast_def_line_set & bdls, bool * changed) const
+{
+    if (! m_VolStart) {
+        return;
+    }
+
+    NON_CONST_ITERATE(list< CRef<CBlast_def_line> >, dl, bdls.Set()) {
+        if (! (**dl).CanGetSeqid()) {
+            continue;
+        }
+
+        NON_CONST_ITERATE(list< CRef<CSeq_id> >, id, (*dl)->SetSeqid()) {
+            CSeq_id & seqid = **id;
 
-                    if (dbt.GetDb() == "BL_ORD_ID") {
-                        int vol_oid = dbt.GetTag().GetId();
-                        dbt.SetTag().SetId(m_VolStart + vol_oid);
-                        if (changed) {
-                            *changed = true;
-                        }
+            if (seqid.Which() == CSeq_id::e_General) {
+                CDbtag & dbt = seqid.SetGeneral();
+
+                if (dbt.GetDb() == "BL_ORD_ID") {
+                    int vol_oid = dbt.GetTag().GetId();
+                    dbt.SetTag().SetId(m_VolStart + vol_oid);
+                    if (changed) {
+                        *changed = true;
                     }
                 }
             }
         }
     }
+}
+
+/// Read hook which skips a member of a class.
+class CSeqDB_SkipMemberHook : public CReadClassMemberHook {
+public:
+    /// Skip the member instead of reading it.
+    /// @param in The input stream. [in]
+    /// @param member The member. [in]
+    virtual void ReadClassMember(CObjectIStream      & in,
+                                 const CObjectInfoMI & member)
+    {
+        DefaultSkip(in, member);
+    }
+};
+
+CRef<CBlast_def_line_set>
+CSeqDBVol::GetPartialHeader(int                   oid,
+                            TSeqDBDeflineFields   fields,
+                            CSeqDBLockHold      & locked) const
+{
+    m_Atlas.Lock(locked);
+
+    // Filtering needs the Seq-ids and memberships, so the filtered
+    // (and cached) deflines are used.
+
+    if ((fields & eDeflineAll) == eDeflineAll || x_HaveIdFilter() || m_MemBit) {
+        return x_GetFilteredHeader(oid, NULL, locked);
+    }
+
+    CRef<CBlast_def_line_set> bdls;
+
+    CTempString raw_data = x_GetHdrAsn1Binary(oid, locked);
+
+    if (! raw_data.size()) {
+        return bdls;
+    }
+
+    CObjectIStreamAsnBinary inpstr(raw_data.data(), raw_data.size());
+
+    CRef<CSeqDB_SkipMemberHook> skip(new CSeqDB_SkipMemberHook);
+    CObjectTypeInfo type = CType<CBlast_def_line>();
+
+    if (! (fields & eDeflineTitle)) {
+        type.FindMember("title").SetLocalReadHook(inpstr, skip);
+    }
+    if (! (fields & eDeflineSeqIds)) {
+        type.FindMember("seqid").SetLocalReadHook(inpstr, skip);
+    }
+    if (! (fields & eDeflineTaxId)) {
+        type.FindMember("taxid").SetLocalReadHook(inpstr, skip);
+    }
+    if (! (fields & eDeflineOther)) {
+        type.FindMember("memberships").SetLocalReadHook(inpstr, skip);
+        type.FindMember("links").SetLocalReadHook(inpstr, skip);
+        type.FindMember("other-info").SetLocalReadHook(inpstr, skip);
+    }
+
+    bdls.Reset(new objects::CBlast_def_line_set);
+
+    inpstr >> *bdls;
+
+    if (fields & eDeflineSeqIds) {
+        x_AdjustOids(*bdls, NULL);
+    }
 
     return bdls;
 }
 
+int CSeqDBVol::GetHdrLength(int oid) const
+{
+    TIndx hdr_start = 0;
+    TIndx hdr_end   = 0;
+
+    m_Idx->GetHdrStartEnd(oid, hdr_start, hdr_end);
+
+    return int(hdr_end - hdr_start);
+}
+
 CTempString
 CSeqDBVol::x_GetHdrAsn1Binary(int oid, CSeqDBLockHold & locked) const
 {
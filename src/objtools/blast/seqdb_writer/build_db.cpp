@@ -48,6 +48,9 @@
 // Other utilities
 
 #include <util/sequtil/sequtil_convert.hpp>
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <deque>
 
 // Local
 
@@ -772,6 +775,175 @@ CConstRef<CBioseq> CFastaBioseqSource::GetNext()
     return rv;
 }
 
+/// Bioseq source which reads ahead of its consumer.
+///
+/// Bioseqs are read from another source by a separate thread, so that
+/// parsing the input overlaps with building the database.  At most
+/// eMaxPending Bioseqs are read ahead.  Errors raised by the other
+/// source are reported (as CWriteDBException) by GetNext().
+class CReadAheadBioseqSource : public IBioseqSource {
+public:
+    /// Maximum number of Bioseqs read ahead.
+    enum { eMaxPending = 256 };
+
+    /// Constructor; starts the reading thread.
+    /// @param src The source to read from. [in]
+    CReadAheadBioseqSource(IBioseqSource & src);
+
+    /// Destructor; stops the reading thread.
+    ~CReadAheadBioseqSource();
+
+    /// Get the next Bioseq, or NULL at the end of the input.
+    virtual CConstRef<CBioseq> GetNext();
+
+private:
+    /// The reading thread.
+    class CReader : public CThread {
+    public:
+        /// Constructor.
+        /// @param owner The source owning this thread. [in]
+        CReader(CReadAheadBioseqSource & owner)
+            : m_Owner(owner)
+        {
+        }
+
+    protected:
+        /// Read until the end of the input.
+        virtual void * Main(void)
+        {
+            m_Owner.x_Read();
+            return 0;
+        }
+
+    private:
+        /// The source owning this thread.
+        CReadAheadBioseqSource & m_Owner;
+    };
+
+    /// Read Bioseqs from m_Source; this runs in the reading thread.
+    void x_Read();
+
+    /// The source to read from.
+    IBioseqSource & m_Source;
+
+    /// Protects the fields below.
+    CFastMutex m_Lock;
+
+    /// Posted for each Bioseq read, and at the end of the input.
+    CSemaphore m_Ready;
+
+    /// Posted for each Bioseq consumed, and when stopping.
+    CSemaphore m_Space;
+
+    /// Bioseqs read but not consumed yet.
+    deque< CConstRef<CBioseq> > m_Queue;
+
+    /// True once the reading thread is done.
+    bool m_Done;
+
+    /// True when the reading thread must stop.
+    bool m_Stop;
+
+    /// Error raised by m_Source, if any.
+    string m_Error;
+
+    /// The reading thread.
+    CRef<CReader> m_Reader;
+
+    /// Allow the reading thread to call x_Read.
+    friend class CReader;
+};
+
+CReadAheadBioseqSource::CReadAheadBioseqSource(IBioseqSource & src)
+    : m_Source(src),
+      m_Ready (0, kMax_Int),
+      m_Space (eMaxPending, kMax_Int),
+      m_Done  (false),
+      m_Stop  (false)
+{
+    m_Reader.Reset(new CReader(*this));
+    m_Reader->Run();
+}
+
+CReadAheadBioseqSource::~CReadAheadBioseqSource()
+{
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_Stop = true;
+    }}
+    m_Space.Post();
+    m_Reader->Join();
+}
+
+void CReadAheadBioseqSource::x_Read()
+{
+    string error;
+
+    try {
+        for(;;) {
+            m_Space.Wait();
+
+            {{
+                CFastMutexGuard guard(m_Lock);
+                if (m_Stop) {
+                    break;
+                }
+            }}
+
+            CConstRef<CBioseq> bs = m_Source.GetNext();
+
+            if (bs.Empty()) {
+                break;
+            }
+
+            {{
+                CFastMutexGuard guard(m_Lock);
+                m_Queue.push_back(bs);
+            }}
+            m_Ready.Post();
+        }
+    }
+    catch(const CException & e) {
+        error = e.GetMsg();
+    }
+    catch(const std::exception & e) {
+        error = e.what();
+    }
+
+    {{
+        CFastMutexGuard guard(m_Lock);
+        m_Error = error;
+        m_Done = true;
+    }}
+    m_Ready.Post();
+}
+
+CConstRef<CBioseq> CReadAheadBioseqSource::GetNext()
+{
+    for(;;) {
+        m_Ready.Wait();
+
+        CFastMutexGuard guard(m_Lock);
+
+        if (! m_Queue.empty()) {
+            CConstRef<CBioseq> bs = m_Queue.front();
+            m_Queue.pop_front();
+            m_Space.Post();
+            return bs;
+        }
+
+        if (m_Done) {
+            // Keep later calls from blocking.
+            m_Ready.Post();
+
+            if (! m_Error.empty()) {
+                NCBI_THROW(CWriteDBException, eFileErr, m_Error);
+            }
+            return CConstRef<CBioseq>();
+        }
+    }
+}
+
 bool CBuildDatabase::AddSequences(IBioseqSource & src, bool add_pig)
 {
     bool found = false;
@@ -1015,7 +1187,8 @@ CBuildDatabase::CBuildDatabase(const string         & dbname,
       m_OIDCount     (0),
       m_Verbose      (false),
       m_ParseIDs     (((indexing & CWriteDB::eFullIndex) != 0 ? true : false)),
-      m_FoundMatchingMasks(false)
+      m_FoundMatchingMasks(false),
+      m_NumThreads   (0)
 {
     s_CreateDirectories(dbname);
     const string output_dbname = CDirEntry::CreateAbsolutePath(dbname);
@@ -1064,7 +1237,8 @@ CBuildDatabase::CBuildDatabase(const string & dbname,
       m_OIDCount     (0),
       m_Verbose      (false),
       m_ParseIDs     (parse_seqids),
-      m_FoundMatchingMasks(false)
+      m_FoundMatchingMasks(false),
+      m_NumThreads   (0)
 {
     s_CreateDirectories(dbname);
     const string output_dbname = CDirEntry::CreateAbsolutePath(dbname);
@@ -1304,7 +1478,12 @@ bool CBuildDatabase::AddFasta(CNcbiIstream & fasta_file)
                                m_ParseIDs);
 
         try {
-            success = AddSequences(fbs);
+            if (m_NumThreads > 0) {
+                CReadAheadBioseqSource ras(fbs);
+                success = AddSequences(ras);
+            } else {
+                success = AddSequences(fbs);
+            }
 	    if (success == false)
             	NCBI_THROW(CWriteDBException, eFileErr, "No sequences added");
 
@@ -1483,6 +1662,12 @@ void CBuildDatabase::SetMaxFileSize(Uint8 max_file_size)
     m_OutputDb->SetMaxFileSize(max_file_size);
 }
 
+void CBuildDatabase::SetNumberOfThreads(int num_threads)
+{
+    m_OutputDb->SetNumberOfThreads(num_threads);
+    m_NumThreads = num_threads;
+}
+
 int
 CBuildDatabase::RegisterMaskingAlgorithm(EBlast_filter_program program,
                                          const string        & options,
@@ -1312,6 +1312,213 @@ BOOST_AUTO_TEST_CASE(MultiVolume)
     s_WrapUpFiles(f);
 }
 
+// Build a multi-volume database with a taxid index, and check that
+// SetTaxIdFilter selects the same OIDs as scanning the deflines.
+
+BOOST_AUTO_TEST_CASE(TaxIdIndex)
+{
+
+    CSeqDB nr("nr", CSeqDB::eProtein);
+
+    typedef CWriteDB::EIndexType TType;
+
+    CWriteDB db("taxidx",
+                CWriteDB::eProtein,
+                "title",
+                TType(CWriteDB::eFullIndex | CWriteDB::eAddTaxIds));
+
+    db.SetMaxVolumeLetters(500);
+
+    int gis[] = { 129295, 129296, 129297, 129299, 0 };
+
+    for(int i = 0; gis[i]; i++) {
+        int oid(0);
+        nr.GiToOid(gis[i], oid);
+
+        db.AddSequence(*nr.GetBioseq(oid));
+    }
+
+    db.Close();
+
+    vector<string> files;
+    db.ListFiles(files);
+
+    {
+        CSeqDB all("taxidx", CSeqDB::eProtein);
+
+        vector<int> taxids;
+        all.GetTaxIDs(0, taxids);
+        BOOST_REQUIRE(! taxids.empty());
+
+        set<TTaxId> wanted;
+        wanted.insert(taxids.front());
+
+        vector<int> expected;
+
+        for(int oid = 0; all.CheckOrFindOID(oid); oid++) {
+            all.GetTaxIDs(oid, taxids);
+
+            if (find(taxids.begin(), taxids.end(), *wanted.begin())
+                != taxids.end()) {
+                expected.push_back(oid);
+            }
+        }
+
+        CSeqDB filtered("taxidx", CSeqDB::eProtein);
+        filtered.SetTaxIdFilter(wanted);
+
+        vector<int> found;
+
+        for(int oid = 0; filtered.CheckOrFindOID(oid); oid++) {
+            found.push_back(oid);
+        }
+
+        BOOST_REQUIRE(expected == found);
+
+        // A taxid found nowhere leaves no sequences.
+
+        set<TTaxId> missing;
+        missing.insert(-5);
+
+        CSeqDB none("taxidx", CSeqDB::eProtein);
+        none.SetTaxIdFilter(missing);
+
+        int oid = 0;
+        BOOST_REQUIRE(! none.CheckOrFindOID(oid));
+    }
+
+    s_WrapUpFiles(files);
+}
+
+// Build a multi-volume protein database from a few nr sequences,
+// using the given number of threads, and list its files.
+
+static void s_BuildThreadedDb(const string   & dbname,
+                              int              num_threads,
+                              vector<string> & files)
+{
+    CSeqDB nr("nr", CSeqDB::eProtein);
+
+    typedef CWriteDB::EIndexType TType;
+
+    CWriteDB db(dbname,
+                CWriteDB::eProtein,
+                "title",
+                TType(CWriteDB::eFullIndex | CWriteDB::eAddHash));
+
+    db.SetMaxVolumeLetters(500);
+    db.SetNumberOfThreads(num_threads);
+
+    int gis[] = { 129295, 129296, 129297, 129299, 0 };
+
+    for(int i = 0; gis[i]; i++) {
+        int oid(0);
+        nr.GiToOid(gis[i], oid);
+
+        db.AddSequence(*nr.GetBioseq(oid));
+    }
+
+    db.Close();
+    db.ListFiles(files);
+}
+
+// Read an entire file.
+
+static string s_ReadBinaryFile(const string & fname)
+{
+    CNcbiIfstream in(fname.c_str(), IOS_BASE::in | IOS_BASE::binary);
+    CNcbiOstrstream oss;
+    oss << in.rdbuf();
+    return CNcbiOstrstreamToString(oss);
+}
+
+// Check that two builds produced the same files.
+
+static void s_CompareThreadedDbs(const vector<string> & serial,
+                                 const vector<string> & threaded)
+{
+    BOOST_REQUIRE_EQUAL(serial.size(), threaded.size());
+
+    for(unsigned i = 0; i < serial.size(); i++) {
+        string ext = s_ExtractLast(serial[i], ".");
+
+        BOOST_REQUIRE_EQUAL(ext, s_ExtractLast(threaded[i], "."));
+
+        // Index files hold the creation time, and alias files the
+        // volume names; all other files must be identical.
+
+        if (ext == "pin" || ext == "pal") {
+            continue;
+        }
+
+        BOOST_REQUIRE(s_ReadBinaryFile(serial[i]) ==
+                      s_ReadBinaryFile(threaded[i]));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ThreadedBuildMatchesSerial)
+{
+
+    vector<string> serial, threaded;
+
+    s_BuildThreadedDb("w-serial", 0, serial);
+    s_BuildThreadedDb("w-threaded", 4, threaded);
+
+    s_CompareThreadedDbs(serial, threaded);
+
+    s_WrapUpFiles(serial);
+    s_WrapUpFiles(threaded);
+}
+
+// Build a database from the first num_seqs sequences of nr, using the
+// given number of threads, and list its files.  Enough sequences are
+// added to fill the queue of pending sequences several times over.
+
+static void s_BuildThreadedDbFromOids(const string   & dbname,
+                                      int              num_threads,
+                                      int              num_seqs,
+                                      bool             parse_ids,
+                                      vector<string> & files)
+{
+    CSeqDB nr("nr", CSeqDB::eProtein);
+
+    typedef CWriteDB::EIndexType TType;
+
+    CWriteDB db(dbname,
+                CWriteDB::eProtein,
+                "title",
+                TType(CWriteDB::eFullIndex | CWriteDB::eAddHash),
+                parse_ids);
+
+    db.SetMaxVolumeLetters(20000);
+    db.SetNumberOfThreads(num_threads);
+
+    for(int oid = 0; nr.CheckOrFindOID(oid) && oid < num_seqs; oid++) {
+        db.AddSequence(*nr.GetBioseq(oid));
+    }
+
+    db.Close();
+    db.ListFiles(files);
+}
+
+BOOST_AUTO_TEST_CASE(ThreadedBuildManySequences)
+{
+
+    for(int parse_ids = 0; parse_ids < 2; parse_ids++) {
+        vector<string> one, many;
+
+        s_BuildThreadedDbFromOids("w-one-thread", 1, 500,
+                                  parse_ids != 0, one);
+        s_BuildThreadedDbFromOids("w-many-threads", 4, 500,
+                                  parse_ids != 0, many);
+
+        s_CompareThreadedDbs(one, many);
+
+        s_WrapUpFiles(one);
+        s_WrapUpFiles(many);
+    }
+}
+
 BOOST_AUTO_TEST_CASE(UsPatId)
 {
 
@@ -71,7 +71,11 @@ CWriteDB_Impl::CWriteDB_Impl(const string & dbname,
       m_Pig              (0),
       m_Hash             (0),
       m_SeqLength        (0),
-      m_HaveSequence     (false)
+      m_HaveSequence     (false),
+      m_HashPending      (false),
+      m_CookReady        (0, kMax_Int),
+      m_CookDone         (0, kMax_Int),
+      m_CookStop         (false)
 {
     CTime now(CTime::eCurrent);
 
@@ -93,6 +97,7 @@ CWriteDB_Impl::~CWriteDB_Impl()
 	 LOG_POST(Error << "BLAST Database creation error: " << e.GetMsg());
     }
 
+    x_StopCookThreads();
 }
 
 void CWriteDB_Impl::x_ResetSequenceData()
@@ -106,6 +111,7 @@ void CWriteDB_Impl::x_ResetSequenceData()
     m_Pig = 0;
     m_Hash = 0;
     m_SeqLength = 0;
+    m_HashPending = false;
 
     m_Sequence.erase();
     m_Ambig.erase();
@@ -135,7 +141,11 @@ void CWriteDB_Impl::AddSequence(const CTempString & seq,
     m_Ambig.assign(ambig.data(), ambig.length());
 
     if (m_Indices & CWriteDB::eAddHash) {
-        x_ComputeHash(seq, ambig);
+        if (m_CookThreads.empty()) {
+            x_ComputeHash(seq, ambig);
+        } else {
+            m_HashPending = true;
+        }
     }
 
     x_SetHaveSequence();
@@ -159,7 +169,11 @@ void CWriteDB_Impl::AddSequence(const CBioseq & bs)
     }
 
     if (m_Indices & CWriteDB::eAddHash) {
-        x_ComputeHash(bs);
+        if (m_CookThreads.empty()) {
+            x_ComputeHash(bs);
+        } else {
+            m_HashPending = true;
+        }
     }
 
     x_SetHaveSequence();
@@ -315,6 +329,8 @@ void CWriteDB_Impl::Close()
     m_Closed = true;
 
     x_Publish();
+    x_WriteCookJobs(0);
+    x_StopCookThreads();
     m_Sequence.erase();
     m_Ambig.erase();
 
@@ -799,37 +815,49 @@ void CWriteDB_Impl::x_CookHeader()
 
 void CWriteDB_Impl::x_CookIds()
 {
-    if (! m_Ids.empty()) {
+    x_CookIds(m_BinHdr, m_Deflines, m_Ids);
+}
+
+void CWriteDB_Impl::x_CookIds(const string                   & bin_hdr,
+                              CConstRef<CBlast_def_line_set> & deflines,
+                              vector< CRef<CSeq_id> >        & idlist)
+{
+    if (! idlist.empty()) {
         return;
     }
 
-    if (m_Deflines.Empty()) {
-        if (m_BinHdr.empty()) {
+    if (deflines.Empty()) {
+        if (bin_hdr.empty()) {
             NCBI_THROW(CWriteDBException,
                        eArgErr,
                        "Error: Cannot find IDs or deflines.");
         }
 
-        x_SetDeflinesFromBinary(m_BinHdr, m_Deflines);
+        x_SetDeflinesFromBinary(bin_hdr, deflines);
     }
 
-    ITERATE(list< CRef<CBlast_def_line> >, iter, m_Deflines->Get()) {
+    ITERATE(list< CRef<CBlast_def_line> >, iter, deflines->Get()) {
         const list< CRef<CSeq_id> > & ids = (**iter).GetSeqid();
-        // m_Ids.insert(m_Ids.end(), ids.begin(), ids.end());
+        // idlist.insert(idlist.end(), ids.begin(), ids.end());
         // Spelled out for WorkShop. :-/
-        m_Ids.reserve(m_Ids.size() + ids.size());
+        idlist.reserve(idlist.size() + ids.size());
         ITERATE (list<CRef<CSeq_id> >, it, ids) {
-            m_Ids.push_back(*it);
+            idlist.push_back(*it);
         }
     }
 }
 
 void CWriteDB_Impl::x_MaskSequence()
+{
+    x_MaskSequence(m_Sequence);
+}
+
+void CWriteDB_Impl::x_MaskSequence(string & sequence) const
 {
     // Scan and mask the sequence itself.
-    for(unsigned i = 0; i < m_Sequence.size(); i++) {
-        if (m_MaskLookup[m_Sequence[i] & 0xFF] != 0) {
-            m_Sequence[i] = m_MaskByte[0];
+    for(unsigned i = 0; i < sequence.size(); i++) {
+        if (m_MaskLookup[sequence[i] & 0xFF] != 0) {
+            sequence[i] = m_MaskByte[0];
         }
     }
 }
@@ -861,45 +889,54 @@ int CWriteDB_Impl::x_ComputeSeqLength()
 
 void CWriteDB_Impl::x_CookSequence()
 {
-    if (! m_Sequence.empty())
+    x_CookSequence(m_Bioseq, m_SeqVector, m_Protein, m_Sequence, m_Ambig);
+}
+
+void CWriteDB_Impl::x_CookSequence(const CConstRef<CBioseq> & bioseq,
+                                   CSeqVector               & seqvector,
+                                   bool                       protein,
+                                   string                   & sequence,
+                                   string                   & ambig)
+{
+    if (! sequence.empty())
         return;
 
-    if (! (m_Bioseq.NotEmpty() && m_Bioseq->CanGetInst())) {
+    if (! (bioseq.NotEmpty() && bioseq->CanGetInst())) {
         NCBI_THROW(CWriteDBException,
                    eArgErr,
                    "Need sequence data.");
     }
 
-    const CSeq_inst & si = m_Bioseq->GetInst();
+    const CSeq_inst & si = bioseq->GetInst();
 
-    if (m_Bioseq->GetInst().CanGetSeq_data()) {
+    if (bioseq->GetInst().CanGetSeq_data()) {
         const CSeq_data & sd = si.GetSeq_data();
 
         string msg;
 
         switch(sd.Which()) {
         case CSeq_data::e_Ncbistdaa:
-            WriteDB_StdaaToBinary(si, m_Sequence);
+            WriteDB_StdaaToBinary(si, sequence);
             break;
 
         case CSeq_data::e_Ncbieaa:
-            WriteDB_EaaToBinary(si, m_Sequence);
+            WriteDB_EaaToBinary(si, sequence);
             break;
 
         case CSeq_data::e_Iupacaa:
-            WriteDB_IupacaaToBinary(si, m_Sequence);
+            WriteDB_IupacaaToBinary(si, sequence);
             break;
 
         case CSeq_data::e_Ncbi2na:
-            WriteDB_Ncbi2naToBinary(si, m_Sequence);
+            WriteDB_Ncbi2naToBinary(si, sequence);
             break;
 
         case CSeq_data::e_Ncbi4na:
-            WriteDB_Ncbi4naToBinary(si, m_Sequence, m_Ambig);
+            WriteDB_Ncbi4naToBinary(si, sequence, ambig);
             break;
 
         case CSeq_data::e_Iupacna:
-             WriteDB_IupacnaToBinary(si, m_Sequence, m_Ambig);
+             WriteDB_IupacnaToBinary(si, sequence, ambig);
              break;
 
         default:
@@ -912,7 +949,7 @@ void CWriteDB_Impl::x_CookSequence()
             NCBI_THROW(CWriteDBException, eArgErr, msg);
         }
     } else {
-        int sz = m_SeqVector.size();
+        int sz = seqvector.size();
 
         if (sz == 0) {
             NCBI_THROW(CWriteDBException,
@@ -921,19 +958,19 @@ void CWriteDB_Impl::x_CookSequence()
                        "and no Bioseq_Handle available.");
         }
 
-        if (m_Protein) {
+        if (protein) {
             // I add one to the string length to allow the "i+1" in
             // the loop to be done safely.
 
-            m_Sequence.reserve(sz);
-            m_SeqVector.GetSeqData(0, sz, m_Sequence);
+            sequence.reserve(sz);
+            seqvector.GetSeqData(0, sz, sequence);
         } else {
             // I add one to the string length to allow the "i+1" in the
             // loop to be done safely.
 
             string na8;
             na8.reserve(sz + 1);
-            m_SeqVector.GetSeqData(0, sz, na8);
+            seqvector.GetSeqData(0, sz, na8);
             na8.resize(sz + 1);
 
             string na4;
@@ -946,8 +983,8 @@ void CWriteDB_Impl::x_CookSequence()
             WriteDB_Ncbi4naToBinary(na4.data(),
                                     (int) na4.size(),
                                     (int) si.GetLength(),
-                                    m_Sequence,
-                                    m_Ambig);
+                                    sequence,
+                                    ambig);
         }
     }
 }
@@ -1006,8 +1043,16 @@ void CWriteDB_Impl::x_Publish()
         return;
     }
 
-    x_CookData();
+    if (m_CookThreads.empty()) {
+        x_CookData();
+        x_WriteData();
+    } else {
+        x_QueueCookJob();
+    }
+}
 
+void CWriteDB_Impl::x_WriteData()
+{
     bool done = false;
 
     if (! m_Volume.Empty()) {
@@ -1025,7 +1070,7 @@ void CWriteDB_Impl::x_Publish()
         int index = (int) m_VolumeList.size();
 
         if (m_Volume.NotEmpty()) {
-            m_Volume->Close();
+            m_Volume->Close(! m_CookThreads.empty());
         }
 
         {
@@ -1073,6 +1118,237 @@ void CWriteDB_Impl::x_Publish()
                        "Cannot write sequence to volume.");
         }
     }
+
+    if ((m_Indices & CWriteDB::eAddTaxIds) && m_Deflines.NotEmpty()) {
+        vector<TTaxId> taxids;
+
+        ITERATE(CBlast_def_line_set::Tdata, iter, m_Deflines->Get()) {
+            if ((**iter).IsSetTaxid() && (**iter).GetTaxid() > 0) {
+                taxids.push_back((**iter).GetTaxid());
+            }
+        }
+
+        if (! taxids.empty()) {
+            sort(taxids.begin(), taxids.end());
+            taxids.erase(unique(taxids.begin(), taxids.end()), taxids.end());
+            m_Volume->AddTaxIds(taxids);
+        }
+    }
+}
+
+void CWriteDB_Impl::SetNumberOfThreads(int num_threads)
+{
+    if (x_HaveSequence() || m_Volume.NotEmpty() || ! m_CookThreads.empty()) {
+        NCBI_THROW(CWriteDBException,
+                   eArgErr,
+                   "Error: Threads must be set before adding sequences.");
+    }
+
+    for(int i = 0; i < num_threads; i++) {
+        m_CookThreads.push_back(CRef<CCookThread>(new CCookThread(*this)));
+        m_CookThreads.back()->Run();
+    }
+}
+
+void CWriteDB_Impl::x_QueueCookJob()
+{
+    // Bound the memory used by sequences waiting to be written; nt
+    // scale inputs can have very long sequences.  Writing finished jobs
+    // replaces the current sequence members, so the queue is drained
+    // only after the current sequence has been moved into its job.
+
+    const size_t kMaxPending = 16 * m_CookThreads.size();
+
+    CRef<SCookJob> job(new SCookJob);
+
+    job->bioseq    = m_Bioseq;
+    job->seqvector = m_SeqVector;
+    job->deflines  = m_Deflines;
+    job->pig       = m_Pig;
+    job->hash      = m_Hash;
+    job->need_hash = m_HashPending;
+
+    job->ids        .swap(m_Ids);
+    job->linkouts   .swap(m_Linkouts);
+    job->memberships.swap(m_Memberships);
+    job->sequence   .swap(m_Sequence);
+    job->ambig      .swap(m_Ambig);
+    job->bin_hdr    .swap(m_BinHdr);
+
+    // The blobs go with the sequence; the next sequence gets new ones.
+
+    job->blobs.swap(m_Blobs);
+    m_Blobs.reserve(job->blobs.size());
+
+    for(size_t i = 0; i < job->blobs.size(); i++) {
+        m_Blobs.push_back(CRef<CBlastDbBlob>(new CBlastDbBlob));
+    }
+
+    {{
+        CFastMutexGuard guard(m_CookLock);
+        m_CookJobs.push_back(job);
+        m_CookQueue.push_back(job);
+    }}
+    m_CookReady.Post();
+
+    x_WriteCookJobs(kMaxPending);
+}
+
+void CWriteDB_Impl::x_WriteCookJobs(size_t max_pending)
+{
+    for(;;) {
+        CRef<SCookJob> job;
+
+        {{
+            CFastMutexGuard guard(m_CookLock);
+
+            if (m_CookJobs.empty()) {
+                return;
+            }
+            if (m_CookJobs.front()->done) {
+                job = m_CookJobs.front();
+                m_CookJobs.pop_front();
+            } else if (m_CookJobs.size() <= max_pending) {
+                return;
+            }
+        }}
+
+        if (job.Empty()) {
+            m_CookDone.Wait();
+            continue;
+        }
+
+        if (! job->error.empty()) {
+            NCBI_THROW(CWriteDBException, eArgErr, job->error);
+        }
+
+        // The sequence being added was moved to the queue already, so
+        // the members can hold this one while it is written.
+
+        m_Bioseq    = job->bioseq;
+        m_SeqVector = job->seqvector;
+        m_Deflines  = job->deflines;
+        m_Pig       = job->pig;
+        m_Hash      = job->hash;
+
+        m_Ids        .swap(job->ids);
+        m_Linkouts   .swap(job->linkouts);
+        m_Memberships.swap(job->memberships);
+        m_Sequence   .swap(job->sequence);
+        m_Ambig      .swap(job->ambig);
+        m_BinHdr     .swap(job->bin_hdr);
+        m_Blobs      .swap(job->blobs);
+
+        // Headers containing the OID can only be built here.
+
+        if (! m_ParseIDs) {
+            x_CookHeader();
+            x_CookIds();
+        }
+
+        x_WriteData();
+
+        m_Blobs.swap(job->blobs);
+    }
+}
+
+CRef<CWriteDB_Impl::SCookJob> CWriteDB_Impl::x_NextCookJob()
+{
+    for(;;) {
+        m_CookReady.Wait();
+
+        CFastMutexGuard guard(m_CookLock);
+
+        if (m_CookStop) {
+            return CRef<SCookJob>();
+        }
+        if (! m_CookQueue.empty()) {
+            CRef<SCookJob> job = m_CookQueue.front();
+            m_CookQueue.pop_front();
+            return job;
+        }
+    }
+}
+
+void CWriteDB_Impl::x_CookJob(SCookJob & job)
+{
+    try {
+        if (job.need_hash) {
+            if (job.bioseq.NotEmpty()) {
+                job.hash = SeqDB_SequenceHash(*job.bioseq);
+            } else {
+                job.hash = x_SequenceHash(m_Protein, job.sequence, job.ambig);
+            }
+        }
+
+        if (m_ParseIDs) {
+            x_ExtractDeflines(job.bioseq,
+                              job.deflines,
+                              job.bin_hdr,
+                              job.memberships,
+                              job.linkouts,
+                              job.pig,
+                              -1,
+                              m_ParseIDs);
+
+            x_CookIds(job.bin_hdr, job.deflines, job.ids);
+        }
+
+        x_CookSequence(job.bioseq,
+                       job.seqvector,
+                       m_Protein,
+                       job.sequence,
+                       job.ambig);
+
+        if (m_Protein && m_MaskedLetters.size()) {
+            x_MaskSequence(job.sequence);
+        }
+    }
+    catch(const CException & e) {
+        job.error = e.GetMsg();
+    }
+    catch(const std::exception & e) {
+        job.error = e.what();
+    }
+
+    {{
+        CFastMutexGuard guard(m_CookLock);
+        job.done = true;
+    }}
+    m_CookDone.Post();
+}
+
+void CWriteDB_Impl::x_StopCookThreads()
+{
+    if (m_CookThreads.empty()) {
+        return;
+    }
+
+    {{
+        CFastMutexGuard guard(m_CookLock);
+        m_CookStop = true;
+        m_CookQueue.clear();
+    }}
+
+    m_CookReady.Post((unsigned int) m_CookThreads.size());
+
+    NON_CONST_ITERATE(vector< CRef<CCookThread> >, iter, m_CookThreads) {
+        (**iter).Join();
+    }
+
+    m_CookThreads.clear();
+    m_CookJobs.clear();
+}
+
+void * CWriteDB_Impl::CCookThread::Main(void)
+{
+    CRef<SCookJob> job;
+
+    while((job = m_Owner.x_NextCookJob()).NotEmpty()) {
+        m_Owner.x_CookJob(*job);
+    }
+
+    return 0;
 }
 
 void CWriteDB_Impl::SetDeflines(const CBlast_def_line_set & deflines)
@@ -1521,13 +1797,20 @@ void CWriteDB_Impl::ListFiles(vector<string> & files)
 void CWriteDB_Impl::x_ComputeHash(const CTempString & sequence,
                                   const CTempString & ambig)
 {
-    if (m_Protein) {
-        m_Hash = SeqDB_SequenceHash(sequence.data(), sequence.size());
-    } else {
-        string na8;
-        SeqDB_UnpackAmbiguities(sequence, ambig, na8);
-        m_Hash = SeqDB_SequenceHash(na8.data(), na8.size());
+    m_Hash = x_SequenceHash(m_Protein, sequence, ambig);
+}
+
+int CWriteDB_Impl::x_SequenceHash(bool                protein,
+                                  const CTempString & sequence,
+                                  const CTempString & ambig)
+{
+    if (protein) {
+        return SeqDB_SequenceHash(sequence.data(), sequence.size());
     }
+
+    string na8;
+    SeqDB_UnpackAmbiguities(sequence, ambig, na8);
+    return SeqDB_SequenceHash(na8.data(), na8.size());
 }
 
 /// Compute the hash of a (Bioseq) sequence.
@@ -50,6 +50,10 @@
 #include <objmgr/bioseq_handle.hpp>
 #include <objmgr/seq_vector.hpp>
 
+#include <corelib/ncbithr.hpp>
+#include <corelib/ncbimtx.hpp>
+#include <deque>
+
 BEGIN_NCBI_SCOPE
 
 /// Import definitions from the objects namespace.
@@ -200,6 +204,20 @@ public:
     /// @param sz Maximum sequence letters per volume.
     void SetMaxVolumeLetters(Uint8 sz);
 
+    /// Set the number of threads used to convert sequences.
+    ///
+    /// With one or more threads, sequence data, hashes and (if IDs
+    /// are parsed) headers and ID lists of added sequences are
+    /// converted to disk format by that many worker threads.  The
+    /// calling thread writes the converted sequences to the volumes
+    /// in the order they were added, and volumes build their ISAM
+    /// indices in parallel when closed.  The files produced are the
+    /// same as those of a serial build.  This must be called before
+    /// any sequences are added.
+    ///
+    /// @param num_threads Number of worker threads (0 for none).
+    void SetNumberOfThreads(int num_threads);
+
     /// Extract deflines from a CBioseq.
     ///
     /// Given a CBioseq, this method extracts and returns header info
@@ -424,6 +442,105 @@ private:
     /// Replace masked input letters with m_MaskByte value.
     void x_MaskSequence();
 
+    /// Replace masked input letters with m_MaskByte value.
+    /// @param sequence Sequence to mask. [in|out]
+    void x_MaskSequence(string & sequence) const;
+
+    /// Collect ids for ISAM files.
+    /// @param bin_hdr Binary header, used if deflines are empty. [in]
+    /// @param deflines Deflines of the sequence. [in|out]
+    /// @param ids Identifiers of the sequence. [in|out]
+    static void x_CookIds(const string                   & bin_hdr,
+                          CConstRef<CBlast_def_line_set> & deflines,
+                          vector< CRef<CSeq_id> >        & ids);
+
+    /// Convert sequence data into usable forms.
+    /// @param bioseq Bioseq containing the sequence. [in]
+    /// @param seqvector Sequence, if the Bioseq has no data. [in]
+    /// @param protein True for protein sequences. [in]
+    /// @param sequence Sequence data in disk format. [in|out]
+    /// @param ambig Ambiguities in disk format. [out]
+    static void x_CookSequence(const CConstRef<CBioseq> & bioseq,
+                               CSeqVector               & seqvector,
+                               bool                       protein,
+                               string                   & sequence,
+                               string                   & ambig);
+
+    /// Write the cooked sequence to the current volume.
+    ///
+    /// A new volume is started if the sequence does not fit.
+    void x_WriteData();
+
+    /// Sequence data converted by the cooking threads.
+    struct SCookJob : public CObject {
+        /// Constructor.
+        SCookJob()
+            : pig(0), hash(0), need_hash(false), done(false)
+        {
+        }
+
+        CConstRef<CBioseq>             bioseq;      ///< Bioseq, if any.
+        CSeqVector                     seqvector;   ///< SeqVector, if any.
+        CConstRef<CBlast_def_line_set> deflines;    ///< Deflines.
+        vector< CRef<CSeq_id> >        ids;         ///< ISAM identifiers.
+        vector< vector<int> >          linkouts;    ///< Linkout bits.
+        vector< vector<int> >          memberships; ///< Membership bits.
+        int                            pig;         ///< PIG.
+        int                            hash;        ///< Sequence hash.
+        bool                           need_hash;   ///< Compute the hash.
+        string                         sequence;    ///< Sequence data.
+        string                         ambig;       ///< Ambiguities.
+        string                         bin_hdr;     ///< Binary header.
+        vector< CRef<CBlastDbBlob> >   blobs;       ///< Column data.
+        bool                           done;        ///< Cooking is done.
+        string                         error;       ///< Cooking error.
+    };
+
+    /// Worker thread cooking queued sequences.
+    class CCookThread : public CThread {
+    public:
+        /// Constructor.
+        /// @param owner Object owning the queue. [in]
+        CCookThread(CWriteDB_Impl & owner)
+            : m_Owner(owner)
+        {
+        }
+
+    protected:
+        /// Cook sequences until the owner stops the threads.
+        virtual void * Main(void);
+
+    private:
+        /// Object owning the queue.
+        CWriteDB_Impl & m_Owner;
+    };
+
+    /// Move the current sequence to the cooking queue.
+    void x_QueueCookJob();
+
+    /// Write cooked sequences in the order they were queued.
+    ///
+    /// Sequences are written until the first one which is not cooked
+    /// yet; if more than max_pending sequences remain, this waits for
+    /// the cooking threads.
+    ///
+    /// @param max_pending Number of sequences which may remain. [in]
+    void x_WriteCookJobs(size_t max_pending);
+
+    /// Wait for a sequence to cook.
+    /// @return The sequence, or NULL if the thread should stop.
+    CRef<SCookJob> x_NextCookJob();
+
+    /// Cook one sequence; this runs in a cooking thread.
+    /// @param job The sequence. [in|out]
+    void x_CookJob(SCookJob & job);
+
+    /// Stop and join the cooking threads.
+    void x_StopCookThreads();
+
+    /// Allow the cooking threads to use the queue.
+    friend class CCookThread;
+
     /// Get binary version of deflines from 'user' data in Bioseq.
     ///
     /// Some CBioseq objects (e.g. those from CSeqDB) have an ASN.1
@@ -543,6 +660,16 @@ private:
     /// @param sequence The sequence as a CBioseq. [in]
     void x_ComputeHash(const CBioseq & sequence);
 
+    /// Compute the hash of a (raw) sequence.
+    ///
+    /// @param protein True for protein sequences. [in]
+    /// @param sequence The sequence data. [in]
+    /// @param ambiguities Nucleotide ambiguities are provided here. [in]
+    /// @return The hash of the sequence.
+    static int x_SequenceHash(bool                protein,
+                              const CTempString & sequence,
+                              const CTempString & ambiguities);
+
     /// Get the mask data column id.
     ///
     /// The mask data column is created if it does not exist, and its
@@ -585,6 +712,9 @@ private:
     /// True if we have a sequence to write.
     bool m_HaveSequence;
 
+    /// True if the hash is to be computed by the cooking threads.
+    bool m_HashPending;
+
     // Cooked
 
     /// Sequence data in format that will be written to disk.
@@ -612,6 +742,29 @@ private:
 
     /// Registry for masking algorithms in this database.
     CMaskInfoRegistry m_MaskAlgoRegistry;
+
+    // Cooking threads
+
+    /// Threads cooking sequences (empty for a serial build).
+    vector< CRef<CCookThread> > m_CookThreads;
+
+    /// Queued sequences not written yet, in the order they were added.
+    deque< CRef<SCookJob> > m_CookJobs;
+
+    /// Queued sequences not claimed by a cooking thread yet.
+    deque< CRef<SCookJob> > m_CookQueue;
+
+    /// Protects the queues and the done flags of queued sequences.
+    CFastMutex m_CookLock;
+
+    /// Posted for each queued sequence and for each stopping thread.
+    CSemaphore m_CookReady;
+
+    /// Posted for each cooked sequence.
+    CSemaphore m_CookDone;
+
+    /// True when the cooking threads must stop.
+    bool m_CookStop;
 };
 
 END_NCBI_SCOPE
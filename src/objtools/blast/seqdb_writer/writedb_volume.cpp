@@ -33,6 +33,9 @@
 #include <ncbi_pch.hpp>
 #include "writedb_volume.hpp"
 #include <objtools/blast/seqdb_writer/writedb_error.hpp>
+#include <corelib/ncbithr.hpp>
+#include <util/bitset/ncbi_bitset.hpp>
+#include <util/bitset/bmserial.h>
 #include <iostream>
 
 BEGIN_NCBI_SCOPE
@@ -53,7 +56,7 @@ CWriteDB_Volume::CWriteDB_Volume(const string & dbname,
       m_Title       (title),
       m_Date        (date),
       m_Index       (index),
-      m_Indices     (indices),
+      m_Indices     ((EIndexType) (indices & ~CWriteDB::eAddTaxIds)),
       m_OID         (0),
       m_Open        (true)
 {
@@ -128,6 +131,13 @@ CWriteDB_Volume::CWriteDB_Volume(const string & dbname,
                                              max_file_size));
 
     }
+
+    if (indices & CWriteDB::eAddTaxIds) {
+        m_TaxIdIndex.Reset(new CWriteDB_TaxIdIndex(dbname,
+                                                   protein,
+                                                   index,
+                                                   max_file_size));
+    }
 }
 
 CWriteDB_Volume::~CWriteDB_Volume()
@@ -300,7 +310,104 @@ int CWriteDB_Volume::x_FindNuclLength(const string & seq)
     return WriteDB_FindSequenceLength(m_Protein, seq);
 }
 
-void CWriteDB_Volume::Close()
+void CWriteDB_TaxIdIndex::x_Flush()
+{
+    if (m_Postings.empty()) {
+        return;
+    }
+
+    sort(m_Postings.begin(), m_Postings.end());
+
+    // Compress the OIDs of each taxid.
+
+    vector<TTaxId> taxids;
+    vector<string> postings;
+
+    size_t i = 0;
+
+    while(i < m_Postings.size()) {
+        TTaxId taxid = m_Postings[i].first;
+
+        bm::bvector<> oids(bm::BM_GAP);
+
+        for(; i < m_Postings.size() && m_Postings[i].first == taxid; i++) {
+            oids.set_bit(m_Postings[i].second);
+        }
+
+        oids.optimize();
+
+        bm::bvector<>::statistics st;
+        oids.calc_stat(& st);
+
+        string data(st.max_serialize_mem, (char) 0);
+        data.resize(bm::serialize(oids, (unsigned char*) & data[0]));
+
+        taxids.push_back(taxid);
+        postings.push_back(data);
+    }
+
+    Create();
+    WriteInt4(kVersion);
+    WriteInt4((int) taxids.size());
+
+    int offset = 0;
+
+    for(size_t j = 0; j < taxids.size(); j++) {
+        WriteInt4(taxids[j]);
+        WriteInt4(offset);
+        offset += (int) postings[j].size();
+    }
+    WriteInt4(offset);
+
+    ITERATE(vector<string>, iter, postings) {
+        Write(*iter);
+    }
+
+    vector< pair<TTaxId, int> > tmp;
+    m_Postings.swap(tmp);
+}
+
+/// Thread which sorts and writes one ISAM index.
+class CWriteDB_IsamCloser : public CThread {
+public:
+    /// Constructor.
+    /// @param isam The index to close. [in]
+    CWriteDB_IsamCloser(CRef<CWriteDB_Isam> isam)
+        : m_Isam(isam)
+    {
+    }
+
+    /// Get the error raised while closing the index, if any.
+    const string & GetError() const
+    {
+        return m_Error;
+    }
+
+protected:
+    /// Close the index.
+    virtual void * Main(void)
+    {
+        try {
+            m_Isam->Close();
+        }
+        catch(const CException & e) {
+            m_Error = e.GetMsg();
+        }
+        catch(const std::exception & e) {
+            m_Error = e.what();
+        }
+        return 0;
+    }
+
+private:
+    /// The index to close.
+    CRef<CWriteDB_Isam> m_Isam;
+
+    /// Error message, or empty if the index was closed.
+    string m_Error;
+};
+
+void CWriteDB_Volume::Close(bool parallel_indices)
 {
     if (m_Open) {
         m_Open = false;
@@ -310,7 +417,55 @@ void CWriteDB_Volume::Close()
         m_Hdr->Close();
         m_Seq->Close();
 
-        if (m_Indices != CWriteDB::eNoIndex) {
+        if (m_Indices != CWriteDB::eNoIndex && parallel_indices) {
+            vector< CRef<CWriteDB_Isam> > isams;
+
+            if (m_Protein) {
+                isams.push_back(m_PigIsam);
+            }
+            isams.push_back(m_GiIsam);
+            isams.push_back(m_AccIsam);
+
+            if (m_TraceIsam.NotEmpty()) {
+                isams.push_back(m_TraceIsam);
+            }
+
+            if (m_HashIsam.NotEmpty()) {
+                isams.push_back(m_HashIsam);
+            }
+
+            vector< CRef<CWriteDB_IsamCloser> > closers;
+
+            ITERATE(vector< CRef<CWriteDB_Isam> >, iter, isams) {
+                closers.push_back(CRef<CWriteDB_IsamCloser>
+                                  (new CWriteDB_IsamCloser(*iter)));
+                closers.back()->Run();
+            }
+
+            // The closers must be joined even if this fails.
+
+            string error;
+
+            try {
+                m_GiIndex->Close();
+            }
+            catch(const CException & e) {
+                error = e.GetMsg();
+            }
+
+            NON_CONST_ITERATE(vector< CRef<CWriteDB_IsamCloser> >, iter, closers) {
+                (**iter).Join();
+
+                if (error.empty()) {
+                    error = (**iter).GetError();
+                }
+            }
+            m_IdSet.clear();
+
+            if (! error.empty()) {
+                NCBI_THROW(CWriteDBException, eFileErr, error);
+            }
+        } else if (m_Indices != CWriteDB::eNoIndex) {
             if (m_Protein) {
                 m_PigIsam->Close();
             }
@@ -329,6 +484,10 @@ void CWriteDB_Volume::Close()
         }
     }
 
+    if (m_TaxIdIndex.NotEmpty()) {
+        m_TaxIdIndex->Close();
+    }
+
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     NON_CONST_ITERATE(vector< CRef<CWriteDB_Column> >, iter, m_Columns) {
@@ -364,6 +523,10 @@ void CWriteDB_Volume::RenameSingle()
         }
     }
 
+    if (m_TaxIdIndex.NotEmpty() && m_TaxIdIndex->IsCreated()) {
+        m_TaxIdIndex->RenameSingle();
+    }
+
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     NON_CONST_ITERATE(vector< CRef<CWriteDB_Column> >, iter, m_Columns) {
@@ -401,6 +564,10 @@ void CWriteDB_Volume::ListFiles(vector<string> & files) const
     if (m_GiIndex.NotEmpty()) {
         files.push_back(m_GiIndex->GetFilename());
     }
+
+    if (m_TaxIdIndex.NotEmpty() && m_TaxIdIndex->IsCreated()) {
+        files.push_back(m_TaxIdIndex->GetFilename());
+    }
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
     ITERATE(vector< CRef<CWriteDB_Column> >, iter, m_Columns) {
@@ -98,6 +98,54 @@ private:
 };
 
 
+/// CWriteDB_TaxIdIndex class
+///
+/// This class creates the taxid->OID postings file.  For each taxid
+/// found in the deflines of the volume, the set of (volume relative)
+/// OIDs is stored as a compressed bit vector (see bmserial.h).  The
+/// file starts with a version number and the number of taxids, then
+/// a table of taxids (in increasing order), each followed by the
+/// offset of its postings relative to the end of the table, and one
+/// more offset for the end of the postings; all values are Int4 in
+/// big-endian order.  The file is only created if some sequence of
+/// the volume has a taxid.
+class CWriteDB_TaxIdIndex : public CWriteDB_File {
+public:
+    CWriteDB_TaxIdIndex(const string & dbname,
+                        bool           protein,
+                        int            index,
+                        Uint8          max_fsize)
+    : CWriteDB_File  (dbname, (protein ? "pto" : "nto"), index, max_fsize, false){ }
+
+    ~CWriteDB_TaxIdIndex() { };
+
+    /// Add the taxids of a sequence.
+    /// @param oid The OID of the sequence in this volume. [in]
+    /// @param taxids The taxids of the sequence. [in]
+    void AddTaxIds(int oid, const vector<TTaxId> & taxids)
+    {
+        ITERATE(vector<TTaxId>, iter, taxids) {
+            m_Postings.push_back(make_pair(*iter, oid));
+        }
+    }
+
+    /// Check whether the file was written.
+    bool IsCreated() const
+    {
+        return m_Created;
+    }
+
+    /// Version of the file format.
+    static const int kVersion = 1;
+
+private:
+    void x_Flush();
+
+    /// Pairs of taxid and OID.
+    vector< pair<TTaxId, int> > m_Postings;
+};
+
+
 /// CWriteDB_Volume class
 ///
 /// This manufactures a blast database volume from sequences.
@@ -159,6 +207,20 @@ public:
                        const TBlobList & blobs,
                        int               maskcol_id=-1);
 
+    /// Add the taxids of the last sequence written.
+    ///
+    /// This does nothing unless the volume was built with the
+    /// eAddTaxIds index flag.
+    ///
+    /// @param taxids The taxids of the sequence.
+    void AddTaxIds(const vector<TTaxId> & taxids)
+    {
+        _ASSERT(m_OID > 0);
+        if (m_TaxIdIndex.NotEmpty()) {
+            m_TaxIdIndex->AddTaxIds(m_OID - 1, taxids);
+        }
+    }
+
     /// Rename all volumes files to single-volume names.
     ///
     /// When volume component files are generated by WriteDB, the
@@ -173,8 +235,12 @@ public:
     /// This method finalizes and closes all files associated with
     /// this volume.  (This is not a trivial operation, because ISAM
     /// indices and the index file (pin or nin) cannot be written
-    /// until all of the data has been seen.)
-    void Close();
+    /// until all of the data has been seen.)  The ISAM indices are
+    /// independent of each other, so they can be sorted and written
+    /// by separate threads; the files produced are the same.
+    ///
+    /// @param parallel_indices If true, build each ISAM index in its own thread.
+    void Close(bool parallel_indices = false);
 
     /// Get the name of the volume.
     ///
@@ -266,6 +332,7 @@ private:
     CRef<CWriteDB_Isam> m_TraceIsam; ///< Trace ID index (pti+ptd or nti+ntd).
     CRef<CWriteDB_Isam> m_HashIsam;  ///< Hash index (phi+phd or nhi+nhd).
     CRef<CWriteDB_GiIndex> m_GiIndex;///< OID->GI lookup (pgx or ngx).
+    CRef<CWriteDB_TaxIdIndex> m_TaxIdIndex; ///< Taxid->OIDs (pto or nto).
 
 #if ((!defined(NCBI_COMPILER_WORKSHOP) || (NCBI_COMPILER_VERSION  > 550)) && \
      (!defined(NCBI_COMPILER_MIPSPRO)) )
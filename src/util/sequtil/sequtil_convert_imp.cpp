@@ -36,6 +36,7 @@
 
 #include "sequtil_convert_imp.hpp"
 #include "sequtil_shared.hpp"
+#include "sequtil_simd.hpp"
 #include "sequtil_tables.hpp"
 
 #include <stdlib.h>
@@ -267,12 +268,15 @@ SIZE_TYPE CSeqConvert_imp::x_ConvertIupacnaTo2na
     const Uint1* table = CIupacnaTo2na::GetTable();
     
     const char* src_i = src + pos;
-    for ( size_t count = length / 4; count; --count ) {
+    SIZE_TYPE done = simd_iupacna_to_2na(src_i, length, dst);
+    src_i += done;
+    dst += done / 4;
+    for ( size_t count = (length - done) / 4; count; --count ) {
         *dst = 
-            table[*src_i * 4          ] | 
-            table[*(src_i + 1) * 4 + 1] |
-            table[*(src_i + 2) * 4 + 2] |
-            table[*(src_i + 3) * 4 + 3];
+            table[static_cast<Uint1>(*src_i) * 4          ] | 
+            table[static_cast<Uint1>(*(src_i + 1)) * 4 + 1] |
+            table[static_cast<Uint1>(*(src_i + 2)) * 4 + 2] |
+            table[static_cast<Uint1>(*(src_i + 3)) * 4 + 3];
         src_i += 4;
         ++dst;
     }
@@ -324,9 +328,13 @@ SIZE_TYPE CSeqConvert_imp::x_ConvertIupacnaTo4na
     const Uint1* table = CIupacnaTo4na::GetTable();
     
     const char* src_i = src + pos;
+    SIZE_TYPE done = simd_iupacna_to_4na(src_i, length, dst);
+    src_i += done;
+    dst += done / 2;
     
-    for ( size_t count = length / 2; count; --count ) {
-        *dst = table[*src_i * 2] | table[*(src_i + 1) * 2 + 1];
+    for ( size_t count = (length - done) / 2; count; --count ) {
+        *dst = table[static_cast<Uint1>(*src_i) * 2] |
+            table[static_cast<Uint1>(*(src_i + 1)) * 2 + 1];
         src_i += 2;
         ++dst;
     }
@@ -353,8 +361,10 @@ SIZE_TYPE CSeqConvert_imp::x_ConvertIupacnaTo8na
     // given a specific conversion table.
     // the iupacna to ncbi8na table converts upper and lower case IUPACna
     // into a single ncbi8na byte (which is the same as ncbi4na_expand)
-    return convert_1_to_1(src, pos, length, dst, 
-                          CIupacnaTo8na::GetTable());
+    SIZE_TYPE done = simd_iupacna_to_8na(src + pos, length, dst);
+    convert_1_to_1(src, pos + done, length - done, dst + done, 
+                   CIupacnaTo8na::GetTable());
+    return length;
 }
 
 
@@ -370,7 +380,20 @@ SIZE_TYPE CSeqConvert_imp::x_Convert2naToIupacna
  TSeqPos length,
  char* dst)
 {
-    return convert_1_to_4(src, pos, length, dst, C2naToIupacna::GetTable());
+    const Uint1* table = C2naToIupacna::GetTable();
+
+    // the vector code starts at a byte boundary
+    TSeqPos head = min((4 - pos % 4) % 4, length);
+    if ( head != 0 ) {
+        convert_1_to_4(src, pos, head, dst, table);
+    }
+    TSeqPos done = head + TSeqPos(simd_2na_to_iupacna(src + (pos + head) / 4,
+                                                      length - head,
+                                                      dst + head));
+    if ( done < length ) {
+        convert_1_to_4(src, pos + done, length - done, dst + done, table);
+    }
+    return length;
 }
 
 
@@ -654,7 +677,20 @@ SIZE_TYPE CSeqConvert_imp::x_Convert4naToIupacna
  TSeqPos length,
  char* dst)
 {
-    return convert_1_to_2(src, pos, length, dst, C4naToIupacna::GetTable());
+    const Uint1* table = C4naToIupacna::GetTable();
+
+    // the vector code starts at a byte boundary
+    TSeqPos head = min(pos % 2, length);
+    if ( head != 0 ) {
+        convert_1_to_2(src, pos, head, dst, table);
+    }
+    TSeqPos done = head + TSeqPos(simd_4na_to_iupacna(src + (pos + head) / 2,
+                                                      length - head,
+                                                      dst + head));
+    if ( done < length ) {
+        convert_1_to_2(src, pos + done, length - done, dst + done, table);
+    }
+    return length;
 }
 
 // NCBI4na -> NCBI2na
@@ -780,7 +816,10 @@ SIZE_TYPE CSeqConvert_imp::x_Convert8naToIupacna
  TSeqPos length,
  char *dst)
 {
-    return convert_1_to_1(src, pos, length, dst, C8naToIupacna::GetTable());
+    SIZE_TYPE done = simd_8na_to_iupacna(src + pos, length, dst);
+    convert_1_to_1(src, pos + done, length - done, dst + done,
+                   C8naToIupacna::GetTable());
+    return length;
 }
 
 
@@ -902,7 +941,10 @@ SIZE_TYPE CSeqConvert_imp::x_ConvertIupacaaToStdaa
  TSeqPos length,
  char *dst)
 {
-    return convert_1_to_1(src, pos, length, dst, CIupacaaToStdaa::GetTable());
+    SIZE_TYPE done = simd_iupacaa_to_stdaa(src + pos, length, dst);
+    convert_1_to_1(src, pos + done, length - done, dst + done,
+                   CIupacaaToStdaa::GetTable());
+    return length;
 }
 
 
@@ -944,7 +986,10 @@ SIZE_TYPE CSeqConvert_imp::x_ConvertStdaaToIupacaa
  TSeqPos length,
  char *dst)
 {
-    return convert_1_to_1(src, pos, length, dst, CStdaaToIupacaa::GetTable());
+    SIZE_TYPE done = simd_stdaa_to_iupacaa(src + pos, length, dst);
+    convert_1_to_1(src, pos + done, length - done, dst + done,
+                   CStdaaToIupacaa::GetTable());
+    return length;
 }
 
 // NCBIstdaa (NCBI8aa) -> NCBIeaa
@@ -1342,7 +1387,7 @@ bool CSeqConvert_imp::x_HasAmbigIupacna(const char* src, size_t length)
     
     const char* end = src + length;
     
-    const char* iter = src;
+    const char* iter = src + simd_iupacna_unambig_prefix(src, length);
     while ( (iter != end)  &&  (not_ambig[static_cast<Uint1>(*iter)]) ) { 
           ++iter;
     }
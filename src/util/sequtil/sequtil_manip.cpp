@@ -39,6 +39,7 @@
 #include <util/sequtil/sequtil_manip.hpp>
 #include <util/sequtil/sequtil_convert.hpp>
 #include "sequtil_shared.hpp"
+#include "sequtil_simd.hpp"
 #include "sequtil_tables.hpp"
 
 
@@ -453,6 +454,20 @@ SIZE_TYPE CSeqManip::ReverseComplement
 }
 
 
+static SIZE_TYPE s_IupacnaRevCmp
+(const char* src,
+ TSeqPos pos,
+ TSeqPos length,
+ char* dst)
+{
+    // the vector code handles the end of the range, the table the rest
+    SIZE_TYPE done = simd_iupacna_revcmp(src + pos, length, dst);
+    copy_1_to_1_reverse(src, pos, TSeqPos(length - done), dst + done,
+                        CIupacnaCmp::GetTable());
+    return length;
+}
+
+
 static SIZE_TYPE s_Ncbi2naRevCmp
 (const char* src,
  TSeqPos pos,
@@ -551,8 +566,9 @@ static SIZE_TYPE s_Ncbi4naRevCmp
                 *dst = table[static_cast<Uint1>(*--iter)];
             }
 
+            // the last byte holds a residue from before the range
             if ( length % 2 != 0 ) {
-                *dst &= char(0xF0);
+                *(dst - 1) &= char(0xF0);
             }
         }}
         break;
@@ -573,8 +589,7 @@ SIZE_TYPE CSeqManip::ReverseComplement
 
     switch ( src_coding ) {
     case CSeqUtil::e_Iupacna:
-        return copy_1_to_1_reverse(src, pos, length, dst, 
-                                   CIupacnaCmp::GetTable());
+        return s_IupacnaRevCmp(src, pos, length, dst);
 
     case CSeqUtil::e_Ncbi2na:
         return s_Ncbi2naRevCmp(src, pos, length, dst);
@@ -641,13 +656,32 @@ SIZE_TYPE CSeqManip::ReverseComplement
 }
 
 
+static SIZE_TYPE s_IupacnaRevCmp
+(char* src,
+ TSeqPos pos,
+ TSeqPos length)
+{
+    // the vector code swaps the ends of the range, the table the middle
+    char* first = src + pos;
+    SIZE_TYPE done = simd_iupacna_revcmp_ends(first, length);
+    revcmp(first + done, 0, TSeqPos(length - 2 * done),
+           CIupacnaCmp::GetTable());
+
+    if ( pos != 0 ) {
+        copy(first, first + length, src);
+    }
+
+    return length;
+}
+
+
 static SIZE_TYPE s_Ncbi2naExpandRevCmp
 (char* src,
  TSeqPos pos,
  TSeqPos length)
 {
     char* first = src + pos;    
-    char* last  = first + length;
+    char* last  = first + length - 1;
     char temp;
 
     for ( ; first <= last; ++first, --last ) {
@@ -672,7 +706,7 @@ static SIZE_TYPE s_Ncbi2naRevCmp
     char* buf = new char[length];
     CSeqConvert::Convert(src, CSeqUtil::e_Ncbi2na, pos, length, 
         buf, CSeqUtil::e_Ncbi8na);
-    revcmp(buf, pos, length, C8naCmp::GetTable());
+    revcmp(buf, 0, length, C8naCmp::GetTable());
     CSeqConvert::Convert(buf, CSeqUtil::e_Ncbi8na, 0, length, 
         src, CSeqUtil::e_Ncbi2na);
     delete[] buf;
@@ -689,7 +723,7 @@ static SIZE_TYPE s_Ncbi4naRevCmp
     char* buf = new char[length];
     CSeqConvert::Convert(src, CSeqUtil::e_Ncbi4na, pos, length, 
         buf, CSeqUtil::e_Ncbi8na);
-    revcmp(buf, pos, length, C8naCmp::GetTable());
+    revcmp(buf, 0, length, C8naCmp::GetTable());
     CSeqConvert::Convert(buf, CSeqUtil::e_Ncbi8na, 0, length, 
         src, CSeqUtil::e_Ncbi4na);
     delete[] buf;
@@ -708,7 +742,7 @@ SIZE_TYPE CSeqManip::ReverseComplement
 
     switch ( src_coding ) {
     case CSeqUtil::e_Iupacna:
-        return revcmp(src, pos, length, CIupacnaCmp::GetTable());
+        return s_IupacnaRevCmp(src, pos, length);
 
     case CSeqUtil::e_Ncbi2na:
         return s_Ncbi2naRevCmp(src, pos, length);
@@ -0,0 +1,509 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Vector kernels for the most common conversions.
+ */
+#include <ncbi_pch.hpp>
+#include <corelib/ncbistd.hpp>
+
+#include "sequtil_simd.hpp"
+#include "sequtil_tables.hpp"
+
+// The kernels are compiled with per-function target attributes, so that
+// the library needs no special compiler flags and still runs on CPUs
+// without SSE4.1.
+#if (defined(__x86_64__)  ||  defined(__i386__))  &&  \
+    (defined(__clang__)  ||  \
+     (defined(__GNUC__)  &&  \
+      (__GNUC__ > 4  ||  (__GNUC__ == 4  &&  __GNUC_MINOR__ >= 9))))
+#  define SEQUTIL_SIMD_X86 1
+#  define SEQUTIL_SSE41 __attribute__((target("sse4.1")))
+#  include <immintrin.h>
+#endif
+
+
+BEGIN_NCBI_SCOPE
+
+
+static volatile int s_DetectedLevel = -1;
+static volatile int s_MaxLevel = CSeqUtil::eSimd_SSE41;
+
+
+static CSeqUtil::ESimdLevel s_DetectLevel(void)
+{
+#ifdef SEQUTIL_SIMD_X86
+    __builtin_cpu_init();
+    if ( __builtin_cpu_supports("sse4.1") ) {
+        return CSeqUtil::eSimd_SSE41;
+    }
+#endif
+    return CSeqUtil::eSimd_None;
+}
+
+
+CSeqUtil::ESimdLevel CSeqUtil::GetSimdLevel(void)
+{
+    if ( s_DetectedLevel < 0 ) {
+        s_DetectedLevel = s_DetectLevel();
+    }
+    return ESimdLevel(min(int(s_DetectedLevel), int(s_MaxLevel)));
+}
+
+
+CSeqUtil::ESimdLevel CSeqUtil::SetMaxSimdLevel(ESimdLevel level)
+{
+    ESimdLevel old_level = ESimdLevel(int(s_MaxLevel));
+    s_MaxLevel = level;
+    return old_level;
+}
+
+
+#ifdef SEQUTIL_SIMD_X86
+
+// shorter inputs are left to the table-driven code
+static const SIZE_TYPE kMinSimdLength = 64;
+
+
+static bool s_UseSimd(SIZE_TYPE length)
+{
+    return length >= kMinSimdLength  &&
+        CSeqUtil::GetSimdLevel() >= CSeqUtil::eSimd_SSE41;
+}
+
+
+// Collect 16 entries of a table with several columns per row:
+// table[(first + i * step) * stride + col], i = 0..15
+static void s_Gather(Uint1* lut, const Uint1* table, size_t stride,
+                     size_t col, size_t first, size_t step)
+{
+    for ( size_t i = 0; i < 16; ++i ) {
+        lut[i] = table[(first + i * step) * stride + col];
+    }
+}
+
+
+// A pair of 16 entry lookups covering the letters: the tables map the
+// bytes 0x40-0x5f and 0x60-0x7f alike, through lo for c & 0x1f < 16
+// and through hi otherwise.
+struct SLetterLut
+{
+    SEQUTIL_SSE41
+    SLetterLut(const Uint1* table, size_t stride, size_t col)
+    {
+        Uint1 lut[16];
+        s_Gather(lut, table, stride, col, 0x40, 1);
+        lo = _mm_loadu_si128((const __m128i*)lut);
+        s_Gather(lut, table, stride, col, 0x50, 1);
+        hi = _mm_loadu_si128((const __m128i*)lut);
+        other = _mm_set1_epi8(char(table[col]));
+    }
+
+    __m128i lo, hi;
+    // value of the bytes outside of 0x40-0x7f
+    __m128i other;
+};
+
+
+SEQUTIL_SSE41 static inline
+__m128i s_LetterIndex(__m128i v, __m128i& in_hi)
+{
+    __m128i idx = _mm_and_si128(v, _mm_set1_epi8(0x1f));
+    // moves bit 4 to bit 7, the one tested by blendv; the bits moved
+    // across byte boundaries are zero
+    in_hi = _mm_slli_epi16(idx, 3);
+    return idx;
+}
+
+
+SEQUTIL_SSE41 static inline
+__m128i s_IsLetter(__m128i v)
+{
+    return _mm_cmpeq_epi8(_mm_and_si128(v, _mm_set1_epi8(char(0xc0))),
+                          _mm_set1_epi8(0x40));
+}
+
+
+SEQUTIL_SSE41 static inline
+__m128i s_Lookup(__m128i v, const SLetterLut& lut)
+{
+    __m128i in_hi;
+    __m128i idx = s_LetterIndex(v, in_hi);
+    __m128i r = _mm_blendv_epi8(_mm_shuffle_epi8(lut.lo, idx),
+                                _mm_shuffle_epi8(lut.hi, idx), in_hi);
+    return _mm_blendv_epi8(lut.other, r, s_IsLetter(v));
+}
+
+
+SEQUTIL_SSE41 static inline
+__m128i s_Load(const char* p)
+{
+    return _mm_loadu_si128((const __m128i*)p);
+}
+
+
+SEQUTIL_SSE41 static inline
+void s_Store(char* p, __m128i v)
+{
+    _mm_storeu_si128((__m128i*)p, v);
+}
+
+
+SEQUTIL_SSE41 static inline
+__m128i s_Reverse(__m128i v)
+{
+    return _mm_shuffle_epi8(v, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                             7, 6, 5, 4, 3, 2, 1, 0));
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_IupacnaTo2na(const char* src, SIZE_TYPE length, char* dst)
+{
+    // column 3 holds the plain 2-bit codes
+    SLetterLut lut(CIupacnaTo2na::GetTable(), 4, 3);
+    // pairs of codes -> 4-bit values -> bytes, first residue highest
+    const __m128i w2 = _mm_set1_epi16(0x0104);
+    const __m128i w4 = _mm_set1_epi32(0x00010010);
+    SIZE_TYPE done = 0;
+    for ( ; done + 64 <= length; done += 64, src += 64, dst += 16 ) {
+        __m128i q0 = _mm_madd_epi16(_mm_maddubs_epi16(
+                         s_Lookup(s_Load(src), lut), w2), w4);
+        __m128i q1 = _mm_madd_epi16(_mm_maddubs_epi16(
+                         s_Lookup(s_Load(src + 16), lut), w2), w4);
+        __m128i q2 = _mm_madd_epi16(_mm_maddubs_epi16(
+                         s_Lookup(s_Load(src + 32), lut), w2), w4);
+        __m128i q3 = _mm_madd_epi16(_mm_maddubs_epi16(
+                         s_Lookup(s_Load(src + 48), lut), w2), w4);
+        s_Store(dst, _mm_packus_epi16(_mm_packs_epi32(q0, q1),
+                                      _mm_packs_epi32(q2, q3)));
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_IupacnaTo4na(const char* src, SIZE_TYPE length, char* dst)
+{
+    // column 1 holds the plain 4-bit codes
+    SLetterLut lut(CIupacnaTo4na::GetTable(), 2, 1);
+    const __m128i w2 = _mm_set1_epi16(0x0110);
+    SIZE_TYPE done = 0;
+    for ( ; done + 32 <= length; done += 32, src += 32, dst += 16 ) {
+        __m128i p0 = _mm_maddubs_epi16(s_Lookup(s_Load(src), lut), w2);
+        __m128i p1 = _mm_maddubs_epi16(s_Lookup(s_Load(src + 16), lut), w2);
+        s_Store(dst, _mm_packus_epi16(p0, p1));
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_ConvertLetters(const char* src, SIZE_TYPE length, char* dst,
+                           const Uint1* table)
+{
+    SLetterLut lut(table, 1, 0);
+    SIZE_TYPE done = 0;
+    for ( ; done + 16 <= length; done += 16 ) {
+        s_Store(dst + done, s_Lookup(s_Load(src + done), lut));
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_2naToIupacna(const char* src, SIZE_TYPE length, char* dst)
+{
+    // the letter of code k starts the row of the byte k << 6
+    const Uint1* table = C2naToIupacna::GetTable();
+    const __m128i lut = _mm_setr_epi8(table[0x00 * 4], table[0x40 * 4],
+                                      table[0x80 * 4], table[0xc0 * 4],
+                                      0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i mask = _mm_set1_epi8(0x03);
+    SIZE_TYPE done = 0;
+    for ( ; done + 64 <= length; done += 64, src += 16, dst += 64 ) {
+        __m128i v = s_Load(src);
+        __m128i r0 = _mm_shuffle_epi8(lut, _mm_and_si128(
+                                          _mm_srli_epi16(v, 6), mask));
+        __m128i r1 = _mm_shuffle_epi8(lut, _mm_and_si128(
+                                          _mm_srli_epi16(v, 4), mask));
+        __m128i r2 = _mm_shuffle_epi8(lut, _mm_and_si128(
+                                          _mm_srli_epi16(v, 2), mask));
+        __m128i r3 = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        __m128i lo01 = _mm_unpacklo_epi8(r0, r1);
+        __m128i hi01 = _mm_unpackhi_epi8(r0, r1);
+        __m128i lo23 = _mm_unpacklo_epi8(r2, r3);
+        __m128i hi23 = _mm_unpackhi_epi8(r2, r3);
+        s_Store(dst,      _mm_unpacklo_epi16(lo01, lo23));
+        s_Store(dst + 16, _mm_unpackhi_epi16(lo01, lo23));
+        s_Store(dst + 32, _mm_unpacklo_epi16(hi01, hi23));
+        s_Store(dst + 48, _mm_unpackhi_epi16(hi01, hi23));
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_4naToIupacna(const char* src, SIZE_TYPE length, char* dst)
+{
+    // the letter of code k starts the row of the byte k << 4
+    Uint1 table[16];
+    s_Gather(table, C4naToIupacna::GetTable(), 2, 0, 0, 0x10);
+    const __m128i lut = _mm_loadu_si128((const __m128i*)table);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    SIZE_TYPE done = 0;
+    for ( ; done + 32 <= length; done += 32, src += 16, dst += 32 ) {
+        __m128i v = s_Load(src);
+        __m128i r0 = _mm_shuffle_epi8(lut, _mm_and_si128(
+                                          _mm_srli_epi16(v, 4), mask));
+        __m128i r1 = _mm_shuffle_epi8(lut, _mm_and_si128(v, mask));
+        s_Store(dst,      _mm_unpacklo_epi8(r0, r1));
+        s_Store(dst + 16, _mm_unpackhi_epi8(r0, r1));
+    }
+    return done;
+}
+
+
+// Codes below 'limit' (16 or 32) are looked up, others get table[limit]
+SEQUTIL_SSE41 static
+SIZE_TYPE s_ConvertCodes(const char* src, SIZE_TYPE length, char* dst,
+                         const Uint1* table, int limit)
+{
+    const __m128i lo = _mm_loadu_si128((const __m128i*)table);
+    const __m128i hi = limit > 16?
+        _mm_loadu_si128((const __m128i*)(table + 16)): lo;
+    const __m128i other = _mm_set1_epi8(char(table[limit]));
+    const __m128i max_code = _mm_set1_epi8(char(limit - 1));
+    SIZE_TYPE done = 0;
+    for ( ; done + 16 <= length; done += 16 ) {
+        __m128i v = s_Load(src + done);
+        __m128i in_hi;
+        __m128i idx = s_LetterIndex(v, in_hi);
+        __m128i r = _mm_blendv_epi8(_mm_shuffle_epi8(lo, idx),
+                                    _mm_shuffle_epi8(hi, idx), in_hi);
+        __m128i valid = _mm_cmpeq_epi8(_mm_min_epu8(v, max_code), v);
+        s_Store(dst + done, _mm_blendv_epi8(other, r, valid));
+    }
+    return done;
+}
+
+
+// IUPACna complement: letters go through the table keeping their case,
+// everything else is left as is
+SEQUTIL_SSE41 static inline
+__m128i s_IupacnaCmp(__m128i v, const SLetterLut& lut)
+{
+    __m128i in_hi;
+    __m128i idx = s_LetterIndex(v, in_hi);
+    __m128i r = _mm_blendv_epi8(_mm_shuffle_epi8(lut.lo, idx),
+                                _mm_shuffle_epi8(lut.hi, idx), in_hi);
+    r = _mm_or_si128(r, _mm_and_si128(v, _mm_set1_epi8(0x20)));
+    return _mm_blendv_epi8(v, r, s_IsLetter(v));
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_IupacnaRevCmp(const char* src, SIZE_TYPE length, char* dst)
+{
+    SLetterLut lut(CIupacnaCmp::GetTable(), 1, 0);
+    const char* end = src + length;
+    SIZE_TYPE done = 0;
+    for ( ; done + 16 <= length; done += 16 ) {
+        __m128i v = s_Reverse(s_Load(end - done - 16));
+        s_Store(dst + done, s_IupacnaCmp(v, lut));
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_IupacnaRevCmpEnds(char* buf, SIZE_TYPE length)
+{
+    SLetterLut lut(CIupacnaCmp::GetTable(), 1, 0);
+    SIZE_TYPE done = 0;
+    for ( ; 2 * (done + 16) <= length; done += 16 ) {
+        char* first = buf + done;
+        char* last = buf + length - done - 16;
+        __m128i f = s_IupacnaCmp(s_Reverse(s_Load(first)), lut);
+        __m128i l = s_IupacnaCmp(s_Reverse(s_Load(last)), lut);
+        s_Store(first, l);
+        s_Store(last, f);
+    }
+    return done;
+}
+
+
+SEQUTIL_SSE41 static
+SIZE_TYPE s_IupacnaUnambigPrefix(const char* src, SIZE_TYPE length)
+{
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i a = _mm_set1_epi8('a');
+    const __m128i c = _mm_set1_epi8('c');
+    const __m128i g = _mm_set1_epi8('g');
+    const __m128i t = _mm_set1_epi8('t');
+    const __m128i u = _mm_set1_epi8('u');
+    SIZE_TYPE done = 0;
+    for ( ; done + 16 <= length; done += 16 ) {
+        __m128i v = _mm_or_si128(s_Load(src + done), lower);
+        __m128i ok = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, a), _mm_cmpeq_epi8(v, c)),
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, g),
+                                      _mm_cmpeq_epi8(v, t)),
+                         _mm_cmpeq_epi8(v, u)));
+        if ( !_mm_test_all_ones(ok) ) {
+            break;
+        }
+    }
+    return done;
+}
+
+#endif
+
+
+SIZE_TYPE simd_iupacna_to_2na(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_IupacnaTo2na(src, length, dst);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacna_to_4na(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_IupacnaTo4na(src, length, dst);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacna_to_8na(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_ConvertLetters(src, length, dst, CIupacnaTo8na::GetTable());
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_2na_to_iupacna(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_2naToIupacna(src, length, dst);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_4na_to_iupacna(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_4naToIupacna(src, length, dst);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_8na_to_iupacna(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_ConvertCodes(src, length, dst,
+                              C8naToIupacna::GetTable(), 16);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacaa_to_stdaa(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_ConvertLetters(src, length, dst,
+                                CIupacaaToStdaa::GetTable());
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_stdaa_to_iupacaa(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_ConvertCodes(src, length, dst,
+                              CStdaaToIupacaa::GetTable(), 32);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacna_revcmp(const char* src, SIZE_TYPE length, char* dst)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_IupacnaRevCmp(src, length, dst);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacna_revcmp_ends(char* buf, SIZE_TYPE length)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_IupacnaRevCmpEnds(buf, length);
+    }
+#endif
+    return 0;
+}
+
+
+SIZE_TYPE simd_iupacna_unambig_prefix(const char* src, SIZE_TYPE length)
+{
+#ifdef SEQUTIL_SIMD_X86
+    if ( s_UseSimd(length) ) {
+        return s_IupacnaUnambigPrefix(src, length);
+    }
+#endif
+    return 0;
+}
+
+
+END_NCBI_SCOPE
@@ -0,0 +1,75 @@
+#ifndef UTIL_SEQUTIL___SEQUTIL_SIMD__HPP
+#define UTIL_SEQUTIL___SEQUTIL_SIMD__HPP
+
+/* $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Vector kernels for the most common conversions.
+ *
+ *   Every kernel handles a prefix of whole vectors and returns the
+ *   number of residues it processed; the caller finishes the rest with
+ *   the table-driven code. Zero is returned when the CPU lacks the
+ *   needed instructions or the input is too short to bother. The
+ *   lookups are loaded from the conversion tables, so the results are
+ *   identical to those of the table-driven code.
+ */
+
+#include <corelib/ncbistd.hpp>
+
+#include <util/sequtil/sequtil.hpp>
+
+
+BEGIN_NCBI_SCOPE
+
+
+// Conversions; src and dst point to the first residue, which must
+// start a byte in the packed codings.
+SIZE_TYPE simd_iupacna_to_2na(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_iupacna_to_4na(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_iupacna_to_8na(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_2na_to_iupacna(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_4na_to_iupacna(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_8na_to_iupacna(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_iupacaa_to_stdaa(const char* src, SIZE_TYPE length, char* dst);
+SIZE_TYPE simd_stdaa_to_iupacaa(const char* src, SIZE_TYPE length, char* dst);
+
+// Reverse complement of IUPACna; converts the last residues of src
+// into the first ones of dst.
+SIZE_TYPE simd_iupacna_revcmp(const char* src, SIZE_TYPE length, char* dst);
+
+// In place reverse complement of IUPACna; returns the number of
+// residues swapped at each end of the buffer.
+SIZE_TYPE simd_iupacna_revcmp_ends(char* buf, SIZE_TYPE length);
+
+// Length of the prefix made of whole vectors of A, C, G, T or U
+// (either case); stops at the first vector holding anything else.
+SIZE_TYPE simd_iupacna_unambig_prefix(const char* src, SIZE_TYPE length);
+
+
+END_NCBI_SCOPE
+
+
+#endif  /* UTIL_SEQUTIL___SEQUTIL_SIMD__HPP */
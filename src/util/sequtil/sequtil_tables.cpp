@@ -2783,104 +2783,104 @@ const Uint1 C2naRevCmp::scm_Table3[256] = {
 // NCBI4na
 const Uint1 C4naRevCmp::scm_Table0[512] = {
     0x0,0x0,  0x0,0x8,  0x0,0x4,  0x0,0xc,
-    0x0,0x2,  0x0,0xa,  0x0,0x9,  0x0,0xe,
-    0x0,0x1,  0x0,0x6,  0x0,0x5,  0x0,0xd,
+    0x0,0x2,  0x0,0xa,  0x0,0x6,  0x0,0xe,
+    0x0,0x1,  0x0,0x9,  0x0,0x5,  0x0,0xd,
     0x0,0x3,  0x0,0xb,  0x0,0x7,  0x0,0xf,
     0x80,0x0,  0x80,0x8,  0x80,0x4,  0x80,0xc,
-    0x80,0x2,  0x80,0xa,  0x80,0x9,  0x80,0xe,
-    0x80,0x1,  0x80,0x6,  0x80,0x5,  0x80,0xd,
+    0x80,0x2,  0x80,0xa,  0x80,0x6,  0x80,0xe,
+    0x80,0x1,  0x80,0x9,  0x80,0x5,  0x80,0xd,
     0x80,0x3,  0x80,0xb,  0x80,0x7,  0x80,0xf,
     0x40,0x0,  0x40,0x8,  0x40,0x4,  0x40,0xc,
-    0x40,0x2,  0x40,0xa,  0x40,0x9,  0x40,0xe,
-    0x40,0x1,  0x40,0x6,  0x40,0x5,  0x40,0xd,
+    0x40,0x2,  0x40,0xa,  0x40,0x6,  0x40,0xe,
+    0x40,0x1,  0x40,0x9,  0x40,0x5,  0x40,0xd,
     0x40,0x3,  0x40,0xb,  0x40,0x7,  0x40,0xf,
     0xc0,0x0,  0xc0,0x8,  0xc0,0x4,  0xc0,0xc,
-    0xc0,0x2,  0xc0,0xa,  0xc0,0x9,  0xc0,0xe,
-    0xc0,0x1,  0xc0,0x6,  0xc0,0x5,  0xc0,0xd,
+    0xc0,0x2,  0xc0,0xa,  0xc0,0x6,  0xc0,0xe,
+    0xc0,0x1,  0xc0,0x9,  0xc0,0x5,  0xc0,0xd,
     0xc0,0x3,  0xc0,0xb,  0xc0,0x7,  0xc0,0xf,
     0x20,0x0,  0x20,0x8,  0x20,0x4,  0x20,0xc,
-    0x20,0x2,  0x20,0xa,  0x20,0x9,  0x20,0xe,
-    0x20,0x1,  0x20,0x6,  0x20,0x5,  0x20,0xd,
+    0x20,0x2,  0x20,0xa,  0x20,0x6,  0x20,0xe,
+    0x20,0x1,  0x20,0x9,  0x20,0x5,  0x20,0xd,
     0x20,0x3,  0x20,0xb,  0x20,0x7,  0x20,0xf,
     0xa0,0x0,  0xa0,0x8,  0xa0,0x4,  0xa0,0xc,
-    0xa0,0x2,  0xa0,0xa,  0xa0,0x9,  0xa0,0xe,
-    0xa0,0x1,  0xa0,0x6,  0xa0,0x5,  0xa0,0xd,
+    0xa0,0x2,  0xa0,0xa,  0xa0,0x6,  0xa0,0xe,
+    0xa0,0x1,  0xa0,0x9,  0xa0,0x5,  0xa0,0xd,
     0xa0,0x3,  0xa0,0xb,  0xa0,0x7,  0xa0,0xf,
-    0x90,0x0,  0x90,0x8,  0x90,0x4,  0x90,0xc,
-    0x90,0x2,  0x90,0xa,  0x90,0x9,  0x90,0xe,
-    0x90,0x1,  0x90,0x6,  0x90,0x5,  0x90,0xd,
-    0x90,0x3,  0x90,0xb,  0x90,0x7,  0x90,0xf,
+    0x60,0x0,  0x60,0x8,  0x60,0x4,  0x60,0xc,
+    0x60,0x2,  0x60,0xa,  0x60,0x6,  0x60,0xe,
+    0x60,0x1,  0x60,0x9,  0x60,0x5,  0x60,0xd,
+    0x60,0x3,  0x60,0xb,  0x60,0x7,  0x60,0xf,
     0xe0,0x0,  0xe0,0x8,  0xe0,0x4,  0xe0,0xc,
-    0xe0,0x2,  0xe0,0xa,  0xe0,0x9,  0xe0,0xe,
-    0xe0,0x1,  0xe0,0x6,  0xe0,0x5,  0xe0,0xd,
+    0xe0,0x2,  0xe0,0xa,  0xe0,0x6,  0xe0,0xe,
+    0xe0,0x1,  0xe0,0x9,  0xe0,0x5,  0xe0,0xd,
     0xe0,0x3,  0xe0,0xb,  0xe0,0x7,  0xe0,0xf,
     0x10,0x0,  0x10,0x8,  0x10,0x4,  0x10,0xc,
-    0x10,0x2,  0x10,0xa,  0x10,0x9,  0x10,0xe,
-    0x10,0x1,  0x10,0x6,  0x10,0x5,  0x10,0xd,
+    0x10,0x2,  0x10,0xa,  0x10,0x6,  0x10,0xe,
+    0x10,0x1,  0x10,0x9,  0x10,0x5,  0x10,0xd,
     0x10,0x3,  0x10,0xb,  0x10,0x7,  0x10,0xf,
-    0x60,0x0,  0x60,0x8,  0x60,0x4,  0x60,0xc,
-    0x60,0x2,  0x60,0xa,  0x60,0x9,  0x60,0xe,
-    0x60,0x1,  0x60,0x6,  0x60,0x5,  0x60,0xd,
-    0x60,0x3,  0x60,0xb,  0x60,0x7,  0x60,0xf,
+    0x90,0x0,  0x90,0x8,  0x90,0x4,  0x90,0xc,
+    0x90,0x2,  0x90,0xa,  0x90,0x6,  0x90,0xe,
+    0x90,0x1,  0x90,0x9,  0x90,0x5,  0x90,0xd,
+    0x90,0x3,  0x90,0xb,  0x90,0x7,  0x90,0xf,
     0x50,0x0,  0x50,0x8,  0x50,0x4,  0x50,0xc,
-    0x50,0x2,  0x50,0xa,  0x50,0x9,  0x50,0xe,
-    0x50,0x1,  0x50,0x6,  0x50,0x5,  0x50,0xd,
+    0x50,0x2,  0x50,0xa,  0x50,0x6,  0x50,0xe,
+    0x50,0x1,  0x50,0x9,  0x50,0x5,  0x50,0xd,
     0x50,0x3,  0x50,0xb,  0x50,0x7,  0x50,0xf,
     0xd0,0x0,  0xd0,0x8,  0xd0,0x4,  0xd0,0xc,
-    0xd0,0x2,  0xd0,0xa,  0xd0,0x9,  0xd0,0xe,
-    0xd0,0x1,  0xd0,0x6,  0xd0,0x5,  0xd0,0xd,
+    0xd0,0x2,  0xd0,0xa,  0xd0,0x6,  0xd0,0xe,
+    0xd0,0x1,  0xd0,0x9,  0xd0,0x5,  0xd0,0xd,
     0xd0,0x3,  0xd0,0xb,  0xd0,0x7,  0xd0,0xf,
     0x30,0x0,  0x30,0x8,  0x30,0x4,  0x30,0xc,
-    0x30,0x2,  0x30,0xa,  0x30,0x9,  0x30,0xe,
-    0x30,0x1,  0x30,0x6,  0x30,0x5,  0x30,0xd,
+    0x30,0x2,  0x30,0xa,  0x30,0x6,  0x30,0xe,
+    0x30,0x1,  0x30,0x9,  0x30,0x5,  0x30,0xd,
     0x30,0x3,  0x30,0xb,  0x30,0x7,  0x30,0xf,
     0xb0,0x0,  0xb0,0x8,  0xb0,0x4,  0xb0,0xc,
-    0xb0,0x2,  0xb0,0xa,  0xb0,0x9,  0xb0,0xe,
-    0xb0,0x1,  0xb0,0x6,  0xb0,0x5,  0xb0,0xd,
+    0xb0,0x2,  0xb0,0xa,  0xb0,0x6,  0xb0,0xe,
+    0xb0,0x1,  0xb0,0x9,  0xb0,0x5,  0xb0,0xd,
     0xb0,0x3,  0xb0,0xb,  0xb0,0x7,  0xb0,0xf,
     0x70,0x0,  0x70,0x8,  0x70,0x4,  0x70,0xc,
-    0x70,0x2,  0x70,0xa,  0x70,0x9,  0x70,0xe,
-    0x70,0x1,  0x70,0x6,  0x70,0x5,  0x70,0xd,
+    0x70,0x2,  0x70,0xa,  0x70,0x6,  0x70,0xe,
+    0x70,0x1,  0x70,0x9,  0x70,0x5,  0x70,0xd,
     0x70,0x3,  0x70,0xb,  0x70,0x7,  0x70,0xf,
     0xf0,0x0,  0xf0,0x8,  0xf0,0x4,  0xf0,0xc,
-    0xf0,0x2,  0xf0,0xa,  0xf0,0x9,  0xf0,0xe,
-    0xf0,0x1,  0xf0,0x6,  0xf0,0x5,  0xf0,0xd,
+    0xf0,0x2,  0xf0,0xa,  0xf0,0x6,  0xf0,0xe,
+    0xf0,0x1,  0xf0,0x9,  0xf0,0x5,  0xf0,0xd,
     0xf0,0x3,  0xf0,0xb,  0xf0,0x7,  0xf0,0xf
 };
 
 const Uint1 C4naRevCmp::scm_Table1[256] = {
-    0x0, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x90, 0xe0,
-    0x10, 0x60, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
-    0x8, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x98, 0xe8,
-    0x18, 0x68, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
-    0x4, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x94, 0xe4,
-    0x14, 0x64, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
-    0xc, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x9c, 0xec,
-    0x1c, 0x6c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
-    0x2, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x92, 0xe2,
-    0x12, 0x62, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
-    0xa, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x9a, 0xea,
-    0x1a, 0x6a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
-    0x9, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x99, 0xe9,
-    0x19, 0x69, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
-    0xe, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x9e, 0xee,
-    0x1e, 0x6e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
-    0x1, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x91, 0xe1,
-    0x11, 0x61, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
-    0x6, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x96, 0xe6,
-    0x16, 0x66, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
-    0x5, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x95, 0xe5,
-    0x15, 0x65, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
-    0xd, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x9d, 0xed,
-    0x1d, 0x6d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
-    0x3, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x93, 0xe3,
-    0x13, 0x63, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
-    0xb, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x9b, 0xeb,
-    0x1b, 0x6b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
-    0x7, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x97, 0xe7,
-    0x17, 0x67, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
-    0xf, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x9f, 0xef,
-    0x1f, 0x6f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
+    0x0, 0x80, 0x40, 0xc0, 0x20, 0xa0, 0x60, 0xe0,
+    0x10, 0x90, 0x50, 0xd0, 0x30, 0xb0, 0x70, 0xf0,
+    0x8, 0x88, 0x48, 0xc8, 0x28, 0xa8, 0x68, 0xe8,
+    0x18, 0x98, 0x58, 0xd8, 0x38, 0xb8, 0x78, 0xf8,
+    0x4, 0x84, 0x44, 0xc4, 0x24, 0xa4, 0x64, 0xe4,
+    0x14, 0x94, 0x54, 0xd4, 0x34, 0xb4, 0x74, 0xf4,
+    0xc, 0x8c, 0x4c, 0xcc, 0x2c, 0xac, 0x6c, 0xec,
+    0x1c, 0x9c, 0x5c, 0xdc, 0x3c, 0xbc, 0x7c, 0xfc,
+    0x2, 0x82, 0x42, 0xc2, 0x22, 0xa2, 0x62, 0xe2,
+    0x12, 0x92, 0x52, 0xd2, 0x32, 0xb2, 0x72, 0xf2,
+    0xa, 0x8a, 0x4a, 0xca, 0x2a, 0xaa, 0x6a, 0xea,
+    0x1a, 0x9a, 0x5a, 0xda, 0x3a, 0xba, 0x7a, 0xfa,
+    0x6, 0x86, 0x46, 0xc6, 0x26, 0xa6, 0x66, 0xe6,
+    0x16, 0x96, 0x56, 0xd6, 0x36, 0xb6, 0x76, 0xf6,
+    0xe, 0x8e, 0x4e, 0xce, 0x2e, 0xae, 0x6e, 0xee,
+    0x1e, 0x9e, 0x5e, 0xde, 0x3e, 0xbe, 0x7e, 0xfe,
+    0x1, 0x81, 0x41, 0xc1, 0x21, 0xa1, 0x61, 0xe1,
+    0x11, 0x91, 0x51, 0xd1, 0x31, 0xb1, 0x71, 0xf1,
+    0x9, 0x89, 0x49, 0xc9, 0x29, 0xa9, 0x69, 0xe9,
+    0x19, 0x99, 0x59, 0xd9, 0x39, 0xb9, 0x79, 0xf9,
+    0x5, 0x85, 0x45, 0xc5, 0x25, 0xa5, 0x65, 0xe5,
+    0x15, 0x95, 0x55, 0xd5, 0x35, 0xb5, 0x75, 0xf5,
+    0xd, 0x8d, 0x4d, 0xcd, 0x2d, 0xad, 0x6d, 0xed,
+    0x1d, 0x9d, 0x5d, 0xdd, 0x3d, 0xbd, 0x7d, 0xfd,
+    0x3, 0x83, 0x43, 0xc3, 0x23, 0xa3, 0x63, 0xe3,
+    0x13, 0x93, 0x53, 0xd3, 0x33, 0xb3, 0x73, 0xf3,
+    0xb, 0x8b, 0x4b, 0xcb, 0x2b, 0xab, 0x6b, 0xeb,
+    0x1b, 0x9b, 0x5b, 0xdb, 0x3b, 0xbb, 0x7b, 0xfb,
+    0x7, 0x87, 0x47, 0xc7, 0x27, 0xa7, 0x67, 0xe7,
+    0x17, 0x97, 0x57, 0xd7, 0x37, 0xb7, 0x77, 0xf7,
+    0xf, 0x8f, 0x4f, 0xcf, 0x2f, 0xaf, 0x6f, 0xef,
+    0x1f, 0x9f, 0x5f, 0xdf, 0x3f, 0xbf, 0x7f, 0xff
 };
 
 /////////////////////////////////////////////////////////////////////////////
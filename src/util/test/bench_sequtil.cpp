@@ -0,0 +1,262 @@
+/*  $Id$
+ * ===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ * File Description:
+ *   Throughput of CSeqConvert and CSeqManip for every pair of codings,
+ *   with the table-driven code and with the vector kernels
+ *
+ */
+
+#include <ncbi_pch.hpp>
+#include <corelib/ncbiapp.hpp>
+#include <corelib/ncbiargs.hpp>
+#include <corelib/ncbitime.hpp>
+#include <util/random_gen.hpp>
+#include <util/sequtil/sequtil_convert.hpp>
+#include <util/sequtil/sequtil_manip.hpp>
+#include <util/sequtil/sequtil_expt.hpp>
+
+
+USING_NCBI_SCOPE;
+
+
+struct SCodingInfo
+{
+    CSeqUtil::TCoding  coding;
+    const char*        name;
+};
+
+static const SCodingInfo kNaCodings[] = {
+    { CSeqUtil::e_Iupacna,         "iupacna" },
+    { CSeqUtil::e_Ncbi2na,         "ncbi2na" },
+    { CSeqUtil::e_Ncbi2na_expand,  "ncbi2na_expand" },
+    { CSeqUtil::e_Ncbi4na,         "ncbi4na" },
+    { CSeqUtil::e_Ncbi8na,         "ncbi8na" }
+};
+
+static const SCodingInfo kAaCodings[] = {
+    { CSeqUtil::e_Iupacaa,    "iupacaa" },
+    { CSeqUtil::e_Ncbi8aa,    "ncbi8aa" },
+    { CSeqUtil::e_Ncbieaa,    "ncbieaa" },
+    { CSeqUtil::e_Ncbistdaa,  "ncbistdaa" }
+};
+
+
+/////////////////////////////////////////////////////////////////////////////
+//  Application
+
+
+class CSequtilBenchApp : public CNcbiApplication
+{
+public:
+    virtual void Init(void);
+    virtual int  Run(void);
+
+private:
+    typedef CSeqUtil::ESimdLevel TLevel;
+
+    void x_BenchCodings(const string& sample,
+                        CSeqUtil::TCoding sample_coding,
+                        const SCodingInfo* codings, size_t count);
+    void x_BenchRevCmp(const string& sample,
+                       CSeqUtil::TCoding sample_coding,
+                       const SCodingInfo* codings, size_t count);
+    void x_Report(const string& op, const string& from, const string& to,
+                  double table_time, double simd_time,
+                  bool same);
+
+    TSeqPos  m_Length;
+    int      m_Repeats;
+    TLevel   m_Level;
+    int      m_Mismatches;
+};
+
+
+void CSequtilBenchApp::Init(void)
+{
+    auto_ptr<CArgDescriptions> arg_desc(new CArgDescriptions);
+    arg_desc->SetUsageContext(GetArguments().GetProgramBasename(),
+                              "CSeqConvert and CSeqManip throughput");
+
+    arg_desc->AddDefaultKey("length", "Residues",
+                            "Length of the sample sequences",
+                            CArgDescriptions::eInteger, "4000000");
+    arg_desc->AddDefaultKey("repeats", "Count",
+                            "Number of times each operation is timed",
+                            CArgDescriptions::eInteger, "5");
+    arg_desc->AddDefaultKey("ambig", "Percent",
+                            "Percentage of ambiguous nucleotides",
+                            CArgDescriptions::eDouble, "0.1");
+
+    SetupArgDescriptions(arg_desc.release());
+}
+
+
+void CSequtilBenchApp::x_Report(const string& op,
+                                const string& from, const string& to,
+                                double table_time, double simd_time,
+                                bool same)
+{
+    double mb = double(m_Length) * m_Repeats / 1e6;
+    cout << op << '\t' << from << '\t' << to << '\t'
+         << NStr::DoubleToString(mb / table_time, 1) << '\t'
+         << NStr::DoubleToString(mb / simd_time, 1) << '\t'
+         << NStr::DoubleToString(table_time / simd_time, 2)
+         << (same ? "" : "\tMISMATCH") << endl;
+    if ( !same ) {
+        ++m_Mismatches;
+    }
+}
+
+
+void CSequtilBenchApp::x_BenchCodings(const string& sample,
+                                      CSeqUtil::TCoding sample_coding,
+                                      const SCodingInfo* codings,
+                                      size_t count)
+{
+    for ( size_t i = 0; i < count; ++i ) {
+        string src;
+        CSeqConvert::Convert(sample, sample_coding, 0, m_Length,
+                             src, codings[i].coding);
+        for ( size_t j = 0; j < count; ++j ) {
+            string dst[2];
+            double elapsed[2];
+            try {
+                for ( int pass = 0; pass < 2; ++pass ) {
+                    CSeqUtil::SetMaxSimdLevel(pass ? m_Level
+                                              : CSeqUtil::eSimd_None);
+                    // warm up, so that the allocation is not timed
+                    CSeqConvert::Convert(src, codings[i].coding,
+                                         0, m_Length,
+                                         dst[pass], codings[j].coding);
+                    CStopWatch sw(CStopWatch::eStart);
+                    for ( int r = 0; r < m_Repeats; ++r ) {
+                        CSeqConvert::Convert(src, codings[i].coding,
+                                             0, m_Length,
+                                             dst[pass], codings[j].coding);
+                    }
+                    elapsed[pass] = sw.Elapsed();
+                }
+            }
+            catch ( CSeqUtilException& ) {
+                // no such conversion
+                continue;
+            }
+            x_Report("convert", codings[i].name, codings[j].name,
+                     elapsed[0], elapsed[1], dst[0] == dst[1]);
+        }
+    }
+}
+
+
+void CSequtilBenchApp::x_BenchRevCmp(const string& sample,
+                                     CSeqUtil::TCoding sample_coding,
+                                     const SCodingInfo* codings,
+                                     size_t count)
+{
+    for ( size_t i = 0; i < count; ++i ) {
+        string src;
+        CSeqConvert::Convert(sample, sample_coding, 0, m_Length,
+                             src, codings[i].coding);
+        string dst[2];
+        string buf[2];
+        double elapsed[2];
+        double in_place[2];
+        for ( int pass = 0; pass < 2; ++pass ) {
+            CSeqUtil::SetMaxSimdLevel(pass ? m_Level : CSeqUtil::eSimd_None);
+            CSeqManip::ReverseComplement(src, codings[i].coding,
+                                         0, m_Length, dst[pass]);
+            CStopWatch sw(CStopWatch::eStart);
+            for ( int r = 0; r < m_Repeats; ++r ) {
+                CSeqManip::ReverseComplement(src, codings[i].coding,
+                                             0, m_Length, dst[pass]);
+            }
+            elapsed[pass] = sw.Elapsed();
+
+            buf[pass] = src;
+            sw.Restart();
+            for ( int r = 0; r < m_Repeats; ++r ) {
+                CSeqManip::ReverseComplement(buf[pass], codings[i].coding,
+                                             0, m_Length);
+            }
+            in_place[pass] = sw.Elapsed();
+        }
+        x_Report("revcmp", codings[i].name, codings[i].name,
+                 elapsed[0], elapsed[1], dst[0] == dst[1]);
+        x_Report("revcmp_in_place", codings[i].name, codings[i].name,
+                 in_place[0], in_place[1], buf[0] == buf[1]);
+    }
+}
+
+
+int CSequtilBenchApp::Run(void)
+{
+    const CArgs& args = GetArgs();
+    m_Length = args["length"].AsInteger();
+    m_Repeats = args["repeats"].AsInteger();
+    m_Level = CSeqUtil::GetSimdLevel();
+    m_Mismatches = 0;
+    double ambig = args["ambig"].AsDouble() / 100;
+
+    CRandom rnd(1);
+    const char kBases[] = "ACGT";
+    const char kAmbig[] = "NRYKMSWBDHV";
+    string na(m_Length, 'A');
+    NON_CONST_ITERATE ( string, it, na ) {
+        if ( rnd.GetRand(0, 1000000) < ambig * 1000000 ) {
+            *it = kAmbig[rnd.GetRand(0, sizeof(kAmbig) - 2)];
+        }
+        else {
+            *it = kBases[rnd.GetRand(0, 3)];
+        }
+    }
+    const char kResidues[] = "ACDEFGHIKLMNPQRSTVWYBZX";
+    string aa(m_Length, 'A');
+    NON_CONST_ITERATE ( string, it, aa ) {
+        *it = kResidues[rnd.GetRand(0, sizeof(kResidues) - 2)];
+    }
+
+    cout << "# vector level: " << m_Level << endl;
+    cout << "op\tfrom\tto\ttable MB/s\tsimd MB/s\tspeedup" << endl;
+    x_BenchCodings(na, CSeqUtil::e_Iupacna,
+                   kNaCodings, ArraySize(kNaCodings));
+    x_BenchCodings(aa, CSeqUtil::e_Iupacaa,
+                   kAaCodings, ArraySize(kAaCodings));
+    x_BenchRevCmp(na, CSeqUtil::e_Iupacna,
+                  kNaCodings, ArraySize(kNaCodings));
+
+    if ( m_Mismatches ) {
+        ERR_POST("Results differ from the table-driven code: "
+                 << m_Mismatches);
+        return 1;
+    }
+    return 0;
+}
+
+
+int main(int argc, const char* argv[])
+{
+    return CSequtilBenchApp().AppMain(argc, argv);
+}
@@ -0,0 +1,358 @@
+/*  $Id$
+* ===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+* File Description:
+*   Unit test for CSeqConvert and CSeqManip: the vector code must give
+*   the same results as the table-driven code
+*
+* ===========================================================================
+*/
+
+#include <ncbi_pch.hpp>
+
+#include <util/random_gen.hpp>
+#include <util/sequtil/sequtil_convert.hpp>
+#include <util/sequtil/sequtil_manip.hpp>
+#include <util/sequtil/sequtil_expt.hpp>
+
+// This header must be included before all Boost.Test headers if there are any
+#include <corelib/test_boost.hpp>
+
+
+USING_NCBI_SCOPE;
+
+
+static const CSeqUtil::TCoding kNaCodings[] = {
+    CSeqUtil::e_Iupacna,
+    CSeqUtil::e_Ncbi2na,
+    CSeqUtil::e_Ncbi2na_expand,
+    CSeqUtil::e_Ncbi4na,
+    CSeqUtil::e_Ncbi4na_expand,
+    CSeqUtil::e_Ncbi8na
+};
+
+static const CSeqUtil::TCoding kAaCodings[] = {
+    CSeqUtil::e_Iupacaa,
+    CSeqUtil::e_Ncbi8aa,
+    CSeqUtil::e_Ncbieaa,
+    CSeqUtil::e_Ncbistdaa
+};
+
+// Offsets into the source; odd ones and ones that are not a multiple of
+// the residues per byte of the packed codings
+static const TSeqPos kOffsets[] = { 0, 1, 2, 3, 5, 7, 17 };
+
+// Lengths below, at and above the shortest input given to the vector code,
+// and around multiples of the vector width
+static const TSeqPos kLengths[] = {
+    0, 1, 2, 3, 4, 5, 7, 15, 16, 17, 31, 33, 63, 64, 65, 66, 67,
+    127, 128, 129, 131, 255, 256, 257, 259, 1001
+};
+
+
+// Best instruction set of the CPU, before any test limits it
+static const CSeqUtil::ESimdLevel kBestLevel = CSeqUtil::GetSimdLevel();
+
+
+// Number of distinct byte values valid in a coding
+static int s_NumValues(CSeqUtil::TCoding coding)
+{
+    switch ( coding ) {
+    case CSeqUtil::e_Ncbi2na_expand:
+        return 4;
+    case CSeqUtil::e_Ncbi4na_expand:
+    case CSeqUtil::e_Ncbi8na:
+        return 16;
+    default:
+        // character codings map every byte, and every byte of a packed
+        // coding is a valid group of residues
+        return 256;
+    }
+}
+
+
+// Source data with every valid byte value, in random order; packed codings
+// only use the beginning
+static string s_AllBytes(CSeqUtil::TCoding coding)
+{
+    const int kValues = s_NumValues(coding);
+    CRandom rnd(1);
+    string data;
+    while ( data.size() < 2048 ) {
+        string bytes(kValues, '\0');
+        for ( int i = 0; i < kValues; ++i ) {
+            bytes[i] = char(i);
+        }
+        for ( int i = kValues - 1; i > 0; --i ) {
+            swap(bytes[i], bytes[rnd.GetRand(0, i)]);
+        }
+        data += bytes;
+    }
+    return data;
+}
+
+
+// Number of bytes holding length residues of a coding starting at pos
+static size_t s_Bytes(CSeqUtil::TCoding coding, TSeqPos pos, TSeqPos length)
+{
+    switch ( coding ) {
+    case CSeqUtil::e_Ncbi2na:
+        return (pos + length + 3) / 4;
+    case CSeqUtil::e_Ncbi4na:
+        return (pos + length + 1) / 2;
+    default:
+        return pos + length;
+    }
+}
+
+
+// Convert with the vector code enabled or disabled
+static bool s_Convert(const string& src, CSeqUtil::TCoding src_coding,
+                      TSeqPos pos, TSeqPos length,
+                      vector<char>& dst, CSeqUtil::TCoding dst_coding,
+                      CSeqUtil::ESimdLevel level)
+{
+    CSeqUtil::SetMaxSimdLevel(level);
+    dst.assign(length + 16, '\x5a');
+    try {
+        CSeqConvert::Convert(src.data(), src_coding, pos, length,
+                             &dst[0], dst_coding);
+    }
+    catch ( CSeqUtilException& ) {
+        // no such conversion
+        CSeqUtil::SetMaxSimdLevel(kBestLevel);
+        return false;
+    }
+    CSeqUtil::SetMaxSimdLevel(kBestLevel);
+    return true;
+}
+
+
+static void s_CheckConversions(const CSeqUtil::TCoding* codings,
+                               size_t count)
+{
+    for ( size_t i = 0; i < count; ++i ) {
+        const string kData = s_AllBytes(codings[i]);
+        for ( size_t j = 0; j < count; ++j ) {
+            ITERATE_0_IDX ( p, ArraySize(kOffsets) ) {
+                ITERATE_0_IDX ( l, ArraySize(kLengths) ) {
+                    TSeqPos pos = kOffsets[p];
+                    TSeqPos length = kLengths[l];
+                    if ( s_Bytes(codings[i], pos, length) > kData.size() ) {
+                        continue;
+                    }
+                    vector<char> table, simd;
+                    if ( !s_Convert(kData, codings[i], pos, length,
+                                    table, codings[j],
+                                    CSeqUtil::eSimd_None) ) {
+                        break;
+                    }
+                    s_Convert(kData, codings[i], pos, length,
+                              simd, codings[j], kBestLevel);
+                    BOOST_CHECK_MESSAGE(table == simd,
+                                        "coding " << codings[i] << " to "
+                                        << codings[j] << ", pos " << pos
+                                        << ", length " << length);
+                }
+            }
+        }
+    }
+}
+
+
+BOOST_AUTO_TEST_CASE(ConvertNa)
+{
+    s_CheckConversions(kNaCodings, ArraySize(kNaCodings));
+}
+
+
+BOOST_AUTO_TEST_CASE(ConvertAa)
+{
+    s_CheckConversions(kAaCodings, ArraySize(kAaCodings));
+}
+
+
+// Reverse complement into a separate buffer and in place, with the vector
+// code enabled or disabled
+static void s_RevCmp(const string& src, CSeqUtil::TCoding coding,
+                     TSeqPos pos, TSeqPos length,
+                     vector<char>& dst, string& in_place,
+                     CSeqUtil::ESimdLevel level)
+{
+    CSeqUtil::SetMaxSimdLevel(level);
+    dst.assign(length + 16, '\x5a');
+    CSeqManip::ReverseComplement(src.data(), coding, pos, length, &dst[0]);
+    in_place = src;
+    CSeqManip::ReverseComplement(&in_place[0], coding, pos, length);
+    CSeqUtil::SetMaxSimdLevel(kBestLevel);
+}
+
+
+BOOST_AUTO_TEST_CASE(ReverseComplement)
+{
+    ITERATE_0_IDX ( i, ArraySize(kNaCodings) ) {
+        CSeqUtil::TCoding coding = kNaCodings[i];
+        const string kData = s_AllBytes(coding);
+        ITERATE_0_IDX ( p, ArraySize(kOffsets) ) {
+            ITERATE_0_IDX ( l, ArraySize(kLengths) ) {
+                TSeqPos pos = kOffsets[p];
+                TSeqPos length = kLengths[l];
+                // empty ranges are left to the callers of the char*
+                // overloads
+                if ( length == 0  ||
+                     s_Bytes(coding, pos, length) > kData.size() ) {
+                    continue;
+                }
+                vector<char> table, simd;
+                string table_in_place, simd_in_place;
+                s_RevCmp(kData, coding, pos, length,
+                         table, table_in_place, CSeqUtil::eSimd_None);
+                s_RevCmp(kData, coding, pos, length,
+                         simd, simd_in_place, kBestLevel);
+                BOOST_CHECK_MESSAGE(table == simd,
+                                    "coding " << coding << ", pos " << pos
+                                    << ", length " << length);
+                BOOST_CHECK_MESSAGE(table_in_place == simd_in_place,
+                                    "in place, coding " << coding
+                                    << ", pos " << pos
+                                    << ", length " << length);
+
+                // in place, the result is moved to the start of the buffer
+                vector<char> residues, in_place_residues;
+                s_Convert(string(table.begin(), table.end()), coding,
+                          0, length, residues, CSeqUtil::e_Ncbi8na,
+                          CSeqUtil::eSimd_None);
+                s_Convert(table_in_place, coding, 0, length,
+                          in_place_residues, CSeqUtil::e_Ncbi8na,
+                          CSeqUtil::eSimd_None);
+                BOOST_CHECK_MESSAGE(residues == in_place_residues,
+                                    "in place vs copy, coding " << coding
+                                    << ", pos " << pos
+                                    << ", length " << length);
+            }
+        }
+    }
+}
+
+
+// The in-place ncbi2na_expand reverse complement used to swap in the byte
+// following the range
+BOOST_AUTO_TEST_CASE(Ncbi2naExpandRevCmpInPlace)
+{
+    ITERATE_0_IDX ( i, 2 ) {
+        CSeqUtil::SetMaxSimdLevel(i ? kBestLevel : CSeqUtil::eSimd_None);
+        char buf[] = { 0, 1, 2, 3, 1, 0x7f };
+        CSeqManip::ReverseComplement(buf, CSeqUtil::e_Ncbi2na_expand, 0, 5);
+        const char kExpected[] = { 2, 0, 1, 2, 3, 0x7f };
+        BOOST_CHECK_EQUAL_COLLECTIONS(buf, buf + sizeof(buf),
+                                      kExpected,
+                                      kExpected + sizeof(kExpected));
+
+        char odd[] = { 0x7f, 0, 0, 1, 0x7f };
+        CSeqManip::ReverseComplement(odd, CSeqUtil::e_Ncbi2na_expand, 1, 3);
+        const char kOddExpected[] = { 2, 3, 3, 3, 0x7f };
+        BOOST_CHECK_EQUAL_COLLECTIONS(odd, odd + sizeof(odd),
+                                      kOddExpected,
+                                      kOddExpected + sizeof(kOddExpected));
+    }
+    CSeqUtil::SetMaxSimdLevel(kBestLevel);
+}
+
+
+// The in-place ncbi2na reverse complement of a range not starting at 0
+// used to read past its temporary buffer
+BOOST_AUTO_TEST_CASE(Ncbi2naRevCmpInPlaceOffset)
+{
+    // ACGT TGCA
+    char buf[] = { 0x1b, char(0xe4) };
+    CSeqManip::ReverseComplement(buf, CSeqUtil::e_Ncbi2na, 2, 5);
+    // GTTGC -> GCAAC, moved to the start
+    vector<char> iupac;
+    s_Convert(string(buf, sizeof(buf)), CSeqUtil::e_Ncbi2na, 0, 5,
+              iupac, CSeqUtil::e_Iupacna, kBestLevel);
+    BOOST_CHECK_EQUAL(string(&iupac[0], 5), string("GCAAC"));
+}
+
+
+// S and W are their own complements; the ncbi4na reverse complement
+// tables used to swap them
+BOOST_AUTO_TEST_CASE(Ncbi4naRevCmpSelfComplementary)
+{
+    // SWAC
+    const char kSrc[] = { 0x69, 0x12 };
+    char dst[2];
+    CSeqManip::ReverseComplement(kSrc, CSeqUtil::e_Ncbi4na, 0, 4, dst);
+    // GTWS
+    BOOST_CHECK_EQUAL(Uint1(dst[0]), 0x48);
+    BOOST_CHECK_EQUAL(Uint1(dst[1]), 0x96);
+
+    // odd offset: WAC -> GTW
+    CSeqManip::ReverseComplement(kSrc, CSeqUtil::e_Ncbi4na, 1, 3, dst);
+    BOOST_CHECK_EQUAL(Uint1(dst[0]), 0x48);
+    BOOST_CHECK_EQUAL(Uint1(dst[1]), 0x90);
+}
+
+
+// Bytes above 0x7f used to index the IUPACna to ncbi2na and ncbi4na tables
+// with a negative offset, except in the last partial byte; every complete
+// byte must match the residues converted one at a time (the bad reads
+// themselves only show under an address sanitizer)
+BOOST_AUTO_TEST_CASE(IupacnaHighBytes)
+{
+    string src;
+    for ( int c = 0x80; c < 0x100; ++c ) {
+        src += char(c);
+    }
+    src += "ACGTNacgtn";
+
+    ITERATE_0_IDX ( i, 2 ) {
+        CSeqUtil::ESimdLevel level = i ? kBestLevel : CSeqUtil::eSimd_None;
+        TSeqPos length = TSeqPos(src.size());
+
+        vector<char> packed2, packed4;
+        s_Convert(src, CSeqUtil::e_Iupacna, 0, length,
+                  packed2, CSeqUtil::e_Ncbi2na, level);
+        s_Convert(src, CSeqUtil::e_Iupacna, 0, length,
+                  packed4, CSeqUtil::e_Ncbi4na, level);
+
+        for ( TSeqPos k = 0; k < length; ++k ) {
+            vector<char> one2, one4;
+            s_Convert(src, CSeqUtil::e_Iupacna, k, 1,
+                      one2, CSeqUtil::e_Ncbi2na, CSeqUtil::eSimd_None);
+            s_Convert(src, CSeqUtil::e_Iupacna, k, 1,
+                      one4, CSeqUtil::e_Ncbi4na, CSeqUtil::eSimd_None);
+            int shift2 = 6 - 2 * (k % 4);
+            int shift4 = 4 - 4 * (k % 2);
+            BOOST_CHECK_MESSAGE(
+                ((Uint1(packed2[k / 4]) >> shift2) & 0x03) ==
+                (Uint1(one2[0]) >> 6),
+                "ncbi2na, byte " << k << ", level " << level);
+            BOOST_CHECK_MESSAGE(
+                ((Uint1(packed4[k / 2]) >> shift4) & 0x0f) ==
+                (Uint1(one4[0]) >> 4),
+                "ncbi4na, byte " << k << ", level " << level);
+        }
+    }
+}
@@ -36,6 +36,7 @@
 #include <corelib/ncbiargs.hpp>
 #include <corelib/ncbiutil.hpp>
 #include <util/rangemap.hpp>
+#include <util/rangemap_index.hpp>
 #include <util/itree.hpp>
 #include <stdlib.h>
 
@@ -52,6 +53,7 @@ public:
     int Run(void);
 
     void TestRangeMap(void) const;
+    void TestRangeMapIndex(void) const;
     void TestIntervalTree(void) const;
 
     void Filling(const char* type) const;
@@ -265,6 +267,59 @@ void CTestRangeMap::TestRangeMap(void) const
     End();
 }
 
+void CTestRangeMap::TestRangeMapIndex(void) const
+{
+    Filling("CRangeMapIndex");
+
+    typedef CRangeMultimap<int> TMap;
+    typedef TMap::const_iterator TMapCI;
+    typedef CRangeMapIndex<TMap> TIndex;
+    typedef TIndex::const_iterator TIndexCI;
+
+    TMap m;
+
+    // fill, with a few long intervals to get several levels
+    for ( int count = 0; count < m_RangeNumber; ++count ) {
+        TRange range = RandomRange();
+        if ( count % 100 == 0 ) {
+            range.SetLength(range.GetLength() * (1 + rand() % 50));
+        }
+        m.insert(TMap::value_type(range, count));
+        Added(range);
+    }
+
+    TIndex index(m);
+    if ( m_PrintSize ) {
+        Filled(index.size());
+    }
+    assert(index.size() == m.size());
+
+    // the index should find the same entries in the same order
+    size_t scannedCount = 0;
+    for ( int count = 0; count < m_ScanCount; ++count ) {
+        for ( int pos = 0; pos <= m_Length + 2*m_RangeLength;
+              pos += m_ScanStep ) {
+            TRange range;
+            range.Set(pos, pos + m_ScanLength - 1);
+
+            StartFrom(range);
+
+            TMapCI i = m.begin(range);
+            TIndexCI j = index.begin(range);
+            for ( ; i; ++i, ++j ) {
+                assert(j);
+                assert(&*i == &*j);
+                From(range, j.GetInterval());
+                ++scannedCount;
+            }
+            assert(!j);
+        }
+    }
+    PrintTotalScannedNumber(scannedCount);
+
+    End();
+}
+
 void CTestRangeMap::Init(void)
 {
     SetDiagPostLevel(eDiag_Warning);
@@ -279,7 +334,8 @@ void CTestRangeMap::Init(void)
                      CArgDescriptions::eString, "CIntervalTree");
     d->SetConstraint("t", (new CArgAllow_Strings)->
                      Allow("CIntervalTree")->Allow("i")->
-                     Allow("CRangeMap")->Allow("r"));
+                     Allow("CRangeMap")->Allow("r")->
+                     Allow("CRangeMapIndex")->Allow("x"));
 
     d->AddDefaultKey("c", "count",
                      "how may times to run whole test",
@@ -333,10 +389,15 @@ int CTestRangeMap::Run(void)
     bool intervalTree =
         args["t"].AsString() == "CIntervalTree" ||
         args["t"].AsString() == "i";
+    bool rangeMapIndex =
+        args["t"].AsString() == "CRangeMapIndex" ||
+        args["t"].AsString() == "x";
 
     for ( int count = 0; count < m_Count; ++count ) {
         if ( intervalTree )
             TestIntervalTree();
+        else if ( rangeMapIndex )
+            TestRangeMapIndex();
         else
             TestRangeMap();
     }